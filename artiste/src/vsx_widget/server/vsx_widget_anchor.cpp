@@ -1789,17 +1789,12 @@ bool vsx_widget_anchor::event_key_down(signed long key, bool alt, bool ctrl, boo
 
 void vsx_widget_anchor::get_value() 
 {
-  if (io == -1)
-  {
-    command_q_b.add_raw("param_get " + component->name+" "+name+" "+i2s(id));
-  }
-  else
-  {
-    if (p_type != "render")
-    {
-      command_q_b.add_raw("pgo " + component->name+" "+name+" "+i2s(id));
-    }
-  }
+  if (io == 1 && p_type == "render") return;
+  // the engine sends the value (param_values) whenever it changes for as long
+  // as we keep renewing the watch, no need to ask every time we're drawn
+  if (time - watch_time < VSX_WIDGET_ANCHOR_WATCH_RENEW) return;
+  watch_time = time;
+  command_q_b.add_raw("param_watch " + component->name+" "+name+" "+i2s(io)+" "+i2s(id));
   component->vsx_command_queue_b(this);
 }
 
@@ -2264,6 +2259,7 @@ vsx_widget_anchor::vsx_widget_anchor()
   alias_for_component = alias_for_anchor = "";
   menu = search_anchor = t = 0;
   display_value_t = 0.0f;
+  watch_time = -VSX_WIDGET_ANCHOR_WATCH_RENEW;
   widget_type = VSX_WIDGET_TYPE_ANCHOR;
 }
 
@@ -29,6 +29,9 @@
 // VSX_WIDGET_ANCHOR ************************************************************************************************
 // VSX_WIDGET_ANCHOR ************************************************************************************************
 // VSX_WIDGET_ANCHOR ************************************************************************************************
+// seconds between renewing the param_watch for our value
+#define VSX_WIDGET_ANCHOR_WATCH_RENEW 0.5
+
 class vsx_widget_anchor : public vsx_widget {
   vsx_widget *t;
   vsx_string display_value;
@@ -60,6 +63,9 @@ class vsx_widget_anchor : public vsx_widget {
 
   vsx_widget* search_anchor;
 
+  // when we last asked the engine to keep sending our value
+  double watch_time;
+
 public:
   float text_size;
   float display_value_t;
@@ -42,6 +42,7 @@
 #include "vsx_module.h"
 #include "vsx_version.h"
 #include "vsx_platform.h"
+#include "vsx_timer.h"
 // local includes
 #include "log/vsx_log_a.h"
 #include "vsx_widget_base.h"
@@ -75,6 +76,7 @@ vsx_widget_server::vsx_widget_server() {
   cmd_in = 0;
   server_type = VSX_WIDGET_SERVER_CONNECTION_TYPE_INTERNAL;
   init_run = false;
+  state_generation = 0;
   support_scaling = false;
   selection = false;
   #if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
@@ -146,6 +148,7 @@ module browser\n\
   menu->commands.adds(VSX_COMMAND_MENU,"configuration >;gui framerate limit >;85fps","conf","global_framerate_limit 85");
   menu->commands.adds(VSX_COMMAND_MENU,"configuration >;gui framerate limit >;90fps","conf","global_framerate_limit 90");
   menu->commands.adds(VSX_COMMAND_MENU,"configuration >;gui framerate limit >;100fps","conf","global_framerate_limit 100");
+  menu->commands.adds(VSX_COMMAND_MENU,"server >;resync state","state_resync","");
   #if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
   menu->commands.adds(VSX_COMMAND_MENU,"server >;connect to rendering server...","show_connect_dialog","");
   #endif
@@ -286,8 +289,12 @@ void vsx_widget_server::vsx_command_process_f() {
   }
   
 	if (init_run) {
+    // a whole state arrives in one go, work through it over a few frames
+    // instead of freezing the gui until it's all there
+    vsx_timer budget_timer;
+    double budget_end = budget_timer.atime() + VSX_WIDGET_SERVER_COMMAND_BUDGET;
     // messages from the engine
-		while ( (c = cmd_in->pop()) )
+		while ( budget_timer.atime() < budget_end && (c = cmd_in->pop()) )
 		{
       //c->dump_to_stdout();
 			if (c->cmd == "vsxu_welcome") {
@@ -398,6 +405,49 @@ void vsx_widget_server::vsx_command_process_f() {
 				}
 			}
 			else
+			if (c->cmd == "param_values") {
+				// syntax:
+				//  param_values [gui-id]:[value],[gui-id]:[value],...
+				// sampled values of what the anchors watch, they get them as
+				// if they had asked with param_get
+				std::vector<vsx_string> values;
+				vsx_string deli = ",";
+				explode(c->parts[1], deli, values);
+				for (size_t i = 0; i < values.size(); i++) {
+					std::vector<vsx_string> id_value;
+					vsx_string deli_value = ":";
+					explode(values[i], deli_value, id_value);
+					if (id_value.size() != 2) continue;
+					vsx_widget* t = f(s2i(id_value[0]));
+					if (t && t->widget_type == VSX_WIDGET_TYPE_ANCHOR) {
+						vsx_widget_anchor* anchor = (vsx_widget_anchor*)t;
+						command_q_b.add_raw("param_get_ok "+anchor->component->name+" "+anchor->name+" "+id_value[1]+" "+id_value[0]);
+						t->vsx_command_queue_b(this);
+					}
+				}
+			}
+			else
+			if (c->cmd == "state_generation") {
+				// the engine's change log generation of what we've got, what
+				// to ask get_state_since for
+				state_generation = s2i(c->parts[1]);
+			}
+			else
+			if (c->cmd == "state_sync_full") {
+				// the engine couldn't replay what we missed, the whole state
+				// follows, start over
+				for (note_iter = note_list.begin(); note_iter != note_list.end(); ++note_iter) {
+					(*note_iter).second->_delete();
+				}
+				note_list.clear();
+				std::map<vsx_string, vsx_widget*>temp_ = comp_list;
+				for (std::map<vsx_string, vsx_widget*>::iterator it = temp_.begin(); it != temp_.end(); ++it) {
+          (*it).second->_delete();
+				}
+				if (sequencer)
+          sequencer->message("clear");
+			}
+			else
 			if (c->cmd == "param_alias_ok") {
 				// syntax:
 				//          param_alias_ok [p_def] [-1=in / 1=out] [component] [parameter] [source_component] [source_parameter]
@@ -1122,6 +1172,10 @@ void vsx_widget_server::vsx_command_process_b(vsx_command_s *t) {
 				// PORRRRRRRRRRN
 			}
 		} else
+		if (t->cmd == "state_resync") {
+			// ask for what changed since the last generation we saw
+			cmd_out->add_raw("get_state_since "+i2s(state_generation));
+		} else
 		if (t->cmd == "alert_dialog") {
 			root->add(new dialog_messagebox(t->parts[1],(base64_decode(t->parts[2])+"|")),"alert");
 		} else
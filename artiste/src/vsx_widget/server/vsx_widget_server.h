@@ -32,6 +32,9 @@
 #define VSX_WIDGET_SERVER_CONNECTION_TYPE_INTERNAL 1
 #define VSX_WIDGET_SERVER_CONNECTION_TYPE_SOCKET 2
 
+// seconds per frame spent on commands from the engine
+#define VSX_WIDGET_SERVER_COMMAND_BUDGET 0.02
+
 class vsx_widget_server : public vsx_widget {
 #ifndef VSXU_PLAYER  
   vsx_texture mtex;
@@ -68,6 +71,8 @@ public:
   void *engine;
 
   vsx_string state_name;
+  // change log generation of the state we show, see get_state_since
+  int state_generation;
   
   vsx_string connection_id; // the unique id of this connection in the event that multiple clients are connected to one server
   vsx_string server_version; // the server version of vsxu
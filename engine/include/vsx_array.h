@@ -26,6 +26,9 @@
 
 #include <stdlib.h>
 #include <string.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 // VSX Array class
 //
 // This is a special case array aimed at speed - for mesh data etc.
@@ -35,6 +38,25 @@
 // * DON'T POINT TO ANY ELEMENT/DATA STORED IN THE ARRAY
 //   (data is realloc'd, such pointers would be invalid)
 // Now you've been warned, use it for speed!
+//
+// Sharing: share() makes this array point at the memory of another one
+// instead of copying it, the memory gets a reference count and is freed by
+// whoever lets go of it last. Anything that changes the layout - growing
+// past used, memory_clear, clone, set_data - first gives this array a
+// private copy, so the other holders never see a realloc or a free.
+// Writing elements in place through get_pointer() / [] does NOT copy, all
+// holders see it (same as the old volatile arrays). Use
+// get_write_pointer() if you want to change the data just for yourself.
+// The count is atomic so holders may live in different threads, the data
+// itself is not protected.
+
+#if defined(_MSC_VER)
+  #define VSX_ARRAY_REF_INC(p) _InterlockedIncrement(p)
+  #define VSX_ARRAY_REF_DEC(p) _InterlockedDecrement(p)
+#else
+  #define VSX_ARRAY_REF_INC(p) __sync_add_and_fetch(p, 1)
+  #define VSX_ARRAY_REF_DEC(p) __sync_sub_and_fetch(p, 1)
+#endif
 
 template<class T>
 class vsx_array {
@@ -43,8 +65,48 @@ class vsx_array {
   T* A;
   size_t allocation_increment;
   size_t data_volatile;
+  // holders of A when it's shared, 0 while A is ours alone
+  volatile long* refs;
+
+  // let go of shared memory, freeing it if we were the last one
+  void release()
+  {
+    if (VSX_ARRAY_REF_DEC(refs) == 0)
+    {
+      free(A);
+      delete refs;
+    }
+    refs = 0;
+    A = 0;
+    used = allocated = 0;
+  }
+
+  // get a private copy of shared memory before changing its layout.
+  // Copy first, then drop the reference - someone else may be freeing it.
+  void detach()
+  {
+    if (!refs) return;
+    if (*refs == 1)
+    {
+      // the others are gone already
+      delete refs;
+      refs = 0;
+      return;
+    }
+    T* n = (T*)malloc(sizeof(T) * allocated);
+    memcpy((void*)n, (void*)A, sizeof(T) * used);
+    if (VSX_ARRAY_REF_DEC(refs) == 0)
+    {
+      free(A);
+      delete refs;
+    }
+    refs = 0;
+    A = n;
+  }
 
 public:
+  // bumped by whoever rewrites the data, copied by share(). Lets a module
+  // see which attributes of a mesh changed; 0 means nobody keeps track.
   size_t timestamp;
 
   void set_allocation_increment(unsigned long new_increment) {
@@ -53,6 +115,7 @@ public:
 
   void set_data(T* nA, int nsize)
   {
+    if (refs) release();
   	A = nA;
   	used = allocated = nsize;
   }
@@ -60,6 +123,7 @@ public:
   // clones another array of same type into this one
   void clone(vsx_array<T>* F)
   {
+    detach();
     allocate(F->size());
     memcpy((void*)A, (void*)(F->get_pointer()), sizeof(T) * used);
   }
@@ -72,8 +136,55 @@ public:
     data_volatile = 1;
   }
 
+  // use the memory of source instead of a copy, see the top of the file.
+  // Volatile (borrowed) data can't be counted, that's borrowed again.
+  void share(vsx_array<T>& source)
+  {
+    if (&source == this) return;
+    timestamp = source.timestamp;
+    if (source.A && source.A == A)
+    {
+      used = source.used;
+      return;
+    }
+    if (source.data_volatile)
+    {
+      set_volatile();
+      set_data(source.A, (int)source.used);
+      return;
+    }
+    unset_volatile();
+    clear();
+    if (!source.A) return;
+    if (!source.refs)
+    {
+      source.refs = new long;
+      *source.refs = 1;
+    }
+    VSX_ARRAY_REF_INC(source.refs);
+    refs = source.refs;
+    A = source.A;
+    used = source.used;
+    allocated = source.allocated;
+    allocation_increment = source.allocation_increment;
+  }
+
+  bool is_shared()
+  {
+    return refs && *refs > 1;
+  }
+
+  // pointer to data nobody else sees, copies it if it's shared
+  T* get_write_pointer()
+  {
+    detach();
+    return A;
+  }
+
+  // stop using borrowed or shared memory, next allocate() gets our own
   void unset_volatile()
   {
+    if (refs) release();
     if (data_volatile) {
       A = 0;
       allocated = 0;
@@ -109,6 +220,7 @@ public:
 
   void clear() {
     if (data_volatile) { return; }
+    if (refs) release();
   	if (A)
     free(A);
     A = 0;
@@ -118,6 +230,7 @@ public:
 
   void memory_clear()
   {
+    detach();
     memset(A, 0, sizeof(T) * allocated);
   }
 
@@ -127,6 +240,7 @@ public:
   }
 
   void allocate(size_t index) {
+    if (refs && index >= used) detach();
     if (index >= allocated || allocated == 0)
     {
     	if (allocation_increment == 0) allocation_increment = 1;
@@ -150,9 +264,14 @@ public:
     return A[index];
   }
 
-  vsx_array() : allocated(0),used(0),A(0),allocation_increment(1),data_volatile(0),timestamp(0) {};
+  vsx_array() : allocated(0),used(0),A(0),allocation_increment(1),data_volatile(0),refs(0),timestamp(0) {};
   ~vsx_array() {
     if (data_volatile) return;
+    if (refs)
+    {
+      release();
+      return;
+    }
   	if (A) free(A);
   }
 };
@@ -34,6 +34,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <vector>
 #include <vsx_string.h>
 #include <vsx_command.h>
 
@@ -41,6 +42,73 @@
 #define VSX_COMMAND_CLIENT_CONNECTED 1
 #define VSX_COMMAND_CLIENT_DISCONNECTED 2
 
+// Wire protocol
+//
+// The server's welcome line (text as always) ends with
+// VSX_COMMAND_WIRE_WELCOME when it speaks this protocol. Only then does the
+// client send VSX_COMMAND_WIRE_MAGIC (8 bytes, the last one is the protocol
+// version), and from then on both sides send frames, little endian:
+//
+//   u32  length of the rest of the frame
+//   u32  number of commands, 0 is a keepalive
+//   per command:
+//     u16  opcode: index in the opcode table (vsx_command_client_server.cpp)
+//          or VSX_COMMAND_WIRE_LITERAL followed by the command as a string
+//     u16  number of arguments
+//     the arguments as strings: u32 length + bytes
+//
+// The arguments are the space separated parts of the command, so the other
+// side gets exactly what parsing the text version would give it.
+// Everything a side has queued goes out as one frame in one send, and in a
+// row of param sets only the last one for each parameter is kept.
+//
+// A client that doesn't start with the magic (telnet, old clients) gets the
+// old newline separated text; the server holds its output until the first
+// bytes from the client tell it which one it's talking to. Against a server
+// without the welcome tag the client stays on text.
+
+#define VSX_COMMAND_WIRE_WELCOME " wire 1"
+#define VSX_COMMAND_WIRE_MAGIC "VSXWIRE\x01"
+#define VSX_COMMAND_WIRE_MAGIC_SIZE 8
+#define VSX_COMMAND_WIRE_LITERAL 0xffff
+// anything bigger is a broken stream
+#define VSX_COMMAND_WIRE_MAX_FRAME (64 * 1024 * 1024)
+
+class vsx_command_wire
+{
+  std::vector<char> out;
+  std::vector<char> in;
+  // start of the unread part of in
+  size_t in_pos;
+
+  void write_u16(unsigned int v);
+  void write_u32(unsigned int v);
+  void write_string(const char* s, size_t size);
+
+public:
+  vsx_command_wire();
+
+  // pops everything in the list into one frame, returns how many commands
+  // went into it after coalescing
+  size_t encode(vsx_command_list* list);
+  // empty frame
+  void encode_keepalive();
+
+  // what's waiting to be sent
+  const char* get_out();
+  size_t get_out_size();
+  void clear_out();
+
+  // received bytes, when the socket had some
+  void receive(const char* data, size_t size);
+  // commands from every complete frame received so far, false if the
+  // stream is broken
+  bool decode(std::vector<vsx_command_s*>& commands);
+
+  // start over on a new connection
+  void reset();
+};
+
 class vsx_command_list_server
 {
   pthread_t         worker_t;
@@ -44,6 +44,8 @@ class vsx_channel;
 // join another component with the first
 // 
 
+class vsx_param_vsxl_abs;
+
 class vsx_comp : public vsx_comp_abs {
 protected:
 	enum frame_status_enum {
@@ -59,11 +61,16 @@ protected:
   bool all_valid;
 	bool output_finished;
 	vsx_timer run_timer;
+  // vsxl filters of the parameters, run together in prepare()
+  std::vector<vsx_param_vsxl_abs*> vsxl_param_filters;
 	
 public:
 
   // is internal critical to vsx_engine?
   bool internal_critical;
+
+  // change log generation of the last change to this component
+  unsigned long generation;
   
   // parameter lists filled out by the module
 	vsx_module_param_list* in_module_parameters;
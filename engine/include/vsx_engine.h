@@ -51,6 +51,9 @@
 #include "vsx_param_sequence.h"
 #include "vsx_param_sequence_list.h"
 #include "vsx_sequence_pool.h"
+#include "vsx_engine_change_log.h"
+#include "vsx_param_telemetry.h"
+#include "vsx_metrics.h"
 #include "vsx_module_list_abs.h"
 
 
@@ -130,6 +133,10 @@ public:
   void reset_time();
   double get_fps();
   float get_last_frame_time();
+
+  // adds this engine's numbers, labelled engine="[metrics id]"; the engine
+  // registers itself with vsx_metrics so this normally isn't called directly
+  void get_metrics(vsx_metrics_writer& out);
   void set_amp(float amp);
   void set_speed(float spd);
 
@@ -161,6 +168,28 @@ public:
   // loads a new state (clearing out the previous one)
   int load_state(vsx_string filename, vsx_string *error_string = 0);
 
+  // load_state in two steps, for switching states without stalling rendering:
+  //   read_state  - reads / unpacks the file. Only touches this engine's
+  //                 filesystem, so it can run on another thread as long as
+  //                 the engine isn't used meanwhile. false if there's nothing
+  //                 to load (broken archive).
+  //   queue_state - on the render thread: checks the modules and queues the
+  //                 commands, they're run by process_message_queue within the
+  //                 load budget. Same return value as load_state.
+  bool read_state(vsx_string filename, std::vector<vsx_string>& lines);
+  int queue_state(vsx_string filename, std::vector<vsx_string>& lines, vsx_string *error_string = 0);
+
+  // seconds per process_message_queue for the commands of a loading state,
+  // 0 (default) runs them all at once
+  void set_load_budget(float new_value);
+
+  // seconds of timeline the sequencers look ahead for resource parameters
+  // changing, so the loaders can have the files ready (vsx_module::prefetch).
+  // Default 2, or VSXU_PREFETCH_HORIZON from the environment; 0 turns it off.
+  // It doesn't look across a loop point (time_set_loop_point or the
+  // sequence pool's), what comes after the jump back is loaded on demand
+  void set_prefetch_horizon(float new_value);
+
   // process messages - this should be run once per physical frame
   void process_message_queue(vsx_command_list *cmd_in, vsx_command_list *cmd_out_res, bool exclusive = false, bool ignore_timing = false, float max_time = 0.01f);
 
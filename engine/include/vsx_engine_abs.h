@@ -67,6 +67,28 @@ protected:
   vsx_param_sequence_list sequence_list;
   vsx_sequence_pool sequence_pool;
 
+//-- client state sync
+  // numbered structural changes, for clients catching up
+  vsx_engine_change_log change_log;
+  // parameter values clients are watching
+  vsx_param_telemetry telemetry;
+
+//-- metrics (see vsx_metrics.h)
+  int metrics_id;
+  vsx_timer metrics_timer;
+  // start of the last render(), for the time between frames
+  double metrics_frame_start;
+  vsx_metrics_histogram metrics_frame_time;
+  double metrics_frames;
+  // seconds spent in each part of render()
+  double metrics_time_sequencer;
+  double metrics_time_interpolation;
+  double metrics_time_prepare;
+  double metrics_time_reset;
+  // process_message_queue
+  double metrics_commands;
+  double metrics_time_commands;
+
 //-- notes
   std::map<vsx_string,vsx_note> note_map;
   std::map<vsx_string,vsx_note>::iterator note_iter;
@@ -123,6 +145,13 @@ protected:
   // constant frame progression time
   float frame_cfp_time;
 
+  // seconds per process_message_queue spent on the commands of a state that's
+  // loading, 0 for no limit
+  float load_budget;
+
+  // how far ahead the sequencers tell modules about resources, 0 = off
+  float prefetch_horizon;
+
   // engine speed control
   float g_timer_amp;
 
@@ -150,7 +179,9 @@ protected:
 
 //-- internal methods
   void tell_client_time(vsx_command_list *cmd_out);
-  int i_load_state(vsx_command_list& load1, vsx_string *error_string, vsx_string info_filename = "[undefined]");
+  // deferred: queue the commands instead of running them, process_message_queue
+  // picks them up
+  int i_load_state(vsx_command_list& load1, vsx_string *error_string, vsx_string info_filename = "[undefined]", bool deferred = false);
   void i_clear(vsx_command_list *cmd_out = 0, bool clear_critical = false);
   void rename_component();
   int rename_component(vsx_string old_identifier, vsx_string new_base = "$", vsx_string new_name = "$");
@@ -158,6 +189,9 @@ protected:
   void redeclare_in_params(vsx_comp* comp, vsx_command_list *cmd_out);
   void redeclare_out_params(vsx_comp* comp, vsx_command_list *cmd_out);
   void send_state_to_client(vsx_command_list *cmd_out);
+  // moves the replies of one command from staging to dest, recording the
+  // ones that change the state when dest is the client
+  void log_changes(vsx_command_list *staging, vsx_command_list *dest, bool to_client);
   int get_state_as_commandlist(vsx_command_list &savelist);
   void message_fail(vsx_string header, vsx_string message);
   // called each frame after engine has rendered
@@ -0,0 +1,82 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+
+#ifndef VSX_ENGINE_CHANGE_LOG_H
+#define VSX_ENGINE_CHANGE_LOG_H
+
+#include <deque>
+#include "vsx_string.h"
+#include "vsx_command.h"
+
+// Every structural change the engine tells a client about (components,
+// parameter specs, connections, aliases, vsxl filters, notes, sequences)
+// is kept here, numbered with a generation that only goes up. A client that
+// knows the last generation it saw asks for "get_state_since N" and gets
+// only what happened after N instead of the whole state again.
+//
+// The entries are the reply commands the engine already sends, so replaying
+// them is exactly what a client that was listening all along would have
+// seen. Clearing / loading a state throws the log away, and the oldest
+// entries fall out when it's full; anyone asking for a generation before
+// that (the horizon) gets a full dump.
+
+#define VSX_ENGINE_CHANGE_LOG_SIZE 4096
+
+class vsx_engine_change_log_entry
+{
+public:
+  unsigned long generation;
+  vsx_string command;
+};
+
+class vsx_engine_change_log
+{
+  std::deque<vsx_engine_change_log_entry> entries;
+  unsigned long generation;
+  // the oldest generation a client can replay from
+  unsigned long horizon;
+
+public:
+  vsx_engine_change_log();
+
+  // does this reply change the state a client has to show
+  static bool is_change(vsx_command_s* c);
+
+  // part of the command that names the component it changes, 0 for none
+  static size_t component_part(vsx_command_s* c);
+
+  // returns the generation given to the entry
+  unsigned long add(vsx_command_s* c);
+
+  // the state was replaced, nothing before now can be replayed
+  void invalidate();
+
+  unsigned long get_generation();
+
+  // adds everything after since to cmd_out, false if since is too old
+  // (or 0, which no client has seen)
+  bool get_since(unsigned long since, vsx_command_list* cmd_out);
+};
+
+#endif
@@ -0,0 +1,103 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef VSX_FFT_H
+#define VSX_FFT_H
+
+#include <vsx_platform.h>
+#include <stdlib.h>
+#include <vector>
+
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+#define VSX_FFT_DLLIMPORT
+#else
+  #if defined(VSX_ENG_DLL)
+    #define VSX_FFT_DLLIMPORT __declspec (dllexport)
+  #else
+    #define VSX_FFT_DLLIMPORT __declspec (dllimport)
+  #endif
+#endif
+
+// Single precision 2D FFT for power of two sizes.
+//
+// All state lives in the instance (twiddle and bit reversal tables), so any
+// number of them can run at the same time. Rows and then columns are split
+// over the engine thread pool; columns are done in blocks so every
+// butterfly walks along rows in memory instead of striding down the image.
+//
+// Data is row major, data[y * size_x + x], transformed in place.
+// Conventions are the same as Paul Bourke's FFT2D which this replaces:
+//   forward: X(n) = 1/N sum x(k) e^(-j 2 pi k n / N)
+//   inverse: x(n) =     sum X(k) e^( j 2 pi k n / N)
+//
+// There is no separate real transform. If the spectrum is hermitian
+// (F(-k) = conj(F(k)), which is what you have when the result is real),
+// pack two of them as A + iB and the inverse gives you a in the real part
+// and b in the imaginary part - two real transforms for the price of one.
+
+class vsx_fft_complex
+{
+public:
+  float re;
+  float im;
+};
+
+class VSX_FFT_DLLIMPORT vsx_fft_2d
+{
+  size_t size_x;
+  size_t size_y;
+  std::vector<vsx_fft_complex> twiddle_x; // e^(j 2 pi k / size_x), k < size_x / 2
+  std::vector<vsx_fft_complex> twiddle_y;
+  std::vector<size_t> reverse_x;
+  std::vector<size_t> reverse_y;
+
+  // per call state handed to the pool
+  class pass
+  {
+  public:
+    vsx_fft_2d* fft;
+    vsx_fft_complex* data;
+    bool inverse;
+  };
+  static void rows_task(void* arg, size_t start, size_t end);
+  static void columns_task(void* arg, size_t start, size_t end);
+  void transform(vsx_fft_complex* data, bool inverse, bool threaded);
+
+public:
+  vsx_fft_2d();
+
+  // false if a size isn't a power of two
+  bool init(size_t size_x, size_t size_y);
+
+  size_t get_size_x() { return size_x; }
+  size_t get_size_y() { return size_y; }
+
+  void forward(vsx_fft_complex* data, bool threaded = true);
+  void inverse(vsx_fft_complex* data, bool threaded = true);
+
+  // 1D helpers on one contiguous row of size_x
+  void forward_row(vsx_fft_complex* row);
+  void inverse_row(vsx_fft_complex* row);
+};
+
+#endif
@@ -51,6 +51,17 @@ inline vsx_tex_coord vsx_tex_coord__(float x, float y) {
   return a;
 }
 
+// attributes for vsx_mesh_data::share()
+#define VSX_MESH_VERTICES 1
+#define VSX_MESH_VERTEX_NORMALS 2
+#define VSX_MESH_VERTEX_COLORS 4
+#define VSX_MESH_VERTEX_TEX_COORDS 8
+#define VSX_MESH_FACES 16
+#define VSX_MESH_FACE_NORMALS 32
+#define VSX_MESH_VERTEX_TANGENTS 64
+#define VSX_MESH_FACE_CENTERS 128
+#define VSX_MESH_ALL 255
+
 // the mesh contains vertices stored in a local coordinate system.
 #ifndef VSX_NO_MESH
 class vsx_mesh_data {
@@ -67,14 +78,31 @@ public:
   // selected vertices, whom wich should be modified when run through a mesh deformer that modifies the
   // vertex coordinates
   vsx_array<unsigned long>* selected_vertices;
+  // affine transform the vertices and normals haven't seen yet. The
+  // transform modifiers stack theirs up here (see
+  // vsx_mesh_kernels::stack_transform) and the first module that reads the
+  // vertices applies them all in one go - vsx_module_param_mesh::get_addr()
+  // does that, only get_addr_lazy() hands out meshes with this set.
+  vsx_matrix pending_transform;
+  bool transform_pending;
 
+  // single threaded, vsx_mesh_kernels has a pooled version for big meshes
   void calculate_face_centers() {
     if (!faces.size()) return;
+    face_centers.allocate(faces.size() - 1);
+    face_centers.reset_used(faces.size());
+    vsx_face* fp = faces.get_pointer();
+    vsx_vector* vp = vertices.get_pointer();
+    // may still be shared with the module we got the mesh from
+    vsx_vector* cp = face_centers.get_write_pointer();
+    const float third = 1.0f / 3.0f;
     for (unsigned long i = 0; i < faces.size(); ++i) {
-      //printf("i: %d %d\n",i,faces[i].a);
-      face_centers[i].x = (vertices[faces[i].a].x+vertices[faces[i].b].x+vertices[faces[i].c].x);
-      face_centers[i].y = (vertices[faces[i].a].y+vertices[faces[i].b].y+vertices[faces[i].c].y);
-      face_centers[i].z = (vertices[faces[i].a].z+vertices[faces[i].b].z+vertices[faces[i].c].z);
+      const vsx_vector& a = vp[fp[i].a];
+      const vsx_vector& b = vp[fp[i].b];
+      const vsx_vector& c = vp[fp[i].c];
+      cp[i].x = (a.x + b.x + c.x) * third;
+      cp[i].y = (a.y + b.y + c.y) * third;
+      cp[i].z = (a.z + b.z + c.z) * third;
     }
   }
   
@@ -100,9 +128,26 @@ public:
     faces.reset_used();
     face_normals.reset_used();
     face_centers.reset_used();
+    transform_pending = false;
+  }
+
+  // use the attributes of source without copying them (see vsx_array.h),
+  // the others are left alone. A modifier that only moves vertices shares
+  // everything but VSX_MESH_VERTICES and writes those itself.
+  void share(vsx_mesh_data* source, unsigned int attributes) {
+    if (attributes & VSX_MESH_VERTICES) vertices.share(source->vertices);
+    if (attributes & VSX_MESH_VERTEX_NORMALS) vertex_normals.share(source->vertex_normals);
+    if (attributes & VSX_MESH_VERTEX_COLORS) vertex_colors.share(source->vertex_colors);
+    if (attributes & VSX_MESH_VERTEX_TEX_COORDS) vertex_tex_coords.share(source->vertex_tex_coords);
+    if (attributes & VSX_MESH_FACES) faces.share(source->faces);
+    if (attributes & VSX_MESH_FACE_NORMALS) face_normals.share(source->face_normals);
+    if (attributes & VSX_MESH_VERTEX_TANGENTS) vertex_tangents.share(source->vertex_tangents);
+    if (attributes & VSX_MESH_FACE_CENTERS) face_centers.share(source->face_centers);
   }
+
   vsx_mesh_data() {
     selected_vertices = 0;
+    transform_pending = false;
   }
   
   void clear() {
@@ -120,6 +165,7 @@ public:
     face_normals.clear(); 
     //printf("fc\n");
     face_centers.clear();
+    transform_pending = false;
     //printf("--end\n");
   }
 
@@ -129,6 +175,13 @@ public:
 };
 #endif
 
+// something cached alongside a mesh and deleted with it, see
+// vsx_mesh_spatial
+class vsx_mesh_attachment {
+public:
+  virtual ~vsx_mesh_attachment() {}
+};
+
 class vsx_mesh {
 public:
   unsigned long timestamp;
@@ -137,13 +190,17 @@ public:
 #else
   void* data;
 #endif
+  // spatial index, made by the first module that asks for it
+  vsx_mesh_attachment* spatial;
   vsx_mesh() {
+    spatial = 0;
 #ifndef VSX_NO_MESH
     data = new vsx_mesh_data;
     timestamp = rand();
 #endif
   }
   ~vsx_mesh() {
+    delete spatial;
 #ifndef VSX_NO_MESH
     delete (vsx_mesh_data*)data;
 #endif
@@ -0,0 +1,115 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef VSX_MESH_CONTAINER_H
+#define VSX_MESH_CONTAINER_H
+
+#include <vsx_platform.h>
+#include <stdint.h>
+#include <vector>
+#include "vsx_math_3d.h"
+#include "vsx_mesh.h"
+
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+#define VSX_MESH_CONTAINER_DLLIMPORT
+#else
+  #if defined(VSX_ENG_DLL)
+    #define VSX_MESH_CONTAINER_DLLIMPORT __declspec (dllexport)
+  #else
+    #define VSX_MESH_CONTAINER_DLLIMPORT __declspec (dllimport)
+  #endif
+#endif
+
+// Baked mesh file (.vxb), written by tools/vsxmesh - the successor of .vxm,
+// which was raw vsx_vector/vsx_face memory behind native size_t lengths.
+//
+// Everything is little endian with fixed size fields, and every attribute
+// section starts at a multiple of 64 bytes. Uncompressed sections are used
+// in place: load_memory() points the mesh arrays at the file image, so
+// with a mapped file (vsxf::f_data_map) loading costs nothing but the page
+// faults. Compressed sections are decoded on the thread pool.
+//
+// File layout:
+//   char[4]  "VXB1"
+//   uint32   version, flags, number of sections
+//   uint32   vertex count, face count
+//   float[6] bounds min xyz, max xyz
+//   pad to 64 bytes
+//   per section, 32 bytes: uint32 attribute, encoding, element count,
+//                          element size, uint64 offset, size in bytes
+//   section data
+//
+// Compressed sections (VSX_MESH_CONTAINER_DELTA) are split in blocks of
+// 4096 elements: uint32 block count, block count + 1 uint32 offsets from
+// the end of that table, then the blocks. Every 32 bit word of an element
+// is stored as a LEB128 varint of
+//   faces     zigzag(index - previous index), mostly tiny for a mesh in
+//             vertex cache order
+//   others    word xor the same word of the previous element - neighbours
+//             share sign, exponent and the top of the mantissa
+// Lossless, 35-55% smaller than raw on the grids and scans tried so far.
+
+#define VSX_MESH_CONTAINER_VERSION 1
+
+// flags
+#define VSX_MESH_CONTAINER_COMPRESSED 1
+
+// section attributes, the same bits as vsx_mesh_data::share() takes
+#define VSX_MESH_CONTAINER_VERTICES VSX_MESH_VERTICES
+#define VSX_MESH_CONTAINER_VERTEX_NORMALS VSX_MESH_VERTEX_NORMALS
+#define VSX_MESH_CONTAINER_VERTEX_COLORS VSX_MESH_VERTEX_COLORS
+#define VSX_MESH_CONTAINER_VERTEX_TEX_COORDS VSX_MESH_VERTEX_TEX_COORDS
+#define VSX_MESH_CONTAINER_FACES VSX_MESH_FACES
+#define VSX_MESH_CONTAINER_VERTEX_TANGENTS VSX_MESH_VERTEX_TANGENTS
+
+// section encodings
+#define VSX_MESH_CONTAINER_RAW 0
+#define VSX_MESH_CONTAINER_DELTA 1
+
+class VSX_MESH_CONTAINER_DLLIMPORT vsx_mesh_container
+{
+public:
+  uint32_t flags;
+  unsigned long vertex_count;
+  unsigned long face_count;
+  vsx_vector bounds_min;
+  vsx_vector bounds_max;
+  // after load_memory(), the attributes (VSX_MESH_CONTAINER_* bits) that
+  // point into the file image
+  unsigned int in_place;
+
+  vsx_mesh_container();
+
+  // the file image of vertices, faces, normals, texture coordinates, colors
+  // and tangents of data, malloc'ed - free() it when done. Normals are
+  // calculated if data has none, bounds always. flags picks compression.
+  // 0 if there are no vertices.
+  unsigned char* serialize(vsx_mesh_data* data, unsigned long& size);
+
+  // parse a file image into out (old arrays are dropped). The image must
+  // stay put as long as out uses it, see in_place. False for a broken or
+  // unknown file, out is empty then.
+  bool load_memory(const unsigned char* data, unsigned long size, vsx_mesh_data* out);
+};
+
+#endif
@@ -0,0 +1,121 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef VSX_MESH_KERNELS_H
+#define VSX_MESH_KERNELS_H
+
+#include <vsx_platform.h>
+#include <stdlib.h>
+#include <vector>
+#include "vsx_math_3d.h"
+#include "vsx_mesh.h"
+
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+#define VSX_MESH_KERNELS_DLLIMPORT
+#else
+  #if defined(VSX_ENG_DLL)
+    #define VSX_MESH_KERNELS_DLLIMPORT __declspec (dllexport)
+  #else
+    #define VSX_MESH_KERNELS_DLLIMPORT __declspec (dllimport)
+  #endif
+#endif
+
+// flags for calculate_vertex_normals()
+// every face counts the same instead of by its area (what the inflate
+// modules always did)
+#define VSX_MESH_KERNELS_UNIT_FACES 1
+// point the normals the other way, for clockwise meshes
+#define VSX_MESH_KERNELS_FLIP 2
+
+// The per vertex/per face math every mesh module needs, in one place.
+//
+// Everything is split over the engine thread pool, in chunks of a few
+// thousand faces or vertices, and nothing ever scatters into a shared
+// array: vertex normals and tangents are gathered per vertex through a
+// vertex -> face table (CSR: the faces of vertex v are
+// face_list[vertex_start[v] .. vertex_start[v + 1]]) so no two tasks
+// touch the same output.
+//
+// The table only depends on the faces, it's rebuilt when the face array,
+// the face count or the vertex count changes. If you rewrite the faces in
+// place with the same counts, call topology_changed() - and since a mesh
+// from another module can have that happen behind your back, call it
+// whenever its timestamp changes.
+//
+// Keep one instance per module (the table and the scratch buffers live in
+// it), and only hand it meshes whose arrays you own - the results are
+// written straight into them.
+
+class VSX_MESH_KERNELS_DLLIMPORT vsx_mesh_kernels
+{
+  std::vector<unsigned int> vertex_start;
+  std::vector<unsigned int> face_list;
+  const vsx_face* adjacency_faces;
+  size_t adjacency_face_count;
+  size_t adjacency_vertex_count;
+
+  // 4 floats per face so the gather can load them in one go
+  std::vector<float> face_scratch;
+
+  void build_adjacency(vsx_mesh_data* data);
+
+public:
+  vsx_mesh_kernels();
+
+  // forget the vertex -> face table
+  void topology_changed();
+
+  // data->face_normals, normalized unless unit is false (then the length
+  // is twice the face area)
+  void calculate_face_normals(vsx_mesh_data* data, bool unit = true);
+
+  // data->face_centers, the average of the 3 corners
+  void calculate_face_centers(vsx_mesh_data* data);
+
+  // data->vertex_normals, normalized sum of the normals of the faces
+  // around each vertex, area weighted by default. Vertices without faces
+  // get 0, 0, 0.
+  void calculate_vertex_normals(vsx_mesh_data* data, int flags = 0);
+
+  // per vertex tangent (xyz, orthogonal to the vertex normal) and
+  // handedness of the bitangent (w, 1 or -1) from the texture coordinates,
+  // Lengyel's method. Needs vertex_tex_coords and vertex_normals for every
+  // vertex, returns false (and leaves result empty) otherwise.
+  bool calculate_tangents(vsx_mesh_data* data, vsx_array<vsx_quaternion>& result);
+
+  // axis aligned box around all vertices, after the pending transform if
+  // there is one. False for an empty mesh.
+  bool calculate_bounds(vsx_mesh_data* data, vsx_vector& min, vsx_vector& max);
+
+  // dest gets all attributes of source (shared, nothing is copied) and m on
+  // top of whatever source still has pending. This is all a transform
+  // modifier has to do per frame.
+  static void stack_transform(vsx_mesh_data* source, vsx_mesh_data* dest, vsx_matrix& m);
+
+  // moves the vertices by data->pending_transform and the normals by its
+  // inverse transpose (keeping their length), in one pass into fresh
+  // arrays - the old ones may be shared with the module we got them from.
+  static void apply_pending_transform(vsx_mesh_data* data);
+};
+
+#endif
@@ -0,0 +1,182 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef VSX_MESH_SPATIAL_H
+#define VSX_MESH_SPATIAL_H
+
+#include <vsx_platform.h>
+#include <stdlib.h>
+#include <float.h>
+#include <vector>
+#include "vsx_math_3d.h"
+#include "vsx_mesh.h"
+
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+#define VSX_MESH_SPATIAL_DLLIMPORT
+#else
+  #if defined(VSX_ENG_DLL)
+    #define VSX_MESH_SPATIAL_DLLIMPORT __declspec (dllexport)
+  #else
+    #define VSX_MESH_SPATIAL_DLLIMPORT __declspec (dllimport)
+  #endif
+#endif
+
+// Spatial queries on meshes and point sets, so nearest vertex picking and
+// particle / mesh collisions don't have to loop over everything.
+//
+//   vsx_bvh         triangles, binned SAH bounding volume hierarchy: ray
+//                   casts and nearest point on the surface
+//   vsx_point_grid  points (vertices, particles), hashed uniform grid:
+//                   nearest point and everything within a radius
+//
+// Both copy what they need at build(), the source can change afterwards.
+// Queries are const and can run from any number of threads, the *_batch
+// versions split the queries over the engine thread pool.
+//
+// Modules normally don't keep their own, they ask the mesh:
+//
+//   vsx_bvh* bvh = vsx_mesh_spatial::get(mesh)->get_bvh();
+//
+// which builds on first use and again whenever the mesh timestamp moves.
+
+// result of a query, distance is FLT_MAX when nothing was found
+class vsx_mesh_spatial_hit
+{
+public:
+  vsx_vector position;
+  float distance; // along the ray, or from the query point
+  unsigned int index; // face, or point
+  // barycentric weights of corners b and c (faces only)
+  float u, v;
+};
+
+class vsx_bvh_node
+{
+public:
+  float min[3];
+  // leaf: first face, inner: index of the left child (the right one is next)
+  unsigned int first;
+  float max[3];
+  // faces in a leaf, 0 for inner nodes
+  unsigned int count;
+};
+
+class VSX_MESH_SPATIAL_DLLIMPORT vsx_bvh
+{
+  std::vector<vsx_bvh_node> nodes;
+  // leaf order: corners of face i at corners[i * 3], its index in the mesh
+  // at face_index[i]
+  std::vector<vsx_vector> corners;
+  std::vector<unsigned int> face_index;
+
+public:
+  // faces pointing outside vertex_count are left out
+  void build(const vsx_vector* vertices, size_t vertex_count, const vsx_face* faces, size_t face_count);
+  void clear();
+
+  // closest hit along origin + t * direction, 0 <= t <= max_distance.
+  // direction doesn't need to be normalized, distance is in units of it.
+  // Both sides of the faces count.
+  bool raycast(const vsx_vector& origin, const vsx_vector& direction, float max_distance, vsx_mesh_spatial_hit& hit) const;
+
+  // closest point on the surface no further away than max_distance
+  bool nearest(const vsx_vector& point, float max_distance, vsx_mesh_spatial_hit& hit) const;
+
+  void raycast_batch(const vsx_vector* origins, const vsx_vector* directions, size_t count, float max_distance, vsx_mesh_spatial_hit* hits) const;
+  void nearest_batch(const vsx_vector* points, size_t count, float max_distance, vsx_mesh_spatial_hit* hits) const;
+
+  size_t get_num_faces() const;
+  size_t get_num_nodes() const;
+};
+
+class VSX_MESH_SPATIAL_DLLIMPORT vsx_point_grid
+{
+  float cell_size;
+  float inverse_cell_size;
+  // cells are counted from the low corner of the points
+  float origin[3];
+  // occupied cell range, searches never leave it
+  int cell_min[3];
+  int cell_max[3];
+  // hash bucket b holds points[bucket_start[b] .. bucket_start[b + 1]]
+  std::vector<unsigned int> bucket_start;
+  std::vector<vsx_vector> points;
+  std::vector<unsigned int> point_index;
+  size_t hash_mask;
+
+  void cell_of(const vsx_vector& p, int* c) const;
+  size_t hash(int x, int y, int z) const;
+  void fill(const vsx_vector* source, size_t count);
+
+public:
+  vsx_point_grid();
+
+  // cell_size 0 picks one that puts a handful of points in every occupied
+  // cell, for volumes as well as for points on a surface
+  void build(const vsx_vector* source, size_t count, float n_cell_size = 0.0f);
+  void clear();
+
+  // index is the point's index in build()'s source
+  bool nearest(const vsx_vector& point, float max_distance, vsx_mesh_spatial_hit& hit) const;
+
+  // indices of all points within radius, appended to result; returns how
+  // many were added. In no particular order.
+  size_t radius(const vsx_vector& point, float radius, std::vector<unsigned int>& result) const;
+
+  // the same into a plain array, out can be 0 to only count
+  size_t radius_query(const vsx_vector& point, float radius, unsigned int* out) const;
+
+  void nearest_batch(const vsx_vector* query, size_t count, float max_distance, vsx_mesh_spatial_hit* hits) const;
+
+  // all results of query i are indices[offsets[i] .. offsets[i + 1]]
+  void radius_batch(const vsx_vector* query, size_t count, float radius, std::vector<unsigned int>& offsets, std::vector<unsigned int>& indices) const;
+
+  float get_cell_size() const;
+  size_t get_num_points() const;
+};
+
+// what vsx_mesh::spatial holds
+class VSX_MESH_SPATIAL_DLLIMPORT vsx_mesh_spatial : public vsx_mesh_attachment
+{
+  vsx_mesh* mesh;
+  vsx_bvh bvh;
+  vsx_point_grid vertex_grid;
+  bool bvh_valid;
+  unsigned long bvh_timestamp;
+  bool grid_valid;
+  unsigned long grid_timestamp;
+
+  vsx_mesh_spatial(vsx_mesh* n_mesh);
+
+public:
+  // the index of this mesh, created the first time
+  static vsx_mesh_spatial* get(vsx_mesh* mesh);
+
+  // faces of the mesh
+  vsx_bvh* get_bvh();
+
+  // vertices of the mesh
+  vsx_point_grid* get_vertex_grid();
+};
+
+#endif
@@ -0,0 +1,171 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+
+#ifndef VSX_METRICS_H
+#define VSX_METRICS_H
+
+#include <vsx_platform.h>
+#include <vector>
+#include <pthread.h>
+#include "vsx_string.h"
+#include "vsx_timer.h"
+
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+#define VSX_METRICS_DLLIMPORT
+#else
+  #if defined(VSX_ENG_DLL)
+    #define VSX_METRICS_DLLIMPORT __declspec (dllexport)
+  #else
+    #define VSX_METRICS_DLLIMPORT __declspec (dllimport)
+  #endif
+#endif
+
+// Process-wide metrics for keeping an eye on a running show.
+//
+// Anything that has numbers worth watching registers a source, a function
+// that adds its current values to a vsx_metrics_writer:
+//
+//   static void my_metrics(vsx_metrics_writer& out, void* arg)
+//   {
+//     out.gauge("vsx_something_queue", ((my_class*)arg)->queue.size());
+//   }
+//   vsx_metrics::get_instance()->add_source(my_metrics, this);
+//   ...
+//   vsx_metrics::get_instance()->remove_source(this);
+//
+// Every engine is a source (frame time histogram, time per render phase,
+// components, command queue), so are the bitmap cache / decoder and the
+// player's engine pool. Sources are called from whoever collects, normally
+// the render thread, and must not block on it.
+//
+// The values go out two ways:
+//  * the engine command "metrics_get [prometheus / json]", answered with
+//    "metrics_ok [format] [base64 text]" - works over vsx_command_list_server
+//  * VSXU_METRICS_FILE in the environment: the file is rewritten every
+//    VSXU_METRICS_INTERVAL seconds (default 5), as json if the name ends in
+//    .json, in the Prometheus text format otherwise (for node_exporter's
+//    textfile collector). Written on the thread pool, the frame doesn't wait.
+//
+// Counters (_total) only go up, rates are for whoever reads them.
+
+// frame time buckets, upper bounds in seconds; 240 / 120 / 90 / 60 / 50 /
+// 40 / 30 / 20 / 15 / 10 fps and worse
+#define VSX_METRICS_HISTOGRAM_BUCKETS 12
+
+class vsx_metrics_writer;
+
+class VSX_METRICS_DLLIMPORT vsx_metrics_histogram
+{
+  unsigned long counts[VSX_METRICS_HISTOGRAM_BUCKETS];
+  unsigned long count;
+  double sum;
+
+public:
+  static const double bounds[VSX_METRICS_HISTOGRAM_BUCKETS];
+
+  vsx_metrics_histogram();
+  void add(double value);
+
+  friend class vsx_metrics_writer;
+};
+
+class vsx_metrics_sample
+{
+public:
+  vsx_string name;
+  // prometheus syntax: engine="1",phase="prepare"
+  vsx_string labels;
+  double value;
+  // gauge, counter or histogram (the _bucket, _sum and _count samples)
+  const char* type;
+  // the name the TYPE line is for, differs from name for histograms
+  vsx_string family;
+};
+
+class VSX_METRICS_DLLIMPORT vsx_metrics_writer
+{
+  std::vector<vsx_metrics_sample> samples;
+  void add(const vsx_string& family, const vsx_string& name, const vsx_string& labels, double value, const char* type);
+
+public:
+  void gauge(const vsx_string& name, double value, const vsx_string& labels = "");
+  void counter(const vsx_string& name, double value, const vsx_string& labels = "");
+  void histogram(const vsx_string& name, const vsx_metrics_histogram& histogram, const vsx_string& labels = "");
+
+  // label value with quotes and backslashes escaped, name="value"
+  static vsx_string label(const vsx_string& name, const vsx_string& value);
+
+  vsx_string get_prometheus();
+  vsx_string get_json();
+};
+
+typedef void (*vsx_metrics_source)(vsx_metrics_writer& out, void* arg);
+
+class vsx_metrics_source_entry
+{
+public:
+  vsx_metrics_source func;
+  void* arg;
+};
+
+class VSX_METRICS_DLLIMPORT vsx_metrics
+{
+  pthread_mutex_t mutex;
+  std::vector<vsx_metrics_source_entry> sources;
+  vsx_timer timer;
+  double start_time;
+  vsx_string file_name;
+  double interval;
+  double last_write;
+  // a file write is on the thread pool
+  bool writing;
+  int next_id;
+
+  static void write_file(void* ptr);
+
+public:
+  vsx_metrics();
+
+  static vsx_metrics* get_instance();
+
+  void add_source(vsx_metrics_source func, void* arg);
+  // every source registered with arg
+  void remove_source(void* arg);
+
+  // numbers for engine="..." labels and the like
+  int get_id();
+
+  double get_uptime();
+
+  void collect(vsx_metrics_writer& out);
+
+  // "json" or anything else for the prometheus text
+  vsx_string get(const vsx_string& format);
+
+  // writes the metrics file when it's time, cheap otherwise - call it every
+  // frame
+  void tick();
+};
+
+#endif
@@ -322,6 +322,17 @@ public:
     VSX_UNUSED(name);
   }
 
+  // the sequencer is going to set the resource parameter name to value a
+  // little later in the timeline. Modules that load files can start reading /
+  // decoding it now so the switch doesn't stall a frame. Don't change the
+  // param, run() sees the new value as usual when it's time.
+  // Runs on the render thread, can come more than once for the same value.
+  virtual void prefetch(const vsx_string& name, const vsx_string& value)
+  {
+    VSX_UNUSED(name);
+    VSX_UNUSED(value);
+  }
+
   // is the module loaded and ready to render in high performance?
   // this will be used to determine if loading is completed for a demo for instance, or an effect.
   // The engine will not star the time until loading of all modules are done.
@@ -62,6 +62,9 @@
 #endif
 #include "vsx_math_3d.h"
 #include "vsx_mesh.h"
+#ifndef VSX_NO_MESH
+  #include "vsx_mesh_kernels.h"
+#endif
 #include "vsx_grid_mesh.h"
 #include "vsx_bitmap.h"
 #include "vsx_particlesystem.h"
@@ -216,6 +219,15 @@ public:
     else
     return 0;
   }
+
+  // same as get_addr() but a mesh may still have a pending transform, for
+  // modules that deal with that themselves
+  T* get_addr_lazy() {
+    if (valid)
+    return param_data;
+    else
+    return 0;
+  }
   
   T& get(int index = 0) {
     return param_data[index];
@@ -316,6 +328,22 @@ typedef vsx_module_param<0, vsx_string,          1,0 > vsx_module_param_string;
 typedef vsx_module_param<0, float,               4,1 > vsx_module_param_float4; // use get() set()
 typedef vsx_module_param<0, vsx_matrix,          1,0 > vsx_module_param_matrix; // use get() set()
 typedef vsx_module_param<0, vsx_mesh*,           1,0 > vsx_module_param_mesh; // use get() / set()
+#ifndef VSX_NO_MESH
+// modules reading a mesh get the vertices with the stacked up transforms
+// applied (see vsx_mesh_data::pending_transform)
+template<> inline vsx_mesh** vsx_module_param<0, vsx_mesh*, 1, 0>::get_addr() {
+  if (!valid)
+    return 0;
+  if (param_data[0] && param_data[0]->data->transform_pending)
+    vsx_mesh_kernels::apply_pending_transform(param_data[0]->data);
+  return param_data;
+}
+template<> inline vsx_mesh*& vsx_module_param<0, vsx_mesh*, 1, 0>::get(int index) {
+  if (param_data[index] && param_data[index]->data->transform_pending)
+    vsx_mesh_kernels::apply_pending_transform(param_data[index]->data);
+  return param_data[index];
+}
+#endif
 typedef vsx_module_param<0, vsx_bitmap,          1,0 > vsx_module_param_bitmap; // use get_addr() / set_p()
 typedef vsx_module_param<0, vsx_particlesystem,  1,0 > vsx_module_param_particlesystem; // use get_addr() / set_p()
 typedef vsx_module_param<0, vsx_float_array,     1,0 > vsx_module_param_float_array; // use get_addr() set_p()
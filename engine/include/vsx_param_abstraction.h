@@ -91,6 +91,7 @@ public:
   bool critical; // copied from the module param to save ->'s
   bool all_required;
   bool sequence; // is a sequence active for this parameter?
+  int interpolation_slot; // in the engine's interpolation list, -1 if none
 
   vsx_string name; // name of our anchor
 	vsx_string spec; // specification string, filled out by the module in the form :float
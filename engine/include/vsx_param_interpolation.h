@@ -25,92 +25,56 @@
 #ifndef VSX_PARAM_INTERPOLATION_H
 #define VSX_PARAM_INTERPOLATION_H
 
+#include <vector>
+#include <list>
 #include "vsx_param_abstraction.h"
-class vsx_module_param_interpolation_abs {
-public:
-  vsx_engine_param* t_engine_param;
-  vsx_module_param_abs* target_param;
-  vsx_module* module;
-  
-  // set new destination value
-  virtual bool set(vsx_module_param_abs* value,int arity, float interpolation_time) = 0;
-  virtual bool set(vsx_string value,int arity, float interpolation_time) = 0;
-  // to be run each frame
-  virtual bool interpolate(float dtime) = 0;
-};  
-
-
-class vsx_module_param_interpolation_float : public vsx_module_param_interpolation_abs {
-  int iterations;
-  double temp;
-  float destination_value;
-  float dest_interp;
-public:
-  bool set(vsx_module_param_abs* value,int arity, float interpolation_time);
-  bool set(vsx_string value,int arity, float interpolation_time);
-  bool interpolate(float dtime);
-  vsx_module_param_interpolation_float(vsx_module_param_abs* param) {
-    target_param = param;
-  }
-};
-
-class vsx_module_param_interpolation_float3 : public vsx_module_param_interpolation_abs {
-  float temp;
-  float destination_value[3];
-  float dest_interp;
-public:
-  bool set(vsx_module_param_abs* value,int arity, float interpolation_time);
-  bool set(vsx_string value,int arity, float interpolation_time);
-  bool interpolate(float dtime);
-  vsx_module_param_interpolation_float3(vsx_module_param_abs* param) {
-    target_param = param;
-  }
-};
-
-class vsx_module_param_interpolation_float4 : public vsx_module_param_interpolation_abs {
-  float temp;
-  float destination_value[4];
-  float dest_interp;
-public:
-  bool set(vsx_module_param_abs* value,int arity, float interpolation_time);
-  bool set(vsx_string value,int arity, float interpolation_time);
-  bool interpolate(float dtime);
-  vsx_module_param_interpolation_float4(vsx_module_param_abs* param) {
-    target_param = param;
-  }
-};
-
-
-class vsx_module_param_interpolation_quaternion : public vsx_module_param_interpolation_abs {
-  float temp;
-  float destination_value[4];
-  float dest_interp;
-public:
-  bool set(vsx_module_param_abs* value,int arity, float interpolation_time);
-  bool set(vsx_string value,int arity, float interpolation_time);
-  bool interpolate(float dtime);
-  vsx_module_param_interpolation_quaternion(vsx_module_param_abs* param) {
-    target_param = param;
-  }
-};
-
 
+// Smooth changes of float, float3, float4 and quaternion parameters towards
+// values set with param_set_interpolate (sliders, knobs, MIDI / OSC
+// controllers).
+//
+// Every component is a critically damped spring pulled towards its
+// destination. It is stepped with the exact solution of the spring, so a
+// parameter arrives the same way at 30 and at 144 fps, and it keeps its
+// velocity when the destination moves, so a stream of new values from a
+// controller doesn't make it jerk. The speed given with the value is the one
+// the old exponential lerp used (16 by default), the spring uses twice that,
+// which settles at about the same time.
+//
+// The state is kept as structure of arrays, 4 lanes for every parameter
+// being interpolated (unused lanes sit still at 0), and all of it is stepped
+// in one pass. Parameters are kept packed and the engine param knows its
+// slot, so adding and removing one doesn't search anything.
 
 class vsx_module_param_interpolation_list {
-  std::list<vsx_module_param_interpolation_abs*> listeners;
-  std::map<vsx_engine_param*,vsx_module_param_interpolation_abs*> listeners_map;
+  // per parameter
+  std::vector<vsx_engine_param*> params;
+  // per lane, slot i uses lanes i * 4 .. i * 4 + 3
+  std::vector<float> value;
+  std::vector<float> velocity;
+  std::vector<float> destination;
+  std::vector<float> omega;
+  std::vector<float> decay;
+
   std::list<vsx_engine_param*> remove_list;
-public:
-  vsx_module_param_interpolation_abs* add(vsx_engine_param* parameter);
 
+  // components of the parameter type, 0 if it can't be interpolated
+  static int get_lanes(vsx_engine_param* parameter);
+  // copies the lanes of a slot into the parameter
+  void write(size_t slot);
+  // slot of the parameter, -1 if it can't be interpolated
+  int add(vsx_engine_param* parameter);
 
+public:
   bool remove(vsx_engine_param* parameter);
   bool schedule_remove(vsx_engine_param* parameter);
 
-  //void set_target_value(vsx_engine_param* target, vsx_engine_param* value, int arity = 0,float interpolation_time = 16);
   void set_target_value(vsx_engine_param* target, vsx_string value, int arity = 0,float interpolation_time = 16);
-  
+
+  // parameters being interpolated
+  size_t size();
+
   void run(float d_time);
-}; 
+};
 
 #endif
@@ -55,6 +55,8 @@ class vsx_param_sequence
   float cur_delay;
   int cur_interpolation;
   float total_time;
+  // end of what prefetch_ahead() already told the module about
+  float prefetch_end;
 public:
   void* engine;
   vsx_comp_abs* comp;
@@ -76,6 +78,16 @@ public:
   void remove_line(vsx_command_list* dest, vsx_command_s* cmd_in, vsx_string cmd_prefix = "");
   void rescale_time(float start, float scale);
   float calculate_total_time(bool no_cache = false);
+
+  // time into the sequence execute() has got to
+  float get_position();
+  // resource params only: tells the module (vsx_module::prefetch) about the
+  // rows starting after from, up to and including to; from < 0 includes the
+  // first row
+  void prefetch(float from, float to);
+  // the rows coming up within horizon seconds of the current position, each
+  // one announced once unless the time jumps
+  void prefetch_ahead(float horizon);
   vsx_string dump();
   void inject(vsx_string ij);
   vsx_param_sequence();
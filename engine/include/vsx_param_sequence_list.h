@@ -83,6 +83,13 @@ public:
   void run(float dtime, float blend = 1.0f);
   void run_absolute(float vtime, float blend = 1.0f);
 
+  // lookahead: lets the modules start loading the files their resource
+  // params get within horizon seconds (see vsx_module::prefetch)
+  void prefetch(float horizon);
+  // the same for a list that isn't running yet: the rows in (from, to] of
+  // its own time, from < 0 includes the first ones
+  void prefetch_range(float from, float to);
+
   // initialization / de-initialization
   void set_engine(void* s_engine) { engine = s_engine; }
   void clear_master_sequences();
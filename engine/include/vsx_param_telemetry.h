@@ -0,0 +1,90 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+
+#ifndef VSX_PARAM_TELEMETRY_H
+#define VSX_PARAM_TELEMETRY_H
+
+#include <map>
+#include "vsx_string.h"
+#include "vsx_command.h"
+#include "vsx_timer.h"
+
+// Parameter values a client is looking at, sampled at a fixed rate and sent
+// as one command with only the values that changed:
+//
+//   param_values [id]:[base64 value],[id]:[base64 value],...
+//
+// instead of the client asking for every value with its own param_get each
+// time it redraws. A client registers a value with
+//
+//   param_watch [component] [param] [-1=in / 1=out] [id]
+//
+// and has to repeat that every now and then, a watch nobody renewed for
+// VSX_PARAM_TELEMETRY_TIMEOUT seconds (the anchor went off screen, the
+// client went away) is dropped. Values are cut at 100 characters like
+// param_get does.
+
+#define VSX_PARAM_TELEMETRY_RATE 10.0f
+#define VSX_PARAM_TELEMETRY_TIMEOUT 2.0
+#define VSX_PARAM_TELEMETRY_VALUE_LENGTH 100
+
+class vsx_engine_abs;
+
+class vsx_param_telemetry_watch
+{
+public:
+  vsx_string component;
+  vsx_string param;
+  int io;
+  // what the client was sent last
+  vsx_string value;
+  bool sent;
+  double expires;
+};
+
+class vsx_param_telemetry
+{
+  std::map<int, vsx_param_telemetry_watch> watches;
+  vsx_timer timer;
+  double interval;
+  double last_sample;
+
+public:
+  vsx_param_telemetry();
+
+  // adds or renews a watch
+  void watch(int id, vsx_string component, vsx_string param, int io);
+  void unwatch(int id);
+  void clear();
+
+  // samples per second
+  void set_rate(float rate);
+
+  size_t size();
+
+  // when it's time, adds a param_values with what changed to cmd_out
+  void sample(vsx_engine_abs* engine, vsx_command_list* cmd_out);
+};
+
+#endif
@@ -71,6 +71,9 @@ public:
     bool run_from_channel = false
   ); // if enabled, it'll run all sequences and set values
 
+  // lookahead for the selected sequence list, see vsx_param_sequence_list
+  void prefetch(float horizon);
+
   // time manipulation
   int get_state();
   float get_time();
@@ -0,0 +1,126 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef VSX_SOFT_BODY_H
+#define VSX_SOFT_BODY_H
+
+#include <vsx_platform.h>
+#include <stdlib.h>
+#include <vector>
+#include "vsx_math_3d.h"
+#include "vsx_mesh.h"
+
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+#define VSX_SOFT_BODY_DLLIMPORT
+#else
+  #if defined(VSX_ENG_DLL)
+    #define VSX_SOFT_BODY_DLLIMPORT __declspec (dllexport)
+  #else
+    #define VSX_SOFT_BODY_DLLIMPORT __declspec (dllimport)
+  #endif
+#endif
+
+// Mass-spring cloth / soft body on a triangle mesh, the model the inflate
+// and ribbon cloth modules always used: every face keeps the rest length
+// of its three edges and pulls them back towards it, an optional gas
+// pressure pushes every face along its normal, explicit Euler with a
+// damped speed per vertex.
+//
+// The faces are colored once in build() so that no two faces of a color
+// share a vertex. A step runs the colors one after the other, the faces of
+// one color in parallel on the engine thread pool - every task owns the
+// vertices it writes, no atomics or locks. The few faces that don't fit
+// the colors (vertices with more than 64 faces) run last, on one thread.
+// The volume for the pressure is a parallel reduction over the faces. With
+// SSE the face pass does 4 faces at once and the vertex update runs over
+// the flat position and speed arrays.
+//
+// Positions are passed in to every step, they're not kept; the caller owns
+// the mesh and can move the pinned vertices in between.
+
+class vsx_soft_body_constraint
+{
+public:
+  unsigned int a, b, c;
+  // rest lengths of a -> b, b -> c, c -> a
+  float rest_ab, rest_bc, rest_ca;
+};
+
+class VSX_SOFT_BODY_DLLIMPORT vsx_soft_body
+{
+  // in color order, color k is constraints[color_start[k] .. color_start[k + 1]],
+  // the ones from serial_start on didn't get a color
+  std::vector<vsx_soft_body_constraint> constraints;
+  std::vector<size_t> color_start;
+  size_t serial_start;
+  // faces per vertex and the sum of their wind weights, what the per face
+  // accelerations add up to for each vertex
+  std::vector<float> vertex_faces;
+  std::vector<float> vertex_wind;
+  std::vector<vsx_vector> speed;
+  std::vector<double> volume_partial;
+
+public:
+  // settings, can change between steps
+  float step_size;
+  float stiffness;
+  float damping; // speeds are multiplied by this after every step
+  // pressure = (gas_amount - volume) / volume * gas_expansion, 0 turns it off
+  float gas_amount;
+  float gas_expansion;
+  // added to the speed of every corner of every face, every step
+  vsx_vector face_acceleration;
+  // same, times the weight of the face from build()
+  vsx_vector wind;
+  // vertices are kept above this (y)
+  float floor_y;
+  // the first pinned vertices are left alone, the caller moves them
+  size_t pinned;
+
+  // results of the last step
+  float volume;
+  float pressure;
+
+  vsx_soft_body();
+
+  // constraints for faces over positions. Rest lengths are the current
+  // edge lengths unless rest_lengths has one vsx_vector (ab, bc, ca) per
+  // face, face_wind (optional) is one weight per face. Speeds start at 0.
+  void build(const vsx_face* faces, size_t face_count, const vsx_vector* positions, size_t vertex_count, const vsx_vector* rest_lengths = 0, const float* face_wind = 0);
+
+  // every vertex gets this speed
+  void set_speed(const vsx_vector& v);
+
+  // signed volume of the closed surface, positive when the faces wind
+  // clockwise like the inflate module expects
+  float calculate_volume(const vsx_vector* positions);
+
+  // one explicit step of step_size. positions must have the vertex count
+  // build() was given.
+  void step(vsx_vector* positions);
+
+  size_t get_num_colors();
+  size_t get_num_vertices();
+};
+
+#endif
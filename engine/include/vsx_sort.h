@@ -0,0 +1,91 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef VSX_SORT_H
+#define VSX_SORT_H
+
+#include <vsx_platform.h>
+#include <stdlib.h>
+#include <vector>
+
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+#define VSX_SORT_DLLIMPORT
+#else
+  #if defined(VSX_ENG_DLL)
+    #define VSX_SORT_DLLIMPORT __declspec (dllexport)
+  #else
+    #define VSX_SORT_DLLIMPORT __declspec (dllimport)
+  #endif
+#endif
+
+// what sort() ended up doing, see get_last_method()
+#define VSX_SORT_UNCHANGED 0
+#define VSX_SORT_INSERTION 1
+#define VSX_SORT_MERGE 2
+#define VSX_SORT_RADIX 3
+
+// Per frame depth sorting: orders the items 0 .. count - 1 by a float key
+// and hands back the indices, the items themselves never move - build your
+// index buffer from them.
+//
+// Keep one instance per module. The order of the last call is kept, and
+// when the count is the same it's checked against the new keys first:
+//   already sorted     nothing to do
+//   a few long runs    merged (natural merge sort)
+//   small moves        insertion sort, given up after 8 moves per item
+// and only when none of that works out the keys are radix sorted - LSD,
+// 3 passes of 11 bits, passes where all keys share the digit are skipped.
+// Big inputs run their histogram and scatter passes on the thread pool,
+// one slice of the input per task, so the result is stable either way.
+
+class VSX_SORT_DLLIMPORT vsx_sort_float
+{
+  std::vector<unsigned int> order;
+  std::vector<unsigned int> order_tmp;
+  // sortable integer version of the keys, by item
+  std::vector<unsigned int> keys;
+  // radix ping pong buffers, keys travelling along with the items
+  std::vector<unsigned int> radix_keys;
+  std::vector<unsigned int> radix_keys_tmp;
+  std::vector<size_t> histograms;
+  std::vector<size_t> run_starts;
+  int last_method;
+
+  void sort_runs();
+  bool sort_insertion(size_t max_moves);
+  void sort_radix();
+
+public:
+  vsx_sort_float();
+
+  // indices of the items, smallest key first (largest first with
+  // descending). Valid until the next call.
+  const unsigned int* sort(const float* item_keys, size_t count, bool descending = false);
+
+  // forget the last order, next sort() starts from scratch
+  void reset();
+
+  int get_last_method() { return last_method; }
+};
+
+#endif
@@ -0,0 +1,106 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef VSX_TEXTURE_CONTAINER_H
+#define VSX_TEXTURE_CONTAINER_H
+
+#include <vsx_platform.h>
+#include <stdint.h>
+#include <vector>
+
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+#define VSX_TEXTURE_CONTAINER_DLLIMPORT
+#else
+  #if defined(VSX_ENG_DLL)
+    #define VSX_TEXTURE_CONTAINER_DLLIMPORT __declspec (dllexport)
+  #else
+    #define VSX_TEXTURE_CONTAINER_DLLIMPORT __declspec (dllimport)
+  #endif
+#endif
+
+// GPU ready texture container (.vxt), written by tools/vsxtex.
+//
+// Holds the whole mipmap chain already flipped to OpenGL row order, so
+// loading one is a file read plus one glTexImage2D per level - no png/jpeg
+// decoding, no row flipping and no gluBuild2DMipmaps.
+//
+// File layout, little endian:
+//   char[4]  "VXT1"
+//   uint32   format (VSX_TEXTURE_CONTAINER_RGBA8 or _RGBA16F)
+//   uint32   flags
+//   uint32   width, height, number of levels
+//   per level: uint32 width, height, size in bytes, followed by the pixels
+//              (RGBA16F: little endian halves)
+
+#define VSX_TEXTURE_CONTAINER_RGBA8 0
+#define VSX_TEXTURE_CONTAINER_RGBA16F 1
+
+// rows are stored bottom up (what glTexImage2D wants)
+#define VSX_TEXTURE_CONTAINER_FLAG_FLIPPED 1
+
+class vsx_texture_container_level
+{
+public:
+  unsigned long size_x;
+  unsigned long size_y;
+  unsigned long data_size;
+  void* data;
+};
+
+class VSX_TEXTURE_CONTAINER_DLLIMPORT vsx_texture_container
+{
+  // owns the level data, don't copy
+  vsx_texture_container(const vsx_texture_container&);
+  vsx_texture_container& operator=(const vsx_texture_container&);
+
+public:
+  int format;
+  uint32_t flags;
+  unsigned long size_x;
+  unsigned long size_y;
+  std::vector<vsx_texture_container_level> levels;
+
+  vsx_texture_container();
+  ~vsx_texture_container();
+
+  void clear();
+
+  // build from a top down RGBA8 image (the way the png/jpeg decoders
+  // deliver it). Flips it and, if mipmaps is set, box filters levels
+  // down to 1x1.
+  bool build(const unsigned char* rgba, unsigned long size_x, unsigned long size_y, int format = VSX_TEXTURE_CONTAINER_RGBA8, bool mipmaps = true);
+
+  // the file image, malloc'ed, free() it when done
+  unsigned char* serialize(unsigned long& size);
+
+  // parse a file image (see vsxf::f_data_get), the levels are copied.
+  // Other versions and unknown formats are rejected, error says why.
+  bool load_memory(const unsigned char* data, unsigned long size);
+  const char* error;
+
+  // half float helpers for RGBA16F
+  static uint16_t float_to_half(float f);
+  static float half_to_float(uint16_t h);
+};
+
+#endif
@@ -0,0 +1,105 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef VSX_THREAD_POOL_H
+#define VSX_THREAD_POOL_H
+
+#include <vsx_platform.h>
+#include <stdlib.h>
+#include <list>
+#include <vector>
+#include <pthread.h>
+
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+#define VSX_THREAD_POOL_DLLIMPORT
+#else
+  #if defined(VSX_ENG_DLL)
+    #define VSX_THREAD_POOL_DLLIMPORT __declspec (dllexport)
+  #else
+    #define VSX_THREAD_POOL_DLLIMPORT __declspec (dllimport)
+  #endif
+#endif
+
+// Process-wide pool of worker threads.
+//
+// Modules used to spawn one pthread per job, which is fine for a single
+// generator but falls apart when a state has dozens of them. All CPU heavy
+// work (bitmap filters, mesh kernels, decoders) should go through here.
+//
+// Two ways of using it:
+//  * add_task() - fire and forget, the function runs on some worker thread.
+//    Keep your own "done" flag and poll it from run(), just like before.
+//  * parallel_for() - splits [0, count) into chunks and blocks until all
+//    chunks are processed. The calling thread works on chunks too, so it is
+//    safe to call from inside a task (nested parallel_for can't deadlock).
+
+typedef void (*vsx_thread_pool_task)(void* arg);
+typedef void (*vsx_thread_pool_range_task)(void* arg, size_t start, size_t end);
+
+class vsx_thread_pool_job;
+
+class VSX_THREAD_POOL_DLLIMPORT vsx_thread_pool
+{
+  struct task_entry
+  {
+    vsx_thread_pool_task func;
+    void* arg;
+    vsx_thread_pool_job* job;
+  };
+
+  pthread_mutex_t mutex;
+  pthread_cond_t task_cond;
+  pthread_cond_t job_cond;
+  std::list<task_entry> tasks;
+  std::vector<pthread_t> threads;
+  bool stopping;
+
+  static void* worker(void* ptr);
+  static void job_worker(void* ptr);
+  void run_job(vsx_thread_pool_job* job);
+
+public:
+  vsx_thread_pool(size_t num_threads = 0);
+  ~vsx_thread_pool();
+
+  // the shared engine pool, created on first use
+  static vsx_thread_pool* get_instance();
+
+  // number of worker threads (not counting the caller of parallel_for)
+  size_t get_num_threads();
+
+  // cpu cores, or VSXU_THREADS if set - the pool never has fewer than one
+  // worker, so this is how to tell a single core machine
+  static size_t get_num_cores();
+
+  // number of tasks waiting for a worker
+  size_t get_queue_size();
+
+  void add_task(vsx_thread_pool_task func, void* arg);
+
+  // min_chunk is the smallest number of items worth handing to a thread,
+  // small inputs are run directly on the calling thread.
+  void parallel_for(size_t count, size_t min_chunk, vsx_thread_pool_range_task func, void* arg);
+};
+
+#endif
@@ -62,8 +62,10 @@ public:
   void* file_data; // in the case of type == 1 this is the actual decompressed file in RAM
                    // don't mess with this! the file class will handle it.. 
   FILE* file_handle;
-  vsxf_handle() : position(0), size(0),mode(0), file_data(0), file_handle(0) {}
+  bool file_data_mapped; // file_data is a file mapping, f_close unmaps it
+  vsxf_handle() : position(0), size(0),mode(0), file_data(0), file_handle(0), file_data_mapped(false) {}
   ~vsxf_handle() {
+    if (file_data_mapped) return;
     #ifdef VSXU_DEBUG
       printf("vsxf_handle destructor, %s\n", filename.c_str() );
     #endif
@@ -125,6 +127,7 @@ public:
   int archive_add_file(vsx_string filename, char* data = 0, uint32_t data_size = 0, vsx_string disk_filename = "");
   bool is_archive();
   bool is_archive_populated();
+  vsx_string get_archive_name();
 
   vsxf_handle*  f_open(const char* filename, const char* mode);
   void          f_close(vsxf_handle* handle);  
@@ -133,6 +136,15 @@ public:
   char*         f_gets_entire(vsxf_handle* handle);
   int           f_read(void* buf, unsigned long num_bytes, vsxf_handle* handle);
   unsigned long f_get_size(vsxf_handle* handle);
+  // the whole file in one buffer, owned by the handle (freed by f_close).
+  // archive files are already decompressed in RAM, plain files are read in
+  // one go - use this instead of lots of small f_read calls.
+  void*         f_data_get(vsxf_handle* handle);
+  // same, but plain files are memory mapped (copy on write, pages come in
+  // as they're touched) instead of read up front. Only valid until f_close
+  // and don't take it over like f_data_get's buffer - see
+  // handle->file_data_mapped.
+  const void*   f_data_map(vsxf_handle* handle);
 };
 
 VSXFSTDLLIMPORT bool verify_filesuffix(vsx_string& input, const char* type);
@@ -43,11 +43,15 @@
 #include "vsx_timer.h"
 #include "vsx_engine.h"
 #include "vsx_comp_vsxl.h"
+#include "binds/gmMathLib.h"
+#include "vsxl_engine.h"
 
 class p_info {
 public:
   vsx_module_param_abs* param;
   gmVariable variable;
+  // the global holding the value, resolved when the script is loaded
+  gmVariable key;
   vsx_string name;
   unsigned long id;
 };
@@ -55,6 +59,9 @@ public:
 class vsx_comp_vsxl_driver : public vsx_comp_vsxl_driver_abs {
   gmVariable vsx_vtime;
   gmVariable vsx_dtime;
+  gmVariable key_time;
+  gmVariable key_dtime;
+  gmFunctionObject* function;
 public:
   std::vector<p_info*> p_list;
   gmMachine* machine;
@@ -67,6 +74,7 @@ public:
 vsx_comp_vsxl_driver::vsx_comp_vsxl_driver() {
 #ifndef VSXE_NO_GM
   machine = 0;
+  function = 0;
 #endif
 }
 
@@ -75,6 +83,8 @@ void vsx_comp_vsxl_driver::unload() {
   if (machine) {
     machine->ResetAndFreeMemory();
     delete machine;
+    machine = 0;
+    function = 0;
   }
 #endif
 }
@@ -133,79 +143,46 @@ global vsxl_cf = function()\n\
 #endif
   // Compile and execute the script
   machine->ExecuteString(script.c_str(), 0, true);
-  
+
+  // resolve the globals and the function once, not every frame
+  for (std::vector<p_info*>::iterator it = p_list.begin(); it != p_list.end(); ++it) {
+    (*it)->key = vsxl_global_key(machine, (*it)->name.c_str());
+  }
+  key_time = vsxl_global_key(machine, "_time");
+  key_dtime = vsxl_global_key(machine, "_dtime");
+  // the machine is new, nothing to release
+  function = vsxl_get_function(machine, "vsxl_cf", 0);
+  return this;
+
 #endif // no gm
 }
 
 void vsx_comp_vsxl_driver::run() {
 #ifndef VSXE_NO_GM
   // Call a script function
-  //printf("r");
-  //std::cout << "realvalue" << ((vsx_engine*)engine)->vtime << std::endl;
-
   gmTableObject* gtable = machine->GetGlobals();
-  //mytable.Set(machine, "fromstle", mt_var);
   for (std::vector<p_info*>::iterator it = p_list.begin(); it != p_list.end(); ++it) {
     (*it)->variable.SetFloat(((vsx_module_param_float*)(*it)->param)->get());
-    gtable->Set(machine, (*it)->name.c_str(), (*it)->variable);
+    gtable->Set(machine, (*it)->key, (*it)->variable);
   }
 
-  //gmVariable mt_var;
-  //mt_var.SetFloat(0.2);
   vsx_vtime.SetFloat(((vsx_comp_abs*)comp)->r_engine_info->vtime);
   vsx_dtime.SetFloat(((vsx_comp_abs*)comp)->r_engine_info->dtime);
-  machine->GetGlobals()->Set(machine, "_time", vsx_vtime);
-  machine->GetGlobals()->Set(machine, "_dtime", vsx_dtime);
-  //machine->GetGlobals()->Set(machine, "size_x", mt_var);
-  gmCall call;
+  gtable->Set(machine, key_time, vsx_vtime);
+  gtable->Set(machine, key_dtime, vsx_dtime);
 
-	machine->Execute(0);
-	if(call.BeginGlobalFunction(machine, "vsxl_cf"))
+  machine->Execute(0);
+  gmCall call;
+  if (function && call.BeginFunction(machine, function))
   {
-    //call.AddParamFloat(realvalue);
-    //call.AddParamInt(valueB);
     call.End();
-    //call.GetReturnedFloat(resultfloat);
   }
 
-  //gmCallScript::SetMachine(machine);
-  //if (gmCallScript::BeginGlobal("vsxl_cf"))
-  //{
-    //gmCallScript::Thread()->PushTable(&mytable);
-    //gmCallScript::SetReturnTable(&newtable);
-    //gmCallScript::SetReturnFloat(resultfloat);
-    //gmCallScript::AddParamFloat(realvalue);
-
-    //GameObject * object = new GameObject();
-    //object->m_table = (void*)this;
-    //gmCallScript::AddParamUser(object, GameObject::s_typeId);
-    //object->m_userObject = gmCallScript::s_thread->PushNewUser(object, GameObject::s_typeId);
-    //object->m_userObject = gmCallScript::s_thread->PushNewUser(object, GameObject::s_typeId);
-    //gmCallScript::AddParamUser(object->m_userObject);
-    //gmCallScript::AddParamUser((void*)this,GM_PVSXL);
-    //gmCallScript::End();
-  //}
-  //((vsx_module_param_float*)my_param)->set_raw(resultfloat);
-
-  gmVariable stringName;
-  gmVariable retVar;
-
-  //stringName.SetString(machine->AllocStringObject("size_x"));
-  //retVar = machine->GetGlobals()->Get(stringName);
-
   for (std::vector<p_info*>::iterator it = p_list.begin(); it != p_list.end(); ++it) {
-    stringName.SetString(machine->AllocStringObject((*it)->name.c_str()));
-    //printf("var:: %f\n", gtable->Get(stringName).m_value.m_float);
-    ((vsx_module_param_float*)(*it)->param)->set_raw(gtable->Get(stringName).m_value.m_float);
-    //(*it)->variable.SetFloat(((vsx_module_param_float*)(*it)->param)->get());
-    //gtable->Set(machine, (*it)->name, (*it)->variable);
+    ((vsx_module_param_float*)(*it)->param)->set_raw(gtable->Get((*it)->key).m_value.m_float);
   }
 
-
-  //std::cout << "froo " << retVar.m_value.m_float << endl;
-//  std::cout << "froo " << machine->GetGlobals()->Get(vsx_dtime).m_value.m_float << endl;
-  //std::cout << "resultfloat: " << resultfloat << std::endl;
-  machine->CollectGarbage(false);
+  vsxl_collect_garbage(machine, VSXL_GC_BUDGET);
 #endif // no gm
 }
 
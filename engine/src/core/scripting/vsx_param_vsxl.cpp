@@ -55,16 +55,20 @@
 
 class vsx_param_vsxl_driver_float : public vsx_param_vsxl_driver_abs {
   float realvalue, resultfloat;
+  // vsxl_pf<id>, looked up when the script is loaded
+  gmFunctionObject* function;
 //	gmMachine* machine;
 //	gmVariable vsx_vtime;
 //	gmVariable vsx_dtime;
 public:
   void *load(vsx_module_param_abs* engine_param, vsx_string program);
   void run();
+  void run(gmCall& call);
   void unload();
 	vsx_param_vsxl_driver_float() {
 	  //machine = 0;
 	  id = -1;
+	  function = 0;
 	}
 };
 
@@ -114,6 +118,8 @@ static void GM_CDECL AsString(gmUserObject * a_object, char* a_buffer, int a_buf
 
 void vsx_param_vsxl_driver_float::unload() {
 #ifndef VSXE_NO_GM
+  vsxl_release_function(&engine->vsxl->machine, function);
+  function = 0;
 //  printf("unload\n");
   /*if (machine) {
 
@@ -148,7 +154,6 @@ void* vsx_param_vsxl_driver_float::load(vsx_module_param_abs* engine_param,vsx_s
   	id = engine->vsxl->pf_id;
   	engine->vsxl->pf_id++;
   }
-  printf("float::load8\n");
 #ifndef VSX_NO_CLIENT
   if (program == "") { //engine_param->name
   script = "// this script modifies the float param called \""+engine_param->name+"\"\n\
@@ -174,15 +179,15 @@ global vsxl_pf"+i2s(id)+" = function(param)\n\
 };\n\
 ";
   } else {
-  	printf("load_8b\n");
     script = program;
   }
 #endif
   // Compile and execute the script
   //MessageBox(0, "pre-execute", "status", MB_OK);
-  printf("load_9\n");
   engine->vsxl->machine.ExecuteString(script.c_str(), NULL, false, NULL);
-  printf("load_a\n");
+  // run it so the function is defined and get hold of it
+  engine->vsxl->machine.Execute(0);
+  function = vsxl_get_function(&engine->vsxl->machine, ("vsxl_pf"+i2s(id)).c_str(), function);
   //MessageBox(0, "post-execute", "status", MB_OK);
   return this;
 #endif
@@ -190,59 +195,25 @@ global vsxl_pf"+i2s(id)+" = function(param)\n\
 
 void vsx_param_vsxl_driver_float::run() {
 #ifndef VSXE_NO_GM
-  // Call a script function
-  realvalue = ((vsx_module_param_float*)my_param)->get_internal();
-  //std::cout << "realvalue" << ((vsx_engine*)engine)->vtime << std::endl;
-
-  //gmTableObject mytable;
-  //gmVariable mt_var;
-  //mt_var.SetFloat(0.2);
-  //mytable.Set(machine, "fromstle", mt_var);
-
-  //vsx_vtime.SetFloat(0.12);
-  engine->vsxl->vsx_vtime.SetFloat(((vsx_comp_abs*)comp)->r_engine_info->vtime);
-  engine->vsxl->vsx_dtime.SetFloat(((vsx_comp_abs*)comp)->r_engine_info->dtime);
-  engine->vsxl->machine.GetGlobals()->Set(&(engine->vsxl->machine), "_time", engine->vsxl->vsx_vtime);
-  engine->vsxl->machine.GetGlobals()->Set(&(engine->vsxl->machine), "_dtime", engine->vsxl->vsx_dtime);
-
   gmCall call;
+  run(call);
+#endif
+}
 
-	engine->vsxl->machine.Execute(0);
-	if(call.BeginGlobalFunction(&(engine->vsxl->machine), ("vsxl_pf"+i2s(id)).c_str()))
+// _time / _dtime are set and the garbage collected once per frame by
+// vsxl_engine, not here
+void vsx_param_vsxl_driver_float::run(gmCall& call) {
+#ifndef VSXE_NO_GM
+  // Call a script function
+  realvalue = ((vsx_module_param_float*)my_param)->get_internal();
+  resultfloat = realvalue;
+  if (function && call.BeginFunction(&(engine->vsxl->machine), function))
   {
     call.AddParamFloat(realvalue);
-    //call.AddParamInt(valueB);
     call.End();
     call.GetReturnedFloat(resultfloat);
   }
-
-  /*gmCallScript::SetMachine(machine);
-  if (gmCallScript::BeginGlobal(("vsxl_pf"+i2s(id)).c_str()))
-  {
-    gmCallScript::SetReturnFloat(resultfloat);
-    gmCallScript::AddParamFloat(realvalue);
-
-    //GameObject * object = new GameObject();
-    //object->m_table = (void*)this;
-    //gmCallScript::AddParamUser(object, GameObject::s_typeId);
-    //object->m_userObject = gmCallScript::s_thread->PushNewUser(object, GameObject::s_typeId);
-    //object->m_userObject = gmCallScript::s_thread->PushNewUser(object, GameObject::s_typeId);
-    //gmCallScript::AddParamUser(object->m_userObject);
-    //gmCallScript::AddParamUser((void*)this,GM_PVSXL);
-    gmCallScript::End();
-  }*/
   ((vsx_module_param_float*)my_param)->set_raw(resultfloat);
-
-  //gmVariable stringName;
-  //gmVariable retVar;
-
-  //stringName.SetString(machine->AllocStringObject("_dtime"));
-  //retVar = machine->GetGlobals()->Get(stringName);
-
-  //std::cout << "froo " << retVar.m_value.m_float << endl;
-//  std::cout << "froo " << machine->GetGlobals()->Get(vsx_dtime).m_value.m_float << endl;
-  //std::cout << "resultfloat: " << resultfloat << std::endl;
-  engine->vsxl->machine.CollectGarbage();
 #endif
 }
 
@@ -296,3 +267,19 @@ void vsx_param_vsxl::execute() {
   my_driver->run();
 #endif
 }
+
+void vsx_param_vsxl::execute_batch(vsx_param_vsxl_abs** filters, size_t count) {
+#ifndef VSXE_NO_GM
+  // float filters share the engine's machine, one call object does them all
+  gmCall call;
+  for (size_t i = 0; i < count; i++)
+  {
+    vsx_param_vsxl_driver_abs* driver = ((vsx_param_vsxl*)filters[i])->my_driver;
+    if (!driver) continue;
+    if (driver->my_param->type == VSX_MODULE_PARAM_ID_FLOAT)
+      ((vsx_param_vsxl_driver_float*)driver)->run(call);
+    else
+      driver->run();
+  }
+#endif
+}
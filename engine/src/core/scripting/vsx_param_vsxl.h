@@ -69,6 +69,8 @@ public:
   void* load(vsx_module_param_abs* engine_param, vsx_string program, int id = -1);
   vsx_param_vsxl_driver_abs* get_driver();
   void execute();
+  // the filters of a component's parameters, after its channels have run
+  static void execute_batch(vsx_param_vsxl_abs** filters, size_t count);
   vsx_param_vsxl();
   void unload();
 };
@@ -24,25 +24,89 @@
 #ifndef VSXL_ENGINE_H_
 #define VSXL_ENGINE_H_
 
+#include "vsx_timer.h"
+
+// seconds of incremental garbage collection per machine and frame
+#define VSXL_GC_BUDGET 0.0005
+
+// one increment of incremental garbage collection, then more while the
+// collector is in a cycle and there's time left - instead of collecting
+// after every script call
+inline void vsxl_collect_garbage(gmMachine* machine, double budget)
+{
+  machine->CollectGarbage(false);
+  gmGarbageCollector* gc = machine->GetGC();
+  if (gc->IsOff()) return;
+  vsx_timer timer;
+  double start = timer.atime();
+  while (!gc->IsOff() && timer.atime() - start < budget)
+  {
+    if (gc->Collect()) break;
+  }
+}
+
+// a global function of the machine, looked up once (after the script
+// defining it has run) instead of by name on every call. It's kept from the
+// collector until released, even if the script reassigns the global.
+inline gmFunctionObject* vsxl_get_function(gmMachine* machine, const char* name, gmFunctionObject* previous)
+{
+  if (previous)
+    machine->RemoveCPPOwnedGMObject(previous);
+  gmVariable f = machine->GetGlobals()->Get(machine, name);
+  gmFunctionObject* function = f.GetFunctionObjectSafe();
+  if (function)
+    machine->AddCPPOwnedGMObject(function);
+  return function;
+}
+
+inline void vsxl_release_function(gmMachine* machine, gmFunctionObject* function)
+{
+  if (function)
+    machine->RemoveCPPOwnedGMObject(function);
+}
+
+// key for a global, the string is never collected so the key can be kept
+inline gmVariable vsxl_global_key(gmMachine* machine, const char* name)
+{
+  gmVariable key;
+  key.SetString(machine->AllocPermanantStringObject(name));
+  return key;
+}
+
+// the machine the parameter filters of an engine share
 class vsxl_engine {
 public:
 	gmMachine machine;
 	gmVariable vsx_vtime;
 	gmVariable vsx_dtime;
+	gmVariable key_time;
+	gmVariable key_dtime;
 	int pf_id; // counter to make unique parameter filter functions
 	int cf_id;
 	vsxl_engine() : pf_id(0), cf_id(0)
 	{}
 	void init() {
-    //machine = new gmMachine;
-  	printf("float::load2\n");
-    //GameObject::s_typeId = machine->CreateUserType("GameObject");
-  	printf("float::load2\n");
-    //machine->RegisterUserCallbacks(GameObject::s_typeId,GCTrace, GCDestruct,AsString);
-  	printf("float::load2\n");
   	gmBindMathLib(&machine);
-    printf("float::load3\n");		
+  	key_time = vsxl_global_key(&machine, "_time");
+  	key_dtime = vsxl_global_key(&machine, "_dtime");
 	}
+
+  // once per frame, before the components run: the time globals and the
+  // script threads that are waiting to run
+  void begin_frame(float vtime, float dtime)
+  {
+    vsx_vtime.SetFloat(vtime);
+    vsx_dtime.SetFloat(dtime);
+    machine.GetGlobals()->Set(&machine, key_time, vsx_vtime);
+    machine.GetGlobals()->Set(&machine, key_dtime, vsx_dtime);
+    machine.Execute(0);
+  }
+
+  // once per frame, after the components have run
+  void end_frame()
+  {
+    vsxl_collect_garbage(&machine, VSXL_GC_BUDGET);
+  }
 };
 
 #endif /*VSXL_ENGINE_H_*/
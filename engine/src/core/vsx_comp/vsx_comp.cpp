@@ -54,6 +54,7 @@ vsx_comp::vsx_comp() {
   module_info = new vsx_module_info;
   vsxl_modifier = 0;
   internal_critical = false;
+  generation = 0;
   size = 0.05f;
   frame_status = initial_status;
   in_parameters = new vsx_engine_param_list;
@@ -421,6 +422,10 @@ bool vsx_comp::prepare()
     }
   }
 
+  #ifndef VSXE_NO_GM
+    // left over if the last prepare() returned early
+    vsxl_param_filters.clear();
+  #endif
   for (std::vector <vsx_channel*>::iterator it = channels.begin(); it != channels.end(); ++it)
   {
     // check time to speed up loading bar
@@ -451,16 +456,23 @@ bool vsx_comp::prepare()
     #ifdef VSXU_MODULE_TIMING
       new_time_run += (*it)->channel_execution_time;
     #endif
-    // run vsxl after other component has set our value
+    // run vsxl after other component has set our value - collected and run
+    // together once all channels are done
     #ifndef VSXE_NO_GM
       if ((*it)->my_param->module_param->vsxl_modifier)
       {
-        void* a = (*it)->my_param->module_param->vsxl_modifier;
-        ((vsx_param_vsxl_abs*)a)  -> execute();
+        vsxl_param_filters.push_back( (vsx_param_vsxl_abs*)(*it)->my_param->module_param->vsxl_modifier );
       }
     #endif
     ++i;
   }
+  #ifndef VSXE_NO_GM
+    if (vsxl_param_filters.size())
+    {
+      vsx_param_vsxl::execute_batch(&vsxl_param_filters[0], vsxl_param_filters.size());
+      vsxl_param_filters.clear();
+    }
+  #endif
   if (module_info->output)
   {
     LOG("module->run");
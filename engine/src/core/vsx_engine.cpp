@@ -73,22 +73,29 @@ vsx_module_engine_info vsx_engine::engine_info;
 
 using namespace std;
 
+static void engine_metrics(vsx_metrics_writer& out, void* arg)
+{
+  ((vsx_engine*)arg)->get_metrics(out);
+}
 
 vsx_engine::vsx_engine()
 {
   constructor_set_default_values();
   loop_point_end = -1.0f;
+  vsx_metrics::get_instance()->add_source(engine_metrics, this);
 }
 
 vsx_engine::vsx_engine(vsx_string path)
 {
   constructor_set_default_values();
   loop_point_end = -1.0f;
-  log_dir = path;
+  vsx_log_set_dir(path);
+  vsx_metrics::get_instance()->add_source(engine_metrics, this);
 }
 
 vsx_engine::~vsx_engine()
 {
+  vsx_metrics::get_instance()->remove_source(this);
   stop();
   commands_internal.clear(true);
   commands_res_internal.clear(true);
@@ -259,6 +266,26 @@ void vsx_engine::input_event(vsx_engine_input_event &new_input_event)
 int vsx_engine::load_state(vsx_string filename, vsx_string *error_string)
 {
   if (!valid) return 2;
+  std::vector<vsx_string> lines;
+  if (!read_state(filename, lines)) return 0;
+
+  LOG("load_state after")
+#ifdef VSXU_MAC_XCODE
+  syslog(LOG_ERR,"lines.size() = %d\n", (int)lines.size());
+#endif
+  vsx_command_list load1;
+  load1.filesystem = &filesystem;
+  for (size_t i = 0; i < lines.size(); i++)
+    load1.add_raw(lines[i]);
+  int res = i_load_state(load1,error_string,filename);
+  load1.clear(true);
+
+  return res;
+}
+
+bool vsx_engine::read_state(vsx_string filename, std::vector<vsx_string>& lines)
+{
+  if (!valid) return false;
   LOG("load_state 1")
   filesystem.set_base_path("");
   if (filesystem.is_archive())
@@ -269,8 +296,6 @@ int vsx_engine::load_state(vsx_string filename, vsx_string *error_string)
 
 
   LOG("load_state 2")
-  vsx_command_list load1;
-  load1.filesystem = &filesystem;
   vsx_string i_filename = filename;
   LOG("load_state 3")
 
@@ -286,24 +311,60 @@ int vsx_engine::load_state(vsx_string filename, vsx_string *error_string)
         LOG("engine loading archive: "+filename)
         i_filename = "_states/_default";//filesystem.archive_files[0].filename;
       } else
-      { filesystem.archive_close(); return 0; }
+      { filesystem.archive_close(); return false; }
     }
   }
   LOG("engine loading state: "+i_filename);
-  load1.load_from_file(i_filename,true);
-  LOG("load_state after")
-#ifdef VSXU_MAC_XCODE
-  syslog(LOG_ERR,"load1.count() = %d\n", load1.count());
-#endif
+
+  // the lines of the state, what vsx_command_list::load_from_file reads -
+  // commands can't be made here, they're registered in a global list
+  lines.clear();
+  vsxf_handle* fp = filesystem.f_open(i_filename.c_str(), "r");
+  if (fp)
+  {
+    char buf[65535];
+    vsx_string line;
+    while (filesystem.f_gets((char*)&buf,65535,fp))
+    {
+      line = buf;
+      if (line.size())
+      {
+        if (line[line.size()-1] == 0x0A) line.pop_back();
+        if (line[line.size()-1] == 0x0D) line.pop_back();
+      }
+      if (line != vsx_string(""))
+        lines.push_back(line);
+    }
+    filesystem.f_close(fp);
+  }
 
   if (!is_archive)
   filesystem.set_base_path(vsx_get_data_path());
-  int res = i_load_state(load1,error_string,filename);
-  load1.clear(true);
+  return true;
+}
 
+int vsx_engine::queue_state(vsx_string filename, std::vector<vsx_string>& lines, vsx_string *error_string)
+{
+  if (!valid) return 2;
+  vsx_command_list load1;
+  load1.filesystem = &filesystem;
+  for (size_t i = 0; i < lines.size(); i++)
+    load1.add_raw(lines[i]);
+  int res = i_load_state(load1,error_string,filename,true);
+  load1.clear(true);
   return res;
 }
 
+void vsx_engine::set_load_budget(float new_value)
+{
+  load_budget = new_value;
+}
+
+void vsx_engine::set_prefetch_horizon(float new_value)
+{
+  prefetch_horizon = new_value;
+}
+
 
 
 // set engine speed
@@ -345,7 +406,7 @@ bool vsx_engine::start()
     sequence_list.set_engine(this);
     first_start = false;
 
-    log("trying to add screen",0);
+    LOG3("trying to add screen");
 
     // create a new component for the screen
     vsx_comp* comp = new vsx_comp;
@@ -424,6 +485,13 @@ bool vsx_engine::render()
 {
   if (!valid) return false;
 
+  // time between frames, whatever the host does in between included
+  double metrics_t = metrics_timer.atime();
+  if (metrics_frame_start > 0.0)
+    metrics_frame_time.add(metrics_t - metrics_frame_start);
+  metrics_frame_start = metrics_t;
+  vsx_metrics::get_instance()->tick();
+
   // reset dtime
   engine_info.dtime = 0;
 
@@ -578,20 +646,43 @@ bool vsx_engine::render()
     frame_dprev = engine_info.vtime;
 
     // advance the sequencer
+    metrics_t = metrics_timer.atime();
     sequence_list.run(engine_info.dtime);
 
     // advance the sequence pool
     sequence_pool.run(engine_info.dtime);
 
+    // get the loaders going on what the sequencers switch to next
+    if (prefetch_horizon > 0.0f)
+    {
+      sequence_list.prefetch(prefetch_horizon);
+      sequence_pool.prefetch(prefetch_horizon);
+    }
+    metrics_time_sequencer += metrics_timer.atime() - metrics_t;
+
     // run the parameter interpolators
+    metrics_t = metrics_timer.atime();
     interpolation_list.run(m_timer.dtime());
+    metrics_time_interpolation += metrics_timer.atime() - metrics_t;
+    metrics_t = metrics_timer.atime();
+
+    #ifndef VSXE_NO_GM
+      // _time / _dtime for the parameter filters, once for all of them
+      if (vsxl) vsxl->begin_frame(engine_info.vtime, engine_info.dtime);
+    #endif
 
 
     // render the state by iterating over the outputs
     for (unsigned long i = 0; i < outputs.size(); i++) {
       outputs[i]->prepare();
     }
-    
+
+    #ifndef VSXE_NO_GM
+      if (vsxl) vsxl->end_frame();
+    #endif
+    metrics_time_prepare += metrics_timer.atime() - metrics_t;
+    metrics_t = metrics_timer.atime();
+
     // post-rendering reset frame status of the components
     for(std::vector<vsx_comp*>::iterator it = forge.begin(); it < forge.end(); ++it)
     {
@@ -613,7 +704,8 @@ bool vsx_engine::render()
             vsx_module_info foom;
             (*it)->module->module_info(&foom);
 
-            LOG3(vsx_string("waiting for module: ")+foom.identifier+" with name: "+(*it)->name);
+            // every frame while it loads
+            LOG2(vsx_string("waiting for module: ")+foom.identifier+" with name: "+(*it)->name, VSX_LOG_DEBUG);
 
             ++modules_left_to_load;
           } else
@@ -629,6 +721,9 @@ bool vsx_engine::render()
       }
     }
 
+    metrics_time_reset += metrics_timer.atime() - metrics_t;
+    metrics_frames++;
+
     //printf("MODULES LEFT TO LOAD: %d\n",i);
     last_frame_time = (float)frame_timer.dtime();
 
@@ -682,11 +777,19 @@ void vsx_engine::process_message_queue(vsx_command_list *cmd_in, vsx_command_lis
 
   vsx_command_timer.start();
 
-  vsx_command_list* cmd_out = cmd_out_res;
+  // the handlers reply to cmd_staging, from there the replies go to
+  // cmd_dest, recording the ones that change the state in the change log
+  vsx_command_list cmd_staging;
+  vsx_command_list* cmd_dest = cmd_out_res;
+  vsx_command_list* cmd_out = &cmd_staging;
+  unsigned long start_generation = change_log.get_generation();
 
   //#ifdef VSXU_DEBUG
   max_time = 120.0f;
   //#endif
+  // a state loading in the background only gets its slice of the frame
+  if (load_budget > 0.0f && current_state == VSX_ENGINE_LOADING)
+    max_time = load_budget;
   //printf("max time: %f\n", max_time);
   //while (total_time < 0.01 || ignore_timing)
   while (total_time < max_time || ignore_timing)
@@ -703,7 +806,8 @@ void vsx_engine::process_message_queue(vsx_command_list *cmd_in, vsx_command_lis
     //printf("%s\n", vsx_string(vsx_string("cmd_in: ")+c->cmd+" ::: "+c->raw).c_str());
     //printf("c type %d\n",c->type);
     if (c->type == 1)
-      cmd_out = &commands_res_internal;
+      cmd_dest = &commands_res_internal;
+    cmd_staging.accept_commands = cmd_dest->accept_commands;
     //else
 //    	cmd_out = cmd_out_res;
 
@@ -727,18 +831,38 @@ void vsx_engine::process_message_queue(vsx_command_list *cmd_in, vsx_command_lis
     #undef cmd
     #undef cmd_data
 
+    // set_silent
+    cmd_dest->accept_commands = cmd_staging.accept_commands;
+    // a state dump isn't a change
+    log_changes(
+      &cmd_staging,
+      cmd_dest,
+      cmd_dest == cmd_out_res && c->cmd != "get_state" && c->cmd != "get_state_since"
+    );
+
     if (current_state != VSX_ENGINE_LOADING)
     {
-      process_message_queue_redeclare(cmd_out_res);
+      process_message_queue_redeclare(&cmd_staging);
+      log_changes(&cmd_staging, cmd_out_res, true);
     }
 
 
     total_time+=vsx_command_timer.dtime();
+    metrics_commands++;
     // internal garbage collection
     (*(c->garbage_pointer)).remove(c);
     delete c;
   }
 
+  metrics_time_commands += total_time;
+
+  // a loading state's exclusive run goes nowhere, don't waste samples on it
+  if (!exclusive)
+    telemetry.sample(this, cmd_out_res);
+
+  if (change_log.get_generation() != start_generation)
+    cmd_out_res->add_raw("state_generation "+i2s(change_log.get_generation()));
+
 } // process_comand_queue
 
 
@@ -747,6 +871,37 @@ float vsx_engine::get_last_frame_time()
   return last_frame_time;
 }
 
+void vsx_engine::get_metrics(vsx_metrics_writer& out)
+{
+  vsx_string e = vsx_metrics_writer::label("engine", i2s(metrics_id));
+  vsx_string state = "unknown";
+  switch (current_state)
+  {
+    case VSX_ENGINE_LOADING: state = "loading"; break;
+    case VSX_ENGINE_STOPPED: state = "stopped"; break;
+    case VSX_ENGINE_PLAYING: state = "playing"; break;
+    case VSX_ENGINE_REWIND: state = "rewind"; break;
+  }
+  out.gauge("vsx_engine_info", 1.0, e + "," + vsx_metrics_writer::label("state", state));
+  out.gauge("vsx_engine_state", current_state, e);
+  out.histogram("vsx_engine_frame_seconds", metrics_frame_time, e);
+  out.gauge("vsx_engine_last_frame_seconds", last_frame_time, e);
+  out.gauge("vsx_engine_fps", frame_delta_fps, e);
+  out.counter("vsx_engine_frames_total", metrics_frames, e);
+  out.counter("vsx_engine_phase_seconds_total", metrics_time_sequencer, e + ",phase=\"sequencer\"");
+  out.counter("vsx_engine_phase_seconds_total", metrics_time_interpolation, e + ",phase=\"interpolation\"");
+  out.counter("vsx_engine_phase_seconds_total", metrics_time_prepare, e + ",phase=\"prepare\"");
+  out.counter("vsx_engine_phase_seconds_total", metrics_time_reset, e + ",phase=\"reset\"");
+  out.gauge("vsx_engine_components", (double)forge.size(), e);
+  out.gauge("vsx_engine_modules_loading", current_state == VSX_ENGINE_LOADING ? modules_left_to_load : 0, e);
+  out.gauge("vsx_engine_command_queue", (double)commands_internal.count(), e);
+  out.counter("vsx_engine_commands_total", metrics_commands, e);
+  out.counter("vsx_engine_command_seconds_total", metrics_time_commands, e);
+  out.gauge("vsx_engine_interpolations", (double)interpolation_list.size(), e);
+  out.gauge("vsx_engine_param_watches", (double)telemetry.size(), e);
+  out.gauge("vsx_engine_state_generation", (double)change_log.get_generation(), e);
+}
+
 double vsx_engine::get_fps() {
   #ifndef VSX_DEMO_MINI
   return frame_delta_fps;
@@ -81,6 +81,10 @@ void vsx_engine_abs::constructor_set_default_values()
   // on unix/linux, resources are now stored in ~/.vsxu/data/resources
   filesystem.set_base_path(vsx_get_data_path());
   frame_cfp_time = 0.0f;
+  load_budget = 0.0f;
+  prefetch_horizon = 2.0f;
+  if (getenv("VSXU_PREFETCH_HORIZON"))
+    prefetch_horizon = (float)atof(getenv("VSXU_PREFETCH_HORIZON"));
   last_m_time_synch = 0;
   first_start = true;
   stopped = true;
@@ -93,6 +97,15 @@ void vsx_engine_abs::constructor_set_default_values()
   frame_delta_fps = 0;
   frame_delta_fps_frame_count_interval = 50;
   component_name_autoinc = 0;
+  metrics_id = vsx_metrics::get_instance()->get_id();
+  metrics_frame_start = 0.0;
+  metrics_frames = 0.0;
+  metrics_time_sequencer = 0.0;
+  metrics_time_interpolation = 0.0;
+  metrics_time_prepare = 0.0;
+  metrics_time_reset = 0.0;
+  metrics_commands = 0.0;
+  metrics_time_commands = 0.0;
 }
 
 void vsx_engine_abs::reset_input_events()
@@ -101,7 +114,7 @@ void vsx_engine_abs::reset_input_events()
   engine_info.num_input_events = 0;
 }
 
-int vsx_engine_abs::i_load_state(vsx_command_list& load1,vsx_string *error_string, vsx_string info_filename)
+int vsx_engine_abs::i_load_state(vsx_command_list& load1,vsx_string *error_string, vsx_string info_filename, bool deferred)
 {
   if (!valid) return 2;
   LOG("i_load_state 1")
@@ -157,10 +170,20 @@ int vsx_engine_abs::i_load_state(vsx_command_list& load1,vsx_string *error_strin
     //load2.add_raw("clear");
     //process_message_queue(&load2,&loadr2,true);
     start();
-    LOG("i_load_state pre processing_message_queue")
+    if (deferred)
+    {
+      // same as an exclusive process_message_queue, only the commands
+      // are left in the queue for the coming frames
+      load1.set_type(1);
+      while ( (mc = load1.pop()) )
+        commands_internal.add(mc);
+    } else
+    {
+      LOG("i_load_state pre processing_message_queue")
 
-    process_message_queue(&load1,&loadr2,true);
-    LOG("i_load_state post processing_message_queue")
+      process_message_queue(&load1,&loadr2,true);
+      LOG("i_load_state post processing_message_queue")
+    }
     load2.clear(true);
     loadr2.clear(true);
   }
@@ -335,6 +358,30 @@ void vsx_engine_abs::process_message_queue_redeclare(vsx_command_list *cmd_out_r
   }
 }
 
+void vsx_engine_abs::log_changes(vsx_command_list *staging, vsx_command_list *dest, bool to_client)
+{
+  vsx_command_s* c;
+  while ( (c = staging->pop()) )
+  {
+    if (!dest->accept_commands)
+    {
+      delete c;
+      continue;
+    }
+    if (to_client && vsx_engine_change_log::is_change(c))
+    {
+      unsigned long generation = change_log.add(c);
+      size_t part = vsx_engine_change_log::component_part(c);
+      if (part && part < c->parts.size())
+      {
+        vsx_comp* comp = get_component_by_name(c->parts[part]);
+        if (comp) comp->generation = generation;
+      }
+    }
+    dest->add(c);
+  }
+}
+
 void vsx_engine_abs::send_state_to_client(vsx_command_list *cmd_out) {
 #ifndef VSX_DEMO_MINI
   #ifndef SAVE_PRODUCTION
@@ -391,6 +438,8 @@ void vsx_engine_abs::send_state_to_client(vsx_command_list *cmd_out) {
   // notes
   for (note_iter = note_map.begin(); note_iter != note_map.end(); note_iter++)
   cmd_out->add_raw(vsx_string((*note_iter).second.serialize()));
+  // what the client has now, for get_state_since
+  cmd_out->add_raw("state_generation "+i2s(change_log.get_generation()));
 #endif
 }
 
@@ -442,7 +491,7 @@ void vsx_engine_abs::i_clear(vsx_command_list *cmd_out,bool clear_critical) {
         (*fit).second->unload_module();
       }
       delete ((*fit).second);
-      LOG("done deleting"´)
+      LOG("done deleting")
     }
     else
     {
@@ -463,6 +512,9 @@ void vsx_engine_abs::i_clear(vsx_command_list *cmd_out,bool clear_critical) {
   sequence_pool.clear();
   sequence_list.clear_master_sequences();
 
+  // clients that were following along have to start over
+  change_log.invalidate();
+
   //printf("forge save size: %d\n",forge.size());
   last_m_time_synch = 0;
   engine_info.vtime = 0;
@@ -0,0 +1,118 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+
+#include "vsx_engine_change_log.h"
+
+vsx_engine_change_log::vsx_engine_change_log()
+:
+  generation(1),
+  horizon(1)
+{
+}
+
+bool vsx_engine_change_log::is_change(vsx_command_s* c)
+{
+  const vsx_string& cmd = c->cmd;
+  if
+  (
+    cmd == "component_create_ok" ||
+    cmd == "component_delete_ok" ||
+    cmd == "component_rename_ok" ||
+    cmd == "component_assign_ok" ||
+    cmd == "in_param_spec" ||
+    cmd == "out_param_spec" ||
+    cmd == "param_connect_volatile" ||
+    cmd == "param_connect_ok" ||
+    cmd == "param_disconnect_ok" ||
+    cmd == "param_alias_ok" ||
+    cmd == "param_unalias_ok" ||
+    cmd == "pa_ren_ok" ||
+    cmd == "connections_order_ok" ||
+    cmd == "vsxl_pfi_ok" ||
+    cmd == "vsxl_pfr_ok" ||
+    cmd == "vsxl_cfi_ok" ||
+    cmd == "vsxl_cfr_ok" ||
+    cmd == "note_create_ok" ||
+    cmd == "note_delete_ok"
+  )
+    return true;
+  // inject_get is an answer to a question, not a change
+  if (cmd == "pseq_p_ok" && c->parts.size() > 1)
+    return c->parts[1] == "init" || c->parts[1] == "remove";
+  if (cmd == "mseq_channel_ok" && c->parts.size() > 1)
+    return c->parts[1] == "add" || c->parts[1] == "remove";
+  return false;
+}
+
+size_t vsx_engine_change_log::component_part(vsx_command_s* c)
+{
+  const vsx_string& cmd = c->cmd;
+  //  param_alias_ok [p_def] [io] [component] ...
+  if (cmd == "param_alias_ok") return 3;
+  //  param_unalias_ok [io] [component] [param]
+  if (cmd == "param_unalias_ok") return 2;
+  //  pseq_p_ok [init/remove] [component] [param]
+  if (cmd == "pseq_p_ok") return 2;
+  if (cmd == "mseq_channel_ok" || cmd == "component_delete_ok") return 0;
+  if (cmd == "note_create_ok" || cmd == "note_delete_ok") return 0;
+  return 1;
+}
+
+unsigned long vsx_engine_change_log::add(vsx_command_s* c)
+{
+  ++generation;
+  vsx_engine_change_log_entry entry;
+  entry.generation = generation;
+  entry.command = c->raw;
+  entries.push_back(entry);
+  if (entries.size() > VSX_ENGINE_CHANGE_LOG_SIZE)
+  {
+    horizon = entries.front().generation;
+    entries.pop_front();
+  }
+  return generation;
+}
+
+void vsx_engine_change_log::invalidate()
+{
+  ++generation;
+  horizon = generation;
+  entries.clear();
+}
+
+unsigned long vsx_engine_change_log::get_generation()
+{
+  return generation;
+}
+
+bool vsx_engine_change_log::get_since(unsigned long since, vsx_command_list* cmd_out)
+{
+  if (since == 0 || since < horizon || since > generation) return false;
+  // entries are in generation order, skip what the client has seen
+  std::deque<vsx_engine_change_log_entry>::iterator it = entries.begin();
+  while (it != entries.end() && (*it).generation <= since) ++it;
+  for (; it != entries.end(); ++it)
+    cmd_out->add_raw((*it).command);
+  return true;
+}
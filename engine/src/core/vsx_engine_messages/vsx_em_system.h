@@ -86,6 +86,57 @@
     } else
     if (cmd == "get_state") {
       send_state_to_client(cmd_out);
+    } else
+    if (cmd == "get_state_since") {
+      // syntax:
+      //  get_state_since [generation]
+      // replays the changes after the generation the client has, or starts it
+      // over with the full state if they're not in the change log anymore
+      unsigned long since = 0;
+      if (c->parts.size() == 2)
+        since = (unsigned long)s2i(c->parts[1]);
+      if (change_log.get_since(since, cmd_out))
+        cmd_out->add_raw("state_generation "+i2s(change_log.get_generation()));
+      else
+      {
+        cmd_out->add_raw("state_sync_full");
+        send_state_to_client(cmd_out);
+      }
+    } else
+    if (cmd == "get_generation") {
+      // syntax:
+      //  get_generation [component]
+      //  generation_ok [component] [generation of its last change]
+      if (c->parts.size() == 2) {
+        vsx_comp* dest = get_component_by_name(c->parts[1]);
+        if (dest)
+          cmd_out->add_raw("generation_ok "+c->parts[1]+" "+i2s(dest->generation));
+      }
+    } else
+    if (cmd == "param_watch") {
+      // syntax:
+      //  param_watch [component] [param] [-1=in / 1=out] [id]
+      if (c->parts.size() == 5)
+        telemetry.watch(s2i(c->parts[4]), c->parts[1], c->parts[2], s2i(c->parts[3]) == 1 ? 1 : -1);
+    } else
+    if (cmd == "param_unwatch") {
+      if (c->parts.size() == 2)
+        telemetry.unwatch(s2i(c->parts[1]));
+    } else
+    if (cmd == "telemetry_rate") {
+      // syntax:
+      //  telemetry_rate [samples per second]
+      if (c->parts.size() == 2)
+        telemetry.set_rate(s2f(c->parts[1]));
+    } else
+    if (cmd == "metrics_get") {
+      // syntax:
+      //  metrics_get [prometheus / json]
+      //  metrics_ok [format] [base64 of the metrics of the whole process]
+      vsx_string format = "prometheus";
+      if (c->parts.size() == 2 && c->parts[1] == "json")
+        format = "json";
+      cmd_out->add_raw("metrics_ok "+format+" "+base64_encode(vsx_metrics::get_instance()->get(format)));
     } else
 		#ifndef VSX_NO_CLIENT
     if (cmd == "undo_s") {
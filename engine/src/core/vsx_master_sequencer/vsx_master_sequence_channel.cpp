@@ -130,6 +130,47 @@ void vsx_master_sequence_channel::run(float dtime)
 	items[line_cur]->run(line_time);
 }
 
+// the time sequence of a block can bend its time any way it likes, the
+// horizon is only scaled by the average speed
+static float prefetch_scale(vsx_sequence_master_channel_item* item)
+{
+	if (item->length <= 0.0f) return 0.0f;
+	return item->pool_sequence_list->calculate_total_time() / item->length;
+}
+
+void vsx_master_sequence_channel::prefetch(float horizon)
+{
+	if ((size_t)line_cur >= items.size()) return;
+
+	// the block that's playing looks ahead in its own sequences
+	vsx_sequence_master_channel_item* cur = items[line_cur];
+	if (cur->pool_sequence_list && line_time <= cur->length)
+		cur->pool_sequence_list->prefetch(horizon * prefetch_scale(cur));
+
+	// the blocks starting within the horizon: every frame the part of the
+	// window that's new, in the block's own time, so each row gets the full
+	// lead and not just the first one. Before the block starts from is
+	// negative and its first rows are included.
+	float position = line_time;
+	for (int i = 0; i < line_cur; i++)
+		position += items[i]->total_length;
+	float from = prefetch_end;
+	if (from < position || from > position + horizon)
+		from = position;
+	float to = position + horizon;
+	float start = position - line_time + cur->total_length;
+	for (size_t i = line_cur + 1; i < items.size() && start <= to; i++)
+	{
+		if (items[i]->pool_sequence_list)
+		{
+			float scale = prefetch_scale(items[i]);
+			items[i]->pool_sequence_list->prefetch_range((from - start) * scale, (to - start) * scale);
+		}
+		start += items[i]->total_length;
+	}
+	prefetch_end = to;
+}
+
 
 
 //*********************************************************************************************************
@@ -421,6 +462,7 @@ vsx_master_sequence_channel::vsx_master_sequence_channel()
 	i_vtime = 0.0f;
 	line_cur = 0;
 	line_time = 0.0f;
+	prefetch_end = -1.0f;
 	vsx_sequence_master_channel_item* item = new vsx_sequence_master_channel_item;
 	item->total_length = 1.0f;
 	item->length = 0.0f;
@@ -49,6 +49,8 @@ class vsx_master_sequence_channel {
   float line_time; // current line time (accumulated)
   int line_cur; // current line
 	float i_vtime;
+	// end of what prefetch() already announced, in channel time
+	float prefetch_end;
 	std::vector<vsx_sequence_master_channel_item*> items;
 	void i_remove_line(int pos);
 public:
@@ -64,6 +66,8 @@ public:
 	void set_time(float new_time);
 	void set_engine(void* new_engine) { engine = new_engine; };
 	void run(float dtime);
+	// resources the blocks within horizon seconds will switch to
+	void prefetch(float horizon);
 	void inject(vsx_string inject_string);
 	vsx_master_sequence_channel();
 };
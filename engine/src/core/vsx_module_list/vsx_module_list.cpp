@@ -31,9 +31,183 @@
 #include "vsx_module_list_abs.h"
 #include "vsx_module_list.h"
 #include "vsx_module_plugin_info.h"
+#include "vsx_module_list_cache.h"
 
 
 
+vsx_module_list::vsx_module_list()
+{
+  pthread_mutex_init(&plugin_mutex, NULL);
+}
+
+// dlopen the plugin and pick up its functions
+bool vsx_module_list::open_plugin(vsx_module_list_plugin* plugin)
+{
+  // load the plugin
+  vsx_dynamic_object_handle plugin_handle = vsx_dlopen::open(
+        plugin->file_name.c_str()
+  );
+
+  // if loading fails, print debug output
+  if (!plugin_handle) {
+    printf(
+          "vsx_module_list init: Error: trying to load the plugin \"%s\"\n"
+          "                      Cause: dlopen returned error: %s\n",
+          plugin->file_name.c_str(),
+          vsx_dlopen::error()
+    );
+    return false;
+  }
+
+  //-------------------------------------------------------------------------
+  // look for the REQUIRED constructor (factory) method
+  if (vsx_dlopen::sym(plugin_handle, "create_new_module") == 0)
+  {
+    printf(
+          "vsx_module_list init: Error: trying to load the plugin \"%s\"\n"
+          "                      Cause: sym could not find \"create_module\"\n",
+          plugin->file_name.c_str()
+          );
+    vsx_dlopen::close(plugin_handle);
+    return false;
+  }
+  // initialize constructor (factory) method
+  plugin->create_new_module =
+      (vsx_module*(*)(unsigned long, void*))
+      vsx_dlopen::sym(
+        plugin_handle,
+        "create_new_module"
+      );
+  //-------------------------------------------------------------------------
+
+
+
+  //-------------------------------------------------------------------------
+  // look for the REQUIRED destructor method
+  if (vsx_dlopen::sym(plugin_handle, "destroy_module") == 0)
+  {
+    printf(
+          "vsx_module_list init: Error: trying to load the plugin \"%s\"\n"
+          "                      Cause: sym could not find \"destroy_module\"\n",
+          plugin->file_name.c_str()
+          );
+    vsx_dlopen::close(plugin_handle);
+    return false;
+  }
+  // init destructor method
+  plugin->destroy_module =
+      (void(*)(vsx_module*,unsigned long))
+      vsx_dlopen::sym(
+        plugin_handle,
+        "destroy_module"
+      );
+  //-------------------------------------------------------------------------
+
+
+
+  //-------------------------------------------------------------------------
+  // check for and if found, set the optional environment_info support
+  if (vsx_dlopen::sym(plugin_handle,"set_environment_info"))
+  {
+    void(*set_env)(vsx_engine_environment*) =
+        (void(*)(vsx_engine_environment*))
+        vsx_dlopen::sym(
+          plugin_handle,
+          "set_environment_info"
+        );
+    set_env(&engine_environment);
+  }
+  //-------------------------------------------------------------------------
+
+  plugin->handle = plugin_handle;
+  return true;
+}
+
+// open a plugin whose modules came from the cache, the first time one of
+// them is created
+bool vsx_module_list::load_plugin(vsx_module_list_plugin* plugin)
+{
+  pthread_mutex_lock(&plugin_mutex);
+  if (!plugin->handle && !plugin->load_failed)
+  {
+    if (!open_plugin(plugin))
+      plugin->load_failed = true;
+    else
+    {
+      // plugins set up their module tables in here, create_new_module
+      // counts on it having been called
+      unsigned long(*get_num_modules)(void) =
+          (unsigned long(*)(void))
+          vsx_dlopen::sym(
+            plugin->handle,
+            "get_num_modules"
+          );
+      if (get_num_modules)
+        get_num_modules();
+    }
+  }
+  bool result = plugin->handle != 0;
+  pthread_mutex_unlock(&plugin_mutex);
+  return result;
+}
+
+void vsx_module_list::add_module(vsx_module_list_plugin* plugin, unsigned long module_id, vsx_module_info* module_info)
+{
+  module_info->location = "external";
+
+  // create module_plugin_info template
+  vsx_module_plugin_info module_plugin_info_template;
+
+  module_plugin_info_template.plugin = plugin;
+
+  module_plugin_info_template.module_id = module_id;
+
+  // split the module identifier string into its individual names
+  // a module can have multiple names (and locations in the gui tree)
+  // some of these are hidden, thus the name begins with an exclamation mark - !
+  // example module identifier string:
+  //   examples;my_modules;my_module||!old_path;old_category;old_name
+  // Only the first will show up in the gui. The second identifier is still usable in
+  // old state files.
+  vsx_string deli = "||";
+  vsx_avector<vsx_string> parts;
+  explode(module_info->identifier, deli, parts);
+  vsx_module_plugin_info* applied_plugin_info = 0;
+
+  // iterate through the individual names for this module
+  for (unsigned long i = 0; i < parts.size(); ++i)
+  {
+    // create a copy of the template
+    applied_plugin_info = new vsx_module_plugin_info;
+    *applied_plugin_info = module_plugin_info_template;
+    vsx_module_info* applied_module_info = new vsx_module_info;
+    *applied_module_info = *module_info;
+    applied_plugin_info->module_info = applied_module_info;
+
+
+    vsx_string module_identifier;
+    if (parts[i][0] == '!')
+    {
+      // hidden from gui
+      applied_plugin_info->hidden_from_gui = true;
+      module_identifier = parts[i].substr(1);
+    } else
+    {
+      // normal
+      applied_plugin_info->hidden_from_gui = false;
+      module_identifier = parts[i];
+    }
+    // set module info identifier
+    applied_module_info->identifier = module_identifier;
+    // add the applied_plugin_info to module_plugin_list
+    module_plugin_list[module_identifier] = applied_plugin_info;
+
+    // add the module info to the module list
+    module_list[module_identifier] = module_info;
+  } // iterate through the individual names for this module
+  module_infos.push_back(module_info);
+}
+
 void vsx_module_list::init(vsx_string args, bool print_help)
 {
   // woops, looks like we already built the list
@@ -45,7 +219,6 @@ void vsx_module_list::init(vsx_string args, bool print_help)
   //unsigned long total_num_modules = 0;
 
   // set up engine environment for later use (directories in which modules can look for config)
-  vsx_engine_environment engine_environment;
   engine_environment.engine_parameter[0] = PLATFORM_SHARED_FILES+"plugin-config/";
 
   // recursively find the plugin so's from the plugins directory
@@ -63,44 +236,42 @@ void vsx_module_list::init(vsx_string args, bool print_help)
   );
   //-------------------------------------------------------------------------
 
+  // what the plugins contained last time, plugins that haven't changed
+  // since aren't opened here at all
+  vsx_module_list_cache cache;
+  bool use_cache = !print_help && cache.enabled();
+  if (use_cache)
+    cache.load();
+
   //-------------------------------------------------------------------------
   // Iterate through all the filenames, treat them as plugins with dlopen
   // and probe them to see if they are vsxu modules.
   for (std::list<vsx_string>::iterator it = mfiles.begin(); it != mfiles.end(); ++it)
   {
-    vsx_string dynamic_object_file_name = (*it);
-    //vsx_avector<vsx_string> parts;
-    vsx_dynamic_object_handle plugin_handle;
-    //vsx_string deli = vsx_get_directory_separator();
-    //explode((*it),deli,parts);
-
-    // load the plugin
-    plugin_handle = vsx_dlopen::open(
-          dynamic_object_file_name.c_str()
-    );
-
-    // if loading fails, print debug output
-    if (!plugin_handle) {
-      printf(
-            "vsx_module_list init: Error: trying to load the plugin \"%s\"\n"
-            "                      Cause: dlopen returned error: %s\n",
-            dynamic_object_file_name.c_str(),
-            vsx_dlopen::error()
-      );
-      continue; // try to load the next plugin
-    }
-
-    // add this module handle to our list of module handles
-    plugin_handles.push_back(plugin_handle);
+    vsx_module_list_plugin* plugin = new vsx_module_list_plugin;
+    plugin->file_name = (*it);
 
     if (print_help)
     {
-      if ( vsx_dlopen::sym(plugin_handle, "print_help") )
+      plugin->handle = vsx_dlopen::open( plugin->file_name.c_str() );
+      if (!plugin->handle)
+      {
+        printf(
+              "vsx_module_list init: Error: trying to load the plugin \"%s\"\n"
+              "                      Cause: dlopen returned error: %s\n",
+              plugin->file_name.c_str(),
+              vsx_dlopen::error()
+        );
+        delete plugin;
+        continue; // try to load the next plugin
+      }
+      plugins.push_back(plugin);
+      if ( vsx_dlopen::sym(plugin->handle, "print_help") )
       {
         void(*print_help)() =
             (void(*)())
             vsx_dlopen::sym(
-              plugin_handle,
+              plugin->handle,
               "print_help"
             );
         print_help();
@@ -109,59 +280,51 @@ void vsx_module_list::init(vsx_string args, bool print_help)
       continue;
     }
 
+    long long mtime = 0, size = 0;
+    bool cacheable = use_cache && vsx_module_list_cache::stat_file(plugin->file_name, mtime, size);
 
     //-------------------------------------------------------------------------
-    // look for the REQUIRED constructor (factory) method
-    if (vsx_dlopen::sym(plugin_handle, "create_new_module") == 0)
+    // known plugin, take the module infos from the cache
+    vsx_module_list_cache_entry* cache_entry = 0;
+    if (cacheable)
+      cache_entry = cache.find(plugin->file_name, mtime, size);
+    if (cache_entry)
     {
-      printf(
-            "vsx_module_list init: Error: trying to load the plugin \"%s\"\n"
-            "                      Cause: sym could not find \"create_module\"\n",
-            dynamic_object_file_name.c_str()
-            );
-      continue; // try to load the next plugin
+      plugins.push_back(plugin);
+      for (size_t i = 0; i < cache_entry->modules.size(); i++)
+      {
+        vsx_module_info* module_info = new vsx_module_info;
+        *module_info = cache_entry->modules[i].info;
+        add_module(plugin, cache_entry->modules[i].module_id, module_info);
+      }
+      continue;
     }
-    // initialize constructor (factory) method
-    vsx_module*(*create_new_module)(unsigned long, void*) =
-        (vsx_module*(*)(unsigned long, void*))
-        vsx_dlopen::sym(
-          plugin_handle,
-          "create_new_module"
-        );
-    //-------------------------------------------------------------------------
-
-
 
     //-------------------------------------------------------------------------
-    // look for the REQUIRED destructor method
-    if (vsx_dlopen::sym(plugin_handle, "destroy_module") == 0)
+    // new or changed plugin, open it and ask the modules
+    if (!open_plugin(plugin))
     {
-      printf(
-            "vsx_module_list init: Error: trying to load the plugin \"%s\"\n"
-            "                      Cause: sym could not find \"destroy_module\"\n",
-            dynamic_object_file_name.c_str()
-            );
+      delete plugin;
       continue; // try to load the next plugin
     }
-    // init destructor method
-    void(*destroy_module)(vsx_module*,unsigned long) =
-        (void(*)(vsx_module*,unsigned long))
-        vsx_dlopen::sym(
-          plugin_handle,
-          "destroy_module"
-        );
-    //-------------------------------------------------------------------------
 
+    // add this module handle to our list of module handles
+    plugins.push_back(plugin);
 
+    // plugins taking the environment build their module list from the files
+    // in plugin-config (render.glsl's shaders), which the cache can't see
+    // change - ask them every time
+    if (cacheable && !vsx_dlopen::sym(plugin->handle, "set_environment_info"))
+      cache_entry = cache.add(plugin->file_name, mtime, size);
 
     //-------------------------------------------------------------------------
     // look for the REQUIRED get_num_modules method
-    if (vsx_dlopen::sym(plugin_handle, "get_num_modules") == 0)
+    if (vsx_dlopen::sym(plugin->handle, "get_num_modules") == 0)
     {
       printf(
             "vsx_module_list init: Error: trying to load the plugin \"%s\"\n"
             "                      Cause: sym could not find \"get_num_modules\"\n",
-            dynamic_object_file_name.c_str()
+            plugin->file_name.c_str()
             );
       continue; // try to load the next plugin
     }
@@ -169,27 +332,11 @@ void vsx_module_list::init(vsx_string args, bool print_help)
     unsigned long(*get_num_modules)(void) =
         (unsigned long(*)(void))
         vsx_dlopen::sym(
-          plugin_handle,
+          plugin->handle,
           "get_num_modules"
         );
     //-------------------------------------------------------------------------
 
-
-
-    //-------------------------------------------------------------------------
-    // check for and if found, set the optional environment_info support
-    if (vsx_dlopen::sym(plugin_handle,"set_environment_info"))
-    {
-      void(*set_env)(vsx_engine_environment*) =
-          (void(*)(vsx_engine_environment*))
-          vsx_dlopen::sym(
-            plugin_handle,
-            "set_environment_info"
-          );
-      set_env(&engine_environment);
-    }
-    //-------------------------------------------------------------------------
-
     // get the number of modules in this plugin
     unsigned long num_modules_in_this_plugin = get_num_modules();
 
@@ -202,7 +349,7 @@ void vsx_module_list::init(vsx_string args, bool print_help)
     {
       // ask the constructor / factory to create a module instance for us
       vsx_module* module_object =
-          create_new_module(module_index_iterator, (void*)&arguments);
+          plugin->create_new_module(module_index_iterator, (void*)&arguments);
       // check for error
       if (0x0 == module_object)
       {
@@ -212,7 +359,7 @@ void vsx_module_list::init(vsx_string args, bool print_help)
               "                      Hint: If you are developing, check to see that get_num_modules returns\n"
               "                            the correct module count!\n"
               ,
-              dynamic_object_file_name.c_str(),
+              plugin->file_name.c_str(),
               module_index_iterator
               );
         continue; // try to load the next module
@@ -225,66 +372,28 @@ void vsx_module_list::init(vsx_string args, bool print_help)
       // check to see if this module can run on this system
       bool can_run = module_object->can_run();
 
-      destroy_module( module_object, module_index_iterator );
-
-      if (!can_run) continue; // try to load the next module
-
-      module_info->location = "external";
+      plugin->destroy_module( module_object, module_index_iterator );
 
-      // create module_plugin_info template
-      vsx_module_plugin_info module_plugin_info_template;
-
-      module_plugin_info_template.create_new_module = create_new_module;
-      module_plugin_info_template.destroy_module = destroy_module;
-
-      module_plugin_info_template.module_id = module_index_iterator;
-
-      // split the module identifier string into its individual names
-      // a module can have multiple names (and locations in the gui tree)
-      // some of these are hidden, thus the name begins with an exclamation mark - !
-      // example module identifier string:
-      //   examples;my_modules;my_module||!old_path;old_category;old_name
-      // Only the first will show up in the gui. The second identifier is still usable in
-      // old state files.
-      vsx_string deli = "||";
-      vsx_avector<vsx_string> parts;
-      explode(module_info->identifier, deli, parts);
-      vsx_module_plugin_info* applied_plugin_info = 0;
+      if (!can_run)
+      {
+        delete module_info;
+        continue; // try to load the next module
+      }
 
-      // iterate through the individual names for this module
-      for (unsigned long i = 0; i < parts.size(); ++i)
+      if (cache_entry)
       {
-        // create a copy of the template
-        applied_plugin_info = new vsx_module_plugin_info;
-        *applied_plugin_info = module_plugin_info_template;
-        vsx_module_info* applied_module_info = new vsx_module_info;
-        *applied_module_info = *module_info;
-        applied_plugin_info->module_info = applied_module_info;
-
-
-        vsx_string module_identifier;
-        if (parts[i][0] == '!')
-        {
-          // hidden from gui
-          applied_plugin_info->hidden_from_gui = true;
-          module_identifier = parts[i].substr(1);
-        } else
-        {
-          // normal
-          applied_plugin_info->hidden_from_gui = false;
-          module_identifier = parts[i];
-        }
-        // set module info identifier
-        applied_module_info->identifier = module_identifier;
-        // add the applied_plugin_info to module_plugin_list
-        module_plugin_list[module_identifier] = applied_plugin_info;
-
-        // add the module info to the module list
-        module_list[module_identifier] = module_info;
-      } // iterate through the individual names for this module
-      module_infos.push_back(module_info);
+        vsx_module_list_cache_module cache_module;
+        cache_module.module_id = module_index_iterator;
+        cache_module.info = *module_info;
+        cache_entry->modules.push_back(cache_module);
+      }
+
+      add_module(plugin, module_index_iterator, module_info);
     } // iterate through modules in this plugin
   } // Iterate through all the filenames, treat them as plugins
+
+  if (use_cache)
+    cache.save();
 }
 
 std::vector< vsx_module_info* >* vsx_module_list::get_module_list( bool include_hidden )
@@ -309,31 +418,45 @@ std::vector< vsx_module_info* >* vsx_module_list::get_module_list( bool include_
 
 void vsx_module_list::destroy()
 {
-  for (size_t i = 0; i < plugin_handles.size(); i++)
+  for (size_t i = 0; i < plugins.size(); i++)
   {
-    vsx_dlopen::close( plugin_handles[i] );
+    // plugins from the cache that no module was ever created from
+    if (plugins[i]->handle)
+      vsx_dlopen::close( plugins[i]->handle );
+    delete plugins[i];
   }
+  plugins.clear();
 }
 
 vsx_module* vsx_module_list::load_module_by_name(vsx_string name)
 {
-  if ( module_plugin_list.find(name) == module_plugin_list.end() )
+  std::map< vsx_string, void* >::iterator it = module_plugin_list.find(name);
+  if ( it == module_plugin_list.end() )
+  {
+    return 0x0;
+  }
+  vsx_module_plugin_info* plugin_info = (vsx_module_plugin_info*)(*it).second;
+
+  // open the plugin if the module list came from the cache
+  if (!load_plugin(plugin_info->plugin))
   {
     return 0x0;
   }
 
   // call constrcuction factory
   vsx_module* module =
-    ((vsx_module_plugin_info*)module_plugin_list[ name ])
-    ->
-    create_new_module
+    plugin_info->plugin->create_new_module
     (
-      ((vsx_module_plugin_info*)module_plugin_list[ name ])->module_id,
+      plugin_info->module_id,
       (void*)&arguments
     )
   ;
-  module->module_id = ((vsx_module_plugin_info*)module_plugin_list[ name ])->module_id;
-  module->module_identifier = ((vsx_module_plugin_info*)module_plugin_list[ name ])->module_info->identifier;
+  if (!module)
+  {
+    return 0x0;
+  }
+  module->module_id = plugin_info->module_id;
+  module->module_identifier = plugin_info->module_info->identifier;
   return module;
 }
 
@@ -342,7 +465,7 @@ void vsx_module_list::unload_module( vsx_module* module_pointer )
   // call destrcuction factory
   ((vsx_module_plugin_info*)module_plugin_list[ module_pointer->module_identifier ])
   ->
-  destroy_module
+  plugin->destroy_module
   (
     module_pointer,
     module_pointer->module_id
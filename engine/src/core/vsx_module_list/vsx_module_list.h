@@ -24,17 +24,29 @@
 #ifndef VSX_MODULE_LIST_H
 #define VSX_MODULE_LIST_H
 
+#include <pthread.h>
 #include "vsx_dlopen.h"
 // Implementation of Module List Class for Linux
 
 // See vsx_module_list_abs.h for reference documentation for this class
 
+class vsx_module_list_plugin;
+
 class vsx_module_list : public vsx_module_list_abs
 {
 private:
-  std::vector< vsx_dynamic_object_handle > plugin_handles;
+  std::vector< vsx_module_list_plugin* > plugins;
   vsx_argvector arguments;
+  // handed to every plugin, they keep the pointer
+  vsx_engine_environment engine_environment;
+  // plugins opened on demand can be asked for from several engines
+  pthread_mutex_t plugin_mutex;
+
+  bool open_plugin(vsx_module_list_plugin* plugin);
+  bool load_plugin(vsx_module_list_plugin* plugin);
+  void add_module(vsx_module_list_plugin* plugin, unsigned long module_id, vsx_module_info* module_info);
 public:
+  vsx_module_list();
   void init(vsx_string args = "", bool print_help = false);
   void destroy();
   std::vector< vsx_module_info* >* get_module_list( bool include_hidden = false);
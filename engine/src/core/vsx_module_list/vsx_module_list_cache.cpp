@@ -0,0 +1,297 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <vsx_platform.h>
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+  #include <unistd.h>
+#else
+  #include <process.h>
+#endif
+#include <vsx_version.h>
+#include <vsxfst.h>
+
+#include "vsx_module_list_cache.h"
+
+// bump when the layout below or what goes in it changes
+#define MODULE_CACHE_FORMAT 2
+#define MODULE_CACHE_MAGIC "VSXMODC"
+
+// anything that makes the stored infos mean something else
+static vsx_string cache_abi()
+{
+  char abi[64];
+  sprintf(abi, "%s:%d:%d", vsxu_ver, (int)sizeof(vsx_module_info), (int)sizeof(void*));
+  return vsx_string(abi);
+}
+
+//---------------------------------------------------------------------------
+// file helpers, everything is little endian like the machines we run on,
+// the abi string keeps caches from other builds out anyway
+
+static void write_u32(FILE* f, unsigned int v)
+{
+  fwrite(&v, sizeof(v), 1, f);
+}
+
+static void write_s64(FILE* f, long long v)
+{
+  fwrite(&v, sizeof(v), 1, f);
+}
+
+static void write_string(FILE* f, const vsx_string& s)
+{
+  write_u32(f, (unsigned int)s.size());
+  if (s.size())
+    fwrite(s.c_str(), 1, s.size(), f);
+}
+
+static bool read_u32(FILE* f, unsigned int& v)
+{
+  return fread(&v, sizeof(v), 1, f) == 1;
+}
+
+static bool read_s64(FILE* f, long long& v)
+{
+  return fread(&v, sizeof(v), 1, f) == 1;
+}
+
+static bool read_string(FILE* f, vsx_string& s, std::vector<char>& buffer)
+{
+  unsigned int length;
+  if (!read_u32(f, length)) return false;
+  // no string in a module info comes near this, the file is broken
+  if (length > (1 << 24)) return false;
+  buffer.resize(length + 1);
+  if (length && fread(&buffer[0], 1, length, f) != length) return false;
+  buffer[length] = 0;
+  s = vsx_string(&buffer[0]);
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+vsx_module_list_cache::vsx_module_list_cache()
+:
+  changed(false)
+{
+  const char* env = getenv("VSXU_MODULE_CACHE");
+  if (env)
+  {
+    if (strcmp(env, "0") != 0)
+      file_name = env;
+    return;
+  }
+  file_name = vsx_get_data_path() + "module_cache";
+}
+
+bool vsx_module_list_cache::enabled()
+{
+  return file_name.size() != 0;
+}
+
+bool vsx_module_list_cache::stat_file(const vsx_string& file_name, long long& mtime, long long& size)
+{
+  struct stat st;
+  if (stat(file_name.c_str(), &st) != 0) return false;
+  mtime = (long long)st.st_mtime;
+  size = (long long)st.st_size;
+  return true;
+}
+
+void vsx_module_list_cache::load()
+{
+  entries.clear();
+  changed = false;
+  if (!enabled()) return;
+
+  FILE* f = fopen(file_name.c_str(), "rb");
+  if (!f)
+  {
+    // first run
+    changed = true;
+    return;
+  }
+
+  std::vector<char> buffer;
+  bool ok = false;
+  char magic[8];
+  unsigned int format;
+  vsx_string abi;
+  unsigned int num_plugins;
+
+  if
+  (
+    fread(magic, 1, 8, f) == 8 &&
+    memcmp(magic, MODULE_CACHE_MAGIC, 8) == 0 &&
+    read_u32(f, format) &&
+    format == MODULE_CACHE_FORMAT &&
+    read_string(f, abi, buffer) &&
+    abi == cache_abi() &&
+    read_u32(f, num_plugins)
+  )
+  {
+    ok = true;
+    for (unsigned int i = 0; i < num_plugins && ok; i++)
+    {
+      vsx_string plugin_file_name;
+      vsx_module_list_cache_entry entry;
+      unsigned int num_modules;
+      ok =
+        read_string(f, plugin_file_name, buffer) &&
+        read_s64(f, entry.mtime) &&
+        read_s64(f, entry.size) &&
+        read_u32(f, num_modules);
+      if (!ok) break;
+      entry.modules.resize(num_modules);
+      for (unsigned int j = 0; j < num_modules && ok; j++)
+      {
+        vsx_module_list_cache_module& m = entry.modules[j];
+        unsigned int module_id, output, tunnel;
+        ok =
+          read_u32(f, module_id) &&
+          read_string(f, m.info.identifier, buffer) &&
+          read_string(f, m.info.description, buffer) &&
+          read_string(f, m.info.in_param_spec, buffer) &&
+          read_string(f, m.info.out_param_spec, buffer) &&
+          read_string(f, m.info.component_class, buffer) &&
+          read_u32(f, output) &&
+          read_u32(f, tunnel);
+        m.module_id = module_id;
+        m.info.output = (int)output;
+        m.info.tunnel = tunnel != 0;
+      }
+      if (ok)
+        entries[plugin_file_name] = entry;
+    }
+  }
+  fclose(f);
+
+  if (!ok)
+  {
+    printf("vsx_module_list: ignoring module cache %s (old or broken), probing all plugins\n", file_name.c_str());
+    entries.clear();
+    changed = true;
+  }
+}
+
+void vsx_module_list_cache::save()
+{
+  if (!enabled()) return;
+
+  // drop plugins that weren't there this time
+  std::map<vsx_string, vsx_module_list_cache_entry>::iterator it = entries.begin();
+  while (it != entries.end())
+  {
+    if (!(*it).second.used)
+    {
+      entries.erase(it++);
+      changed = true;
+    }
+    else
+      ++it;
+  }
+  if (!changed) return;
+
+  // several processes can start at once, each writes its own file and
+  // renames it over the old one
+  char suffix[32];
+  #if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+    sprintf(suffix, ".%d", (int)getpid());
+  #else
+    sprintf(suffix, ".%d", (int)_getpid());
+  #endif
+  vsx_string temp_name = file_name + suffix;
+
+  FILE* f = fopen(temp_name.c_str(), "wb");
+  if (!f)
+  {
+    printf("vsx_module_list: can't write module cache %s\n", temp_name.c_str());
+    return;
+  }
+  fwrite(MODULE_CACHE_MAGIC, 1, 8, f);
+  write_u32(f, MODULE_CACHE_FORMAT);
+  write_string(f, cache_abi());
+  write_u32(f, (unsigned int)entries.size());
+  for (it = entries.begin(); it != entries.end(); ++it)
+  {
+    vsx_module_list_cache_entry& entry = (*it).second;
+    write_string(f, (*it).first);
+    write_s64(f, entry.mtime);
+    write_s64(f, entry.size);
+    write_u32(f, (unsigned int)entry.modules.size());
+    for (size_t j = 0; j < entry.modules.size(); j++)
+    {
+      vsx_module_list_cache_module& m = entry.modules[j];
+      write_u32(f, (unsigned int)m.module_id);
+      write_string(f, m.info.identifier);
+      write_string(f, m.info.description);
+      write_string(f, m.info.in_param_spec);
+      write_string(f, m.info.out_param_spec);
+      write_string(f, m.info.component_class);
+      write_u32(f, (unsigned int)m.info.output);
+      write_u32(f, m.info.tunnel ? 1 : 0);
+    }
+  }
+  bool ok = ferror(f) == 0;
+  if (fclose(f) != 0) ok = false;
+
+  if (ok)
+  {
+    #if PLATFORM_FAMILY == PLATFORM_FAMILY_WINDOWS
+      remove(file_name.c_str());
+    #endif
+    ok = rename(temp_name.c_str(), file_name.c_str()) == 0;
+  }
+  if (!ok)
+  {
+    printf("vsx_module_list: can't write module cache %s\n", file_name.c_str());
+    remove(temp_name.c_str());
+    return;
+  }
+  changed = false;
+}
+
+vsx_module_list_cache_entry* vsx_module_list_cache::find(const vsx_string& plugin_file_name, long long mtime, long long size)
+{
+  std::map<vsx_string, vsx_module_list_cache_entry>::iterator it = entries.find(plugin_file_name);
+  if (it == entries.end()) return 0;
+  if ((*it).second.mtime != mtime || (*it).second.size != size) return 0;
+  (*it).second.used = true;
+  return &(*it).second;
+}
+
+vsx_module_list_cache_entry* vsx_module_list_cache::add(const vsx_string& plugin_file_name, long long mtime, long long size)
+{
+  vsx_module_list_cache_entry& entry = entries[plugin_file_name];
+  entry.mtime = mtime;
+  entry.size = size;
+  entry.modules.clear();
+  entry.used = true;
+  changed = true;
+  return &entry;
+}
@@ -0,0 +1,102 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef VSX_MODULE_LIST_CACHE_H
+#define VSX_MODULE_LIST_CACHE_H
+
+#include <map>
+#include <vector>
+#include <vsx_string.h>
+#include <vsx_param.h>
+#include <vsx_module.h>
+
+// On-disk registry of what the plugins contain, so the module list doesn't
+// have to dlopen every plugin and create / destroy every module in it just
+// to read the module infos on every start.
+//
+// One entry per plugin file, valid as long as the file has the same size and
+// modification time and the engine writing the cache was the same version
+// (vsxu_ver + the size of vsx_module_info + pointer size). Only the modules
+// that could run when the plugin was probed are stored. Plugins exporting
+// set_environment_info aren't stored at all, their modules can depend on
+// files in plugin-config.
+//
+// The default file is module_cache in the data path (~/.local/share/vsxu/
+// <version>/data/), VSXU_MODULE_CACHE overrides it, set to 0 it turns the
+// cache off.
+
+class vsx_module_list_cache_module
+{
+public:
+  unsigned long module_id;
+  // identifier is the full one, with all its || aliases
+  vsx_module_info info;
+};
+
+class vsx_module_list_cache_entry
+{
+public:
+  long long mtime;
+  long long size;
+  std::vector<vsx_module_list_cache_module> modules;
+  // set when this init looked it up or probed it, entries that aren't used
+  // (removed plugins) aren't saved again
+  bool used;
+
+  vsx_module_list_cache_entry()
+  :
+    mtime(0),
+    size(0),
+    used(false)
+  {}
+};
+
+class vsx_module_list_cache
+{
+  vsx_string file_name;
+  std::map<vsx_string, vsx_module_list_cache_entry> entries;
+  bool changed;
+
+public:
+  vsx_module_list_cache();
+
+  // false if the cache is turned off
+  bool enabled();
+
+  // reads the file, a missing / broken / old one just leaves the cache empty
+  void load();
+
+  // rewrites the file if anything was added or any plugin went away
+  void save();
+
+  // size and modification time of a file, false if it can't be stat'ed
+  static bool stat_file(const vsx_string& file_name, long long& mtime, long long& size);
+
+  // entry for a plugin, 0 if it's not there or the file changed
+  vsx_module_list_cache_entry* find(const vsx_string& plugin_file_name, long long mtime, long long size);
+
+  // new (empty) entry for a plugin that was just probed, replaces an old one
+  vsx_module_list_cache_entry* add(const vsx_string& plugin_file_name, long long mtime, long long size);
+};
+
+#endif
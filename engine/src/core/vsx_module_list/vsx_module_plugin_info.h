@@ -27,15 +27,35 @@
 
 #include <vsx_platform.h>
 
-typedef struct {
-  vsx_dynamic_object_handle plugin_handle;
-  int module_id;
-  bool hidden_from_gui;
-  vsx_module_info* module_info;
+// A plugin file. When the module infos come from the module cache it isn't
+// opened until one of its modules is created the first time.
+class vsx_module_list_plugin
+{
+public:
+  vsx_string file_name;
+  // 0 until opened
+  vsx_dynamic_object_handle handle;
+  // don't try again
+  bool load_failed;
 
   // cached function to module's constructor/destructor
   vsx_module*(*create_new_module)( unsigned long, void* );
   void(*destroy_module)( vsx_module*, unsigned long );
+
+  vsx_module_list_plugin()
+  :
+    handle(0),
+    load_failed(false),
+    create_new_module(0),
+    destroy_module(0)
+  {}
+};
+
+typedef struct {
+  vsx_module_list_plugin* plugin;
+  int module_id;
+  bool hidden_from_gui;
+  vsx_module_info* module_info;
 } vsx_module_plugin_info;
 
 #endif /*VSX_MODULE_PLUGIN_INFO_H_*/
@@ -39,6 +39,7 @@ class vsx_engine_param_list;
 
 vsx_engine_param::vsx_engine_param() {
   sequence = false;
+  interpolation_slot = -1;
   external_expose = 0;
   alias = false;
   alias_parent = 0;
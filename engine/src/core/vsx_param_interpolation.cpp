@@ -23,288 +23,230 @@
 
 #ifndef VSX_NO_CLIENT
 #include <list>
+#include <math.h>
 #include "vsx_param.h"
 #include "vsx_module.h"
 #include "vsx_command.h"
 #include "vsx_param_interpolation.h"
-#include "vsx_quaternion.h"
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
 
-// --- FLOAT3
-bool vsx_module_param_interpolation_float3::set(vsx_module_param_abs* value, int arity, float interpolation_time) {
-  VSX_UNUSED(arity);
-  dest_interp = interpolation_time;
-  for(int i = 0; i < 3; ++i)
-  destination_value[i] = ((vsx_module_param_float*)value)->get_internal(i);
-  return true;
-}
+// the spring is critically damped with omega = speed * this
+#define VSX_PARAM_INTERPOLATION_DAMPING 2.0f
 
-bool vsx_module_param_interpolation_float3::set(vsx_string value, int arity, float interpolation_time) {
-  dest_interp = interpolation_time;
-  destination_value[arity] = s2f(value);
-  return true;
-}
+// how close is close enough, once there the parameter is set to its
+// destination and dropped from the list
+#define VSX_PARAM_INTERPOLATION_EPSILON 0.00001f
 
-bool vsx_module_param_interpolation_float3::interpolate(float dtime) {
-  float tt = dtime*dest_interp;
-  if (tt > 1.0f) tt = 1.0f;
-  int done = 0;
-  for(int i = 0; i < 3; ++i) {
-    temp = ((vsx_module_param_float3*)target_param)->get_internal(i)*(1-tt)+destination_value[i]*tt;
-    ((vsx_module_param_float3*)target_param)->set_internal(temp,i);
-    // know where to stop :)
-    if (fabs(destination_value[i] - temp) < 0.000001) ++done;
+int vsx_module_param_interpolation_list::get_lanes(vsx_engine_param* parameter) {
+  switch (parameter->module_param->type) {
+    case VSX_MODULE_PARAM_ID_FLOAT: return 1;
+    case VSX_MODULE_PARAM_ID_FLOAT3: return 3;
+    case VSX_MODULE_PARAM_ID_FLOAT4: return 4;
+    case VSX_MODULE_PARAM_ID_QUATERNION: return 4;
   }
-  if (done == 3) return false;
-  else
-  return true;
-}
-
-// --- FLOAT4
-bool vsx_module_param_interpolation_float4::set(vsx_module_param_abs* value, int arity, float interpolation_time) {
-  VSX_UNUSED(arity);
-  dest_interp = interpolation_time;
-  for(int i = 0; i < 4; ++i)
-  destination_value[i] = ((vsx_module_param_float*)value)->get_internal(i);
-  return true;
-}
-
-bool vsx_module_param_interpolation_float4::set(vsx_string value, int arity, float interpolation_time) {
-  dest_interp = interpolation_time;
-  destination_value[arity] = s2f(value);
-  return true;
+  return 0;
 }
 
-bool vsx_module_param_interpolation_float4::interpolate(float dtime) {
-  float tt = dtime*dest_interp;
-  if (tt > 1) tt = 1;
-  int done = 0;
-  for(int i = 0; i < 4; ++i) {
-    temp = ((vsx_module_param_float3*)target_param)->get_internal(i)*(1-tt)+destination_value[i]*tt;
-    ((vsx_module_param_float3*)target_param)->set_internal(temp,i);
-    // know where to stop :)
-    if (fabs(destination_value[i] - temp) < 0.000001) ++done;
+template<class T>
+static void write_lanes(vsx_module_param_abs* param, const float* lanes, int count) {
+  for (int i = 0; i < count; ++i)
+    ((T*)param)->set_internal(lanes[i], i);
+}
+
+template<class T>
+static void read_lanes(vsx_module_param_abs* param, float* lanes, int count) {
+  for (int i = 0; i < count; ++i)
+    lanes[i] = ((T*)param)->get_internal(i);
+}
+
+void vsx_module_param_interpolation_list::write(size_t slot) {
+  vsx_module_param_abs* param = params[slot]->module_param;
+  float* lanes = &value[slot * 4];
+  switch (param->type) {
+    case VSX_MODULE_PARAM_ID_FLOAT:
+      write_lanes<vsx_module_param_float>(param, lanes, 1);
+      break;
+    case VSX_MODULE_PARAM_ID_FLOAT3:
+      write_lanes<vsx_module_param_float3>(param, lanes, 3);
+      break;
+    case VSX_MODULE_PARAM_ID_FLOAT4:
+      write_lanes<vsx_module_param_float4>(param, lanes, 4);
+      break;
+    case VSX_MODULE_PARAM_ID_QUATERNION:
+    {
+      // the spring runs on the components, the parameter gets a unit quaternion
+      float len = sqrtf(lanes[0] * lanes[0] + lanes[1] * lanes[1] + lanes[2] * lanes[2] + lanes[3] * lanes[3]);
+      float q[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+      if (len > 0.0f)
+        for (int i = 0; i < 4; ++i) q[i] = lanes[i] / len;
+      write_lanes<vsx_module_param_quaternion>(param, q, 4);
+    }
+    break;
   }
-  if (done == 4) return false;
-  else
-  return true;
-}
-
-
-// --- QUATERNION
-bool vsx_module_param_interpolation_quaternion::set(vsx_module_param_abs* value, int arity, float interpolation_time) {
-  VSX_UNUSED(arity);
-  dest_interp = interpolation_time;
-  for(int i = 0; i < 4; ++i)
-  destination_value[i] = ((vsx_module_param_float*)value)->get_internal(i);
-  return true;
-}
-
-bool vsx_module_param_interpolation_quaternion::set(vsx_string value, int arity, float interpolation_time) {
-  VSX_UNUSED(arity);
-  dest_interp = interpolation_time;
-  destination_value[arity] = s2f(value);
-  return true;
-}
-
-bool vsx_module_param_interpolation_quaternion::interpolate(float dtime) {
-  //printf("running quat-interpolation\n");
-  float tt = dtime * dest_interp;
-  if (tt > 1) tt = 1;
-  int done = 0;
-  vsx_quaternion from_quat;
-  from_quat.x = ((vsx_module_param_quaternion*)target_param)->get_internal(0);
-  from_quat.y = ((vsx_module_param_quaternion*)target_param)->get_internal(1);
-  from_quat.z = ((vsx_module_param_quaternion*)target_param)->get_internal(2);
-  from_quat.w = ((vsx_module_param_quaternion*)target_param)->get_internal(3);
-  vsx_quaternion dest_quat;
-  //printf("destination value 0: %f\n",destination_value[0]);
-  dest_quat.x = destination_value[0];
-  dest_quat.y = destination_value[1];
-  dest_quat.z = destination_value[2];
-  dest_quat.w = destination_value[3];
-  vsx_quaternion result_quat;
-  result_quat.slerp(from_quat,dest_quat,tt);
-  
-  float len = 1.0 / (float)sqrt(
-    result_quat.x*result_quat.x +
-    result_quat.y*result_quat.y +
-    result_quat.z*result_quat.z +
-    result_quat.w*result_quat.w
-  );
-  result_quat.x *= len;
-  result_quat.y *= len;
-  result_quat.z *= len;
-  result_quat.w *= len;
-
-  
-  ((vsx_module_param_quaternion*)target_param)->set_internal(result_quat.x,0);
-  if (fabs(result_quat.x - from_quat.x) < 0.000001) ++done;
-  ((vsx_module_param_quaternion*)target_param)->set_internal(result_quat.y,1);
-  if (fabs(result_quat.y - from_quat.y) < 0.000001) ++done;
-  ((vsx_module_param_quaternion*)target_param)->set_internal(result_quat.z,2);
-  if (fabs(result_quat.z - from_quat.z) < 0.000001) ++done;
-  ((vsx_module_param_quaternion*)target_param)->set_internal(result_quat.w,3);
-  if (fabs(result_quat.w - from_quat.w) < 0.000001) ++done;
-  
-
-  //for(int i = 0; i < 4; ++i) {
-    //// know where to stop :)
-    //if (fabs(destination_value[i])-temp < 0.000001) ++done;
-  //}
-  if (done == 4) return false;
-  else
-  return true;
-}
-
-
-// --- FLOAT
-bool vsx_module_param_interpolation_float::set(vsx_module_param_abs* value, int arity, float interpolation_time) {
-  VSX_UNUSED(arity);
-  iterations = 0;
-  dest_interp = interpolation_time;
-  destination_value = ((vsx_module_param_float*)value)->get_internal();
-  return true;
-}
-
-bool vsx_module_param_interpolation_float::set(vsx_string value, int arity, float interpolation_time) {
-  VSX_UNUSED(arity);
-  iterations = 0;
-  dest_interp = interpolation_time;
-  destination_value = s2f(value);
-  return true;
-}
-
-bool vsx_module_param_interpolation_float::interpolate(float dtime) {
-  //float tt = dtime*16;
-  double tt = dtime*dest_interp;
-  if (tt > 1.0) tt = 1.0;
-  temp = ((vsx_module_param_float*)target_param)->get_internal()*(1.0-tt)+(double)destination_value*tt;
-  //printf("temp: %f\n",temp);
-  ((vsx_module_param_float*)target_param)->set_internal(temp);
-  //printf("dv:   %f       t:   %f\n",destination_value,temp);
-  if (++iterations > 5000) return false;
-  if (fabs(destination_value - temp) < 0.00001f) return false; 
-  else
-  return true;
 }
 
 //------------------------
-vsx_module_param_interpolation_abs* vsx_module_param_interpolation_list::add(vsx_engine_param* parameter) {
-  vsx_module_param_interpolation_abs* t = 0;
-
-  //float type
-  if (parameter->module_param->type == VSX_MODULE_PARAM_ID_FLOAT) {
-    if (listeners_map.find(parameter) == listeners_map.end()) {
-      t = new vsx_module_param_interpolation_float(parameter->module_param);
-      t->t_engine_param = parameter;
-      t->module = parameter->module;
-      listeners_map[parameter] = t;
-      listeners.push_back(t);
-      return t;
-    } else {
-      return listeners_map[parameter];
-    }  
-  }
-  else
-  //float3 type
-  if (parameter->module_param->type == VSX_MODULE_PARAM_ID_FLOAT3) {
-    if (listeners_map.find(parameter) == listeners_map.end()) {
-      t = new vsx_module_param_interpolation_float3(parameter->module_param);
-      t->t_engine_param = parameter;
-      t->module = parameter->module;
-      listeners_map[parameter] = t;      
-      listeners.push_back(t);
-      return t;
-    } else {
-      return listeners_map[parameter];
-    }  
-  }
-  else
-  //float4 type
-  if (parameter->module_param->type == VSX_MODULE_PARAM_ID_FLOAT4) {
-    if (listeners_map.find(parameter) == listeners_map.end()) {
-      t = new vsx_module_param_interpolation_float4(parameter->module_param);
-      t->t_engine_param = parameter;
-      t->module = parameter->module;
-      listeners_map[parameter] = t;
-      listeners.push_back(t);
-      return t;
-    } else {
-      return listeners_map[parameter];
-    }  
-  }
-  else
-  //quaternion type
-  if (parameter->module_param->type == VSX_MODULE_PARAM_ID_QUATERNION) {
-    if (listeners_map.find(parameter) == listeners_map.end()) {
-      t = new vsx_module_param_interpolation_quaternion(parameter->module_param);
-      t->t_engine_param = parameter;
-      t->module = parameter->module;
-      listeners_map[parameter] = t;
-      listeners.push_back(t);
-      return t;
-    } else {
-      return listeners_map[parameter];
-    }  
+int vsx_module_param_interpolation_list::add(vsx_engine_param* parameter) {
+  if (parameter->interpolation_slot >= 0)
+    return parameter->interpolation_slot;
+
+  int lanes = get_lanes(parameter);
+  if (!lanes) return -1;
+
+  size_t slot = params.size();
+  params.push_back(parameter);
+  parameter->interpolation_slot = (int)slot;
+  for (int i = 0; i < 4; ++i) {
+    value.push_back(0.0f);
+    velocity.push_back(0.0f);
+    destination.push_back(0.0f);
+    omega.push_back(0.0f);
+    decay.push_back(1.0f);
   }
 
-  return 0;
-};
+  // start from where the parameter is, components that aren't set keep their value
+  float* v = &value[slot * 4];
+  vsx_module_param_abs* param = parameter->module_param;
+  switch (param->type) {
+    case VSX_MODULE_PARAM_ID_FLOAT: read_lanes<vsx_module_param_float>(param, v, 1); break;
+    case VSX_MODULE_PARAM_ID_FLOAT3: read_lanes<vsx_module_param_float3>(param, v, 3); break;
+    case VSX_MODULE_PARAM_ID_FLOAT4: read_lanes<vsx_module_param_float4>(param, v, 4); break;
+    case VSX_MODULE_PARAM_ID_QUATERNION: read_lanes<vsx_module_param_quaternion>(param, v, 4); break;
+  }
+  for (int i = 0; i < 4; ++i)
+    destination[slot * 4 + i] = v[i];
+  return (int)slot;
+}
 
 bool vsx_module_param_interpolation_list::remove(vsx_engine_param* parameter) {
-  if (listeners_map.find(parameter) != listeners_map.end()) {
-//    printf("removing parameter\n");
-    listeners.remove(listeners_map[parameter]);
-    listeners_map.erase(parameter);
+  if (parameter->interpolation_slot < 0) return true;
+  size_t slot = (size_t)parameter->interpolation_slot;
+  size_t last = params.size() - 1;
+  parameter->interpolation_slot = -1;
+  // move the last one into the hole
+  if (slot != last) {
+    params[slot] = params[last];
+    params[slot]->interpolation_slot = (int)slot;
+    for (int i = 0; i < 4; ++i) {
+      value[slot * 4 + i] = value[last * 4 + i];
+      velocity[slot * 4 + i] = velocity[last * 4 + i];
+      destination[slot * 4 + i] = destination[last * 4 + i];
+      omega[slot * 4 + i] = omega[last * 4 + i];
+    }
   }
+  params.pop_back();
+  value.resize(last * 4);
+  velocity.resize(last * 4);
+  destination.resize(last * 4);
+  omega.resize(last * 4);
+  decay.resize(last * 4);
   return true;
 }
 
 bool vsx_module_param_interpolation_list::schedule_remove(vsx_engine_param* parameter) {
-  if (listeners_map.find(parameter) != listeners_map.end()) {
+  if (parameter->interpolation_slot >= 0) {
     remove_list.push_back(parameter);
-    //listeners.remove(listeners_map[parameter]);
-    //listeners_map.erase(parameter);
   }
   return true;
 }
 
-/*void vsx_module_param_interpolation_list::set_target_value(vsx_engine_param* target, vsx_engine_param* value, int arity,float interpolation_time) {
-  if (listeners_map.find(target) != listeners_map.end()) {
-    listeners_map[target]->set(value->module_param,arity,interpolation_time);
-  } else {
-    vsx_module_param_interpolation_abs* new_interpolation = add(target);
-    if (new_interpolation)
-    new_interpolation->set(value,arity,interpolation_time);
-  }
-}*/
-
 void vsx_module_param_interpolation_list::set_target_value(vsx_engine_param* target, vsx_string value, int arity,float interpolation_time) {
-  if (listeners_map.find(target) != listeners_map.end()) {
-    listeners_map[target]->set(value,arity,interpolation_time);
-  } else {
-    vsx_module_param_interpolation_abs* new_interpolation = add(target);
-    if (new_interpolation)
-    new_interpolation->set(value,arity,interpolation_time);
-  }
+  int slot = add(target);
+  if (slot < 0) return;
+  if (arity < 0 || arity >= get_lanes(target)) return;
+  destination[slot * 4 + arity] = s2f(value);
+  // one speed for the whole parameter, the last one given
+  float w = interpolation_time * VSX_PARAM_INTERPOLATION_DAMPING;
+  if (w < 0.0f) w = 0.0f;
+  for (int i = 0; i < 4; ++i)
+    omega[slot * 4 + i] = w;
 }
+
+size_t vsx_module_param_interpolation_list::size() {
+  return params.size();
+}
+
 //
 void vsx_module_param_interpolation_list::run(float d_time) {
-  //printf("run\n");
   for (std::list<vsx_engine_param*>::iterator it_r = remove_list.begin(); it_r != remove_list.end(); it_r++) {
-    //printf("removing interpolator\n");
     remove(*it_r);
   }
   remove_list.clear();
-  for (std::list<vsx_module_param_interpolation_abs*>::iterator it = listeners.begin(); it != listeners.end(); it++) {
-    //printf("running interpolator\n");
-    if ((*it)->interpolate(d_time)) {
-      ++(*it)->module->param_updates;
-      ++(*it)->target_param->updates;
-    } else {
-      remove_list.push_back((*it)->t_engine_param);
-      //delete *it;
-    }  
+  if (!params.size()) return;
+  if (d_time < 0.0f) d_time = 0.0f;
+
+  size_t num_params = params.size();
+  for (size_t slot = 0; slot < num_params; ++slot) {
+    float* d = &destination[slot * 4];
+    // take the short way round, -q is the same rotation as q
+    if (params[slot]->module_param->type == VSX_MODULE_PARAM_ID_QUATERNION) {
+      float* v = &value[slot * 4];
+      if (v[0] * d[0] + v[1] * d[1] + v[2] * d[2] + v[3] * d[3] < 0.0f)
+        for (int i = 0; i < 4; ++i) d[i] = -d[i];
+    }
+    float e = expf(-omega[slot * 4] * d_time);
+    for (int i = 0; i < 4; ++i)
+      decay[slot * 4 + i] = e;
+  }
+
+  // exact step of x'' = -2w x' - w^2 (x - d) over d_time, for every lane:
+  //   t = (v + w (x - d)) dt
+  //   v = (v - w t) e
+  //   x = d + (x - d + t) e
+  // with e = exp(-w dt)
+  size_t num_lanes = num_params * 4;
+  float* x = &value[0];
+  float* v = &velocity[0];
+  float* d = &destination[0];
+  float* w = &omega[0];
+  float* e = &decay[0];
+#ifdef __SSE2__
+  __m128 dt = _mm_set1_ps(d_time);
+  for (size_t i = 0; i < num_lanes; i += 4) {
+    __m128 xi = _mm_loadu_ps(x + i);
+    __m128 vi = _mm_loadu_ps(v + i);
+    __m128 di = _mm_loadu_ps(d + i);
+    __m128 wi = _mm_loadu_ps(w + i);
+    __m128 ei = _mm_loadu_ps(e + i);
+    __m128 delta = _mm_sub_ps(xi, di);
+    __m128 t = _mm_mul_ps(_mm_add_ps(vi, _mm_mul_ps(wi, delta)), dt);
+    _mm_storeu_ps(v + i, _mm_mul_ps(_mm_sub_ps(vi, _mm_mul_ps(wi, t)), ei));
+    _mm_storeu_ps(x + i, _mm_add_ps(di, _mm_mul_ps(_mm_add_ps(delta, t), ei)));
+  }
+#else
+  for (size_t i = 0; i < num_lanes; ++i) {
+    float delta = x[i] - d[i];
+    float t = (v[i] + w[i] * delta) * d_time;
+    v[i] = (v[i] - w[i] * t) * e[i];
+    x[i] = d[i] + (delta + t) * e[i];
+  }
+#endif
+
+  // backwards so removing (moving the last one in) doesn't skip any
+  for (size_t slot = num_params; slot-- > 0;) {
+    vsx_engine_param* parameter = params[slot];
+    bool done = true;
+    for (int i = 0; i < 4; ++i) {
+      size_t lane = slot * 4 + i;
+      // near enough and too slow to get further away than that
+      if
+      (
+        fabs(destination[lane] - value[lane]) >= VSX_PARAM_INTERPOLATION_EPSILON ||
+        fabs(velocity[lane]) >= VSX_PARAM_INTERPOLATION_EPSILON * (omega[lane] + 1.0f)
+      )
+      done = false;
+    }
+    if (done) {
+      for (int i = 0; i < 4; ++i)
+        value[slot * 4 + i] = destination[slot * 4 + i];
+    }
+    write(slot);
+    ++parameter->module->param_updates;
+    ++parameter->module_param->updates;
+    if (done)
+      remove(parameter);
   }
 }
 
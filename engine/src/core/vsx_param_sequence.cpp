@@ -126,6 +126,21 @@ void vsx_param_sequence::execute(float ptime, float blend)
     }
   }
   //printf("line_cur: %d  cur_val: %s to_val: %s line_time: %f curdel: \n",line_cur, cur_val.c_str(),to_val.c_str(),line_time,cur_delay);
+
+  // strings and resources (file names) can't be interpolated, they step
+  // from row to row
+  if
+  (
+    param->module_param->type == VSX_MODULE_PARAM_ID_RESOURCE
+    ||
+    param->module_param->type == VSX_MODULE_PARAM_ID_STRING
+  )
+  {
+    if (cur_val != param->get_string())
+      param->set_string(cur_val);
+    return;
+  }
+
   if (to_val.size() && cur_val.size())
   {
     float t = (line_time/cur_delay);
@@ -269,6 +284,40 @@ float vsx_param_sequence::calculate_total_time(bool no_cache)
   return total_time;
 }
 
+float vsx_param_sequence::get_position()
+{
+  float position = line_time;
+  for (int i = 0; i < line_cur && i < (int)items.size(); i++)
+    position += items[i].total_length;
+  return position;
+}
+
+void vsx_param_sequence::prefetch(float from, float to)
+{
+  if (param->module_param->type != VSX_MODULE_PARAM_ID_RESOURCE) return;
+  if (!param->module) return;
+  float start = 0.0f;
+  for (size_t i = 0; i < items.size() && start <= to; i++)
+  {
+    if (start > from)
+      param->module->prefetch(param->name, items[i].value);
+    start += items[i].total_length;
+  }
+}
+
+void vsx_param_sequence::prefetch_ahead(float horizon)
+{
+  if (param->module_param->type != VSX_MODULE_PARAM_ID_RESOURCE) return;
+  float position = get_position();
+  float from = prefetch_end;
+  // first time, or the time jumped (rewind, seek, a long frame): everything
+  // within the horizon again
+  if (from < position || from > position + horizon)
+    from = position;
+  prefetch(from, position + horizon);
+  prefetch_end = position + horizon;
+}
+
 vsx_string vsx_param_sequence::dump()
 {
   vsx_string res = "";
@@ -286,6 +335,7 @@ vsx_string vsx_param_sequence::dump()
 void vsx_param_sequence::inject(vsx_string ij)
 {
 	total_time = 0.0f; // reset total time for re-calculation
+  prefetch_end = -1.0f;
   items.clear();
   vsx_string deli = "|";
   std::list<vsx_string> pl;
@@ -324,6 +374,7 @@ vsx_param_sequence::vsx_param_sequence(int p_type,vsx_engine_param* param)
   line_cur = 0;
   p_time = 0;
   cur_delay = 0.0f;
+  prefetch_end = -1.0f;
   vsx_param_sequence_item pa;
   pa.total_length = 3;
 
@@ -345,6 +396,15 @@ vsx_param_sequence::vsx_param_sequence(int p_type,vsx_engine_param* param)
       items.push_back(pa);
     }
     break;
+    case VSX_MODULE_PARAM_ID_STRING:
+    case VSX_MODULE_PARAM_ID_RESOURCE:
+    {
+      pa.interpolation = 0;
+      pa.value = param->get_string();
+      items.push_back(pa);
+      items.push_back(pa);
+    }
+    break;
   }
 }
 
@@ -386,6 +446,7 @@ vsx_param_sequence::vsx_param_sequence()
   p_time = 0;
 	total_time = 0.0f;
   cur_delay = 0.0f;
+  prefetch_end = -1.0f;
 }
 
 void vsx_param_sequence::update_line(vsx_command_list* dest, vsx_command_s* cmd_in, vsx_string cmd_prefix)
@@ -281,6 +281,27 @@ void vsx_param_sequence_list::run_absolute(float vtime, float blend)
   }
 }
 
+void vsx_param_sequence_list::prefetch(float horizon)
+{
+  for (std::list<vsx_param_sequence*>::iterator it = parameter_channel_list.begin(); it != parameter_channel_list.end(); ++it)
+  {
+    (*it)->prefetch_ahead(horizon);
+  }
+
+  for (std::list<void*>::iterator it = master_channel_list.begin(); it != master_channel_list.end(); it++)
+  {
+    ((vsx_master_sequence_channel*)(*it))->prefetch(horizon);
+  }
+}
+
+void vsx_param_sequence_list::prefetch_range(float from, float to)
+{
+  for (std::list<vsx_param_sequence*>::iterator it = parameter_channel_list.begin(); it != parameter_channel_list.end(); ++it)
+  {
+    (*it)->prefetch(from, to);
+  }
+}
+
 vsx_string vsx_param_sequence_list::dump_param(vsx_engine_param* param) {
   if (parameter_channel_map.find(param) != parameter_channel_map.end())
   return parameter_channel_map[param]->dump();
@@ -0,0 +1,117 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+
+#include "vsx_engine.h"
+#include "vsx_param_telemetry.h"
+
+vsx_param_telemetry::vsx_param_telemetry()
+:
+  interval(1.0 / VSX_PARAM_TELEMETRY_RATE),
+  last_sample(0.0)
+{
+  timer.start();
+}
+
+void vsx_param_telemetry::watch(int id, vsx_string component, vsx_string param, int io)
+{
+  vsx_param_telemetry_watch& w = watches[id];
+  if (w.component != component || w.param != param || w.io != io)
+  {
+    // new, or the widget now shows something else
+    w.component = component;
+    w.param = param;
+    w.io = io;
+    w.value = "";
+    w.sent = false;
+  }
+  w.expires = timer.atime() + VSX_PARAM_TELEMETRY_TIMEOUT;
+}
+
+void vsx_param_telemetry::unwatch(int id)
+{
+  watches.erase(id);
+}
+
+void vsx_param_telemetry::clear()
+{
+  watches.clear();
+}
+
+void vsx_param_telemetry::set_rate(float rate)
+{
+  if (rate < 1.0f) rate = 1.0f;
+  if (rate > 100.0f) rate = 100.0f;
+  interval = 1.0 / rate;
+}
+
+size_t vsx_param_telemetry::size()
+{
+  return watches.size();
+}
+
+void vsx_param_telemetry::sample(vsx_engine_abs* engine, vsx_command_list* cmd_out)
+{
+  if (!watches.size()) return;
+  double now = timer.atime();
+  if (now - last_sample < interval) return;
+  last_sample = now;
+
+  vsx_string values;
+  std::map<int, vsx_param_telemetry_watch>::iterator it = watches.begin();
+  while (it != watches.end())
+  {
+    vsx_param_telemetry_watch& w = (*it).second;
+    if (w.expires < now)
+    {
+      watches.erase(it++);
+      continue;
+    }
+    // looked up by name every time, components come and go between samples
+    vsx_comp* comp = engine->get_component_by_name(w.component);
+    vsx_engine_param* param = 0;
+    if (comp)
+    {
+      if (w.io == -1)
+        param = comp->get_params_in()->get_by_name(w.param);
+      else
+        param = comp->get_params_out()->get_by_name(w.param);
+    }
+    if (param)
+    {
+      vsx_string value = param->get_string();
+      if (value.size() > VSX_PARAM_TELEMETRY_VALUE_LENGTH)
+        value = value.substr(0, VSX_PARAM_TELEMETRY_VALUE_LENGTH)+"...";
+      if (value.size() && (!w.sent || value != w.value))
+      {
+        if (values.size()) values += ",";
+        values += i2s((*it).first)+":"+base64_encode(value);
+        w.value = value;
+        w.sent = true;
+      }
+    }
+    ++it;
+  }
+  if (values.size())
+    cmd_out->add_raw("param_values "+values);
+}
@@ -145,6 +145,13 @@ void vsx_sequence_pool::run(float dtime, bool run_from_channel)
   }
 }
 
+void vsx_sequence_pool::prefetch(float horizon)
+{
+  if (edit_enabled && cur_sequence_list)
+  {
+    cur_sequence_list->prefetch(horizon);
+  }
+}
 
 int vsx_sequence_pool::get_state()
 {
@@ -1,33 +1,353 @@
-#include "vsx_string.h"
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <pthread.h>
 #include <vsx_platform.h>
 #if PLATFORM_FAMILY == PLATFORM_FAMILY_WINDOWS
-    #include <io.h>
+  #include <windows.h>
 #else
-  // unix or other
-  #include <syslog.h>
+  #include <unistd.h>
 #endif
+#include "vsx_string.h"
+#include "vsx_timer.h"
 #include "vsx_log.h"
 
-int log_level = 1;
-vsx_string log_dir;
-int first = 1; 
+#if defined(_MSC_VER)
+  #define VSX_LOG_NEXT_SEQUENCE(p) (_InterlockedIncrement(p) - 1)
+  #define VSX_LOG_BARRIER() MemoryBarrier()
+#else
+  #define VSX_LOG_NEXT_SEQUENCE(p) __sync_fetch_and_add(p, 1)
+  #define VSX_LOG_BARRIER() __sync_synchronize()
+#endif
+
+// how often the writer looks at the rings, in ms
+#define VSX_LOG_WRITER_INTERVAL 20
+
+static int get_initial_log_level()
+{
+  const char* env = getenv("VSXU_LOG_LEVEL");
+  if (env) return atoi(env);
+  return VSX_LOG_INFO;
+}
+
+int log_level = get_initial_log_level();
+
+class vsx_log_entry
+{
+public:
+  long sequence;
+  int level;
+  double time;
+  char message[VSX_LOG_MESSAGE_SIZE];
+};
+
+// one per logging thread, the thread only moves head, the writer only tail
+class vsx_log_ring
+{
+public:
+  vsx_log_entry entries[VSX_LOG_RING_SIZE];
+  volatile unsigned long head;
+  volatile unsigned long tail;
+  volatile unsigned long dropped;
+  unsigned long dropped_reported;
+  // the thread is gone, the writer deletes the ring when it's empty
+  volatile int orphaned;
+
+  vsx_log_ring()
+  :
+    head(0),
+    tail(0),
+    dropped(0),
+    dropped_reported(0),
+    orphaned(0)
+  {}
+};
+
+static pthread_once_t log_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+// held by the writer while it writes, guards rings and file
+static pthread_mutex_t write_mutex;
+static std::vector<vsx_log_ring*> rings;
+static volatile long next_sequence = 0;
+static volatile int stopping = 0;
+static FILE* file = 0;
+// guarded by write_mutex, file_path is where file was opened
+static vsx_string log_dir;
+static vsx_string file_path;
+static vsx_timer timer;
+static double start_time;
+
+static bool entry_before(const vsx_log_entry* a, const vsx_log_entry* b)
+{
+  return a->sequence < b->sequence;
+}
+
+static const char* level_name(int level)
+{
+  switch (level)
+  {
+    case VSX_LOG_ERROR: return "error";
+    case VSX_LOG_INFO: return "info";
+    case VSX_LOG_DEBUG: return "debug";
+  }
+  return "trace";
+}
+
+// moves whatever the rings hold to the file, write_mutex must be held
+static void drain()
+{
+  static std::vector<const vsx_log_entry*> pending;
+  static std::vector<unsigned long> heads;
+  pending.clear();
+  heads.resize(rings.size());
+  for (size_t i = 0; i < rings.size(); i++)
+  {
+    vsx_log_ring* r = rings[i];
+    heads[i] = r->head;
+    // the entries up to head are complete
+    VSX_LOG_BARRIER();
+    for (unsigned long j = r->tail; j != heads[i]; j++)
+      pending.push_back(&r->entries[j % VSX_LOG_RING_SIZE]);
+  }
+
+  if (pending.size() && !file)
+  {
+    file_path = log_dir + "vsxu_engine.debug.log";
+    file = fopen(file_path.c_str(), "w");
+  }
+
+  // several threads, one timeline
+  std::sort(pending.begin(), pending.end(), entry_before);
+  for (size_t i = 0; i < pending.size(); i++)
+  {
+    const vsx_log_entry* e = pending[i];
+    if (file)
+      fprintf(file, "%10.4f %-5s %s\n", e->time, level_name(e->level), e->message);
+    if (e->level == VSX_LOG_ERROR || !file)
+      fprintf(stderr, "%s\n", e->message);
+  }
+
+  for (size_t i = 0; i < rings.size(); i++)
+  {
+    vsx_log_ring* r = rings[i];
+    unsigned long dropped = r->dropped;
+    if (dropped != r->dropped_reported)
+    {
+      if (file)
+        fprintf(file, "vsx_log: ring full, dropped %lu messages\n", dropped - r->dropped_reported);
+      r->dropped_reported = dropped;
+    }
+  }
+  if (file && pending.size())
+    fflush(file);
+
+  // done reading, the threads can have the slots back
+  VSX_LOG_BARRIER();
+  for (size_t i = 0; i < rings.size(); i++)
+    rings[i]->tail = heads[i];
+
+  size_t i = 0;
+  while (i < rings.size())
+  {
+    if (rings[i]->orphaned && rings[i]->tail == rings[i]->head)
+    {
+      delete rings[i];
+      rings.erase(rings.begin() + i);
+    }
+    else
+      i++;
+  }
+}
+
+static void* writer(void* arg)
+{
+  VSX_UNUSED(arg);
+  while (1)
+  {
+    pthread_mutex_lock(&write_mutex);
+    if (stopping)
+    {
+      pthread_mutex_unlock(&write_mutex);
+      break;
+    }
+    drain();
+    pthread_mutex_unlock(&write_mutex);
+    #if PLATFORM_FAMILY == PLATFORM_FAMILY_WINDOWS
+      Sleep(VSX_LOG_WRITER_INTERVAL);
+    #else
+      usleep(VSX_LOG_WRITER_INTERVAL * 1000);
+    #endif
+  }
+  return 0;
+}
+
+static void ring_orphan(void* ptr)
+{
+  ((vsx_log_ring*)ptr)->orphaned = 1;
+}
+
+// last words: write what's left and stop the writer. It isn't joined, this
+// can run while a dll is being unloaded, it just sees stopping and leaves.
+static void log_shutdown()
+{
+  pthread_mutex_lock(&write_mutex);
+  drain();
+  stopping = 1;
+  if (file)
+  {
+    fclose(file);
+    file = 0;
+  }
+  pthread_mutex_unlock(&write_mutex);
+}
+
+static void log_init()
+{
+  pthread_mutex_init(&write_mutex, NULL);
+  pthread_key_create(&ring_key, ring_orphan);
+  start_time = timer.atime();
+  pthread_t t;
+  if (pthread_create(&t, NULL, &writer, NULL) == 0)
+    pthread_detach(t);
+  atexit(log_shutdown);
+}
+
+static vsx_log_ring* get_ring()
+{
+  pthread_once(&log_once, log_init);
+  vsx_log_ring* r = (vsx_log_ring*)pthread_getspecific(ring_key);
+  if (r) return r;
+  // first message from this thread
+  r = new vsx_log_ring;
+  pthread_setspecific(ring_key, r);
+  pthread_mutex_lock(&write_mutex);
+  rings.push_back(r);
+  pthread_mutex_unlock(&write_mutex);
+  return r;
+}
+
+// a free slot in the thread's ring, 0 if the writer is behind
+static vsx_log_entry* begin_entry(vsx_log_ring* r, int level)
+{
+  if (r->head - r->tail >= VSX_LOG_RING_SIZE)
+  {
+    r->dropped = r->dropped + 1;
+    return 0;
+  }
+  vsx_log_entry* e = &r->entries[r->head % VSX_LOG_RING_SIZE];
+  e->level = level;
+  e->time = timer.atime() - start_time;
+  e->sequence = VSX_LOG_NEXT_SEQUENCE(&next_sequence);
+  return e;
+}
+
+static void end_entry(vsx_log_ring* r)
+{
+  // the entry has to be complete before the writer can see it
+  VSX_LOG_BARRIER();
+  r->head = r->head + 1;
+}
+
+// errors wait for room rather than being dropped
+static vsx_log_entry* begin_entry_wait(vsx_log_ring* r, int level)
+{
+  vsx_log_entry* e = begin_entry(r, level);
+  if (!e && level == VSX_LOG_ERROR)
+  {
+    vsx_log_flush();
+    e = begin_entry(r, level);
+  }
+  return e;
+}
+
+// an error may be the last thing this process does, don't leave it in
+// the ring
+static void finish_entry(vsx_log_ring* r, int level)
+{
+  end_entry(r);
+  if (level == VSX_LOG_ERROR)
+    vsx_log_flush();
+}
 
 void log(vsx_string message, int level)
 {
-	#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
-    openlog ("vsxu_engine", LOG_CONS | LOG_PID | LOG_NDELAY, LOG_LOCAL1);
-  	syslog(LOG_ERR,"%d: %s", level, message.c_str());
-	#else
-		if (log_level < level) return;
-    printf("%s\n",message.c_str());
-		FILE* fpo = 0;
-		if (first) {
-			fpo = fopen((log_dir+"vsxu_engine.debug.log").c_str(),"w");
-			first = 0;
-		} else
-			fpo = fopen((log_dir+"vsxu_engine.debug.log").c_str(),"a");
-		if (!fpo) return;
-		fprintf(fpo, "%s\n", message.c_str() );
-		fclose(fpo);	
-	#endif
+  if (log_level < level) return;
+  vsx_log_ring* r = get_ring();
+  vsx_log_entry* e = begin_entry_wait(r, level);
+  if (!e) return;
+  size_t length = message.size();
+  if (length > VSX_LOG_MESSAGE_SIZE - 1)
+    length = VSX_LOG_MESSAGE_SIZE - 1;
+  memcpy(e->message, message.c_str(), length);
+  e->message[length] = 0;
+  finish_entry(r, level);
+}
+
+void vsx_log_printf(int level, const char* format, ...)
+{
+  if (log_level < level) return;
+  vsx_log_ring* r = get_ring();
+  vsx_log_entry* e = begin_entry_wait(r, level);
+  if (!e) return;
+  va_list args;
+  va_start(args, format);
+  vsnprintf(e->message, VSX_LOG_MESSAGE_SIZE, format, args);
+  va_end(args);
+  e->message[VSX_LOG_MESSAGE_SIZE - 1] = 0;
+  finish_entry(r, level);
+}
+
+void vsx_log_flush()
+{
+  pthread_once(&log_once, log_init);
+  pthread_mutex_lock(&write_mutex);
+  drain();
+  pthread_mutex_unlock(&write_mutex);
+}
+
+void vsx_log_set_dir(const vsx_string& dir)
+{
+  pthread_once(&log_once, log_init);
+  pthread_mutex_lock(&write_mutex);
+  log_dir = dir;
+  vsx_string path = log_dir + "vsxu_engine.debug.log";
+  if (file && path != file_path)
+  {
+    // what was logged before the directory was known goes along
+    fclose(file);
+    file = 0;
+    if (rename(file_path.c_str(), path.c_str()) == 0)
+    {
+      file = fopen(path.c_str(), "a");
+      file_path = path;
+    }
+  }
+  pthread_mutex_unlock(&write_mutex);
 }
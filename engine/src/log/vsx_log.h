@@ -1,19 +1,87 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+
 #ifndef VSX_LOG_H_
 #define VSX_LOG_H_
 
-// logging
+#include "vsx_string.h"
+
+// Engine logging.
+//
+// Nothing is written in the calling thread: a message goes into a ring
+// buffer owned by that thread (no locks, a full ring drops the message and
+// counts it) and a background thread moves all rings, in the order the
+// messages were logged, to vsxu_engine.debug.log in the directory given to
+// vsx_log_set_dir (the working directory until then), which it keeps open.
+// Errors also go to stderr, and are in the file before log() returns so a
+// crash right after doesn't lose them.
+//
+// Levels above VSX_LOG_COMPILED_LEVEL are compiled out, the macros for them
+// expand to nothing that runs. Below that log_level decides at runtime
+// (VSXU_LOG_LEVEL in the environment, 1 by default), and the message
+// (string concatenations, printf formatting) is only built when it passes.
+//
+//   LOG("component deleting: "+name)          debug
+//   LOG3("Module missing in engine: "+name)   info
+//   LOG2(message, VSX_LOG_TRACE)
+//   LOGF(VSX_LOG_DEBUG, "%s took %f ms", name.c_str(), ms)
+
+#define VSX_LOG_ERROR 0
+#define VSX_LOG_INFO 1
+#define VSX_LOG_DEBUG 2
+#define VSX_LOG_TRACE 3
+
+#ifndef VSX_LOG_COMPILED_LEVEL
+  #ifdef VSXU_DEBUG
+    #define VSX_LOG_COMPILED_LEVEL VSX_LOG_TRACE
+  #else
+    #define VSX_LOG_COMPILED_LEVEL VSX_LOG_INFO
+  #endif
+#endif
+
+// longest message, longer ones are cut
+#define VSX_LOG_MESSAGE_SIZE 512
+// messages per thread waiting for the writer
+#define VSX_LOG_RING_SIZE 512
+
 extern int log_level;
-extern vsx_string log_dir;
-void log(vsx_string message, int level = 1);
 
+void log(vsx_string message, int level = VSX_LOG_INFO);
+void vsx_log_printf(int level, const char* format, ...);
+
+// returns when everything logged so far is in the file
+void vsx_log_flush();
 
-#define LOG(mess) 
-//log(mess);
-#define LOG2(mess, lvl) 
-//log(mess, lvl);
+// where vsxu_engine.debug.log goes, ends with a slash. A file already
+// opened somewhere else is moved there.
+void vsx_log_set_dir(const vsx_string& dir);
 
-#define LOG3(mess) log(mess);
+#define VSX_LOG_ENABLED(level) ((level) <= VSX_LOG_COMPILED_LEVEL && (level) <= log_level)
 
-  
+#define LOG(mess) { if (VSX_LOG_ENABLED(VSX_LOG_DEBUG)) log(mess, VSX_LOG_DEBUG); }
+#define LOG2(mess, lvl) { if (VSX_LOG_ENABLED(lvl)) log(mess, lvl); }
+#define LOG3(mess) { if (VSX_LOG_ENABLED(VSX_LOG_INFO)) log(mess, VSX_LOG_INFO); }
+#define LOGF(lvl, ...) { if (VSX_LOG_ENABLED(lvl)) vsx_log_printf(lvl, __VA_ARGS__); }
 
 #endif /*VSX_LOG_H_*/
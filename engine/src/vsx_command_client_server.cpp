@@ -29,8 +29,15 @@
 
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#ifdef __linux__
+  #include <sys/epoll.h>
+#else
+  #include <poll.h>
+#endif
 
+#include <map>
 #include <vsx_avector.h>
+#include <vsx_timer.h>
 #include <vsxfst.h>
 //#define TCP_NODELAY 1
 
@@ -46,6 +53,12 @@
 
 #define BUFLEN 256*1024
 
+// how long the workers wait for the socket before looking at the command
+// lists again, in milliseconds
+#define WAIT_MS 1
+// seconds without sending anything before a keepalive goes out
+#define KEEPALIVE_TIME 1.0
+
 
 // get sockaddr, IPv4 or IPv6:
 void *get_in_addr(struct sockaddr *sa)
@@ -57,9 +70,431 @@ void *get_in_addr(struct sockaddr *sa)
     return &(((struct sockaddr_in6*)sa)->sin6_addr);
 }
 
-vsx_command_list_server::vsx_command_list_server()
+// ****************************************************************************
+// ****************************************************************************
+// VSX_COMMAND_WIRE ***********************************************************
+// ****************************************************************************
+// ****************************************************************************
+
+// The commands going back and forth the most, sent as their index.
+// Both sides have to agree on this, only ever add at the end and bump the
+// version in VSX_COMMAND_WIRE_MAGIC when changing anything else.
+static const char* wire_opcodes[] =
 {
-  cmd_in = cmd_out = 0;
+  // to the engine
+  "param_set",
+  "param_set_interpolate",
+  "ps",
+  "ps64",
+  "pg64",
+  "param_get",
+  "param_set_default",
+  "param_connect",
+  "param_disconnect",
+  "param_alias",
+  "param_unalias",
+  "pflag",
+  "component_create",
+  "component_delete",
+  "component_pos",
+  "component_size",
+  "component_rename",
+  "component_clone",
+  "component_assign",
+  "component_timing",
+  "connections_order",
+  "pseq_p",
+  "pseq_r",
+  "pseq_l_dump",
+  "seq_pool",
+  "seq_list",
+  "mseq_channel",
+  "time_set",
+  "time_set_loop_point",
+  "play",
+  "stop",
+  "rewind",
+  "get_module_status",
+  "note_create",
+  "note_update",
+  "note_delete",
+  "meta_set",
+  "meta_get",
+  "undo_s",
+  "undo",
+  "fps",
+  "fps_d",
+  "dc",
+  // from the engine
+  "pg64_ok",
+  "param_get_ok",
+  "component_create_ok",
+  "component_pos_ok",
+  "component_size_ok",
+  "param_connect_ok",
+  "param_disconnect_ok",
+  "alert_fail",
+  "pseq_p_ok",
+  "pseq_r_ok",
+  "time_upd",
+  "fps_ok",
+  "fps_d_ok",
+  "component_timing_ok",
+  "module_operation_spec",
+  0
+};
+
+// name -> opcode, built once
+class vsx_command_wire_opcodes
+{
+public:
+  std::map<vsx_string, unsigned int> by_name;
+  unsigned int count;
+
+  vsx_command_wire_opcodes()
+  {
+    for (count = 0; wire_opcodes[count]; count++)
+      by_name[vsx_string(wire_opcodes[count])] = count;
+  }
+};
+
+static vsx_command_wire_opcodes& get_wire_opcodes()
+{
+  static vsx_command_wire_opcodes opcodes;
+  return opcodes;
+}
+
+// commands where only the last value for a parameter matters, as long as
+// nothing else comes in between
+static bool is_param_set(const std::vector<vsx_string>& parts)
+{
+  if (parts.size() < 4) return false;
+  const vsx_string& cmd = parts[0];
+  return
+    cmd == "param_set" ||
+    cmd == "param_set_interpolate" ||
+    cmd == "ps" ||
+    cmd == "ps64";
+}
+
+vsx_command_wire::vsx_command_wire()
+:
+  in_pos(0)
+{
+}
+
+void vsx_command_wire::write_u16(unsigned int v)
+{
+  out.push_back((char)(v & 0xff));
+  out.push_back((char)((v >> 8) & 0xff));
+}
+
+void vsx_command_wire::write_u32(unsigned int v)
+{
+  for (int i = 0; i < 4; i++)
+    out.push_back((char)((v >> (i * 8)) & 0xff));
+}
+
+void vsx_command_wire::write_string(const char* s, size_t size)
+{
+  write_u32((unsigned int)size);
+  out.insert(out.end(), s, s + size);
+}
+
+static unsigned int read_u16(const char* p)
+{
+  const unsigned char* u = (const unsigned char*)p;
+  return (unsigned int)u[0] | ((unsigned int)u[1] << 8);
+}
+
+static unsigned int read_u32(const char* p)
+{
+  const unsigned char* u = (const unsigned char*)p;
+  return (unsigned int)u[0] | ((unsigned int)u[1] << 8) | ((unsigned int)u[2] << 16) | ((unsigned int)u[3] << 24);
+}
+
+size_t vsx_command_wire::encode(vsx_command_list* list)
+{
+  std::vector< std::vector<vsx_string> > batch;
+  vsx_command_s* c;
+  while (list->pop(&c))
+  {
+    batch.push_back(std::vector<vsx_string>());
+    std::vector<vsx_string>& parts = batch.back();
+    if (c->parsed && c->parts.size())
+      parts = c->parts;
+    else
+    {
+      vsx_string s = c->str();
+      vsx_string deli = " ";
+      split_string(s, deli, parts);
+    }
+    if (!parts.size())
+      batch.pop_back();
+  }
+  if (!batch.size()) return 0;
+
+  // drop param sets a later one in the same row overrides
+  std::vector<bool> skip(batch.size(), false);
+  std::map<vsx_string, size_t> last_set;
+  for (size_t i = 0; i < batch.size(); i++)
+  {
+    if (!is_param_set(batch[i]))
+    {
+      last_set.clear();
+      continue;
+    }
+    vsx_string key = batch[i][0] + " " + batch[i][1] + " " + batch[i][2];
+    std::map<vsx_string, size_t>::iterator it = last_set.find(key);
+    if (it != last_set.end())
+      skip[(*it).second] = true;
+    last_set[key] = i;
+  }
+
+  size_t frame_start = out.size();
+  write_u32(0);
+  write_u32(0);
+  vsx_command_wire_opcodes& opcodes = get_wire_opcodes();
+  size_t count = 0;
+  for (size_t i = 0; i < batch.size(); i++)
+  {
+    if (skip[i]) continue;
+    std::vector<vsx_string>& parts = batch[i];
+    std::map<vsx_string, unsigned int>::iterator it = opcodes.by_name.find(parts[0]);
+    if (it != opcodes.by_name.end())
+      write_u16((*it).second);
+    else
+    {
+      write_u16(VSX_COMMAND_WIRE_LITERAL);
+      write_string(parts[0].c_str(), parts[0].size());
+    }
+    write_u16((unsigned int)(parts.size() - 1));
+    for (size_t j = 1; j < parts.size(); j++)
+      write_string(parts[j].c_str(), parts[j].size());
+    count++;
+  }
+
+  // fill in the header
+  unsigned int length = (unsigned int)(out.size() - frame_start - 4);
+  for (int i = 0; i < 4; i++)
+  {
+    out[frame_start + i] = (char)((length >> (i * 8)) & 0xff);
+    out[frame_start + 4 + i] = (char)((count >> (i * 8)) & 0xff);
+  }
+  return count;
+}
+
+void vsx_command_wire::encode_keepalive()
+{
+  write_u32(4);
+  write_u32(0);
+}
+
+const char* vsx_command_wire::get_out()
+{
+  if (!out.size()) return 0;
+  return &out[0];
+}
+
+size_t vsx_command_wire::get_out_size()
+{
+  return out.size();
+}
+
+void vsx_command_wire::clear_out()
+{
+  out.clear();
+}
+
+void vsx_command_wire::receive(const char* data, size_t size)
+{
+  // move what's left to the front now and then instead of on every read
+  if (in_pos && in_pos > in.size() / 2)
+  {
+    in.erase(in.begin(), in.begin() + in_pos);
+    in_pos = 0;
+  }
+  in.insert(in.end(), data, data + size);
+}
+
+// a string at p, false if it doesn't fit before end
+static bool read_wire_string(const char*& p, const char* end, vsx_string& s, std::vector<char>& buffer)
+{
+  if (end - p < 4) return false;
+  unsigned int length = read_u32(p);
+  p += 4;
+  if ((size_t)(end - p) < length) return false;
+  buffer.resize(length + 1);
+  if (length)
+    memcpy(&buffer[0], p, length);
+  buffer[length] = 0;
+  s = vsx_string(&buffer[0]);
+  p += length;
+  return true;
+}
+
+bool vsx_command_wire::decode(std::vector<vsx_command_s*>& commands)
+{
+  vsx_command_wire_opcodes& opcodes = get_wire_opcodes();
+  std::vector<char> buffer;
+  while (in.size() - in_pos >= 8)
+  {
+    const char* frame = &in[in_pos];
+    unsigned int length = read_u32(frame);
+    if (length < 4 || length > VSX_COMMAND_WIRE_MAX_FRAME) return false;
+    if (in.size() - in_pos < 4 + (size_t)length) break;
+
+    const char* p = frame + 8;
+    const char* end = frame + 4 + length;
+    unsigned int count = read_u32(frame + 4);
+    for (unsigned int i = 0; i < count; i++)
+    {
+      if (end - p < 2) return false;
+      unsigned int opcode = read_u16(p);
+      p += 2;
+      vsx_string name;
+      if (opcode == VSX_COMMAND_WIRE_LITERAL)
+      {
+        if (!read_wire_string(p, end, name, buffer)) return false;
+      }
+      else
+      {
+        if (opcode >= opcodes.count) return false;
+        name = wire_opcodes[opcode];
+      }
+      if (end - p < 2) return false;
+      unsigned int num_args = read_u16(p);
+      p += 2;
+
+      // what vsx_command_parse would have made of the text line
+      vsx_command_s* t = new vsx_command_s;
+      t->cmd = name;
+      t->parts.push_back(name);
+      t->raw = name;
+      for (unsigned int j = 0; j < num_args; j++)
+      {
+        vsx_string arg;
+        if (!read_wire_string(p, end, arg, buffer))
+        {
+          // it's on the garbage list already
+          return false;
+        }
+        t->parts.push_back(arg);
+        t->raw = t->raw + " " + arg;
+      }
+      if (t->parts.size() > 1)
+        t->cmd_data = t->parts[1];
+      t->parsed = true;
+      commands.push_back(t);
+    }
+    in_pos += 4 + (size_t)length;
+  }
+  if (in_pos == in.size())
+  {
+    in.clear();
+    in_pos = 0;
+  }
+  return true;
+}
+
+void vsx_command_wire::reset()
+{
+  out.clear();
+  in.clear();
+  in_pos = 0;
+}
+
+// ****************************************************************************
+
+// sends all of it, false if the connection is gone
+static bool send_all(int sock, const char* data, size_t size)
+{
+  while (size)
+  {
+    ssize_t sent = send(sock, data, size, MSG_NOSIGNAL);
+    if (sent == -1)
+    {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += sent;
+    size -= (size_t)sent;
+  }
+  return true;
+}
+
+// waits until the socket has something to read or timeout_ms passed,
+// false on errors
+class vsx_command_socket_waiter
+{
+  int sock;
+#ifdef __linux__
+  int epoll_fd;
+#endif
+public:
+  vsx_command_socket_waiter()
+  :
+    sock(-1)
+  {
+#ifdef __linux__
+    epoll_fd = epoll_create(1);
+#endif
+  }
+
+  ~vsx_command_socket_waiter()
+  {
+#ifdef __linux__
+    if (epoll_fd != -1)
+      close(epoll_fd);
+#endif
+  }
+
+  // the socket to wait for, -1 for none
+  void set_socket(int n_sock)
+  {
+#ifdef __linux__
+    if (sock != -1)
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sock, 0);
+    if (n_sock != -1)
+    {
+      struct epoll_event event;
+      memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN;
+      event.data.fd = n_sock;
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, n_sock, &event);
+    }
+#endif
+    sock = n_sock;
+  }
+
+  // true when there's something to read (or the other side hung up)
+  bool wait(int timeout_ms)
+  {
+#ifdef __linux__
+    struct epoll_event event;
+    int n = epoll_wait(epoll_fd, &event, 1, timeout_ms);
+    return n > 0;
+#else
+    struct pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, timeout_ms) > 0;
+#endif
+  }
+};
+
+// reads what's there without blocking: > 0 bytes, 0 nothing, -1 connection gone
+static ssize_t recv_some(int sock, char* buf, size_t size)
+{
+  ssize_t size_recv = recv(sock, buf, size, MSG_DONTWAIT);
+  if (size_recv == 0) return -1;
+  if (size_recv == -1)
+  {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+    return -1;
+  }
+  return size_recv;
 }
 
 // ****************************************************************************
@@ -68,6 +503,11 @@ vsx_command_list_server::vsx_command_list_server()
 // ****************************************************************************
 // ****************************************************************************
 
+vsx_command_list_server::vsx_command_list_server()
+{
+  cmd_in = cmd_out = 0;
+}
+
 void vsx_command_list_server::set_command_lists(vsx_command_list* new_in,
                                                 vsx_command_list* new_out)
 {
@@ -93,28 +533,27 @@ void* vsx_command_list_server::server_worker(void *ptr)
   struct addrinfo hints;
   struct addrinfo *servinfo;  // will point to the results
   struct sockaddr_storage their_addr;
-  char recv_buf[BUFLEN];
+  char* recv_buf = new char[BUFLEN];
   socklen_t addr_size;
   int tr=1;
   char s[INET6_ADDRSTRLEN];
   bool run = true;
-  ssize_t size_recv;
-  int keepalive_timer = 0;
   vsx_string message_stack;
-  
+  vsx_command_wire wire;
+  vsx_command_socket_waiter waiter;
+  vsx_timer timer;
+  double last_sent = 0.0;
+
   memset(&hints, 0, sizeof hints); // make sure the struct is empty
   hints.ai_family = AF_INET; //AF_INET6 or AF_UNSPEC
   hints.ai_socktype = SOCK_STREAM; // TCP stream sockets
   hints.ai_flags = AI_PASSIVE;     // fill in my IP for me
 
-  printf("a\n");
-
   if ((status = getaddrinfo(NULL, "11030", &hints, &servinfo)) != 0)
   {
     printf("getaddrinfo error: %s\n", gai_strerror(status));
     exit(1);
   }
-  printf("b\n");
   listen_sock = socket(
     servinfo->ai_family,
     servinfo->ai_socktype,
@@ -123,8 +562,6 @@ void* vsx_command_list_server::server_worker(void *ptr)
     printf("error in socket\n\n");
     handle_error("socket");
   }
-  printf("c socket id: %d\n",listen_sock);
-
 
   // kill "Address already in use" error message
   if (setsockopt(listen_sock,SOL_SOCKET,SO_REUSEADDR,&tr,sizeof(int)) == -1)
@@ -132,23 +569,19 @@ void* vsx_command_list_server::server_worker(void *ptr)
     printf("error in setsockopt\n");
     handle_error("setsockopt\n");
   }
-  printf("d\n");
 
   if (bind(listen_sock, servinfo->ai_addr, servinfo->ai_addrlen) == -1)
   {
     printf("error in bind\n");
     handle_error("bind");
   }
-  printf("e\n");
 
   freeaddrinfo(servinfo);
-  printf("f\n");
 
   if (listen(listen_sock,5) == -1) {
     printf("error listen\n");
     handle_error("bind");
   }
-  printf("g\n");
 
   addr_size = sizeof their_addr;
   while (1)
@@ -160,6 +593,8 @@ void* vsx_command_list_server::server_worker(void *ptr)
                             (struct sockaddr *)&their_addr,
                             &addr_size
                           );
+    if (recv_sock == -1)
+      continue;
 
     inet_ntop(
       their_addr.ss_family,
@@ -168,137 +603,161 @@ void* vsx_command_list_server::server_worker(void *ptr)
       sizeof s
     );
     printf("server: got connection from %s\n", s);
-    //
 
-    vsx_string welcome = ">>VSXu Server 0.3.0\n";
+    int flag = 1;
+    setsockopt(recv_sock, IPPROTO_TCP, TCP_NODELAY, (char *) &flag, sizeof(int));
 
-    send(
-      recv_sock,
-      welcome.c_str(),
-      welcome.size(),
-      0
-    );
+    vsx_string welcome = ">>VSXu Server 0.3.0" VSX_COMMAND_WIRE_WELCOME "\n";
+    send_all(recv_sock, welcome.c_str(), welcome.size());
+
+    wire.reset();
+    waiter.set_socket(recv_sock);
+    last_sent = timer.atime();
+    message_stack = "";
+    // until the first bytes tell us, binary or text
+    bool binary = false;
+    bool mode_known = false;
+    vsx_string greeting;
 
-    memset(&recv_buf,0,BUFLEN);
     while (run)
     {
-      size_recv = recv(recv_sock, &recv_buf, BUFLEN, MSG_DONTWAIT);
+      waiter.wait(WAIT_MS);
+      ssize_t size_recv = recv_some(recv_sock, recv_buf, BUFLEN);
       if (size_recv == -1)
       {
-        if (EAGAIN != errno && EWOULDBLOCK != errno)
-        {
-          printf("EAGAIN / EWOULDBLOCK. closing socket...\n");
-          close(recv_sock);
-          run = false;
-        }
+        printf("connection closed. closing socket...\n");
+        run = false;
+        break;
       }
-      //printf("status: %d\n",status);
 
-      vsx_command_s *out_command;
-      int count_sent = 0;
-      while (this_->cmd_out->pop(&out_command))
+      ssize_t offset = 0;
+      if (size_recv > 0 && !mode_known)
       {
-        //printf("sending command: %s\n",out_command->str().c_str() );
-        vsx_string res = out_command->str()+"\n";
-        if (send(
-          recv_sock,
-          res.c_str(),
-          res.size(),
-          MSG_NOSIGNAL
-        ) == -1) {
-          printf("error in sending. closing socket...\n");
-          close(recv_sock);
-          run = false;
-        } else
+        // the magic can come in pieces, in theory
+        while (offset < size_recv && greeting.size() < VSX_COMMAND_WIRE_MAGIC_SIZE)
         {
-          count_sent++;
+          if (recv_buf[offset] != VSX_COMMAND_WIRE_MAGIC[greeting.size()])
+            break;
+          greeting.push_back(recv_buf[offset]);
+          offset++;
         }
-      }
-      //printf("after cmd_out loop\n");
-      if (!count_sent) {
-        if (keepalive_timer++ == 150) {
-          vsx_string res = "_\n";
-          if (send(
-            recv_sock,
-            res.c_str(),
-            res.size(),
-            MSG_NOSIGNAL
-          ) == -1) {
-            close(recv_sock);
-            run = false;
-          }
-          keepalive_timer = 0;
+        if (greeting.size() == VSX_COMMAND_WIRE_MAGIC_SIZE)
+        {
+          binary = true;
+          mode_known = true;
+        }
+        else
+        if (offset < size_recv)
+        {
+          // not the magic, a text client; what looked like it is text too
+          message_stack = greeting;
+          mode_known = true;
         }
       }
 
-      // need microsecond timing calculation
-      if (size_recv > 0 && size_recv < BUFLEN)
+      if (size_recv > offset && mode_known)
       {
-        //printf("size_recv: %d\n", size_recv);
-        for (ssize_t i = 0; i < size_recv; i++)
+        if (binary)
         {
-          if
-            (
-              (recv_buf[i] == '\n' || recv_buf[i] == '\r')
-              &&
-              message_stack.size()
-            )
+          wire.receive(recv_buf + offset, (size_t)(size_recv - offset));
+          std::vector<vsx_command_s*> commands;
+          bool ok = wire.decode(commands);
+          for (size_t i = 0; i < commands.size(); i++)
           {
-            //printf("got2: %s___\n",message_stack.c_str());
-            if (message_stack == "dc")
-            {
-              memset(&recv_buf,0,BUFLEN);
-              close(recv_sock);
+            if (commands[i]->cmd == "dc")
               run = false;
-              message_stack = "";
-              //return 0;
-            }
             else
+              this_->cmd_in->add(commands[i]);
+          }
+          if (!ok)
+          {
+            printf("broken frame. closing socket...\n");
+            run = false;
+          }
+        }
+        else
+        {
+          for (ssize_t i = offset; i < size_recv; i++)
+          {
+            if
+              (
+                (recv_buf[i] == '\n' || recv_buf[i] == '\r')
+                &&
+                message_stack.size()
+              )
             {
-              if (message_stack != "_")
+              if (message_stack == "dc")
               {
-                this_->cmd_in->add_raw(message_stack);
+                run = false;
               }
+              else
+              {
+                if (message_stack != "_")
+                {
+                  this_->cmd_in->add_raw(message_stack);
+                }
+              }
+              message_stack = "";
+            } else
+            {
+              message_stack.push_back(recv_buf[i]);
             }
-            message_stack = "";
-          } else
-          {
-            message_stack.push_back(recv_buf[i]);
           }
         }
-        memset(&recv_buf,0,BUFLEN);
       }
-      usleep(10);
-      /*if (recv_buf[0] != 0)
-      {
-        vsx_string recv_data(recv_buf);
+      if (!run) break;
+
+      // a binary client sends the magic before anything else, nothing goes
+      // out until we know
+      if (!mode_known)
+        continue;
 
-        vsx_avector<vsx_string> parts;
-        vsx_string deli = "\n";
-        explode(recv_data, deli, parts);
-        for (unsigned long i = 0; i < parts.size(); i++)
+      // text clients get one line per command, still in one send
+      bool sent = false;
+      if (binary)
+      {
+        if (wire.encode(this_->cmd_out))
+          sent = true;
+      }
+      else
+      {
+        vsx_string res;
+        vsx_command_s *out_command;
+        while (this_->cmd_out->pop(&out_command))
+          res = res + out_command->str() + "\n";
+        if (res.size())
         {
-          vsx_string* msg = &parts[i];
-          if ((*msg)[msg->size()-1] == '\r') msg->pop_back();
-          if ((*msg)[msg->size()-1] == '\n') msg->pop_back();
-          if ((*msg)[msg->size()-1] == '\r') msg->pop_back();
-          //printf("got2: %s___\n",msg->c_str());
-          if (*msg == "dc")
-          {
-            close(recv_sock);
+          if (!send_all(recv_sock, res.c_str(), res.size()))
             run = false;
-          }
-          else
-          {
-            this_->cmd_in->add_raw(*msg);
-          }
+          sent = true;
         }
-        memset(&recv_buf,0,size_recv+0x1);
       }
-      usleep(10000);*/
+      if (!sent && timer.atime() - last_sent > KEEPALIVE_TIME)
+      {
+        if (binary)
+          wire.encode_keepalive();
+        else
+        if (!send_all(recv_sock, "_\n", 2))
+          run = false;
+        sent = true;
+      }
+      if (wire.get_out_size())
+      {
+        if (!send_all(recv_sock, wire.get_out(), wire.get_out_size()))
+        {
+          printf("error in sending. closing socket...\n");
+          run = false;
+        }
+        wire.clear_out();
+      }
+      if (sent)
+        last_sent = timer.atime();
     }
+    waiter.set_socket(-1);
+    close(recv_sock);
   }
   close(listen_sock);
+  delete[] recv_buf;
   return 0;
 }
 
@@ -319,27 +778,35 @@ void* vsx_command_list_client::client_worker(void *ptr)
   /*int status;*/
   struct addrinfo hints;
   struct addrinfo *servinfo;  // will point to the results
-  char recv_buf[BUFLEN];
   int sock;
-  ssize_t size_recv;
-  int keepalive_timer = 0;
   vsx_string message_stack;
-  
+  vsx_command_wire wire;
+  vsx_command_socket_waiter waiter;
+  vsx_timer timer;
+  double last_sent = 0.0;
+
   memset(&hints, 0, sizeof hints); // make sure the struct is empty
   hints.ai_family = AF_UNSPEC;     // don't care IPv4 or IPv6
   hints.ai_socktype = SOCK_STREAM; // TCP stream sockets
 
   // get ready to connect
-  /*status = */getaddrinfo(this_->server_address.c_str(), "11030", &hints, &servinfo);
+  if (getaddrinfo(this_->server_address.c_str(), "11030", &hints, &servinfo) != 0)
+  {
+    this_->connected = VSX_COMMAND_CLIENT_DISCONNECTED;
+    return 0;
+  }
 
   sock = socket(servinfo->ai_family, servinfo->ai_socktype, servinfo->ai_protocol);
 
   // servinfo now points to a linked list of 1 or more struct addrinfos
   if (connect(sock, servinfo->ai_addr, servinfo->ai_addrlen) == -1)
   {
+    freeaddrinfo(servinfo);
+    close(sock);
     this_->connected = VSX_COMMAND_CLIENT_DISCONNECTED;
     handle_error("connect");
   }
+  freeaddrinfo(servinfo);
 
   int flag = 1;
   if (setsockopt(sock,            /* socket affected */
@@ -354,95 +821,118 @@ void* vsx_command_list_client::client_worker(void *ptr)
     handle_error("setsockopt");
   }
 
-  memset(&recv_buf,0,BUFLEN);
+  char* recv_buf = new char[BUFLEN];
+  waiter.set_socket(sock);
+  last_sent = timer.atime();
   bool run = true;
+  // the welcome line comes as text, then frames if the server offered them
+  bool welcome_read = false;
+  bool binary = false;
 
   this_->connected = VSX_COMMAND_CLIENT_CONNECTED;
   while (run)
   {
-    size_recv = recv(sock, &recv_buf, BUFLEN-1, MSG_DONTWAIT);
+    waiter.wait(WAIT_MS);
+    ssize_t size_recv = recv_some(sock, recv_buf, BUFLEN);
     if (size_recv == -1)
+      break;
+
+    ssize_t offset = 0;
+    while (!welcome_read && offset < size_recv)
     {
-      if (EAGAIN != errno && EWOULDBLOCK != errno)
+      char c = recv_buf[offset++];
+      if (c == '\n')
       {
-        close(sock);
-        run = false;
-        this_->connected = VSX_COMMAND_CLIENT_DISCONNECTED;
-        //printf("line: %d\n", __LINE__);
-        return 0;
+        vsx_string tag = VSX_COMMAND_WIRE_WELCOME;
+        if (
+          message_stack.size() >= tag.size() &&
+          message_stack.find(tag, message_stack.size() - tag.size()) != -1
+        )
+        {
+          binary = true;
+          message_stack = message_stack.substr(0, message_stack.size() - tag.size());
+        }
+        this_->cmd_in.add_raw(message_stack);
+        message_stack = "";
+        welcome_read = true;
+        if (binary && !send_all(sock, VSX_COMMAND_WIRE_MAGIC, VSX_COMMAND_WIRE_MAGIC_SIZE))
+          run = false;
       }
+      else
+      if (c != '\r')
+        message_stack.push_back(c);
     }
-    int count_sent = 0;
-    vsx_command_s *out_command;
-    while (this_->cmd_out.pop(&out_command))
+    if (!run) break;
+    // nothing goes out before we know what the server speaks
+    if (!welcome_read)
+      continue;
+
+    if (size_recv > offset)
     {
-      vsx_string res = out_command->str()+"\n";
-      //printf("sending to server: %s\n", res.c_str() );
-      if (send(
-        sock,
-        res.c_str(),
-        res.size(),
-        MSG_NOSIGNAL
-        ) == -1)
+      if (binary)
       {
-          close(sock);
-          this_->cmd_out.add_front(out_command);
-          this_->connected = VSX_COMMAND_CLIENT_DISCONNECTED;
-          //printf("line: %d\n", __LINE__);
-          return 0;
+        wire.receive(recv_buf + offset, (size_t)(size_recv - offset));
+        std::vector<vsx_command_s*> commands;
+        bool ok = wire.decode(commands);
+        for (size_t i = 0; i < commands.size(); i++)
+          this_->cmd_in.add(commands[i]);
+        if (!ok)
+          break;
       }
       else
       {
-        count_sent++;
-      }
-    }
-    
-    if (!count_sent) {
-      if (keepalive_timer++ == 150) {
-        vsx_string res = "_\n";
-        if (send(
-          sock,
-          res.c_str(),
-          res.size(),
-          MSG_NOSIGNAL
-        ) == -1) {
-          close(sock);
-          this_->connected = VSX_COMMAND_CLIENT_DISCONNECTED;
-          run = false;
-          printf("line: %d\n", __LINE__);
-          return 0;
+        for (ssize_t i = offset; i < size_recv; i++)
+        {
+          if (recv_buf[i] == '\n' || recv_buf[i] == '\r')
+          {
+            if (message_stack.size() && message_stack != "_")
+              this_->cmd_in.add_raw(message_stack);
+            message_stack = "";
+          }
+          else
+            message_stack.push_back(recv_buf[i]);
         }
-        keepalive_timer = 0;
       }
     }
 
-    // need microsecond timing calculation
-    if (size_recv > 0 && size_recv < BUFLEN)
+    bool sent = false;
+    if (binary)
+      sent = wire.encode(&this_->cmd_out) != 0;
+    else
     {
-      for (ssize_t i = 0; i < size_recv; i++)
+      vsx_string res;
+      vsx_command_s *out_command;
+      while (this_->cmd_out.pop(&out_command))
+        res = res + out_command->str() + "\n";
+      if (res.size())
       {
-        if
-          (
-            (recv_buf[i] == '\n' || recv_buf[i] == '\r')
-            &&
-            message_stack.size()
-          )
-        {
-          //printf("got2: %s___\n",message_stack.c_str());
-          this_->cmd_in.add_raw(message_stack);
-          message_stack = "";
-        } else
-        {
-          if (message_stack != "_")
-          {
-            message_stack.push_back(recv_buf[i]);
-          }
-        }
+        if (!send_all(sock, res.c_str(), res.size()))
+          break;
+        sent = true;
       }
-      memset(&recv_buf,0,BUFLEN);
     }
-    usleep(10);
+    if (!sent && timer.atime() - last_sent > KEEPALIVE_TIME)
+    {
+      if (binary)
+        wire.encode_keepalive();
+      else
+      if (!send_all(sock, "_\n", 2))
+        break;
+      sent = true;
+    }
+    if (wire.get_out_size())
+    {
+      if (!send_all(sock, wire.get_out(), wire.get_out_size()))
+        break;
+      wire.clear_out();
+    }
+    if (sent)
+      last_sent = timer.atime();
   }
+  waiter.set_socket(-1);
+  close(sock);
+  delete[] recv_buf;
+  this_->connected = VSX_COMMAND_CLIENT_DISCONNECTED;
   return 0;
 }
 
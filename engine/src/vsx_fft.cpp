@@ -0,0 +1,205 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <math.h>
+#include "vsx_fft.h"
+#include "vsx_thread_pool.h"
+
+// columns handled together by one task, 16 complex = two cache lines per row
+#define VSX_FFT_COLUMN_BLOCK 16
+
+static bool log2_size(size_t n, size_t& bits)
+{
+  if (n < 1 || (n & (n - 1)))
+    return false;
+  bits = 0;
+  while (((size_t)1 << bits) < n)
+    bits++;
+  return true;
+}
+
+static void build_tables(size_t n, std::vector<vsx_fft_complex>& twiddle, std::vector<size_t>& reverse)
+{
+  size_t bits;
+  log2_size(n, bits);
+  twiddle.resize(n / 2 > 0 ? n / 2 : 1);
+  for (size_t k = 0; k < n / 2; k++)
+  {
+    // in double, the error would otherwise pile up for the big sizes
+    double a = 2.0 * 3.14159265358979323846 * (double)k / (double)n;
+    twiddle[k].re = (float)cos(a);
+    twiddle[k].im = (float)sin(a);
+  }
+  reverse.resize(n);
+  for (size_t i = 0; i < n; i++)
+  {
+    size_t r = 0;
+    for (size_t b = 0; b < bits; b++)
+      if (i & ((size_t)1 << b))
+        r |= (size_t)1 << (bits - 1 - b);
+    reverse[i] = r;
+  }
+}
+
+// n point transform of width interleaved lanes: element t of lane w is at
+// data[t * stride + w]. Rows are stride 1, width 1, a block of columns is
+// stride size_x, width = number of columns.
+static void fft_lanes(vsx_fft_complex* data, size_t n, size_t stride, size_t width, const vsx_fft_complex* twiddle, const size_t* reverse, bool inverse)
+{
+  for (size_t i = 0; i < n; i++)
+  {
+    size_t j = reverse[i];
+    if (i < j)
+    {
+      vsx_fft_complex* a = data + i * stride;
+      vsx_fft_complex* b = data + j * stride;
+      for (size_t w = 0; w < width; w++)
+      {
+        vsx_fft_complex t = a[w];
+        a[w] = b[w];
+        b[w] = t;
+      }
+    }
+  }
+
+  float sign = inverse ? 1.0f : -1.0f;
+  for (size_t half = 1; half < n; half <<= 1)
+  {
+    size_t step = n / (half * 2);
+    for (size_t start = 0; start < n; start += half * 2)
+    {
+      for (size_t k = 0; k < half; k++)
+      {
+        float wr = twiddle[k * step].re;
+        float wi = twiddle[k * step].im * sign;
+        vsx_fft_complex* a = data + (start + k) * stride;
+        vsx_fft_complex* b = data + (start + k + half) * stride;
+        for (size_t w = 0; w < width; w++)
+        {
+          float tr = wr * b[w].re - wi * b[w].im;
+          float ti = wr * b[w].im + wi * b[w].re;
+          b[w].re = a[w].re - tr;
+          b[w].im = a[w].im - ti;
+          a[w].re += tr;
+          a[w].im += ti;
+        }
+      }
+    }
+  }
+
+  if (!inverse)
+  {
+    float scale = 1.0f / (float)n;
+    for (size_t t = 0; t < n; t++)
+    {
+      vsx_fft_complex* a = data + t * stride;
+      for (size_t w = 0; w < width; w++)
+      {
+        a[w].re *= scale;
+        a[w].im *= scale;
+      }
+    }
+  }
+}
+
+vsx_fft_2d::vsx_fft_2d()
+{
+  size_x = 0;
+  size_y = 0;
+}
+
+bool vsx_fft_2d::init(size_t n_size_x, size_t n_size_y)
+{
+  size_t bits;
+  if (!log2_size(n_size_x, bits) || !log2_size(n_size_y, bits))
+    return false;
+  if (n_size_x == size_x && n_size_y == size_y)
+    return true;
+  size_x = n_size_x;
+  size_y = n_size_y;
+  build_tables(size_x, twiddle_x, reverse_x);
+  build_tables(size_y, twiddle_y, reverse_y);
+  return true;
+}
+
+void vsx_fft_2d::rows_task(void* arg, size_t start, size_t end)
+{
+  pass* p = (pass*)arg;
+  vsx_fft_2d* f = p->fft;
+  for (size_t y = start; y < end; y++)
+    fft_lanes(p->data + y * f->size_x, f->size_x, 1, 1, &f->twiddle_x[0], &f->reverse_x[0], p->inverse);
+}
+
+void vsx_fft_2d::columns_task(void* arg, size_t start, size_t end)
+{
+  pass* p = (pass*)arg;
+  vsx_fft_2d* f = p->fft;
+  for (size_t b = start; b < end; b++)
+  {
+    size_t x0 = b * VSX_FFT_COLUMN_BLOCK;
+    size_t width = f->size_x - x0 < VSX_FFT_COLUMN_BLOCK ? f->size_x - x0 : VSX_FFT_COLUMN_BLOCK;
+    fft_lanes(p->data + x0, f->size_y, f->size_x, width, &f->twiddle_y[0], &f->reverse_y[0], p->inverse);
+  }
+}
+
+void vsx_fft_2d::transform(vsx_fft_complex* data, bool inverse, bool threaded)
+{
+  if (!size_x || !size_y)
+    return;
+  pass p;
+  p.fft = this;
+  p.data = data;
+  p.inverse = inverse;
+  size_t blocks = (size_x + VSX_FFT_COLUMN_BLOCK - 1) / VSX_FFT_COLUMN_BLOCK;
+  if (threaded)
+  {
+    vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+    pool->parallel_for(size_y, 16, &rows_task, (void*)&p);
+    pool->parallel_for(blocks, 2, &columns_task, (void*)&p);
+    return;
+  }
+  rows_task((void*)&p, 0, size_y);
+  columns_task((void*)&p, 0, blocks);
+}
+
+void vsx_fft_2d::forward(vsx_fft_complex* data, bool threaded)
+{
+  transform(data, false, threaded);
+}
+
+void vsx_fft_2d::inverse(vsx_fft_complex* data, bool threaded)
+{
+  transform(data, true, threaded);
+}
+
+void vsx_fft_2d::forward_row(vsx_fft_complex* row)
+{
+  if (size_x)
+    fft_lanes(row, size_x, 1, 1, &twiddle_x[0], &reverse_x[0], false);
+}
+
+void vsx_fft_2d::inverse_row(vsx_fft_complex* row)
+{
+  if (size_x)
+    fft_lanes(row, size_x, 1, 1, &twiddle_x[0], &reverse_x[0], true);
+}
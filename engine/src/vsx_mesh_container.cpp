@@ -0,0 +1,458 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "vsx_mesh_container.h"
+#include "vsx_mesh_kernels.h"
+#include "vsx_thread_pool.h"
+
+#define VXB_HEADER_SIZE 64
+#define VXB_SECTION_SIZE 32
+#define VXB_ALIGN 64
+#define VXB_BLOCK 4096
+// one per attribute is all there can be
+#define VXB_MAX_SECTIONS 16
+
+// fixed little endian, whatever the host is
+static void put_u32(unsigned char* p, uint32_t v)
+{
+  p[0] = (unsigned char)v;
+  p[1] = (unsigned char)(v >> 8);
+  p[2] = (unsigned char)(v >> 16);
+  p[3] = (unsigned char)(v >> 24);
+}
+
+static uint32_t get_u32(const unsigned char* p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void put_u64(unsigned char* p, uint64_t v)
+{
+  put_u32(p, (uint32_t)v);
+  put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint64_t get_u64(const unsigned char* p)
+{
+  return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+static void put_f32(unsigned char* p, float f)
+{
+  uint32_t v;
+  memcpy(&v, &f, 4);
+  put_u32(p, v);
+}
+
+static float get_f32(const unsigned char* p)
+{
+  uint32_t v = get_u32(p);
+  float f;
+  memcpy(&f, &v, 4);
+  return f;
+}
+
+static bool host_little_endian()
+{
+  uint32_t v = 1;
+  return *(unsigned char*)&v == 1;
+}
+
+static size_t align_up(size_t v)
+{
+  return (v + VXB_ALIGN - 1) & ~(size_t)(VXB_ALIGN - 1);
+}
+
+static void put_varint(std::vector<unsigned char>& out, uint32_t v)
+{
+  while (v >= 0x80)
+  {
+    out.push_back((unsigned char)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((unsigned char)v);
+}
+
+// count elements of words_per_element 32 bit words, see the top of the header
+static void encode_delta(const uint32_t* words, size_t count, size_t words_per_element, bool indices, std::vector<unsigned char>& out)
+{
+  size_t blocks = (count + VXB_BLOCK - 1) / VXB_BLOCK;
+  size_t table = out.size();
+  out.resize(table + 4 + (blocks + 1) * 4);
+  put_u32(&out[table], (uint32_t)blocks);
+  size_t start = out.size();
+  for (size_t b = 0; b < blocks; b++)
+  {
+    put_u32(&out[table + 4 + b * 4], (uint32_t)(out.size() - start));
+    size_t first = b * VXB_BLOCK;
+    size_t last = first + VXB_BLOCK < count ? first + VXB_BLOCK : count;
+    uint32_t previous = 0;
+    for (size_t w = first * words_per_element; w < last * words_per_element; w++)
+    {
+      uint32_t v = words[w];
+      if (indices)
+      {
+        int32_t d = (int32_t)(v - previous);
+        previous = v;
+        put_varint(out, ((uint32_t)d << 1) ^ (uint32_t)(d >> 31));
+      }
+      else
+        put_varint(out, w >= first * words_per_element + words_per_element ? v ^ words[w - words_per_element] : v);
+    }
+  }
+  put_u32(&out[table + 4 + blocks * 4], (uint32_t)(out.size() - start));
+}
+
+class vxb_decode_job
+{
+public:
+  const unsigned char* table;
+  const unsigned char* blocks;
+  size_t blocks_size;
+  uint32_t* dest;
+  size_t count;
+  size_t words_per_element;
+  bool indices;
+  volatile bool failed;
+};
+
+static void decode_task(void* arg, size_t start, size_t end)
+{
+  vxb_decode_job* j = (vxb_decode_job*)arg;
+  for (size_t b = start; b < end; b++)
+  {
+    size_t from = get_u32(j->table + b * 4);
+    size_t to = get_u32(j->table + b * 4 + 4);
+    if (from > to || to > j->blocks_size)
+    {
+      j->failed = true;
+      return;
+    }
+    const unsigned char* p = j->blocks + from;
+    const unsigned char* p_end = j->blocks + to;
+    size_t first = b * VXB_BLOCK;
+    size_t last = first + VXB_BLOCK < j->count ? first + VXB_BLOCK : j->count;
+    size_t w_first = first * j->words_per_element;
+    size_t w_last = last * j->words_per_element;
+    uint32_t previous = 0;
+    for (size_t w = w_first; w < w_last; w++)
+    {
+      uint32_t v = 0;
+      int shift = 0;
+      while (true)
+      {
+        if (p >= p_end || shift > 28)
+        {
+          j->failed = true;
+          return;
+        }
+        unsigned char c = *p++;
+        v |= (uint32_t)(c & 0x7F) << shift;
+        if (!(c & 0x80))
+          break;
+        shift += 7;
+      }
+      if (j->indices)
+      {
+        previous += (v >> 1) ^ (0 - (v & 1));
+        j->dest[w] = previous;
+      }
+      else
+        j->dest[w] = w >= w_first + j->words_per_element ? v ^ j->dest[w - j->words_per_element] : v;
+    }
+    if (p != p_end)
+      j->failed = true;
+  }
+}
+
+class vxb_check_job
+{
+public:
+  const vsx_face* faces;
+  unsigned long vertex_count;
+  volatile bool failed;
+};
+
+static void check_faces_task(void* arg, size_t start, size_t end)
+{
+  vxb_check_job* j = (vxb_check_job*)arg;
+  for (size_t i = start; i < end; i++)
+  {
+    const vsx_face& f = j->faces[i];
+    if (f.a >= j->vertex_count || f.b >= j->vertex_count || f.c >= j->vertex_count)
+    {
+      j->failed = true;
+      return;
+    }
+  }
+}
+
+// one attribute array, read or written the same way whatever T is
+class vxb_section
+{
+public:
+  uint32_t attribute;
+  uint32_t encoding;
+  uint32_t count;
+  uint32_t element_size;
+  const void* data;
+  std::vector<unsigned char> encoded;
+};
+
+template<class T>
+static void add_section(std::vector<vxb_section>& sections, uint32_t attribute, vsx_array<T>& a, size_t count, bool compress)
+{
+  if (!count || a.size() != count)
+    return;
+  vxb_section s;
+  s.attribute = attribute;
+  s.encoding = compress ? VSX_MESH_CONTAINER_DELTA : VSX_MESH_CONTAINER_RAW;
+  s.count = (uint32_t)count;
+  s.element_size = sizeof(T);
+  s.data = a.get_pointer();
+  sections.push_back(s);
+  if (compress)
+    encode_delta((const uint32_t*)s.data, count, sizeof(T) / 4, attribute == VSX_MESH_CONTAINER_FACES, sections.back().encoded);
+}
+
+// the section into a, in place when possible
+template<class T>
+static bool load_section(vsx_array<T>& a, const unsigned char* data, unsigned long size, const unsigned char* entry, unsigned long count, bool& in_place)
+{
+  uint32_t encoding = get_u32(entry + 4);
+  uint32_t n = get_u32(entry + 8);
+  uint32_t element_size = get_u32(entry + 12);
+  uint64_t offset = get_u64(entry + 16);
+  uint64_t section_size = get_u64(entry + 24);
+  in_place = false;
+  if (!count)
+    return n == 0;
+  if (n != count || element_size != sizeof(T) || offset > size || section_size > size - offset)
+    return false;
+  const unsigned char* p = data + offset;
+  if (encoding == VSX_MESH_CONTAINER_RAW)
+  {
+    if (section_size != (uint64_t)count * sizeof(T))
+      return false;
+    if (host_little_endian() && ((size_t)p & 3) == 0)
+    {
+      a.set_volatile();
+      a.set_data((T*)p, (int)count);
+      a.timestamp++;
+      in_place = true;
+      return true;
+    }
+    a.allocate(count - 1);
+    a.reset_used(count);
+    uint32_t* dest = (uint32_t*)a.get_pointer();
+    for (size_t w = 0; w < count * sizeof(T) / 4; w++)
+      dest[w] = get_u32(p + w * 4);
+    a.timestamp++;
+    return true;
+  }
+  if (encoding != VSX_MESH_CONTAINER_DELTA || section_size < 4)
+    return false;
+  uint32_t blocks = get_u32(p);
+  if (blocks != (count + VXB_BLOCK - 1) / VXB_BLOCK || section_size - 4 < ((uint64_t)blocks + 1) * 4)
+    return false;
+  vxb_decode_job j;
+  j.table = p + 4;
+  j.blocks = j.table + (blocks + 1) * 4;
+  j.blocks_size = (size_t)(section_size - 4 - ((uint64_t)blocks + 1) * 4);
+  a.allocate(count - 1);
+  a.reset_used(count);
+  j.dest = (uint32_t*)a.get_pointer();
+  j.count = count;
+  j.words_per_element = sizeof(T) / 4;
+  j.indices = get_u32(entry) == VSX_MESH_CONTAINER_FACES;
+  j.failed = false;
+  vsx_thread_pool::get_instance()->parallel_for(blocks, 4, &decode_task, (void*)&j);
+  a.timestamp++;
+  return !j.failed;
+}
+
+vsx_mesh_container::vsx_mesh_container()
+{
+  flags = 0;
+  vertex_count = 0;
+  face_count = 0;
+  in_place = 0;
+}
+
+unsigned char* vsx_mesh_container::serialize(vsx_mesh_data* data, unsigned long& size)
+{
+  size = 0;
+  if (data->transform_pending)
+    vsx_mesh_kernels::apply_pending_transform(data);
+  vertex_count = data->vertices.size();
+  face_count = data->faces.size();
+  if (!vertex_count)
+    return 0;
+  vsx_mesh_kernels kernels;
+  if (data->vertex_normals.size() != vertex_count)
+    kernels.calculate_vertex_normals(data);
+  kernels.calculate_bounds(data, bounds_min, bounds_max);
+
+  bool compress = (flags & VSX_MESH_CONTAINER_COMPRESSED) != 0;
+  std::vector<vxb_section> sections;
+  sections.reserve(VXB_MAX_SECTIONS);
+  add_section(sections, VSX_MESH_CONTAINER_VERTICES, data->vertices, vertex_count, compress);
+  add_section(sections, VSX_MESH_CONTAINER_VERTEX_NORMALS, data->vertex_normals, vertex_count, compress);
+  add_section(sections, VSX_MESH_CONTAINER_VERTEX_TEX_COORDS, data->vertex_tex_coords, vertex_count, compress);
+  add_section(sections, VSX_MESH_CONTAINER_VERTEX_COLORS, data->vertex_colors, vertex_count, compress);
+  add_section(sections, VSX_MESH_CONTAINER_VERTEX_TANGENTS, data->vertex_tangents, vertex_count, compress);
+  add_section(sections, VSX_MESH_CONTAINER_FACES, data->faces, face_count, compress);
+
+  std::vector<size_t> offsets(sections.size());
+  size_t total = align_up(VXB_HEADER_SIZE + VXB_SECTION_SIZE * sections.size());
+  for (size_t i = 0; i < sections.size(); i++)
+  {
+    offsets[i] = total;
+    size_t bytes = compress ? sections[i].encoded.size() : (size_t)sections[i].count * sections[i].element_size;
+    total = align_up(total + bytes);
+  }
+  unsigned char* out = (unsigned char*)calloc(total, 1);
+  if (!out)
+    return 0;
+  memcpy(out, "VXB1", 4);
+  put_u32(out + 4, VSX_MESH_CONTAINER_VERSION);
+  put_u32(out + 8, flags);
+  put_u32(out + 12, (uint32_t)sections.size());
+  put_u32(out + 16, (uint32_t)vertex_count);
+  put_u32(out + 20, (uint32_t)face_count);
+  put_f32(out + 24, bounds_min.x);
+  put_f32(out + 28, bounds_min.y);
+  put_f32(out + 32, bounds_min.z);
+  put_f32(out + 36, bounds_max.x);
+  put_f32(out + 40, bounds_max.y);
+  put_f32(out + 44, bounds_max.z);
+  for (size_t i = 0; i < sections.size(); i++)
+  {
+    vxb_section& s = sections[i];
+    unsigned char* e = out + VXB_HEADER_SIZE + i * VXB_SECTION_SIZE;
+    size_t bytes = compress ? s.encoded.size() : (size_t)s.count * s.element_size;
+    put_u32(e, s.attribute);
+    put_u32(e + 4, s.encoding);
+    put_u32(e + 8, s.count);
+    put_u32(e + 12, s.element_size);
+    put_u64(e + 16, offsets[i]);
+    put_u64(e + 24, bytes);
+    if (compress)
+    {
+      memcpy(out + offsets[i], &s.encoded[0], bytes);
+      continue;
+    }
+    const uint32_t* words = (const uint32_t*)s.data;
+    for (size_t w = 0; w < bytes / 4; w++)
+      put_u32(out + offsets[i] + w * 4, words[w]);
+  }
+  size = total;
+  return out;
+}
+
+bool vsx_mesh_container::load_memory(const unsigned char* data, unsigned long size, vsx_mesh_data* out)
+{
+  // stop borrowing the last file before anything else
+  out->vertices.unset_volatile();
+  out->vertex_normals.unset_volatile();
+  out->vertex_tex_coords.unset_volatile();
+  out->vertex_colors.unset_volatile();
+  out->vertex_tangents.unset_volatile();
+  out->faces.unset_volatile();
+  out->clear();
+  in_place = 0;
+  if (!data || size < VXB_HEADER_SIZE || memcmp(data, "VXB1", 4) != 0)
+    return false;
+  if (get_u32(data + 4) != VSX_MESH_CONTAINER_VERSION)
+    return false;
+  flags = get_u32(data + 8);
+  uint32_t num_sections = get_u32(data + 12);
+  vertex_count = get_u32(data + 16);
+  face_count = get_u32(data + 20);
+  bounds_min = vsx_vector(get_f32(data + 24), get_f32(data + 28), get_f32(data + 32));
+  bounds_max = vsx_vector(get_f32(data + 36), get_f32(data + 40), get_f32(data + 44));
+  if (!vertex_count || num_sections > VXB_MAX_SECTIONS || VXB_HEADER_SIZE + num_sections * VXB_SECTION_SIZE > size)
+    return false;
+
+  bool ok = true;
+  unsigned int found = 0;
+  for (uint32_t i = 0; i < num_sections && ok; i++)
+  {
+    const unsigned char* e = data + VXB_HEADER_SIZE + i * VXB_SECTION_SIZE;
+    uint32_t attribute = get_u32(e);
+    bool section_in_place = false;
+    if (found & attribute)
+      ok = false;
+    else
+    switch (attribute)
+    {
+      case VSX_MESH_CONTAINER_VERTICES:
+        ok = load_section(out->vertices, data, size, e, vertex_count, section_in_place);
+        break;
+      case VSX_MESH_CONTAINER_VERTEX_NORMALS:
+        ok = load_section(out->vertex_normals, data, size, e, vertex_count, section_in_place);
+        break;
+      case VSX_MESH_CONTAINER_VERTEX_TEX_COORDS:
+        ok = load_section(out->vertex_tex_coords, data, size, e, vertex_count, section_in_place);
+        break;
+      case VSX_MESH_CONTAINER_VERTEX_COLORS:
+        ok = load_section(out->vertex_colors, data, size, e, vertex_count, section_in_place);
+        break;
+      case VSX_MESH_CONTAINER_VERTEX_TANGENTS:
+        ok = load_section(out->vertex_tangents, data, size, e, vertex_count, section_in_place);
+        break;
+      case VSX_MESH_CONTAINER_FACES:
+        ok = load_section(out->faces, data, size, e, face_count, section_in_place);
+        break;
+      // from a later version, skip it
+      default:
+        continue;
+    }
+    found |= attribute;
+    if (section_in_place)
+      in_place |= attribute;
+  }
+  if (ok && !(found & VSX_MESH_CONTAINER_VERTICES))
+    ok = false;
+  if (ok && face_count && !(found & VSX_MESH_CONTAINER_FACES))
+    ok = false;
+  if (ok && face_count)
+  {
+    // the renderers trust the indices, a broken file must not get past here
+    vxb_check_job j;
+    j.faces = out->faces.get_pointer();
+    j.vertex_count = vertex_count;
+    j.failed = false;
+    vsx_thread_pool::get_instance()->parallel_for(face_count, 16384, &check_faces_task, (void*)&j);
+    ok = !j.failed;
+  }
+  if (!ok)
+  {
+    // drops whatever got loaded
+    load_memory(0, 0, out);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,774 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <math.h>
+#include <string.h>
+#include "vsx_mesh_kernels.h"
+#include "vsx_thread_pool.h"
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
+
+// smallest piece of work handed to one pool thread
+#define VSX_MESH_KERNELS_CHUNK 4096
+// vertices per partial result when reducing the bounding box
+#define VSX_MESH_KERNELS_BOUNDS_CHUNK 16384
+
+// everything a pass needs, the tasks below pick what they use
+class vsx_mesh_kernels_job
+{
+public:
+  const vsx_face* faces;
+  size_t face_count;
+  const vsx_vector* vertices;
+  size_t vertex_count;
+  const vsx_tex_coord* tex_coords;
+  const vsx_vector* normals;
+  const unsigned int* vertex_start;
+  const unsigned int* face_list;
+  float* scratch;
+  vsx_vector* out;
+  vsx_vector* face_out;
+  vsx_quaternion* out_tangents;
+  bool unit;
+  float sign;
+  // bounds, one min/max per chunk
+  vsx_vector* chunk_min;
+  vsx_vector* chunk_max;
+  // row major like vsx_matrix, 0 for none
+  const float* matrix;
+};
+
+template<class T>
+static T* reserve_array(vsx_array<T>& a, size_t count)
+{
+  if (!count)
+  {
+    a.reset_used(0);
+    return 0;
+  }
+  a.allocate(count - 1);
+  a.reset_used(count);
+  return a.get_pointer();
+}
+
+inline bool face_in_range(const vsx_face& f, size_t vertex_count)
+{
+  return f.a < vertex_count && f.b < vertex_count && f.c < vertex_count;
+}
+
+#ifdef __SSE2__
+
+inline __m128 load3(const vsx_vector& v)
+{
+  return _mm_setr_ps(v.x, v.y, v.z, 0.0f);
+}
+
+// x + y + z in all lanes, w has to be 0
+inline __m128 sum3(__m128 v)
+{
+  __m128 s = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+// v * scale / |v|, 0 stays 0
+inline __m128 normalize_scaled(__m128 v, float scale)
+{
+  __m128 len2 = sum3(_mm_mul_ps(v, v));
+  if (_mm_cvtss_f32(len2) <= 0.0f)
+    return _mm_setzero_ps();
+  return _mm_div_ps(_mm_mul_ps(v, _mm_set1_ps(scale)), _mm_sqrt_ps(len2));
+}
+
+inline void store3(__m128 v, vsx_vector& out)
+{
+  float f[4];
+  _mm_storeu_ps(f, v);
+  out.x = f[0];
+  out.y = f[1];
+  out.z = f[2];
+}
+
+// the columns of the 3x4 part of a vsx_matrix, c[3] is the translation
+inline void load_columns(const float* m, __m128* c)
+{
+  c[0] = _mm_setr_ps(m[0], m[4], m[8], 0.0f);
+  c[1] = _mm_setr_ps(m[1], m[5], m[9], 0.0f);
+  c[2] = _mm_setr_ps(m[2], m[6], m[10], 0.0f);
+  c[3] = _mm_setr_ps(m[3], m[7], m[11], 0.0f);
+}
+
+// w of v is ignored
+inline __m128 transform(const __m128* c, __m128 v)
+{
+  __m128 r = _mm_mul_ps(c[0], _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+  r = _mm_add_ps(r, _mm_mul_ps(c[1], _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+  r = _mm_add_ps(r, _mm_mul_ps(c[2], _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+  return _mm_add_ps(r, c[3]);
+}
+
+#endif
+
+inline void transform_scalar(const float* m, const vsx_vector& a, vsx_vector& b)
+{
+  b.x = m[0] * a.x + m[1] * a.y + m[2] * a.z + m[3];
+  b.y = m[4] * a.x + m[5] * a.y + m[6] * a.z + m[7];
+  b.z = m[8] * a.x + m[9] * a.y + m[10] * a.z + m[11];
+}
+
+inline void face_normal(const vsx_mesh_kernels_job* j, size_t i, float* out)
+{
+  const vsx_face& f = j->faces[i];
+  out[0] = out[1] = out[2] = out[3] = 0.0f;
+  if (!face_in_range(f, j->vertex_count))
+    return;
+  vsx_vector n;
+  n.assign_face_normal((vsx_vector*)&j->vertices[f.a], (vsx_vector*)&j->vertices[f.b], (vsx_vector*)&j->vertices[f.c]);
+  if (j->unit)
+  {
+    float len = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+    if (len > 0.0f)
+      n = n * (1.0f / len);
+  }
+  out[0] = n.x;
+  out[1] = n.y;
+  out[2] = n.z;
+}
+
+// pass 1 of the normals, one float4 per face into scratch - or straight
+// into out when only the face normals are wanted
+static void face_normals_task(void* arg, size_t start, size_t end)
+{
+  vsx_mesh_kernels_job* j = (vsx_mesh_kernels_job*)arg;
+  size_t i = start;
+#ifdef __SSE2__
+  // 4 faces at a time, one per lane, transposed back to a float4 each
+  const vsx_vector* v = j->vertices;
+  for (; i + 4 <= end; i += 4)
+  {
+    const vsx_face* f = j->faces + i;
+    if (
+      !face_in_range(f[0], j->vertex_count) || !face_in_range(f[1], j->vertex_count)
+      ||
+      !face_in_range(f[2], j->vertex_count) || !face_in_range(f[3], j->vertex_count)
+    )
+    {
+      for (size_t k = 0; k < 4; k++)
+        face_normal(j, i + k, j->scratch + (i + k) * 4);
+      continue;
+    }
+    #define LANES(corner, axis) _mm_setr_ps(v[f[0].corner].axis, v[f[1].corner].axis, v[f[2].corner].axis, v[f[3].corner].axis)
+    __m128 ax = LANES(a, x), ay = LANES(a, y), az = LANES(a, z);
+    __m128 e1x = _mm_sub_ps(LANES(b, x), ax);
+    __m128 e1y = _mm_sub_ps(LANES(b, y), ay);
+    __m128 e1z = _mm_sub_ps(LANES(b, z), az);
+    __m128 e2x = _mm_sub_ps(LANES(c, x), ax);
+    __m128 e2y = _mm_sub_ps(LANES(c, y), ay);
+    __m128 e2z = _mm_sub_ps(LANES(c, z), az);
+    #undef LANES
+    __m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+    __m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+    __m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+    if (j->unit)
+    {
+      __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+      // degenerate faces stay 0 instead of turning into nan
+      __m128 valid = _mm_cmpgt_ps(len, _mm_setzero_ps());
+      __m128 scale = _mm_and_ps(valid, _mm_div_ps(_mm_set1_ps(1.0f), len));
+      nx = _mm_mul_ps(nx, scale);
+      ny = _mm_mul_ps(ny, scale);
+      nz = _mm_mul_ps(nz, scale);
+    }
+    __m128 nw = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(nx, ny, nz, nw);
+    if (j->face_out)
+    {
+      store3(nx, j->face_out[i]);
+      store3(ny, j->face_out[i + 1]);
+      store3(nz, j->face_out[i + 2]);
+      store3(nw, j->face_out[i + 3]);
+      continue;
+    }
+    float* out = j->scratch + i * 4;
+    _mm_storeu_ps(out, nx);
+    _mm_storeu_ps(out + 4, ny);
+    _mm_storeu_ps(out + 8, nz);
+    _mm_storeu_ps(out + 12, nw);
+  }
+#endif
+  for (; i < end; i++)
+  {
+    if (!j->face_out)
+    {
+      face_normal(j, i, j->scratch + i * 4);
+      continue;
+    }
+    float n[4];
+    face_normal(j, i, n);
+    j->face_out[i].x = n[0];
+    j->face_out[i].y = n[1];
+    j->face_out[i].z = n[2];
+  }
+}
+
+// pass 2, every vertex sums up its own faces
+static void vertex_normals_task(void* arg, size_t start, size_t end)
+{
+  vsx_mesh_kernels_job* j = (vsx_mesh_kernels_job*)arg;
+  for (size_t v = start; v < end; v++)
+  {
+    unsigned int first = j->vertex_start[v];
+    unsigned int last = j->vertex_start[v + 1];
+#ifdef __SSE2__
+    __m128 sum = _mm_setzero_ps();
+    for (unsigned int k = first; k < last; k++)
+      sum = _mm_add_ps(sum, _mm_loadu_ps(j->scratch + (size_t)j->face_list[k] * 4));
+    store3(normalize_scaled(sum, j->sign), j->out[v]);
+#else
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+    for (unsigned int k = first; k < last; k++)
+    {
+      const float* s = j->scratch + (size_t)j->face_list[k] * 4;
+      x += s[0];
+      y += s[1];
+      z += s[2];
+    }
+    float len = sqrtf(x * x + y * y + z * z);
+    float scale = len > 0.0f ? j->sign / len : 0.0f;
+    j->out[v].x = x * scale;
+    j->out[v].y = y * scale;
+    j->out[v].z = z * scale;
+#endif
+  }
+}
+
+// with nobody to share the work with, summing straight into the output is
+// quicker than the two passes - same result up to float rounding
+static void vertex_normals_serial(vsx_mesh_kernels_job* j)
+{
+  vsx_vector* out = j->out;
+  memset((void*)out, 0, sizeof(vsx_vector) * j->vertex_count);
+  float n[4];
+  for (size_t i = 0; i < j->face_count; i++)
+  {
+    const vsx_face& f = j->faces[i];
+    // dropped, like build_adjacency does for the gather
+    if (!face_in_range(f, j->vertex_count))
+      continue;
+    face_normal(j, i, n);
+    out[f.a].x += n[0]; out[f.a].y += n[1]; out[f.a].z += n[2];
+    out[f.b].x += n[0]; out[f.b].y += n[1]; out[f.b].z += n[2];
+    out[f.c].x += n[0]; out[f.c].y += n[1]; out[f.c].z += n[2];
+  }
+  for (size_t v = 0; v < j->vertex_count; v++)
+  {
+    float len = sqrtf(out[v].x * out[v].x + out[v].y * out[v].y + out[v].z * out[v].z);
+    float scale = len > 0.0f ? j->sign / len : 0.0f;
+    out[v].x *= scale;
+    out[v].y *= scale;
+    out[v].z *= scale;
+  }
+}
+
+static void face_centers_task(void* arg, size_t start, size_t end)
+{
+  vsx_mesh_kernels_job* j = (vsx_mesh_kernels_job*)arg;
+  const float third = 1.0f / 3.0f;
+  for (size_t i = start; i < end; i++)
+  {
+    const vsx_face& f = j->faces[i];
+    vsx_vector& c = j->out[i];
+    if (!face_in_range(f, j->vertex_count))
+    {
+      c.x = c.y = c.z = 0.0f;
+      continue;
+    }
+    const vsx_vector& a = j->vertices[f.a];
+    const vsx_vector& b = j->vertices[f.b];
+    const vsx_vector& d = j->vertices[f.c];
+    c.x = (a.x + b.x + d.x) * third;
+    c.y = (a.y + b.y + d.y) * third;
+    c.z = (a.z + b.z + d.z) * third;
+  }
+}
+
+// pass 1 of the tangents, sdir and tdir per face, 8 floats
+static void face_tangents_task(void* arg, size_t start, size_t end)
+{
+  vsx_mesh_kernels_job* j = (vsx_mesh_kernels_job*)arg;
+  for (size_t i = start; i < end; i++)
+  {
+    const vsx_face& f = j->faces[i];
+    float* out = j->scratch + i * 8;
+    for (int k = 0; k < 8; k++)
+      out[k] = 0.0f;
+    if (!face_in_range(f, j->vertex_count))
+      continue;
+    const vsx_vector& v1 = j->vertices[f.a];
+    const vsx_vector& v2 = j->vertices[f.b];
+    const vsx_vector& v3 = j->vertices[f.c];
+    const vsx_tex_coord& w1 = j->tex_coords[f.a];
+    const vsx_tex_coord& w2 = j->tex_coords[f.b];
+    const vsx_tex_coord& w3 = j->tex_coords[f.c];
+
+    float x1 = v2.x - v1.x;
+    float x2 = v3.x - v1.x;
+    float y1 = v2.y - v1.y;
+    float y2 = v3.y - v1.y;
+    float z1 = v2.z - v1.z;
+    float z2 = v3.z - v1.z;
+
+    float s1 = w2.s - w1.s;
+    float s2 = w3.s - w1.s;
+    float t1 = w2.t - w1.t;
+    float t2 = w3.t - w1.t;
+
+    // no texture space on this face, it doesn't get a say
+    float d = s1 * t2 - s2 * t1;
+    if (d == 0.0f)
+      continue;
+    float r = 1.0f / d;
+    out[0] = (t2 * x1 - t1 * x2) * r;
+    out[1] = (t2 * y1 - t1 * y2) * r;
+    out[2] = (t2 * z1 - t1 * z2) * r;
+    out[4] = (s1 * x2 - s2 * x1) * r;
+    out[5] = (s1 * y2 - s2 * y1) * r;
+    out[6] = (s1 * z2 - s2 * z1) * r;
+  }
+}
+
+// pass 2, gather, Gram-Schmidt against the normal and handedness
+static void vertex_tangents_task(void* arg, size_t start, size_t end)
+{
+  vsx_mesh_kernels_job* j = (vsx_mesh_kernels_job*)arg;
+  for (size_t v = start; v < end; v++)
+  {
+    vsx_vector t(0, 0, 0);
+    vsx_vector b(0, 0, 0);
+    for (unsigned int k = j->vertex_start[v]; k < j->vertex_start[v + 1]; k++)
+    {
+      const float* s = j->scratch + (size_t)j->face_list[k] * 8;
+      t.x += s[0];
+      t.y += s[1];
+      t.z += s[2];
+      b.x += s[4];
+      b.y += s[5];
+      b.z += s[6];
+    }
+    const vsx_vector& n = j->normals[v];
+    float d = n.x * t.x + n.y * t.y + n.z * t.z;
+    t.x -= n.x * d;
+    t.y -= n.y * d;
+    t.z -= n.z * d;
+    float len = sqrtf(t.x * t.x + t.y * t.y + t.z * t.z);
+    if (len > 0.0f)
+      t = t * (1.0f / len);
+    vsx_vector nt;
+    nt.cross(n, t);
+    vsx_quaternion& q = j->out_tangents[v];
+    q.x = t.x;
+    q.y = t.y;
+    q.z = t.z;
+    q.w = (nt.x * b.x + nt.y * b.y + nt.z * b.z) < 0.0f ? -1.0f : 1.0f;
+  }
+}
+
+static void bounds_task(void* arg, size_t start, size_t end)
+{
+  vsx_mesh_kernels_job* j = (vsx_mesh_kernels_job*)arg;
+  for (size_t c = start; c < end; c++)
+  {
+    size_t first = c * VSX_MESH_KERNELS_BOUNDS_CHUNK;
+    size_t last = first + VSX_MESH_KERNELS_BOUNDS_CHUNK;
+    if (last > j->vertex_count)
+      last = j->vertex_count;
+    const vsx_vector* p = j->vertices;
+#ifdef __SSE2__
+    __m128 cols[4];
+    if (j->matrix)
+      load_columns(j->matrix, cols);
+    __m128 lo = load3(p[first]);
+    if (j->matrix)
+      lo = transform(cols, lo);
+    __m128 hi = lo;
+    size_t i = first + 1;
+    // a full 4 float load reads x of the next vertex too, fine as long as
+    // there is one
+    for (; i + 1 < j->vertex_count && i < last; i++)
+    {
+      __m128 v = _mm_loadu_ps(&p[i].x);
+      if (j->matrix)
+        v = transform(cols, v);
+      lo = _mm_min_ps(lo, v);
+      hi = _mm_max_ps(hi, v);
+    }
+    for (; i < last; i++)
+    {
+      __m128 v = load3(p[i]);
+      if (j->matrix)
+        v = transform(cols, v);
+      lo = _mm_min_ps(lo, v);
+      hi = _mm_max_ps(hi, v);
+    }
+    store3(lo, j->chunk_min[c]);
+    store3(hi, j->chunk_max[c]);
+#else
+    vsx_vector lo = p[first];
+    if (j->matrix)
+      transform_scalar(j->matrix, p[first], lo);
+    vsx_vector hi = lo;
+    for (size_t i = first + 1; i < last; i++)
+    {
+      vsx_vector v = p[i];
+      if (j->matrix)
+        transform_scalar(j->matrix, p[i], v);
+      if (v.x < lo.x) lo.x = v.x;
+      if (v.y < lo.y) lo.y = v.y;
+      if (v.z < lo.z) lo.z = v.z;
+      if (v.x > hi.x) hi.x = v.x;
+      if (v.y > hi.y) hi.y = v.y;
+      if (v.z > hi.z) hi.z = v.z;
+    }
+    j->chunk_min[c] = lo;
+    j->chunk_max[c] = hi;
+#endif
+  }
+}
+
+// out = matrix * vertices. With unit set (normals) the translation is left
+// out and every result gets the length of its input back.
+static void transform_task(void* arg, size_t start, size_t end)
+{
+  vsx_mesh_kernels_job* j = (vsx_mesh_kernels_job*)arg;
+  const vsx_vector* p = j->vertices;
+  vsx_vector* out = j->out;
+  size_t i = start;
+#ifdef __SSE2__
+  __m128 cols[4];
+  load_columns(j->matrix, cols);
+  if (j->unit)
+    cols[3] = _mm_setzero_ps();
+  __m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+  // full 4 float loads and stores as long as the next vertex is ours too,
+  // the store clobbers its x which is written right after
+  for (; i + 1 < end; i++)
+  {
+    __m128 v = _mm_and_ps(_mm_loadu_ps(&p[i].x), mask);
+    __m128 r = transform(cols, v);
+    if (j->unit)
+      r = normalize_scaled(r, sqrtf(_mm_cvtss_f32(sum3(_mm_mul_ps(v, v)))));
+    _mm_storeu_ps(&out[i].x, r);
+  }
+  for (; i < end; i++)
+  {
+    __m128 v = load3(p[i]);
+    __m128 r = transform(cols, v);
+    if (j->unit)
+      r = normalize_scaled(r, sqrtf(_mm_cvtss_f32(sum3(_mm_mul_ps(v, v)))));
+    store3(r, out[i]);
+  }
+#else
+  const float* m = j->matrix;
+  for (; i < end; i++)
+  {
+    if (!j->unit)
+    {
+      transform_scalar(m, p[i], out[i]);
+      continue;
+    }
+    vsx_vector r;
+    r.x = m[0] * p[i].x + m[1] * p[i].y + m[2] * p[i].z;
+    r.y = m[4] * p[i].x + m[5] * p[i].y + m[6] * p[i].z;
+    r.z = m[8] * p[i].x + m[9] * p[i].y + m[10] * p[i].z;
+    float len = sqrtf(r.x * r.x + r.y * r.y + r.z * r.z);
+    if (len > 0.0f)
+    {
+      float f = sqrtf(p[i].x * p[i].x + p[i].y * p[i].y + p[i].z * p[i].z) / len;
+      r.x *= f;
+      r.y *= f;
+      r.z *= f;
+    }
+    out[i] = r;
+  }
+#endif
+}
+
+vsx_mesh_kernels::vsx_mesh_kernels()
+{
+  topology_changed();
+}
+
+void vsx_mesh_kernels::topology_changed()
+{
+  adjacency_faces = 0;
+  adjacency_face_count = 0;
+  adjacency_vertex_count = 0;
+  vertex_start.clear();
+}
+
+void vsx_mesh_kernels::build_adjacency(vsx_mesh_data* data)
+{
+  const vsx_face* faces = data->faces.get_pointer();
+  size_t face_count = data->faces.size();
+  size_t vertex_count = data->vertices.size();
+  if (
+    vertex_start.size() == vertex_count + 1
+    &&
+    adjacency_faces == faces
+    &&
+    adjacency_face_count == face_count
+    &&
+    adjacency_vertex_count == vertex_count
+  )
+    return;
+
+  // counting sort by vertex - faces come out in order for every vertex, so
+  // the sums don't depend on how the work was split
+  vertex_start.assign(vertex_count + 1, 0);
+  for (size_t i = 0; i < face_count; i++)
+  {
+    if (!face_in_range(faces[i], vertex_count))
+      continue;
+    vertex_start[faces[i].a + 1]++;
+    vertex_start[faces[i].b + 1]++;
+    vertex_start[faces[i].c + 1]++;
+  }
+  for (size_t v = 0; v < vertex_count; v++)
+    vertex_start[v + 1] += vertex_start[v];
+  face_list.resize(vertex_start[vertex_count]);
+  std::vector<unsigned int> cursor(vertex_start.begin(), vertex_start.end() - 1);
+  for (size_t i = 0; i < face_count; i++)
+  {
+    if (!face_in_range(faces[i], vertex_count))
+      continue;
+    face_list[cursor[faces[i].a]++] = (unsigned int)i;
+    face_list[cursor[faces[i].b]++] = (unsigned int)i;
+    face_list[cursor[faces[i].c]++] = (unsigned int)i;
+  }
+
+  adjacency_faces = faces;
+  adjacency_face_count = face_count;
+  adjacency_vertex_count = vertex_count;
+}
+
+void vsx_mesh_kernels::calculate_face_normals(vsx_mesh_data* data, bool unit)
+{
+  size_t face_count = data->faces.size();
+  vsx_vector* out = reserve_array(data->face_normals, face_count);
+  if (!face_count)
+    return;
+
+  vsx_mesh_kernels_job j;
+  j.faces = data->faces.get_pointer();
+  j.face_count = face_count;
+  j.vertices = data->vertices.get_pointer();
+  j.vertex_count = data->vertices.size();
+  j.face_out = out;
+  j.unit = unit;
+
+  vsx_thread_pool::get_instance()->parallel_for(face_count, VSX_MESH_KERNELS_CHUNK, &face_normals_task, (void*)&j);
+}
+
+void vsx_mesh_kernels::calculate_face_centers(vsx_mesh_data* data)
+{
+  size_t face_count = data->faces.size();
+  vsx_vector* out = reserve_array(data->face_centers, face_count);
+  if (!face_count)
+    return;
+
+  vsx_mesh_kernels_job j;
+  j.faces = data->faces.get_pointer();
+  j.face_count = face_count;
+  j.vertices = data->vertices.get_pointer();
+  j.vertex_count = data->vertices.size();
+  j.out = out;
+
+  vsx_thread_pool::get_instance()->parallel_for(face_count, VSX_MESH_KERNELS_CHUNK, &face_centers_task, (void*)&j);
+}
+
+void vsx_mesh_kernels::calculate_vertex_normals(vsx_mesh_data* data, int flags)
+{
+  size_t vertex_count = data->vertices.size();
+  size_t face_count = data->faces.size();
+  vsx_vector* out = reserve_array(data->vertex_normals, vertex_count);
+  if (!vertex_count)
+    return;
+
+  vsx_mesh_kernels_job j;
+  j.faces = data->faces.get_pointer();
+  j.face_count = face_count;
+  j.vertices = data->vertices.get_pointer();
+  j.vertex_count = vertex_count;
+  j.out = out;
+  j.face_out = 0;
+  j.unit = (flags & VSX_MESH_KERNELS_UNIT_FACES) != 0;
+  j.sign = (flags & VSX_MESH_KERNELS_FLIP) ? -1.0f : 1.0f;
+
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+  if (vsx_thread_pool::get_num_cores() < 2)
+  {
+    vertex_normals_serial(&j);
+    return;
+  }
+
+  build_adjacency(data);
+  face_scratch.resize(face_count * 4 + 4);
+  j.vertex_start = &vertex_start[0];
+  j.face_list = face_list.size() ? &face_list[0] : 0;
+  j.scratch = &face_scratch[0];
+  if (face_count)
+    pool->parallel_for(face_count, VSX_MESH_KERNELS_CHUNK, &face_normals_task, (void*)&j);
+  pool->parallel_for(vertex_count, VSX_MESH_KERNELS_CHUNK, &vertex_normals_task, (void*)&j);
+}
+
+bool vsx_mesh_kernels::calculate_tangents(vsx_mesh_data* data, vsx_array<vsx_quaternion>& result)
+{
+  size_t vertex_count = data->vertices.size();
+  size_t face_count = data->faces.size();
+  if (
+    !vertex_count
+    ||
+    data->vertex_tex_coords.size() < vertex_count
+    ||
+    data->vertex_normals.size() < vertex_count
+  )
+  {
+    result.reset_used(0);
+    return false;
+  }
+  vsx_quaternion* out = reserve_array(result, vertex_count);
+  build_adjacency(data);
+  face_scratch.resize(face_count * 8 + 8);
+
+  vsx_mesh_kernels_job j;
+  j.faces = data->faces.get_pointer();
+  j.face_count = face_count;
+  j.vertices = data->vertices.get_pointer();
+  j.vertex_count = vertex_count;
+  j.tex_coords = data->vertex_tex_coords.get_pointer();
+  j.normals = data->vertex_normals.get_pointer();
+  j.vertex_start = &vertex_start[0];
+  j.face_list = face_list.size() ? &face_list[0] : 0;
+  j.scratch = &face_scratch[0];
+  j.out_tangents = out;
+
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+  if (face_count)
+    pool->parallel_for(face_count, VSX_MESH_KERNELS_CHUNK, &face_tangents_task, (void*)&j);
+  pool->parallel_for(vertex_count, VSX_MESH_KERNELS_CHUNK, &vertex_tangents_task, (void*)&j);
+  return true;
+}
+
+bool vsx_mesh_kernels::calculate_bounds(vsx_mesh_data* data, vsx_vector& min, vsx_vector& max)
+{
+  size_t vertex_count = data->vertices.size();
+  if (!vertex_count)
+    return false;
+  size_t chunks = (vertex_count + VSX_MESH_KERNELS_BOUNDS_CHUNK - 1) / VSX_MESH_KERNELS_BOUNDS_CHUNK;
+  std::vector<vsx_vector> chunk_min(chunks);
+  std::vector<vsx_vector> chunk_max(chunks);
+
+  vsx_mesh_kernels_job j;
+  j.vertices = data->vertices.get_pointer();
+  j.vertex_count = vertex_count;
+  j.matrix = data->transform_pending ? data->pending_transform.m : 0;
+  j.chunk_min = &chunk_min[0];
+  j.chunk_max = &chunk_max[0];
+  vsx_thread_pool::get_instance()->parallel_for(chunks, 1, &bounds_task, (void*)&j);
+
+  min = chunk_min[0];
+  max = chunk_max[0];
+  for (size_t c = 1; c < chunks; c++)
+  {
+    if (chunk_min[c].x < min.x) min.x = chunk_min[c].x;
+    if (chunk_min[c].y < min.y) min.y = chunk_min[c].y;
+    if (chunk_min[c].z < min.z) min.z = chunk_min[c].z;
+    if (chunk_max[c].x > max.x) max.x = chunk_max[c].x;
+    if (chunk_max[c].y > max.y) max.y = chunk_max[c].y;
+    if (chunk_max[c].z > max.z) max.z = chunk_max[c].z;
+  }
+  return true;
+}
+
+void vsx_mesh_kernels::stack_transform(vsx_mesh_data* source, vsx_mesh_data* dest, vsx_matrix& m)
+{
+  // share() copies the source timestamps, ours have to move on anyway
+  size_t vertices_timestamp = dest->vertices.timestamp;
+  size_t normals_timestamp = dest->vertex_normals.timestamp;
+  dest->share(source, VSX_MESH_VERTICES | VSX_MESH_VERTEX_NORMALS | VSX_MESH_VERTEX_COLORS | VSX_MESH_VERTEX_TEX_COORDS | VSX_MESH_FACES | VSX_MESH_VERTEX_TANGENTS);
+  dest->vertices.timestamp = vertices_timestamp + 1;
+  dest->vertex_normals.timestamp = normals_timestamp + 1;
+  if (source->transform_pending)
+    dest->pending_transform.multiply(&m, &source->pending_transform);
+  else
+    dest->pending_transform = m;
+  dest->transform_pending = true;
+}
+
+static void transform_array(vsx_array<vsx_vector>& a, const float* matrix, bool normals)
+{
+  size_t count = a.size();
+  if (!count)
+    return;
+  // hold on to the input while a gets a buffer of its own
+  vsx_array<vsx_vector> source;
+  source.share(a);
+  size_t timestamp = a.timestamp;
+  a.unset_volatile();
+  vsx_mesh_kernels_job j;
+  j.vertices = source.get_pointer();
+  j.vertex_count = count;
+  j.out = reserve_array(a, count);
+  j.matrix = matrix;
+  j.unit = normals;
+  a.timestamp = timestamp;
+  vsx_thread_pool::get_instance()->parallel_for(count, VSX_MESH_KERNELS_CHUNK, &transform_task, (void*)&j);
+  source.unset_volatile();
+}
+
+void vsx_mesh_kernels::apply_pending_transform(vsx_mesh_data* data)
+{
+  if (!data->transform_pending)
+    return;
+  data->transform_pending = false;
+  const float* m = data->pending_transform.m;
+  transform_array(data->vertices, m, false);
+
+  // cofactors of the 3x3 part = inverse transpose * determinant, only the
+  // sign of that matters as the length is restored anyway
+  vsx_matrix n;
+  n.m[0] = m[5] * m[10] - m[6] * m[9];
+  n.m[1] = m[6] * m[8] - m[4] * m[10];
+  n.m[2] = m[4] * m[9] - m[5] * m[8];
+  n.m[4] = m[2] * m[9] - m[1] * m[10];
+  n.m[5] = m[0] * m[10] - m[2] * m[8];
+  n.m[6] = m[1] * m[8] - m[0] * m[9];
+  n.m[8] = m[1] * m[6] - m[2] * m[5];
+  n.m[9] = m[2] * m[4] - m[0] * m[6];
+  n.m[10] = m[0] * m[5] - m[1] * m[4];
+  float det = m[0] * n.m[0] + m[1] * n.m[1] + m[2] * n.m[2];
+  if (det < 0.0f)
+    for (int i = 0; i < 11; i++)
+      n.m[i] = -n.m[i];
+  transform_array(data->vertex_normals, n.m, true);
+}
@@ -0,0 +1,1064 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <algorithm>
+#include "vsx_mesh_spatial.h"
+#include "vsx_thread_pool.h"
+
+// smallest piece of work handed to one pool thread
+#define VSX_MESH_SPATIAL_CHUNK 4096
+// queries are a lot more work than a face or a vertex
+#define VSX_MESH_SPATIAL_QUERY_CHUNK 256
+// SAH bins per split
+#define VSX_MESH_SPATIAL_BINS 16
+// faces in a leaf, a leaf is made as soon as a node has this few
+#define VSX_MESH_SPATIAL_LEAF 4
+// a node this size never becomes a leaf, even if SAH would rather have it
+#define VSX_MESH_SPATIAL_MAX_LEAF 16
+// traversal stack, the tree is never deeper than this (see build)
+#define VSX_MESH_SPATIAL_STACK 64
+// points per occupied cell the automatic cell size aims for
+#define VSX_MESH_SPATIAL_CELL_POINTS 4.0f
+// cells per axis, the cell size grows until the grid fits
+#define VSX_MESH_SPATIAL_MAX_CELLS 1048576
+
+static inline float dot3(const float* a, const float* b)
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline void sub3(const float* a, const float* b, float* r)
+{
+  r[0] = a[0] - b[0];
+  r[1] = a[1] - b[1];
+  r[2] = a[2] - b[2];
+}
+
+static inline void cross3(const float* a, const float* b, float* r)
+{
+  r[0] = a[1] * b[2] - a[2] * b[1];
+  r[1] = a[2] * b[0] - a[0] * b[2];
+  r[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static inline float box_area(const float* mn, const float* mx)
+{
+  float dx = mx[0] - mn[0];
+  float dy = mx[1] - mn[1];
+  float dz = mx[2] - mn[2];
+  return dx * dy + dy * dz + dz * dx;
+}
+
+// squared distance from p to the box, 0 inside
+static inline float box_distance2(const float* mn, const float* mx, const float* p)
+{
+  float d2 = 0.0f;
+  for (int k = 0; k < 3; k++)
+  {
+    float d = 0.0f;
+    if (p[k] < mn[k])
+      d = mn[k] - p[k];
+    else
+    if (p[k] > mx[k])
+      d = p[k] - mx[k];
+    d2 += d * d;
+  }
+  return d2;
+}
+
+// slab test, entry distance or FLT_MAX
+static inline float box_ray(const float* mn, const float* mx, const float* o, const float* inv, float t_max)
+{
+  float t0 = 0.0f;
+  float t1 = t_max;
+  for (int k = 0; k < 3; k++)
+  {
+    float a = (mn[k] - o[k]) * inv[k];
+    float b = (mx[k] - o[k]) * inv[k];
+    if (a > b)
+      std::swap(a, b);
+    // a NaN (0 * inf, ray in the plane of the slab) keeps the old values
+    if (a > t0) t0 = a;
+    if (b < t1) t1 = b;
+    if (t0 > t1)
+      return FLT_MAX;
+  }
+  return t0;
+}
+
+// Moller-Trumbore, both sides
+static inline bool triangle_ray(const vsx_vector* c, const float* o, const float* d, float t_max, float& t, float& u, float& v)
+{
+  float e1[3], e2[3], p[3], q[3], s[3];
+  sub3(&c[1].x, &c[0].x, e1);
+  sub3(&c[2].x, &c[0].x, e2);
+  cross3(d, e2, p);
+  float det = dot3(e1, p);
+  if (fabsf(det) < 1e-12f)
+    return false;
+  float inv_det = 1.0f / det;
+  sub3(o, &c[0].x, s);
+  u = dot3(s, p) * inv_det;
+  if (u < 0.0f || u > 1.0f)
+    return false;
+  cross3(s, e1, q);
+  v = dot3(d, q) * inv_det;
+  if (v < 0.0f || u + v > 1.0f)
+    return false;
+  t = dot3(e2, q) * inv_det;
+  return t >= 0.0f && t <= t_max;
+}
+
+// closest point on the triangle, Ericson - Real-Time Collision Detection 5.1.5
+static inline void triangle_closest(const vsx_vector* c, const float* p, float* r, float& u, float& v)
+{
+  const float* a = &c[0].x;
+  const float* b = &c[1].x;
+  const float* cc = &c[2].x;
+  float ab[3], ac[3], ap[3], bp[3], cp[3];
+  sub3(b, a, ab);
+  sub3(cc, a, ac);
+  sub3(p, a, ap);
+  float d1 = dot3(ab, ap);
+  float d2 = dot3(ac, ap);
+  if (d1 <= 0.0f && d2 <= 0.0f)
+  {
+    u = 0.0f; v = 0.0f;
+  }
+  else
+  {
+    sub3(p, b, bp);
+    float d3 = dot3(ab, bp);
+    float d4 = dot3(ac, bp);
+    sub3(p, cc, cp);
+    float d5 = dot3(ab, cp);
+    float d6 = dot3(ac, cp);
+    float vc = d1 * d4 - d3 * d2;
+    float vb = d5 * d2 - d1 * d6;
+    float va = d3 * d6 - d5 * d4;
+    if (d3 >= 0.0f && d4 <= d3)
+    {
+      u = 1.0f; v = 0.0f;
+    }
+    else
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+    {
+      u = d1 / (d1 - d3); v = 0.0f;
+    }
+    else
+    if (d6 >= 0.0f && d5 <= d6)
+    {
+      u = 0.0f; v = 1.0f;
+    }
+    else
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+    {
+      u = 0.0f; v = d2 / (d2 - d6);
+    }
+    else
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+    {
+      v = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+      u = 1.0f - v;
+    }
+    else
+    {
+      float denom = 1.0f / (va + vb + vc);
+      u = vb * denom;
+      v = vc * denom;
+    }
+  }
+  for (int k = 0; k < 3; k++)
+    r[k] = a[k] + ab[k] * u + ac[k] * v;
+}
+
+static inline void set_position(vsx_vector& r, const float* p)
+{
+  r.x = p[0];
+  r.y = p[1];
+  r.z = p[2];
+}
+
+static inline void clear_hit(vsx_mesh_spatial_hit& hit)
+{
+  hit.distance = FLT_MAX;
+  hit.index = 0;
+  hit.u = hit.v = 0.0f;
+  hit.position = vsx_vector(0, 0, 0);
+}
+
+
+//---------------------------------------------------------------------------
+// vsx_bvh
+
+class vsx_bvh_build_job
+{
+public:
+  const vsx_vector* vertices;
+  const vsx_face* faces;
+  const unsigned int* face_index;
+  // 3 floats each
+  float* face_min;
+  float* face_max;
+  float* center;
+};
+
+static void face_bounds_task(void* arg, size_t start, size_t end)
+{
+  vsx_bvh_build_job* j = (vsx_bvh_build_job*)arg;
+  for (size_t i = start; i < end; i++)
+  {
+    const vsx_face& f = j->faces[j->face_index[i]];
+    const float* a = &j->vertices[f.a].x;
+    const float* b = &j->vertices[f.b].x;
+    const float* c = &j->vertices[f.c].x;
+    for (int k = 0; k < 3; k++)
+    {
+      float mn = std::min(a[k], std::min(b[k], c[k]));
+      float mx = std::max(a[k], std::max(b[k], c[k]));
+      j->face_min[i * 3 + k] = mn;
+      j->face_max[i * 3 + k] = mx;
+      j->center[i * 3 + k] = (mn + mx) * 0.5f;
+    }
+  }
+}
+
+class vsx_bvh_bin
+{
+public:
+  float min[3];
+  float max[3];
+  unsigned int count;
+
+  void reset()
+  {
+    min[0] = min[1] = min[2] = FLT_MAX;
+    max[0] = max[1] = max[2] = -FLT_MAX;
+    count = 0;
+  }
+
+  void grow(const float* mn, const float* mx)
+  {
+    for (int k = 0; k < 3; k++)
+    {
+      min[k] = std::min(min[k], mn[k]);
+      max[k] = std::max(max[k], mx[k]);
+    }
+  }
+};
+
+void vsx_bvh::clear()
+{
+  nodes.clear();
+  corners.clear();
+  face_index.clear();
+}
+
+void vsx_bvh::build(const vsx_vector* vertices, size_t vertex_count, const vsx_face* faces, size_t face_count)
+{
+  clear();
+  std::vector<unsigned int> order;
+  order.reserve(face_count);
+  for (size_t i = 0; i < face_count; i++)
+    if (faces[i].a < vertex_count && faces[i].b < vertex_count && faces[i].c < vertex_count)
+      order.push_back((unsigned int)i);
+  size_t count = order.size();
+  if (!count)
+    return;
+
+  std::vector<float> face_min(count * 3);
+  std::vector<float> face_max(count * 3);
+  std::vector<float> center(count * 3);
+  vsx_bvh_build_job j;
+  j.vertices = vertices;
+  j.faces = faces;
+  j.face_index = &order[0];
+  j.face_min = &face_min[0];
+  j.face_max = &face_max[0];
+  j.center = &center[0];
+  vsx_thread_pool::get_instance()->parallel_for(count, VSX_MESH_SPATIAL_CHUNK, &face_bounds_task, (void*)&j);
+
+  // order holds mesh face indices, work on positions into the bounds arrays
+  // and translate at the end
+  std::vector<unsigned int> items(count);
+  for (size_t i = 0; i < count; i++)
+    items[i] = (unsigned int)i;
+
+  nodes.reserve(count / VSX_MESH_SPATIAL_LEAF * 2 + 1);
+  nodes.resize(1);
+  nodes[0].first = 0;
+  nodes[0].count = (unsigned int)count;
+
+  // (node, depth), depth so a degenerate split can't run off the stack
+  // the traversal has
+  std::vector<std::pair<unsigned int, unsigned int> > todo;
+  todo.push_back(std::make_pair(0u, 0u));
+  vsx_bvh_bin bins[VSX_MESH_SPATIAL_BINS];
+  float right_area[VSX_MESH_SPATIAL_BINS];
+  unsigned int right_count[VSX_MESH_SPATIAL_BINS];
+
+  while (todo.size())
+  {
+    unsigned int n = todo.back().first;
+    unsigned int depth = todo.back().second;
+    todo.pop_back();
+    unsigned int first = nodes[n].first;
+    unsigned int n_count = nodes[n].count;
+
+    // node bounds and centroid bounds
+    float c_min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float c_max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    float b_min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float b_max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (unsigned int i = first; i < first + n_count; i++)
+    {
+      unsigned int f = items[i];
+      for (int k = 0; k < 3; k++)
+      {
+        b_min[k] = std::min(b_min[k], face_min[f * 3 + k]);
+        b_max[k] = std::max(b_max[k], face_max[f * 3 + k]);
+        c_min[k] = std::min(c_min[k], center[f * 3 + k]);
+        c_max[k] = std::max(c_max[k], center[f * 3 + k]);
+      }
+    }
+    for (int k = 0; k < 3; k++)
+    {
+      nodes[n].min[k] = b_min[k];
+      nodes[n].max[k] = b_max[k];
+    }
+
+    if (n_count <= VSX_MESH_SPATIAL_LEAF || depth + 2 >= VSX_MESH_SPATIAL_STACK)
+      continue;
+
+    int axis = 0;
+    for (int k = 1; k < 3; k++)
+      if (c_max[k] - c_min[k] > c_max[axis] - c_min[axis])
+        axis = k;
+    float extent = c_max[axis] - c_min[axis];
+    // all centers in one spot, nothing to split on
+    if (extent <= 0.0f)
+      continue;
+
+    float scale = VSX_MESH_SPATIAL_BINS / extent;
+    for (int b = 0; b < VSX_MESH_SPATIAL_BINS; b++)
+      bins[b].reset();
+    for (unsigned int i = first; i < first + n_count; i++)
+    {
+      unsigned int f = items[i];
+      int b = (int)((center[f * 3 + axis] - c_min[axis]) * scale);
+      if (b >= VSX_MESH_SPATIAL_BINS) b = VSX_MESH_SPATIAL_BINS - 1;
+      bins[b].count++;
+      bins[b].grow(&face_min[f * 3], &face_max[f * 3]);
+    }
+
+    // sweep from the right, then from the left evaluating every plane
+    vsx_bvh_bin acc;
+    acc.reset();
+    unsigned int acc_count = 0;
+    for (int b = VSX_MESH_SPATIAL_BINS - 1; b > 0; b--)
+    {
+      if (bins[b].count)
+        acc.grow(bins[b].min, bins[b].max);
+      acc_count += bins[b].count;
+      right_area[b] = acc_count ? box_area(acc.min, acc.max) : 0.0f;
+      right_count[b] = acc_count;
+    }
+    acc.reset();
+    acc_count = 0;
+    float best_cost = FLT_MAX;
+    int best_split = -1;
+    for (int b = 0; b < VSX_MESH_SPATIAL_BINS - 1; b++)
+    {
+      if (bins[b].count)
+        acc.grow(bins[b].min, bins[b].max);
+      acc_count += bins[b].count;
+      if (!acc_count || !right_count[b + 1])
+        continue;
+      float cost = box_area(acc.min, acc.max) * acc_count + right_area[b + 1] * right_count[b + 1];
+      if (cost < best_cost)
+      {
+        best_cost = cost;
+        best_split = b;
+      }
+    }
+    if (best_split < 0)
+      continue;
+    // leaf cost is the node area times its faces, traversal costs about one
+    // face test
+    float parent_area = box_area(b_min, b_max);
+    if (n_count <= VSX_MESH_SPATIAL_MAX_LEAF && best_cost >= parent_area * (n_count - 1))
+      continue;
+
+    // same binning as above, so the counts match the plane we picked
+    unsigned int lo = first;
+    unsigned int hi = first + n_count;
+    while (lo < hi)
+    {
+      unsigned int f = items[lo];
+      int b = (int)((center[f * 3 + axis] - c_min[axis]) * scale);
+      if (b >= VSX_MESH_SPATIAL_BINS) b = VSX_MESH_SPATIAL_BINS - 1;
+      if (b <= best_split)
+        lo++;
+      else
+        std::swap(items[lo], items[--hi]);
+    }
+    unsigned int left_count = lo - first;
+
+    unsigned int left = (unsigned int)nodes.size();
+    nodes.resize(left + 2);
+    nodes[left].first = first;
+    nodes[left].count = left_count;
+    nodes[left + 1].first = first + left_count;
+    nodes[left + 1].count = n_count - left_count;
+    nodes[n].first = left;
+    nodes[n].count = 0;
+    todo.push_back(std::make_pair(left + 1, depth + 1));
+    todo.push_back(std::make_pair(left, depth + 1));
+  }
+
+  // triangles in leaf order, a leaf reads one contiguous run
+  corners.resize(count * 3);
+  face_index.resize(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    unsigned int f = order[items[i]];
+    face_index[i] = f;
+    corners[i * 3] = vertices[faces[f].a];
+    corners[i * 3 + 1] = vertices[faces[f].b];
+    corners[i * 3 + 2] = vertices[faces[f].c];
+  }
+}
+
+bool vsx_bvh::raycast(const vsx_vector& origin, const vsx_vector& direction, float max_distance, vsx_mesh_spatial_hit& hit) const
+{
+  clear_hit(hit);
+  if (!nodes.size())
+    return false;
+  const float* o = &origin.x;
+  const float* d = &direction.x;
+  float inv[3];
+  for (int k = 0; k < 3; k++)
+    inv[k] = 1.0f / d[k];
+
+  float best = max_distance;
+  bool found = false;
+  unsigned int stack[VSX_MESH_SPATIAL_STACK];
+  int top = 0;
+  if (box_ray(nodes[0].min, nodes[0].max, o, inv, best) == FLT_MAX)
+    return false;
+  stack[top++] = 0;
+  while (top)
+  {
+    const vsx_bvh_node& node = nodes[stack[--top]];
+    if (node.count)
+    {
+      for (unsigned int i = node.first; i < node.first + node.count; i++)
+      {
+        float t, u, v;
+        if (triangle_ray(&corners[i * 3], o, d, best, t, u, v))
+        {
+          best = t;
+          found = true;
+          hit.index = face_index[i];
+          hit.u = u;
+          hit.v = v;
+        }
+      }
+      continue;
+    }
+    // nearer child on top so it's searched first and shrinks best
+    float t_left = box_ray(nodes[node.first].min, nodes[node.first].max, o, inv, best);
+    float t_right = box_ray(nodes[node.first + 1].min, nodes[node.first + 1].max, o, inv, best);
+    if (t_left <= t_right)
+    {
+      if (t_right != FLT_MAX) stack[top++] = node.first + 1;
+      if (t_left != FLT_MAX) stack[top++] = node.first;
+    }
+    else
+    {
+      if (t_left != FLT_MAX) stack[top++] = node.first;
+      if (t_right != FLT_MAX) stack[top++] = node.first + 1;
+    }
+  }
+  if (!found)
+    return false;
+  hit.distance = best;
+  hit.position = vsx_vector(o[0] + d[0] * best, o[1] + d[1] * best, o[2] + d[2] * best);
+  return true;
+}
+
+bool vsx_bvh::nearest(const vsx_vector& point, float max_distance, vsx_mesh_spatial_hit& hit) const
+{
+  clear_hit(hit);
+  if (!nodes.size())
+    return false;
+  const float* p = &point.x;
+  float best2 = max_distance < sqrtf(FLT_MAX) ? max_distance * max_distance : FLT_MAX;
+  bool found = false;
+  unsigned int stack[VSX_MESH_SPATIAL_STACK];
+  int top = 0;
+  stack[top++] = 0;
+  while (top)
+  {
+    const vsx_bvh_node& node = nodes[stack[--top]];
+    if (box_distance2(node.min, node.max, p) > best2)
+      continue;
+    if (node.count)
+    {
+      for (unsigned int i = node.first; i < node.first + node.count; i++)
+      {
+        float r[3], u, v, dd[3];
+        triangle_closest(&corners[i * 3], p, r, u, v);
+        sub3(r, p, dd);
+        float d2 = dot3(dd, dd);
+        if (d2 <= best2)
+        {
+          best2 = d2;
+          found = true;
+          hit.index = face_index[i];
+          hit.u = u;
+          hit.v = v;
+          set_position(hit.position, r);
+        }
+      }
+      continue;
+    }
+    float d_left = box_distance2(nodes[node.first].min, nodes[node.first].max, p);
+    float d_right = box_distance2(nodes[node.first + 1].min, nodes[node.first + 1].max, p);
+    if (d_left <= d_right)
+    {
+      stack[top++] = node.first + 1;
+      stack[top++] = node.first;
+    }
+    else
+    {
+      stack[top++] = node.first;
+      stack[top++] = node.first + 1;
+    }
+  }
+  if (!found)
+    return false;
+  hit.distance = sqrtf(best2);
+  return true;
+}
+
+class vsx_bvh_query_job
+{
+public:
+  const vsx_bvh* bvh;
+  const vsx_vector* points;
+  const vsx_vector* directions;
+  float max_distance;
+  vsx_mesh_spatial_hit* hits;
+};
+
+static void bvh_raycast_task(void* arg, size_t start, size_t end)
+{
+  vsx_bvh_query_job* j = (vsx_bvh_query_job*)arg;
+  for (size_t i = start; i < end; i++)
+    j->bvh->raycast(j->points[i], j->directions[i], j->max_distance, j->hits[i]);
+}
+
+static void bvh_nearest_task(void* arg, size_t start, size_t end)
+{
+  vsx_bvh_query_job* j = (vsx_bvh_query_job*)arg;
+  for (size_t i = start; i < end; i++)
+    j->bvh->nearest(j->points[i], j->max_distance, j->hits[i]);
+}
+
+void vsx_bvh::raycast_batch(const vsx_vector* origins, const vsx_vector* directions, size_t count, float max_distance, vsx_mesh_spatial_hit* hits) const
+{
+  vsx_bvh_query_job j;
+  j.bvh = this;
+  j.points = origins;
+  j.directions = directions;
+  j.max_distance = max_distance;
+  j.hits = hits;
+  vsx_thread_pool::get_instance()->parallel_for(count, VSX_MESH_SPATIAL_QUERY_CHUNK, &bvh_raycast_task, (void*)&j);
+}
+
+void vsx_bvh::nearest_batch(const vsx_vector* points, size_t count, float max_distance, vsx_mesh_spatial_hit* hits) const
+{
+  vsx_bvh_query_job j;
+  j.bvh = this;
+  j.points = points;
+  j.directions = 0;
+  j.max_distance = max_distance;
+  j.hits = hits;
+  vsx_thread_pool::get_instance()->parallel_for(count, VSX_MESH_SPATIAL_QUERY_CHUNK, &bvh_nearest_task, (void*)&j);
+}
+
+size_t vsx_bvh::get_num_faces() const
+{
+  return face_index.size();
+}
+
+size_t vsx_bvh::get_num_nodes() const
+{
+  return nodes.size();
+}
+
+
+//---------------------------------------------------------------------------
+// vsx_point_grid
+
+vsx_point_grid::vsx_point_grid() :
+  cell_size(1.0f),
+  inverse_cell_size(1.0f),
+  hash_mask(0)
+{
+  for (int k = 0; k < 3; k++)
+  {
+    origin[k] = 0.0f;
+    cell_min[k] = cell_max[k] = 0;
+  }
+}
+
+void vsx_point_grid::clear()
+{
+  bucket_start.clear();
+  points.clear();
+  point_index.clear();
+  hash_mask = 0;
+}
+
+void vsx_point_grid::cell_of(const vsx_vector& p, int* c) const
+{
+  const float* pp = &p.x;
+  for (int k = 0; k < 3; k++)
+  {
+    // clamp in float first, far away queries would overflow the int
+    float f = floorf((pp[k] - origin[k]) * inverse_cell_size);
+    if (f < -1e9f) f = -1e9f;
+    if (f > 1e9f) f = 1e9f;
+    c[k] = (int)f;
+  }
+}
+
+size_t vsx_point_grid::hash(int x, int y, int z) const
+{
+  return ((size_t)((unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ^ (unsigned int)z * 83492791u)) & hash_mask;
+}
+
+void vsx_point_grid::fill(const vsx_vector* source, size_t count)
+{
+  inverse_cell_size = 1.0f / cell_size;
+  size_t buckets = 16;
+  while (buckets < count * 2)
+    buckets <<= 1;
+  hash_mask = buckets - 1;
+
+  for (int k = 0; k < 3; k++)
+  {
+    cell_min[k] = INT_MAX;
+    cell_max[k] = INT_MIN;
+  }
+  std::vector<unsigned int> point_bucket(count);
+  bucket_start.assign(buckets + 1, 0);
+  for (size_t i = 0; i < count; i++)
+  {
+    int c[3];
+    cell_of(source[i], c);
+    for (int k = 0; k < 3; k++)
+    {
+      cell_min[k] = std::min(cell_min[k], c[k]);
+      cell_max[k] = std::max(cell_max[k], c[k]);
+    }
+    size_t b = hash(c[0], c[1], c[2]);
+    point_bucket[i] = (unsigned int)b;
+    bucket_start[b + 1]++;
+  }
+  for (size_t b = 0; b < buckets; b++)
+    bucket_start[b + 1] += bucket_start[b];
+
+  // counting sort, points of one bucket next to each other
+  points.resize(count);
+  point_index.resize(count);
+  std::vector<unsigned int> cursor(bucket_start.begin(), bucket_start.end() - 1);
+  for (size_t i = 0; i < count; i++)
+  {
+    unsigned int at = cursor[point_bucket[i]]++;
+    points[at] = source[i];
+    point_index[at] = (unsigned int)i;
+  }
+}
+
+void vsx_point_grid::build(const vsx_vector* source, size_t count, float n_cell_size)
+{
+  clear();
+  if (!count)
+    return;
+
+  float mn[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+  float mx[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+  for (size_t i = 0; i < count; i++)
+  {
+    const float* p = &source[i].x;
+    for (int k = 0; k < 3; k++)
+    {
+      mn[k] = std::min(mn[k], p[k]);
+      mx[k] = std::max(mx[k], p[k]);
+    }
+  }
+  float extent[3];
+  float largest = 0.0f;
+  for (int k = 0; k < 3; k++)
+  {
+    origin[k] = mn[k];
+    extent[k] = mx[k] - mn[k];
+    largest = std::max(largest, extent[k]);
+  }
+
+  if (n_cell_size > 0.0f)
+    cell_size = n_cell_size;
+  else
+  if (largest <= 0.0f)
+    cell_size = 1.0f;
+  else
+  {
+    // axes flatter than the cell don't add cells, so a mesh surface (2d)
+    // or a line of particles (1d) gets the cell size of its own dimension
+    // instead of one for the whole box
+    float target = VSX_MESH_SPATIAL_CELL_POINTS / (float)count;
+    cell_size = largest;
+    for (int pass = 0; pass < 3; pass++)
+    {
+      float measure = 1.0f;
+      int dims = 0;
+      for (int k = 0; k < 3; k++)
+        if (extent[k] > cell_size)
+        {
+          measure *= extent[k];
+          dims++;
+        }
+      if (!dims)
+      {
+        measure = largest;
+        dims = 1;
+      }
+      cell_size = powf(measure * target, 1.0f / dims);
+    }
+  }
+  // the int cell coordinates have to fit
+  if (largest / cell_size > VSX_MESH_SPATIAL_MAX_CELLS)
+    cell_size = largest / VSX_MESH_SPATIAL_MAX_CELLS;
+  inverse_cell_size = 1.0f / cell_size;
+
+  fill(source, count);
+
+  // the estimate assumes the points are spread evenly, clumps put many in
+  // one cell - halve until the occupied cells are reasonably light
+  if (n_cell_size > 0.0f)
+    return;
+  for (int pass = 0; pass < 4; pass++)
+  {
+    size_t occupied = 0;
+    for (size_t b = 0; b <= hash_mask; b++)
+      if (bucket_start[b + 1] != bucket_start[b])
+        occupied++;
+    if (count <= occupied * 8 || largest / (cell_size * 0.5f) > VSX_MESH_SPATIAL_MAX_CELLS)
+      break;
+    cell_size *= 0.5f;
+    fill(source, count);
+  }
+}
+
+bool vsx_point_grid::nearest(const vsx_vector& point, float max_distance, vsx_mesh_spatial_hit& hit) const
+{
+  clear_hit(hit);
+  if (!points.size())
+    return false;
+  float best2 = max_distance < sqrtf(FLT_MAX) ? max_distance * max_distance : FLT_MAX;
+  bool found = false;
+  int q[3];
+  cell_of(point, q);
+
+  // shells of cells around q, r cells out. Anything past shell r is at
+  // least r cells away, so once the best is closer than that we're done.
+  int r_first = 0;
+  int r_last = 0;
+  for (int k = 0; k < 3; k++)
+  {
+    r_first = std::max(r_first, std::max(cell_min[k] - q[k], q[k] - cell_max[k]));
+    r_last = std::max(r_last, std::max(q[k] - cell_min[k], cell_max[k] - q[k]));
+  }
+  for (int r = r_first; r <= r_last; r++)
+  {
+    float reach = (float)(r - 1) * cell_size;
+    if (r > 0 && reach * reach > best2)
+      break;
+    int x0 = std::max(q[0] - r, cell_min[0]), x1 = std::min(q[0] + r, cell_max[0]);
+    int y0 = std::max(q[1] - r, cell_min[1]), y1 = std::min(q[1] + r, cell_max[1]);
+    int z0 = std::max(q[2] - r, cell_min[2]), z1 = std::min(q[2] + r, cell_max[2]);
+    for (int x = x0; x <= x1; x++)
+    for (int y = y0; y <= y1; y++)
+    {
+      // on the x / y faces of the shell the whole row, inside it only the
+      // two z caps
+      bool side = abs(x - q[0]) == r || abs(y - q[1]) == r;
+      for (int z = z0; z <= z1; z++)
+      {
+        if (!side && abs(z - q[2]) != r)
+        {
+          if (z > q[2] - r)
+          {
+            if (q[2] + r > z1)
+              break;
+            z = q[2] + r;
+          }
+          else
+            continue;
+        }
+        size_t b = hash(x, y, z);
+        for (unsigned int i = bucket_start[b]; i < bucket_start[b + 1]; i++)
+        {
+          float d[3];
+          sub3(&points[i].x, &point.x, d);
+          float d2 = dot3(d, d);
+          if (d2 < best2 || (d2 == best2 && !found))
+          {
+            best2 = d2;
+            found = true;
+            hit.index = point_index[i];
+            hit.position = points[i];
+          }
+        }
+      }
+    }
+  }
+  if (!found)
+    return false;
+  hit.distance = sqrtf(best2);
+  return true;
+}
+
+size_t vsx_point_grid::radius_query(const vsx_vector& point, float radius, unsigned int* out) const
+{
+  if (!points.size() || radius < 0.0f)
+    return 0;
+  float r2 = radius * radius;
+  size_t found = 0;
+  vsx_vector lo(point.x - radius, point.y - radius, point.z - radius);
+  vsx_vector hi(point.x + radius, point.y + radius, point.z + radius);
+  int c0[3], c1[3];
+  cell_of(lo, c0);
+  cell_of(hi, c1);
+  double cells = 1.0;
+  for (int k = 0; k < 3; k++)
+  {
+    c0[k] = std::max(c0[k], cell_min[k]);
+    c1[k] = std::min(c1[k], cell_max[k]);
+    if (c0[k] > c1[k])
+      return 0;
+    cells *= (double)(c1[k] - c0[k] + 1);
+  }
+
+  // a radius that covers most of the grid is cheaper as a plain scan
+  if (cells > (double)points.size())
+  {
+    for (size_t i = 0; i < points.size(); i++)
+    {
+      float d[3];
+      sub3(&points[i].x, &point.x, d);
+      if (dot3(d, d) <= r2)
+      {
+        if (out)
+          out[found] = point_index[i];
+        found++;
+      }
+    }
+    return found;
+  }
+
+  for (int x = c0[0]; x <= c1[0]; x++)
+  for (int y = c0[1]; y <= c1[1]; y++)
+  for (int z = c0[2]; z <= c1[2]; z++)
+  {
+    size_t b = hash(x, y, z);
+    for (unsigned int i = bucket_start[b]; i < bucket_start[b + 1]; i++)
+    {
+      float d[3];
+      sub3(&points[i].x, &point.x, d);
+      if (dot3(d, d) > r2)
+        continue;
+      // other cells hashing to the same bucket would report it twice, only
+      // take it from its own cell
+      int c[3];
+      cell_of(points[i], c);
+      if (c[0] != x || c[1] != y || c[2] != z)
+        continue;
+      if (out)
+        out[found] = point_index[i];
+      found++;
+    }
+  }
+  return found;
+}
+
+size_t vsx_point_grid::radius(const vsx_vector& point, float radius, std::vector<unsigned int>& result) const
+{
+  size_t count = radius_query(point, radius, 0);
+  size_t at = result.size();
+  result.resize(at + count);
+  if (count)
+    radius_query(point, radius, &result[at]);
+  return count;
+}
+
+class vsx_point_grid_query_job
+{
+public:
+  const vsx_point_grid* grid;
+  const vsx_vector* query;
+  float distance;
+  vsx_mesh_spatial_hit* hits;
+  unsigned int* offsets;
+  unsigned int* indices;
+};
+
+static void grid_nearest_task(void* arg, size_t start, size_t end)
+{
+  vsx_point_grid_query_job* j = (vsx_point_grid_query_job*)arg;
+  for (size_t i = start; i < end; i++)
+    j->grid->nearest(j->query[i], j->distance, j->hits[i]);
+}
+
+void vsx_point_grid::nearest_batch(const vsx_vector* query, size_t count, float max_distance, vsx_mesh_spatial_hit* hits) const
+{
+  vsx_point_grid_query_job j;
+  j.grid = this;
+  j.query = query;
+  j.distance = max_distance;
+  j.hits = hits;
+  vsx_thread_pool::get_instance()->parallel_for(count, VSX_MESH_SPATIAL_QUERY_CHUNK, &grid_nearest_task, (void*)&j);
+}
+
+// radius_batch runs twice: count into offsets[i + 1], then (after the
+// prefix sum) write from offsets[i]
+static void grid_radius_count_task(void* arg, size_t start, size_t end)
+{
+  vsx_point_grid_query_job* j = (vsx_point_grid_query_job*)arg;
+  for (size_t i = start; i < end; i++)
+    j->offsets[i + 1] = (unsigned int)j->grid->radius_query(j->query[i], j->distance, 0);
+}
+
+static void grid_radius_fill_task(void* arg, size_t start, size_t end)
+{
+  vsx_point_grid_query_job* j = (vsx_point_grid_query_job*)arg;
+  for (size_t i = start; i < end; i++)
+    j->grid->radius_query(j->query[i], j->distance, j->indices + j->offsets[i]);
+}
+
+void vsx_point_grid::radius_batch(const vsx_vector* query, size_t count, float radius, std::vector<unsigned int>& offsets, std::vector<unsigned int>& indices) const
+{
+  offsets.assign(count + 1, 0);
+  indices.clear();
+  if (!count)
+    return;
+  vsx_point_grid_query_job j;
+  j.grid = this;
+  j.query = query;
+  j.distance = radius;
+  j.offsets = &offsets[0];
+  j.indices = 0;
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+  pool->parallel_for(count, VSX_MESH_SPATIAL_QUERY_CHUNK, &grid_radius_count_task, (void*)&j);
+  for (size_t i = 0; i < count; i++)
+    offsets[i + 1] += offsets[i];
+  indices.resize(offsets[count]);
+  if (!indices.size())
+    return;
+  j.indices = &indices[0];
+  pool->parallel_for(count, VSX_MESH_SPATIAL_QUERY_CHUNK, &grid_radius_fill_task, (void*)&j);
+}
+
+float vsx_point_grid::get_cell_size() const
+{
+  return cell_size;
+}
+
+size_t vsx_point_grid::get_num_points() const
+{
+  return points.size();
+}
+
+
+//---------------------------------------------------------------------------
+// vsx_mesh_spatial
+
+vsx_mesh_spatial::vsx_mesh_spatial(vsx_mesh* n_mesh) :
+  mesh(n_mesh),
+  bvh_valid(false),
+  bvh_timestamp(0),
+  grid_valid(false),
+  grid_timestamp(0)
+{
+}
+
+vsx_mesh_spatial* vsx_mesh_spatial::get(vsx_mesh* mesh)
+{
+  if (!mesh->spatial)
+    mesh->spatial = new vsx_mesh_spatial(mesh);
+  return static_cast<vsx_mesh_spatial*>(mesh->spatial);
+}
+
+// the vertices as they'd be drawn, with a stacked transform applied
+static const vsx_vector* mesh_vertices(vsx_mesh_data* data, std::vector<vsx_vector>& scratch)
+{
+  if (!data->transform_pending)
+    return data->vertices.get_pointer();
+  vsx_matrix m = data->pending_transform;
+  scratch.resize(data->vertices.size());
+  for (size_t i = 0; i < scratch.size(); i++)
+    scratch[i] = m.multiply_vector(data->vertices[i]);
+  return scratch.size() ? &scratch[0] : 0;
+}
+
+vsx_bvh* vsx_mesh_spatial::get_bvh()
+{
+  if (bvh_valid && bvh_timestamp == mesh->timestamp)
+    return &bvh;
+  vsx_mesh_data* data = (vsx_mesh_data*)mesh->data;
+  std::vector<vsx_vector> scratch;
+  const vsx_vector* v = mesh_vertices(data, scratch);
+  bvh.build(v, data->vertices.size(), data->faces.get_pointer(), data->faces.size());
+  bvh_valid = true;
+  bvh_timestamp = mesh->timestamp;
+  return &bvh;
+}
+
+vsx_point_grid* vsx_mesh_spatial::get_vertex_grid()
+{
+  if (grid_valid && grid_timestamp == mesh->timestamp)
+    return &vertex_grid;
+  vsx_mesh_data* data = (vsx_mesh_data*)mesh->data;
+  std::vector<vsx_vector> scratch;
+  const vsx_vector* v = mesh_vertices(data, scratch);
+  vertex_grid.build(v, data->vertices.size());
+  grid_valid = true;
+  grid_timestamp = mesh->timestamp;
+  return &vertex_grid;
+}
@@ -0,0 +1,379 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <map>
+#include <vsx_platform.h>
+#include "vsxfst.h"
+#include "vsx_thread_pool.h"
+#include "vsx_metrics.h"
+
+const double vsx_metrics_histogram::bounds[VSX_METRICS_HISTOGRAM_BUCKETS] =
+{
+  0.004, 0.008, 0.0125, 0.0167, 0.02, 0.025, 0.0333, 0.05, 0.0667, 0.1, 0.25, 1.0
+};
+
+vsx_metrics_histogram::vsx_metrics_histogram()
+:
+  count(0),
+  sum(0.0)
+{
+  memset(counts, 0, sizeof(counts));
+}
+
+void vsx_metrics_histogram::add(double value)
+{
+  // the rest only shows in count (the +Inf bucket)
+  for (int i = 0; i < VSX_METRICS_HISTOGRAM_BUCKETS; i++)
+  {
+    if (value <= bounds[i])
+    {
+      counts[i]++;
+      break;
+    }
+  }
+  count++;
+  sum += value;
+}
+
+//---------------------------------------------------------------------------
+
+static vsx_string metrics_number(double value)
+{
+  if (value != value) return "NaN";
+  if (value > DBL_MAX) return "+Inf";
+  if (value < -DBL_MAX) return "-Inf";
+  char buf[64];
+  sprintf(buf, "%.10g", value);
+  return vsx_string(buf);
+}
+
+void vsx_metrics_writer::add(const vsx_string& family, const vsx_string& name, const vsx_string& labels, double value, const char* type)
+{
+  vsx_metrics_sample s;
+  s.family = family;
+  s.name = name;
+  s.labels = labels;
+  s.value = value;
+  s.type = type;
+  samples.push_back(s);
+}
+
+void vsx_metrics_writer::gauge(const vsx_string& name, double value, const vsx_string& labels)
+{
+  add(name, name, labels, value, "gauge");
+}
+
+void vsx_metrics_writer::counter(const vsx_string& name, double value, const vsx_string& labels)
+{
+  add(name, name, labels, value, "counter");
+}
+
+void vsx_metrics_writer::histogram(const vsx_string& name, const vsx_metrics_histogram& histogram, const vsx_string& labels)
+{
+  vsx_string sep = labels.size() ? "," : "";
+  unsigned long cumulative = 0;
+  for (int i = 0; i < VSX_METRICS_HISTOGRAM_BUCKETS; i++)
+  {
+    cumulative += histogram.counts[i];
+    add(name, name + "_bucket", labels + sep + "le=\"" + metrics_number(vsx_metrics_histogram::bounds[i]) + "\"", (double)cumulative, "histogram");
+  }
+  add(name, name + "_bucket", labels + sep + "le=\"+Inf\"", (double)histogram.count, "histogram");
+  add(name, name + "_sum", labels, histogram.sum, "histogram");
+  add(name, name + "_count", labels, (double)histogram.count, "histogram");
+}
+
+vsx_string vsx_metrics_writer::label(const vsx_string& name, const vsx_string& value)
+{
+  // the same escapes work for json, labels are copied over as they are
+  vsx_string res = name + "=\"";
+  for (size_t i = 0; i < value.size(); i++)
+  {
+    char c = value[i];
+    if (c == '"' || c == '\\')
+    {
+      res += '\\';
+      res += c;
+    }
+    else
+    if (c == '\n')
+      res += "\\n";
+    else
+    if ((unsigned char)c >= 32)
+      res += c;
+  }
+  return res + "\"";
+}
+
+vsx_string vsx_metrics_writer::get_prometheus()
+{
+  // all samples of a family have to come together after its TYPE line, the
+  // engines all add the same ones
+  std::vector<vsx_string> families;
+  std::map<vsx_string, std::vector<size_t> > by_family;
+  for (size_t i = 0; i < samples.size(); i++)
+  {
+    std::vector<size_t>& list = by_family[samples[i].family];
+    if (!list.size())
+      families.push_back(samples[i].family);
+    list.push_back(i);
+  }
+
+  vsx_string res;
+  for (size_t i = 0; i < families.size(); i++)
+  {
+    std::vector<size_t>& list = by_family[families[i]];
+    res += vsx_string("# TYPE ") + families[i] + " " + samples[list[0]].type + "\n";
+    for (size_t j = 0; j < list.size(); j++)
+    {
+      vsx_metrics_sample& s = samples[list[j]];
+      res += s.name;
+      if (s.labels.size())
+        res += vsx_string("{") + s.labels + "}";
+      res += vsx_string(" ") + metrics_number(s.value) + "\n";
+    }
+  }
+  return res;
+}
+
+// engine="1",phase="prepare" -> {"engine":"1","phase":"prepare"}
+static vsx_string metrics_json_labels(const vsx_string& labels)
+{
+  vsx_string res = "{";
+  bool in_value = false;
+  bool at_name = true;
+  for (size_t i = 0; i < labels.size(); i++)
+  {
+    char c = labels[i];
+    if (in_value)
+    {
+      res += c;
+      if (c == '\\' && i + 1 < labels.size())
+        res += labels[++i];
+      else
+      if (c == '"')
+        in_value = false;
+      continue;
+    }
+    if (at_name)
+    {
+      res += '"';
+      at_name = false;
+    }
+    if (c == '=')
+      res += "\":";
+    else
+    if (c == '"')
+    {
+      res += c;
+      in_value = true;
+    }
+    else
+    if (c == ',')
+    {
+      res += c;
+      at_name = true;
+    }
+    else
+      res += c;
+  }
+  return res + "}";
+}
+
+vsx_string vsx_metrics_writer::get_json()
+{
+  vsx_string res = "{\"metrics\":[";
+  for (size_t i = 0; i < samples.size(); i++)
+  {
+    vsx_metrics_sample& s = samples[i];
+    // no Inf / NaN in json
+    vsx_string value = metrics_number(s.value);
+    if (s.value != s.value || s.value > DBL_MAX || s.value < -DBL_MAX)
+      value = "null";
+    if (i) res += ",\n";
+    res += vsx_string("{\"name\":\"") + s.name + "\",\"type\":\"" + s.type + "\",\"labels\":" + metrics_json_labels(s.labels) + ",\"value\":" + value + "}";
+  }
+  return res + "]}\n";
+}
+
+//---------------------------------------------------------------------------
+
+static void metrics_global(vsx_metrics_writer& out, void* arg)
+{
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+  out.gauge("vsx_thread_pool_threads", (double)pool->get_num_threads());
+  out.gauge("vsx_thread_pool_queue", (double)pool->get_queue_size());
+  out.gauge("vsx_uptime_seconds", ((vsx_metrics*)arg)->get_uptime());
+}
+
+class vsx_metrics_file_task
+{
+public:
+  vsx_metrics* metrics;
+  vsx_string file_name;
+  vsx_string text;
+};
+
+vsx_metrics::vsx_metrics()
+:
+  interval(5.0),
+  last_write(0.0),
+  writing(false),
+  next_id(1)
+{
+  pthread_mutex_init(&mutex, NULL);
+  start_time = timer.atime();
+  const char* env = getenv("VSXU_METRICS_FILE");
+  if (env)
+    file_name = env;
+  env = getenv("VSXU_METRICS_INTERVAL");
+  if (env && atof(env) > 0.0)
+    interval = atof(env);
+  add_source(metrics_global, this);
+}
+
+static pthread_mutex_t instance_mutex = PTHREAD_MUTEX_INITIALIZER;
+static vsx_metrics* instance = 0;
+
+vsx_metrics* vsx_metrics::get_instance()
+{
+  pthread_mutex_lock(&instance_mutex);
+  // never deleted, engines can be torn down in any order at exit
+  if (!instance)
+    instance = new vsx_metrics();
+  pthread_mutex_unlock(&instance_mutex);
+  return instance;
+}
+
+void vsx_metrics::add_source(vsx_metrics_source func, void* arg)
+{
+  vsx_metrics_source_entry e;
+  e.func = func;
+  e.arg = arg;
+  pthread_mutex_lock(&mutex);
+  sources.push_back(e);
+  pthread_mutex_unlock(&mutex);
+}
+
+void vsx_metrics::remove_source(void* arg)
+{
+  pthread_mutex_lock(&mutex);
+  for (size_t i = 0; i < sources.size(); )
+  {
+    if (sources[i].arg == arg)
+      sources.erase(sources.begin() + i);
+    else
+      i++;
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+int vsx_metrics::get_id()
+{
+  pthread_mutex_lock(&mutex);
+  int id = next_id++;
+  pthread_mutex_unlock(&mutex);
+  return id;
+}
+
+double vsx_metrics::get_uptime()
+{
+  return timer.atime() - start_time;
+}
+
+void vsx_metrics::collect(vsx_metrics_writer& out)
+{
+  // held while the sources run so none of them can go away meanwhile
+  pthread_mutex_lock(&mutex);
+  for (size_t i = 0; i < sources.size(); i++)
+    sources[i].func(out, sources[i].arg);
+  pthread_mutex_unlock(&mutex);
+}
+
+vsx_string vsx_metrics::get(const vsx_string& format)
+{
+  vsx_metrics_writer out;
+  collect(out);
+  if (format == "json")
+    return out.get_json();
+  return out.get_prometheus();
+}
+
+void vsx_metrics::write_file(void* ptr)
+{
+  vsx_metrics_file_task* task = (vsx_metrics_file_task*)ptr;
+  // readers never see half a file
+  vsx_string temp_name = task->file_name + ".tmp";
+  FILE* f = fopen(temp_name.c_str(), "wb");
+  bool ok = false;
+  if (f)
+  {
+    ok = fwrite(task->text.c_str(), 1, task->text.size(), f) == task->text.size();
+    if (fclose(f) != 0) ok = false;
+    if (ok)
+    {
+      #if PLATFORM_FAMILY == PLATFORM_FAMILY_WINDOWS
+        remove(task->file_name.c_str());
+      #endif
+      ok = rename(temp_name.c_str(), task->file_name.c_str()) == 0;
+    }
+    if (!ok)
+      remove(temp_name.c_str());
+  }
+  if (!ok)
+    printf("vsx_metrics: can't write %s\n", task->file_name.c_str());
+
+  pthread_mutex_lock(&task->metrics->mutex);
+  task->metrics->writing = false;
+  pthread_mutex_unlock(&task->metrics->mutex);
+  delete task;
+}
+
+void vsx_metrics::tick()
+{
+  if (!file_name.size()) return;
+  double now = timer.atime();
+  pthread_mutex_lock(&mutex);
+  bool due = !writing && now - last_write >= interval;
+  if (due)
+  {
+    last_write = now;
+    writing = true;
+  }
+  pthread_mutex_unlock(&mutex);
+  if (!due) return;
+
+  // the sources are read here, on the frame's thread; only the disk work
+  // goes to the pool
+  vsx_metrics_file_task* task = new vsx_metrics_file_task;
+  task->metrics = this;
+  task->file_name = file_name;
+  size_t len = file_name.size();
+  bool json = len > 5 && file_name.substr((int)len - 5, 5) == ".json";
+  task->text = get(json ? "json" : "prometheus");
+  vsx_thread_pool::get_instance()->add_task(write_file, task);
+}
@@ -0,0 +1,426 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include "vsx_soft_body.h"
+#include "vsx_thread_pool.h"
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
+
+// smallest piece of work handed to one pool thread
+#define VSX_SOFT_BODY_CHUNK 2048
+// faces per partial sum when reducing the volume
+#define VSX_SOFT_BODY_VOLUME_CHUNK 16384
+// one bit per color in a 64 bit mask per vertex
+#define VSX_SOFT_BODY_MAX_COLORS 64
+// edges never get shorter than this in the force, a collapsed edge would
+// divide by 0
+#define VSX_SOFT_BODY_MIN_LENGTH 0.0001f
+
+class vsx_soft_body_job
+{
+public:
+  const vsx_soft_body_constraint* constraints;
+  size_t count;
+  vsx_vector* positions;
+  vsx_vector* speed;
+  float stiffness;
+  float pressure;
+  // vertex pass
+  const float* vertex_faces;
+  const float* vertex_wind;
+  size_t first_vertex;
+  vsx_vector face_acceleration;
+  vsx_vector wind;
+  float step_size;
+  float damping;
+  float floor_y;
+  // volume, one sum per chunk
+  double* volume_partial;
+};
+
+// the faces of one color, no two of them share a vertex
+static void faces_task(void* arg, size_t start, size_t end)
+{
+  vsx_soft_body_job* j = (vsx_soft_body_job*)arg;
+  const vsx_vector* p = j->positions;
+  vsx_vector* s = j->speed;
+  float k = j->stiffness;
+  size_t i = start;
+#ifdef __SSE2__
+  // 4 faces side by side, one per lane - they can't share vertices either
+  __m128 kk = _mm_set1_ps(k);
+  __m128 pressure = _mm_set1_ps(j->pressure);
+  __m128 min_length = _mm_set1_ps(VSX_SOFT_BODY_MIN_LENGTH);
+  for (; i + 4 <= end; i += 4)
+  {
+    const vsx_soft_body_constraint* f = j->constraints + i;
+    #define LANES(corner, axis) _mm_setr_ps(p[f[0].corner].axis, p[f[1].corner].axis, p[f[2].corner].axis, p[f[3].corner].axis)
+    #define REST(edge) _mm_setr_ps(f[0].edge, f[1].edge, f[2].edge, f[3].edge)
+    __m128 ax = LANES(a, x), ay = LANES(a, y), az = LANES(a, z);
+    __m128 bx = LANES(b, x), by = LANES(b, y), bz = LANES(b, z);
+    __m128 cx = LANES(c, x), cy = LANES(c, y), cz = LANES(c, z);
+    __m128 abx = _mm_sub_ps(bx, ax), aby = _mm_sub_ps(by, ay), abz = _mm_sub_ps(bz, az);
+    __m128 bcx = _mm_sub_ps(cx, bx), bcy = _mm_sub_ps(cy, by), bcz = _mm_sub_ps(cz, bz);
+    __m128 cax = _mm_sub_ps(ax, cx), cay = _mm_sub_ps(ay, cy), caz = _mm_sub_ps(az, cz);
+    __m128 len_ab = _mm_max_ps(min_length, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(abx, abx), _mm_mul_ps(aby, aby)), _mm_mul_ps(abz, abz))));
+    __m128 len_bc = _mm_max_ps(min_length, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(bcx, bcx), _mm_mul_ps(bcy, bcy)), _mm_mul_ps(bcz, bcz))));
+    __m128 len_ca = _mm_max_ps(min_length, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cax, cax), _mm_mul_ps(cay, cay)), _mm_mul_ps(caz, caz))));
+    __m128 rest_ab = REST(rest_ab), rest_bc = REST(rest_bc), rest_ca = REST(rest_ca);
+    __m128 s_ab = _mm_div_ps(_mm_mul_ps(_mm_sub_ps(rest_ab, len_ab), kk), _mm_mul_ps(rest_ab, len_ab));
+    __m128 s_bc = _mm_div_ps(_mm_mul_ps(_mm_sub_ps(rest_bc, len_bc), kk), _mm_mul_ps(rest_bc, len_bc));
+    __m128 s_ca = _mm_div_ps(_mm_mul_ps(_mm_sub_ps(rest_ca, len_ca), kk), _mm_mul_ps(rest_ca, len_ca));
+    #undef LANES
+    #undef REST
+    // normal = ab x -ca, times the pressure
+    __m128 nx = _mm_mul_ps(pressure, _mm_sub_ps(_mm_mul_ps(abz, cay), _mm_mul_ps(aby, caz)));
+    __m128 ny = _mm_mul_ps(pressure, _mm_sub_ps(_mm_mul_ps(abx, caz), _mm_mul_ps(abz, cax)));
+    __m128 nz = _mm_mul_ps(pressure, _mm_sub_ps(_mm_mul_ps(aby, cax), _mm_mul_ps(abx, cay)));
+    // what the corners lose: a: ab - ca, b: bc - ab, c: ca - bc, + normal
+    float da[3][4], db[3][4], dc[3][4];
+    __m128 acc_abx = _mm_mul_ps(abx, s_ab), acc_aby = _mm_mul_ps(aby, s_ab), acc_abz = _mm_mul_ps(abz, s_ab);
+    __m128 acc_bcx = _mm_mul_ps(bcx, s_bc), acc_bcy = _mm_mul_ps(bcy, s_bc), acc_bcz = _mm_mul_ps(bcz, s_bc);
+    __m128 acc_cax = _mm_mul_ps(cax, s_ca), acc_cay = _mm_mul_ps(cay, s_ca), acc_caz = _mm_mul_ps(caz, s_ca);
+    _mm_storeu_ps(da[0], _mm_add_ps(_mm_sub_ps(acc_abx, acc_cax), nx));
+    _mm_storeu_ps(da[1], _mm_add_ps(_mm_sub_ps(acc_aby, acc_cay), ny));
+    _mm_storeu_ps(da[2], _mm_add_ps(_mm_sub_ps(acc_abz, acc_caz), nz));
+    _mm_storeu_ps(db[0], _mm_add_ps(_mm_sub_ps(acc_bcx, acc_abx), nx));
+    _mm_storeu_ps(db[1], _mm_add_ps(_mm_sub_ps(acc_bcy, acc_aby), ny));
+    _mm_storeu_ps(db[2], _mm_add_ps(_mm_sub_ps(acc_bcz, acc_abz), nz));
+    _mm_storeu_ps(dc[0], _mm_add_ps(_mm_sub_ps(acc_cax, acc_bcx), nx));
+    _mm_storeu_ps(dc[1], _mm_add_ps(_mm_sub_ps(acc_cay, acc_bcy), ny));
+    _mm_storeu_ps(dc[2], _mm_add_ps(_mm_sub_ps(acc_caz, acc_bcz), nz));
+    for (size_t l = 0; l < 4; l++)
+    {
+      vsx_vector& sa = s[f[l].a];
+      sa.x -= da[0][l]; sa.y -= da[1][l]; sa.z -= da[2][l];
+      vsx_vector& sb = s[f[l].b];
+      sb.x -= db[0][l]; sb.y -= db[1][l]; sb.z -= db[2][l];
+      vsx_vector& sc = s[f[l].c];
+      sc.x -= dc[0][l]; sc.y -= dc[1][l]; sc.z -= dc[2][l];
+    }
+  }
+#endif
+  for (; i < end; i++)
+  {
+    const vsx_soft_body_constraint& f = j->constraints[i];
+    vsx_vector v0 = p[f.a];
+    vsx_vector v1 = p[f.b];
+    vsx_vector v2 = p[f.c];
+
+    vsx_vector edge_ab = v1 - v0;
+    vsx_vector edge_bc = v2 - v1;
+    vsx_vector edge_ca = v0 - v2;
+    float len_ab = edge_ab.length();
+    float len_bc = edge_bc.length();
+    float len_ca = edge_ca.length();
+    if (len_ab < VSX_SOFT_BODY_MIN_LENGTH) len_ab = VSX_SOFT_BODY_MIN_LENGTH;
+    if (len_bc < VSX_SOFT_BODY_MIN_LENGTH) len_bc = VSX_SOFT_BODY_MIN_LENGTH;
+    if (len_ca < VSX_SOFT_BODY_MIN_LENGTH) len_ca = VSX_SOFT_BODY_MIN_LENGTH;
+
+    // relative stretch over the length, times the edge
+    vsx_vector acc_ab = edge_ab * ((f.rest_ab - len_ab) / (f.rest_ab * len_ab) * k);
+    vsx_vector acc_bc = edge_bc * ((f.rest_bc - len_bc) / (f.rest_bc * len_bc) * k);
+    vsx_vector acc_ca = edge_ca * ((f.rest_ca - len_ca) / (f.rest_ca * len_ca) * k);
+
+    // area weighted normal
+    vsx_vector normal;
+    normal.cross(edge_ab, v2 - v0);
+    normal *= j->pressure;
+
+    s[f.a] -= acc_ab - acc_ca + normal;
+    s[f.b] -= acc_bc - acc_ab + normal;
+    s[f.c] -= acc_ca - acc_bc + normal;
+  }
+}
+
+static void volume_task(void* arg, size_t start, size_t end)
+{
+  vsx_soft_body_job* j = (vsx_soft_body_job*)arg;
+  const vsx_vector* p = j->positions;
+  for (size_t c = start; c < end; c++)
+  {
+    size_t first = c * VSX_SOFT_BODY_VOLUME_CHUNK;
+    size_t last = first + VSX_SOFT_BODY_VOLUME_CHUNK;
+    if (last > j->count)
+      last = j->count;
+    double sum = 0.0;
+    for (size_t i = first; i < last; i++)
+    {
+      const vsx_soft_body_constraint& f = j->constraints[i];
+      const vsx_vector& v0 = p[f.a];
+      const vsx_vector& v2 = p[f.b];
+      const vsx_vector& v1 = p[f.c];
+      sum += (v0.x * (v1.y - v2.y) +
+              v1.x * (v2.y - v0.y) +
+              v2.x * (v0.y - v1.y)) * (v0.z + v1.z + v2.z);
+    }
+    j->volume_partial[c] = sum / 6.0;
+  }
+}
+
+// speed += accelerations, position += speed * step, floor, damping
+static void vertices_task(void* arg, size_t start, size_t end)
+{
+  vsx_soft_body_job* j = (vsx_soft_body_job*)arg;
+  start += j->first_vertex;
+  end += j->first_vertex;
+  vsx_vector* p = j->positions;
+  vsx_vector* s = j->speed;
+  const float* nf = j->vertex_faces;
+  const float* nw = j->vertex_wind;
+  vsx_vector ga = j->face_acceleration;
+  vsx_vector w = j->wind;
+  size_t i = start;
+#ifdef __SSE2__
+  // 4 vertices are 3 registers of floats, xyzx yzxy zxyz
+  __m128 h = _mm_set1_ps(j->step_size);
+  __m128 d = _mm_set1_ps(j->damping);
+  __m128 ga0 = _mm_setr_ps(ga.x, ga.y, ga.z, ga.x);
+  __m128 ga1 = _mm_setr_ps(ga.y, ga.z, ga.x, ga.y);
+  __m128 ga2 = _mm_setr_ps(ga.z, ga.x, ga.y, ga.z);
+  __m128 w0 = _mm_setr_ps(w.x, w.y, w.z, w.x);
+  __m128 w1 = _mm_setr_ps(w.y, w.z, w.x, w.y);
+  __m128 w2 = _mm_setr_ps(w.z, w.x, w.y, w.z);
+  // the floor only in the y lanes
+  float fy = j->floor_y;
+  __m128 fl0 = _mm_setr_ps(-FLT_MAX, fy, -FLT_MAX, -FLT_MAX);
+  __m128 fl1 = _mm_setr_ps(fy, -FLT_MAX, -FLT_MAX, fy);
+  __m128 fl2 = _mm_setr_ps(-FLT_MAX, -FLT_MAX, fy, -FLT_MAX);
+  for (; i + 4 <= end; i += 4)
+  {
+    float* pp = &p[i].x;
+    float* sp = &s[i].x;
+    __m128 n = _mm_loadu_ps(nf + i);
+    __m128 s0 = _mm_add_ps(_mm_loadu_ps(sp), _mm_mul_ps(ga0, _mm_shuffle_ps(n, n, _MM_SHUFFLE(1, 0, 0, 0))));
+    __m128 s1 = _mm_add_ps(_mm_loadu_ps(sp + 4), _mm_mul_ps(ga1, _mm_shuffle_ps(n, n, _MM_SHUFFLE(2, 2, 1, 1))));
+    __m128 s2 = _mm_add_ps(_mm_loadu_ps(sp + 8), _mm_mul_ps(ga2, _mm_shuffle_ps(n, n, _MM_SHUFFLE(3, 3, 3, 2))));
+    if (nw)
+    {
+      n = _mm_loadu_ps(nw + i);
+      s0 = _mm_add_ps(s0, _mm_mul_ps(w0, _mm_shuffle_ps(n, n, _MM_SHUFFLE(1, 0, 0, 0))));
+      s1 = _mm_add_ps(s1, _mm_mul_ps(w1, _mm_shuffle_ps(n, n, _MM_SHUFFLE(2, 2, 1, 1))));
+      s2 = _mm_add_ps(s2, _mm_mul_ps(w2, _mm_shuffle_ps(n, n, _MM_SHUFFLE(3, 3, 3, 2))));
+    }
+    _mm_storeu_ps(pp, _mm_max_ps(fl0, _mm_add_ps(_mm_loadu_ps(pp), _mm_mul_ps(s0, h))));
+    _mm_storeu_ps(pp + 4, _mm_max_ps(fl1, _mm_add_ps(_mm_loadu_ps(pp + 4), _mm_mul_ps(s1, h))));
+    _mm_storeu_ps(pp + 8, _mm_max_ps(fl2, _mm_add_ps(_mm_loadu_ps(pp + 8), _mm_mul_ps(s2, h))));
+    _mm_storeu_ps(sp, _mm_mul_ps(s0, d));
+    _mm_storeu_ps(sp + 4, _mm_mul_ps(s1, d));
+    _mm_storeu_ps(sp + 8, _mm_mul_ps(s2, d));
+  }
+#endif
+  for (; i < end; i++)
+  {
+    s[i] += ga * nf[i];
+    if (nw)
+      s[i] += w * nw[i];
+    p[i] += s[i] * j->step_size;
+    if (p[i].y < j->floor_y)
+      p[i].y = j->floor_y;
+    s[i] = s[i] * j->damping;
+  }
+}
+
+vsx_soft_body::vsx_soft_body()
+{
+  serial_start = 0;
+  step_size = 0.01f;
+  stiffness = 1.0f;
+  damping = 0.98f;
+  gas_amount = 0.0f;
+  gas_expansion = 0.0f;
+  face_acceleration = vsx_vector(0.0f, 0.0f, 0.0f);
+  wind = vsx_vector(0.0f, 0.0f, 0.0f);
+  floor_y = -FLT_MAX;
+  pinned = 0;
+  volume = 0.0f;
+  pressure = 0.0f;
+}
+
+void vsx_soft_body::build(const vsx_face* faces, size_t face_count, const vsx_vector* positions, size_t vertex_count, const vsx_vector* rest_lengths, const float* face_wind)
+{
+  speed.assign(vertex_count, vsx_vector(0.0f, 0.0f, 0.0f));
+  vertex_faces.assign(vertex_count, 0.0f);
+  vertex_wind.clear();
+  if (face_wind)
+    vertex_wind.assign(vertex_count, 0.0f);
+
+  // greedy, every face gets the lowest color none of its vertices has yet;
+  // a triangle mesh ends up with around 12-16
+  std::vector<uint64_t> used(vertex_count, 0);
+  std::vector<unsigned char> color(face_count, 0xFF);
+  std::vector<size_t> color_count(VSX_SOFT_BODY_MAX_COLORS + 1, 0);
+  size_t num_colors = 0;
+  for (size_t i = 0; i < face_count; i++)
+  {
+    const vsx_face& f = faces[i];
+    if (f.a >= vertex_count || f.b >= vertex_count || f.c >= vertex_count)
+      continue;
+    uint64_t taken = used[f.a] | used[f.b] | used[f.c];
+    size_t c = 0;
+    while (c < VSX_SOFT_BODY_MAX_COLORS && (taken & ((uint64_t)1 << c)))
+      c++;
+    if (c < VSX_SOFT_BODY_MAX_COLORS)
+    {
+      used[f.a] |= (uint64_t)1 << c;
+      used[f.b] |= (uint64_t)1 << c;
+      used[f.c] |= (uint64_t)1 << c;
+      if (c + 1 > num_colors)
+        num_colors = c + 1;
+    }
+    color[i] = (unsigned char)c;
+    color_count[c]++;
+    vertex_faces[f.a] += 1.0f;
+    vertex_faces[f.b] += 1.0f;
+    vertex_faces[f.c] += 1.0f;
+    if (face_wind)
+    {
+      vertex_wind[f.a] += face_wind[i];
+      vertex_wind[f.b] += face_wind[i];
+      vertex_wind[f.c] += face_wind[i];
+    }
+  }
+
+  // the faces without a color go after the last one
+  color_start.assign(num_colors + 1, 0);
+  for (size_t c = 0; c < num_colors; c++)
+    color_start[c + 1] = color_start[c] + color_count[c];
+  serial_start = color_start[num_colors];
+  constraints.resize(serial_start + color_count[VSX_SOFT_BODY_MAX_COLORS]);
+
+  std::vector<size_t> cursor(color_start.begin(), color_start.end() - 1);
+  cursor.resize(VSX_SOFT_BODY_MAX_COLORS + 1, 0);
+  cursor[VSX_SOFT_BODY_MAX_COLORS] = serial_start;
+  for (size_t i = 0; i < face_count; i++)
+  {
+    if (color[i] == 0xFF)
+      continue;
+    const vsx_face& f = faces[i];
+    vsx_soft_body_constraint& con = constraints[cursor[color[i]]++];
+    con.a = f.a;
+    con.b = f.b;
+    con.c = f.c;
+    if (rest_lengths)
+    {
+      con.rest_ab = rest_lengths[i].x;
+      con.rest_bc = rest_lengths[i].y;
+      con.rest_ca = rest_lengths[i].z;
+    }
+    else
+    {
+      vsx_vector v0 = positions[f.a];
+      vsx_vector v1 = positions[f.b];
+      vsx_vector v2 = positions[f.c];
+      con.rest_ab = (v1 - v0).length();
+      con.rest_bc = (v2 - v1).length();
+      con.rest_ca = (v0 - v2).length();
+    }
+    if (con.rest_ab < VSX_SOFT_BODY_MIN_LENGTH) con.rest_ab = VSX_SOFT_BODY_MIN_LENGTH;
+    if (con.rest_bc < VSX_SOFT_BODY_MIN_LENGTH) con.rest_bc = VSX_SOFT_BODY_MIN_LENGTH;
+    if (con.rest_ca < VSX_SOFT_BODY_MIN_LENGTH) con.rest_ca = VSX_SOFT_BODY_MIN_LENGTH;
+  }
+}
+
+void vsx_soft_body::set_speed(const vsx_vector& v)
+{
+  speed.assign(speed.size(), v);
+}
+
+float vsx_soft_body::calculate_volume(const vsx_vector* positions)
+{
+  if (constraints.empty())
+    return 0.0f;
+  size_t chunks = (constraints.size() + VSX_SOFT_BODY_VOLUME_CHUNK - 1) / VSX_SOFT_BODY_VOLUME_CHUNK;
+  volume_partial.resize(chunks);
+
+  vsx_soft_body_job j;
+  j.constraints = &constraints[0];
+  j.count = constraints.size();
+  j.positions = (vsx_vector*)positions;
+  j.volume_partial = &volume_partial[0];
+  vsx_thread_pool::get_instance()->parallel_for(chunks, 1, &volume_task, (void*)&j);
+
+  // in chunk order, the same result however the work was split
+  double sum = 0.0;
+  for (size_t c = 0; c < chunks; c++)
+    sum += volume_partial[c];
+  return (float)sum;
+}
+
+void vsx_soft_body::step(vsx_vector* positions)
+{
+  size_t vertex_count = speed.size();
+  if (!vertex_count)
+    return;
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+
+  volume = calculate_volume(positions);
+  pressure = volume != 0.0f ? (gas_amount - volume) / volume : 0.0f;
+
+  vsx_soft_body_job j;
+  j.positions = positions;
+  j.speed = &speed[0];
+  j.stiffness = stiffness;
+  j.pressure = pressure * gas_expansion;
+
+  for (size_t c = 0; c + 1 < color_start.size(); c++)
+  {
+    j.constraints = &constraints[0] + color_start[c];
+    pool->parallel_for(color_start[c + 1] - color_start[c], VSX_SOFT_BODY_CHUNK, &faces_task, (void*)&j);
+  }
+  if (serial_start < constraints.size())
+  {
+    j.constraints = &constraints[0] + serial_start;
+    faces_task((void*)&j, 0, constraints.size() - serial_start);
+  }
+
+  // the pinned vertices don't keep what they got
+  size_t first = pinned < vertex_count ? pinned : vertex_count;
+  for (size_t i = 0; i < first; i++)
+    speed[i] = vsx_vector(0.0f, 0.0f, 0.0f);
+  if (first == vertex_count)
+    return;
+  j.vertex_faces = &vertex_faces[0];
+  j.vertex_wind = vertex_wind.empty() ? 0 : &vertex_wind[0];
+  j.first_vertex = pinned;
+  j.face_acceleration = face_acceleration;
+  j.wind = wind;
+  j.step_size = step_size;
+  j.damping = damping;
+  j.floor_y = floor_y;
+  pool->parallel_for(vertex_count - pinned, VSX_SOFT_BODY_CHUNK, &vertices_task, (void*)&j);
+}
+
+size_t vsx_soft_body::get_num_colors()
+{
+  return (color_start.size() ? color_start.size() - 1 : 0) + (serial_start < constraints.size() ? 1 : 0);
+}
+
+size_t vsx_soft_body::get_num_vertices()
+{
+  return speed.size();
+}
@@ -0,0 +1,305 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <string.h>
+#include "vsx_sort.h"
+#include "vsx_thread_pool.h"
+
+#define VSX_SORT_RADIX_BITS 11
+#define VSX_SORT_RADIX_SIZE (1 << VSX_SORT_RADIX_BITS)
+#define VSX_SORT_RADIX_MASK (VSX_SORT_RADIX_SIZE - 1)
+// below this the radix passes run on the calling thread
+#define VSX_SORT_PARALLEL_MIN 65536
+// more runs than this in the last order and merging isn't worth it
+#define VSX_SORT_MAX_MERGE_RUNS 32
+// insertion sort gives up after this many moves per item
+#define VSX_SORT_INSERTION_MOVES 8
+
+class vsx_sort_radix_job
+{
+public:
+  const unsigned int* src_keys;
+  // 0 on the first pass, the items are still 0 .. count - 1
+  const unsigned int* src_items;
+  unsigned int* dst_keys;
+  unsigned int* dst_items;
+  size_t count;
+  size_t slices;
+  unsigned int shift;
+  // one table per slice: counts after the histogram pass, write offsets
+  // for the scatter pass
+  size_t* histograms;
+};
+
+inline size_t slice_start(vsx_sort_radix_job* j, size_t slice)
+{
+  return j->count * slice / j->slices;
+}
+
+static void histogram_task(void* arg, size_t start, size_t end)
+{
+  vsx_sort_radix_job* j = (vsx_sort_radix_job*)arg;
+  for (size_t s = start; s < end; s++)
+  {
+    size_t* h = j->histograms + s * VSX_SORT_RADIX_SIZE;
+    memset(h, 0, sizeof(size_t) * VSX_SORT_RADIX_SIZE);
+    size_t last = slice_start(j, s + 1);
+    for (size_t i = slice_start(j, s); i < last; i++)
+      h[(j->src_keys[i] >> j->shift) & VSX_SORT_RADIX_MASK]++;
+  }
+}
+
+static void scatter_task(void* arg, size_t start, size_t end)
+{
+  vsx_sort_radix_job* j = (vsx_sort_radix_job*)arg;
+  for (size_t s = start; s < end; s++)
+  {
+    size_t* h = j->histograms + s * VSX_SORT_RADIX_SIZE;
+    size_t last = slice_start(j, s + 1);
+    for (size_t i = slice_start(j, s); i < last; i++)
+    {
+      unsigned int key = j->src_keys[i];
+      size_t o = h[(key >> j->shift) & VSX_SORT_RADIX_MASK]++;
+      j->dst_keys[o] = key;
+      j->dst_items[o] = j->src_items ? j->src_items[i] : (unsigned int)i;
+    }
+  }
+}
+
+vsx_sort_float::vsx_sort_float()
+{
+  last_method = VSX_SORT_RADIX;
+}
+
+void vsx_sort_float::reset()
+{
+  order.clear();
+}
+
+const unsigned int* vsx_sort_float::sort(const float* item_keys, size_t count, bool descending)
+{
+  // IEEE floats compare like integers once the negative ones have all
+  // their bits flipped and the positive ones just the sign
+  keys.resize(count);
+  unsigned int flip = descending ? 0xFFFFFFFF : 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    unsigned int u;
+    memcpy(&u, &item_keys[i], sizeof(u));
+    u ^= (u & 0x80000000) ? 0xFFFFFFFF : 0x80000000;
+    keys[i] = u ^ flip;
+  }
+  if (!count)
+  {
+    order.clear();
+    last_method = VSX_SORT_UNCHANGED;
+    return 0;
+  }
+
+  if (order.size() == count)
+  {
+    const unsigned int* k = &keys[0];
+    const unsigned int* o = &order[0];
+    run_starts.clear();
+    run_starts.push_back(0);
+    // a run break every few items means the camera jumped, not moved - stop
+    // counting as soon as that shows, the radix sort doesn't need it
+    bool scattered = false;
+    for (size_t i = 1; i < count && !scattered; i++)
+      if (k[o[i - 1]] > k[o[i]])
+      {
+        run_starts.push_back(i);
+        scattered = run_starts.size() * 4 > i + 256;
+      }
+    size_t runs = run_starts.size();
+    if (scattered)
+      runs = count;
+    if (runs == 1)
+    {
+      last_method = VSX_SORT_UNCHANGED;
+      return &order[0];
+    }
+    if (runs <= VSX_SORT_MAX_MERGE_RUNS)
+    {
+      sort_runs();
+      last_method = VSX_SORT_MERGE;
+      return &order[0];
+    }
+    if (runs < count / 4 && sort_insertion(count * VSX_SORT_INSERTION_MOVES))
+    {
+      last_method = VSX_SORT_INSERTION;
+      return &order[0];
+    }
+  }
+  sort_radix();
+  last_method = VSX_SORT_RADIX;
+  return &order[0];
+}
+
+// bottom up merge of the runs found in the last order
+void vsx_sort_float::sort_runs()
+{
+  size_t count = order.size();
+  const unsigned int* k = &keys[0];
+  order_tmp.resize(count);
+  unsigned int* src = &order[0];
+  unsigned int* dst = &order_tmp[0];
+  std::vector<size_t>& rs = run_starts;
+  rs.push_back(count);
+  while (rs.size() > 2)
+  {
+    size_t w = 0;
+    size_t r = 0;
+    for (; r + 2 < rs.size(); r += 2)
+    {
+      size_t i = rs[r];
+      size_t mid = rs[r + 1];
+      size_t j = mid;
+      size_t end = rs[r + 2];
+      size_t o = i;
+      rs[w++] = i;
+      while (i < mid && j < end)
+      {
+        // left first on equal keys, keeps it stable
+        if (k[src[j]] < k[src[i]])
+          dst[o++] = src[j++];
+        else
+          dst[o++] = src[i++];
+      }
+      while (i < mid)
+        dst[o++] = src[i++];
+      while (j < end)
+        dst[o++] = src[j++];
+    }
+    if (r + 1 < rs.size())
+    {
+      memcpy(dst + rs[r], src + rs[r], sizeof(unsigned int) * (rs[r + 1] - rs[r]));
+      rs[w++] = rs[r];
+    }
+    rs[w++] = count;
+    rs.resize(w);
+    unsigned int* t = src;
+    src = dst;
+    dst = t;
+  }
+  if (src != &order[0])
+    order.swap(order_tmp);
+}
+
+bool vsx_sort_float::sort_insertion(size_t max_moves)
+{
+  size_t count = order.size();
+  const unsigned int* k = &keys[0];
+  unsigned int* o = &order[0];
+  size_t moves = 0;
+  for (size_t i = 1; i < count; i++)
+  {
+    unsigned int item = o[i];
+    unsigned int key = k[item];
+    size_t j = i;
+    while (j > 0 && k[o[j - 1]] > key)
+    {
+      o[j] = o[j - 1];
+      j--;
+    }
+    o[j] = item;
+    moves += i - j;
+    // what's left is a valid order, the radix sort starts over anyway
+    if (moves > max_moves)
+      return false;
+  }
+  return true;
+}
+
+void vsx_sort_float::sort_radix()
+{
+  size_t count = keys.size();
+  order.resize(count);
+  order_tmp.resize(count);
+  radix_keys.resize(count);
+  radix_keys_tmp.resize(count);
+
+  size_t slices = 1;
+  if (count >= VSX_SORT_PARALLEL_MIN)
+  {
+    slices = vsx_thread_pool::get_num_cores() * 4;
+    if (slices > 64)
+      slices = 64;
+  }
+  histograms.resize(slices * VSX_SORT_RADIX_SIZE);
+
+  vsx_sort_radix_job j;
+  j.count = count;
+  j.slices = slices;
+  j.histograms = &histograms[0];
+  j.src_keys = &keys[0];
+  j.src_items = 0;
+  unsigned int* key_buffers[2] = { &radix_keys[0], &radix_keys_tmp[0] };
+  unsigned int* item_buffers[2] = { &order[0], &order_tmp[0] };
+  int target = 0;
+
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+  for (unsigned int shift = 0; shift < 32; shift += VSX_SORT_RADIX_BITS)
+  {
+    j.shift = shift;
+    pool->parallel_for(slices, 1, &histogram_task, (void*)&j);
+
+    // counts -> offsets, slice by slice within each digit so equal keys
+    // keep their order
+    bool skip = false;
+    size_t sum = 0;
+    for (size_t d = 0; d < VSX_SORT_RADIX_SIZE; d++)
+    {
+      size_t total = 0;
+      for (size_t s = 0; s < slices; s++)
+      {
+        size_t& h = histograms[s * VSX_SORT_RADIX_SIZE + d];
+        size_t c = h;
+        h = sum;
+        sum += c;
+        total += c;
+      }
+      if (total == count)
+        skip = true;
+    }
+    if (skip)
+      continue;
+
+    j.dst_keys = key_buffers[target];
+    j.dst_items = item_buffers[target];
+    pool->parallel_for(slices, 1, &scatter_task, (void*)&j);
+    j.src_keys = j.dst_keys;
+    j.src_items = j.dst_items;
+    target ^= 1;
+  }
+
+  if (!j.src_items)
+  {
+    // all keys the same
+    for (size_t i = 0; i < count; i++)
+      order[i] = (unsigned int)i;
+    return;
+  }
+  if (j.src_items != &order[0])
+    order.swap(order_tmp);
+}
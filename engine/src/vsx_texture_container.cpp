@@ -0,0 +1,351 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "vsx_texture_container.h"
+
+#define VXT_HEADER_SIZE 24
+#define VXT_LEVEL_HEADER_SIZE 12
+// more than enough for 2^31 x 2^31
+#define VXT_MAX_LEVELS 32
+
+vsx_texture_container::vsx_texture_container()
+{
+  format = VSX_TEXTURE_CONTAINER_RGBA8;
+  flags = 0;
+  size_x = 0;
+  size_y = 0;
+  error = 0;
+}
+
+vsx_texture_container::~vsx_texture_container()
+{
+  clear();
+}
+
+void vsx_texture_container::clear()
+{
+  for (size_t i = 0; i < levels.size(); i++)
+    free(levels[i].data);
+  levels.clear();
+  size_x = size_y = 0;
+}
+
+uint16_t vsx_texture_container::float_to_half(float f)
+{
+  union { float f; uint32_t u; } v;
+  v.f = f;
+  uint32_t sign = (v.u >> 16) & 0x8000;
+  uint32_t fexp = (v.u >> 23) & 0xff;
+  uint32_t mant = v.u & 0x7fffff;
+  if (fexp == 0xff)
+    return sign | 0x7c00 | (mant ? 0x200 : 0); // inf / nan
+  int32_t exp = (int32_t)fexp - 127 + 15;
+  if (exp >= 31)
+    return sign | 0x7c00;
+  if (exp <= 0)
+  {
+    // denormal half (or zero)
+    if (exp < -10)
+      return sign;
+    mant |= 0x800000;
+    uint32_t shift = 14 - exp;
+    uint32_t h = mant >> shift;
+    uint32_t rem = mant & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rem > halfway || (rem == halfway && (h & 1)))
+      h++;
+    return sign | h;
+  }
+  // round to nearest even, a carry out of the mantissa bumps the exponent
+  // which is exactly what we want (up to inf)
+  uint32_t h = ((uint32_t)exp << 10) | (mant >> 13);
+  uint32_t rem = mant & 0x1fff;
+  if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+    h++;
+  return sign | h;
+}
+
+float vsx_texture_container::half_to_float(uint16_t h)
+{
+  union { float f; uint32_t u; } v;
+  uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  int32_t exp = (h >> 10) & 0x1f;
+  uint32_t mant = h & 0x3ff;
+  if (exp == 0)
+  {
+    if (mant == 0)
+    {
+      v.u = sign;
+      return v.f;
+    }
+    exp = 1;
+    while (!(mant & 0x400))
+    {
+      mant <<= 1;
+      exp--;
+    }
+    mant &= 0x3ff;
+  } else
+  if (exp == 31)
+  {
+    v.u = sign | 0x7f800000 | (mant << 13);
+    return v.f;
+  }
+  v.u = sign | ((uint32_t)(exp + 112) << 23) | (mant << 13);
+  return v.f;
+}
+
+// 2x2 box filter, odd sizes reuse the last row/column
+static void downsample_rgba8(const unsigned char* src, unsigned long sx, unsigned long sy, unsigned char* dst, unsigned long dx, unsigned long dy)
+{
+  for (unsigned long y = 0; y < dy; y++)
+  {
+    const unsigned char* r0 = src + (y * 2) * sx * 4;
+    const unsigned char* r1 = src + (y * 2 + 1 < sy ? y * 2 + 1 : sy - 1) * sx * 4;
+    for (unsigned long x = 0; x < dx; x++)
+    {
+      unsigned long x0 = x * 2 * 4;
+      unsigned long x1 = (x * 2 + 1 < sx ? x * 2 + 1 : sx - 1) * 4;
+      for (int c = 0; c < 4; c++)
+        *dst++ = (unsigned char)((r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c] + 2) >> 2);
+    }
+  }
+}
+
+static void downsample_float(const float* src, unsigned long sx, unsigned long sy, float* dst, unsigned long dx, unsigned long dy)
+{
+  for (unsigned long y = 0; y < dy; y++)
+  {
+    const float* r0 = src + (y * 2) * sx * 4;
+    const float* r1 = src + (y * 2 + 1 < sy ? y * 2 + 1 : sy - 1) * sx * 4;
+    for (unsigned long x = 0; x < dx; x++)
+    {
+      unsigned long x0 = x * 2 * 4;
+      unsigned long x1 = (x * 2 + 1 < sx ? x * 2 + 1 : sx - 1) * 4;
+      for (int c = 0; c < 4; c++)
+        *dst++ = (r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c]) * 0.25f;
+    }
+  }
+}
+
+bool vsx_texture_container::build(const unsigned char* rgba, unsigned long n_size_x, unsigned long n_size_y, int n_format, bool mipmaps)
+{
+  clear();
+  if (!rgba || !n_size_x || !n_size_y)
+    return false;
+  if (n_format != VSX_TEXTURE_CONTAINER_RGBA8 && n_format != VSX_TEXTURE_CONTAINER_RGBA16F)
+    return false;
+  format = n_format;
+  flags = VSX_TEXTURE_CONTAINER_FLAG_FLIPPED;
+  size_x = n_size_x;
+  size_y = n_size_y;
+
+  // level 0, flipped
+  unsigned long row = size_x * 4;
+  unsigned char* base = (unsigned char*)malloc(row * size_y);
+  if (!base)
+    return false;
+  for (unsigned long y = 0; y < size_y; y++)
+    memcpy(base + y * row, rgba + (size_y - 1 - y) * row, row);
+
+  vsx_texture_container_level l;
+  if (format == VSX_TEXTURE_CONTAINER_RGBA8)
+  {
+    l.size_x = size_x;
+    l.size_y = size_y;
+    l.data_size = row * size_y;
+    l.data = base;
+    levels.push_back(l);
+    while (mipmaps && (l.size_x > 1 || l.size_y > 1))
+    {
+      vsx_texture_container_level n;
+      n.size_x = l.size_x > 1 ? l.size_x / 2 : 1;
+      n.size_y = l.size_y > 1 ? l.size_y / 2 : 1;
+      n.data_size = n.size_x * n.size_y * 4;
+      n.data = malloc(n.data_size);
+      downsample_rgba8((unsigned char*)l.data, l.size_x, l.size_y, (unsigned char*)n.data, n.size_x, n.size_y);
+      levels.push_back(n);
+      l = n;
+    }
+    return true;
+  }
+
+  // RGBA16F: filter in float, store as half
+  unsigned long num = size_x * size_y * 4;
+  float* cur = (float*)malloc(num * sizeof(float));
+  for (unsigned long i = 0; i < num; i++)
+    cur[i] = (float)base[i] * (1.0f / 255.0f);
+  free(base);
+  unsigned long cx = size_x, cy = size_y;
+  while (1)
+  {
+    l.size_x = cx;
+    l.size_y = cy;
+    l.data_size = cx * cy * 4 * sizeof(uint16_t);
+    l.data = malloc(l.data_size);
+    for (unsigned long i = 0; i < cx * cy * 4; i++)
+      ((uint16_t*)l.data)[i] = float_to_half(cur[i]);
+    levels.push_back(l);
+    if (!mipmaps || (cx == 1 && cy == 1))
+      break;
+    unsigned long nx = cx > 1 ? cx / 2 : 1;
+    unsigned long ny = cy > 1 ? cy / 2 : 1;
+    float* next = (float*)malloc(nx * ny * 4 * sizeof(float));
+    downsample_float(cur, cx, cy, next, nx, ny);
+    free(cur);
+    cur = next;
+    cx = nx;
+    cy = ny;
+  }
+  free(cur);
+  return true;
+}
+
+static void put_u32(unsigned char*& p, uint32_t v)
+{
+  p[0] = (unsigned char)v;
+  p[1] = (unsigned char)(v >> 8);
+  p[2] = (unsigned char)(v >> 16);
+  p[3] = (unsigned char)(v >> 24);
+  p += 4;
+}
+
+static uint32_t get_u32(const unsigned char*& p)
+{
+  uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  p += 4;
+  return v;
+}
+
+static bool host_little_endian()
+{
+  uint32_t v = 1;
+  return *(unsigned char*)&v == 1;
+}
+
+// RGBA8 is bytes either way, RGBA16F halves are stored little endian
+static void copy_pixels(void* dest, const void* src, unsigned long size, int format)
+{
+  if (format != VSX_TEXTURE_CONTAINER_RGBA16F || host_little_endian())
+  {
+    memcpy(dest, src, size);
+    return;
+  }
+  const unsigned char* s = (const unsigned char*)src;
+  unsigned char* d = (unsigned char*)dest;
+  for (unsigned long i = 0; i + 1 < size; i += 2)
+  {
+    d[i] = s[i + 1];
+    d[i + 1] = s[i];
+  }
+}
+
+unsigned char* vsx_texture_container::serialize(unsigned long& size)
+{
+  size = VXT_HEADER_SIZE;
+  for (size_t i = 0; i < levels.size(); i++)
+    size += VXT_LEVEL_HEADER_SIZE + levels[i].data_size;
+  unsigned char* out = (unsigned char*)malloc(size);
+  if (!out)
+    return 0;
+  unsigned char* p = out;
+  memcpy(p, "VXT1", 4);
+  p += 4;
+  put_u32(p, format);
+  put_u32(p, flags);
+  put_u32(p, size_x);
+  put_u32(p, size_y);
+  put_u32(p, levels.size());
+  for (size_t i = 0; i < levels.size(); i++)
+  {
+    put_u32(p, levels[i].size_x);
+    put_u32(p, levels[i].size_y);
+    put_u32(p, levels[i].data_size);
+    copy_pixels(p, levels[i].data, levels[i].data_size, format);
+    p += levels[i].data_size;
+  }
+  return out;
+}
+
+bool vsx_texture_container::load_memory(const unsigned char* data, unsigned long size)
+{
+  clear();
+  error = 0;
+  if (!data || size < VXT_HEADER_SIZE || memcmp(data, "VXT", 3) != 0)
+  {
+    error = "not a vxt file";
+    return false;
+  }
+  if (data[3] != '1')
+  {
+    error = "unsupported vxt version";
+    return false;
+  }
+  const unsigned char* p = data + 4;
+  const unsigned char* end = data + size;
+  format = get_u32(p);
+  flags = get_u32(p);
+  unsigned long n_size_x = get_u32(p);
+  unsigned long n_size_y = get_u32(p);
+  uint32_t num_levels = get_u32(p);
+  if (format != VSX_TEXTURE_CONTAINER_RGBA8 && format != VSX_TEXTURE_CONTAINER_RGBA16F)
+  {
+    error = "unknown pixel format";
+    format = VSX_TEXTURE_CONTAINER_RGBA8;
+    return false;
+  }
+  if (num_levels == 0 || num_levels > VXT_MAX_LEVELS)
+  {
+    error = "bad number of mipmap levels";
+    return false;
+  }
+  unsigned long bytes_per_pixel = format == VSX_TEXTURE_CONTAINER_RGBA16F ? 8 : 4;
+  for (uint32_t i = 0; i < num_levels; i++)
+  {
+    if ((unsigned long)(end - p) < VXT_LEVEL_HEADER_SIZE)
+    {
+      clear();
+      error = "truncated file";
+      return false;
+    }
+    vsx_texture_container_level l;
+    l.size_x = get_u32(p);
+    l.size_y = get_u32(p);
+    l.data_size = get_u32(p);
+    if (l.data_size > (unsigned long)(end - p) || l.data_size != (unsigned long long)l.size_x * l.size_y * bytes_per_pixel)
+    {
+      clear();
+      error = "truncated file or bad level size";
+      return false;
+    }
+    l.data = malloc(l.data_size);
+    copy_pixels(l.data, p, l.data_size, format);
+    p += l.data_size;
+    levels.push_back(l);
+  }
+  size_x = n_size_x;
+  size_y = n_size_y;
+  return true;
+}
@@ -0,0 +1,259 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "vsx_thread_pool.h"
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_WINDOWS
+  #include <windows.h>
+#else
+  #include <unistd.h>
+#endif
+
+class vsx_thread_pool_job
+{
+public:
+  vsx_thread_pool_range_task func;
+  void* arg;
+  size_t count;
+  size_t chunk_size;
+  size_t num_chunks;
+  size_t next_chunk;
+  size_t helpers_running;
+};
+
+static size_t get_num_cpu_cores()
+{
+  const char* env = getenv("VSXU_THREADS");
+  if (env && atoi(env) > 0)
+    return (size_t)atoi(env);
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_WINDOWS
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  long n = (long)info.dwNumberOfProcessors;
+#else
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  if (n < 1) n = 1;
+  return (size_t)n;
+}
+
+vsx_thread_pool::vsx_thread_pool(size_t num_threads)
+{
+  stopping = false;
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&task_cond, NULL);
+  pthread_cond_init(&job_cond, NULL);
+  if (num_threads == 0)
+  {
+    // leave one core for the render thread
+    num_threads = get_num_cpu_cores();
+    if (num_threads > 1) num_threads--;
+  }
+  for (size_t i = 0; i < num_threads; i++)
+  {
+    pthread_t t;
+    if (pthread_create(&t, NULL, &worker, (void*)this) == 0)
+      threads.push_back(t);
+  }
+}
+
+vsx_thread_pool::~vsx_thread_pool()
+{
+  pthread_mutex_lock(&mutex);
+  stopping = true;
+  pthread_cond_broadcast(&task_cond);
+  pthread_mutex_unlock(&mutex);
+  for (size_t i = 0; i < threads.size(); i++)
+    pthread_join(threads[i], NULL);
+  pthread_cond_destroy(&job_cond);
+  pthread_cond_destroy(&task_cond);
+  pthread_mutex_destroy(&mutex);
+}
+
+static pthread_mutex_t instance_mutex = PTHREAD_MUTEX_INITIALIZER;
+static vsx_thread_pool* instance = 0;
+
+vsx_thread_pool* vsx_thread_pool::get_instance()
+{
+  pthread_mutex_lock(&instance_mutex);
+  // never deleted; joining workers from a static destructor while a plugin
+  // still has a task queued is asking for trouble at exit
+  if (!instance)
+    instance = new vsx_thread_pool();
+  pthread_mutex_unlock(&instance_mutex);
+  return instance;
+}
+
+size_t vsx_thread_pool::get_num_threads()
+{
+  return threads.size();
+}
+
+size_t vsx_thread_pool::get_num_cores()
+{
+  return get_num_cpu_cores();
+}
+
+size_t vsx_thread_pool::get_queue_size()
+{
+  pthread_mutex_lock(&mutex);
+  size_t s = tasks.size();
+  pthread_mutex_unlock(&mutex);
+  return s;
+}
+
+void* vsx_thread_pool::worker(void* ptr)
+{
+  vsx_thread_pool* pool = (vsx_thread_pool*)ptr;
+  pthread_mutex_lock(&pool->mutex);
+  while (1)
+  {
+    while (pool->tasks.empty() && !pool->stopping)
+      pthread_cond_wait(&pool->task_cond, &pool->mutex);
+    if (pool->tasks.empty())
+      break;
+    task_entry t = pool->tasks.front();
+    pool->tasks.pop_front();
+    if (t.job)
+      t.job->helpers_running++;
+    pthread_mutex_unlock(&pool->mutex);
+
+    t.func(t.arg);
+
+    pthread_mutex_lock(&pool->mutex);
+    if (t.job)
+    {
+      t.job->helpers_running--;
+      pthread_cond_broadcast(&pool->job_cond);
+    }
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  return 0;
+}
+
+void vsx_thread_pool::add_task(vsx_thread_pool_task func, void* arg)
+{
+  // no workers (VSXU_THREADS=1 on a single core box), run it right here
+  if (threads.empty())
+  {
+    func(arg);
+    return;
+  }
+  task_entry t;
+  t.func = func;
+  t.arg = arg;
+  t.job = 0;
+  pthread_mutex_lock(&mutex);
+  tasks.push_back(t);
+  pthread_cond_signal(&task_cond);
+  pthread_mutex_unlock(&mutex);
+}
+
+struct vsx_thread_pool_job_arg
+{
+  vsx_thread_pool* pool;
+  vsx_thread_pool_job* job;
+};
+
+void vsx_thread_pool::job_worker(void* ptr)
+{
+  vsx_thread_pool_job_arg* a = (vsx_thread_pool_job_arg*)ptr;
+  a->pool->run_job(a->job);
+}
+
+void vsx_thread_pool::run_job(vsx_thread_pool_job* job)
+{
+  while (1)
+  {
+    pthread_mutex_lock(&mutex);
+    if (job->next_chunk >= job->num_chunks)
+    {
+      pthread_mutex_unlock(&mutex);
+      return;
+    }
+    size_t chunk = job->next_chunk++;
+    pthread_mutex_unlock(&mutex);
+
+    size_t start = chunk * job->chunk_size;
+    size_t end = start + job->chunk_size;
+    if (end > job->count) end = job->count;
+    job->func(job->arg, start, end);
+  }
+}
+
+void vsx_thread_pool::parallel_for(size_t count, size_t min_chunk, vsx_thread_pool_range_task func, void* arg)
+{
+  if (count == 0) return;
+  if (min_chunk == 0) min_chunk = 1;
+  size_t num_helpers = threads.size();
+  if (count <= min_chunk || num_helpers == 0)
+  {
+    func(arg, 0, count);
+    return;
+  }
+
+  vsx_thread_pool_job job;
+  job.func = func;
+  job.arg = arg;
+  job.count = count;
+  // a few chunks per thread evens out uneven rows
+  job.chunk_size = count / ((num_helpers + 1) * 4);
+  if (job.chunk_size < min_chunk) job.chunk_size = min_chunk;
+  job.num_chunks = (count + job.chunk_size - 1) / job.chunk_size;
+  job.next_chunk = 0;
+  job.helpers_running = 0;
+
+  if (num_helpers > job.num_chunks - 1)
+    num_helpers = job.num_chunks - 1;
+
+  vsx_thread_pool_job_arg job_arg;
+  job_arg.pool = this;
+  job_arg.job = &job;
+
+  pthread_mutex_lock(&mutex);
+  for (size_t i = 0; i < num_helpers; i++)
+  {
+    task_entry t;
+    t.func = &job_worker;
+    t.arg = (void*)&job_arg;
+    t.job = &job;
+    tasks.push_back(t);
+  }
+  pthread_cond_broadcast(&task_cond);
+  pthread_mutex_unlock(&mutex);
+
+  run_job(&job);
+
+  // helpers that never got a worker are not needed any more, drop them and
+  // wait for the ones still chewing on their last chunk
+  pthread_mutex_lock(&mutex);
+  for (std::list<task_entry>::iterator it = tasks.begin(); it != tasks.end();)
+  {
+    if ((*it).job == &job)
+      it = tasks.erase(it);
+    else
+      ++it;
+  }
+  while (job.helpers_running)
+    pthread_cond_wait(&job_cond, &mutex);
+  pthread_mutex_unlock(&mutex);
+}
@@ -54,6 +54,7 @@
 #include <stdlib.h>
 #include <string>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 
@@ -159,7 +160,7 @@ void vsxf::archive_close() {
     char nn = 0;
     fwrite(&nn,sizeof(char),1,archive_handle);
     fwrite(outBuffer,sizeof(Byte),outSizeProcessed,archive_handle);
-    delete outBuffer;
+    MyFree(outBuffer);
 
     vsxf_archive_info finfo;
     finfo.filename = filename;
@@ -235,6 +236,11 @@ bool vsxf::is_archive_populated()
   return (archive_files.size() > 0);
 }
 
+vsx_string vsxf::get_archive_name()
+{
+  return archive_name;
+}
+
   vsxf_handle* vsxf::f_open(const char* filename, const char* mode)
   {
     vsx_string i_filename(filename);
@@ -266,63 +272,68 @@ bool vsxf::is_archive_populated()
     }
     else
     {
-      FILE* l_handle = fopen(archive_name.c_str(),"rb");
-
       vsx_string mode_search(mode);
       if (mode_search.find("r") != -1)
       {
+        // only the lookup needs the lock; reading and decompressing happens
+        // on our own FILE* so several loader threads can do it at once
         bool found = false;
         vsx_string fname(filename);
-        unsigned long i = 0;
+        vsxf_archive_info info;
         get_lock();
-        while (!found && i < archive_files.size())
+        for (unsigned long i = 0; i < archive_files.size(); ++i)
         {
-          //printf("trying file: %s\n",archive_files[i].filename.c_str());
           if (archive_files[i].filename == fname)
           {
+            info = archive_files[i];
             found = true;
-            handle = new vsxf_handle;
-            handle->filename = fname;
-            handle->position = 0;
-            handle->size = archive_files[i].size;
-            handle->mode = VSXF_MODE_READ;
-            // decompress the data into the filehandle
-            //printf("nhandle size: %d\n",handle->size);
-            void* inBuffer = malloc(handle->size);
-            fseek(l_handle,archive_files[i].position-1,SEEK_SET);
-            if (!fread(inBuffer,1,handle->size,l_handle))
-            {
-              delete handle;
-              release_lock();
-              return NULL;
-            }
-            void* outBuffer = 0;
-            size_t outSize;
-            size_t outSizeProcessed;
-            if (LzmaRamGetUncompressedSize((unsigned char*)inBuffer, archive_files[i].size, &outSize) != 0)
-            {
-              printf("vsxf: lzma data error!");
-            }
-            if (outSize != 0)
-            {
-              outBuffer = malloc(outSize);
-            }
-            handle->file_data = 0;
-            if (outBuffer != 0)
-            {
-              LzmaRamDecompress((unsigned char*)inBuffer, archive_files[i].size, (unsigned char*)outBuffer, outSize, &outSizeProcessed, malloc, free);
-              handle->size = outSizeProcessed;
-              //printf("decompressed %d into %d bytes\n",handle->size, outSizeProcessed);
-              handle->file_data = outBuffer;
-              //printf("byte %s\n",outBuffer);
-              //FILE* ff = fmemopen (void *outBuffer, outSize, "r");
-            }
+            break;
+          }
+        }
+        release_lock();
+        if (found)
+        {
+          FILE* l_handle = fopen(archive_name.c_str(),"rb");
+          if (!l_handle)
+          {
+            delete handle;
+            return NULL;
+          }
+          handle->filename = fname;
+          handle->position = 0;
+          handle->size = info.size;
+          handle->mode = VSXF_MODE_READ;
+          // decompress the data into the filehandle
+          void* inBuffer = malloc(handle->size);
+          fseek(l_handle,info.position-1,SEEK_SET);
+          if (!fread(inBuffer,1,handle->size,l_handle))
+          {
             free(inBuffer);
             fclose(l_handle);
-            release_lock();
-            return handle;
+            delete handle;
+            return NULL;
+          }
+          void* outBuffer = 0;
+          size_t outSize;
+          size_t outSizeProcessed;
+          if (LzmaRamGetUncompressedSize((unsigned char*)inBuffer, info.size, &outSize) != 0)
+          {
+            printf("vsxf: lzma data error!");
+          }
+          if (outSize != 0)
+          {
+            outBuffer = malloc(outSize);
+          }
+          handle->file_data = 0;
+          if (outBuffer != 0)
+          {
+            LzmaRamDecompress((unsigned char*)inBuffer, info.size, (unsigned char*)outBuffer, outSize, &outSizeProcessed, malloc, free);
+            handle->size = outSizeProcessed;
+            handle->file_data = outBuffer;
           }
-          ++i;
+          free(inBuffer);
+          fclose(l_handle);
+          return handle;
         }
       } else
       if (mode_search.find("w") != -1)
@@ -343,6 +354,12 @@ bool vsxf::is_archive_populated()
 
   void vsxf::f_close(vsxf_handle* handle) {
     if (handle) {
+      #if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+      if (handle->file_data_mapped) {
+        munmap(handle->file_data, handle->size);
+        handle->file_data = 0;
+      }
+      #endif
       if (type == VSXF_TYPE_FILESYSTEM) fclose(handle->file_handle);
       if (type == VSXF_TYPE_ARCHIVE) {
         if (handle->mode == VSXF_MODE_WRITE) {
@@ -397,6 +414,43 @@ bool vsxf::is_archive_populated()
     }
   }
 
+  void* vsxf::f_data_get(vsxf_handle* handle) {
+    if (!handle) return 0;
+    if (handle->file_data) return handle->file_data;
+    if (type != VSXF_TYPE_FILESYSTEM) return 0;
+    unsigned long size = f_get_size(handle);
+    void* buf = malloc(size + 1);
+    if (!buf) return 0;
+    handle->size = fread(buf, 1, size, handle->file_handle);
+    handle->file_data = buf;
+    return buf;
+  }
+
+  const void* vsxf::f_data_map(vsxf_handle* handle) {
+    if (!handle) return 0;
+    if (handle->file_data) return handle->file_data;
+    #if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+    if (type == VSXF_TYPE_FILESYSTEM) {
+      unsigned long size = f_get_size(handle);
+      // can't map an empty file, f_data_get handles that fine
+      if (size) {
+        // writable but private: meshes pointing into it may be modified in
+        // place downstream, that must neither crash nor reach the file
+        void* data = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(handle->file_handle), 0);
+        if (data != MAP_FAILED) {
+          // all of it will be read soon, by several threads at once
+          madvise(data, size, MADV_WILLNEED);
+          handle->file_data = data;
+          handle->file_data_mapped = true;
+          handle->size = size;
+          return data;
+        }
+      }
+    }
+    #endif
+    return f_data_get(handle);
+  }
+
   char* vsxf::f_gets_entire(vsxf_handle* handle) {
     unsigned long size = f_get_size(handle);
     char* buf = (char*)malloc(size+1);
@@ -104,10 +104,22 @@ public:
   // MISC OPTIONS
 
   // set_option_preload_all
-  //   should all states be loaded on initial frame? default: false
-  //   This will make vsxu stall on startup while loading all presets.
+  //   should all visuals be kept loaded (within the memory budget)?
+  //   default: false. They load in the background after the first one.
   virtual void set_option_preload_all(bool value) = 0;
 
+  // set_option_engine_pool_size
+  //   number of visuals kept loaded: the one playing and the ones most
+  //   likely to come next (randomizer order, next/prev). The others are
+  //   unloaded, keeping only the parsed state file. 0 = all. default: 4
+  virtual void set_option_engine_pool_size(int value) = 0;
+
+  // set_option_memory_budget
+  //   estimated memory the loaded visuals may use, in megabytes. Visuals are
+  //   unloaded past it, the least likely to come next first. 0 = no limit.
+  //   default: 1024
+  virtual void set_option_memory_budget(int megabytes) = 0;
+
   // **************************************************************************
   // SOUND INJECTION
   //
@@ -119,6 +131,9 @@ public:
   // arbitrary engine information (statistics etc)
   // returns information about currently playing effect
   virtual int get_engine_num_modules() = 0;
+
+  // estimated memory use of each loaded visual, one per line, and the total
+  virtual std::string get_engine_pool_info() = 0;
 };
 
 #endif
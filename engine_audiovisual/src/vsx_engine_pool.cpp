@@ -0,0 +1,425 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <set>
+#include <algorithm>
+#include "vsx_statelist.h"
+#include "vsx_engine_pool.h"
+
+// components, their parameters and the module itself
+#define POOL_COMPONENT_OVERHEAD 4096
+// an engine without components
+#define POOL_ENGINE_OVERHEAD 65536
+
+vsx_engine_pool::vsx_engine_pool()
+:
+  pool_size(4),
+  memory_budget(1024 * 1024 * 1024),
+  clock(0),
+  direction(0),
+  random_pos(0),
+  measure_pos(0)
+{
+}
+
+void vsx_engine_pool::set_pool_size(size_t new_value)
+{
+  pool_size = new_value;
+}
+
+size_t vsx_engine_pool::get_pool_size()
+{
+  return pool_size;
+}
+
+void vsx_engine_pool::set_memory_budget(size_t new_value)
+{
+  memory_budget = new_value;
+}
+
+size_t vsx_engine_pool::get_memory_budget()
+{
+  return memory_budget;
+}
+
+template<class T>
+inline size_t array_bytes(vsx_array<T>& a)
+{
+  return a.get_allocated() * sizeof(T);
+}
+
+size_t vsx_engine_pool::measure(vsx_engine* engine)
+{
+  if (!engine) return 0;
+  size_t total = 0;
+  // the same data can be in more than one parameter, count it once
+  std::set<void*> seen;
+  std::set<unsigned int> seen_textures;
+  unsigned long num_modules = engine->get_num_modules();
+  for (unsigned long i = 0; i < num_modules; i++)
+  {
+    vsx_comp* comp = engine->get_by_id(i);
+    if (!comp) continue;
+    total += POOL_COMPONENT_OVERHEAD;
+    if (!comp->out_module_parameters) continue;
+    vsx_avector<vsx_module_param_abs*>& params = comp->out_module_parameters->id_vec;
+    for (size_t j = 0; j < params.size(); j++)
+    {
+      vsx_module_param_abs* param = params[j];
+      if (!param || !param->valid) continue;
+      switch (param->type)
+      {
+        case VSX_MODULE_PARAM_ID_TEXTURE:
+        {
+          vsx_texture** t = ((vsx_module_param_texture*)param)->get_addr();
+          if (!t || !*t || !(*t)->valid) break;
+          if (!seen_textures.insert((*t)->texture_info.ogl_id).second) break;
+          // rgba8, the mip maps on top
+          total += (size_t)((*t)->texture_info.size_x * (*t)->texture_info.size_y * 4.0f * 1.33f);
+          break;
+        }
+        case VSX_MODULE_PARAM_ID_BITMAP:
+        {
+          vsx_bitmap* b = ((vsx_module_param_bitmap*)param)->get_addr();
+          if (!b || !b->data) break;
+          if (!seen.insert(b->data).second) break;
+          total += b->size_x * b->size_y * (b->bpp ? b->bpp : 4);
+          break;
+        }
+        case VSX_MODULE_PARAM_ID_MESH:
+        {
+          vsx_mesh** m = ((vsx_module_param_mesh*)param)->get_addr_lazy();
+          if (!m || !*m || !(*m)->data) break;
+          if (!seen.insert((void*)*m).second) break;
+          vsx_mesh_data* d = (*m)->data;
+          total +=
+            array_bytes(d->vertices) +
+            array_bytes(d->vertex_normals) +
+            array_bytes(d->vertex_colors) +
+            array_bytes(d->vertex_tex_coords) +
+            array_bytes(d->faces) +
+            array_bytes(d->face_normals) +
+            array_bytes(d->vertex_tangents) +
+            array_bytes(d->face_centers);
+          break;
+        }
+        case VSX_MODULE_PARAM_ID_PARTICLESYSTEM:
+        {
+          vsx_particlesystem* p = ((vsx_module_param_particlesystem*)param)->get_addr();
+          if (!p || !p->particles) break;
+          if (!seen.insert((void*)p->particles).second) break;
+          total += array_bytes(*p->particles);
+          break;
+        }
+        case VSX_MODULE_PARAM_ID_FLOAT_ARRAY:
+        {
+          vsx_float_array* a = ((vsx_module_param_float_array*)param)->get_addr();
+          if (!a || !a->data) break;
+          if (!seen.insert((void*)a->data).second) break;
+          total += array_bytes(*a->data);
+          break;
+        }
+        case VSX_MODULE_PARAM_ID_FLOAT3_ARRAY:
+        {
+          vsx_float3_array* a = ((vsx_module_param_float3_array*)param)->get_addr();
+          if (!a || !a->data) break;
+          if (!seen.insert((void*)a->data).second) break;
+          total += array_bytes(*a->data);
+          break;
+        }
+        case VSX_MODULE_PARAM_ID_QUATERNION_ARRAY:
+        {
+          vsx_quaternion_array* a = ((vsx_module_param_quaternion_array*)param)->get_addr();
+          if (!a || !a->data) break;
+          if (!seen.insert((void*)a->data).second) break;
+          total += array_bytes(*a->data);
+          break;
+        }
+      }
+    }
+  }
+  return total;
+}
+
+size_t vsx_engine_pool::get_state_usage(state_info& info)
+{
+  if (!info.engine) return 0;
+  if (info.queued) return POOL_ENGINE_OVERHEAD + info.memory_usage;
+  // parsed
+  size_t total = POOL_ENGINE_OVERHEAD;
+  for (size_t i = 0; i < info.lines.size(); i++)
+    total += info.lines[i].size();
+  return total;
+}
+
+size_t vsx_engine_pool::estimate(std::vector<state_info>& states, size_t index)
+{
+  if (states[index].memory_usage) return POOL_ENGINE_OVERHEAD + states[index].memory_usage;
+  size_t total = 0;
+  size_t count = 0;
+  for (size_t i = 0; i < states.size(); i++)
+  {
+    if (!states[i].memory_usage) continue;
+    total += states[i].memory_usage;
+    count++;
+  }
+  if (!count) return POOL_ENGINE_OVERHEAD;
+  return POOL_ENGINE_OVERHEAD + total / count;
+}
+
+void vsx_engine_pool::touch(state_info& info)
+{
+  info.last_used = ++clock;
+}
+
+void vsx_engine_pool::set_direction(int new_value)
+{
+  direction = new_value;
+}
+
+void vsx_engine_pool::fill_random(size_t count, size_t ahead)
+{
+  // drop what's been used, then top up with shuffled rounds of all states
+  if (random_pos)
+  {
+    random_order.erase(random_order.begin(), random_order.begin() + random_pos);
+    random_pos = 0;
+  }
+  while (random_order.size() < ahead)
+  {
+    size_t start = random_order.size();
+    for (size_t i = 0; i < count; i++)
+      random_order.push_back(i);
+    for (size_t i = random_order.size() - 1; i > start; i--)
+    {
+      size_t j = start + rand() % (i - start + 1);
+      std::swap(random_order[i], random_order[j]);
+    }
+  }
+}
+
+size_t vsx_engine_pool::next_random(std::vector<state_info>& states, size_t current)
+{
+  size_t candidates = 0;
+  for (size_t i = 0; i < states.size(); i++)
+  {
+    if (i != current && !states[i].load_failed) candidates++;
+  }
+  if (!candidates) return states.size();
+  while (1)
+  {
+    if (random_pos >= random_order.size())
+      fill_random(states.size(), states.size());
+    size_t pick = random_order[random_pos++];
+    // the playlist may have grown or shrunk since
+    if (pick >= states.size()) continue;
+    if (pick == current || states[pick].load_failed) continue;
+    return pick;
+  }
+}
+
+static void add_wanted(std::vector<state_info>& states, size_t index, size_t limit, std::vector<char>& added, std::vector<size_t>& wanted)
+{
+  if (wanted.size() >= limit) return;
+  if (index >= states.size()) return;
+  if (added[index] || states[index].load_failed) return;
+  added[index] = 1;
+  wanted.push_back(index);
+}
+
+class pool_recent_sort
+{
+public:
+  std::vector<state_info>* states;
+  bool operator()(size_t a, size_t b)
+  {
+    return (*states)[a].last_used > (*states)[b].last_used;
+  }
+};
+
+void vsx_engine_pool::get_wanted(std::vector<state_info>& states, size_t current, size_t target, bool randomizer, std::vector<size_t>& wanted)
+{
+  wanted.clear();
+  size_t n = states.size();
+  if (!n) return;
+  size_t limit = pool_size ? pool_size : n;
+  std::vector<char> added(n, 0);
+
+  add_wanted(states, current, limit, added, wanted);
+  add_wanted(states, target, limit, added, wanted);
+
+  // neighbours of the one on screen, the way next / prev was last pressed
+  size_t next = (current + 1) % n;
+  size_t prev = (current + n - 1) % n;
+  if (direction > 0)
+  {
+    add_wanted(states, next, limit, added, wanted);
+    add_wanted(states, (current + 2) % n, limit, added, wanted);
+  }
+  if (direction < 0)
+  {
+    add_wanted(states, prev, limit, added, wanted);
+    add_wanted(states, (current + n - 2) % n, limit, added, wanted);
+  }
+
+  if (randomizer)
+  {
+    // the randomizer's picks are decided in advance, look a round ahead
+    if (random_order.size() - random_pos < limit)
+      fill_random(n, limit);
+    for (size_t i = random_pos; i < random_order.size() && wanted.size() < limit; i++)
+    {
+      if (random_order[i] == current) continue;
+      add_wanted(states, random_order[i], limit, added, wanted);
+    }
+  }
+
+  add_wanted(states, next, limit, added, wanted);
+  add_wanted(states, prev, limit, added, wanted);
+
+  // the rest by when they were last on screen
+  if (wanted.size() >= limit) return;
+  std::vector<size_t> recent;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (states[i].last_used) recent.push_back(i);
+  }
+  pool_recent_sort sorter;
+  sorter.states = &states;
+  std::sort(recent.begin(), recent.end(), sorter);
+  for (size_t i = 0; i < recent.size(); i++)
+    add_wanted(states, recent[i], limit, added, wanted);
+
+  // preloading everything
+  if (!pool_size)
+  for (size_t i = 0; i < n; i++)
+    add_wanted(states, i, limit, added, wanted);
+}
+
+size_t vsx_engine_pool::update_usage(std::vector<state_info>& states)
+{
+  size_t n = states.size();
+  for (size_t tries = 0; tries < n; tries++)
+  {
+    measure_pos = (measure_pos + 1) % n;
+    state_info& info = states[measure_pos];
+    if (!info.engine || !info.queued || info.loader) continue;
+    info.memory_usage = measure(info.engine);
+    break;
+  }
+  return get_usage(states);
+}
+
+size_t vsx_engine_pool::get_usage(std::vector<state_info>& states)
+{
+  size_t total = 0;
+  for (size_t i = 0; i < states.size(); i++)
+    total += get_state_usage(states[i]);
+  return total;
+}
+
+size_t vsx_engine_pool::get_num_built(std::vector<state_info>& states)
+{
+  size_t count = 0;
+  for (size_t i = 0; i < states.size(); i++)
+  {
+    if (states[i].engine && states[i].queued) count++;
+  }
+  return count;
+}
+
+size_t vsx_engine_pool::get_victim(std::vector<state_info>& states, std::vector<size_t>& wanted, size_t current, size_t target, bool over_budget)
+{
+  size_t n = states.size();
+  std::vector<char> is_wanted(n, 0);
+  for (size_t i = 0; i < wanted.size(); i++)
+    is_wanted[wanted[i]] = 1;
+
+  size_t built = n;
+  size_t parsed = n;
+  for (size_t i = 0; i < n; i++)
+  {
+    state_info& info = states[i];
+    if (i == current || i == target) continue;
+    // the thread pool is reading into it
+    if (!info.engine || info.loader) continue;
+    if (is_wanted[i]) continue;
+    if (info.queued)
+    {
+      // let it finish building, the commands left would build it again
+      if (info.engine->get_engine_state() == VSX_ENGINE_LOADING) continue;
+      if (built == n || info.last_used < states[built].last_used) built = i;
+    } else
+    {
+      if (parsed == n || info.last_used < states[parsed].last_used) parsed = i;
+    }
+  }
+  if (built != n) return built;
+  if (!over_budget) return n;
+  if (parsed != n) return parsed;
+
+  // still over, give up the least wanted of the wanted
+  for (size_t k = wanted.size(); k > 0; k--)
+  {
+    size_t i = wanted[k - 1];
+    state_info& info = states[i];
+    if (i == current || i == target) continue;
+    if (!info.engine || info.loader || !info.queued) continue;
+    if (info.engine->get_engine_state() == VSX_ENGINE_LOADING) continue;
+    return i;
+  }
+  return n;
+}
+
+vsx_string vsx_engine_pool::get_info(std::vector<state_info>& states)
+{
+  vsx_string result;
+  char line[512];
+  size_t total = 0;
+  for (size_t i = 0; i < states.size(); i++)
+  {
+    state_info& info = states[i];
+    if (!info.engine) continue;
+    size_t usage = get_state_usage(info);
+    total += usage;
+    const char* form = "built";
+    if (info.loader) form = "reading";
+    else
+    if (!info.queued) form = "parsed";
+    else
+    if (info.engine->get_engine_state() == VSX_ENGINE_LOADING) form = "building";
+    sprintf(line, "%8.1f MB  %-8s %s\n", (double)usage / (1024.0 * 1024.0), form, info.state_name.c_str());
+    result += line;
+  }
+  sprintf
+  (
+    line,
+    "%8.1f MB  total, %lu built (pool %lu), budget %.1f MB\n",
+    (double)total / (1024.0 * 1024.0),
+    (unsigned long)get_num_built(states),
+    (unsigned long)pool_size,
+    (double)memory_budget / (1024.0 * 1024.0)
+  );
+  result += line;
+  return result;
+}
@@ -0,0 +1,113 @@
+/**
+* Project: VSXu Engine: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu Engine.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef VSX_ENGINE_POOL_H_
+#define VSX_ENGINE_POOL_H_
+
+#include <stdlib.h>
+#include <vector>
+#include <vsx_string.h>
+
+class vsx_engine;
+class state_info;
+
+// Keeps track of which of the player's visuals should have a built engine.
+//
+// A visual is in one of three forms:
+//   built   - engine with all its components, ready to fade to
+//   parsed  - the engine is there (with the .vsx archive index) and the
+//             lines of the state are kept, but no components: building it
+//             again skips reading the file
+//   cold    - nothing but the file name
+//
+// The statelist asks for the wanted states every frame - the one on screen,
+// the one being switched to, the randomizer's next picks and the neighbours
+// in the direction next/prev were last pressed, then the most recently
+// used - and builds the first pool_size of them. Built states that aren't
+// wanted are demoted to parsed, the least recently used first. While over
+// the memory budget, parsed ones are dropped too and, last, the least wanted
+// of the wanted ones are demoted.
+//
+// Memory per engine is an estimate: what the modules put out (textures,
+// bitmaps, meshes, particle systems, arrays) plus a fixed amount per
+// component. It leaves out what modules keep to themselves, so set the
+// budget with some headroom.
+class vsx_engine_pool {
+  size_t pool_size;
+  size_t memory_budget;
+  unsigned long clock;
+  int direction;
+  // upcoming randomizer picks, from random_pos on
+  std::vector<size_t> random_order;
+  size_t random_pos;
+  size_t measure_pos;
+
+  void fill_random(size_t count, size_t ahead);
+
+public:
+  vsx_engine_pool();
+
+  // number of built engines, 0 = all of them
+  void set_pool_size(size_t new_value);
+  size_t get_pool_size();
+
+  // bytes, 0 = no limit
+  void set_memory_budget(size_t new_value);
+  size_t get_memory_budget();
+
+  // estimated bytes used by an engine's components
+  static size_t measure(vsx_engine* engine);
+
+  // what a state takes in its current form
+  static size_t get_state_usage(state_info& info);
+
+  // what building a state is expected to take, from its last measure or
+  // the average of the others
+  size_t estimate(std::vector<state_info>& states, size_t index);
+
+  // the state went on screen
+  void touch(state_info& info);
+
+  // 1 = next_state, -1 = prev_state, 0 = anything else
+  void set_direction(int new_value);
+
+  // the randomizer's next pick, states.size() if there's none
+  size_t next_random(std::vector<state_info>& states, size_t current);
+
+  // states that should be built, most wanted first, at most pool_size
+  void get_wanted(std::vector<state_info>& states, size_t current, size_t target, bool randomizer, std::vector<size_t>& wanted);
+
+  // measures the next built engine (one per call), returns the total
+  size_t update_usage(std::vector<state_info>& states);
+  size_t get_usage(std::vector<state_info>& states);
+  size_t get_num_built(std::vector<state_info>& states);
+
+  // state to demote, states.size() for none
+  //   over_budget false: only built states that aren't wanted
+  size_t get_victim(std::vector<state_info>& states, std::vector<size_t>& wanted, size_t current, size_t target, bool over_budget);
+
+  // one line per state that isn't cold, plus the total
+  vsx_string get_info(std::vector<state_info>& states);
+};
+
+#endif /*VSX_ENGINE_POOL_H_*/
@@ -95,6 +95,8 @@ public:
   void dec_speed();
 
   void set_option_preload_all(bool value);
+  void set_option_engine_pool_size(int value);
+  void set_option_memory_budget(int megabytes);
 
   void set_sound_freq(float* data);
   void set_sound_wave(float* data);
@@ -103,6 +105,7 @@ public:
   // arbitrary engine information (statistics etc)
   // returns information about currently playing effect
   int get_engine_num_modules();
+  std::string get_engine_pool_info();
 
   vsx_manager();
   ~vsx_manager();
@@ -307,6 +310,18 @@ void vsx_manager::set_option_preload_all(bool value)
  ((vsx_statelist*)int_state_manager)->set_option_preload_all(value);
 }
 
+void vsx_manager::set_option_engine_pool_size(int value)
+{
+  if (value < 0) value = 0;
+  ((vsx_statelist*)int_state_manager)->set_option_engine_pool_size((size_t)value);
+}
+
+void vsx_manager::set_option_memory_budget(int megabytes)
+{
+  if (megabytes < 0) megabytes = 0;
+  ((vsx_statelist*)int_state_manager)->set_option_memory_budget((size_t)megabytes * 1024 * 1024);
+}
+
 void vsx_manager::set_sound_freq(float* data)
 {
    ((vsx_statelist*)int_state_manager)->set_sound_freq(data);
@@ -330,4 +345,7 @@ int vsx_manager::get_engine_num_modules()
   return 0;
 }
 
-
+std::string vsx_manager::get_engine_pool_info()
+{
+  return std::string( ((vsx_statelist*)int_state_manager)->get_engine_pool_info().c_str() );
+}
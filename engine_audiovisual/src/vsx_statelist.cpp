@@ -22,34 +22,292 @@
 */
 
 #include "vsx_statelist.h"
+#include "vsx_thread_pool.h"
+#include "vsx_metrics.h"
 
 
 int vsx_statelist::init_current(vsx_engine *vxe_local, state_info* info) {
   //title_timer = 5.0f;
-  if (vxe_local == 0)
+  if (vxe_local == 0 || info->need_reload)
   {
-    vxe_local = new vsx_engine();
-    vxe_local->set_module_list( module_list );
-    vxe_local->set_no_send_client_time(true);
-    vxe_local->start();
-    (*state_iter).engine = vxe_local;
+    begin_loading(info);
+    return 0;
+  }
+  if (!info->queued && !info->loader)
+  {
+    // parsed, build it again from the lines we kept
+    queue_lines(info);
+    return 0;
+  }
+  // built in the background, whatever is left goes on at its budget
+  vxe_local->set_load_budget(load_budget_for(info));
+  vxe_local->reset_time();
+  return 0;
+}
+
+void vsx_statelist::begin_loading(state_info* info)
+{
+  // already on its way
+  if (info->loader) return;
+
+  if (info->engine == 0)
+  {
+    info->engine = new vsx_engine();
+    info->engine->set_module_list( module_list );
+    info->engine->set_no_send_client_time(true);
+    info->engine->start();
+  } else
+  {
+    printf("reloading state\n");
+    info->engine->unload_state();
+  }
+  info->need_reload = false;
+  info->load_failed = false;
+  info->queued = false;
+  info->lines.clear();
 #ifdef VSXU_DEBUG
-    printf("loading state: %s\n", (*state_iter).state_name.c_str());
+  printf("loading state: %s\n", info->state_name.c_str());
 #endif
-    return vxe_local->load_state((*state_iter).state_name);
+  // reading / unpacking the file goes on the thread pool, the commands are
+  // queued in update_loading once it's done
+  info->engine->set_load_budget(load_budget_for(info));
+  state_loader* loader = new state_loader;
+  loader->engine = info->engine;
+  loader->state_name = info->state_name;
+  loader->read_ok = false;
+  loader->thread_state = 1;
+  info->loader = loader;
+  vsx_thread_pool::get_instance()->add_task(&state_loader::read, (void*)loader);
+}
+
+int vsx_statelist::queue_lines(state_info* info)
+{
+  // this is where missing modules are found
+  info->engine->set_load_budget(load_budget_for(info));
+  int res = info->engine->queue_state(info->state_name, info->lines);
+  info->queued = true;
+  if (res > 0)
+  {
+    info->load_failed = true;
+    info->lines.clear();
+  }
+  return res;
+}
 
-  } else
+bool vsx_statelist::is_ready(state_info* info)
+{
+  return info->engine && !info->loader && !info->load_failed && info->queued;
+}
+
+// the state on screen builds at full speed, as does the first one (there's
+// nothing on screen yet whose frames it could hold up); the one we're
+// switching to and the ones the pool builds ahead get option_load_budget per
+// frame, render() keeps the old one on screen until it's done
+float vsx_statelist::load_budget_for(state_info* info)
+{
+  if (info->engine && info->engine == vxe)
+    return 0.0f;
+  if (!vxe && state_iter != statelist.end() && info == &(*state_iter))
+    return 0.0f;
+  return option_load_budget;
+}
+
+void vsx_statelist::render_current()
+{
+  if (!vxe) return;
+  if (cmd_out && cmd_in)
+  {
+    vxe->process_message_queue(cmd_in, cmd_out);
+    cmd_out->clear();
+  }
+  vxe->render();
+}
+
+void vsx_statelist::abort_transition()
+{
+  std::vector<state_info>::iterator it;
+  // back to the state on screen
+  if (vxe)
+  for (it = statelist.begin(); it != statelist.end(); ++it)
   {
-    if (info->need_reload) {
-      printf("reloading state\n");
-      vxe_local->unload_state();
-      vxe_local->load_state(info->state_name);
-      info->need_reload = false;
+    if ((*it).engine == vxe && !(*it).load_failed)
+    {
+      state_iter = it;
+      transition_time = 2.0f;
+      return;
     }
+  }
 
-    vxe_local->reset_time();
+  // the state on screen is the one that failed (the first one), take any
+  // other that's still in the running
+  for (it = statelist.begin(); it != statelist.end(); ++it)
+  {
+    if (!(*it).load_failed) break;
+  }
+  if (it == statelist.end()) return;
+  state_iter = it;
+  init_current((*state_iter).engine, &(*state_iter));
+  vxe = (*state_iter).engine;
+  vxe->set_load_budget(0.0f);
+  engine_pool.touch(*state_iter);
+  cmd_in = &(*state_iter).cmd_in;
+  cmd_out = &(*state_iter).cmd_out;
+  transition_time = 2.0f;
+}
+
+void vsx_statelist::update_loading()
+{
+  for (std::vector<state_info>::iterator it = statelist.begin(); it != statelist.end(); ++it)
+  {
+    state_info* info = &(*it);
+    if (!info->loader || info->loader->thread_state != 2) continue;
+
+    // the file is in, queue the commands
+    int res = 1;
+    if (info->loader->read_ok)
+    {
+      info->lines.swap(info->loader->lines);
+      res = queue_lines(info);
+    }
+    delete info->loader;
+    info->loader = 0;
+    if (res > 0)
+    {
+      info->load_failed = true;
+      if (it == state_iter)
+        abort_transition();
+    }
+  }
+}
+
+size_t vsx_statelist::get_current_index()
+{
+  for (size_t i = 0; i < statelist.size(); i++)
+  {
+    if (vxe && statelist[i].engine == vxe) return i;
+  }
+  return statelist.size();
+}
+
+void vsx_statelist::demote(state_info* info)
+{
+  if (info->queued)
+  {
+    // parsed: the engine keeps its archive, we keep the lines
+    info->engine->unload_state();
+    info->queued = false;
+  } else
+  {
+    info->engine->stop();
+    delete info->engine;
+    info->engine = 0;
+    info->lines.clear();
+  }
+}
+
+void vsx_statelist::update_pool()
+{
+  size_t n = statelist.size();
+  size_t current = get_current_index();
+  if (current == n) return;
+  size_t target = state_iter - statelist.begin();
+
+  size_t usage = engine_pool.update_usage(statelist);
+  size_t budget = engine_pool.get_memory_budget();
+  size_t limit = engine_pool.get_pool_size() ? engine_pool.get_pool_size() : n;
+  std::vector<size_t> wanted;
+  engine_pool.get_wanted(statelist, current, target, randomizer, wanted);
+
+  // too many built, or over the budget
+  size_t victim;
+  bool demoted = false;
+  while (engine_pool.get_num_built(statelist) > limit)
+  {
+    victim = engine_pool.get_victim(statelist, wanted, current, target, false);
+    if (victim == n) break;
+    demote(&statelist[victim]);
+    usage = engine_pool.get_usage(statelist);
+    demoted = true;
+  }
+  while (budget && usage > budget)
+  {
+    victim = engine_pool.get_victim(statelist, wanted, current, target, true);
+    if (victim == n) break;
+    demote(&statelist[victim]);
+    usage = engine_pool.get_usage(statelist);
+    demoted = true;
+  }
+  #ifdef VSXU_DEBUG
+  if (demoted)
+    printf("engine pool:\n%s", engine_pool.get_info(statelist).c_str());
+  #else
+  (void)demoted;
+  #endif
+
+  // start on the next wanted state that isn't built, one a frame
+  for (size_t k = 0; k < wanted.size(); k++)
+  {
+    size_t i = wanted[k];
+    state_info* info = &statelist[i];
+    // those two are loaded when switched to
+    if (i == current || i == target) continue;
+    if (info->loader || info->load_failed || is_ready(info)) continue;
+    if (budget && usage + engine_pool.estimate(statelist, i) > budget) break;
+    init_current(info->engine, info);
+    break;
+  }
+
+  // build the wanted ones a budget at a time - and run their modules so
+  // the ones loading over several frames get there - in the order they're
+  // wanted, then any others still building
+  state_info* warm_up = 0;
+  for (size_t k = 0; k < wanted.size() && !warm_up; k++)
+  {
+    size_t i = wanted[k];
+    if (i == current || i == target) continue;
+    if (is_ready(&statelist[i]) && statelist[i].engine->get_engine_state() == VSX_ENGINE_LOADING)
+      warm_up = &statelist[i];
+  }
+  for (size_t i = 0; i < n && !warm_up; i++)
+  {
+    if (i == current || i == target) continue;
+    if (is_ready(&statelist[i]) && statelist[i].engine->get_engine_state() == VSX_ENGINE_LOADING)
+      warm_up = &statelist[i];
+  }
+  if (!warm_up) return;
+
+  // one state a frame
+  warm_up->engine->process_message_queue(&warm_up->cmd_in, &warm_up->cmd_out);
+  warm_up->cmd_out.clear(true);
+  if (tex_to.has_buffer_support())
+  {
+    tex_to.begin_capture_to_buffer();
+      warm_up->engine->render();
+    tex_to.end_capture_to_buffer();
   }
-  return 0;
+}
+
+vsx_string vsx_statelist::get_engine_pool_info()
+{
+  return engine_pool.get_info(statelist);
+}
+
+void vsx_statelist::get_metrics(vsx_metrics_writer& out)
+{
+  size_t reading = 0;
+  for (size_t i = 0; i < statelist.size(); i++)
+    if (statelist[i].loader) reading++;
+  out.gauge("vsx_player_states", (double)statelist.size());
+  out.gauge("vsx_player_states_built", (double)engine_pool.get_num_built(statelist));
+  out.gauge("vsx_player_states_reading", (double)reading);
+  out.gauge("vsx_player_engine_pool_budget_bytes", (double)engine_pool.get_memory_budget());
+  // estimated, see vsx_engine_pool::measure
+  out.gauge("vsx_memory_bytes", (double)engine_pool.get_usage(statelist), "subsystem=\"engine_pool\"");
+}
+
+static void statelist_metrics(vsx_metrics_writer& out, void* arg)
+{
+  ((vsx_statelist*)arg)->get_metrics(out);
 }
 
 void vsx_statelist::add_visual_path(vsx_string new_visual_path)
@@ -102,6 +360,7 @@ void vsx_statelist::select_visual(int selection)
           change = false;
       }
     }
+    engine_pool.set_direction(0);
     init_current((*state_iter).engine, &(*state_iter));
     transition_time = 2.0f;
 }
@@ -109,16 +368,24 @@ void vsx_statelist::select_visual(int selection)
 void vsx_statelist::next_state()
 {
   if ((*state_iter).engine != vxe) return;
-  ++state_iter;
-  if (state_iter == statelist.end()) state_iter = statelist.begin();
+  size_t tries = statelist.size();
+  do {
+    ++state_iter;
+    if (state_iter == statelist.end()) state_iter = statelist.begin();
+  } while ((*state_iter).load_failed && --tries);
+  engine_pool.set_direction(1);
   init_current((*state_iter).engine, &(*state_iter));
   transition_time = 2.0f;
 }
 void vsx_statelist::prev_state()
 {
   if ((*state_iter).engine != vxe) return;
-  if (state_iter == statelist.begin()) state_iter = statelist.end();
-  --state_iter;
+  size_t tries = statelist.size();
+  do {
+    if (state_iter == statelist.begin()) state_iter = statelist.end();
+    --state_iter;
+  } while ((*state_iter).load_failed && --tries);
+  engine_pool.set_direction(-1);
   init_current((*state_iter).engine, &(*state_iter));
   transition_time = 2.0f;
 }
@@ -271,40 +538,15 @@ vsx_string vsx_statelist::get_meta_visual_company()
 void vsx_statelist::random_state() {
   if (0 == statelist.size()) return;
   if ((*state_iter).engine != vxe) return;
-  int steps = rand() % statelist.size();
-  while (steps) {
-    ++state_iter;
-    if (state_iter == statelist.end()) state_iter = statelist.begin();
-    --steps;
-  }
-  if ((*state_iter).engine == vxe) { random_state(); return; }
+  // the pool knows the order in advance so it can have them built
+  size_t pick = engine_pool.next_random(statelist, state_iter - statelist.begin());
+  if (pick >= statelist.size()) return;
+  state_iter = statelist.begin() + pick;
+  engine_pool.set_direction(0);
   init_current((*state_iter).engine, &(*state_iter));
   transition_time = 2.0f;
 }
 
-void vsx_statelist::preload_engines()
-{
-  // go through statelist and load and validate every plugin
-  std::vector<state_info> new_statelist;
-  for (state_iter = statelist.begin(); state_iter != statelist.end(); state_iter++)
-  {
-    if (init_current((*state_iter).engine, &(*state_iter)) > 0)
-    {
-      continue;
-    }
-    new_statelist.push_back(*state_iter);
-    if (option_preload_all == true)
-    {
-      while ( (*state_iter).engine->get_modules_left_to_load() )
-      {
-        (*state_iter).engine->process_message_queue( &(*state_iter).cmd_in, cmd_out = &(*state_iter).cmd_out,false, true);
-        (*state_iter).engine->render();
-      }
-    }
-  }
-  statelist = new_statelist;
-}
-
 void vsx_statelist::render() 
 {
   if (render_first)
@@ -341,24 +583,21 @@ void vsx_statelist::render()
       (*state_iter).is_volatile = true;
     }
 
-    preload_engines();
-
     // mark all state_info instances non-volatile (engine will be deleted when state_iter will be deleted)
     for (state_iter = statelist.begin(); state_iter != statelist.end(); state_iter++)
     {
       (*state_iter).is_volatile = true;
     }
 
-    // reset state_iter to a random state
-    state_iter = statelist.begin();
-    int steps = rand() % statelist.size();
-    while (steps) {
-      ++state_iter;
-      if (state_iter == statelist.end()) state_iter = statelist.begin();
-      --steps;
-    }
+    // start on a random state, the pool (update_pool) loads the ones likely
+    // to come after it
+    state_iter = statelist.begin() + engine_pool.next_random(statelist, statelist.size());
+    init_current((*state_iter).engine, &(*state_iter));
+    engine_pool.touch(*state_iter);
 
     vxe = (*state_iter).engine;
+    // what's on screen loads at full speed
+    vxe->set_load_budget(0.0f);
     cmd_in = &(*state_iter).cmd_in;
     cmd_out = &(*state_iter).cmd_out;
   } // render first
@@ -366,8 +605,45 @@ void vsx_statelist::render()
   // prevent from rendering by mistake
   if ( !statelist.size() ) return;
 
+  update_loading();
+  update_pool();
+
   if ((*state_iter).engine != vxe) // change is on the way
   {
+    // still reading the state file, keep the old one on screen until
+    // there's something to fade to
+    if (!is_ready(&(*state_iter)))
+    {
+      if ((*state_iter).load_failed)
+      {
+        abort_transition();
+        return;
+      }
+      render_current();
+      return;
+    }
+
+    // still building, a budget a frame; it has to render (off screen) for
+    // its modules to finish loading, without buffers it switches once its
+    // commands are done and the rest loads on screen
+    vsx_engine* target = (*state_iter).engine;
+    if (target->get_engine_state() == VSX_ENGINE_LOADING)
+    {
+      target->process_message_queue(&(*state_iter).cmd_in, &(*state_iter).cmd_out);
+      (*state_iter).cmd_out.clear(true);
+      if (tex_to.has_buffer_support())
+      {
+        tex_to.begin_capture_to_buffer();
+          target->render();
+        tex_to.end_capture_to_buffer();
+      }
+      if (tex_to.has_buffer_support() || !target->get_commands_internal_count())
+      {
+        render_current();
+        return;
+      }
+    }
+
     if ( tex_to.has_buffer_support() )
     {
       tex_to.begin_capture_to_buffer();
@@ -399,6 +675,8 @@ void vsx_statelist::render()
     if (transition_time <= 0.0)
     {
       vxe = (*state_iter).engine;
+      vxe->set_load_budget(0.0f);
+      engine_pool.touch(*state_iter);
       cmd_in = &(*state_iter).cmd_in;
       cmd_out = &(*state_iter).cmd_out;
       transitioning = false;
@@ -473,6 +751,9 @@ void vsx_statelist::render()
     }
   } else
   {
+    // the state on screen is still being read (first frames)
+    if ((*state_iter).loader)
+      return;
     if (cmd_out && cmd_in)
     {
       vxe->process_message_queue(cmd_in, cmd_out);
@@ -661,15 +942,32 @@ void vsx_statelist::init(vsx_string base_path,vsx_string init_sound_type)
 vsx_statelist::vsx_statelist() 
 {
   option_preload_all = false;
+  option_load_budget = 0.004f;
+  vsx_metrics::get_instance()->add_source(statelist_metrics, this);
 }
 
 vsx_statelist::~vsx_statelist()
 {
+  vsx_metrics::get_instance()->remove_source(this);
   #ifdef VSXU_DEBUG
   printf("statelist destructor\n");
   #endif
   for (std::vector<state_info>::iterator it = statelist.begin(); it != statelist.end(); ++it)
   {
+    // the thread pool may still be reading into the engine
+    if ((*it).loader)
+    {
+      while ((*it).loader->thread_state != 2)
+      {
+        #if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+          usleep(1000);
+        #else
+          Sleep(1);
+        #endif
+      }
+      delete (*it).loader;
+      (*it).loader = 0;
+    }
     if ((*it).engine)
     {
       (*it).engine->stop();
@@ -33,6 +33,24 @@
 #endif
 
 #include "vsx_engine.h"
+#include "vsx_engine_pool.h"
+
+// a state file being read on the thread pool for its engine
+class state_loader {
+public:
+  vsx_engine* engine;
+  vsx_string state_name;
+  std::vector<vsx_string> lines;
+  bool read_ok;
+  int thread_state; // 1 = reading, 2 = done
+
+  static void read(void* ptr)
+  {
+    state_loader* my = (state_loader*)ptr;
+    my->read_ok = my->engine->read_state(my->state_name, my->lines);
+    my->thread_state = 2;
+  }
+};
 
 class state_info {
 public:
@@ -46,6 +64,18 @@ public:
   bool need_stop;
   bool need_reload;
   bool is_volatile;
+  // reading the state file, the engine is off limits until it's done
+  state_loader* loader;
+  // the state couldn't be loaded (missing modules), skipped from then on
+  bool load_failed;
+  // the lines of the state once read, kept while it's parsed or built
+  std::vector<vsx_string> lines;
+  // commands queued / components built, false when it's only parsed
+  bool queued;
+  // estimated bytes of the built engine, last time it was measured
+  size_t memory_usage;
+  // when it was last on screen, see vsx_engine_pool
+  unsigned long last_used;
 
   state_info() {
     speed = 1.0f;
@@ -53,6 +83,11 @@ public:
     need_stop = false;
     need_reload = false;
     is_volatile = false;
+    loader = 0;
+    load_failed = false;
+    queued = false;
+    memory_usage = 0;
+    last_used = 0;
   }
   ~state_info() {
     if (is_volatile) return;
@@ -115,8 +150,27 @@ private:
 
   // options
   bool option_preload_all;
+  float option_load_budget;
+
+  // which states are kept built
+  vsx_engine_pool engine_pool;
 
-  void preload_engines();
+  // states are read on the thread pool and built a budget at a time on the
+  // render thread, see update_loading
+  void begin_loading(state_info* info);
+  int queue_lines(state_info* info);
+  void update_loading();
+  bool is_ready(state_info* info);
+  float load_budget_for(state_info* info);
+  void abort_transition();
+  // the state on screen, one frame, while the next one isn't there yet
+  void render_current();
+
+  // builds the states likely to be shown next and demotes the rest, see
+  // vsx_engine_pool
+  void update_pool();
+  void demote(state_info* info);
+  size_t get_current_index();
 
 public:
 
@@ -135,10 +189,36 @@ public:
   // OPTIONS
 
   // set_option_preload_all
-  //   should all states be loaded on initial frame? default: false
+  //   keep all states built (within the memory budget)? default: false
   void set_option_preload_all(bool new_value)
   {
     option_preload_all = new_value;
+    if (option_preload_all)
+      engine_pool.set_pool_size(0);
+  }
+
+  // set_option_engine_pool_size
+  //   number of states kept built, the one on screen included. 0 = all
+  //   default: 4
+  void set_option_engine_pool_size(size_t new_value)
+  {
+    engine_pool.set_pool_size(new_value);
+  }
+
+  // set_option_memory_budget
+  //   estimated bytes the built / parsed states may take, 0 = no limit
+  //   default: 1 GB
+  void set_option_memory_budget(size_t new_value)
+  {
+    engine_pool.set_memory_budget(new_value);
+  }
+
+  // set_option_load_budget
+  //   seconds per frame spent building states that aren't on screen yet
+  //   default: 0.004
+  void set_option_load_budget(float new_value)
+  {
+    option_load_budget = new_value;
   }
   // **************************************************************************
 
@@ -182,6 +262,12 @@ public:
   vsx_string get_meta_visual_name();
   vsx_string get_meta_visual_creator();
   vsx_string get_meta_visual_company();
+
+  // memory use of every engine that's in memory, one per line
+  vsx_string get_engine_pool_info();
+
+  // engine pool numbers for vsx_metrics, the engines report themselves
+  void get_metrics(vsx_metrics_writer& out);
   
 
   vsx_statelist();
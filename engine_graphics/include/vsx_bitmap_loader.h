@@ -0,0 +1,210 @@
+/**
+* Project: VSXu: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef VSX_BITMAP_LOADER_H
+#define VSX_BITMAP_LOADER_H
+
+#include <map>
+#include <list>
+#include <pthread.h>
+#include <vsx_string.h>
+#include <vsx_bitmap.h>
+#include <vsxfst.h>
+#include <vsx_texture_container.h>
+
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+  #define VSX_BITMAP_LOADER_DLLIMPORT
+#else
+  #if defined(VSX_ENG_DLL)
+    #define VSX_BITMAP_LOADER_DLLIMPORT __declspec (dllexport)
+  #else
+    #define VSX_BITMAP_LOADER_DLLIMPORT __declspec (dllimport)
+  #endif
+#endif
+
+// Shared png/jpeg decode service and bitmap cache.
+//
+// Loader modules used to start one pthread per image, so loading a state
+// with a hundred images meant a hundred threads fighting over the vsxf
+// mutex. Now they ask this service instead:
+//
+//   entry = vsx_bitmap_loader::get_instance()->request(name, engine->filesystem);
+//   ...
+//   in run(): if (entry->state == VSX_BITMAP_LOADER_DONE) use entry->bitmap
+//   in on_delete(): vsx_bitmap_loader::get_instance()->release(entry, engine->filesystem);
+//
+// The same file requested by several modules (or several engines, like the
+// player's preloaded visuals) is only decoded once and the bitmap is
+// shared, so treat entry->bitmap as read only. Files with identical
+// contents under different names share one bitmap too (content hash).
+// Images nobody references any more are kept around for reuse until the
+// memory budget is hit, then the least recently released go first.
+// Decoding runs on a few tasks on the engine thread pool, highest priority
+// first. The file is read in one go (vsxf::f_data_get) and decoded from RAM.
+//
+// For the GL side use entry->content_name as the name for
+// vsx_texture::upload_ram_bitmap_cached() so the texture is shared as well.
+
+#define VSX_BITMAP_LOADER_FAILED -1
+#define VSX_BITMAP_LOADER_QUEUED 0
+#define VSX_BITMAP_LOADER_DECODING 1
+#define VSX_BITMAP_LOADER_DONE 2
+
+#define VSX_BITMAP_LOADER_PRIORITY_PREFETCH 0
+#define VSX_BITMAP_LOADER_PRIORITY_NORMAL 1
+#define VSX_BITMAP_LOADER_PRIORITY_VISIBLE 2
+
+// decoded pixels, shared by all entries with the same file contents
+class vsx_bitmap_loader_data
+{
+public:
+  uint64_t hash;
+  vsx_bitmap bitmap;
+  vsx_texture_container* container;
+  size_t bytes;
+  int references;
+  vsx_bitmap_loader_data() : hash(0), container(0), bytes(0), references(0) {}
+};
+
+class vsx_bitmap_loader_entry
+{
+public:
+  vsx_string key;
+  vsx_string filename;
+  vsx_string filename_alpha; // jpeg only, alpha taken from this file's red channel
+  int type; // 0 = png, 1 = jpeg, 2 = vxt
+  int priority;
+  volatile int state;
+  vsx_string error;
+  // always 4 bytes per pixel worth of memory, bpp/bformat tell what's in it
+  vsx_bitmap bitmap;
+  // vxt files end up here instead of in bitmap
+  vsx_texture_container* container;
+  // unique per content, set when done
+  vsx_string content_name;
+
+  // internal
+  vsx_bitmap_loader_data* data;
+  int references;
+  bool detached; // not in the key map any more (reloaded)
+  bool unused; // in the lru list
+  std::list<vsxf*> filesystems; // one per reference, the worker reads through the first one
+  vsx_bitmap_loader_entry() : type(0), priority(0), state(0), container(0), data(0), references(0), detached(false), unused(false) {}
+};
+
+class vsx_bitmap_loader_stats
+{
+public:
+  size_t requests;
+  size_t hits; // already loaded (or loading) under the same name
+  size_t content_hits; // other name, same file contents - decode skipped
+  size_t decodes;
+  size_t failures;
+  size_t evictions; // unused images dropped to stay under the budget
+  size_t bytes_evicted;
+  size_t bytes_resident; // all decoded pixels held by the cache
+  size_t bytes_unused; // the part of that only the cache holds on to
+  size_t num_entries;
+  size_t num_unused;
+  size_t memory_budget;
+};
+
+class VSX_BITMAP_LOADER_DLLIMPORT vsx_bitmap_loader
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t read_cond;
+  std::map<vsx_string, vsx_bitmap_loader_entry*> entries;
+  std::list<vsx_bitmap_loader_entry*> queue;
+  std::map<uint64_t, vsx_bitmap_loader_data*> contents;
+  std::list<vsx_bitmap_loader_entry*> unused; // refcount 0, oldest first
+  size_t memory_budget;
+  vsx_bitmap_loader_stats stats;
+  vsx_bitmap_loader_entry* reading; // entry whose file is being read right now
+  vsxf* reading_fs;
+  size_t workers_running;
+  size_t max_workers;
+
+  static void worker(void* ptr);
+  void process(vsx_bitmap_loader_entry* entry);
+  // these expect the mutex to be held
+  void retire(vsx_bitmap_loader_entry* entry);
+  void destroy(vsx_bitmap_loader_entry* entry);
+  void trim();
+
+public:
+  vsx_bitmap_loader();
+
+  static vsx_bitmap_loader* get_instance();
+
+  // filename is relative to the filesystem (archive or base path).
+  // jpeg and vxt files are picked by suffix, everything else is treated as png.
+  // reload = true decodes the file again even if it's already loaded,
+  // modules holding the old entry keep it until they release it.
+  vsx_bitmap_loader_entry* request(
+    vsx_string filename,
+    vsxf* filesystem,
+    int priority = VSX_BITMAP_LOADER_PRIORITY_NORMAL,
+    vsx_string filename_alpha = "",
+    bool reload = false
+  );
+
+  // move a queued entry up (or down) the queue
+  void set_priority(vsx_bitmap_loader_entry* entry, int priority);
+
+  // drop a reference. filesystem must be the one passed to request().
+  // the bitmap stays cached until the memory budget needs the space.
+  void release(vsx_bitmap_loader_entry* entry, vsxf* filesystem);
+
+  // number of entries waiting for a decoder
+  size_t get_queue_size();
+
+  // upper limit for decoded pixels, only unused images are evicted so the
+  // cache can be over budget if everything is in use.
+  // default is 256 MB or VSXU_BITMAP_CACHE_MB from the environment.
+  void set_memory_budget(size_t bytes);
+
+  // drop every image nobody uses right now
+  void flush_unused();
+
+  void get_stats(vsx_bitmap_loader_stats& result);
+};
+
+// what a loader module holds on to for the sequencer's lookahead
+// (vsx_module::prefetch): requested at prefetch priority and referenced, so
+// they're decoded and cached by the time the timeline switches to them.
+// The newest few are kept, the module calls remove() once it has requested
+// the file itself.
+#define VSX_BITMAP_LOADER_PREFETCH_MAX 4
+
+class VSX_BITMAP_LOADER_DLLIMPORT vsx_bitmap_loader_prefetch
+{
+  std::list<vsx_bitmap_loader_entry*> entries;
+
+public:
+  void add(vsx_string filename, vsxf* filesystem, vsx_string filename_alpha = "");
+  void remove(vsx_string filename, vsxf* filesystem, vsx_string filename_alpha = "");
+  // in on_delete()
+  void clear(vsxf* filesystem);
+};
+
+#endif
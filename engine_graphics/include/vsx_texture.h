@@ -29,6 +29,7 @@
 #include <vsx_string.h>
 #include <vsx_bitmap.h>
 #include <vsxfst.h>
+#include <vsx_texture_container.h>
 
 
 #if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
@@ -175,6 +176,10 @@ public:
 #endif
   VSX_TEXTURE_DLLIMPORT void upload_ram_bitmap(vsx_bitmap* vbitmap,bool mipmaps = false, bool upside_down = true);
   VSX_TEXTURE_DLLIMPORT void upload_ram_bitmap(void* data, unsigned long size_x, unsigned long size_y,bool mipmaps = false, int bpp = 4, int bpp2 = GL_BGRA_EXT, bool upside_down = true);
+  // same, but textures uploaded under the same cache_name share one GL
+  // texture (refcounted, freed by the last unload()). Use the content_name
+  // from vsx_bitmap_loader so identical images are only on the GPU once.
+  VSX_TEXTURE_DLLIMPORT void upload_ram_bitmap_cached(vsx_bitmap* vbitmap, vsx_string cache_name, bool mipmaps = false, bool upside_down = true);
 
   // load a tga file in the same thread as ours (why would anyone use tga when png's around? anyway..)
 //  void load_tga(vsx_string name, bool mipmaps = true);
@@ -185,6 +190,11 @@ public:
   VSX_TEXTURE_DLLIMPORT void load_png_thread(vsx_string fname, bool mipmaps = true);
   VSX_TEXTURE_DLLIMPORT void load_jpeg(vsx_string fname, bool mipmaps = true);
 
+  // upload a prebuilt mipmap chain as is (see vsx_texture_container.h)
+  VSX_TEXTURE_DLLIMPORT void upload_container(vsx_texture_container* container);
+  // load a .vxt file made by vsxtex, the fast path for png/jpeg
+  VSX_TEXTURE_DLLIMPORT void load_container(vsx_string fname, vsxf* filesystem = 0x0);
+
   // update the transform object with a new transformation
   void set_transform(vsx_transform_obj* new_transform_obj) {
     if(transform_obj == new_transform_obj) return;
@@ -114,7 +114,8 @@ public:
   float size_x;
   float size_y;
 
-  int type; // 0 = tga, 1 = png
+  int type; // 0 = tga, 1 = png, 2 = vxt, 3 = shared bitmap
+  int references; // number of vsx_textures using this entry in t_glist
 	GLuint ogl_id;
 	GLuint ogl_type;
 
@@ -127,6 +128,8 @@ public:
   vsx_texture_info() :
     size_x(0.0f),
     size_y(0.0f),
+    type(0),
+    references(0),
     ogl_id(0),
     ogl_type(0)
   {}
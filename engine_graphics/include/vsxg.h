@@ -91,6 +91,8 @@ typedef struct {
 } pngRawInfo;
 
 extern int VSXG_DLLIMPORT pngLoadRaw(const char* filename, pngRawInfo *rawinfo, vsxf* filesystem);
+// decode a png already in memory (see vsxf::f_data_get)
+extern int VSXG_DLLIMPORT pngLoadRawMemory(const unsigned char* data, unsigned long size, pngRawInfo *rawinfo);
 
 class VSXG_DLLIMPORT CJPEGTest
 {
@@ -104,6 +106,14 @@ public:
         vsx_string& strErr, // Returns error text on failure
         vsxf* filesystem
     );
+
+    // Load JPEG from a buffer holding the whole file
+    bool LoadJPEGMemory
+    (
+        const unsigned char* data,
+        unsigned long size,
+        vsx_string& strErr
+    );
     
     bool SaveJPEG( const vsx_string & strFile, vsx_string & strErr, const int nQFactor );
     
@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
 #include <png.h>
 
 /* Used to decide if GL/gl.h supports the paletted extension */
@@ -86,39 +87,53 @@ static void checkForGammaEnv()
 }
 
 typedef struct {
-  vsxf* filesystem;
-  vsxf_handle* fp;
-} vsxf_info;
+  const unsigned char* data;
+  unsigned long size;
+  unsigned long position;
+} png_memory_info;
 
 
-static void png_vsxf_read_data(png_structp png_ptr, png_bytep data, png_size_t length)
+static void png_memory_read_data(png_structp png_ptr, png_bytep data, png_size_t length)
 {
-  png_size_t check;
-  vsxf_info* a = (vsxf_info*)(png_get_io_ptr(png_ptr));
-   /* fread() returns 0 on error, so it is OK to store this in a png_size_t
-    * instead of an int, which is what fread() actually returns.
-    */
-   check = (png_size_t)a->filesystem->f_read((void*)data, length,a->fp);
-
-   if (check != length)
-   {
-     printf("Error reading png file. 'Check'' is not equal to 'length' in glpng.cpp line %d",__LINE__);
-     //png_error(png_ptr, "Read Error");
-   }
+  png_memory_info* a = (png_memory_info*)(png_get_io_ptr(png_ptr));
+  if (a->position + length > a->size)
+  {
+    printf("Error reading png file, unexpected end of data in glpng.cpp line %d\n",__LINE__);
+    png_error(png_ptr, "Read Error");
+  }
+  memcpy(data, a->data + a->position, length);
+  a->position += length;
 }
 
 
-
-//int APIENTRY pngLoadRawF(FILE *fp, pngRawInfo *pinfo) {
+// reads the whole file in one go and decodes from memory
 int  pngLoadRaw(const char* filename, pngRawInfo *pinfo, vsxf* filesystem) {
-	unsigned char header[8];
+  if (pinfo == NULL) {
+    printf("error in png loader: pinfo is NULL %d\n",__LINE__);
+    return 0;
+  }
+  vsxf_handle* fp = filesystem->f_open(filename,"rb");
+  if (!fp) {
+    printf("error in png loader: i_filesystem.fp not valid on line %d\n",__LINE__);
+    return 0;
+  }
+  unsigned char* data = (unsigned char*)filesystem->f_data_get(fp);
+  int result = 0;
+  if (data)
+    result = pngLoadRawMemory(data, fp->size, pinfo);
+  filesystem->f_close(fp);
+  return result;
+}
+
+
+int  pngLoadRawMemory(const unsigned char* file_data, unsigned long file_size, pngRawInfo *pinfo) {
 	png_structp png;
 	png_infop   info;
 	png_infop   endinfo;
 	png_bytep   data;
   png_bytep  *row_p;
   double fileGamma;
-  vsxf_info i_filesystem;
+  png_memory_info i_memory;
 
 	png_uint_32 width, height;
 	int depth, color;
@@ -129,18 +144,13 @@ int  pngLoadRaw(const char* filename, pngRawInfo *pinfo, vsxf* filesystem) {
     printf("error in png loader: pinfo is NULL %d\n",__LINE__);
     return 0;
   }
-	i_filesystem.filesystem = filesystem;
-	i_filesystem.fp = filesystem->f_open(filename,"rb");
-	if (!i_filesystem.fp) {
-    printf("error in png loader: i_filesystem.fp not valid on line %d\n",__LINE__);
-    return 0;
-  }
-  
-	filesystem->f_read(header, 8, i_filesystem.fp);
-	if (!png_check_sig(header, 8)) {
+  if (file_size < 8 || !png_check_sig((png_bytep)file_data, 8)) {
     printf("error in %s on line %d\n",__FILE__,__LINE__);
     return 0;
   }
+  i_memory.data = file_data;
+  i_memory.size = file_size;
+  i_memory.position = 8;
 
 	png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
   if (!png) {
@@ -166,11 +176,10 @@ int  pngLoadRaw(const char* filename, pngRawInfo *pinfo, vsxf* filesystem) {
   {
     printf("error in png_jmpbuf %s on line %d\n",__FILE__,__LINE__);
     png_destroy_read_struct(&png, &info,&endinfo);
-    filesystem->f_close(i_filesystem.fp);
     return 0;
   }
 
-	png_set_read_fn(png, (png_bytep)(&i_filesystem), png_vsxf_read_data);
+	png_set_read_fn(png, (png_bytep)(&i_memory), png_memory_read_data);
   png_set_sig_bytes(png, 8);
 	png_read_info(png, info);
 	png_get_IHDR(png, info, &width, &height, &depth, &color, NULL, NULL, NULL);
@@ -234,7 +243,6 @@ int  pngLoadRaw(const char* filename, pngRawInfo *pinfo, vsxf* filesystem) {
 
    png_read_end(png, endinfo);
 	png_destroy_read_struct(&png, &info, &endinfo);
-  filesystem->f_close(i_filesystem.fp);
 	return 1;
 }
 
@@ -37,21 +37,18 @@ extern "C" {
 
 
 
-/* Expanded data source object for stdio input */
+/* Expanded data source object for memory input */
 
 typedef struct {
   struct jpeg_source_mgr pub;	/* public fields */
 
-  vsxf_handle* infile;		/* source stream */
-  vsxf* filesystem;
-  JOCTET * buffer;		/* start of buffer */
-  boolean start_of_file;	/* have we gotten any data yet? */
+  const JOCTET * data;		/* the whole file, see vsxf::f_data_get */
+  size_t size;
+  JOCTET eoi[2];		/* fake EOI marker for truncated files */
 } my_source_mgr2;
 
 typedef my_source_mgr2 * my_src_ptr;
 
-#define INPUT_BUF_SIZE  4096	/* choose an efficiently fread'able size */
-
 
 /*
  * Initialize source --- called by jpeg_read_header
@@ -61,72 +58,28 @@ typedef my_source_mgr2 * my_src_ptr;
 METHODDEF(void)
 init_source (j_decompress_ptr cinfo)
 {
-  my_src_ptr src = (my_src_ptr) cinfo->src;
-
-  /* We reset the empty-input-file flag for each image,
-   * but we don't clear the input buffer.
-   * This is correct behavior for reading a series of images from one source.
-   */
-  src->start_of_file = TRUE;
+  VSX_UNUSED(cinfo);
 }
 
 
 /*
  * Fill the input buffer --- called whenever buffer is emptied.
  *
- * In typical applications, this should read fresh data into the buffer
- * (ignoring the current state of next_input_byte & bytes_in_buffer),
- * reset the pointer & count to the start of the buffer, and return TRUE
- * indicating that the buffer has been reloaded.  It is not necessary to
- * fill the buffer entirely, only to obtain at least one more byte.
- *
- * There is no such thing as an EOF return.  If the end of the file has been
- * reached, the routine has a choice of ERREXIT() or inserting fake data into
- * the buffer.  In most cases, generating a warning message and inserting a
- * fake EOI marker is the best course of action --- this will allow the
- * decompressor to output however much of the image is there.  However,
- * the resulting error message is misleading if the real problem is an empty
- * input file, so we handle that case specially.
- *
- * In applications that need to be able to suspend compression due to input
- * not being available yet, a FALSE return indicates that no more data can be
- * obtained right now, but more may be forthcoming later.  In this situation,
- * the decompressor will return to its caller (with an indication of the
- * number of scanlines it has read, if any).  The application should resume
- * decompression after it has loaded more data into the input buffer.  Note
- * that there are substantial restrictions on the use of suspension --- see
- * the documentation.
- *
- * When suspending, the decompressor will back up to a convenient restart point
- * (typically the start of the current MCU). next_input_byte & bytes_in_buffer
- * indicate where the restart point will be if the current call returns FALSE.
- * Data beyond this point must be rescanned after resumption, so move it to
- * the front of the buffer rather than discarding it.
+ * The whole file is handed over in init, so getting here means the
+ * data ran out. Insert a fake EOI marker so the decompressor outputs
+ * however much of the image is there.
  */
 
 METHODDEF(boolean)
 fill_input_buffer (j_decompress_ptr cinfo)
 {
   my_src_ptr src = (my_src_ptr) cinfo->src;
-  size_t nbytes;
-
-  nbytes = src->filesystem->f_read(src->buffer,INPUT_BUF_SIZE * sizeof(JOCTET),src->infile);
-  //printf("nbytes: %d\n",nbytes);
-  //JFREAD(src->infile, src->buffer, INPUT_BUF_SIZE);
-
-  if (nbytes <= 0) {
-    if (src->start_of_file)	/* Treat empty input file as fatal error */
-      ERREXIT(cinfo, JERR_INPUT_EMPTY);
-    WARNMS(cinfo, JWRN_JPEG_EOF);
-    /* Insert a fake EOI marker */
-    src->buffer[0] = (JOCTET) 0xFF;
-    src->buffer[1] = (JOCTET) JPEG_EOI;
-    nbytes = 2;
-  }
 
-  src->pub.next_input_byte = src->buffer;
-  src->pub.bytes_in_buffer = nbytes;
-  src->start_of_file = FALSE;
+  WARNMS(cinfo, JWRN_JPEG_EOF);
+  src->eoi[0] = (JOCTET) 0xFF;
+  src->eoi[1] = (JOCTET) JPEG_EOI;
+  src->pub.next_input_byte = src->eoi;
+  src->pub.bytes_in_buffer = 2;
 
   return TRUE;
 }
@@ -135,13 +88,6 @@ fill_input_buffer (j_decompress_ptr cinfo)
 /*
  * Skip data --- used to skip over a potentially large amount of
  * uninteresting data (such as an APPn marker).
- *
- * Writers of suspendable-input applications must note that skip_input_data
- * is not granted the right to give a suspension return.  If the skip extends
- * beyond the data currently in the buffer, the buffer can be marked empty so
- * that the next read will cause a fill_input_buffer call that can suspend.
- * Arranging for additional bytes to be discarded before reloading the input
- * buffer is the application writer's problem.
  */
 
 METHODDEF(void)
@@ -149,21 +95,14 @@ skip_input_data (j_decompress_ptr cinfo, long num_bytes)
 {
   my_src_ptr src = (my_src_ptr) cinfo->src;
 
-  /* Just a dumb implementation for now.  Could use fseek() except
-   * it doesn't work on pipes.  Not clear that being smart is worth
-   * any trouble anyway --- large skips are infrequent.
-   */
-  if (num_bytes > 0) {
-    while (num_bytes > (long) src->pub.bytes_in_buffer) {
-      num_bytes -= (long) src->pub.bytes_in_buffer;
-      (void) fill_input_buffer(cinfo);
-      /* note we assume that fill_input_buffer will never return FALSE,
-       * so suspension need not be handled.
-       */
-    }
-    src->pub.next_input_byte += (size_t) num_bytes;
-    src->pub.bytes_in_buffer -= (size_t) num_bytes;
+  if (num_bytes <= 0)
+    return;
+  if ((size_t) num_bytes > src->pub.bytes_in_buffer) {
+    (void) fill_input_buffer(cinfo);
+    return;
   }
+  src->pub.next_input_byte += (size_t) num_bytes;
+  src->pub.bytes_in_buffer -= (size_t) num_bytes;
 }
 
 
@@ -194,31 +133,19 @@ term_source (j_decompress_ptr cinfo)
 
 
 /*
- * Prepare for input from a stdio stream.
- * The caller must have already opened the stream, and is responsible
- * for closing it after finishing decompression.
+ * Prepare for input from memory.
+ * The buffer must stay alive until decompression is finished.
  */
 
 GLOBAL(void)
-jpeg_stdio2_src (j_decompress_ptr cinfo, vsxf_handle* infile, vsxf* filesystem)
+jpeg_memory2_src (j_decompress_ptr cinfo, const unsigned char* data, size_t size)
 {
   my_src_ptr src;
 
-  /* The source object and input buffer are made permanent so that a series
-   * of JPEG images can be read from the same file by calling jpeg_stdio_src
-   * only before the first one.  (If we discarded the buffer at the end of
-   * one image, we'd likely lose the start of the next one.)
-   * This makes it unsafe to use this manager and a different source
-   * manager serially with the same JPEG object.  Caveat programmer.
-   */
   if (cinfo->src == NULL) {	/* first time for this JPEG object? */
     cinfo->src = (struct jpeg_source_mgr *)
       (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
 				  sizeof(my_source_mgr2));
-    src = (my_src_ptr) cinfo->src;
-    src->buffer = (JOCTET *)
-      (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
-				  INPUT_BUF_SIZE * sizeof(JOCTET));
   }
 
   src = (my_src_ptr) cinfo->src;
@@ -227,10 +154,10 @@ jpeg_stdio2_src (j_decompress_ptr cinfo, vsxf_handle* infile, vsxf* filesystem)
   src->pub.skip_input_data = skip_input_data;
   src->pub.resync_to_restart = jpeg_resync_to_restart; /* use default method */
   src->pub.term_source = term_source;
-  src->infile = infile;
-  src->filesystem = filesystem;
-  src->pub.bytes_in_buffer = 0; /* forces fill_input_buffer on first read */
-  src->pub.next_input_byte = NULL; /* until buffer loaded */
+  src->data = (const JOCTET *) data;
+  src->size = size;
+  src->pub.bytes_in_buffer = size;
+  src->pub.next_input_byte = src->data;
 }
 
 
@@ -285,12 +212,6 @@ bool CJPEGTest::LoadJPEG( const vsx_string & strFile, vsx_string & strErr,vsxf*
         m_nResX = 0; 
         m_nResY = 0;     
     }
-    // Decode image
-    struct jpeg_decompress_struct cinfo;
-    struct jpeg_error_mgr jerr;
-    
-    cinfo.err = jpeg_std_error( &jerr );
-    jpeg_create_decompress( &cinfo );
     //printf("opening jpeg: %s\n",strFile.c_str());
     vsxf_handle* fp = filesystem->f_open( strFile.c_str(), "rb" );
     if( ! fp )
@@ -298,8 +219,40 @@ bool CJPEGTest::LoadJPEG( const vsx_string & strFile, vsx_string & strErr,vsxf*
         strErr = "Failed to open file for reading.";
         return false;
     }
+    unsigned char* data = (unsigned char*)filesystem->f_data_get( fp );
+    if( ! data )
+    {
+        filesystem->f_close( fp );
+        strErr = "Failed to read file.";
+        return false;
+    }
+    bool result = LoadJPEGMemory( data, fp->size, strErr );
+    filesystem->f_close( fp );
+    return result;
+}
+
+bool CJPEGTest::LoadJPEGMemory( const unsigned char* data, unsigned long size, vsx_string & strErr )
+{
+    if( m_pBuf )
+    {
+        delete [] m_pBuf; 
+        m_pBuf = 0; 
+        m_nResX = 0; 
+        m_nResY = 0;     
+    }
+    if( size < 2 )
+    {
+        strErr = "File is empty.";
+        return false;
+    }
+    // Decode image
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
     
-    jpeg_stdio2_src( &cinfo, fp, filesystem );
+    cinfo.err = jpeg_std_error( &jerr );
+    jpeg_create_decompress( &cinfo );
+    
+    jpeg_memory2_src( &cinfo, data, size );
     jpeg_read_header( &cinfo, TRUE );
     
     jpeg_start_decompress( &cinfo );
@@ -310,6 +263,7 @@ bool CJPEGTest::LoadJPEG( const vsx_string & strFile, vsx_string & strErr,vsxf*
     if( cinfo.out_color_components != 3 && cinfo.out_color_components != 1 )
     {
         strErr = "Image does not have either 1 or 3 color components.";
+        jpeg_destroy_decompress( &cinfo );
         return false;
     }
         
@@ -357,8 +311,6 @@ bool CJPEGTest::LoadJPEG( const vsx_string & strFile, vsx_string & strErr,vsxf*
     jpeg_finish_decompress( &cinfo );
     
     jpeg_destroy_decompress( &cinfo );
-    
-    filesystem->f_close( fp );
 
     return true;
 }
@@ -0,0 +1,574 @@
+/**
+* Project: VSXu: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vsx_gl_global.h>
+#include <vsx_bitmap_loader.h>
+#include <vsx_thread_pool.h>
+#include <vsx_metrics.h>
+#include <vsxg.h>
+
+// more than this and the decoders just compete with the render thread for
+// memory bandwidth
+#define MAX_DECODE_WORKERS 4
+
+#define DEFAULT_MEMORY_BUDGET_MB 256
+
+static void bitmap_loader_metrics(vsx_metrics_writer& out, void* arg)
+{
+  vsx_bitmap_loader* loader = (vsx_bitmap_loader*)arg;
+  vsx_bitmap_loader_stats s;
+  loader->get_stats(s);
+  out.counter("vsx_bitmap_cache_requests_total", (double)s.requests);
+  out.counter("vsx_bitmap_cache_hits_total", (double)s.hits);
+  out.counter("vsx_bitmap_cache_content_hits_total", (double)s.content_hits);
+  out.counter("vsx_bitmap_cache_decodes_total", (double)s.decodes);
+  out.counter("vsx_bitmap_cache_failures_total", (double)s.failures);
+  out.counter("vsx_bitmap_cache_evictions_total", (double)s.evictions);
+  out.counter("vsx_bitmap_cache_evicted_bytes_total", (double)s.bytes_evicted);
+  out.gauge("vsx_bitmap_cache_entries", (double)s.num_entries);
+  out.gauge("vsx_bitmap_cache_budget_bytes", (double)s.memory_budget);
+  out.gauge("vsx_bitmap_decode_queue", (double)loader->get_queue_size());
+  out.gauge("vsx_memory_bytes", (double)s.bytes_resident, "subsystem=\"bitmap_cache\"");
+  out.gauge("vsx_memory_unused_bytes", (double)s.bytes_unused, "subsystem=\"bitmap_cache\"");
+}
+
+vsx_bitmap_loader::vsx_bitmap_loader()
+{
+  pthread_mutex_init(&mutex, NULL);
+  pthread_cond_init(&read_cond, NULL);
+  reading = 0;
+  reading_fs = 0;
+  workers_running = 0;
+  max_workers = vsx_thread_pool::get_instance()->get_num_threads();
+  if (max_workers > MAX_DECODE_WORKERS) max_workers = MAX_DECODE_WORKERS;
+  if (max_workers < 1) max_workers = 1;
+  memset(&stats, 0, sizeof(stats));
+  memory_budget = (size_t)DEFAULT_MEMORY_BUDGET_MB << 20;
+  const char* env = getenv("VSXU_BITMAP_CACHE_MB");
+  if (env && atoi(env) >= 0)
+    memory_budget = (size_t)atoi(env) << 20;
+  vsx_metrics::get_instance()->add_source(bitmap_loader_metrics, this);
+}
+
+static pthread_mutex_t instance_mutex = PTHREAD_MUTEX_INITIALIZER;
+static vsx_bitmap_loader* instance = 0;
+
+vsx_bitmap_loader* vsx_bitmap_loader::get_instance()
+{
+  pthread_mutex_lock(&instance_mutex);
+  // leaked on purpose, same as the thread pool
+  if (!instance)
+    instance = new vsx_bitmap_loader();
+  pthread_mutex_unlock(&instance_mutex);
+  return instance;
+}
+
+vsx_bitmap_loader_entry* vsx_bitmap_loader::request(vsx_string filename, vsxf* filesystem, int priority, vsx_string filename_alpha, bool reload)
+{
+  // the same relative name means different files in different archives
+  vsx_string key;
+  if (filesystem->is_archive())
+    key = filesystem->get_archive_name() + ":";
+  else
+    key = filesystem->get_base_path();
+  key += filename;
+  if (filename_alpha.size())
+    key += "|" + filename_alpha;
+
+  bool start_worker = false;
+  pthread_mutex_lock(&mutex);
+  stats.requests++;
+  std::map<vsx_string, vsx_bitmap_loader_entry*>::iterator it = entries.find(key);
+  if (it != entries.end() && reload)
+  {
+    vsx_bitmap_loader_entry* old = (*it).second;
+    entries.erase(it);
+    it = entries.end();
+    old->detached = true;
+    if (old->unused)
+    {
+      unused.remove(old);
+      destroy(old);
+    }
+  }
+  vsx_bitmap_loader_entry* entry;
+  if (it != entries.end())
+  {
+    entry = (*it).second;
+    stats.hits++;
+    if (entry->unused)
+    {
+      unused.remove(entry);
+      entry->unused = false;
+    }
+    if (entry->state == VSX_BITMAP_LOADER_QUEUED && priority > entry->priority)
+      entry->priority = priority;
+  }
+  else
+  {
+    entry = new vsx_bitmap_loader_entry;
+    entry->key = key;
+    entry->filename = filename;
+    entry->filename_alpha = filename_alpha;
+    entry->type = 0;
+    if (verify_filesuffix(filename, "jpg") || verify_filesuffix(filename, "jpeg"))
+      entry->type = 1;
+    if (verify_filesuffix(filename, "vxt"))
+      entry->type = 2;
+    entry->priority = priority;
+    entry->bitmap.valid = false;
+    entry->bitmap.data = 0;
+    entries[key] = entry;
+    queue.push_back(entry);
+    if (workers_running < max_workers)
+    {
+      workers_running++;
+      start_worker = true;
+    }
+  }
+  entry->references++;
+  entry->filesystems.push_back(filesystem);
+  pthread_mutex_unlock(&mutex);
+
+  // outside the lock, with no pool threads the worker runs right here
+  if (start_worker)
+    vsx_thread_pool::get_instance()->add_task(&worker, (void*)this);
+  return entry;
+}
+
+void vsx_bitmap_loader::set_priority(vsx_bitmap_loader_entry* entry, int priority)
+{
+  pthread_mutex_lock(&mutex);
+  entry->priority = priority;
+  pthread_mutex_unlock(&mutex);
+}
+
+void vsx_bitmap_loader::release(vsx_bitmap_loader_entry* entry, vsxf* filesystem)
+{
+  if (!entry) return;
+  pthread_mutex_lock(&mutex);
+  // the worker might be reading the file through this filesystem, which
+  // goes away with the engine - wait until it's done with it
+  while (reading == entry && reading_fs == filesystem)
+    pthread_cond_wait(&read_cond, &mutex);
+
+  for (std::list<vsxf*>::iterator it = entry->filesystems.begin(); it != entry->filesystems.end(); ++it)
+  {
+    if (*it == filesystem)
+    {
+      entry->filesystems.erase(it);
+      break;
+    }
+  }
+  entry->references--;
+  // while decoding, the worker retires it when it's done
+  if (entry->references == 0 && entry->state != VSX_BITMAP_LOADER_DECODING)
+    retire(entry);
+  pthread_mutex_unlock(&mutex);
+}
+
+// nobody references the entry any more
+void vsx_bitmap_loader::retire(vsx_bitmap_loader_entry* entry)
+{
+  if (entry->state == VSX_BITMAP_LOADER_QUEUED)
+    queue.remove(entry);
+  if (entry->state == VSX_BITMAP_LOADER_DONE && !entry->detached)
+  {
+    // keep it for the next one asking
+    entry->unused = true;
+    unused.push_back(entry);
+    trim();
+    return;
+  }
+  if (!entry->detached)
+    entries.erase(entry->key);
+  destroy(entry);
+}
+
+void vsx_bitmap_loader::destroy(vsx_bitmap_loader_entry* entry)
+{
+  vsx_bitmap_loader_data* data = entry->data;
+  delete entry;
+  if (!data || --data->references > 0)
+    return;
+  contents.erase(data->hash);
+  stats.bytes_resident -= data->bytes;
+  if (data->bitmap.data)
+    free(data->bitmap.data);
+  if (data->container)
+    delete data->container;
+  delete data;
+}
+
+void vsx_bitmap_loader::trim()
+{
+  while (stats.bytes_resident > memory_budget && unused.size())
+  {
+    vsx_bitmap_loader_entry* entry = unused.front();
+    unused.pop_front();
+    entries.erase(entry->key);
+    stats.evictions++;
+    if (entry->data->references == 1)
+      stats.bytes_evicted += entry->data->bytes;
+    destroy(entry);
+  }
+}
+
+size_t vsx_bitmap_loader::get_queue_size()
+{
+  pthread_mutex_lock(&mutex);
+  size_t s = queue.size();
+  pthread_mutex_unlock(&mutex);
+  return s;
+}
+
+void vsx_bitmap_loader::set_memory_budget(size_t bytes)
+{
+  pthread_mutex_lock(&mutex);
+  memory_budget = bytes;
+  trim();
+  pthread_mutex_unlock(&mutex);
+}
+
+void vsx_bitmap_loader::flush_unused()
+{
+  pthread_mutex_lock(&mutex);
+  size_t budget = memory_budget;
+  memory_budget = 0;
+  trim();
+  memory_budget = budget;
+  pthread_mutex_unlock(&mutex);
+}
+
+void vsx_bitmap_loader::get_stats(vsx_bitmap_loader_stats& result)
+{
+  pthread_mutex_lock(&mutex);
+  result = stats;
+  result.bytes_unused = 0;
+  // only count pixels no live entry shares
+  std::map<vsx_bitmap_loader_data*, int> unused_refs;
+  for (std::list<vsx_bitmap_loader_entry*>::iterator it = unused.begin(); it != unused.end(); ++it)
+    if ((*it)->data && ++unused_refs[(*it)->data] == (*it)->data->references)
+      result.bytes_unused += (*it)->data->bytes;
+  result.num_entries = entries.size();
+  result.num_unused = unused.size();
+  result.memory_budget = memory_budget;
+  pthread_mutex_unlock(&mutex);
+}
+
+void vsx_bitmap_loader::worker(void* ptr)
+{
+  vsx_bitmap_loader* loader = (vsx_bitmap_loader*)ptr;
+  pthread_mutex_lock(&loader->mutex);
+  while (loader->queue.size())
+  {
+    // highest priority first, oldest first within a priority
+    std::list<vsx_bitmap_loader_entry*>::iterator best = loader->queue.begin();
+    for (std::list<vsx_bitmap_loader_entry*>::iterator it = loader->queue.begin(); it != loader->queue.end(); ++it)
+      if ((*it)->priority > (*best)->priority)
+        best = it;
+    vsx_bitmap_loader_entry* entry = *best;
+    loader->queue.erase(best);
+    entry->state = VSX_BITMAP_LOADER_DECODING;
+    pthread_mutex_unlock(&loader->mutex);
+
+    loader->process(entry);
+
+    pthread_mutex_lock(&loader->mutex);
+    if (entry->references == 0)
+      loader->retire(entry);
+  }
+  loader->workers_running--;
+  pthread_mutex_unlock(&loader->mutex);
+}
+
+// reads the whole file and takes over the buffer so the handle (and the
+// filesystem) is not needed while decoding
+static unsigned char* read_file(vsxf* filesystem, vsx_string& filename, unsigned long& size)
+{
+  vsxf_handle* fp = filesystem->f_open(filename.c_str(), "rb");
+  if (!fp) return 0;
+  unsigned char* data = (unsigned char*)filesystem->f_data_get(fp);
+  size = fp->size;
+  fp->file_data = 0;
+  filesystem->f_close(fp);
+  return data;
+}
+
+// FNV-1a, 64 bit
+static uint64_t hash_bytes(uint64_t h, const unsigned char* data, unsigned long size)
+{
+  for (unsigned long i = 0; i < size; i++)
+  {
+    h ^= data[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static bool decode_png(vsx_bitmap_loader_data* d, vsx_string& error, unsigned char* data, unsigned long size)
+{
+  pngRawInfo pp;
+  if (!pngLoadRawMemory(data, size, &pp))
+  {
+    error = "Failed to decode PNG file.";
+    return false;
+  }
+  if (pp.Components == 1) {
+    d->bitmap.bpp = 3;
+    d->bitmap.bformat = GL_RGB;
+  } else
+  if (pp.Components == 2) {
+    d->bitmap.bpp = 4;
+    d->bitmap.bformat = GL_RGBA;
+  } else
+  if (pp.Components == 3) {
+    d->bitmap.bpp = 3;
+    d->bitmap.bformat = GL_RGB;
+  } else
+  {
+    d->bitmap.bpp = 4;
+    d->bitmap.bformat = GL_RGBA;
+  }
+  d->bitmap.size_x = pp.Width;
+  d->bitmap.size_y = pp.Height;
+  d->bitmap.data = (vsx_bitmap_32bt*)pp.Data;
+  d->bitmap.valid = true;
+  d->bytes = pp.Width * pp.Height * pp.Components;
+  return true;
+}
+
+static bool decode_jpeg(vsx_bitmap_loader_data* d, vsx_string& error, unsigned char* data, unsigned long size, unsigned char* data_alpha, unsigned long size_alpha)
+{
+  CJPEGTest cj;
+  if (!cj.LoadJPEGMemory(data, size, error))
+    return false;
+  unsigned long b_c = cj.GetResX() * cj.GetResY();
+  CJPEGTest cj_a;
+  unsigned char* acp = 0;
+  if (data_alpha)
+  {
+    if (!cj_a.LoadJPEGMemory(data_alpha, size_alpha, error))
+      return false;
+    if ((unsigned long)(cj_a.GetResX() * cj_a.GetResY()) < b_c)
+    {
+      error = "Alpha image is smaller than the RGB image.";
+      return false;
+    }
+    acp = cj_a.m_pBuf;
+  }
+
+  vsx_bitmap_32bt* p = (vsx_bitmap_32bt*)malloc(sizeof(vsx_bitmap_32bt) * b_c);
+  if (!p)
+  {
+    error = "Out of memory.";
+    return false;
+  }
+  unsigned char* rgbcp = cj.m_pBuf;
+  for (unsigned long i = 0; i < b_c; ++i)
+  {
+    p[i] =
+        (acp ? acp[i*3] << 24 : 0xFF000000) |
+        rgbcp[i*3+2] << 16 |
+        rgbcp[i*3+1] << 8 |
+        rgbcp[i*3];
+  }
+  d->bitmap.bpp = 4;
+  d->bitmap.bformat = GL_RGBA;
+  d->bitmap.size_x = cj.GetResX();
+  d->bitmap.size_y = cj.GetResY();
+  d->bitmap.data = p;
+  d->bitmap.valid = true;
+  d->bytes = b_c * sizeof(vsx_bitmap_32bt);
+  return true;
+}
+
+static bool decode_vxt(vsx_bitmap_loader_data* d, vsx_string& error, unsigned char* data, unsigned long size)
+{
+  vsx_texture_container* c = new vsx_texture_container;
+  if (!c->load_memory(data, size))
+  {
+    error = vsx_string("Not a valid vxt texture container: ") + c->error + ".";
+    delete c;
+    return false;
+  }
+  d->container = c;
+  for (size_t i = 0; i < c->levels.size(); i++)
+    d->bytes += c->levels[i].data_size;
+  return true;
+}
+
+void vsx_bitmap_loader::process(vsx_bitmap_loader_entry* entry)
+{
+  unsigned char* data = 0;
+  unsigned char* data_alpha = 0;
+  unsigned long size = 0;
+  unsigned long size_alpha = 0;
+
+  pthread_mutex_lock(&mutex);
+  reading = entry;
+  reading_fs = entry->filesystems.size() ? entry->filesystems.front() : 0;
+  pthread_mutex_unlock(&mutex);
+
+  if (reading_fs)
+  {
+    data = read_file(reading_fs, entry->filename, size);
+    if (data && entry->filename_alpha.size())
+      data_alpha = read_file(reading_fs, entry->filename_alpha, size_alpha);
+  }
+
+  pthread_mutex_lock(&mutex);
+  reading = 0;
+  reading_fs = 0;
+  pthread_cond_broadcast(&read_cond);
+  pthread_mutex_unlock(&mutex);
+
+  vsx_bitmap_loader_data* d = 0;
+  if (!data || (entry->filename_alpha.size() && !data_alpha))
+    entry->error = "Failed to open file for reading.";
+  else
+  {
+    // the type is part of the hash, a jpeg with and without alpha differ
+    uint64_t hash = hash_bytes(14695981039346656037ULL + entry->type, data, size);
+    if (data_alpha)
+      hash = hash_bytes(hash ^ 0xa1, data_alpha, size_alpha);
+
+    pthread_mutex_lock(&mutex);
+    std::map<uint64_t, vsx_bitmap_loader_data*>::iterator it = contents.find(hash);
+    if (it != contents.end())
+    {
+      d = (*it).second;
+      d->references++;
+      stats.content_hits++;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    if (!d)
+    {
+      d = new vsx_bitmap_loader_data;
+      d->hash = hash;
+      bool ok;
+      if (entry->type == 2)
+        ok = decode_vxt(d, entry->error, data, size);
+      else
+      if (entry->type == 1)
+        ok = decode_jpeg(d, entry->error, data, size, data_alpha, size_alpha);
+      else
+        ok = decode_png(d, entry->error, data, size);
+      if (!ok)
+      {
+        delete d;
+        d = 0;
+      }
+      else
+      {
+        pthread_mutex_lock(&mutex);
+        stats.decodes++;
+        it = contents.find(hash);
+        if (it != contents.end())
+        {
+          // somebody else decoded the same thing meanwhile, use theirs
+          if (d->bitmap.data) free(d->bitmap.data);
+          if (d->container) delete d->container;
+          delete d;
+          d = (*it).second;
+        }
+        else
+        {
+          contents[hash] = d;
+          stats.bytes_resident += d->bytes;
+        }
+        d->references++;
+        pthread_mutex_unlock(&mutex);
+      }
+    }
+  }
+
+  if (data) free(data);
+  if (data_alpha) free(data_alpha);
+
+  pthread_mutex_lock(&mutex);
+  if (d)
+  {
+    char name[32];
+    sprintf(name, "bitmap:%016llx", (unsigned long long)d->hash);
+    entry->data = d;
+    entry->bitmap = d->bitmap;
+    entry->container = d->container;
+    entry->content_name = name;
+    entry->state = VSX_BITMAP_LOADER_DONE;
+    trim();
+  }
+  else
+  {
+    stats.failures++;
+    entry->state = VSX_BITMAP_LOADER_FAILED;
+  }
+  pthread_mutex_unlock(&mutex);
+}
+
+//---------------------------------------------------------------------------
+
+void vsx_bitmap_loader_prefetch::add(vsx_string filename, vsxf* filesystem, vsx_string filename_alpha)
+{
+  for (std::list<vsx_bitmap_loader_entry*>::iterator it = entries.begin(); it != entries.end(); ++it)
+  {
+    if ((*it)->filename == filename && (*it)->filename_alpha == filename_alpha)
+    {
+      // newest again
+      vsx_bitmap_loader_entry* entry = *it;
+      entries.erase(it);
+      entries.push_back(entry);
+      return;
+    }
+  }
+  entries.push_back(vsx_bitmap_loader::get_instance()->request(filename, filesystem, VSX_BITMAP_LOADER_PRIORITY_PREFETCH, filename_alpha));
+  while (entries.size() > VSX_BITMAP_LOADER_PREFETCH_MAX)
+  {
+    vsx_bitmap_loader::get_instance()->release(entries.front(), filesystem);
+    entries.pop_front();
+  }
+}
+
+void vsx_bitmap_loader_prefetch::remove(vsx_string filename, vsxf* filesystem, vsx_string filename_alpha)
+{
+  for (std::list<vsx_bitmap_loader_entry*>::iterator it = entries.begin(); it != entries.end(); ++it)
+  {
+    if ((*it)->filename == filename && (*it)->filename_alpha == filename_alpha)
+    {
+      vsx_bitmap_loader::get_instance()->release(*it, filesystem);
+      entries.erase(it);
+      return;
+    }
+  }
+}
+
+void vsx_bitmap_loader_prefetch::clear(vsxf* filesystem)
+{
+  for (std::list<vsx_bitmap_loader_entry*>::iterator it = entries.begin(); it != entries.end(); ++it)
+    vsx_bitmap_loader::get_instance()->release(*it, filesystem);
+  entries.clear();
+}
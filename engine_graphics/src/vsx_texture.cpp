@@ -586,12 +586,20 @@ void vsx_texture::reinit_all_active()
   std::map<vsx_string, vsx_texture_info> temp_glist = t_glist;
   vsx_string tname;
   for (std::map<vsx_string, vsx_texture_info>::iterator it = temp_glist.begin(); it != temp_glist.end(); ++it) {
+    tname = (*it).first;
     if ((*it).second.type == 1)
     {
-      tname = (*it).first;
       t_glist.erase(tname);
       load_png(tname);
     }
+    if ((*it).second.type == 2)
+    {
+      t_glist.erase(tname);
+      load_container(tname);
+    }
+    // the users of the old entry still count
+    if (t_glist.find(tname) != t_glist.end())
+      t_glist[tname].references = (*it).second.references;
   }
 }
 
@@ -601,6 +609,33 @@ void vsx_texture::upload_ram_bitmap(vsx_bitmap* vbitmap,bool mipmaps, bool upsid
   upload_ram_bitmap(vbitmap->data, vbitmap->size_x, vbitmap->size_y,mipmaps,vbitmap->bpp, vbitmap->bformat,upside_down);
 }
 
+void vsx_texture::upload_ram_bitmap_cached(vsx_bitmap* vbitmap, vsx_string cache_name, bool mipmaps, bool upside_down)
+{
+  if (mipmaps)
+    cache_name += ":mip";
+  if (name == cache_name && texture_info.ogl_id != 0)
+    return;
+  // let go of whatever we had, shared or not
+  unload();
+  if (t_glist.find(cache_name) != t_glist.end())
+  {
+    t_glist[cache_name].references++;
+    texture_info = t_glist[cache_name];
+    name = cache_name;
+    locked = true;
+    valid = true;
+    return;
+  }
+  name = "";
+  init_opengl_texture();
+  upload_ram_bitmap(vbitmap, mipmaps, upside_down);
+  name = cache_name;
+  locked = true;
+  texture_info.type = 3; // shared bitmap, owners upload it again after a context loss
+  texture_info.references = 1;
+  t_glist[cache_name] = texture_info;
+}
+
 void vsx_texture::upload_ram_bitmap(void* data, unsigned long size_x, unsigned long size_y, bool mipmaps, int bpp, int bpp2, bool upside_down)
 {
   if (!mipmaps)
@@ -756,7 +791,9 @@ void vsx_texture::load_png(vsx_string fname, bool mipmaps, vsxf* filesystem)
   if (t_glist.find(fname) != t_glist.end()) {
     //printf("already found png: %s\n",fname.c_str());
     locked = true;
+    t_glist[fname].references++;
     texture_info = t_glist[fname];
+    name = fname;
     return;
   } else
   {
@@ -783,6 +820,7 @@ void vsx_texture::load_png(vsx_string fname, bool mipmaps, vsxf* filesystem)
       upload_ram_bitmap((unsigned long*)(pp->Data),pp->Width,pp->Height,mipmaps,pp->Components,GL_RGBA);
       free(pp->Data);
       texture_info.type = 1; // png
+      texture_info.references = 1;
       //printf("name: %s\n",fname.c_str());
       t_glist[fname] = texture_info;
     }
@@ -791,6 +829,78 @@ void vsx_texture::load_png(vsx_string fname, bool mipmaps, vsxf* filesystem)
   }
 }
 
+void vsx_texture::upload_container(vsx_texture_container* container)
+{
+  if (!container || !container->levels.size())
+    return;
+  GLenum data_type = GL_UNSIGNED_BYTE;
+  GLint internal_format = GL_RGBA;
+  if (container->format == VSX_TEXTURE_CONTAINER_RGBA16F)
+  {
+    #ifdef VSXU_OPENGL_ES
+      printf("vsx_texture: half float textures not supported on GL ES\n");
+      return;
+    #else
+      data_type = GL_HALF_FLOAT_ARB;
+      internal_format = GL_RGBA16F_ARB;
+    #endif
+  }
+  texture_info.ogl_type = GL_TEXTURE_2D;
+  GLboolean oldStatus = glIsEnabled(texture_info.ogl_type);
+  glEnable(texture_info.ogl_type);
+  glBindTexture(texture_info.ogl_type, texture_info.ogl_id);
+  glTexParameteri(texture_info.ogl_type, GL_TEXTURE_MIN_FILTER, container->levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(texture_info.ogl_type, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  #ifndef VSXU_OPENGL_ES
+    glTexParameteri(texture_info.ogl_type, GL_TEXTURE_MAX_LEVEL, container->levels.size() - 1);
+  #endif
+  // levels are already flipped and filtered, straight to the driver
+  for (size_t i = 0; i < container->levels.size(); i++)
+  {
+    vsx_texture_container_level& l = container->levels[i];
+    glTexImage2D(texture_info.ogl_type, i, internal_format, l.size_x, l.size_y, 0, GL_RGBA, data_type, l.data);
+  }
+  texture_info.size_x = container->size_x;
+  texture_info.size_y = container->size_y;
+  if(!oldStatus) glDisable(texture_info.ogl_type);
+  valid = true;
+}
+
+void vsx_texture::load_container(vsx_string fname, vsxf* filesystem)
+{
+  if (t_glist.find(fname) != t_glist.end()) {
+    locked = true;
+    t_glist[fname].references++;
+    texture_info = t_glist[fname];
+    name = fname;
+    return;
+  }
+  locked = false;
+  vsxf* i_filesystem = 0x0;
+  if (filesystem == 0x0)
+  {
+    i_filesystem = new vsxf;
+    filesystem = i_filesystem;
+  }
+  vsxf_handle* fp = filesystem->f_open(fname.c_str(), "rb");
+  if (fp)
+  {
+    vsx_texture_container container;
+    unsigned char* data = (unsigned char*)filesystem->f_data_get(fp);
+    if (data && container.load_memory(data, fp->size))
+    {
+      this->name = fname;
+      init_opengl_texture();
+      upload_container(&container);
+      texture_info.type = 2; // vxt
+      texture_info.references = 1;
+      t_glist[fname] = texture_info;
+    }
+    filesystem->f_close(fp);
+  }
+  if (i_filesystem) delete i_filesystem;
+}
+
 void vsx_texture::load_jpeg(vsx_string fname, bool mipmaps) {
     CJPEGTest cj;
     vsx_string ret;
@@ -824,8 +934,12 @@ void* png_worker(void *ptr) {
 // load a png but put the heavy processing in a thread
 void vsx_texture::load_png_thread(vsx_string fname, bool mipmaps)
 {
+  // let go of what we had while name still says what it is
+  if (texture_info.ogl_id != 0)
+    unload();
   if (t_glist.find(fname) != t_glist.end()) {
     locked = true;
+    t_glist[fname].references++;
     texture_info = t_glist[fname];
     this->name = fname;
     return;
@@ -857,8 +971,6 @@ bool vsx_texture::bind()
     if (pti_l)
     if (((pti*)pti_l)->thread_state == 2)
     {
-      if (texture_info.ogl_id != 0)
-      unload();
       init_opengl_texture();
       pngRawInfo* pp = (pngRawInfo*)(((pti*)pti_l)->pp);
       if (pp->Components == 1)
@@ -871,7 +983,18 @@ bool vsx_texture::bind()
       upload_ram_bitmap((unsigned long*)(pp->Data),pp->Width,pp->Height,false,pp->Components,GL_RGBA);
       free((((pti*)pti_l)->pp)->Data);
       texture_info.type = 1; // png
-      t_glist[name] = texture_info;
+      if (t_glist.find(name) != t_glist.end())
+      {
+        // someone else loaded the same file while the thread ran, share theirs
+        glDeleteTextures(1, &(texture_info.ogl_id));
+        t_glist[name].references++;
+        texture_info = t_glist[name];
+        locked = true;
+      } else
+      {
+        texture_info.references = 1;
+        t_glist[name] = texture_info;
+      }
       pthread_join(((pti*)pti_l)->worker_t,0);
       valid = true;
       delete (pti*)pti_l;
@@ -911,7 +1034,8 @@ void vsx_texture::unload()
   {
     if (name != "" && t_glist.find(name) != t_glist.end())
     {
-      if (!locked)
+      // shared, the last one out deletes it
+      if (--t_glist[name].references <= 0)
       {
         t_glist.erase(name);
         //printf("deleting GL texture\n");
@@ -29,6 +29,7 @@
 #include "vsx_param.h"
 #include "vsx_module.h"
 #include <pthread.h>
+#include "particle_kernels.h"
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -39,6 +40,7 @@
 class module_texture_to_bitmap : public vsx_module {
   // in
 	vsx_module_param_texture* texture_in;
+	vsx_module_param_int* async;
 	// out
 	vsx_module_param_bitmap* result1;
 	// internal
@@ -50,15 +52,83 @@ class module_texture_to_bitmap : public vsx_module {
 
   int p_updates;
 
+  // async readback: glGetTexImage goes into one pixel buffer while the
+  // other one, filled last frame, is mapped and copied out. The bitmap is
+  // one frame behind but the render thread doesn't wait for the GPU.
+  GLuint pbo[2];
+  bool pbo_filled[2];
+  int pbo_current;
+  unsigned long pbo_size_x;
+  unsigned long pbo_size_y;
+
+  void free_pbo()
+  {
+    if (pbo[0])
+      glDeleteBuffersARB(2, pbo);
+    pbo[0] = pbo[1] = 0;
+    pbo_filled[0] = pbo_filled[1] = false;
+    pbo_size_x = pbo_size_y = 0;
+  }
+
+  void read_sync()
+  {
+    glGetTexImage(GL_TEXTURE_2D,
+               0,
+               GL_RGBA,
+               GL_UNSIGNED_BYTE,
+               bitm.data);
+    bitm.valid = true;
+    ++bitm.timestamp;
+    result1->set_p(bitm);
+  }
+
+  void read_async()
+  {
+    if (pbo_size_x != bitm.size_x || pbo_size_y != bitm.size_y)
+    {
+      free_pbo();
+      glGenBuffersARB(2, pbo);
+      for (int i = 0; i < 2; i++)
+      {
+        glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, pbo[i]);
+        glBufferDataARB(GL_PIXEL_PACK_BUFFER_ARB, bitm.size_x * bitm.size_y * 4, 0, GL_STREAM_READ_ARB);
+      }
+      pbo_size_x = bitm.size_x;
+      pbo_size_y = bitm.size_y;
+      pbo_current = 0;
+    }
+    glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, pbo[pbo_current]);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    pbo_filled[pbo_current] = true;
+
+    pbo_current = 1 - pbo_current;
+    if (pbo_filled[pbo_current])
+    {
+      glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, pbo[pbo_current]);
+      void* p = glMapBufferARB(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+      if (p)
+      {
+        memcpy(bitm.data, p, bitm.size_x * bitm.size_y * 4);
+        glUnmapBufferARB(GL_PIXEL_PACK_BUFFER_ARB);
+        bitm.valid = true;
+        ++bitm.timestamp;
+        result1->set_p(bitm);
+      }
+    }
+    glBindBufferARB(GL_PIXEL_PACK_BUFFER_ARB, 0);
+  }
+
 public:
   
   void module_info(vsx_module_info* info)
   {
-    info->in_param_spec = "texture_in:texture";
+    info->in_param_spec = "texture_in:texture,async:enum?no|yes";
     info->identifier = "texture;loaders;texture2bitmap";
     info->out_param_spec = "bitmap:bitmap";
     info->component_class = "bitmap";
-    info->description = "transforms a texture into a bitmap (slow!)";
+    info->description = "transforms a texture into a bitmap (slow!)\n"
+                        "async = yes gives you the previous frame\n"
+                        "but doesn't stall rendering";
   }
   
   void param_set_notify(const vsx_string& name)
@@ -77,6 +147,12 @@ public:
     bitm.data = 0;
     bitm.valid = false;
     texture_in = (vsx_module_param_texture*)in_parameters.create(VSX_MODULE_PARAM_ID_TEXTURE,"texture_in");  
+    async = (vsx_module_param_int*)in_parameters.create(VSX_MODULE_PARAM_ID_INT,"async");
+    async->set(1);
+    pbo[0] = pbo[1] = 0;
+    pbo_filled[0] = pbo_filled[1] = false;
+    pbo_current = 0;
+    pbo_size_x = pbo_size_y = 0;
     loading_done = true;
   }
   void run() {
@@ -104,16 +180,13 @@ public:
           bitm.size_x = width;
           bitm.size_y = height;
         }
-          //printf("bwidth: %d\n",width);
-        glGetTexImage(GL_TEXTURE_2D,
-                   0,
-                   GL_RGBA,
-                   GL_UNSIGNED_BYTE,
-                   bitm.data);
-        //printf("bdata: %d\n",(unsigned int)bitm.data[0]);
-        bitm.valid = true;
-        ++bitm.timestamp;
-        result1->set_p(bitm);
+        if (async->get() && GLEW_ARB_pixel_buffer_object)
+          read_async();
+        else
+        {
+          free_pbo();
+          read_sync();
+        }
       }
       (*texture)->_bind();
     }
@@ -122,11 +195,14 @@ public:
   }  
   
   void stop() {
+    // the buffers die with the context
+    free_pbo();
   }
   
   void on_delete() {
     //printf("deleting bitmap..");
-    if (bitm.valid)
+    free_pbo();
+    if (bitm.data)
     delete[] (vsx_bitmap_32bt*)bitm.data;
   }
 };
@@ -142,6 +218,7 @@ class module_bitmap_to_particlesystem : public vsx_module {
 	vsx_module_param_float* size;
 	vsx_module_param_float* blobsize;
 	vsx_module_param_float* random_weight;
+	vsx_module_param_int* skip_dark;
 	// out
 	vsx_module_param_particlesystem* particlesystem_out;
 	// internal
@@ -151,6 +228,8 @@ class module_bitmap_to_particlesystem : public vsx_module {
 	int bitm_timestamp;
 	
   vsx_particlesystem particles;
+  vsx_array<vsx_vector> grid;
+  vsx_array<size_t> row_offsets;
 
   int p_updates;
   bool first;
@@ -160,10 +239,11 @@ public:
   void module_info(vsx_module_info* info)
   {
     info->identifier = "particlesystems;generators;bitmap2particlesystem";
-    info->in_param_spec = "bitmap_in:bitmap,size:float,blobsize:float,random_weight:float";
+    info->in_param_spec = "bitmap_in:bitmap,size:float,blobsize:float,random_weight:float,skip_dark:enum?no|yes";
     info->out_param_spec = "particlesystem_out:particlesystem";
     info->component_class = "particlesystem";
-    info->description = "";
+    info->description = "skip_dark = yes only emits particles\n"
+                        "for pixels that aren't black";
   }
   
   void param_set_notify(const vsx_string& name)
@@ -181,6 +261,7 @@ public:
     blobsize->set(0.1f);
     random_weight = (vsx_module_param_float*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"random_weight");  
     random_weight->set(0.5f);
+    skip_dark = (vsx_module_param_int*)in_parameters.create(VSX_MODULE_PARAM_ID_INT,"skip_dark");
     //bitmap_in->set_p(bitm2);
     particles.timestamp = 0;
     particles.particles = new vsx_array<vsx_particle>;
@@ -197,48 +278,52 @@ public:
         first = true;
         p_updates = param_updates;
       }
-      int i = 0;
-      int width = bitm->size_x;
-      //printf("width: %d\n",width);
-      //printf("height: %d\n",bitm->size_y);
+      // downstream modifiers work on the particles in place, so they're
+      // rebuilt every frame like before, not only when the bitmap changes
+      if (bitm->bformat != GL_RGBA || !bitm->data)
+        return;
+
+      unsigned long width = bitm->size_x;
+      unsigned long num = width * bitm->size_y;
+      if (!num)
+        return;
       float space = size->get()/(float)width;
       float dest = -size->get()*0.5f;
+      if (grid.size() != num)
+        first = true;
       if (first) {
+        // rand() isn't thread safe, the start positions are made here
+        unsigned long i = 0;
+        grid.allocate(num - 1);
+        grid.reset_used(num);
         for (size_t y = 0; y < bitm->size_y; ++y) {
-          for (int x = 0; x < width; ++x) {
-            (*particles.particles)[i].pos.x = dest+(float)x*space+random_weight->get()*(-0.5+(float)(rand()%1000)/1000.0f);
-            (*particles.particles)[i].pos.y = 0;
-            (*particles.particles)[i].pos.z = dest+(float)y*space+random_weight->get()*(-0.5+(float)(rand()%1000)/1000.0f);
+          for (unsigned long x = 0; x < width; ++x) {
+            grid[i].x = dest+(float)x*space+random_weight->get()*(-0.5+(float)(rand()%1000)/1000.0f);
+            grid[i].y = 0;
+            grid[i].z = dest+(float)y*space+random_weight->get()*(-0.5+(float)(rand()%1000)/1000.0f);
             ++i;
           }
         }
-        first = false;
       }
 
-      i = 0;
-      for (size_t y = 0; y < bitm->size_y; ++y) {
-        int cc = y*width;
-        if (bitm->bformat == GL_RGBA)
-        {
-          for (int x = 0; x < width; ++x) {
-            (*particles.particles)[i].color.b = ((float)(unsigned char)((((vsx_bitmap_32bt*)bitm->data)[cc+x]&0x00FF0000)>>16))/255.0f;
-            (*particles.particles)[i].color.g = ((float)(unsigned char)((((vsx_bitmap_32bt*)bitm->data)[cc+x]&0x0000FF00)>>8))/255.0f;
-            (*particles.particles)[i].color.r = ((float)(unsigned char)((((vsx_bitmap_32bt*)bitm->data)[cc+x]&0x000000FF)))/255.0f;
-            (*particles.particles)[i].color.a = 1.0f;
-            if ((*particles.particles)[i].color.b < 0.01f && (*particles.particles)[i].color.g < 0.01f && (*particles.particles)[i].color.r < 0.01f)
-            (*particles.particles)[i].size = 0.0f;
-            else
-            (*particles.particles)[i].size = (*particles.particles)[i].orig_size = blobsize->get();
-
-            (*particles.particles)[i].speed.x = 0;
-            (*particles.particles)[i].speed.y = 0;
-            (*particles.particles)[i].speed.z = 0;
-            (*particles.particles)[i].time = 0;
-            (*particles.particles)[i].lifetime = 1000000000;
-            ++i;
-          }
-        }
-      }
+      // reserve room for every pixel, the kernels write straight into it
+      particles.particles->allocate(num - 1);
+      row_offsets.allocate(bitm->size_y);
+
+      bitmap_particles_job job;
+      job.data = (vsx_bitmap_32bt*)bitm->data;
+      job.size_x = width;
+      job.size_y = bitm->size_y;
+      job.grid = grid.get_pointer();
+      job.particles = particles.particles->get_pointer();
+      job.blobsize = blobsize->get();
+      job.compact = skip_dark->get() != 0;
+      job.write_pos = first;
+      job.row_offsets = row_offsets.get_pointer();
+      size_t count = bitmap_particles_convert(job, vsx_thread_pool::get_instance());
+      particles.particles->reset_used(count);
+      first = false;
+      ++particles.timestamp;
       particlesystem_out->set_p(particles);
     }
   }
@@ -0,0 +1,231 @@
+/**
+* Project: VSXu: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef PARTICLE_KERNELS_H
+#define PARTICLE_KERNELS_H
+
+// Row kernels for particlesystems;generators;bitmap2particlesystem.
+//
+// One RGBA8 pixel becomes one particle. A pixel is lit when any of r, g, b
+// is above 0.01 (byte value 3 or more) - that's what the module always
+// did with floats, done here on the bytes. Unlit pixels either give a
+// particle of size 0 (the old behaviour, particle i is always pixel i) or
+// are skipped entirely when compacting, so only lit pixels cost anything
+// further down the chain.
+//
+// Compaction is two passes over rows so it can run on the thread pool:
+// count the lit pixels per row, prefix sum (on the caller), then write
+// every row to its own offset.
+//
+// No OpenGL in here, tools/vsxbench runs these on synthetic bitmaps.
+
+#include <stdlib.h>
+#include <string.h>
+#include "vsx_math_3d.h"
+#include "vsx_quaternion.h"
+#include "vsx_bitmap.h"
+#include "vsx_array.h"
+#include "vsx_particlesystem.h"
+#include "vsx_thread_pool.h"
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
+
+class bitmap_particles_job
+{
+public:
+  const vsx_bitmap_32bt* data;
+  unsigned long size_x;
+  unsigned long size_y;
+  const vsx_vector* grid; // start position per pixel
+  vsx_particle* particles; // size_x * size_y reserved
+  float blobsize;
+  bool compact;
+  bool write_pos; // non compact only, compact always writes it
+  size_t* row_offsets; // compact only, size_y + 1
+};
+
+inline bool bitmap_particles_lit(vsx_bitmap_32bt p)
+{
+  return (p & 0xFF) > 2 || ((p >> 8) & 0xFF) > 2 || ((p >> 16) & 0xFF) > 2;
+}
+
+// the plain version, the reference for the sse2 path
+inline void bitmap_particles_write(const bitmap_particles_job& j, vsx_particle* p, unsigned long pixel)
+{
+  vsx_bitmap_32bt c = j.data[pixel];
+  p->color.r = ((float)(unsigned char)(c & 0xFF)) / 255.0f;
+  p->color.g = ((float)(unsigned char)((c >> 8) & 0xFF)) / 255.0f;
+  p->color.b = ((float)(unsigned char)((c >> 16) & 0xFF)) / 255.0f;
+  p->color.a = 1.0f;
+  if (bitmap_particles_lit(c))
+    p->size = p->orig_size = j.blobsize;
+  else
+    p->size = 0.0f;
+  p->speed.x = 0;
+  p->speed.y = 0;
+  p->speed.z = 0;
+  p->time = 0;
+  p->lifetime = 1000000000;
+}
+
+#ifdef __SSE2__
+// 4 bits, one per pixel, set for lit pixels
+inline int bitmap_particles_lit_mask4(__m128i px)
+{
+  __m128i rgb = _mm_and_si128(px, _mm_set1_epi32(0x00FFFFFF));
+  __m128i above = _mm_subs_epu8(rgb, _mm_set1_epi8(2));
+  __m128i dark = _mm_cmpeq_epi32(above, _mm_setzero_si128());
+  return ~_mm_movemask_ps(_mm_castsi128_ps(dark)) & 0xF;
+}
+
+// r, g, b as floats divided by 255 (same rounding as the plain version), a = 1
+inline void bitmap_particles_colors4(__m128i px, __m128* out)
+{
+  const __m128 scale = _mm_set1_ps(255.0f);
+  const __m128i alpha_mask = _mm_set_epi32(-1, 0, 0, 0);
+  const __m128 one_alpha = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = _mm_unpacklo_epi8(px, zero);
+  __m128i hi = _mm_unpackhi_epi8(px, zero);
+  __m128i w[4] =
+  {
+    _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+    _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)
+  };
+  for (int k = 0; k < 4; k++)
+  {
+    __m128i c = _mm_andnot_si128(alpha_mask, w[k]);
+    out[k] = _mm_or_ps(_mm_div_ps(_mm_cvtepi32_ps(c), scale), one_alpha);
+  }
+}
+#endif
+
+inline void bitmap_particles_fill(const bitmap_particles_job& j, vsx_particle* p, unsigned long pixel)
+{
+  p->speed.x = 0;
+  p->speed.y = 0;
+  p->speed.z = 0;
+  p->time = 0;
+  p->lifetime = 1000000000;
+  if (j.compact || j.write_pos)
+    p->pos = j.grid[pixel];
+}
+
+// pass 1 of compaction, lit pixels per row into row_offsets[y + 1]
+inline void bitmap_particles_count_rows(const bitmap_particles_job& j, size_t start, size_t end)
+{
+  for (size_t y = start; y < end; y++)
+  {
+    const vsx_bitmap_32bt* row = j.data + y * j.size_x;
+    size_t count = 0;
+    unsigned long x = 0;
+#ifdef __SSE2__
+    for (; x + 4 <= j.size_x; x += 4)
+    {
+      int m = bitmap_particles_lit_mask4(_mm_loadu_si128((const __m128i*)(row + x)));
+      count += (m & 1) + ((m >> 1) & 1) + ((m >> 2) & 1) + ((m >> 3) & 1);
+    }
+#endif
+    for (; x < j.size_x; x++)
+      count += bitmap_particles_lit(row[x]);
+    j.row_offsets[y + 1] = count;
+  }
+}
+
+// pass 2 (or the only pass without compaction)
+inline void bitmap_particles_rows(const bitmap_particles_job& j, size_t start, size_t end)
+{
+  for (size_t y = start; y < end; y++)
+  {
+    unsigned long pixel = y * j.size_x;
+    const vsx_bitmap_32bt* row = j.data + pixel;
+    vsx_particle* out = j.particles + (j.compact ? j.row_offsets[y] : pixel);
+    unsigned long x = 0;
+#ifdef __SSE2__
+    for (; x + 4 <= j.size_x; x += 4)
+    {
+      __m128i px = _mm_loadu_si128((const __m128i*)(row + x));
+      int m = bitmap_particles_lit_mask4(px);
+      if (j.compact && !m)
+        continue;
+      __m128 colors[4];
+      bitmap_particles_colors4(px, colors);
+      for (int k = 0; k < 4; k++)
+      {
+        bool lit = (m >> k) & 1;
+        if (j.compact && !lit)
+          continue;
+        _mm_storeu_ps(&out->color.r, colors[k]);
+        if (lit)
+          out->size = out->orig_size = j.blobsize;
+        else
+          out->size = 0.0f;
+        bitmap_particles_fill(j, out, pixel + x + k);
+        ++out;
+      }
+    }
+#endif
+    for (; x < j.size_x; x++)
+    {
+      if (j.compact && !bitmap_particles_lit(row[x]))
+        continue;
+      bitmap_particles_write(j, out, pixel + x);
+      bitmap_particles_fill(j, out, pixel + x);
+      ++out;
+    }
+  }
+}
+
+inline void bitmap_particles_count_task(void* ptr, size_t start, size_t end)
+{
+  bitmap_particles_count_rows(*((bitmap_particles_job*)ptr), start, end);
+}
+
+inline void bitmap_particles_rows_task(void* ptr, size_t start, size_t end)
+{
+  bitmap_particles_rows(*((bitmap_particles_job*)ptr), start, end);
+}
+
+// the whole conversion, returns the number of particles written.
+// pool can be 0 to run everything on the calling thread.
+inline size_t bitmap_particles_convert(bitmap_particles_job& j, vsx_thread_pool* pool)
+{
+  if (j.compact)
+  {
+    j.row_offsets[0] = 0;
+    if (pool)
+      pool->parallel_for(j.size_y, 16, &bitmap_particles_count_task, (void*)&j);
+    else
+      bitmap_particles_count_rows(j, 0, j.size_y);
+    for (unsigned long y = 0; y < j.size_y; y++)
+      j.row_offsets[y + 1] += j.row_offsets[y];
+  }
+  if (pool)
+    pool->parallel_for(j.size_y, 16, &bitmap_particles_rows_task, (void*)&j);
+  else
+    bitmap_particles_rows(j, 0, j.size_y);
+  return j.compact ? j.row_offsets[j.size_y] : j.size_x * j.size_y;
+}
+
+#endif
@@ -23,91 +23,8 @@
 
 
 
-typedef unsigned char uint8;
-
-#define BLEND_NORMAL        0
-#define BLEND_LIGHTEN       1
-#define BLEND_DARKEN        2
-#define BLEND_MULTIPLY      3
-#define BLEND_AVERAGE       4
-#define BLEND_ADD           5
-#define BLEND_SUBTRACT      6
-#define BLEND_DIFFERENCE    7
-#define BLEND_NEGATION      8
-#define BLEND_SCREEN        9
-#define BLEND_EXCLUSION    10
-#define BLEND_OVERLAY      11
-#define BLEND_SOFT_LIGHT   12
-#define BLEND_HARD_LIGHT   13
-#define BLEND_COLOR_DODGE  14
-#define BLEND_COLOR_BURN   15
-#define BLEND_LINEAR_DODGE 16
-#define BLEND_LINEAR_BURN  17
-#define BLEND_LINEAR_LIGHT 18
-#define BLEND_VIVID_LIGHT  19
-#define BLEND_PIN_LIGHT    20
-#define BLEND_HARD_MIX     21
-#define BLEND_REFLECT      22
-#define BLEND_GLOW         23
-#define BLEND_PHOENIX      24
-
-#define min(A,B) A<B?A:B
-#define max(A,B) A>B?A:B
-
-#define Blend_Normal(A,B) ((unsigned char)(A))
-#define Blend_Lighten(A,B)  ((unsigned char)((B > A) ? B:A))
-#define Blend_Darken(A,B) ((unsigned char)((B > A) ? A:B))
-#define Blend_Multiply(A,B) ((unsigned char)((A * B) / 255))
-#define Blend_Average(A,B)  ((unsigned char)((A + B) / 2))
-#define Blend_Add(A,B)  ((unsigned char)((A + B > 255) ? 255:(A + B)))
-#define Blend_Subtract(A,B) ((unsigned char)((A + B < 255) ? 0:(A + B - 255)))
-#define Blend_Difference(A,B) ((unsigned char)(abs(A - B)))
-#define Blend_Negation(A,B) ((unsigned char)(255 - abs(255 - A - B)))
-#define Blend_Screen(A,B) ((unsigned char)(255 - (((255 - A) * (255 - B)) >> 8)))
-#define Blend_Exclusion(A,B)  ((unsigned char)(A + B - 2 * A * B / 255))
-#define Blend_Overlay(A,B)  ((unsigned char)((B < 128) ? (2 * A * B / 255):(255 - 2 * (255 - A) * (255 - B) / 255)))
-#define Blend_Soft_Light(A,B)  ((uint8)((B < 128) ? (2*((A >> 1)+64)) * (B/255):(255 - (2*(255-((A >> 1) + 64))*(255-B)/255))))
-#define Blend_Hard_Light(A,B)  (Blend_Overlay(B,A))
-#define Blend_Color_Dodge(A,B) ((uint8)((A == 255) ? A:((B << 8 ) / (255 - A) > 255) ? 255:((B << 8 ) / (255 - A))))
-#define Blend_Color_Burn(A,B)  ((uint8)((A == 0) ? 0:((255 - (((255 - B) << 8 ) / A)) < 0) ? 0:(255 - (((255 - B) << 8 ) / A))))
-#define Blend_Linear_Dodge(A,B)  (Blend_Add(A,B))
-#define Blend_Linear_Burn(A,B) (Blend_Subtract(A,B))
-#define Blend_Linear_Light(A,B)  ((uint8)(A < 128) ? Blend_Linear_Burn((2 * A),B):Blend_Linear_Dodge((2 * (A - 128)),B))
-#define Blend_Vivid_Light(A,B) ((uint8)(A < 128) ? Blend_Color_Burn((2 * A),B):Blend_Color_Dodge((2 * (A - 128)),B))
-#define Blend_Pin_Light(A,B) ((uint8)(A < 128) ? Blend_Darken((2 * A),B):Blend_Lighten((2 *(A - 128)),B))
-#define Blend_Hard_Mix(A,B)  ((uint8)(A < 255 - B) ? 0:255)
-#define Blend_Reflect(A,B)  ((uint8)((B == 255) ? B:((A * A / (255 - B) > 255) ? 255:(A * A / (255 - B)))))
-#define Blend_Glow(A,B) (Blend_Reflect(B,A))
-#define Blend_Phoenix(A,B)  ((uint8)(min(A,B) - max(A,B) + 255))
-#define Blend_Opacity(A,B,F,O)  ((uint8)(O * F(A,B) + (1 - O) * B))
-
-
-/*#define fl_Blend_Normal(A,B) ((unsigned char)(A))
-#define fl_Blend_Lighten(A,B)  ((unsigned char)((B > A) ? B:A))
-#define fl_Blend_Darken(A,B) ((unsigned char)((B > A) ? A:B))*/
-#define fl_Blend_Multiply(A,B) ((unsigned char)((A * B) / 255))
-/*#define fl_Blend_Average(A,B)  ((unsigned char)((A + B) / 2))
-#define fl_Blend_Add(A,B)  ((unsigned char)((A + B > 255) ? 255:(A + B)))
-#define fl_Blend_Subtract(A,B) ((unsigned char)((A + B < 255) ? 0:(A + B - 255)))
-#define fl_Blend_Difference(A,B) ((unsigned char)(abs(A - B)))
-#define fl_Blend_Negation(A,B) ((unsigned char)(255 - abs(255 - A - B)))
-#define fl_Blend_Screen(A,B) ((unsigned char)(255 - (((255 - A) * (255 - B)) >> 8)))
-#define fl_Blend_Exclusion(A,B)  ((unsigned char)(A + B - 2 * A * B / 255))
-#define fl_Blend_Overlay(A,B)  ((unsigned char)((B < 128) ? (2 * A * B / 255):(255 - 2 * (255 - A) * (255 - B) / 255)))
-#define fl_Blend_Soft_Light(A,B)  ((uint8)((B < 128) ? (2*((A >> 1)+64)) * (B/255):(255 - (2*(255-((A >> 1) + 64))*(255-B)/255))))
-#define fl_Blend_Hard_Light(A,B)  (Blend_Overlay(B,A))
-#define fl_Blend_Color_Dodge(A,B) ((uint8)((A == 255) ? A:((B << 8 ) / (255 - A) > 255) ? 255:((B << 8 ) / (255 - A))))
-#define fl_Blend_Color_Burn(A,B)  ((uint8)((A == 0) ? 0:((255 - (((255 - B) << 8 ) / A)) < 0) ? 0:(255 - (((255 - B) << 8 ) / A))))
-#define fl_Blend_Linear_Dodge(A,B)  (Blend_Add(A,B))
-#define fl_Blend_Linear_Burn(A,B) (Blend_Subtract(A,B))
-#define fl_Blend_Linear_Light(A,B)  ((uint8)(A < 128) ? Blend_Linear_Burn((2 * A),B):Blend_Linear_Dodge((2 * (A - 128)),B))
-#define fl_Blend_Vivid_Light(A,B) ((uint8)(A < 128) ? Blend_Color_Burn((2 * A),B):Blend_Color_Dodge((2 * (A - 128)),B))
-#define fl_Blend_Pin_Light(A,B) ((uint8)(A < 128) ? Blend_Darken((2 * A),B):Blend_Lighten((2 *(A - 128)),B))
-#define fl_Blend_Hard_Mix(A,B)  ((uint8)(A < 255 - B) ? 0:255)
-#define fl_Blend_Reflect(A,B)  ((uint8)((B == 255) ? B:((A * A / (255 - B) > 255) ? 255:(A * A / (255 - B)))))
-#define fl_Blend_Glow(A,B) (Blend_Reflect(B,A))
-#define fl_Blend_Phoenix(A,B)  ((uint8)(min(A,B) - max(A,B) + 255))*/
-#define fl_Blend_Opacity(A,B,F,O)  ((O * F(A,B) + (1 - O) * B))
+#include "blend_kernels.h"
+#include "vsx_thread_pool.h"
 
 // 0..24 blend types
 
@@ -120,9 +37,6 @@ class module_bitmap_blend : public vsx_module {
 
   int bitm_timestamp;
 
-  pthread_t	worker_t;
-
-
   int p_updates;
 
 public:
@@ -145,105 +59,46 @@ public:
   
   vsx_bitmap*       work_bitmap;
   bool              worker_running;
-  bool              thread_created;
-  int               thread_state;
+  volatile int      thread_state;
   int my_ref;
 
-  // our worker thread, to keep the tough generating work off the main loop
-  // this is a fairly simple operation, but when you want to generate fractals
-  // and decode film, you could run into several seconds of processing time. 
-  static void* worker(void *ptr)
+  // parameters are sampled in run() so the worker never touches them
+  blend_lut         lut;
+  blend_composite   composite;
+  int               work_blend_type;
+  float             work_opacity;
+  vsx_array<vsx_bitmap_32bt> zero_row;
+
+  static void worker_rows(void* ptr, size_t start, size_t end)
+  {
+    blend_composite_rows(*((blend_composite*)ptr), start, end);
+  }
+
+  // runs in the engine thread pool, to keep the tough generating work off the main loop.
+  // the rows are in turn split over the pool; this thread joins in on them.
+  static void worker(void *ptr)
   {
     module_bitmap_blend* mod = ((module_bitmap_blend*)ptr);
     vsx_bitmap* bitm = mod->work_bitmap;
-    vsx_bitmap* bitm1 = mod->bitm1;
-    vsx_bitmap* bitm2 = mod->bitm2;
-    
-    unsigned long x,y,ix,iy;
 
-    for (x = 0; x < bitm->size_x * bitm->size_y; x++) ((vsx_bitmap_32bt*)bitm->data)[x] = 0;
-    //TEEEEMP!
-    //bitm->timestamp++;
-    //bitm->valid = true;
-    //mod->thread_state = 2;
-    //return 0;
-    // END TEEEEEMP
-    
-    bool ixbound = false, iybound = false;
-    iy = 0;
-    for (y = (unsigned long)mod->bitm1_ofs->get(1); y < bitm->size_y && !iybound; y++)
-    {
-      ix = 0;
-      ixbound = false;
-      for (x = (unsigned long)mod->bitm1_ofs->get(0); x < bitm->size_x && !ixbound; x++)
-      {
-        ((vsx_bitmap_32bt*)bitm->data)[x + y * bitm->size_x] = ((vsx_bitmap_32bt*)bitm1->data)[ix + iy * bitm1->size_x];
-        ix++;
-        if (ix >= bitm1->size_x) ixbound = true;
-      }
-      iy++;
-      if (iy >= bitm1->size_y) iybound = true;
-    }
-
-    iybound = false;
-    iy = 0;
-    for (y = (unsigned long)mod->bitm2_ofs->get(1); y < bitm->size_y && !iybound; y++)
-    {
-      ix = 0;
-      ixbound = false;
-      for (x = (unsigned long)mod->bitm2_ofs->get(0); x < bitm->size_x && !ixbound; x++)
-      {
-        vsx_bitmap_32bt* data = (vsx_bitmap_32bt*)bitm->data;
-        vsx_bitmap_32bt* data2 = (vsx_bitmap_32bt*)bitm2->data;
-
-#define BLEND_FUNC(BLT) \
-      for (int a = 0; a < 4; a++)\
-      {\
-        ((unsigned char*)&data[x + y * bitm->size_x])[a] = Blend_Opacity(((unsigned char*)&data2[ix + iy * bitm2->size_x])[a],((unsigned char*)&data[x + y * bitm->size_x])[a],BLT,mod->bitm2_opacity->get());\
-      }\
-      
-  switch (mod->filter_type->get())
-  {
-    case BLEND_NORMAL       : BLEND_FUNC(Blend_Normal) break;
-    case BLEND_LIGHTEN      : BLEND_FUNC(Blend_Lighten) break;
-    case BLEND_DARKEN       : BLEND_FUNC(Blend_Darken) break;
-    case BLEND_MULTIPLY     : BLEND_FUNC(Blend_Multiply) break;
-    case BLEND_AVERAGE      : BLEND_FUNC(Blend_Average) break;
-    case BLEND_ADD          : BLEND_FUNC(Blend_Add) break;
-    case BLEND_SUBTRACT     : BLEND_FUNC(Blend_Subtract) break;
-    case BLEND_DIFFERENCE   : BLEND_FUNC(Blend_Difference) break;
-    case BLEND_NEGATION     : BLEND_FUNC(Blend_Negation) break;
-    case BLEND_SCREEN       : BLEND_FUNC(Blend_Screen) break;
-    case BLEND_EXCLUSION    : BLEND_FUNC(Blend_Exclusion) break;
-    case BLEND_OVERLAY      : BLEND_FUNC(Blend_Overlay) break;
-    case BLEND_SOFT_LIGHT   : BLEND_FUNC(Blend_Soft_Light) break;
-    case BLEND_HARD_LIGHT   : BLEND_FUNC(Blend_Hard_Light) break;
-    case BLEND_COLOR_DODGE  : BLEND_FUNC(Blend_Color_Dodge) break;
-    case BLEND_COLOR_BURN   : BLEND_FUNC(Blend_Color_Burn) break;
-    case BLEND_LINEAR_DODGE : BLEND_FUNC(Blend_Linear_Dodge) break;
-    case BLEND_LINEAR_BURN  : BLEND_FUNC(Blend_Linear_Burn) break;
-    case BLEND_LINEAR_LIGHT : BLEND_FUNC(Blend_Linear_Light) break;
-    case BLEND_VIVID_LIGHT  : BLEND_FUNC(Blend_Vivid_Light) break;
-    case BLEND_PIN_LIGHT    : BLEND_FUNC(Blend_Pin_Light) break;
-    case BLEND_HARD_MIX     : BLEND_FUNC(Blend_Hard_Mix) break;
-    case BLEND_REFLECT      : BLEND_FUNC(Blend_Reflect) break;
-    case BLEND_GLOW         : BLEND_FUNC(Blend_Glow) break;
-    case BLEND_PHOENIX      : BLEND_FUNC(Blend_Phoenix) break;
-  }
-      
-      ix++;
-      if (ix >= bitm2->size_x) ixbound = true;
-    }
-    iy++;
-    if (iy >= bitm2->size_y) iybound = true;
-  }
+    mod->lut.build(mod->work_blend_type, mod->work_opacity);
+    vsx_thread_pool::get_instance()->parallel_for(bitm->size_y, 16, &worker_rows, (void*)&mod->composite);
 
     bitm->timestamp++;
     bitm->valid = true;
     mod->thread_state = 2;
-    //printf("blob thread done\n");
-    // the thread will die here.
-    return 0;
+  }
+
+  void wait_for_worker()
+  {
+    while (thread_state == 1)
+    {
+#ifdef _WIN32
+      ::Sleep(1);
+#else
+      usleep(1000);
+#endif
+    }
   }
   
   void module_info(vsx_module_info* info)
@@ -297,7 +152,6 @@ BLEND_LINEAR_BURN|BLEND_LINEAR_LIGHT|BLEND_VIVID_LIGHT|BLEND_PIN_LIGHT|BLEND_HAR
   {
     thread_state = 0;
     worker_running = false;
-    thread_created = false;
     p_updates = -1;
     in1 = (vsx_module_param_bitmap*)in_parameters.create(VSX_MODULE_PARAM_ID_BITMAP,"in1");
     in2 = (vsx_module_param_bitmap*)in_parameters.create(VSX_MODULE_PARAM_ID_BITMAP,"in2");
@@ -337,13 +191,12 @@ BLEND_LINEAR_BURN|BLEND_LINEAR_LIGHT|BLEND_VIVID_LIGHT|BLEND_PIN_LIGHT|BLEND_HAR
   void run() {
     bitm1 = in1->get_addr();
     bitm2 = in2->get_addr();
-    // initialize our worker thread, we don't want to keep the renderloop waiting do we?
+    // hand the job to the thread pool, we don't want to keep the renderloop waiting do we?
     if (!worker_running)
     if (bitm1 && bitm2 && !to_delete_data)
     {
       if (bitm1->valid && bitm2->valid)
       if (timestamp1 != bitm1->timestamp || timestamp2 != bitm2->timestamp || p_updates != param_updates) {
-        //printf("both bitmaps are OK it seems %d - %d\n",bitm1->timestamp,timestamp1);
         p_updates = param_updates;
         bitm.valid = false;
         timestamp1 = bitm1->timestamp;
@@ -355,26 +208,39 @@ BLEND_LINEAR_BURN|BLEND_LINEAR_LIGHT|BLEND_VIVID_LIGHT|BLEND_PIN_LIGHT|BLEND_HAR
           bitm.data = new vsx_bitmap_32bt[(int)target_size->get(0)*(int)target_size->get(1)];
           bitm.size_x = (int)target_size->get(0);
           bitm.size_y = (int)target_size->get(1);
+          zero_row.reset_used();
+          zero_row.allocate(bitm.size_x);
+          zero_row.memory_clear();
         }
-        
-        //printf("creating thread\n");
+
+        composite.dst = (vsx_bitmap_32bt*)bitm.data;
+        composite.dst_x = bitm.size_x;
+        composite.dst_y = bitm.size_y;
+        composite.src1 = (vsx_bitmap_32bt*)bitm1->data;
+        composite.src1_x = bitm1->size_x;
+        composite.src1_y = bitm1->size_y;
+        composite.ofs1_x = (unsigned long)bitm1_ofs->get(0);
+        composite.ofs1_y = (unsigned long)bitm1_ofs->get(1);
+        composite.src2 = (vsx_bitmap_32bt*)bitm2->data;
+        composite.src2_x = bitm2->size_x;
+        composite.src2_y = bitm2->size_y;
+        composite.ofs2_x = (unsigned long)bitm2_ofs->get(0);
+        composite.ofs2_y = (unsigned long)bitm2_ofs->get(1);
+        composite.lut = &lut;
+        composite.zero_row = zero_row.get_pointer();
+        work_blend_type = filter_type->get();
+        work_opacity = bitm2_opacity->get();
+
         thread_state = 1;
         worker_running = true;
-        thread_created = true;
-        pthread_create(&worker_t, NULL, &worker, (void*)this);
-        //printf("done creating thread\n");
+        vsx_thread_pool::get_instance()->add_task(&worker, (void*)this);
       }
     }
     if (thread_state == 2) {
       if (bitm.valid && bitm_timestamp != bitm.timestamp)
       {
-        if (worker_running)
-        {
-          pthread_join(worker_t,0);
-        }
         worker_running = false;
         // ok, new version
-        //printf("uploading subplasma to param\n");
         bitm_timestamp = bitm.timestamp;
         result1->set_p(bitm);
         loading_done = true;
@@ -394,7 +260,7 @@ BLEND_LINEAR_BURN|BLEND_LINEAR_LIGHT|BLEND_VIVID_LIGHT|BLEND_PIN_LIGHT|BLEND_HAR
   void on_delete() {
     if (worker_running)
     {
-      pthread_join(worker_t,NULL);
+      wait_for_worker();
     }
     if (bitm.data)
     {
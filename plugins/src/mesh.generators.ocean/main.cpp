@@ -23,16 +23,34 @@
 
 
 #include "_configuration.h"
+#include "vsx_gl_global.h"
 #include "vsx_param.h"
 #include "vsx_module.h"
 #include "vsx_math_3d.h"
-#include "fftrefraction.h"
-#include <pthread.h>
-#include <semaphore.h>
+#include "vsx_thread_pool.h"
+#include "vsx_ocean.h"
 #if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
 #include <unistd.h>
 #endif
 
+// Both modules compute the next frame on the engine thread pool while the
+// previous one is drawn. The ocean itself splits its work over the pool
+// too, the task joins in on that.
+//
+// thread_state: 0 = idle, 1 = computing, 2 = result waiting in run()
+
+static void ocean_wait_for_worker(volatile int& thread_state)
+{
+  while (thread_state == 1)
+  {
+#ifdef _WIN32
+    ::Sleep(1);
+#else
+    usleep(1000);
+#endif
+  }
+}
+
 class vsx_module_mesh_ocean_tunnel_threaded : public vsx_module {
 public:
   // in
@@ -44,30 +62,15 @@ public:
   vsx_mesh* mesh;
   vsx_mesh* mesh_a;
   vsx_mesh* mesh_b;
-  //bool first_run;
-  Alaska ocean;
+  vsx_ocean ocean;
   float t;
+  float work_dtime;
 
-  // threading stuff
-  pthread_t         worker_t;
+  volatile int thread_state;
 
-  pthread_mutex_t   mesh_mutex;
-  int               thread_has_something_to_deliver; // locked by the mesh mutex
-  pthread_mutex_t   thread_exit_mutex;
-  sem_t sem_worker_todo; // indicates wether the worker should do anything.
-  bool              thread_created;
-
-  int p_updates;
-  bool              worker_running;
-  int               thread_state;
-  int               thread_exit;
   vsx_module_mesh_ocean_tunnel_threaded()
   {
-    pthread_mutex_init(&mesh_mutex,NULL);
-    pthread_mutex_init(&thread_exit_mutex,NULL);
-    sem_init(&sem_worker_todo,0,0);
-    thread_has_something_to_deliver = 0;
-    thread_created = false;
+    thread_state = 0;
     mesh_a = 0;
     mesh_b = 0;
   }
@@ -77,24 +80,12 @@ public:
 
   ~vsx_module_mesh_ocean_tunnel_threaded()
   {
-    if (thread_created)
-    {
-      pthread_mutex_lock(&thread_exit_mutex);
-        thread_exit = 1;
-      pthread_mutex_unlock(&thread_exit_mutex);
-      void* ret;
-      int jret = pthread_join(worker_t, &ret);
-      if (jret == 22) printf("ocean_tunnel_threaded: pthread_join failed: EINVAL\n");
-      if (jret == 3) printf("ocean_tunnel_threaded: pthread_join failed: ESRCH\n");
-    }
+    ocean_wait_for_worker(thread_state);
     if (mesh_a != 0)
     {
       delete mesh_a;
       delete mesh_b;
     }
-    pthread_mutex_destroy(&thread_exit_mutex);
-    pthread_mutex_destroy(&mesh_mutex);
-    sem_destroy(&sem_worker_todo);
   }
 
   void module_info(vsx_module_info* info)
@@ -110,163 +101,96 @@ public:
     mesh_a = new vsx_mesh;
     mesh_b = new vsx_mesh;
     mesh = mesh_a;
-    thread_state = 0;
-    thread_exit = 0;
-    worker_running = false;
     
     loading_done = false;
     time_speed = (vsx_module_param_float*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"time_speed");
     time_speed->set(0.2f);
     result = (vsx_module_param_mesh*)out_parameters.create(VSX_MODULE_PARAM_ID_MESH,"mesh");
-    //first_run = true;
-    ocean.calculate_ho();
+    ocean.calculate_h0();
     t = 0;
   }
 
-  static void* worker(void *ptr)
+  static void worker(void *ptr)
   {
-    while (1)
+    vsx_module_mesh_ocean_tunnel_threaded* my = ((vsx_module_mesh_ocean_tunnel_threaded*)ptr);
+    my->t += my->work_dtime;
+    my->ocean.update(my->t);
+    my->mesh->data->vertices.reset_used(0);
+    my->mesh->data->vertex_normals.reset_used(0);
+    my->mesh->data->vertex_tex_coords.reset_used(0);
+    my->mesh->data->faces.reset_used(0);
+    vsx_face face;
+    vsx_vector g;
+    vsx_vector c;
+    int nx = (int)my->ocean.size;
+    float world = my->ocean.world_size;
+    for (int L=-1;L<2;L++)
     {
-      vsx_module_mesh_ocean_tunnel_threaded* my = ((vsx_module_mesh_ocean_tunnel_threaded*)ptr);
-      if (0 == sem_trywait(&my->sem_worker_todo))
+      for (int i=0;i<nx;i++)
       {
-        pthread_mutex_lock(&my->mesh_mutex);
-        my->t += my->time_speed->get()*my->engine->real_dtime;
-        my->ocean.dtime = my->t;
-        my->ocean.display();
-        my->mesh->data->vertices.reset_used(0);
-        my->mesh->data->vertex_normals.reset_used(0);
-        my->mesh->data->vertex_tex_coords.reset_used(0);
-        my->mesh->data->faces.reset_used(0);
-        vsx_face face;
-        vsx_vector g;
-        vsx_vector c;
-        for (int L=-1;L<2;L++)
+        unsigned long b = 0;
+        for (int k=-1;k<2;k++)
         {
-          for (int i=0;i<(BIG_NX-1);i++)
+          unsigned long a = 0;
+          for (int j=0;j<=nx;j++)
           {
-            unsigned long b = 0;
-            for (int k=-1;k<2;k++)
+            if (j%2 == 1) continue;
+            for (int side = 0; side < 2; side++)
             {
-              unsigned long a = 0;
-              for (int j=0;j<(BIG_NY);j++)
-              {
-                //printf("j: %d\n", j);
-                if (j%2 == 1) continue;
-    #define TDIV (float)MAX_WORLD_X
-    #define TD2  (float)MAX_WORLD_X*0.5f
-                g.x = my->ocean.sea[i][j][0];//+L*MAX_WORLD_X;
-                g.y = my->ocean.sea[i][j][1];//+k*MAX_WORLD_Y;
-                g.z = my->ocean.sea[i][j][2];//*ocean.scale_height;
-
-                float gr = \
-                PI*2.0f * g.x/(TDIV);
-                float nra = gr + 90.0f / 360.0f * 2*PI;
-
-
-                vsx_vector nn;
-                nn.x = my->ocean.big_normals[i][j][0];
-                nn.y = my->ocean.big_normals[i][j][1];
-                nn.normalize();
-                my->mesh->data->vertex_normals.push_back(vsx_vector(\
-                  nn.x* cos(nra) + nn.y * -sin(nra),\
-                  nn.x* sin(nra) + nn.y * cos(nra),\
-                  my->ocean.big_normals[i][j][2]));
-                my->mesh->data->vertex_normals[my->mesh->data->vertex_normals.size()-1].normalize();
-
-
-                float gz = 2.0f+fabs(g.z)*1.5f;
-                c.x = cos(gr)*gz;
-                c.y = sin(gr)*gz;
-                c.z = g.y*2.0f;
-                b = my->mesh->data->vertices.push_back(c);
-                my->mesh->data->vertex_tex_coords.push_back(vsx_tex_coord__(fabs(g.x-TD2)*2.0f , fabs(g.y-TD2)*2.0f));
-                ++a;
-                if (a >= 3) {
-                  face.a = b-3;
-                  face.b = b-2;
-                  face.c = b-1;
-                  my->mesh->data->faces.push_back(face);
-                }
-                g.x = my->ocean.sea[i+1][j][0];//+L*MAX_WORLD_X;
-                g.y = my->ocean.sea[i+1][j][1];//+k*MAX_WORLD_Y;
-                g.z = my->ocean.sea[i+1][j][2];//*ocean.scale_height;
-
-                gr = \
-                PI*2.0f* g.x/(TDIV);
-                nra = gr + 90.0f / 360.0f * 2*PI;
-
-
-                nn.x = my->ocean.big_normals[i+1][j][0];
-                nn.y = my->ocean.big_normals[i+1][j][1];
-                nn.normalize();
-                my->mesh->data->vertex_normals.push_back(vsx_vector(\
-                  nn.x* cos(nra) + nn.y * -sin(nra),\
-                  nn.x* sin(nra) + nn.y * cos(nra),\
-                  my->ocean.big_normals[i+1][j][2]));
-
-                my->mesh->data->vertex_normals[my->mesh->data->vertex_normals.size()-1].normalize();
-
-                gz = 2.0f+fabs(g.z)*1.5f;
-                c.x = cos(gr)*gz;
-                c.y = sin(gr)*gz;
-                c.z = g.y*2.0f;
-                b = my->mesh->data->vertices.push_back(c);
-
-                my->mesh->data->vertex_tex_coords.push_back(vsx_tex_coord__(fabs(g.x-TD2)*2.0f , fabs(g.y-TD2)*2.0f));
-
-                ++a;
-
-                if (a >= 4) {
-                  face.a = b-3;
-                  face.b = b-2;
-                  face.c = b-1;
-                  my->mesh->data->faces.push_back(face);
-                }
+              my->ocean.get_position(i + side, j, g);
+
+              float gr = PI*2.0f * g.x/world;
+              float nra = gr + 90.0f / 360.0f * 2*PI;
+
+              vsx_vector& on = my->ocean.get_normal(i + side, j);
+              vsx_vector nn;
+              nn.x = on.x;
+              nn.y = on.y;
+              nn.normalize();
+              my->mesh->data->vertex_normals.push_back(vsx_vector(
+                nn.x* cos(nra) + nn.y * -sin(nra),
+                nn.x* sin(nra) + nn.y * cos(nra),
+                on.z));
+              my->mesh->data->vertex_normals[my->mesh->data->vertex_normals.size()-1].normalize();
+
+              float gz = 2.0f+fabs(g.z)*1.5f;
+              c.x = cos(gr)*gz;
+              c.y = sin(gr)*gz;
+              c.z = g.y*2.0f;
+              b = my->mesh->data->vertices.push_back(c);
+              my->mesh->data->vertex_tex_coords.push_back(vsx_tex_coord__(fabs(g.x-world*0.5f)*2.0f , fabs(g.y-world*0.5f)*2.0f));
+              ++a;
+              if (a >= (unsigned long)(3 + side)) {
+                face.a = b-3;
+                face.b = b-2;
+                face.c = b-1;
+                my->mesh->data->faces.push_back(face);
               }
             }
           }
         }
-        my->thread_has_something_to_deliver++;
-        pthread_mutex_unlock(&my->mesh_mutex);
-      } // sem_trywait
-      pthread_mutex_lock(&my->thread_exit_mutex);
-      int time_to_exit = my->thread_exit;
-      pthread_mutex_unlock(&my->thread_exit_mutex);
-      if (time_to_exit) {
-        int *retval = new int;
-        *retval = 0;
-        my->thread_exit = 0;
-        pthread_exit((void*)retval);
-        return 0;
       }
     }
+    my->thread_state = 2;
   }
 
   void run() {
     loading_done = true;
-    if (!thread_created)
+    if (thread_state == 2)
     {
-      pthread_create(&worker_t, NULL, &worker, (void*)this);
-      thread_created = true;
-      sem_post(&sem_worker_todo);
-      return;
+      mesh->timestamp++;
+      result->set(mesh);
+
+      // toggle to the other mesh
+      if (mesh == mesh_a) mesh = mesh_b;
+      else mesh = mesh_a;
+      thread_state = 0;
     }
-    // this concept assumes that the run takes shorter than the framerate to do
-    if (0 == pthread_mutex_lock(&mesh_mutex) )
+    if (thread_state == 0)
     {
-      // lock ackquired. thread is waiting for us to set the semaphore before doing anything again.
-      if (thread_has_something_to_deliver)
-      {
-        mesh->timestamp++;
-        result->set(mesh);
-
-        // toggle to the other mesh
-        if (mesh == mesh_a) mesh = mesh_b;
-        else mesh = mesh_a;
-        sem_post(&sem_worker_todo);
-      }
-      pthread_mutex_unlock(&mesh_mutex);
+      work_dtime = time_speed->get()*engine->real_dtime;
+      thread_state = 1;
+      vsx_thread_pool::get_instance()->add_task(&worker, (void*)this);
     }
   }
 };
@@ -287,61 +211,53 @@ public:
   vsx_module_param_float* wind_speed_y;
   vsx_module_param_float* time_speed;
   vsx_module_param_int* normals_only;
+  vsx_module_param_int* size;
   // out
   vsx_module_param_mesh* result;
+  vsx_module_param_bitmap* normal_map;
   // internal
   vsx_mesh* mesh;
   vsx_mesh* mesh_a;
   vsx_mesh* mesh_b;
-
-  //bool first_run;
-  Alaska ocean;
-
-  // threading stuff
-  pthread_t         worker_t;
-
-  pthread_mutex_t   mesh_mutex;
-  int               thread_has_something_to_deliver; // locked by the mesh mutex
-  pthread_mutex_t   thread_exit_mutex;
-  sem_t sem_worker_todo; // indicates wether the worker should do anything.
-  bool              thread_created;
-
-  int p_updates;
-  bool              worker_running;
-  int               thread_state;
-  int               thread_exit;
+  vsx_bitmap* bitmap;
+  vsx_bitmap bitmap_a;
+  vsx_bitmap bitmap_b;
+
+  vsx_ocean ocean;
+
+  // parameters are sampled in run() so the worker never touches them
+  volatile int thread_state;
+  bool work_new_spectrum;
+  size_t work_size;
+  float work_wind[2];
+  float work_phillips_a;
+  float work_dtime;
+  bool work_choppy;
+  // phillips_a at wind_speed 1
+  float default_phillips_a;
 
   vsx_module_mesh_ocean_threaded()
   {
-    pthread_mutex_init(&mesh_mutex,NULL);
-    pthread_mutex_init(&thread_exit_mutex,NULL);
-    sem_init(&sem_worker_todo,0,0);
-    thread_has_something_to_deliver = 0;
-    thread_created = false;
+    thread_state = 0;
+    default_phillips_a = ocean.phillips_a;
     mesh_a = 0;
     mesh_b = 0;
+    bitmap_a.data = 0;
+    bitmap_b.data = 0;
   }
 
   ~vsx_module_mesh_ocean_threaded()
   {
-    if (thread_created)
-    {
-      pthread_mutex_lock(&thread_exit_mutex);
-        thread_exit = 1;
-      pthread_mutex_unlock(&thread_exit_mutex);
-      void* ret;
-      int jret = pthread_join(worker_t, &ret);
-      if (jret == 22) printf("ocean_threaded: pthread_join failed: EINVAL\n");
-      if (jret == 3) printf("ocean_threaded: pthread_join failed: ESRCH\n");
-    }
+    ocean_wait_for_worker(thread_state);
     if (mesh_a != 0)
     {
       delete mesh_a;
       delete mesh_b;
     }
-    pthread_mutex_destroy(&thread_exit_mutex);
-    pthread_mutex_destroy(&mesh_mutex);
-    sem_destroy(&sem_worker_todo);
+    if (bitmap_a.data)
+      delete[] (vsx_bitmap_32bt*)bitmap_a.data;
+    if (bitmap_b.data)
+      delete[] (vsx_bitmap_32bt*)bitmap_b.data;
   }
 
   bool init() {
@@ -351,16 +267,23 @@ public:
   void module_info(vsx_module_info* info)
   {
     info->identifier = "mesh;generators;ocean";
-    info->description = "";
+    info->description = "Tessendorf FFT ocean.\n"
+                        "size is the grid resolution, the area\n"
+                        "stays the same. normals_only = yes\n"
+                        "turns the choppy displacement off.";
     info->in_param_spec =
         "time_speed:float,"
         "wave_speed:float,"
         "wind_speed_x:float,"
         "wind_speed_y:float,"
         "wind_speed:float,"
-        "normals_only:enum?no|yes"
+        "normals_only:enum?no|yes,"
+        "size:enum?32|64|128|256|512"
+        ;
+    info->out_param_spec =
+        "mesh:mesh,"
+        "normal_map:bitmap"
         ;
-    info->out_param_spec = "mesh:mesh";
     info->component_class = "mesh";
   }
 
@@ -369,9 +292,9 @@ public:
     mesh_a = new vsx_mesh;
     mesh_b = new vsx_mesh;
     mesh = mesh_a;
-    thread_state = 0;
-    thread_exit = 0;
-    worker_running = false;
+    bitmap = &bitmap_a;
+    bitmap_a.bpp = bitmap_b.bpp = 4;
+    bitmap_a.bformat = bitmap_b.bformat = GL_RGBA;
 
     loading_done = false;
     time_speed = (vsx_module_param_float*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"time_speed");
@@ -386,249 +309,70 @@ public:
     wind_speed_y = (vsx_module_param_float*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"wind_speed_y");
     wind_speed_y->set(30.0);
     normals_only = (vsx_module_param_int*)in_parameters.create(VSX_MODULE_PARAM_ID_INT,"normals_only");
+    size = (vsx_module_param_int*)in_parameters.create(VSX_MODULE_PARAM_ID_INT,"size");
+    size->set(1); // 64, what it always was
     result = (vsx_module_param_mesh*)out_parameters.create(VSX_MODULE_PARAM_ID_MESH,"mesh");
-    ocean.calculate_ho();
+    normal_map = (vsx_module_param_bitmap*)out_parameters.create(VSX_MODULE_PARAM_ID_BITMAP,"normal_map");
+    work_new_spectrum = true;
   }
 
-  static void* worker(void *ptr)
+  static void worker(void *ptr)
   {
-    while (1)
+    vsx_module_mesh_ocean_threaded* my = ((vsx_module_mesh_ocean_threaded*)ptr);
+    vsx_ocean& ocean = my->ocean;
+    if (my->work_new_spectrum)
     {
-      vsx_module_mesh_ocean_threaded* my = ((vsx_module_mesh_ocean_threaded*)ptr);
-      if (0 == sem_trywait(&my->sem_worker_todo))
-      {
-        pthread_mutex_lock(&my->mesh_mutex);
-
-        if (my->param_updates)
-        {
-          my->ocean.factor = my->wave_speed->get() * 10.0;
-          my->ocean.wind = my->wind_speed->get() * 0.1;
-          my->ocean.wind_global[0] = my->wind_speed_x->get();
-          my->ocean.wind_global[1] = my->wind_speed_y->get();
-          my->ocean.calculate_ho();
-          my->param_updates = 0;
-        }
-
-        my->ocean.dtime = my->engine->real_vtime*my->time_speed->get() * 0.1f;
-        my->ocean.normals_only = my->normals_only->get();
-
-        my->ocean.display();
-        my->mesh->data->vertices.reset_used(0);
-        my->mesh->data->vertex_normals.reset_used(0);
-        my->mesh->data->vertex_tex_coords.reset_used(0);
-        my->mesh->data->faces.reset_used(0);
-        vsx_face face;
-        for (int L=-1;L<2;L++)
-        {
-          for (int i=0;i<(BIG_NX-1);i++)
-          {
-            unsigned long b = 0;
-            for (int k=-1;k<2;k++)
-            {
-              unsigned long a = 0;
-              for (int j=0;j<(BIG_NY);j++)
-              {
-                my->mesh->data->vertex_normals.push_back(vsx_vector(my->ocean.big_normals[i][j][0],my->ocean.big_normals[i][j][1],my->ocean.big_normals[i][j][2]));
-                b = my->mesh->data->vertices.push_back(vsx_vector(my->ocean.sea[i][j][0]+L*MAX_WORLD_X,my->ocean.sea[i][j][1]+k*MAX_WORLD_Y,my->ocean.sea[i][j][2]*my->ocean.scale_height));
-                ++a;
-                if (a >= 3) {
-                  face.a = b-3;
-                  face.b = b-2;
-                  face.c = b-1;
-                  my->mesh->data->faces.push_back(face);
-                }
-
-                my->mesh->data->vertex_normals.push_back(vsx_vector(my->ocean.big_normals[i+1][j][0],my->ocean.big_normals[i+1][j][1],my->ocean.big_normals[i+1][j][2]));
-                b = my->mesh->data->vertices.push_back(vsx_vector(my->ocean.sea[i+1][j][0]+L*MAX_WORLD_X,my->ocean.sea[i+1][j][1]+k*MAX_WORLD_Y,my->ocean.sea[i+1][j][2]*my->ocean.scale_height));
-                ++a;
-                if (a >= 4) {
-                  face.a = b-3;
-                  face.b = b-2;
-                  face.c = b-1;
-                  my->mesh->data->faces.push_back(face);
-                }
-              }
-            }
-          }
-        }
-        my->thread_has_something_to_deliver++;
-        pthread_mutex_unlock(&my->mesh_mutex);
-      } // sem_trywait
-      pthread_mutex_lock(&my->thread_exit_mutex);
-      int time_to_exit = my->thread_exit;
-      pthread_mutex_unlock(&my->thread_exit_mutex);
-      if (time_to_exit) {
-        int *retval = new int;
-        *retval = 0;
-        my->thread_exit = 0;
-        pthread_exit((void*)retval);
-        return 0;
-      }
+      ocean.size = my->work_size;
+      ocean.wind[0] = my->work_wind[0];
+      ocean.wind[1] = my->work_wind[1];
+      ocean.phillips_a = my->work_phillips_a;
+      ocean.calculate_h0();
+      my->work_new_spectrum = false;
     }
+    ocean.choppy = my->work_choppy;
+    ocean.update(my->work_dtime);
+
+    ocean.build_mesh(my->mesh->data, 3);
+    if (my->mesh->data->faces.size() != 9 * ocean.size * ocean.size * 2)
+      ocean.build_faces(my->mesh->data, 3);
+    ocean.build_normal_map(*my->bitmap);
+    my->thread_state = 2;
   }
 
   void run() {
     loading_done = true;
-    if (!thread_created)
+    if (thread_state == 2)
     {
-      pthread_create(&worker_t, NULL, &worker, (void*)this);
-      thread_created = true;
-      sem_post(&sem_worker_todo);
-      return;
+      mesh->timestamp++;
+      result->set(mesh);
+      normal_map->set_p(*bitmap);
+
+      // toggle to the other mesh/bitmap
+      if (mesh == mesh_a) mesh = mesh_b;
+      else mesh = mesh_a;
+      if (bitmap == &bitmap_a) bitmap = &bitmap_b;
+      else bitmap = &bitmap_a;
+      thread_state = 0;
     }
-    // this concept assumes that the run takes shorter than the framerate to do
-    if (0 == pthread_mutex_lock(&mesh_mutex) )
+    if (thread_state == 0)
     {
-      // lock ackquired. thread is waiting for us to set the semaphore before doing anything again.
-      if (thread_has_something_to_deliver)
-      {
-
-        mesh->timestamp++;
-        result->set(mesh);
-
-        // toggle to the other mesh
-        if (mesh == mesh_a) mesh = mesh_b;
-        else mesh = mesh_a;
-        sem_post(&sem_worker_todo);
-      }
-      pthread_mutex_unlock(&mesh_mutex);
-    }
-  }
-};
-
-
-
-
-
-
-
-
-
-
-class vsx_module_mesh_ocean : public vsx_module {
-  // in
-  vsx_module_param_float* wave_speed;
-  vsx_module_param_float* wind_speed;
-  vsx_module_param_float* wind_speed_x;
-  vsx_module_param_float* wind_speed_y;
-  vsx_module_param_float* time_speed;
-  vsx_module_param_int* normals_only;
-  // out
-	vsx_module_param_mesh* result;
-	// internal
-	vsx_mesh* mesh;
-	//bool first_run;
-	Alaska ocean;
-public:
-
-  bool init() {
-    mesh = new vsx_mesh;
-    return true;
-  }
-
-  void on_delete()
-  {
-    delete mesh;
-  }
-
-  void module_info(vsx_module_info* info)
-  {
-    info->identifier = "mesh;generators;ocean";
-    info->description = "";
-    info->in_param_spec =
-        "time_speed:float,"
-        "wave_speed:float,"
-        "wind_speed_x:float,"
-        "wind_speed_y:float,"
-        "wind_speed:float,"
-        "normals_only:enum?no|yes"
-        ;
-    info->out_param_spec = "mesh:mesh";
-    info->component_class = "mesh";
-  }
-
-  void declare_params(vsx_module_param_list& in_parameters, vsx_module_param_list& out_parameters)
-  {
-    loading_done = false;
-    time_speed = (vsx_module_param_float*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"time_speed");
-    time_speed->set(1.0);
-
-    wave_speed = (vsx_module_param_float*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"wave_speed");
-    wave_speed->set(1.0);
-    wind_speed = (vsx_module_param_float*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"wind_speed");
-    wind_speed->set(1.0);
-    wind_speed_x = (vsx_module_param_float*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"wind_speed_x");
-    wind_speed_x->set(20.0);
-    wind_speed_y = (vsx_module_param_float*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"wind_speed_y");
-    wind_speed_y->set(30.0);
-    normals_only = (vsx_module_param_int*)in_parameters.create(VSX_MODULE_PARAM_ID_INT,"normals_only");
-    result = (vsx_module_param_mesh*)out_parameters.create(VSX_MODULE_PARAM_ID_MESH,"mesh");
-    ocean.calculate_ho();
-  }
-  void run() {
-    ocean.dtime = engine->real_vtime*time_speed->get() * 0.1f;
-    if (param_updates)
-    {
-      ocean.normals_only = normals_only->get();
-      ocean.factor = wave_speed->get() * 10.0;
-      ocean.wind = wind_speed->get() * 0.1;
-      ocean.wind_global[0] = wind_speed_x->get();
-      ocean.wind_global[1] = wind_speed_y->get();
-      ocean.calculate_ho();
+      work_new_spectrum = work_new_spectrum || param_updates;
       param_updates = 0;
+      work_size = (size_t)32 << (size->get() < 4 ? size->get() : 4);
+      work_wind[0] = wind_speed_x->get();
+      work_wind[1] = wind_speed_y->get();
+      // the old Alaska factor and wind, both relative to what they were
+      // by default: wave_speed scales time, wind_speed the wave amplitude
+      work_phillips_a = default_phillips_a * (wind_speed->get() > 0.0f ? wind_speed->get() : 0.0f);
+      work_dtime = engine->real_vtime*time_speed->get()*wave_speed->get() * 0.1f;
+      work_choppy = normals_only->get() == 0;
+      thread_state = 1;
+      vsx_thread_pool::get_instance()->add_task(&worker, (void*)this);
     }
-    ocean.display();
-    mesh->data->vertices.reset_used(0);
-    mesh->data->vertex_normals.reset_used(0);
-    mesh->data->vertex_tex_coords.reset_used(0);
-    mesh->data->faces.reset_used(0);
-    vsx_face face;
-    for (int L=-1;L<2;L++)
-    {
-      for (int i=0;i<(BIG_NX-1);i++)
-      {
-        unsigned long b = 0;
-        for (int k=-1;k<2;k++)
-        {
-          unsigned long a = 0;
-          for (int j=0;j<(BIG_NY);j++)
-          {
-            mesh->data->vertex_normals.push_back(vsx_vector(ocean.big_normals[i][j][0],ocean.big_normals[i][j][1],ocean.big_normals[i][j][2]));
-            b = mesh->data->vertices.push_back(vsx_vector(ocean.sea[i][j][0]+L*MAX_WORLD_X,ocean.sea[i][j][1]+k*MAX_WORLD_Y,ocean.sea[i][j][2]*ocean.scale_height));
-            ++a;
-            if (a >= 3) {
-              face.a = b-3;
-              face.b = b-2;
-              face.c = b-1;
-              mesh->data->faces.push_back(face);
-            }
-
-            mesh->data->vertex_normals.push_back(vsx_vector(ocean.big_normals[i+1][j][0],ocean.big_normals[i+1][j][1],ocean.big_normals[i+1][j][2]));
-            b = mesh->data->vertices.push_back(vsx_vector(ocean.sea[i+1][j][0]+L*MAX_WORLD_X,ocean.sea[i+1][j][1]+k*MAX_WORLD_Y,ocean.sea[i+1][j][2]*ocean.scale_height));
-            ++a;
-            if (a >= 4) {
-              face.a = b-3;
-              face.b = b-2;
-              face.c = b-1;
-              mesh->data->faces.push_back(face);
-            }
-          }
-        }
-      }
-    }
-    mesh->timestamp++;
-    
-    loading_done = true;
-    result->set_p(mesh);
   }
 };
 
 
-
-
-
-
-
 //******************************************************************************
 //*** F A C T O R Y ************************************************************
 //******************************************************************************
@@ -0,0 +1,317 @@
+/**
+* Project: VSXu: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include <math.h>
+#include "vsx_ocean.h"
+#include "vsx_thread_pool.h"
+
+// gauss.cpp
+void gauss(double work[2]);
+
+vsx_ocean::vsx_ocean()
+{
+  h0_size = 0;
+  current_time = 0.0f;
+  size = 64;
+  world_size = 64.0f;
+  gravity = 30.81f;
+  phillips_a = 0.0008f;
+  wind[0] = 20.0f;
+  wind[1] = 30.0f;
+  choppy = true;
+  lambda = 0.29f;
+  scale_height = 0.25f;
+}
+
+double vsx_ocean::phillips(double kx, double ky)
+{
+  double k2 = kx * kx + ky * ky;
+  if (k2 == 0)
+    return 0;
+  double v2 = wind[0] * wind[0] + wind[1] * wind[1];
+  double el = v2 / gravity;
+  double kw = kx * wind[0] + ky * wind[1];
+  // the exp(-|k|) at the end damps the smallest waves
+  return phillips_a * (exp(-1 / (k2 * el * el)) / (k2 * k2)) * (kw * kw / (k2 * v2)) * exp(-sqrt(k2) * 1.0);
+}
+
+void vsx_ocean::calculate_h0()
+{
+  if (size < 2 || !fft.init(size, size))
+  {
+    size = 64;
+    fft.init(size, size);
+  }
+  size_t num = size * size;
+  h0.resize(num);
+  h0_mirror.resize(num);
+  omega.resize(num);
+  k_unit.resize(num * 2);
+  spectrum_a.resize(num);
+  spectrum_b.resize(num);
+  height.assign(num, 0.0f);
+  displacement_x.assign(num, 0.0f);
+  displacement_y.assign(num, 0.0f);
+  normals.resize(num);
+
+  double gauss_value[2];
+  for (size_t i = 0; i < size; i++)
+  {
+    for (size_t j = 0; j < size; j++)
+    {
+      size_t n = i * size + j;
+      // centered, index size/2 is k = 0
+      double kx = 2.0 * PI * ((double)i - 0.5 * size) / world_size;
+      double ky = 2.0 * PI * ((double)j - 0.5 * size) / world_size;
+      double klen = sqrt(kx * kx + ky * ky);
+      gauss(gauss_value);
+      double root_of_phillips = sqrt(phillips(kx, ky));
+      h0[n].re = (float)(gauss_value[0] * root_of_phillips / sqrt(2.0));
+      h0[n].im = (float)(gauss_value[1] * root_of_phillips / sqrt(2.0));
+      omega[n] = (float)sqrt(klen * gravity);
+      // no displacement from the nyquist row/column, it is its own -k so
+      // -i k/|k| h isn't hermitian there and would leak into the height
+      bool nyquist = i == 0 || j == 0;
+      k_unit[n * 2] = klen > 0 && !nyquist ? (float)(kx / klen) : 0.0f;
+      k_unit[n * 2 + 1] = klen > 0 && !nyquist ? (float)(ky / klen) : 0.0f;
+    }
+  }
+  for (size_t i = 0; i < size; i++)
+  {
+    for (size_t j = 0; j < size; j++)
+    {
+      // -k, wrapped (the most negative k is its own mirror)
+      size_t m = ((size - i) & (size - 1)) * size + ((size - j) & (size - 1));
+      h0_mirror[i * size + j].re = h0[m].re;
+      h0_mirror[i * size + j].im = -h0[m].im;
+    }
+  }
+  h0_size = size;
+}
+
+void vsx_ocean::spectrum_task(void* arg, size_t start, size_t end)
+{
+  vsx_ocean* o = (vsx_ocean*)arg;
+  size_t size = o->size;
+  float t = o->current_time;
+  for (size_t i = start; i < end; i++)
+  {
+    for (size_t j = 0; j < size; j++)
+    {
+      size_t n = i * size + j;
+      float wt = o->omega[n] * t;
+      float c = cosf(wt);
+      float s = sinf(wt);
+      const vsx_fft_complex& a = o->h0[n];
+      const vsx_fft_complex& b = o->h0_mirror[n];
+      // h0 e^(iwt) + conj(h0(-k)) e^(-iwt)
+      float hr = a.re * c - a.im * s + b.re * c + b.im * s;
+      float hi = a.re * s + a.im * c - b.re * s + b.im * c;
+      if (o->choppy)
+      {
+        // D = -i k/|k| h, packed: A = H + i Dx
+        float ux = o->k_unit[n * 2];
+        float uy = o->k_unit[n * 2 + 1];
+        o->spectrum_a[n].re = hr + ux * hr;
+        o->spectrum_a[n].im = hi + ux * hi;
+        o->spectrum_b[n].re = uy * hi;
+        o->spectrum_b[n].im = -uy * hr;
+      }
+      else
+      {
+        o->spectrum_a[n].re = hr;
+        o->spectrum_a[n].im = hi;
+      }
+    }
+  }
+}
+
+void vsx_ocean::resolve_task(void* arg, size_t start, size_t end)
+{
+  vsx_ocean* o = (vsx_ocean*)arg;
+  size_t size = o->size;
+  for (size_t i = start; i < end; i++)
+  {
+    for (size_t j = 0; j < size; j++)
+    {
+      size_t n = i * size + j;
+      // the spectrum is centered, that shifts the result by (-1)^(i+j)
+      float sign = ((i + j) & 1) ? -1.0f : 1.0f;
+      o->height[n] = o->spectrum_a[n].re * sign;
+      if (o->choppy)
+      {
+        o->displacement_x[n] = o->spectrum_a[n].im * sign * o->lambda;
+        o->displacement_y[n] = o->spectrum_b[n].re * sign * o->lambda;
+      }
+      else
+      {
+        o->displacement_x[n] = 0.0f;
+        o->displacement_y[n] = 0.0f;
+      }
+    }
+  }
+}
+
+void vsx_ocean::normals_task(void* arg, size_t start, size_t end)
+{
+  vsx_ocean* o = (vsx_ocean*)arg;
+  size_t size = o->size;
+  size_t mask = size - 1;
+  float f = o->scale_height * (float)size / (2.0f * o->world_size);
+  for (size_t i = start; i < end; i++)
+  {
+    const float* prev = &o->height[((i - 1) & mask) * size];
+    const float* next = &o->height[((i + 1) & mask) * size];
+    const float* row = &o->height[i * size];
+    for (size_t j = 0; j < size; j++)
+    {
+      vsx_vector& nn = o->normals[i * size + j];
+      nn.x = -(next[j] - prev[j]) * f;
+      nn.y = -(row[(j + 1) & mask] - row[(j - 1) & mask]) * f;
+      nn.z = 1.0f;
+      nn.normalize();
+    }
+  }
+}
+
+void vsx_ocean::update(float t)
+{
+  if (h0_size != size)
+    calculate_h0();
+  current_time = t;
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+  pool->parallel_for(size, 8, &spectrum_task, (void*)this);
+  fft.inverse(&spectrum_a[0]);
+  if (choppy)
+    fft.inverse(&spectrum_b[0]);
+  pool->parallel_for(size, 8, &resolve_task, (void*)this);
+  pool->parallel_for(size, 8, &normals_task, (void*)this);
+}
+
+void vsx_ocean::build_normal_map(vsx_bitmap& bitmap)
+{
+  if (bitmap.size_x != size || bitmap.size_y != size || !bitmap.data)
+  {
+    if (bitmap.data)
+      delete[] (vsx_bitmap_32bt*)bitmap.data;
+    bitmap.data = new vsx_bitmap_32bt[size * size];
+    bitmap.size_x = size;
+    bitmap.size_y = size;
+  }
+  vsx_bitmap_32bt* p = (vsx_bitmap_32bt*)bitmap.data;
+  for (size_t y = 0; y < size; y++)
+  {
+    for (size_t x = 0; x < size; x++)
+    {
+      vsx_vector& nn = normals[x * size + y];
+      p[y * size + x] =
+        (vsx_bitmap_32bt)(unsigned char)(nn.x * 127.0f + 127.0f) |
+        (vsx_bitmap_32bt)(unsigned char)(nn.y * 127.0f + 127.0f) << 8 |
+        (vsx_bitmap_32bt)(unsigned char)(nn.z * 127.0f + 127.0f) << 16 |
+        0xFF000000;
+    }
+  }
+  bitmap.bpp = 4;
+  bitmap.valid = true;
+  ++bitmap.timestamp;
+}
+
+class vsx_ocean_mesh_job
+{
+public:
+  vsx_ocean* ocean;
+  vsx_vector* vertices;
+  vsx_vector* normals;
+  int tiles;
+};
+
+static void mesh_rows_task(void* arg, size_t start, size_t end)
+{
+  vsx_ocean_mesh_job* job = (vsx_ocean_mesh_job*)arg;
+  vsx_ocean* o = job->ocean;
+  size_t side = o->size + 1;
+  int first = -(job->tiles / 2);
+  vsx_vector p;
+  for (size_t i = start; i < end; i++)
+  {
+    for (size_t j = 0; j < side; j++)
+    {
+      o->get_position(i, j, p);
+      p.z *= o->scale_height;
+      vsx_vector& nn = o->get_normal(i, j);
+      for (int l = 0; l < job->tiles; l++)
+      for (int k = 0; k < job->tiles; k++)
+      {
+        size_t v = (size_t)(l * job->tiles + k) * side * side + i * side + j;
+        job->vertices[v].x = p.x + (float)(first + l) * o->world_size;
+        job->vertices[v].y = p.y + (float)(first + k) * o->world_size;
+        job->vertices[v].z = p.z;
+        job->normals[v] = nn;
+      }
+    }
+  }
+}
+
+void vsx_ocean::build_mesh(vsx_mesh_data* data, int tiles)
+{
+  size_t side = size + 1;
+  size_t count = (size_t)(tiles * tiles) * side * side;
+  data->vertices.allocate(count - 1);
+  data->vertices.reset_used(count);
+  data->vertex_normals.allocate(count - 1);
+  data->vertex_normals.reset_used(count);
+  vsx_ocean_mesh_job job;
+  job.ocean = this;
+  job.vertices = data->vertices.get_pointer();
+  job.normals = data->vertex_normals.get_pointer();
+  job.tiles = tiles;
+  vsx_thread_pool::get_instance()->parallel_for(side, 8, &mesh_rows_task, (void*)&job);
+}
+
+void vsx_ocean::build_faces(vsx_mesh_data* data, int tiles)
+{
+  size_t side = size + 1;
+  data->faces.reset_used(0);
+  data->faces.allocate((size_t)(tiles * tiles) * size * size * 2 - 1);
+  vsx_face* f = data->faces.get_pointer();
+  for (int t = 0; t < tiles * tiles; t++)
+  {
+    size_t base = (size_t)t * side * side;
+    for (size_t i = 0; i < size; i++)
+    {
+      for (size_t j = 0; j < size; j++)
+      {
+        // same two triangles per quad as the old strips
+        size_t v = base + i * side + j;
+        f->a = v;
+        f->b = v + side;
+        f->c = v + 1;
+        ++f;
+        f->a = v + side;
+        f->b = v + 1;
+        f->c = v + side + 1;
+        ++f;
+      }
+    }
+  }
+}
@@ -0,0 +1,119 @@
+/**
+* Project: VSXu: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef VSX_OCEAN_H
+#define VSX_OCEAN_H
+
+#include <vector>
+#include "vsx_math_3d.h"
+#include "vsx_bitmap.h"
+#include "vsx_mesh.h"
+#include "vsx_fft.h"
+
+// Tessendorf style FFT ocean, the successor of Joe Dart's "Alaska" code
+// (same phillips spectrum and constants so old states look about the same).
+//
+// Any power of two size, everything is per instance so several oceans can
+// update at once, and the heavy loops run on the engine thread pool:
+//
+//   spectrum  h~(k,t) = h0(k) e^(iwt) + conj(h0(-k)) e^(-iwt), by rows
+//   inverse   one complex FFT gives both height and x displacement (the
+//             spectra are hermitian, so they're packed as H + i Dx), a
+//             second one y displacement - skipped when choppy is off
+//   normals   central differences on the periodic height field
+//
+// The surface covers world_size x world_size; a bigger size means a finer
+// grid over the same area, not a bigger ocean.
+
+class vsx_ocean
+{
+  vsx_fft_2d fft;
+  size_t h0_size;
+  std::vector<vsx_fft_complex> h0; // h0(k)
+  std::vector<vsx_fft_complex> h0_mirror; // conj(h0(-k))
+  std::vector<float> omega; // dispersion, sqrt(g |k|)
+  std::vector<float> k_unit; // kx / |k|, ky / |k| pairs, 0 at k = 0
+  std::vector<vsx_fft_complex> spectrum_a; // height + i * displacement x
+  std::vector<vsx_fft_complex> spectrum_b; // displacement y
+  float current_time;
+
+  double phillips(double kx, double ky);
+
+  static void spectrum_task(void* arg, size_t start, size_t end);
+  static void resolve_task(void* arg, size_t start, size_t end);
+  static void normals_task(void* arg, size_t start, size_t end);
+
+public:
+  // settings, call calculate_h0() after changing any of them
+  size_t size; // grid points per side, power of two
+  float world_size;
+  float gravity;
+  float phillips_a;
+  float wind[2];
+  // these take effect on the next update()
+  bool choppy;
+  float lambda; // choppiness
+  float scale_height;
+
+  // results of update(), size * size each, index [x * size + y] like the
+  // old c[x][y] arrays
+  std::vector<float> height; // raw, not multiplied by scale_height yet
+  std::vector<float> displacement_x; // world units, 0 without choppy
+  std::vector<float> displacement_y;
+  std::vector<vsx_vector> normals;
+
+  vsx_ocean();
+
+  // random phillips spectrum for the current settings
+  void calculate_h0();
+
+  // surface at time t (seconds times speed, like Alaska::dtime)
+  void update(float t);
+
+  // grid point i, j in [0, size] - the far edges wrap around to the first
+  // row/column, shifted by world_size. z is the raw height like Alaska::sea.
+  inline void get_position(size_t i, size_t j, vsx_vector& p)
+  {
+    size_t ii = i & (size - 1);
+    size_t jj = j & (size - 1);
+    size_t n = ii * size + jj;
+    p.x = (float)i * world_size / (float)size + displacement_x[n];
+    p.y = (float)j * world_size / (float)size + displacement_y[n];
+    p.z = height[n];
+  }
+
+  inline vsx_vector& get_normal(size_t i, size_t j)
+  {
+    return normals[(i & (size - 1)) * size + (j & (size - 1))];
+  }
+
+  // size x size RGBA, normal * 127 + 127 in rgb, alpha 255
+  void build_normal_map(vsx_bitmap& bitmap);
+
+  // tiles x tiles copies of the (size + 1)^2 grid centered around the
+  // origin tile, vertices and normals only. build_faces() once per size.
+  void build_mesh(vsx_mesh_data* data, int tiles);
+  void build_faces(vsx_mesh_data* data, int tiles);
+};
+
+#endif
@@ -28,6 +28,10 @@
 #include "vsx_math_3d.h"
 #include "vsx_sequence.h"
 #include "vsx_bspline.h"
+#include "vsx_mesh_kernels.h"
+#include "vsx_soft_body.h"
+#include "parametric_surface.h"
+#include "supershape.h"
 
 class vsx_module_mesh_rand_points : public vsx_module {
   // in
@@ -581,60 +585,6 @@ public:
   }
 };
 
-void eval2D(double a, double b, float m,float n1,float n2,float n3,float phi,float &x,float &y){
-  double r;
-  double t1,t2;
-  //double a=1,b=1;
-
-  t1 = cos(m * phi / 4) / a;
-  t1 = fabs(t1);
-  t1 = pow(t1,n2);
-
-  t2 = sin(m * phi / 4) / b;
-  t2 = fabs(t2);
-  t2 = pow(t2,n3);
-
-  r = pow(t1+t2,1/n1);
-  if (fabs(r) == 0) {
-    x = 0;
-    y = 0;
-  } else {
-    r = 1 / r;
-    x = (float)(r * cos(phi));
-    y = (float)(r * sin(phi));
-  }
-}
-
-inline void eval3D(double a, double b, float m,float n1,float n2,float n3,float phi,float theta,float &x,float &y,float &z)
-{
-  double r;
-  double t1,t2;
-  //double a=1,b=1;
-
-  eval2D(a,b, m,n1,n2,n3,phi,x,y);
-
-  t1 = cos(m * theta / 4) / a;
-  t1 = fabs(t1);
-  t1 = pow(t1,n2);
-
-  t2 = sin(m * theta / 4) / b;
-  t2 = fabs(t2);
-  t2 = pow(t2,n3);
-
-  r = pow(t1+t2,1/n1);
-  if (fabs(r) == 0) {
-    x = 0;
-    y = 0;
-    z = 0;
-  } else {
-    r = 1 / r;
-    x *= (float)(r * cos(theta));
-    y *= (float)(r * cos(theta));
-    z = (float) (r * sin(theta));
-  }
-
-}
-
 class vsx_module_mesh_supershape : public vsx_module {
   // in
   vsx_module_param_float* x_num_segments;
@@ -654,8 +604,9 @@ class vsx_module_mesh_supershape : public vsx_module {
 	// internal
 	vsx_mesh* mesh;
 	bool first_run;
-	int n_segs;
 	int l_param_updates;
+	parametric_surface surface;
+	supershape_tables shape;
 public:
 
   void module_info(vsx_module_info* info)
@@ -723,238 +674,44 @@ public:
   }
 
   void run() {
-    if (l_param_updates != param_updates) first_run = true;
-    mesh->data->vertices[0] = vsx_vector(10);
-
-    if (first_run) {
-      l_param_updates = param_updates;
-      //printf("generating supershape mesh\n");
-      mesh->data->vertices.reset_used();
-      mesh->data->faces.reset_used();
-			int vi = 0; // vertex index
-
-			// sanity checks
-			float _x_start = x_start->get();
-			/*if (_x_start < -HALF_PI) _x_start = -HALF_PI;
-			if (_x_start > HALF_PI) _x_start = HALF_PI;*/
-
-			float _x_stop = x_stop->get();
-			/*if (_x_stop < -HALF_PI) _x_stop = -HALF_PI;
-			if (_x_stop > HALF_PI) _x_stop = HALF_PI;*/
-
-			if (_x_start > _x_stop) {
-				float t = _x_start;
-				_x_start = _x_stop;
-				_x_stop = t;
-			}
-
-			float _y_start = y_start->get();
-			/*if (_y_start < -PI) _y_start = -PI;
-			if (_y_start > PI) _y_start = PI;*/
-
-			float _y_stop = y_stop->get();
-			/*if (_y_stop < -PI) _y_stop = -PI;
-			if (_y_stop > PI) _y_stop = PI;*/
-
-			if (_y_start > _y_stop) {
-				float t = _y_start;
-				_y_start = _y_stop;
-				_y_stop = t;
-			}
+    if (l_param_updates == param_updates && !first_run)
+      return;
+    l_param_updates = param_updates;
+    first_run = false;
 
+    float _x_start = x_start->get();
+    float _x_stop = x_stop->get();
+    if (_x_start > _x_stop) {
+      float t = _x_start;
+      _x_start = _x_stop;
+      _x_stop = t;
+    }
+    float _y_start = y_start->get();
+    float _y_stop = y_stop->get();
+    if (_y_start > _y_stop) {
+      float t = _y_start;
+      _y_start = _y_stop;
+      _y_stop = t;
+    }
 
-			float theta_step = (_x_stop - _x_start) / x_num_segments->get();
-			float phi_step = (_y_stop - _y_start) / x_num_segments->get();
-			int _x_num_segments = (int)x_num_segments->get();
-			int _y_num_segments = (int)x_num_segments->get();
-
-
-			double _x_a = x_a->get();
-			double _x_b = x_b->get();
-			float _x_n1 = x_n1->get();
-			float _x_n2 = x_n2->get();
-			float _x_n3 = x_n3->get();
-			float _x_m = x_m->get();
-
-			/*double _y_a = y_a->get();
-			double _y_b = y_b->get();
-			double _y_n1 = y_n1->get();
-			double _y_n2 = y_n2->get();
-			double _y_n3 = y_n3->get();
-			double _y_m = y_m->get();*/
-
-      float scale = 1.0f;
-
-
-      float x1=0,y1=0,z1=0;
-      float x2=0,y2=0,z2=0;
-      float x3=0,y3=0,z3=0;
-//      float x4=0,y4=0,z4=0;
-
-      float phi = _y_start;
-
-      vsx_avector<vsx_vector> prev_row_normals;
-      vsx_avector<vsx_vector*> prev_row_threes;
-      vsx_vector prev_norm;
-
-      for (int i = 0; i < _x_num_segments+1; i++) {
-        float theta = (float)_x_start;
-
-        /*double r1 = pow(
-                    pow(
-                      fabs((1.0f / _x_a) * cos(_x_m * theta / 4.0f))
-                      , _x_n2)
-                    +
-                    pow(
-                      fabs((1.0f / _x_b) * sin(_x_m * theta / 4.0f))
-                      , _x_n3)
-                  , -1.0f/_x_n1);*/
-        for(int j = 0; j < _y_num_segments+1; j++) {
-          //eval3D(double a, double b, float m,float n1,float n2,float n3,float phi,float theta,float &x,float &y,float &z)
-
-	        eval3D(_x_a, _x_b, _x_m,_x_n1,_x_n2,_x_n3,phi       ,theta         ,x1,y1,z1);
-	        eval3D(_x_a, _x_b, _x_m,_x_n1,_x_n2,_x_n3,phi       ,theta+theta_step,x2,y2,z2);
-	        eval3D(_x_a, _x_b,_x_m,_x_n1,_x_n2,_x_n3,phi+phi_step,theta+theta_step,x3,y3,z3);
-	        //eval3D(_x_m,_x_n1,_x_n2,_x_n3,phi+phi_step,theta         ,x4,y4,z4);
-	        // Calc normal ->
-	        // create vectors
-	        float v1x=x1-x2; float v2x=x2-x3;
-	        float v1y=y1-y2; float v2y=y2-y3;
-	        float v1z=z1-z2; float v2z=z2-z3;
-	          // Get cross product of vectors
-	        float nx = (v1y * v2z) - (v1z * v2y);
-	        float ny = (v1z * v2x) - (v1x * v2z);
-	        float nz = (v1x * v2y) - (v1y * v2x);
-	        // Normalise final vector
-	        float vLen = (float)sqrt( (nx * nx) + (ny * ny) + (nz * nz) );
-	        vsx_vector norm(-nx/vLen,  -ny/vLen,  -nz/vLen);
-	        mesh->data->vertex_normals[vi] = norm;
-	        mesh->data->vertices[vi] = vsx_vector(x1*scale, y1*scale, z1*scale);
-	        vi++;
-          //mesh->data->vertex_normals[vi] = norm;
-          //mesh->data->vertices[vi] = vsx_vector(x4*scale, y4*scale, z4*scale);
-
-          //vi++;
-          /*mesh->data->vertex_normals[vi] = norm;
-          mesh->data->vertices[vi] = vsx_vector(x3*scale, y3*scale, z3*scale);
-          vi++;
-          mesh->data->vertex_normals[vi] = norm;
-          mesh->data->vertices[vi] = vsx_vector(x4*scale, y4*scale, z4*scale);
-          vi++;*/
-          //Gl.glNormal3f(nx/vLen,  ny/vLen,  nz/vLen);
-          //Gl.glVertex3f(x1*scale, y1*scale, z1*scale);
-          //Gl.glVertex3f(x2*scale, y2*scale, z2*scale);
-          //Gl.glVertex3f(x3*scale, y3*scale, z3*scale);
-          //Gl.glVertex3f(x4*scale, y4*scale, z4*scale);
-          //theta+=addTheta;
-
-          // per-vertex normals (try)
-          if (i > 0 && j > 0)
-          {
-            vsx_vector sum_norm = norm + prev_norm + prev_row_normals[j] + prev_row_normals[j-1];
-            sum_norm.normalize();
-            mesh->data->vertex_normals[vi-2] = sum_norm;
-            mesh->data->vertex_normals[vi-3] = sum_norm;
-            //printf("i: %d j: %d\n", i,j);
-            //mesh->data->vertex_normals[vi-_x_num_segments-2] = sum_norm;
-            //(*prev_row_threes[j]) = sum_norm;
-          }
-          prev_norm = norm;
+    float theta_step = (_x_stop - _x_start) / x_num_segments->get();
+    float phi_step = (_y_stop - _y_start) / x_num_segments->get();
+    int num_segments = (int)x_num_segments->get();
+    if (num_segments < 1) num_segments = 1;
 
-          if (i > 0 && j > 0)
-          {
-            vsx_face a;
-            a.a = vi - 1; // (0)
-            a.b = vi - _x_num_segments-1;
-            a.c = vi - _x_num_segments-2;
-            mesh->data->faces.push_back(a);
-            a.a = vi-2;
-            a.b = vi-1;
-            a.c = vi - _x_num_segments-2;
-            mesh->data->faces.push_back(a);
-
-  	        //a.a = vi-2; // 3
-  	        //a.b = vi-3; // 2
-  	        //a.c = vi-4; // 1
-  	        //mesh->data->faces.push_back(a);
-//            a.a = vi-2; // 3
-            //a.b = vi-4; // 1
-            //a.c = vi-1; // 4
-            //mesh->data->faces.push_back(a);
-          }
-          theta += theta_step;
-
-          prev_row_normals[j] = norm;
-          //prev_row_threes[j] = &mesh->data->vertex_normals[vi-2];
-					/*double r2 = pow(
-											pow(
-												fabs((1.0f / _y_a) * cos(_y_m * phi / 4.0f))
-												, _y_n2)
-											+
-											pow(
-											  fabs((1.0f / _y_b) * sin(_y_m * phi / 4.0f))
-											  , _y_n3)
-										, -1.0f/_y_n1);
-
-			    vsx_vector tmp_vec;//(sin(angle) * rad, y, cos(angle) * rad);
-			    tmp_vec.x = r1 * cos(phi) * r2 * cos(theta);
-			    tmp_vec.y = r1 * sin(phi) * r2 * cos(theta);
-			    tmp_vec.z = r2 * sin(theta);
-			    //printf("%f %f %f\n", tmp_vec.x, tmp_vec.y, tmp_vec.z);
-			    mesh->data->vertices[vi] = tmp_vec;
-			    mesh->data->vertex_normals[vi] = tmp_vec;
-			    mesh->data->vertex_colors[vi] = vsx_color(1, 1, 1, 1);
-			    phi += phi_step;
-			    vi++;*/
-				}
-				phi += phi_step;
-			}
+    // only the resolution changes the faces
+    if (surface.set_resolution(mesh->data, num_segments + 1, num_segments + 1))
+      surface.grid_faces(mesh->data, false);
 
-			/*vsx_vector tmp_vec = vsx_vector(0, 1, 0);
-	    mesh->data->vertices[vi] = tmp_vec;
-	    mesh->data->vertex_normals[vi] = tmp_vec;
-	    mesh->data->vertex_colors[vi] = vsx_color(1, 1, 1, 1);
-	  	vi++;
-			tmp_vec = vsx_vector(0, -1, 0);
-	    mesh->data->vertices[vi] = tmp_vec;
-	    mesh->data->vertex_normals[vi] = tmp_vec;
-	    mesh->data->vertex_colors[vi] = vsx_color(1, 1, 1, 1);
-	  	vi++;*/
-	  	 /*
-	  	for(int i = 0; i < _y_num_segments - 2; i++) {
-				for(int j = 0; j < _x_num_segments; j++) {
-					vsx_face a;
-					a.a = i * _x_num_segments + j;
-					a.b = (i + 1) * _x_num_segments + j;
-					a.c = i * _x_num_segments + ((j + 1) % _x_num_segments);
-					vsx_vector aa = mesh->data->vertices[a.b] - mesh->data->vertices[a.a];
-					vsx_vector b = mesh->data->vertices[a.c] - mesh->data->vertices[a.a];
-					vsx_vector n;
-					n.cross(aa,b);
-					n.normalize();
-					mesh->data->vertex_normals[a.a] = mesh->data->vertex_normals[a.b] = mesh->data->vertex_normals[a.c] = n;
-			    //printf("%d %d %d\n", a.a, a.b, a.c);
-					//mesh->data->faces.push_back(a);
-					a.a = i * _x_num_segments + ((j + 1) % _x_num_segments);
-					a.b = (i + 1) * _x_num_segments + j;
-					a.c = (i + 1) * _x_num_segments + ((j + 1) % _x_num_segments);
-			    //printf("%d %d %d\n", a.a, a.b, a.c);
-					aa = mesh->data->vertices[a.b] - mesh->data->vertices[a.a];
-					b = mesh->data->vertices[a.c] - mesh->data->vertices[a.a];
-					//vsx_vector n;
-					n.cross(aa,b);
-					n.normalize();
-					mesh->data->vertex_normals[a.a] = mesh->data->vertex_normals[a.b] = mesh->data->vertex_normals[a.c] = n;
-
-					mesh->data->faces.push_back(a);
-				}
-	  	}*/
-			first_run = false;
-			mesh->timestamp++;
-	    result->set_p(mesh);
-    }
+    shape.build(
+      x_a->get(), x_b->get(), x_m->get(), x_n1->get(), x_n2->get(), x_n3->get(),
+      _y_start, phi_step, _x_start, theta_step, surface.rows, surface.columns
+    );
 
-    //  }
+    surface.evaluate(mesh->data, &supershape_row, (void*)&shape);
+    surface.normals_grid(mesh->data, false);
+    mesh->timestamp++;
+    result->set_p(mesh);
   }
 };
 
@@ -1438,6 +1195,8 @@ class vsx_module_mesh_abstract_hand : public vsx_module {
   int l_param_updates;
   int current_num_stacks;
   int current_num_sectors;
+  parametric_surface surface;
+  parametric_surface_tube tube;
 
   // x_shape
   vsx_sequence seq_x_shape;
@@ -1556,18 +1315,24 @@ public:
   }
 
   void run() {
-    int new_num_stacks = (int)num_stacks->get();
-    int new_num_sectors = (int)num_sectors->get();
     if (param_updates == 0) return;
-
     param_updates = 0;
-//    if (current_num_stacks == new_num_stacks && current_num_sectors == new_num_sectors) return;
 
-    mesh->data->reset();
     calc_shapes();
 
-    current_num_sectors = new_num_sectors;
-    current_num_stacks = new_num_stacks;
+    current_num_sectors = (int)num_sectors->get();
+    current_num_stacks = (int)num_stacks->get();
+
+    // faces, texture coordinates and colors only change with the
+    // resolution, the shapes just move the vertices
+    if (surface.set_resolution(mesh->data, current_num_stacks, current_num_sectors))
+    {
+      surface.grid_faces(mesh->data, true);
+      surface.grid_tex_coords(mesh->data, true, false);
+      surface.grid_colors(mesh->data);
+      tube.resize(current_num_stacks, current_num_sectors);
+      tube.set_angles((float)(current_num_sectors - 1));
+    }
 
     float x_shape_multiplier_f = x_shape_multiplier->get();
     float y_shape_multiplier_f = y_shape_multiplier->get();
@@ -1575,153 +1340,28 @@ public:
     float size_shape_x_multiplier_f = size_shape_x_multiplier->get();
     float size_shape_y_multiplier_f = size_shape_y_multiplier->get();
 
-
-    int vi = 0; // vertex index
-
-    mesh->data->faces.reset_used();
-
     float one_div_num_stacks = 1.0f / (float)current_num_stacks;
-    //float one_div_num_sectors = 1.0f / (float)current_num_sectors;
-    float one_div_num_sectors_minus_one = 1.0f / (float)(current_num_sectors - 1);
-
-    //for(int i = 1; i < current_num_stacks; i++)
     for(int i = 0; i < current_num_stacks; i++)
     {
       // banana extends in z direction
       // x and y are the roundness
       float ip = (float)i * one_div_num_stacks;
       int index8192 = (int)round(8192.0f*ip);
-
-      vsx_vector circle_base_pos = vsx_vector(
-                                                x_shape[index8192] * x_shape_multiplier_f,
-                                                y_shape[index8192] * y_shape_multiplier_f,
-                                                z_shape[index8192] * z_shape_multiplier_f
-                                                );
-      int j;
-      for(j = 0; j < current_num_sectors; j++)
-      {
-        double j1 = (float)j * one_div_num_sectors_minus_one;
-        vsx_vector tmp_vec(
-            circle_base_pos.x + cos(j1 * TWO_PI) * size_shape_x[index8192] * size_shape_x_multiplier_f,
-            circle_base_pos.y + sin(j1 * TWO_PI) * size_shape_y[index8192] * size_shape_y_multiplier_f,
-            circle_base_pos.z
-        );
-        mesh->data->vertices[vi] = tmp_vec;
-        mesh->data->vertex_normals[vi] = tmp_vec - circle_base_pos;
-        mesh->data->vertex_normals[vi].normalize();
-        mesh->data->vertex_colors[vi] = vsx_color(1, 1, 1, 1);
-        mesh->data->vertex_tex_coords[vi].s = j1;
-        mesh->data->vertex_tex_coords[vi].t = ip;
-
-        if (i && j)
-        {
-          vsx_face a;
-          // c
-          //
-          // b   a (vi - 10)
-          a.a = vi - current_num_sectors;
-          a.b = vi-1;
-          a.c = vi - current_num_sectors-1;
-          mesh->data->faces.push_back(a);
-          // b   c (vi)
-          //
-          //     a (vi - 10)
-          a.a = vi - current_num_sectors;
-          a.b = vi;
-          a.c = vi-1;
-          mesh->data->faces.push_back(a);
-        }
-        vi++;
-      }
-      /*if (i > 1 && i < current_num_stacks-1)
-      {
-        vsx_face a;
-        // c
-        //
-        // b   a (vi - 10)
-        a.c = vi - current_num_sectors;
-        a.b = vi - current_num_sectors-1;
-        a.a = vi-1;
-        mesh->data->faces.push_back(a);
-        // b   c (vi)
-        //
-        //     a (vi - 10)
-        a.c = vi - current_num_sectors;
-        a.b = vi-1;
-        a.a = vi;
-        mesh->data->faces.push_back(a);
-      }*/
-    }
-
-      /*
-
-
-      double i1 = (double)(i-1) / (current_num_stacks-1);
-      float global_shape = sin(i1 * 3.14159);
-      double angle_stack = (double)i / current_num_stacks * PI;
-      float rad = (float)sin(angle_stack);
-      float y = (float)cos(angle_stack);
-      //double i1 = (double)i / current_num_sectors;
-      for(int j = 0; j < current_num_sectors; j++)
-      {
-        double j1 = (double)j / current_num_sectors;
-        double angle = j1 *  PI;
-        float s = (float)sin(angle) * rad;
-        vsx_vector tmp_vec(
-              s*growth->get() * global_shape,
-              y * global_shape,
-              ( (float)cos(angle) * rad  +  sin(s * 2.14) * bend->get()) * global_shape
-        );
-        //printf("%f %f %f\n", tmp_vec.x, tmp_vec.y, tmp_vec.z);
-        mesh->data->vertices[vi] = tmp_vec;
-        mesh->data->vertex_normals[vi] = tmp_vec;
-        mesh->data->vertex_colors[vi] = vsx_color(1, 1, 1, 1);
-        vi++;
-      }*/
-
-    /*vsx_vector tmp_vec = vsx_vector(0, 1, 0);
-    mesh->data->vertices[vi] = tmp_vec;
-    mesh->data->vertex_normals[vi] = tmp_vec;
-    mesh->data->vertex_colors[vi] = vsx_color(1, 1, 1, 1);
-    vi++;
-    tmp_vec = vsx_vector(0, -1, 0);
-    mesh->data->vertices[vi] = tmp_vec;
-    mesh->data->vertex_normals[vi] = tmp_vec;
-    mesh->data->vertex_colors[vi] = vsx_color(1, 1, 1, 1);
-    vi++;*/
-
-/*    for(int i = 0; i < (current_num_stacks - 2); i++) {
-      for(int j = 0; j < current_num_sectors; j++) {
-        vsx_face a;
-        a.a = i * current_num_sectors + j;
-        a.b = (i + 1) * current_num_sectors + j;
-        a.c = i * current_num_sectors + ((j + 1) % current_num_sectors);
-        //printf("%d %d %d\n", a.a, a.b, a.c);
-        mesh->data->faces.push_back(a);
-        a.a = i * current_num_sectors + ((j + 1) % current_num_sectors);
-        a.b = (i + 1) * current_num_sectors + j;
-        a.c = (i + 1) * current_num_sectors + ((j + 1) % current_num_sectors);
-        //printf("%d %d %d\n", a.a, a.b, a.c);
-        mesh->data->faces.push_back(a);
-      }
+      tube.center[i] = vsx_vector(
+                                    x_shape[index8192] * x_shape_multiplier_f,
+                                    y_shape[index8192] * y_shape_multiplier_f,
+                                    z_shape[index8192] * z_shape_multiplier_f
+                                  );
+      tube.x_axis[i] = vsx_vector(1.0f, 0.0f, 0.0f);
+      tube.y_axis[i] = vsx_vector(0.0f, 1.0f, 0.0f);
+      tube.radius_x[i] = size_shape_x[index8192] * size_shape_x_multiplier_f;
+      tube.radius_y[i] = size_shape_y[index8192] * size_shape_y_multiplier_f;
     }
+    surface.evaluate(mesh->data, &parametric_surface_tube::row, (void*)&tube);
+    if (current_num_stacks > 0)
+      surface.normals_radial(mesh->data, &tube.center[0]);
 
-    for(int j = 0; j < current_num_sectors; j++) {
-      vsx_face a;
-      a.a = vi - 2;
-      a.b = 0 * current_num_sectors + j;
-      a.c = 0 * current_num_sectors + ((j + 1) % current_num_sectors);
-      //printf("%d %d %d\n", a.a, a.b, a.c);
-      mesh->data->faces.push_back(a);
-      a.a = vi - 1;
-      a.b = (current_num_stacks - 2) * current_num_sectors + ((j + 1) % current_num_sectors);
-      a.c = (current_num_stacks - 2) * current_num_sectors + j;
-      //printf("%d %d %d\n", a.a, a.b, a.c);
-      mesh->data->faces.push_back(a);
-    }
-*/
-    //printf("%d\n", vi);
-    last_vertex_index->set( (float)vi );
+    last_vertex_index->set( (float)mesh->data->vertices.size() );
     mesh->timestamp++;
     result->set_p(mesh);
   }
@@ -1752,6 +1392,8 @@ class vsx_module_mesh_torus_knot : public vsx_module {
   int l_param_updates;
   int current_num_stacks;
   int current_num_sectors;
+  parametric_surface surface;
+  parametric_surface_tube tube;
 
   // x_shape
   vsx_sequence seq_x_shape;
@@ -1865,122 +1507,25 @@ public:
     delete mesh;
   }
 
-  void run() {
-
-    if (param_updates == 0) return;
-
-    param_updates = 0;
-
-    int new_num_stacks = (int)num_stacks->get();
-    int new_num_sectors = (int)num_sectors->get();
-
-//    if (current_num_stacks == new_num_stacks && current_num_sectors == new_num_sectors) return;
-
-    mesh->data->reset();
-    calc_shapes();
-
-    current_num_sectors = new_num_sectors;
-    current_num_stacks = new_num_stacks;
-
-    //float x_shape_multiplier_f = x_shape_multiplier->get();
-    //float y_shape_multiplier_f = y_shape_multiplier->get();
-    //float z_shape_multiplier_f = z_shape_multiplier->get();
-    float size_shape_x_multiplier_f = size_shape_x_multiplier->get();
-    float size_shape_y_multiplier_f = size_shape_y_multiplier->get();
-
-
-    int vi = 0; // vertex index
-
-    float Q = q->get();
-    float P = p->get();
-    float phiofs = phi_offset->get();
-
+  // the faces only depend on the resolution, this is how they've always
+  // been laid out (rows joined at the ends, the seam closed by hand)
+  void knot_faces()
+  {
     mesh->data->faces.reset_used();
-    float one_div_num_stacks = 1.0f / (float)(current_num_stacks);
-
-    //int num_vertices = current_num_stacks * (current_num_sectors-1);
-
+    int vi = 0; // vertex index
     for(int i = 0; i < current_num_stacks; i++)
     {
-      // banana extends in z direction
-      // x and y are the roundness
-      float ip = (float)i * one_div_num_stacks;
-      float ip2 = (float)(i+1) * one_div_num_stacks;
-      float phi = TWO_PI * ip;
-      float phi2 = TWO_PI * ip2;
-
-      // knot vertex pos
-
-      float r = 0.5f * (2.0f + sin( Q * phi ) );
-
-
-
-      int index8192 = (int)round(8192.0f*ip) % 8192;
-
-      vsx_vector circle_base_pos = vsx_vector(
-                                                r * cos ( P * phi + phiofs),
-                                                r * cos ( Q * phi + phiofs),
-                                                r * sin ( P * phi + phiofs)
-                                                //x_shape[index8192] * x_shape_multiplier_f,
-                                                //y_shape[index8192] * y_shape_multiplier_f,
-                                                //z_shape[index8192] * z_shape_multiplier_f
-                                                );
-      vsx_vector circle_base_pos_phi2 = vsx_vector(
-                                                r * cos ( P * phi2 +phiofs),
-                                                r * cos ( Q * phi2 +phiofs),
-                                                r * sin ( P * phi2 +phiofs)
-                                                );
-
-      // rotation calculation
-      vsx_vector T = circle_base_pos_phi2 - circle_base_pos;
-      vsx_vector N = circle_base_pos_phi2 + circle_base_pos;
-      vsx_vector B;
-      B.cross(T, N);
-      N.cross(B, T);
-      B.normalize();
-      N.normalize();
-
-
-      float j1_div_num_sectors = 1.0f / (float)(current_num_sectors);
-      int j;
-      for(j = 0; j < current_num_sectors; j++)
+      for(int j = 0; j < current_num_sectors; j++)
       {
-        double j1 = (float)j * j1_div_num_sectors;
-
-        //newpoint = point.x * N + point.y * B;
-
-        float px = cos(j1 * TWO_PI) * size_shape_x[index8192] * size_shape_x_multiplier_f;
-        float py = sin(j1 * TWO_PI) * size_shape_y[index8192] * size_shape_y_multiplier_f;
-
-        vsx_vector tmp_vec(
-            circle_base_pos.x,
-            circle_base_pos.y,
-            circle_base_pos.z
-        );
-
-        tmp_vec += N * px + B * py;
-
-        mesh->data->vertices[vi] = tmp_vec;
-        mesh->data->vertex_normals[vi] = tmp_vec - circle_base_pos;
-        mesh->data->vertex_normals[vi].normalize();
-        mesh->data->vertex_colors[vi] = vsx_color(1, 1, 1, 1);
-
         if (i && j)
         {
           vsx_face a;
           // c                      current row
           //
           // b   a (vi - 10)        prev row
-
-
           a.c = vi - current_num_sectors;
           a.b = vi - current_num_sectors-1;
           a.a = vi-1;
-          //if (i==1) {
-            //if (j > 1) mesh->data->faces.push_back(a);
-          //}
-          //else
-          //if (j)
           mesh->data->faces.push_back(a);
 
           // b   c (vi)
@@ -1995,65 +1540,26 @@ public:
       }
       if (i > 1 && i < current_num_stacks-1)
       {
-        //vi--;
         vsx_face a;
         // (vi-1)
         // a
         //
         // b   c (vi - 10)
-//        if (rand()%5 == 2)
-
-        //int ji = vi % num_vertices;//
-
-        {
-          a.c = vi - current_num_sectors ;
-          a.b = vi - current_num_sectors - 1;
-          a.a = vi - 1;
-          mesh->data->faces.push_back(a);
-        }
-        {
-          a.b = vi - current_num_sectors;
-          a.c = vi;
-          a.a = vi - 1;
-          mesh->data->faces.push_back(a);
-        }
+        a.c = vi - current_num_sectors ;
+        a.b = vi - current_num_sectors - 1;
+        a.a = vi - 1;
+        mesh->data->faces.push_back(a);
         // (vi-1)
         // b   a (vi)
         //
         //     c (vi - 10)
-
-
-
-        //a.c = vi - current_num_sectors+1;
-        //a.b = vi;
-        //a.a = vi - current_num_sectors;
-        //mesh->data->faces.push_back(a);
-        //vi++;
-      }
-
-
-
-      /*if (i > 1)// && i < current_num_stacks-1)
-      {
-        vsx_face a;
-        // c
-        //
-        // b   a (vi - 10)
-        a.c = vi - current_num_sectors;
-        a.b = vi - current_num_sectors-1;
-        a.a = vi-1;
-        mesh->data->faces.push_back(a);
-        // b   c (vi)
-        //
-        //     a (vi - 10)
-        a.c = vi - current_num_sectors;
-        a.b = vi-1;
-        a.a = vi;
+        a.b = vi - current_num_sectors;
+        a.c = vi;
+        a.a = vi - 1;
         mesh->data->faces.push_back(a);
-      }*/
+      }
     }
 
-    //if (rand()%4 == 2)
     for(int j = 0; j < current_num_sectors-1; j++)
     {
       if (j)
@@ -2083,21 +1589,81 @@ public:
       a.a = current_num_sectors - 1;
       mesh->data->faces.push_back(a);
     }
-    /*{
-      vsx_face a;
-      a.c = 0;
-      a.b = vi - current_num_sectors - 1;
-      a.a = current_num_sectors -2;
-      mesh->data->faces.push_back(a);
-    }*/
-    //printf("vi: %d\n", vi);
-    // vi=4829
-    // vi-current_num_sectors == 4819
+  }
 
-    // id=4818, 0, 8
+  void run() {
 
+    if (param_updates == 0) return;
+
+    param_updates = 0;
+
+    calc_shapes();
+
+    current_num_sectors = (int)num_sectors->get();
+    current_num_stacks = (int)num_stacks->get();
+
+    if (surface.set_resolution(mesh->data, current_num_stacks, current_num_sectors))
+    {
+      if (current_num_stacks > 0 && current_num_sectors > 0)
+        knot_faces();
+      surface.grid_colors(mesh->data);
+      tube.resize(current_num_stacks, current_num_sectors);
+      tube.set_angles((float)current_num_sectors);
+    }
+
+    float size_shape_x_multiplier_f = size_shape_x_multiplier->get();
+    float size_shape_y_multiplier_f = size_shape_y_multiplier->get();
+
+    float Q = q->get();
+    float P = p->get();
+    float phiofs = phi_offset->get();
+
+    float one_div_num_stacks = 1.0f / (float)(current_num_stacks);
+
+    // the frame of every ring along the knot, the rings themselves are
+    // written on the thread pool
+    for(int i = 0; i < current_num_stacks; i++)
+    {
+      float ip = (float)i * one_div_num_stacks;
+      float ip2 = (float)(i+1) * one_div_num_stacks;
+      float phi = TWO_PI * ip;
+      float phi2 = TWO_PI * ip2;
+
+      // knot vertex pos
+      float r = 0.5f * (2.0f + sin( Q * phi ) );
+
+      int index8192 = (int)round(8192.0f*ip) % 8192;
+
+      vsx_vector circle_base_pos = vsx_vector(
+                                                r * cos ( P * phi + phiofs),
+                                                r * cos ( Q * phi + phiofs),
+                                                r * sin ( P * phi + phiofs)
+                                                );
+      vsx_vector circle_base_pos_phi2 = vsx_vector(
+                                                r * cos ( P * phi2 +phiofs),
+                                                r * cos ( Q * phi2 +phiofs),
+                                                r * sin ( P * phi2 +phiofs)
+                                                );
+
+      // rotation calculation
+      vsx_vector T = circle_base_pos_phi2 - circle_base_pos;
+      vsx_vector N = circle_base_pos_phi2 + circle_base_pos;
+      vsx_vector B;
+      B.cross(T, N);
+      N.cross(B, T);
+      B.normalize();
+      N.normalize();
+
+      tube.center[i] = circle_base_pos;
+      tube.x_axis[i] = N;
+      tube.y_axis[i] = B;
+      tube.radius_x[i] = size_shape_x[index8192] * size_shape_x_multiplier_f;
+      tube.radius_y[i] = size_shape_y[index8192] * size_shape_y_multiplier_f;
+    }
+    surface.evaluate(mesh->data, &parametric_surface_tube::row, (void*)&tube);
+    if (current_num_stacks > 0)
+      surface.normals_radial(mesh->data, &tube.center[0]);
 
-    //printf("%d\n", vi);
     mesh->timestamp++;
     result->set_p(mesh);
   }
@@ -2365,10 +1931,11 @@ class vsx_module_mesh_ribbon_cloth : public vsx_module {
   int l_param_updates;
   bool regen;
   vsx_array<vsx_vector> face_lengths;
-  vsx_array<vsx_vector> vertices_speed;
   vsx_array<vsx_vector> vertices_orig;
   int num_runs;
   vsx_vector prev_pos;
+  vsx_soft_body body;
+  vsx_mesh_kernels kernels;
 public:
   bool init() {
     mesh = new vsx_mesh;
@@ -2468,14 +2035,6 @@ public:
     if (regen)
     {
       prev_pos = a;
-      vertices_speed.allocate((int)COUNT*4);
-      for (int i = 0; i < (int)COUNT*4; i++)
-      {
-        vertices_speed[i].x = 0.0f;
-        vertices_speed[i].y = -0.04f;
-        vertices_speed[i].z = 0.0f;
-      }
-      
       regen = false;
       mesh->data->faces.reset_used();
       for (int i = 0; i < (int)COUNT; i++)
@@ -2564,114 +2123,52 @@ public:
   #undef COUNT
     }
 
-    //vertices_speed.allocate( mesh->data->vertices.size() );
-    float fcount = 1.0f / (float)mesh->data->faces.size();
-    float dirx = -b.x*0.05f;
-    float dirz = -b.z*0.05f;
-    float stepsizemultiplier = 0.02f * step_size->get();
-    float gravity_pull = -0.01f;
-    vsx_face* face_p = mesh->data->faces.get_pointer();
-    vsx_vector* vertices_speed_p = vertices_speed.get_pointer();
-    vsx_vector* faces_length_p = face_lengths.get_pointer();
-    vsx_vector* vertex_p = mesh->data->vertices.get_pointer();
-
-    for (int j = 0; j < 8; j++)
+    if (!body.get_num_vertices())
     {
-      vsx_face* face_p_it = face_p;
-      for(unsigned int i = 0; i < mesh->data->faces.size(); i++) {
-        // face fetching
-        unsigned long fa = (*face_p_it).a;
-        unsigned long fb = (*face_p_it).b;
-        unsigned long fc = (*face_p_it).c;
-        face_p_it++;
-        // ---
-        
-        vsx_vector v0 = vertex_p[fa];
-        vsx_vector v1 = vertex_p[fb];
-        vsx_vector v2 = vertex_p[fc];
-        
-        vsx_vector edgeA = (v1 - v0);
-        vsx_vector edgeB = (v2 - v1);
-        vsx_vector edgeC = (v0 - v2);
-
-        float lenA = edgeA.length();
-        float lenB = edgeB.length();
-        float lenC = edgeC.length();
-
-        if (lenA < 0.0001f) lenA = 0.0001f;
-        if (lenB < 0.0001f) lenB = 0.0001f;
-        if (lenC < 0.0001f) lenC = 0.0001f;
-        float edgeForceA = (face_lengths[i].x - lenA) / faces_length_p[i].x;
-        float edgeForceB = (face_lengths[i].y - lenB) / faces_length_p[i].y;
-        float edgeForceC = (face_lengths[i].z - lenC) / faces_length_p[i].z;
-        float edgeAccA = edgeForceA / lenA;
-        float edgeAccB = edgeForceB / lenB;
-        float edgeAccC = edgeForceC / lenC;
-        vsx_vector accA = edgeA * edgeAccA;
-        vsx_vector accB = edgeB * edgeAccB;
-        vsx_vector accC = edgeC * edgeAccC;
-
+      // wind pulls hardest at the free end of the ribbon
+      float fcount = 1.0f / (float)mesh->data->faces.size();
+      std::vector<float> face_wind(mesh->data->faces.size());
+      for (size_t i = 0; i < face_wind.size(); i++)
+      {
         float ii = 1.0f - (float)i * fcount;
+        face_wind[i] = pow(sin(ii*1.57f),3.0f)*2.0f;
+      }
+      body.build(mesh->data->faces.get_pointer(), mesh->data->faces.size(), mesh->data->vertices.get_pointer(), mesh->data->vertices.size(), face_lengths.get_pointer(), &face_wind[0]);
+      body.set_speed(vsx_vector(0.0f, -0.04f, 0.0f));
+      // the first two pairs of vertices hang on the start point
+      body.pinned = 4;
+    }
 
-        vertices_speed_p[fa] -= (accA - accC)*stiffness->get();// * 0.8f;//(0.10f+0.9*ii);
-        vertices_speed_p[fb] -= (accB - accA)*stiffness->get();// * 0.8f;//(0.10f+0.9*ii);
-        vertices_speed_p[fc] -= (accC - accB)*stiffness->get();// * 0.8f;//(0.10f+0.9*ii);
-
-        vertices_speed_p[fa].y += gravity_pull;
-        vertices_speed_p[fb].y += gravity_pull;
-        vertices_speed_p[fc].y += gravity_pull;
-        float sp2 = pow(sin(ii*1.57f),3.0f)*2.0f;
-
-        vertices_speed_p[fa].x -= dirx*sp2;
-        vertices_speed_p[fb].x -= dirx*sp2;
-        vertices_speed_p[fc].x -= dirx*sp2;
+    body.step_size = 0.02f * step_size->get();
+    body.stiffness = stiffness->get();
+    body.damping = damping_factor->get();
+    body.face_acceleration = vsx_vector(0.0f, -0.01f, 0.0f);
+    body.wind = vsx_vector(b.x*0.05f, 0.0f, b.z*0.05f);
+    body.floor_y = floor_y->get();
+    vsx_vector* vertex_p = mesh->data->vertices.get_pointer();
 
-        vertices_speed_p[fa].z -= dirz*sp2;
-        vertices_speed_p[fb].z -= dirz*sp2;
-        vertices_speed_p[fc].z -= dirz*sp2;
-      }
-      vsx_vector mdist = a-prev_pos;  // prev_pos-------->a
-      float mdl = mdist.length();
-      if (mdl > 0.07f)
-      {
-        // prev_pos    <---0.1f a
-        mdist.normalize();
-        mdist.x = -mdist.x;
-        mdist.y = -mdist.y;
-        mdist.z = -mdist.z;
-        //printf("newlength: %f\n", mdl-0.01f);
-        addpos = mdist*(mdl-0.07f);
-        //printf("addpos: %f, %f, %f\n", addpos.x, addpos.y, addpos.z);
-        for(unsigned long i = 4; i < mesh->data->vertices.size(); i++) {
-          vertex_p[i] -= addpos;
-        }
-      }
-      prev_pos = a;
-      for(unsigned long i = 0; i < 4; i++)
-      {
-        mesh->data->vertices[i] = a;
-      }
-      float floor = floor_y->get();
+    // drag the ribbon along when the start point moves too far in one frame
+    vsx_vector mdist = a-prev_pos;  // prev_pos-------->a
+    float mdl = mdist.length();
+    if (mdl > 0.07f)
+    {
+      mdist.normalize();
+      addpos = mdist*(mdl-0.07f);
       for(unsigned long i = 4; i < mesh->data->vertices.size(); i++) {
-        //mesh->data->vertices[i] -= addpos;
-        vertex_p[i] += (vertices_speed[i] * stepsizemultiplier);
-        if (mesh->data->vertices[i].y < floor) mesh->data->vertices[i].y = floor;
-        vertices_speed[i] = vertices_speed[i] * damping_factor->get();
+        vertex_p[i] += addpos;
       }
     }
-    for(unsigned long i = 0; i < mesh->data->faces.size(); i++) {
-      vsx_vector a = mesh->data->vertices[mesh->data->faces[i].b] - mesh->data->vertices[mesh->data->faces[i].a];
-      vsx_vector b = mesh->data->vertices[mesh->data->faces[i].c] - mesh->data->vertices[mesh->data->faces[i].a];
-      vsx_vector normal;
-      normal.cross(a,b);
-
-      normal = -normal;
-      normal.normalize();
-      mesh->data->vertex_normals[mesh->data->faces[i].a] = normal;
-      mesh->data->vertex_normals[mesh->data->faces[i].b] = normal;
-      mesh->data->vertex_normals[mesh->data->faces[i].c] = normal;
+    prev_pos = a;
+    for(unsigned long i = 0; i < 4; i++)
+    {
+      vertex_p[i] = a;
     }
 
+    for (int j = 0; j < 8; j++)
+      body.step(vertex_p);
+    // smooth normals over the strip (the faces are clockwise)
+    kernels.calculate_vertex_normals(mesh->data, VSX_MESH_KERNELS_UNIT_FACES | VSX_MESH_KERNELS_FLIP);
+
     mesh->timestamp++;
     result->set(mesh);
     num_runs++;
@@ -3140,6 +2637,7 @@ class vsx_module_mesh_sphere_icosahedron : public vsx_module
   int l_param_updates;
   int current_subdivision_level;
   int current_max_normalization_level;
+  vsx_mesh_kernels kernels;
 
 public:
   void module_info(vsx_module_info* info)
@@ -3428,31 +2926,15 @@ public:
       face.b = index_a;
       face.c = index_c;
 
-      vsx_vector an;
-      an.assign_face_normal
-      (
-            &mesh->data->vertices[index_b],
-            &mesh->data->vertices[index_a],
-            &mesh->data->vertices[index_c]
-      );
-      //an.normalize();
-      mesh->data->vertex_normals[index_a] += an;
-      mesh->data->vertex_normals[index_b] += an;
-      mesh->data->vertex_normals[index_c] += an;
-
-
-
 //      face.a = i*3+1;
 //      face.b = i*3;
 //      face.c = i*3+2;
       mesh->data->faces.push_back(face);
     }
 
-    // normalize all normals
-    for (size_t i = 0; i < mesh->data->vertex_normals.size(); i++)
-    {
-      mesh->data->vertex_normals[i].normalize();
-    }
+    // area weighted normals from the faces around each vertex
+    kernels.topology_changed();
+    kernels.calculate_vertex_normals(mesh->data);
 
     if (maxlevel > 1)
     free(old);
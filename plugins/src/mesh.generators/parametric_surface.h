@@ -0,0 +1,366 @@
+/**
+* Project: VSXu: Realtime modular visual programming language, music/audio visualizer.
+*
+* This file is part of Vovoid VSXu.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef PARAMETRIC_SURFACE_H
+#define PARAMETRIC_SURFACE_H
+
+// Shared by the mesh;solid generators that are a rows x columns grid of
+// vertices (supershape, super_banana, torus_knot).
+//
+// The faces, texture coordinates and colors of such a grid only depend on
+// its resolution, so they're written once per resolution and left alone
+// while the shape parameters animate - faces.timestamp and
+// vertex_tex_coords.timestamp only move when they really changed.
+//
+// Positions are written a batch of rows at a time on the thread pool: the
+// module hands a row function that fills one row. Most shapes are a row
+// term times a column term, so the expensive math (pow, sin, cos) goes
+// into two small tables and the row function is a few multiplies per
+// vertex, 4 at a time with SSE.
+//
+// No OpenGL in here, "vsxbench parametric" checks these against the per
+// vertex code they replaced.
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "vsx_math_3d.h"
+#include "vsx_mesh.h"
+#include "vsx_thread_pool.h"
+#ifdef __SSE2__
+  #include <emmintrin.h>
+#endif
+
+// rows per task, a row is a few hundred vertices at most
+#define PARAMETRIC_SURFACE_CHUNK 8
+
+// fill columns vertices of row into out
+typedef void (*parametric_surface_row_func)(void* arg, int row, vsx_vector* out);
+
+class parametric_surface
+{
+public:
+  int rows;
+  int columns;
+
+  parametric_surface() : rows(0), columns(0) {}
+
+  // resizes the vertex arrays of data for a rows x columns grid. True when
+  // the resolution changed (or it's the first call) - the caller writes
+  // the faces, texture coordinates, colors then.
+  bool set_resolution(vsx_mesh_data* data, int n_rows, int n_columns)
+  {
+    if (n_rows < 0) n_rows = 0;
+    if (n_columns < 0) n_columns = 0;
+    if (n_rows == rows && n_columns == columns && data->vertices.size() == (size_t)(rows * columns))
+      return false;
+    rows = n_rows;
+    columns = n_columns;
+    size_t count = (size_t)rows * columns;
+    resize(data->vertices, count);
+    resize(data->vertex_normals, count);
+    data->faces.reset_used(0);
+    data->vertex_colors.reset_used(0);
+    data->vertex_tex_coords.reset_used(0);
+    data->faces.timestamp++;
+    data->vertex_tex_coords.timestamp++;
+    return true;
+  }
+
+  template<class T>
+  static void resize(vsx_array<T>& a, size_t count)
+  {
+    a.reset_used(0);
+    if (count)
+      a.allocate(count - 1);
+  }
+
+  // two triangles per quad of the grid, first triangle (row, col - 1),
+  // (row - 1, col), (row - 1, col - 1). flip turns both around.
+  void grid_faces(vsx_mesh_data* data, bool flip)
+  {
+    data->faces.reset_used(0);
+    if (rows < 2 || columns < 2)
+      return;
+    resize(data->faces, (size_t)(rows - 1) * (columns - 1) * 2);
+    vsx_face* f = data->faces.get_pointer();
+    for (int i = 1; i < rows; i++)
+      for (int j = 1; j < columns; j++)
+      {
+        unsigned int cur = i * columns + j;
+        unsigned int left = cur - 1;
+        unsigned int up = cur - columns;
+        unsigned int up_left = up - 1;
+        f->a = left; f->b = flip ? up_left : up; f->c = flip ? up : up_left;
+        f++;
+        f->a = left; f->b = flip ? up : cur; f->c = flip ? cur : up;
+        f++;
+      }
+  }
+
+  // vertex_tex_coords, s along the columns and t along the rows. 0..1, or
+  // 0..(n - 1) / n in a direction that wraps around.
+  void grid_tex_coords(vsx_mesh_data* data, bool wrap_rows, bool wrap_columns)
+  {
+    resize(data->vertex_tex_coords, (size_t)rows * columns);
+    float s_div = 1.0f / (float)(wrap_columns ? columns : (columns > 1 ? columns - 1 : 1));
+    float t_div = 1.0f / (float)(wrap_rows ? rows : (rows > 1 ? rows - 1 : 1));
+    vsx_tex_coord* t = data->vertex_tex_coords.get_pointer();
+    for (int i = 0; i < rows; i++)
+      for (int j = 0; j < columns; j++)
+      {
+        t->s = (float)j * s_div;
+        t->t = (float)i * t_div;
+        t++;
+      }
+  }
+
+  // white vertex_colors
+  void grid_colors(vsx_mesh_data* data)
+  {
+    size_t count = (size_t)rows * columns;
+    resize(data->vertex_colors, count);
+    vsx_color* c = data->vertex_colors.get_pointer();
+    for (size_t i = 0; i < count; i++)
+      c[i] = vsx_color(1, 1, 1, 1);
+  }
+
+  class job
+  {
+  public:
+    parametric_surface_row_func func;
+    void* arg;
+    vsx_vector* out;
+    const vsx_vector* center; // per row, normals_radial
+    int columns;
+    int rows;
+    bool flip;
+  };
+
+  static void rows_task(void* ptr, size_t start, size_t end)
+  {
+    job* j = (job*)ptr;
+    for (size_t i = start; i < end; i++)
+      j->func(j->arg, (int)i, j->out + i * j->columns);
+  }
+
+  // data->vertices, row by row on the thread pool
+  void evaluate(vsx_mesh_data* data, parametric_surface_row_func func, void* arg)
+  {
+    if (!rows || !columns)
+      return;
+    job j;
+    j.func = func;
+    j.arg = arg;
+    j.out = data->vertices.get_pointer();
+    j.columns = columns;
+    j.rows = rows;
+    vsx_thread_pool::get_instance()->parallel_for(rows, PARAMETRIC_SURFACE_CHUNK, &rows_task, (void*)&j);
+    data->vertices.timestamp++;
+  }
+
+  // normal of the grid itself: (next row - previous row) x (next column -
+  // previous column), one sided at the edges. Where that is 0 (a pole,
+  // where a whole row is one point) the position is used instead.
+  static void normals_grid_task(void* ptr, size_t start, size_t end)
+  {
+    job* j = (job*)ptr;
+    const vsx_vector* p = j->center;
+    int cols = j->columns;
+    for (size_t ii = start; ii < end; ii++)
+    {
+      int i = (int)ii;
+      const vsx_vector* r0 = p + (i > 0 ? i - 1 : i) * cols;
+      const vsx_vector* r1 = p + (i < j->rows - 1 ? i + 1 : i) * cols;
+      const vsx_vector* row = p + i * cols;
+      vsx_vector* out = j->out + i * cols;
+      for (int c = 0; c < cols; c++)
+      {
+        int c0 = c > 0 ? c - 1 : c;
+        int c1 = c < cols - 1 ? c + 1 : c;
+        float ax = r1[c].x - r0[c].x, ay = r1[c].y - r0[c].y, az = r1[c].z - r0[c].z;
+        float bx = row[c1].x - row[c0].x, by = row[c1].y - row[c0].y, bz = row[c1].z - row[c0].z;
+        float nx = ay * bz - az * by;
+        float ny = az * bx - ax * bz;
+        float nz = ax * by - ay * bx;
+        float len = sqrtf(nx * nx + ny * ny + nz * nz);
+        float inv = j->flip ? -1.0f : 1.0f;
+        if (len < 1e-12f)
+        {
+          // pointing out from the origin, whichever way the grid turns
+          nx = row[c].x; ny = row[c].y; nz = row[c].z;
+          len = sqrtf(nx * nx + ny * ny + nz * nz);
+          inv = 1.0f;
+        }
+        if (len < 1e-12f)
+        {
+          out[c] = vsx_vector(0, 0, 0);
+          continue;
+        }
+        inv /= len;
+        out[c] = vsx_vector(nx * inv, ny * inv, nz * inv);
+      }
+    }
+  }
+
+  // data->vertex_normals from the positions, see normals_grid_task
+  void normals_grid(vsx_mesh_data* data, bool flip)
+  {
+    if (!rows || !columns)
+      return;
+    job j;
+    j.center = data->vertices.get_pointer();
+    j.out = data->vertex_normals.get_pointer();
+    j.columns = columns;
+    j.rows = rows;
+    j.flip = flip;
+    vsx_thread_pool::get_instance()->parallel_for(rows, PARAMETRIC_SURFACE_CHUNK, &normals_grid_task, (void*)&j);
+    data->vertex_normals.timestamp++;
+  }
+
+  static void normals_radial_task(void* ptr, size_t start, size_t end)
+  {
+    job* j = (job*)ptr;
+    for (size_t i = start; i < end; i++)
+    {
+      vsx_vector c = j->center[i];
+      vsx_vector* out = j->out + i * j->columns;
+      // out holds the positions here, see normals_radial
+      for (int k = 0; k < j->columns; k++)
+      {
+        float nx = out[k].x - c.x, ny = out[k].y - c.y, nz = out[k].z - c.z;
+        float len = sqrtf(nx * nx + ny * ny + nz * nz);
+        float inv = len > 0.0f ? 1.0f / len : 0.0f;
+        out[k] = vsx_vector(nx * inv, ny * inv, nz * inv);
+      }
+    }
+  }
+
+  // data->vertex_normals pointing away from a center per row, for tubes
+  void normals_radial(vsx_mesh_data* data, const vsx_vector* centers)
+  {
+    if (!rows || !columns)
+      return;
+    memcpy(data->vertex_normals.get_pointer(), data->vertices.get_pointer(), sizeof(vsx_vector) * rows * columns);
+    job j;
+    j.center = centers;
+    j.out = data->vertex_normals.get_pointer();
+    j.columns = columns;
+    j.rows = rows;
+    vsx_thread_pool::get_instance()->parallel_for(rows, PARAMETRIC_SURFACE_CHUNK, &normals_radial_task, (void*)&j);
+    data->vertex_normals.timestamp++;
+  }
+};
+
+// out[k] = (a * column_x[k], b * column_x[k], column_z[k]) for a row of a
+// separable shape
+inline void parametric_surface_separable_row(float a, float b, const float* column_x, const float* column_z, int columns, vsx_vector* out)
+{
+  int k = 0;
+#ifdef __SSE2__
+  __m128 aa = _mm_set1_ps(a);
+  __m128 bb = _mm_set1_ps(b);
+  for (; k + 4 <= columns; k += 4)
+  {
+    __m128 cx = _mm_loadu_ps(column_x + k);
+    __m128 z = _mm_loadu_ps(column_z + k);
+    __m128 x = _mm_mul_ps(aa, cx);
+    __m128 y = _mm_mul_ps(bb, cx);
+    // interleave to x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+    __m128 xy_lo = _mm_unpacklo_ps(x, y); // x0 y0 x1 y1
+    __m128 xy_hi = _mm_unpackhi_ps(x, y); // x2 y2 x3 y3
+    __m128 r0 = _mm_shuffle_ps(xy_lo, _mm_unpacklo_ps(z, x), _MM_SHUFFLE(3, 0, 1, 0));
+    __m128 r1 = _mm_shuffle_ps(_mm_unpacklo_ps(y, z), xy_hi, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128 t = _mm_shuffle_ps(z, xy_hi, _MM_SHUFFLE(3, 2, 3, 2)); // z2 z3 x3 y3
+    __m128 r2 = _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 3, 2, 0));
+    float* o = &out[k].x;
+    _mm_storeu_ps(o, r0);
+    _mm_storeu_ps(o + 4, r1);
+    _mm_storeu_ps(o + 8, r2);
+  }
+#endif
+  for (; k < columns; k++)
+  {
+    out[k].x = a * column_x[k];
+    out[k].y = b * column_x[k];
+    out[k].z = column_z[k];
+  }
+}
+
+// a tube along a curve: row i is an ellipse around center[i] in the plane
+// of x_axis[i] / y_axis[i] with radii radius_x[i] / radius_y[i], column j at
+// angle[j]. Fill the tables, then evaluate() with row().
+class parametric_surface_tube
+{
+public:
+  std::vector<vsx_vector> center;
+  std::vector<vsx_vector> x_axis;
+  std::vector<vsx_vector> y_axis;
+  std::vector<float> radius_x;
+  std::vector<float> radius_y;
+  std::vector<float> column_cos;
+  std::vector<float> column_sin;
+
+  void resize(int rows, int columns)
+  {
+    center.resize(rows);
+    x_axis.resize(rows);
+    y_axis.resize(rows);
+    radius_x.resize(rows);
+    radius_y.resize(rows);
+    column_cos.resize(columns);
+    column_sin.resize(columns);
+  }
+
+  // column j at angle j / columns_per_turn of a full turn
+  void set_angles(float columns_per_turn)
+  {
+    for (size_t j = 0; j < column_cos.size(); j++)
+    {
+      double angle = (double)j / columns_per_turn * TWO_PI;
+      column_cos[j] = (float)cos(angle);
+      column_sin[j] = (float)sin(angle);
+    }
+  }
+
+  static void row(void* arg, int i, vsx_vector* out)
+  {
+    parametric_surface_tube* t = (parametric_surface_tube*)arg;
+    vsx_vector c = t->center[i];
+    vsx_vector x = t->x_axis[i];
+    vsx_vector y = t->y_axis[i];
+    x *= t->radius_x[i];
+    y *= t->radius_y[i];
+    const float* cs = &t->column_cos[0];
+    const float* sn = &t->column_sin[0];
+    int columns = (int)t->column_cos.size();
+    for (int k = 0; k < columns; k++)
+    {
+      out[k].x = c.x + x.x * cs[k] + y.x * sn[k];
+      out[k].y = c.y + x.y * cs[k] + y.y * sn[k];
+      out[k].z = c.z + x.z * cs[k] + y.z * sn[k];
+    }
+  }
+};
+
+#endif
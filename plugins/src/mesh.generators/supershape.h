@@ -0,0 +1,147 @@
+/**
+* Project: VSXu: Realtime modular visual programming language, music/audio visualizer.
+*
+* This file is part of Vovoid VSXu.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef SUPERSHAPE_H
+#define SUPERSHAPE_H
+
+// The 3D superformula for mesh;solid;mesh_solid_supershape, kept apart
+// from the module so tools/vsxbench can check the table path against
+// eval3D.
+
+#include <math.h>
+#include <vector>
+#include "parametric_surface.h"
+
+inline void eval2D(double a, double b, float m,float n1,float n2,float n3,float phi,float &x,float &y){
+  double r;
+  double t1,t2;
+  //double a=1,b=1;
+
+  t1 = cos(m * phi / 4) / a;
+  t1 = fabs(t1);
+  t1 = pow(t1,n2);
+
+  t2 = sin(m * phi / 4) / b;
+  t2 = fabs(t2);
+  t2 = pow(t2,n3);
+
+  r = pow(t1+t2,1/n1);
+  if (fabs(r) == 0) {
+    x = 0;
+    y = 0;
+  } else {
+    r = 1 / r;
+    x = (float)(r * cos(phi));
+    y = (float)(r * sin(phi));
+  }
+}
+
+inline void eval3D(double a, double b, float m,float n1,float n2,float n3,float phi,float theta,float &x,float &y,float &z)
+{
+  double r;
+  double t1,t2;
+  //double a=1,b=1;
+
+  eval2D(a,b, m,n1,n2,n3,phi,x,y);
+
+  t1 = cos(m * theta / 4) / a;
+  t1 = fabs(t1);
+  t1 = pow(t1,n2);
+
+  t2 = sin(m * theta / 4) / b;
+  t2 = fabs(t2);
+  t2 = pow(t2,n3);
+
+  r = pow(t1+t2,1/n1);
+  if (fabs(r) == 0) {
+    x = 0;
+    y = 0;
+    z = 0;
+  } else {
+    r = 1 / r;
+    x *= (float)(r * cos(theta));
+    y *= (float)(r * cos(theta));
+    z = (float) (r * sin(theta));
+  }
+
+}
+
+// the theta half of eval3D: what the eval2D x and y get multiplied with,
+// and z
+inline void eval3D_theta(double a, double b, float m,float n1,float n2,float n3,float theta,float &xy_scale,float &z)
+{
+  double t1 = pow(fabs(cos(m * theta / 4) / a), n2);
+  double t2 = pow(fabs(sin(m * theta / 4) / b), n3);
+  double r = pow(t1+t2,1/n1);
+  if (fabs(r) == 0) {
+    xy_scale = 0;
+    z = 0;
+  } else {
+    r = 1 / r;
+    xy_scale = (float)(r * cos(theta));
+    z = (float) (r * sin(theta));
+  }
+}
+
+// eval3D(phi, theta) is eval2D(phi) times a term of theta alone, so the
+// pow / sin / cos go into one table per row (phi) and one per column
+// (theta) and a vertex is 3 multiplies
+class supershape_tables
+{
+public:
+  std::vector<float> row_x;
+  std::vector<float> row_y;
+  std::vector<float> column_xy;
+  std::vector<float> column_z;
+  int columns;
+
+  void build(double a, double b, float m, float n1, float n2, float n3, float phi_start, float phi_step, float theta_start, float theta_step, int n_rows, int n_columns)
+  {
+    row_x.resize(n_rows);
+    row_y.resize(n_rows);
+    float phi = phi_start;
+    for (int i = 0; i < n_rows; i++)
+    {
+      eval2D(a, b, m, n1, n2, n3, phi, row_x[i], row_y[i]);
+      phi += phi_step;
+    }
+    column_xy.resize(n_columns);
+    column_z.resize(n_columns);
+    float theta = theta_start;
+    for (int j = 0; j < n_columns; j++)
+    {
+      eval3D_theta(a, b, m, n1, n2, n3, theta, column_xy[j], column_z[j]);
+      theta += theta_step;
+    }
+    columns = n_columns;
+  }
+};
+
+// parametric_surface row function
+inline void supershape_row(void* arg, int row, vsx_vector* out)
+{
+  supershape_tables* t = (supershape_tables*)arg;
+  parametric_surface_separable_row(t->row_x[row], t->row_y[row], &t->column_xy[0], &t->column_z[0], t->columns, out);
+}
+
+#endif
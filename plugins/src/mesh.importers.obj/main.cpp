@@ -26,6 +26,33 @@
 #include "vsx_param.h"
 #include "vsx_module.h"
 #include "vsx_math_3d.h"
+#include "vsx_thread_pool.h"
+#include "obj_parser.h"
+#include "vsx_mesh_container.h"
+#if PLATFORM_FAMILY == PLATFORM_FAMILY_UNIX
+#include <unistd.h>
+#endif
+
+// Loading runs as one task on the engine thread pool (which splits the
+// parsing over the pool again), the previous mesh stays on the output
+// until the new one is done.
+//
+// thread_state: 0 = idle, 1 = loading, 2 = result waiting in run()
+//
+// A file the sequencer is about to switch to (prefetch()) is parsed the same
+// way ahead of time, and only swapped in once the filename really changes.
+
+static void obj_wait_for_worker(volatile int& thread_state)
+{
+  while (thread_state == 1)
+  {
+#ifdef _WIN32
+    ::Sleep(1);
+#else
+    usleep(1000);
+#endif
+  }
+}
 
 class vsx_module_obj_loader : public vsx_module {
   // in
@@ -35,19 +62,37 @@ class vsx_module_obj_loader : public vsx_module {
 	vsx_module_param_mesh* result;
 	// internal
 	vsx_mesh* mesh;
-	bool first_run;
-	int n_rays;
+	vsx_mesh* mesh_loading;
 	vsx_string current_filename;
+
+  // sampled in run(), the worker doesn't touch the params
+  volatile int thread_state;
+  vsx_string work_filename;
+  bool work_preserve_uv_coords;
+  bool work_ok;
+  // the worker is on a file the timeline hasn't switched to yet
+  bool work_prefetch;
 public:
-  
+
+  vsx_module_obj_loader()
+  {
+    thread_state = 0;
+    work_prefetch = false;
+    mesh = 0;
+    mesh_loading = 0;
+  }
+
   bool init() {
     mesh = new vsx_mesh;
+    mesh_loading = new vsx_mesh;
     return true;
   }
 
   void on_delete()
   {
+    obj_wait_for_worker(thread_state);
     delete mesh;
+    delete mesh_loading;
   }
 
 void module_info(vsx_module_info* info)
@@ -70,223 +115,80 @@ void declare_params(vsx_module_param_list& in_parameters, vsx_module_param_list&
   preserve_uv_coords->set(1);
 
   result = (vsx_module_param_mesh*)out_parameters.create(VSX_MODULE_PARAM_ID_MESH,"mesh");
-  first_run = true;
+}
+
+static void worker(void* ptr)
+{
+  vsx_module_obj_loader* my = (vsx_module_obj_loader*)ptr;
+  my->work_ok = false;
+  vsxf_handle* fp = my->engine->filesystem->f_open(my->work_filename.c_str(), "rb");
+  if (fp)
+  {
+    const char* data = (const char*)my->engine->filesystem->f_data_map(fp);
+    my->work_ok = obj_parser_load(data, fp->size, my->work_preserve_uv_coords, my->mesh_loading->data, vsx_thread_pool::get_instance());
+    my->engine->filesystem->f_close(fp);
+  }
+  my->thread_state = 2;
+}
+
+void prefetch(const vsx_string& name, const vsx_string& value)
+{
+  vsx_string file = value;
+  if (name != "filename" || thread_state != 0 || !mesh_loading) return;
+  if (file == current_filename || !verify_filesuffix(file, "obj")) return;
+  work_filename = file;
+  work_preserve_uv_coords = preserve_uv_coords->get() != 0;
+  work_prefetch = true;
+  thread_state = 1;
+  vsx_thread_pool::get_instance()->add_task(&worker, (void*)this);
 }
 
 void run() {
-  if (filename->get() != current_filename) {
+  if (thread_state == 2 && work_prefetch)
+  {
+    if (filename->get() == work_filename && (preserve_uv_coords->get() != 0) == work_preserve_uv_coords)
+    {
+      // the timeline got here, it's already parsed
+      current_filename = work_filename;
+      work_prefetch = false;
+    }
+    else
+    if (filename->get() != current_filename)
+    {
+      // went somewhere else
+      mesh_loading->data->clear();
+      work_prefetch = false;
+      thread_state = 0;
+    }
+  }
+  if (thread_state == 2 && !work_prefetch)
+  {
+    if (work_ok)
+    {
+      vsx_mesh* t = mesh;
+      mesh = mesh_loading;
+      mesh_loading = t;
+      mesh->timestamp = (int)(engine->real_vtime*1000.0f);
+      // don't keep two copies of a big scan around
+      mesh_loading->data->clear();
+      message = "module||ok";
+    }
+    else
+      message = "module||ERROR! Could not read "+work_filename;
+    loading_done = true;
+    thread_state = 0;
+  }
+  if (thread_state == 0 && filename->get() != current_filename) {
    	if (!verify_filesuffix(filename->get(),"obj")) {
    		filename->set(current_filename);
    		message = "module||ERROR! This is not a OBJ mesh file!";
    		return;
-   	} else message = "module||ok";
-
+   	}
     current_filename = filename->get();
-    vsxf_handle *fp;
-    //printf("a\n");
-    if ((fp = engine->filesystem->f_open(current_filename.c_str(), "r")) == NULL)
-    {
-      return;
-    }
-    
-    char buf[65535];
-    vsx_string line;
-    vsx_array<vsx_vector> vertices; //vertices.set_allocation_increment(15000);
-    vsx_array<vsx_vector> normals; //normals.set_allocation_increment(15000);
-    vsx_array<vsx_tex_coord> texcoords; //texcoords.set_allocation_increment(15000);
-    //mesh->data->vertex_tex_coords.reset_used();
-    mesh->data->clear();
-    //mesh->data->vertices.set_allocation_increment(15000);
-    //mesh->data->vertex_normals.set_allocation_increment(15000);
-    //mesh->data->vertex_tex_coords.set_allocation_increment(15000);
-    //mesh->data->faces.set_allocation_increment(15000);
-
-    int face_cur = 0;
-    //printf("b\n");
-    bool found_normals = false;
-    bool found_texcoords = false;
-    if (preserve_uv_coords->get()) {
-      mesh->data->vertices.reset_used();
-      mesh->data->vertex_tex_coords.reset_used();
-      mesh->data->vertex_normals.reset_used();
-      mesh->data->faces.reset_used();
-
-	    while (engine->filesystem->f_gets(buf,65535,fp)) {
-	      line = buf;
-	      if (line[line.size()-1] == 0x0A) line.pop_back();
-	      if (line[line.size()-1] == 0x0D) line.pop_back();
-	      //printf("reading line: %s\n",line.c_str());
-	      //printf("c\n");
-	      if (line.size()) {
-	        vsx_avector<vsx_string> parts;
-	        vsx_string deli = " ";
-	        explode(line, deli, parts);
-	        if (parts[0] == "v") {
-	        	//printf("v\n");
-	          //mesh->data->vertices.push_back(vsx_vector(s2f(parts[1]),s2f(parts[2]),s2f(parts[3])));
-	          vertices.push_back(vsx_vector(s2f(parts[1]),s2f(parts[2]),s2f(parts[3])));
-	        } else
-	        if (parts[0] == "vt") {
-	        	//printf("vt\n");
-	          vsx_tex_coord a;
-	          a.s = (s2f(parts[1]));
-	          a.t = (s2f(parts[2]));
-	          //printf("%f  ::   %f\n",a.s,a.t);
-	          texcoords.push_back(a);
-	          //vsx_vector__(s2f(parts[1]),s2f(parts[2]),s2f(parts[3])));
-	          found_texcoords = true;
-
-	        } else
-	        if (parts[0] == "vn") {
-	        	//printf("vn\n");
-	          //printf("normal\n");
-	          normals.push_back(vsx_vector(s2f(parts[1]),s2f(parts[2]),s2f(parts[3])));
-	          found_normals = true;
-	          //mesh->data->vertex_normals.push_back(vsx_vector__(s2f(parts[1]),s2f(parts[2]),s2f(parts[3])));
-	        } else
-	        if (parts[0] == "f") {
-	        	//printf("f1\n");
-	          //printf("face\n");
-	          //if (parts.size() == 4) {
-	            //printf("num texcoords %d\n",texcoords.size());
-	            vsx_face ff;
-	//            vsx_avector<vsx_string> parts2;
-	            vsx_string deli2 = "/";
-
-	/*            explode(parts[1], deli2, parts2);
-	            ff.c = s2i(parts2[0])-1;
-	            mesh->data->vertex_normals[ff.c] = normals[s2i(parts2[1])-1];
-	            mesh->data->vertex_tex_coords[ff.c] = texcoords[s2i(parts2[1])-1];
-
-	            explode(parts[2], deli2, parts2);
-	            ff.b = s2i(parts2[0])-1;
-	            mesh->data->vertex_normals[ff.b] = normals[s2i(parts2[1])-1];
-	            mesh->data->vertex_tex_coords[ff.b] = texcoords[s2i(parts2[1])-1];
-
-	            explode(parts[3], deli2, parts2);
-	            ff.a = s2i(parts2[0])-1;
-	            mesh->data->vertex_normals[ff.a] = normals[s2i(parts2[1])-1];
-	            mesh->data->vertex_tex_coords[ff.a] = texcoords[s2i(parts2[1])-1];*/
-
-
-	            vsx_avector<vsx_string> parts2;
-	            explode(parts[1], deli2, parts2);
-	            vsx_avector<vsx_string> parts3;
-	            explode(parts[2], deli2, parts3);
-	            vsx_avector<vsx_string> parts4;
-	            explode(parts[3], deli2, parts4);
-
-	            ff.c = face_cur;   //s2i(parts2[0])-1;
-	            ff.b = face_cur+1; //s2i(parts3[0])-1;
-	            ff.a = face_cur+2; //s2i(parts4[0])-1;
-
-              
-	            //printf("f2\n");
-              //printf("reading line: %s\n",line.c_str());
-              int id;
-              id = s2i(parts2[0])-1; if (id < 0) id=0;
-	            mesh->data->vertices[ff.a] = vertices[id];
-              id = s2i(parts3[0])-1; if (id < 0) id=0;
-              mesh->data->vertices[ff.b] = vertices[id];
-              id = s2i(parts4[0])-1; if (id < 0) id=0;
-	            mesh->data->vertices[ff.c] = vertices[id];
-
-	            if (found_texcoords && found_normals) {
-                if (parts2[1] != "") {
-                  mesh->data->vertex_tex_coords[ff.a] = texcoords[s2i(parts2[1])-1];
-                  mesh->data->vertex_tex_coords[ff.b] = texcoords[s2i(parts3[1])-1];
-                  mesh->data->vertex_tex_coords[ff.c] = texcoords[s2i(parts4[1])-1];
-                }
-	              if (parts2[2] != "") {
-                  mesh->data->vertex_normals[ff.a] = normals[s2i(parts2[2])-1];
-                  mesh->data->vertex_normals[ff.b] = normals[s2i(parts3[2])-1];
-                  mesh->data->vertex_normals[ff.c] = normals[s2i(parts4[2])-1];
-                }
-	            } else
-	            if (found_normals) {
-                if (parts2[2] != "") {
-                  mesh->data->vertex_normals[ff.a] = normals[s2i(parts2[2])-1];
-                  mesh->data->vertex_normals[ff.b] = normals[s2i(parts3[2])-1];
-                  mesh->data->vertex_normals[ff.c] = normals[s2i(parts4[2])-1];
-                }
-	            } else
-	            if (found_texcoords) {
-                if (parts2[1] != "") {
-                  mesh->data->vertex_tex_coords[ff.a] = texcoords[s2i(parts2[1])-1];
-                  mesh->data->vertex_tex_coords[ff.b] = texcoords[s2i(parts3[1])-1];
-                  mesh->data->vertex_tex_coords[ff.c] = texcoords[s2i(parts4[1])-1];
-                }
-	            }
-
-
-						  //printf("%d  ",s2i(parts2[1]));
-						  //printf("%d  ",s2i(parts3[1]));
-						  //printf("%d\n",s2i(parts4[1]));
-						  //printf("f3\n");
-
-	            /*printf("ida: %d\n",s2i(parts2[1]));
-	            printf("orig coords: %f %f\n",texcoords[s2i(parts2[1])-1].s,texcoords[s2i(parts2[1])-1].t);
-	            printf("texcoord s: %f   %f\n",mesh->data->vertex_tex_coords[ff.a].s,mesh->data->vertex_tex_coords[ff.a].t);
-
-	            printf("idb: %d\n",s2i(parts3[1]));
-	            printf("orig coords: %f %f\n",texcoords[s2i(parts3[1])-1].s,texcoords[s2i(parts3[1])-1].t);
-	            printf("texcoord s: %f   %f\n",mesh->data->vertex_tex_coords[ff.a].s,mesh->data->vertex_tex_coords[ff.a].t);
-
-	            printf("idc: %d\n",s2i(parts4[1]));
-	            printf("orig coords: %f %f\n",texcoords[s2i(parts4[1])-1].s,texcoords[s2i(parts4[1])-1].t);
-	            printf("texcoord s: %f   %f\n",mesh->data->vertex_tex_coords[ff.a].s,mesh->data->vertex_tex_coords[ff.a].t);
-	*/
-	            face_cur += 3;
-	            mesh->data->faces.push_back(ff);
-	            //printf("f4\n");
-	          //}
-	        }
-
-	      }
-	    }
-    } else {
-
-	    while (engine->filesystem->f_gets(buf,65535,fp)) {
-	      line = buf;
-	      if (line[line.size()-1] == 0x0A) line.pop_back();
-	      if (line[line.size()-1] == 0x0D) line.pop_back();
-	      if (line.size()) {
-	        vsx_avector<vsx_string> parts;
-	        vsx_string deli = " ";
-	        explode(line, deli, parts);
-	        if (parts[0] == "v") {
-	        	mesh->data->vertices.push_back(vsx_vector(s2f(parts[1]),s2f(parts[2]),s2f(parts[3])));
-	        } else
-	        if (parts[0] == "f") {
-	            vsx_face ff;
-	            vsx_string deli2 = "/";
-
-	            vsx_avector<vsx_string> parts2;
-	            explode(parts[1], deli2, parts2);
-	            vsx_avector<vsx_string> parts3;
-	            explode(parts[2], deli2, parts3);
-	            vsx_avector<vsx_string> parts4;
-	            explode(parts[3], deli2, parts4);
-
-	            ff.c = s2i(parts2[0])-1;
-	            ff.b = s2i(parts3[0])-1;
-	            ff.a = s2i(parts4[0])-1;
-
-	            //printf("face %d %d %d %d\n", mesh->data->faces.size(), ff.a, ff.b, ff.c);
-
-	            mesh->data->faces.push_back(ff);
-	        }
-
-	      }
-	    }
-    }
-
-    engine->filesystem->f_close(fp);
-    loading_done = true;
-    mesh->timestamp = (int)(engine->real_vtime*1000.0f);
-    #ifdef VSXU_DEBUG
-      //printf("mesh timestamp: %d\n", (int)mesh->timestamp);
-    #endif
+    work_filename = current_filename;
+    work_preserve_uv_coords = preserve_uv_coords->get() != 0;
+    thread_state = 1;
+    vsx_thread_pool::get_instance()->add_task(&worker, (void*)this);
   }
   result->set_p(mesh);
 }
@@ -455,6 +357,99 @@ void run() {
 }
 };
 
+//******************************************************************************************
+//******************************************************************************************
+//******************************************************************************************
+
+// .vxb files from tools/vsxmesh. The file stays open (mapped) as long as the
+// mesh is on the output, uncompressed attributes point straight into it.
+class vsx_module_vxb_loader : public vsx_module {
+  // in
+  vsx_module_param_resource* filename;
+  // out
+  vsx_module_param_mesh* result;
+  // internal
+  vsx_mesh* mesh;
+  vsxf_handle* file;
+  vsx_mesh_container container;
+  vsx_string current_filename;
+public:
+
+  vsx_module_vxb_loader()
+  {
+    mesh = 0;
+    file = 0;
+  }
+
+  bool init() {
+    mesh = new vsx_mesh;
+    return true;
+  }
+
+  void on_delete()
+  {
+    // the arrays may point into the file, drop them first
+    delete mesh;
+    if (file)
+      engine->filesystem->f_close(file);
+  }
+
+void module_info(vsx_module_info* info)
+{
+  info->identifier = "mesh;importers;vxb_importer";
+  info->description = "Loads baked meshes (.vxb) made with vsxmesh";
+  info->in_param_spec = "filename:resource";
+  info->out_param_spec = "mesh:mesh";
+  info->component_class = "mesh";
+}
+
+void declare_params(vsx_module_param_list& in_parameters, vsx_module_param_list& out_parameters)
+{
+  loading_done = false;
+  filename = (vsx_module_param_resource*)in_parameters.create(VSX_MODULE_PARAM_ID_RESOURCE,"filename");
+  filename->set("");
+  current_filename = "";
+
+  result = (vsx_module_param_mesh*)out_parameters.create(VSX_MODULE_PARAM_ID_MESH,"mesh");
+}
+
+void run() {
+  if (filename->get() != current_filename) {
+    if (!verify_filesuffix(filename->get(),"vxb")) {
+      filename->set(current_filename);
+      message = "module||ERROR! This is not a VXB mesh file!";
+      return;
+    }
+    current_filename = filename->get();
+    vsxf_handle* fp = engine->filesystem->f_open(current_filename.c_str(), "rb");
+    bool ok = false;
+    if (fp)
+    {
+      const unsigned char* data = (const unsigned char*)engine->filesystem->f_data_map(fp);
+      ok = data && container.load_memory(data, fp->size, mesh->data);
+    }
+    // the mesh doesn't use the old file any more either way
+    if (file)
+      engine->filesystem->f_close(file);
+    file = 0;
+    if (ok)
+    {
+      file = fp;
+      message = "module||ok";
+    }
+    else
+    {
+      if (fp)
+        engine->filesystem->f_close(fp);
+      message = "module||ERROR! Could not read "+current_filename;
+    }
+    mesh->timestamp++;
+    loading_done = true;
+  }
+  result->set_p(mesh);
+}
+};
+
 //******************************************************************************
 //*** F A C T O R Y ************************************************************
 //******************************************************************************
@@ -476,6 +471,7 @@ vsx_module* create_new_module(unsigned long module, void* args)
   switch(module) {
     case 0: return (vsx_module*)(new vsx_module_obj_loader);
     case 1: return (vsx_module*)(new vsx_module_vxm_loader);
+    case 2: return (vsx_module*)(new vsx_module_vxb_loader);
   }
   return 0;
 }
@@ -485,12 +481,13 @@ void destroy_module(vsx_module* m,unsigned long module) {
   switch(module) {
     case 0: delete (vsx_module_obj_loader*)m; break;
     case 1: delete (vsx_module_vxm_loader*)m; break;
+    case 2: delete (vsx_module_vxb_loader*)m; break;
   }
 }
 
 
 unsigned long get_num_modules() {
-  return 2;
+  return 3;
 }
 
 
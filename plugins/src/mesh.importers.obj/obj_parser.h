@@ -0,0 +1,550 @@
+/**
+* Project: VSXu: Realtime modular visual programming engine.
+*
+* This file is part of Vovoid VSXu.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Lesser General Public License (LGPL)
+*
+* VSXu Engine is free software; you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+// Wavefront OBJ parsing for mesh;importers;obj_importer.
+//
+// The file is cut into chunks at line breaks and every chunk is parsed on
+// the thread pool into its own v / vt / vn / face corner lists. Numbers go
+// through the small parsers below instead of strings and s2f. Afterwards
+// the lists are laid out one after the other (prefix sums over the chunk
+// counts), corner indices are made global and the mesh is built:
+//
+//   preserve_uv_coords off  vertices are the v lines, faces index them
+//   preserve_uv_coords on   one vertex per distinct v/vt/vn combination,
+//                           found through a hash table - the old loader
+//                           made 3 new vertices for every face
+//
+// Polygons are split into fans. Negative (relative) indices are supported,
+// unknown lines (o, g, s, usemtl ...) are skipped.
+//
+// Works on a buffer that isn't 0 terminated (vsxf::f_data_map), and needs
+// no engine or OpenGL - tools/vsxbench runs it on generated files.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "vsx_math_3d.h"
+#include "vsx_mesh.h"
+#include "vsx_thread_pool.h"
+
+// smallest chunk worth a task
+#define OBJ_PARSER_MIN_CHUNK (256 * 1024)
+
+class obj_parser_chunk
+{
+public:
+  const char* start;
+  const char* end;
+  std::vector<vsx_vector> positions;
+  std::vector<vsx_tex_coord> tex_coords;
+  std::vector<vsx_vector> normals;
+  // 3 ints per triangle corner: v, vt, vn. Zero based and global, -1 when
+  // not given - except for the slots listed in relative, those hold an
+  // index counted from the start of this chunk until fix up.
+  std::vector<int> corners;
+  std::vector<size_t> relative;
+  size_t position_base;
+  size_t tex_coord_base;
+  size_t normal_base;
+  size_t corner_base;
+};
+
+class obj_parser_job
+{
+public:
+  std::vector<obj_parser_chunk> chunks;
+  size_t num_positions;
+  size_t num_tex_coords;
+  size_t num_normals;
+  std::vector<vsx_vector> positions;
+  std::vector<vsx_tex_coord> tex_coords;
+  std::vector<vsx_vector> normals;
+  std::vector<int> corners;
+};
+
+inline const char* obj_parser_skip_blanks(const char* p, const char* end)
+{
+  while (p < end && (*p == ' ' || *p == '\t'))
+    p++;
+  return p;
+}
+
+inline const char* obj_parser_next_line(const char* p, const char* end)
+{
+  while (p < end && *p != '\n')
+    p++;
+  return p < end ? p + 1 : end;
+}
+
+// decimal float with optional sign, fraction and exponent. 0 and the
+// position unchanged when there's no number.
+inline const char* obj_parser_float(const char* p, const char* end, float& result)
+{
+  static const double powers[] =
+  {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  result = 0.0f;
+  const char* s = obj_parser_skip_blanks(p, end);
+  bool negative = false;
+  if (s < end && (*s == '-' || *s == '+'))
+  {
+    negative = *s == '-';
+    s++;
+  }
+  // 19 significant digits always fit, the rest only moves the exponent
+  unsigned long long mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  const char* first = s;
+  while (s < end && *s >= '0' && *s <= '9')
+  {
+    if (digits < 19)
+    {
+      mantissa = mantissa * 10 + (unsigned long long)(*s - '0');
+      if (mantissa)
+        digits++;
+    }
+    else
+      exponent++;
+    s++;
+  }
+  if (s < end && *s == '.')
+  {
+    s++;
+    while (s < end && *s >= '0' && *s <= '9')
+    {
+      if (digits < 19)
+      {
+        mantissa = mantissa * 10 + (unsigned long long)(*s - '0');
+        if (mantissa)
+          digits++;
+        exponent--;
+      }
+      s++;
+    }
+  }
+  if (s == first || (s == first + 1 && *first == '.'))
+    return p;
+  if (s < end && (*s == 'e' || *s == 'E'))
+  {
+    const char* e = s + 1;
+    bool e_negative = false;
+    if (e < end && (*e == '-' || *e == '+'))
+    {
+      e_negative = *e == '-';
+      e++;
+    }
+    if (e < end && *e >= '0' && *e <= '9')
+    {
+      int value = 0;
+      while (e < end && *e >= '0' && *e <= '9')
+      {
+        if (value < 10000)
+          value = value * 10 + (*e - '0');
+        e++;
+      }
+      exponent += e_negative ? -value : value;
+      s = e;
+    }
+  }
+  double v = (double)mantissa;
+  if (mantissa)
+  {
+    if (exponent < 0)
+      v = exponent >= -22 ? v / powers[-exponent] : v * pow(10.0, (double)exponent);
+    else
+    if (exponent > 0)
+      v = exponent <= 22 ? v * powers[exponent] : v * pow(10.0, (double)exponent);
+  }
+  result = (float)(negative ? -v : v);
+  return s;
+}
+
+// signed integer, false when there's none
+inline bool obj_parser_int(const char*& p, const char* end, int& result)
+{
+  const char* s = p;
+  bool negative = false;
+  if (s < end && (*s == '-' || *s == '+'))
+  {
+    negative = *s == '-';
+    s++;
+  }
+  if (s >= end || *s < '0' || *s > '9')
+    return false;
+  long long value = 0;
+  while (s < end && *s >= '0' && *s <= '9')
+  {
+    if (value < 0x7FFFFFFF)
+      value = value * 10 + (*s - '0');
+    s++;
+  }
+  if (value > 0x7FFFFFFF)
+    value = 0x7FFFFFFF;
+  result = (int)(negative ? -value : value);
+  p = s;
+  return true;
+}
+
+// obj index (1 based, or negative = counted back from the last one) to a
+// slot value, see obj_parser_chunk::corners
+inline void obj_parser_index(obj_parser_chunk& c, int value, size_t count, int& slot, size_t slot_index)
+{
+  if (value > 0)
+  {
+    slot = value - 1;
+    return;
+  }
+  if (value < 0)
+  {
+    slot = (int)count + value;
+    c.relative.push_back(slot_index);
+    return;
+  }
+  slot = -1;
+}
+
+inline void obj_parser_parse_chunk(obj_parser_chunk& c)
+{
+  // corners of the current polygon, v vt vn each
+  std::vector<int> polygon;
+  const char* p = c.start;
+  const char* end = c.end;
+  while (p < end)
+  {
+    p = obj_parser_skip_blanks(p, end);
+    if (p + 1 < end && p[0] == 'v')
+    {
+      if (p[1] == ' ' || p[1] == '\t')
+      {
+        vsx_vector v;
+        p = obj_parser_float(p + 2, end, v.x);
+        p = obj_parser_float(p, end, v.y);
+        p = obj_parser_float(p, end, v.z);
+        c.positions.push_back(v);
+      }
+      else
+      if (p[1] == 't' && p + 2 < end && (p[2] == ' ' || p[2] == '\t'))
+      {
+        vsx_tex_coord t;
+        p = obj_parser_float(p + 3, end, t.s);
+        p = obj_parser_float(p, end, t.t);
+        c.tex_coords.push_back(t);
+      }
+      else
+      if (p[1] == 'n' && p + 2 < end && (p[2] == ' ' || p[2] == '\t'))
+      {
+        vsx_vector n;
+        p = obj_parser_float(p + 3, end, n.x);
+        p = obj_parser_float(p, end, n.y);
+        p = obj_parser_float(p, end, n.z);
+        c.normals.push_back(n);
+      }
+    }
+    else
+    if (p + 1 < end && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+    {
+      polygon.clear();
+      p += 2;
+      while (true)
+      {
+        p = obj_parser_skip_blanks(p, end);
+        int v, vt = 0, vn = 0;
+        if (!obj_parser_int(p, end, v))
+          break;
+        if (p < end && *p == '/')
+        {
+          p++;
+          obj_parser_int(p, end, vt);
+          if (p < end && *p == '/')
+          {
+            p++;
+            obj_parser_int(p, end, vn);
+          }
+        }
+        polygon.push_back(v);
+        polygon.push_back(vt);
+        polygon.push_back(vn);
+      }
+      size_t n = polygon.size() / 3;
+      for (size_t i = 1; i + 1 < n; i++)
+      {
+        size_t fan[3] = { 0, i, i + 1 };
+        for (size_t k = 0; k < 3; k++)
+        {
+          size_t slot = c.corners.size();
+          c.corners.resize(slot + 3);
+          const int* in = &polygon[fan[k] * 3];
+          obj_parser_index(c, in[0], c.positions.size(), c.corners[slot], slot);
+          obj_parser_index(c, in[1], c.tex_coords.size(), c.corners[slot + 1], slot + 1);
+          obj_parser_index(c, in[2], c.normals.size(), c.corners[slot + 2], slot + 2);
+        }
+      }
+    }
+    p = obj_parser_next_line(p, end);
+  }
+}
+
+inline void obj_parser_parse_task(void* ptr, size_t start, size_t end)
+{
+  obj_parser_job* j = (obj_parser_job*)ptr;
+  for (size_t i = start; i < end; i++)
+    obj_parser_parse_chunk(j->chunks[i]);
+}
+
+// chunk lists -> the global ones, relative and out of range indices fixed
+inline void obj_parser_gather_task(void* ptr, size_t start, size_t end)
+{
+  obj_parser_job* j = (obj_parser_job*)ptr;
+  for (size_t i = start; i < end; i++)
+  {
+    obj_parser_chunk& c = j->chunks[i];
+    if (c.positions.size())
+      memcpy((void*)&j->positions[c.position_base], (void*)&c.positions[0], sizeof(vsx_vector) * c.positions.size());
+    if (c.tex_coords.size())
+      memcpy((void*)&j->tex_coords[c.tex_coord_base], (void*)&c.tex_coords[0], sizeof(vsx_tex_coord) * c.tex_coords.size());
+    if (c.normals.size())
+      memcpy((void*)&j->normals[c.normal_base], (void*)&c.normals[0], sizeof(vsx_vector) * c.normals.size());
+    if (!c.corners.size())
+      continue;
+    int* out = &j->corners[c.corner_base];
+    memcpy(out, &c.corners[0], sizeof(int) * c.corners.size());
+    size_t bases[3] = { c.position_base, c.tex_coord_base, c.normal_base };
+    for (size_t r = 0; r < c.relative.size(); r++)
+    {
+      size_t slot = c.relative[r];
+      out[slot] += (int)bases[slot % 3];
+      // pointing before the first one, drop it below
+      if (out[slot] < 0)
+        out[slot] = 0x7FFFFFFF;
+    }
+    size_t counts[3] = { j->num_positions, j->num_tex_coords, j->num_normals };
+    for (size_t k = 0; k < c.corners.size(); k++)
+    {
+      size_t count = counts[k % 3];
+      if (out[k] >= 0 && (size_t)out[k] >= count)
+        out[k] = -1;
+      // faces always need a vertex, the old loader used the first one
+      if (k % 3 == 0 && out[k] < 0)
+        out[k] = 0;
+    }
+    std::vector<int>().swap(c.corners);
+    std::vector<size_t>().swap(c.relative);
+  }
+}
+
+inline unsigned int obj_parser_hash(const int* key)
+{
+  unsigned int h = (unsigned int)key[0] * 0x9E3779B1u;
+  h ^= (unsigned int)key[1] * 0x85EBCA77u;
+  h ^= (unsigned int)key[2] * 0xC2B2AE3Du;
+  return h ^ (h >> 15);
+}
+
+// out gets cleared first. False only for an empty file or no vertices.
+inline bool obj_parser_load(const char* data, size_t size, bool preserve_uv_coords, vsx_mesh_data* out, vsx_thread_pool* pool)
+{
+  out->clear();
+  if (!data || !size)
+    return false;
+
+  obj_parser_job j;
+  size_t wanted = vsx_thread_pool::get_num_cores() * 4;
+  size_t chunk_size = size / wanted;
+  if (chunk_size < OBJ_PARSER_MIN_CHUNK)
+    chunk_size = OBJ_PARSER_MIN_CHUNK;
+  const char* end = data + size;
+  const char* p = data;
+  while (p < end)
+  {
+    obj_parser_chunk c;
+    c.start = p;
+    p = (size_t)(end - p) > chunk_size ? obj_parser_next_line(p + chunk_size, end) : end;
+    c.end = p;
+    j.chunks.push_back(c);
+  }
+  pool->parallel_for(j.chunks.size(), 1, &obj_parser_parse_task, (void*)&j);
+
+  size_t num_corners = 0;
+  j.num_positions = 0;
+  j.num_tex_coords = 0;
+  j.num_normals = 0;
+  for (size_t i = 0; i < j.chunks.size(); i++)
+  {
+    obj_parser_chunk& c = j.chunks[i];
+    c.position_base = j.num_positions;
+    c.tex_coord_base = j.num_tex_coords;
+    c.normal_base = j.num_normals;
+    c.corner_base = num_corners;
+    j.num_positions += c.positions.size();
+    j.num_tex_coords += c.tex_coords.size();
+    j.num_normals += c.normals.size();
+    num_corners += c.corners.size();
+  }
+  if (!j.num_positions)
+    return false;
+  j.positions.resize(j.num_positions);
+  j.tex_coords.resize(j.num_tex_coords);
+  j.normals.resize(j.num_normals);
+  j.corners.resize(num_corners);
+  pool->parallel_for(j.chunks.size(), 1, &obj_parser_gather_task, (void*)&j);
+  j.chunks.clear();
+
+  size_t num_faces = num_corners / 9;
+  const int* corner = num_corners ? &j.corners[0] : 0;
+  bool has_tex_coords = false;
+  bool has_normals = false;
+  if (preserve_uv_coords)
+  {
+    for (size_t k = 0; k < num_corners; k += 3)
+    {
+      has_tex_coords |= corner[k + 1] >= 0;
+      has_normals |= corner[k + 2] >= 0;
+    }
+  }
+
+  if (!has_tex_coords && !has_normals)
+  {
+    // the v lines are the vertices
+    out->vertices.allocate(j.num_positions - 1);
+    out->vertices.reset_used(j.num_positions);
+    memcpy((void*)out->vertices.get_pointer(), (void*)&j.positions[0], sizeof(vsx_vector) * j.num_positions);
+  }
+  else
+  {
+    // one vertex per distinct v/vt/vn, the table holds vertex + 1
+    std::vector<int> keys;
+    keys.reserve(j.num_positions * 3);
+    std::vector<unsigned int> table;
+    size_t table_size = 1024;
+    while (table_size < j.num_positions * 2)
+      table_size <<= 1;
+    table.assign(table_size, 0);
+    std::vector<unsigned int> remap(num_corners / 3);
+    for (size_t k = 0; k < num_corners; k += 3)
+    {
+      size_t vertex_count = keys.size() / 3;
+      if (vertex_count * 2 >= table_size)
+      {
+        table_size <<= 1;
+        table.assign(table_size, 0);
+        for (size_t v = 0; v < vertex_count; v++)
+        {
+          size_t h = obj_parser_hash(&keys[v * 3]) & (table_size - 1);
+          while (table[h])
+            h = (h + 1) & (table_size - 1);
+          table[h] = (unsigned int)v + 1;
+        }
+      }
+      const int* key = corner + k;
+      size_t h = obj_parser_hash(key) & (table_size - 1);
+      while (true)
+      {
+        unsigned int e = table[h];
+        if (!e)
+        {
+          table[h] = (unsigned int)vertex_count + 1;
+          keys.push_back(key[0]);
+          keys.push_back(key[1]);
+          keys.push_back(key[2]);
+          remap[k / 3] = (unsigned int)vertex_count;
+          break;
+        }
+        const int* other = &keys[(e - 1) * 3];
+        if (other[0] == key[0] && other[1] == key[1] && other[2] == key[2])
+        {
+          remap[k / 3] = e - 1;
+          break;
+        }
+        h = (h + 1) & (table_size - 1);
+      }
+    }
+    std::vector<unsigned int>().swap(table);
+
+    size_t vertex_count = keys.size() / 3;
+    out->vertices.allocate(vertex_count - 1);
+    out->vertices.reset_used(vertex_count);
+    vsx_vector* vp = out->vertices.get_pointer();
+    vsx_tex_coord* tp = 0;
+    vsx_vector* np = 0;
+    if (has_tex_coords)
+    {
+      out->vertex_tex_coords.allocate(vertex_count - 1);
+      out->vertex_tex_coords.reset_used(vertex_count);
+      tp = out->vertex_tex_coords.get_pointer();
+    }
+    if (has_normals)
+    {
+      out->vertex_normals.allocate(vertex_count - 1);
+      out->vertex_normals.reset_used(vertex_count);
+      np = out->vertex_normals.get_pointer();
+    }
+    vsx_tex_coord no_tex_coord = vsx_tex_coord__(0.0f, 0.0f);
+    vsx_vector no_normal;
+    for (size_t v = 0; v < vertex_count; v++)
+    {
+      const int* key = &keys[v * 3];
+      vp[v] = j.positions[key[0]];
+      if (tp)
+        tp[v] = key[1] >= 0 ? j.tex_coords[key[1]] : no_tex_coord;
+      if (np)
+        np[v] = key[2] >= 0 ? j.normals[key[2]] : no_normal;
+    }
+    // faces index vertices from here on
+    for (size_t k = 0; k < num_corners / 3; k++)
+      j.corners[k * 3] = (int)remap[k];
+  }
+
+  if (num_faces)
+  {
+    out->faces.allocate(num_faces - 1);
+    out->faces.reset_used(num_faces);
+    vsx_face* fp = out->faces.get_pointer();
+    for (size_t f = 0; f < num_faces; f++)
+    {
+      const int* c = corner + f * 9;
+      // both windings are what the old loader produced
+      if (preserve_uv_coords)
+      {
+        fp[f].a = c[0];
+        fp[f].b = c[3];
+        fp[f].c = c[6];
+      }
+      else
+      {
+        fp[f].a = c[6];
+        fp[f].b = c[3];
+        fp[f].c = c[0];
+      }
+    }
+  }
+  return true;
+}
+
+#endif
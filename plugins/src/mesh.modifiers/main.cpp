@@ -28,6 +28,10 @@
 #include <vsx_math_3d.h>
 #include <vsx_float_array.h>
 #include <vsx_quaternion.h>
+#include <vsx_mesh_kernels.h>
+#include <vsx_sort.h>
+#include <vsx_soft_body.h>
+#include <vsx_mesh_spatial.h>
 #include <pthread.h>
 
 /*
@@ -192,6 +196,66 @@ public:
   }
 };
 
+class vsx_module_mesh_closest_vertex_picker : public vsx_module {
+  // in
+  vsx_module_param_mesh* mesh_in;
+  vsx_module_param_float3* position;
+  // out
+  vsx_module_param_float* id;
+  vsx_module_param_float3* vertex;
+  vsx_module_param_float* distance;
+  vsx_module_param_mesh* passthru;
+public:
+
+  void module_info(vsx_module_info* info)
+  {
+    info->identifier = "mesh;modifiers;pickers;mesh_closest_vertex_picker";
+    info->description = "Finds the vertex closest to a position.\n"
+                        "id can go into mesh_vertex_picker\n"
+                        "for the rest of its attributes.";
+    info->in_param_spec = "mesh_in:mesh,position:float3";
+    info->out_param_spec = "id:float,vertex:float3,distance:float,passthru:mesh";
+    info->component_class = "mesh";
+  }
+
+  void declare_params(vsx_module_param_list& in_parameters, vsx_module_param_list& out_parameters)
+  {
+    mesh_in = (vsx_module_param_mesh*)in_parameters.create(VSX_MODULE_PARAM_ID_MESH,"mesh_in");
+    position = (vsx_module_param_float3*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT3,"position");
+    passthru = (vsx_module_param_mesh*)out_parameters.create(VSX_MODULE_PARAM_ID_MESH,"passthru");
+    id = (vsx_module_param_float*)out_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"id");
+    id->set(-1.0f);
+    vertex = (vsx_module_param_float3*)out_parameters.create(VSX_MODULE_PARAM_ID_FLOAT3,"vertex");
+    distance = (vsx_module_param_float*)out_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"distance");
+    loading_done = true;
+  }
+
+  void run() {
+    vsx_mesh** p = mesh_in->get_addr();
+    if (!p) return;
+    passthru->set(*p);
+    if (!(*p)->data || !(*p)->data->vertices.size())
+    {
+      id->set(-1.0f);
+      return;
+    }
+    // the grid is kept with the mesh and only rebuilt when it changes, so
+    // a moving position costs a lookup, not a pass over the vertices
+    vsx_point_grid* grid = vsx_mesh_spatial::get(*p)->get_vertex_grid();
+    vsx_mesh_spatial_hit hit;
+    if (!grid->nearest(vsx_vector(position->get(0), position->get(1), position->get(2)), FLT_MAX, hit))
+    {
+      id->set(-1.0f);
+      return;
+    }
+    id->set((float)hit.index);
+    vertex->set(hit.position.x,0);
+    vertex->set(hit.position.y,1);
+    vertex->set(hit.position.z,2);
+    distance->set(hit.distance);
+  }
+};
+
 class vsx_module_mesh_to_float3_arrays : public vsx_module {
   // in
   vsx_module_param_mesh* mesh_in;
@@ -402,6 +466,7 @@ class vsx_module_mesh_quat_rotate : public vsx_module {
   vsx_mesh* mesh;
   vsx_quaternion q;
   unsigned long prev_timestamp;
+
 public:
 
   bool init() {
@@ -442,7 +507,7 @@ public:
 
   void run()
   {
-    vsx_mesh** p = mesh_in->get_addr();
+    vsx_mesh** p = mesh_in->get_addr_lazy();
     if (!p) { printf("error in vsx_module_mesh_quat_rotate: mesh_in is invalid\n"); return; }
     if (
         param_updates
@@ -465,32 +530,9 @@ public:
       {
         mat = q.matrix();
       }
-      mesh->data->vertices.reset_used(0);
-      mesh->data->vertex_normals.reset_used(0);
-      mesh->data->vertex_tex_coords.reset_used(0);
-      mesh->data->vertex_colors.reset_used(0);
-      mesh->data->faces.reset_used(0);
-
-      for (unsigned int i = 0; i < (*p)->data->vertices.size(); i++)
-      {
-        mesh->data->vertices[i] = mat.multiply_vector((*p)->data->vertices[i]);
-      }
-      for (unsigned int i = 0; i < (*p)->data->vertex_normals.size(); i++)
-      {
-        mesh->data->vertex_normals[i] = mat.multiply_vector((*p)->data->vertex_normals[i]);
-      }
-/*
-      vsx_array<vsx_vector> vertices;
-      vsx_array<vsx_vector> vertex_normals;
-      vsx_array<vsx_color> vertex_colors;
-      vsx_array<vsx_tex_coord> vertex_tex_coords;
-      vsx_array<vsx_face> faces;
-*/
-      for (unsigned int i = 0; i < (*p)->data->vertex_tex_coords.size(); i++) mesh->data->vertex_tex_coords[i] = (*p)->data->vertex_tex_coords[i];
-      for (unsigned int i = 0; i < (*p)->data->vertex_tangents.size(); i++) mesh->data->vertex_tangents[i] = (*p)->data->vertex_tangents[i];
-      //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
-      for (unsigned int i = 0; i < (*p)->data->vertex_colors.size(); i++) mesh->data->vertex_colors[i] = (*p)->data->vertex_colors[i];
-      for (unsigned int i = 0; i < (*p)->data->faces.size(); i++) mesh->data->faces[i] = (*p)->data->faces[i];
+      // nothing is moved here, whoever reads the vertices applies all
+      // stacked transforms at once
+      vsx_mesh_kernels::stack_transform((*p)->data, mesh->data, mat);
       mesh->timestamp++;
       mesh_out->set_p(mesh);
       //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
@@ -592,7 +634,7 @@ public:
       //mesh->data->vertex_normals.reset_used(0);
 
       unsigned long end = (*p)->data->vertices.size();
-      vsx_vector* vs_p = &(*p)->data->vertices[0];//.get_pointer();
+      vsx_vector* vs_p = (*p)->data->vertices.get_pointer();
       mesh->data->vertices.allocate(end);
       mesh->data->vertices.reset_used(end);
       vsx_vector* vs_d = mesh->data->vertices.get_pointer();
@@ -637,18 +679,10 @@ public:
 */
       if (prev_timestamp != (*p)->timestamp)
       {
-        mesh->data->vertex_tex_coords.set_volatile();
-        mesh->data->vertex_tex_coords.set_data((*p)->data->vertex_tex_coords.get_pointer(), (*p)->data->vertex_tex_coords.size());
-
-        mesh->data->vertex_tangents.set_volatile();
-        mesh->data->vertex_tangents.set_data((*p)->data->vertex_tangents.get_pointer(), (*p)->data->vertex_tangents.size());
-
-        mesh->data->vertex_colors.set_volatile();
-        mesh->data->vertex_colors.set_data((*p)->data->vertex_colors.get_pointer(), (*p)->data->vertex_colors.size());
-
-        mesh->data->faces.set_volatile();
-        mesh->data->faces.set_data((*p)->data->faces.get_pointer(), (*p)->data->faces.size());
+        mesh->data->share((*p)->data, VSX_MESH_VERTEX_TEX_COORDS | VSX_MESH_VERTEX_TANGENTS | VSX_MESH_VERTEX_COLORS | VSX_MESH_FACES);
       }
+      mesh->data->vertices.timestamp++;
+      mesh->data->vertex_normals.timestamp++;
       mesh->timestamp++;
       mesh_out->set_p(mesh);
       //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
@@ -698,7 +732,7 @@ public:
   vsx_vector v;
   void run()
   {
-    vsx_mesh** p = mesh_in->get_addr();
+    vsx_mesh** p = mesh_in->get_addr_lazy();
     if (!p) { printf("error in vsx_module_mesh_translate: mesh_in is invalid\n"); return; }
 
     if (param_updates || prev_timestamp != (*p)->timestamp)
@@ -707,57 +741,12 @@ public:
       v.x = translation->get(0);
       v.y = translation->get(1);
       v.z = translation->get(2);
-      mesh->data->vertices.reset_used(0);
-      mesh->data->vertex_normals.reset_used(0);
-      mesh->data->vertex_tex_coords.reset_used(0);
-      mesh->data->vertex_colors.reset_used(0);
-      mesh->data->faces.reset_used(0);
-
-      unsigned long end = (*p)->data->vertices.size();
-      vsx_vector* vs_p = &(*p)->data->vertices[0];//.get_pointer();
-      mesh->data->vertices.allocate(end);
-      mesh->data->vertices.reset_used(end);
-      vsx_vector* vs_d = mesh->data->vertices.get_pointer();
-
-
-      for (unsigned int i = 0; i < end; i++)
-      {
-        //mesh->data->vertices[i] = (*p)->data->vertices[i] + v;
-        vs_d[i] = vs_p[i] + v;
-      }
-/*
-      vsx_array<vsx_vector> vertices;
-      vsx_array<vsx_vector> vertex_normals;
-      vsx_array<vsx_color> vertex_colors;
-      vsx_array<vsx_tex_coord> vertex_tex_coords;
-      vsx_array<vsx_face> faces;
-*/
 
-      //if (prev_timestamp != (*p)->timestamp)
-      //{
-      mesh->data->vertex_normals.set_volatile();
-      mesh->data->vertex_normals.set_data((*p)->data->vertex_normals.get_pointer(), (*p)->data->vertex_normals.size());
-
-      mesh->data->vertex_tex_coords.set_volatile();
-      mesh->data->vertex_tex_coords.set_data((*p)->data->vertex_tex_coords.get_pointer(), (*p)->data->vertex_tex_coords.size());
-
-      mesh->data->vertex_tangents.set_volatile();
-      mesh->data->vertex_tangents.set_data((*p)->data->vertex_tangents.get_pointer(), (*p)->data->vertex_tangents.size());
-
-      mesh->data->vertex_colors.set_volatile();
-      mesh->data->vertex_colors.set_data((*p)->data->vertex_colors.get_pointer(), (*p)->data->vertex_colors.size());
-
-      mesh->data->faces.set_volatile();
-      mesh->data->faces.set_data((*p)->data->faces.get_pointer(), (*p)->data->faces.size());
-//      }
-
-
-      //for (unsigned int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
-      //for (unsigned int i = 0; i < (*p)->data->vertex_tangents.size(); i++) mesh->data->vertex_tangents[i] = (*p)->data->vertex_tangents[i];
-      //for (unsigned int i = 0; i < (*p)->data->vertex_tex_coords.size(); i++) mesh->data->vertex_tex_coords[i] = (*p)->data->vertex_tex_coords[i];
-      //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
-      //for (unsigned int i = 0; i < (*p)->data->vertex_colors.size(); i++) mesh->data->vertex_colors[i] = (*p)->data->vertex_colors[i];
-      //for (unsigned int i = 0; i < (*p)->data->faces.size(); i++) mesh->data->faces[i] = (*p)->data->faces[i];
+      vsx_matrix m;
+      m.m[3] = v.x;
+      m.m[7] = v.y;
+      m.m[11] = v.z;
+      vsx_mesh_kernels::stack_transform((*p)->data, mesh->data, m);
       mesh->timestamp++;
       mesh_out->set_p(mesh);
       //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
@@ -806,7 +795,7 @@ public:
   }
 
   void run() {
-    vsx_mesh** p = mesh_in->get_addr();
+    vsx_mesh** p = mesh_in->get_addr_lazy();
     if (!p) { printf("error in vsx_module_mesh_scale: mesh_in is invalid\n"); return; }
     
     if
@@ -820,57 +809,12 @@ public:
       v.x = scale->get(0);
       v.y = scale->get(1);
       v.z = scale->get(2);
-      mesh->data->vertices.reset_used(0);
-      mesh->data->vertex_normals.reset_used(0);
-      mesh->data->vertex_tex_coords.reset_used(0);
-      mesh->data->vertex_colors.reset_used(0);
-      mesh->data->faces.reset_used(0);
-
-      unsigned long end = (*p)->data->vertices.size();
-      vsx_vector* vs_p = &(*p)->data->vertices[0];
-      mesh->data->vertices.allocate(end);
-      mesh->data->vertices.reset_used(end);
-      vsx_vector* vs_d = mesh->data->vertices.get_pointer();
-
-
-      for (unsigned int i = 0; i < end; i++)
-      {
-        //mesh->data->vertices[i] = (*p)->data->vertices[i] + v;
-        vs_d[i] = vs_p[i] * v;
-      }
-/*
-      vsx_array<vsx_vector> vertices;
-      vsx_array<vsx_vector> vertex_normals;
-      vsx_array<vsx_color> vertex_colors;
-      vsx_array<vsx_tex_coord> vertex_tex_coords;
-      vsx_array<vsx_face> faces;
-*/
-
-      //if (prev_timestamp != (*p)->timestamp)
-      //{
-      mesh->data->vertex_normals.set_volatile();
-      mesh->data->vertex_normals.set_data((*p)->data->vertex_normals.get_pointer(), (*p)->data->vertex_normals.size());
-
-      mesh->data->vertex_tex_coords.set_volatile();
-      mesh->data->vertex_tex_coords.set_data((*p)->data->vertex_tex_coords.get_pointer(), (*p)->data->vertex_tex_coords.size());
-
-      mesh->data->vertex_tangents.set_volatile();
-      mesh->data->vertex_tangents.set_data((*p)->data->vertex_tangents.get_pointer(), (*p)->data->vertex_tangents.size());
 
-      mesh->data->vertex_colors.set_volatile();
-      mesh->data->vertex_colors.set_data((*p)->data->vertex_colors.get_pointer(), (*p)->data->vertex_colors.size());
-
-      mesh->data->faces.set_volatile();
-      mesh->data->faces.set_data((*p)->data->faces.get_pointer(), (*p)->data->faces.size());
-//      }
-
-
-      //for (unsigned int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
-      //for (unsigned int i = 0; i < (*p)->data->vertex_tangents.size(); i++) mesh->data->vertex_tangents[i] = (*p)->data->vertex_tangents[i];
-      //for (unsigned int i = 0; i < (*p)->data->vertex_tex_coords.size(); i++) mesh->data->vertex_tex_coords[i] = (*p)->data->vertex_tex_coords[i];
-      //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
-      //for (unsigned int i = 0; i < (*p)->data->vertex_colors.size(); i++) mesh->data->vertex_colors[i] = (*p)->data->vertex_colors[i];
-      //for (unsigned int i = 0; i < (*p)->data->faces.size(); i++) mesh->data->faces[i] = (*p)->data->faces[i];
+      vsx_matrix m;
+      m.m[0] = v.x;
+      m.m[5] = v.y;
+      m.m[10] = v.z;
+      vsx_mesh_kernels::stack_transform((*p)->data, mesh->data, m);
       mesh->timestamp++;
       mesh_out->set_p(mesh);
       //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
@@ -887,6 +831,7 @@ class vsx_module_mesh_scale_normalize : public vsx_module {
   vsx_module_param_mesh* mesh_out;
   // internal
   vsx_mesh* mesh;
+  vsx_mesh_kernels kernels;
 public:
   bool init() {
     mesh = new vsx_mesh;
@@ -917,43 +862,30 @@ public:
   unsigned long prev_timestamp;
   vsx_vector v;
   void run() {
-    vsx_mesh** p = mesh_in->get_addr();
+    vsx_mesh** p = mesh_in->get_addr_lazy();
     if (!p)
     {
       return;
     }
 
     if (p && (param_updates || prev_timestamp != (*p)->timestamp)) {
+      if (prev_timestamp != (*p)->timestamp)
+        kernels.topology_changed();
       prev_timestamp = (*p)->timestamp;
-      mesh->data->vertices.reset_used(0);
-      mesh->data->vertex_normals.reset_used(0);
-      mesh->data->vertex_tex_coords.reset_used(0);
-      mesh->data->vertex_colors.reset_used(0);
-      mesh->data->faces.reset_used(0);
 
-      // 1. find out the minima and maxima of the mesh
+      // 1. find out the minima and maxima of the mesh (always including
+      // the origin), as the input will look once its transforms are applied
       vsx_vector minima;
       vsx_vector maxima;
-
-
-      vsx_vector* vs_p;
-      unsigned long end = (*p)->data->vertices.size();
-      vs_p = &(*p)->data->vertices[0];
-      mesh->data->vertices.allocate(end);
-      mesh->data->vertices.reset_used(end);
-      vsx_vector* vs_d = mesh->data->vertices.get_pointer();
-
-
-      for (unsigned int i = 0; i < end; i++)
+      vsx_vector lo, hi;
+      if (kernels.calculate_bounds((*p)->data, lo, hi))
       {
-        if (vs_p[i].x < minima.x) minima.x = vs_p[i].x;
-        if (vs_p[i].x > maxima.x) maxima.x = vs_p[i].x;
-
-        if (vs_p[i].y < minima.y) minima.y = vs_p[i].y;
-        if (vs_p[i].y > maxima.y) maxima.y = vs_p[i].y;
-
-        if (vs_p[i].z < minima.z) minima.z = vs_p[i].z;
-        if (vs_p[i].z > maxima.z) maxima.z = vs_p[i].z;
+        if (lo.x < minima.x) minima.x = lo.x;
+        if (lo.y < minima.y) minima.y = lo.y;
+        if (lo.z < minima.z) minima.z = lo.z;
+        if (hi.x > maxima.x) maxima.x = hi.x;
+        if (hi.y > maxima.y) maxima.y = hi.y;
+        if (hi.z > maxima.z) maxima.z = hi.z;
       }
 
       // find largest diff
@@ -965,49 +897,14 @@ public:
 
       float scaling = 1.0f / diff;
 
-
-      float xmove = -minima.x * scaling;
-      float ymove = -minima.y * scaling;
-      float zmove = -minima.z * scaling;
-
-
-      vs_p = &(*p)->data->vertices[0];
-      for (unsigned int i = 0; i < end; i++)
-      {
-        vs_d[i] = vs_p[i] * scaling + vsx_vector(xmove, ymove, zmove);
-      }
-      //vsx_array<vsx_vector> vertices;
-      //vsx_array<vsx_vector> vertex_normals;
-      //vsx_array<vsx_color> vertex_colors;
-      //vsx_array<vsx_tex_coord> vertex_tex_coords;
-      //vsx_array<vsx_face> faces;
-
-
-      //if (prev_timestamp != (*p)->timestamp)
-      //{
-      mesh->data->vertex_normals.set_volatile();
-      mesh->data->vertex_normals.set_data((*p)->data->vertex_normals.get_pointer(), (*p)->data->vertex_normals.size());
-
-      mesh->data->vertex_tex_coords.set_volatile();
-      mesh->data->vertex_tex_coords.set_data((*p)->data->vertex_tex_coords.get_pointer(), (*p)->data->vertex_tex_coords.size());
-
-      mesh->data->vertex_tangents.set_volatile();
-      mesh->data->vertex_tangents.set_data((*p)->data->vertex_tangents.get_pointer(), (*p)->data->vertex_tangents.size());
-
-      mesh->data->vertex_colors.set_volatile();
-      mesh->data->vertex_colors.set_data((*p)->data->vertex_colors.get_pointer(), (*p)->data->vertex_colors.size());
-
-      mesh->data->faces.set_volatile();
-      mesh->data->faces.set_data((*p)->data->faces.get_pointer(), (*p)->data->faces.size());
-//      }
-
-
-      //for (unsigned int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
-      //for (unsigned int i = 0; i < (*p)->data->vertex_tangents.size(); i++) mesh->data->vertex_tangents[i] = (*p)->data->vertex_tangents[i];
-      //for (unsigned int i = 0; i < (*p)->data->vertex_tex_coords.size(); i++) mesh->data->vertex_tex_coords[i] = (*p)->data->vertex_tex_coords[i];
-      //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
-      //for (unsigned int i = 0; i < (*p)->data->vertex_colors.size(); i++) mesh->data->vertex_colors[i] = (*p)->data->vertex_colors[i];
-      //for (unsigned int i = 0; i < (*p)->data->faces.size(); i++) mesh->data->faces[i] = (*p)->data->faces[i];
+      vsx_matrix m;
+      m.m[0] = scaling;
+      m.m[5] = scaling;
+      m.m[10] = scaling;
+      m.m[3] = -minima.x * scaling;
+      m.m[7] = -minima.y * scaling;
+      m.m[11] = -minima.z * scaling;
+      vsx_mesh_kernels::stack_transform((*p)->data, mesh->data, m);
       mesh->timestamp++;
       mesh_out->set_p(mesh);
       //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
@@ -1078,14 +975,9 @@ public:
       v.x = translation->get(0);
       v.y = translation->get(1);
       v.z = translation->get(2);
-      mesh->data->vertices.reset_used(0);
-      mesh->data->vertex_normals.reset_used(0);
-      mesh->data->vertex_tex_coords.reset_used(0);
-      mesh->data->vertex_colors.reset_used(0);
-      mesh->data->faces.reset_used(0);
 
       unsigned long end = (*p)->data->vertices.size();
-      vsx_vector* vs_p = &(*p)->data->vertices[0];//.get_pointer();
+      vsx_vector* vs_p = (*p)->data->vertices.get_pointer();
       mesh->data->vertices.allocate(end);
       mesh->data->vertices.reset_used(end);
       vsx_vector* vs_d = mesh->data->vertices.get_pointer();
@@ -1124,20 +1016,7 @@ public:
 
       //if (prev_timestamp != (*p)->timestamp)
       //{
-      mesh->data->vertex_normals.set_volatile();
-      mesh->data->vertex_normals.set_data((*p)->data->vertex_normals.get_pointer(), (*p)->data->vertex_normals.size());
-
-      mesh->data->vertex_tex_coords.set_volatile();
-      mesh->data->vertex_tex_coords.set_data((*p)->data->vertex_tex_coords.get_pointer(), (*p)->data->vertex_tex_coords.size());
-
-      mesh->data->vertex_tangents.set_volatile();
-      mesh->data->vertex_tangents.set_data((*p)->data->vertex_tangents.get_pointer(), (*p)->data->vertex_tangents.size());
-
-      mesh->data->vertex_colors.set_volatile();
-      mesh->data->vertex_colors.set_data((*p)->data->vertex_colors.get_pointer(), (*p)->data->vertex_colors.size());
-
-      mesh->data->faces.set_volatile();
-      mesh->data->faces.set_data((*p)->data->faces.get_pointer(), (*p)->data->faces.size());
+      mesh->data->share((*p)->data, VSX_MESH_VERTEX_NORMALS | VSX_MESH_VERTEX_TEX_COORDS | VSX_MESH_VERTEX_TANGENTS | VSX_MESH_VERTEX_COLORS | VSX_MESH_FACES);
 //      }
 
 
@@ -1147,6 +1026,7 @@ public:
       //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
       //for (unsigned int i = 0; i < (*p)->data->vertex_colors.size(); i++) mesh->data->vertex_colors[i] = (*p)->data->vertex_colors[i];
       //for (unsigned int i = 0; i < (*p)->data->faces.size(); i++) mesh->data->faces[i] = (*p)->data->faces[i];
+      mesh->data->vertices.timestamp++;
       mesh->timestamp++;
       mesh_out->set_p(mesh);
       //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
@@ -1190,21 +1070,40 @@ public:
     noise_amount = (vsx_module_param_float3*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT3, "noise_amount");
     loading_done = true;
     mesh_out = (vsx_module_param_mesh*)out_parameters.create(VSX_MODULE_PARAM_ID_MESH,"mesh_out");
+    prev_timestamp = 0xFFFFFFFF;
+    prev_faces_timestamp = 0;
+    prev_normals_timestamp = 0;
+    prev_tex_coords_timestamp = 0;
   }
   unsigned long prev_timestamp;
+  size_t prev_faces_timestamp;
+  size_t prev_normals_timestamp;
+  size_t prev_tex_coords_timestamp;
   vsx_vector v;
   void run() {
     vsx_mesh** p = mesh_in->get_addr();
     if (p && (param_updates || prev_timestamp != (*p)->timestamp)) {
+      vsx_mesh_data* in = (*p)->data;
+      // the decoupled faces, normals and tex coords only depend on the
+      // input faces, normals and tex coords - keep them when the input says
+      // those didn't change and just move the vertices
+      bool rebuild =
+        prev_timestamp != (*p)->timestamp
+        &&
+        !(
+          in->faces.timestamp && in->faces.timestamp == prev_faces_timestamp &&
+          in->vertex_normals.timestamp == prev_normals_timestamp &&
+          in->vertex_tex_coords.timestamp == prev_tex_coords_timestamp
+        );
+      if (mesh->data->faces.size() != in->faces.size())
+        rebuild = true;
       prev_timestamp = (*p)->timestamp;
+      prev_faces_timestamp = in->faces.timestamp;
+      prev_normals_timestamp = in->vertex_normals.timestamp;
+      prev_tex_coords_timestamp = in->vertex_tex_coords.timestamp;
       v.x = noise_amount->get(0);
       v.y = noise_amount->get(1);
       v.z = noise_amount->get(2);
-      mesh->data->vertices.reset_used(0);
-      mesh->data->vertex_normals.reset_used(0);
-      mesh->data->vertex_tex_coords.reset_used(0);
-      mesh->data->vertex_colors.reset_used(0);
-      mesh->data->faces.reset_used(0);
 
       if (random_distort_points.size() != (*p)->data->faces.size())
       {
@@ -1219,28 +1118,50 @@ public:
       }
 
       // we need to decouple the faces
-      size_t i_vertex_iter = 0;
-      size_t i_face_iter = 0;
-      for (size_t face_iterator = 0; face_iterator < (*p)->data->faces.size(); face_iterator++)
+      if (rebuild)
       {
-        mesh->data->vertices[i_vertex_iter] = (*p)->data->vertices[(*p)->data->faces[face_iterator].a] + random_distort_points[face_iterator] * v;
-        mesh->data->vertex_normals[i_vertex_iter] = (*p)->data->vertex_normals[(*p)->data->faces[face_iterator].a];
-        mesh->data->vertex_tex_coords[i_vertex_iter] = (*p)->data->vertex_tex_coords[(*p)->data->faces[face_iterator].a];
-        mesh->data->faces[i_face_iter].a = i_vertex_iter;
-        i_vertex_iter++;
-        mesh->data->vertices[i_vertex_iter] = (*p)->data->vertices[(*p)->data->faces[face_iterator].b] + random_distort_points[face_iterator] * v;
-        mesh->data->vertex_normals[i_vertex_iter] = (*p)->data->vertex_normals[(*p)->data->faces[face_iterator].b];
-        mesh->data->vertex_tex_coords[i_vertex_iter] = (*p)->data->vertex_tex_coords[(*p)->data->faces[face_iterator].b];
-        mesh->data->faces[i_face_iter].b = i_vertex_iter;
-        i_vertex_iter++;
-        mesh->data->vertices[i_vertex_iter] = (*p)->data->vertices[(*p)->data->faces[face_iterator].c] + random_distort_points[face_iterator] * v;
-        mesh->data->vertex_normals[i_vertex_iter] = (*p)->data->vertex_normals[(*p)->data->faces[face_iterator].c];
-        mesh->data->vertex_tex_coords[i_vertex_iter] = (*p)->data->vertex_tex_coords[(*p)->data->faces[face_iterator].c];
-        mesh->data->faces[i_face_iter].c = i_vertex_iter;
-        i_vertex_iter++;
-        i_face_iter++;
+        mesh->data->vertex_normals.reset_used(0);
+        mesh->data->vertex_tex_coords.reset_used(0);
+        mesh->data->faces.reset_used(0);
+        size_t i_vertex_iter = 0;
+        for (size_t face_iterator = 0; face_iterator < in->faces.size(); face_iterator++)
+        {
+          mesh->data->vertex_normals[i_vertex_iter] = in->vertex_normals[in->faces[face_iterator].a];
+          mesh->data->vertex_tex_coords[i_vertex_iter] = in->vertex_tex_coords[in->faces[face_iterator].a];
+          mesh->data->faces[face_iterator].a = i_vertex_iter;
+          i_vertex_iter++;
+          mesh->data->vertex_normals[i_vertex_iter] = in->vertex_normals[in->faces[face_iterator].b];
+          mesh->data->vertex_tex_coords[i_vertex_iter] = in->vertex_tex_coords[in->faces[face_iterator].b];
+          mesh->data->faces[face_iterator].b = i_vertex_iter;
+          i_vertex_iter++;
+          mesh->data->vertex_normals[i_vertex_iter] = in->vertex_normals[in->faces[face_iterator].c];
+          mesh->data->vertex_tex_coords[i_vertex_iter] = in->vertex_tex_coords[in->faces[face_iterator].c];
+          mesh->data->faces[face_iterator].c = i_vertex_iter;
+          i_vertex_iter++;
+        }
+        mesh->data->vertex_normals.timestamp++;
+        mesh->data->vertex_tex_coords.timestamp++;
+        mesh->data->faces.timestamp++;
       }
 
+      size_t face_count = in->faces.size();
+      mesh->data->vertices.reset_used(0);
+      if (face_count)
+      {
+        mesh->data->vertices.allocate(face_count * 3 - 1);
+        vsx_vector* vd = mesh->data->vertices.get_pointer();
+        vsx_face* fp = in->faces.get_pointer();
+        for (size_t face_iterator = 0; face_iterator < face_count; face_iterator++)
+        {
+          vsx_vector d = random_distort_points[face_iterator] * v;
+          vd[0] = in->vertices[fp[face_iterator].a] + d;
+          vd[1] = in->vertices[fp[face_iterator].b] + d;
+          vd[2] = in->vertices[fp[face_iterator].c] + d;
+          vd += 3;
+        }
+      }
+      mesh->data->vertices.timestamp++;
+
       //for (unsigned int i = 0; i < (*p)->data->vertices.size(); i++)
       //{
       //  mesh->data->vertices[i] = (*p)->data->vertices[i] + v;
@@ -1421,23 +1342,7 @@ public:
       param_updates = 0;
     } else
     {
-      mesh->data->vertices.set_volatile();
-      mesh->data->vertices.set_data((*p)->data->vertices.get_pointer(), (*p)->data->vertices.size());
-
-      mesh->data->vertex_normals.set_volatile();
-      mesh->data->vertex_normals.set_data((*p)->data->vertex_normals.get_pointer(), (*p)->data->vertex_normals.size());
-
-      mesh->data->vertex_tex_coords.set_volatile();
-      mesh->data->vertex_tex_coords.set_data((*p)->data->vertex_tex_coords.get_pointer(), (*p)->data->vertex_tex_coords.size());
-
-      mesh->data->vertex_tangents.set_volatile();
-      mesh->data->vertex_tangents.set_data((*p)->data->vertex_tangents.get_pointer(), (*p)->data->vertex_tangents.size());
-
-      mesh->data->vertex_colors.set_volatile();
-      mesh->data->vertex_colors.set_data((*p)->data->vertex_colors.get_pointer(), (*p)->data->vertex_colors.size());
-
-      mesh->data->faces.set_volatile();
-      mesh->data->faces.set_data((*p)->data->faces.get_pointer(), (*p)->data->faces.size());
+      mesh->data->share((*p)->data, VSX_MESH_VERTICES | VSX_MESH_VERTEX_NORMALS | VSX_MESH_VERTEX_TEX_COORDS | VSX_MESH_VERTEX_TANGENTS | VSX_MESH_VERTEX_COLORS | VSX_MESH_FACES);
       mesh->timestamp = (*p)->timestamp;
     }
     mesh_out->set_p(mesh);
@@ -1627,26 +1532,14 @@ public:
       {
         if (!vertex_transform_enabled)
         {
-          mesh->data->vertices.set_volatile();
-          mesh->data->vertices.set_data((*p)->data->vertices.get_pointer(), (*p)->data->vertices.size());
+          mesh->data->share((*p)->data, VSX_MESH_VERTICES);
         }
         if (!normal_transform_enabled)
         {
-          mesh->data->vertex_normals.set_volatile();
-          mesh->data->vertex_normals.set_data((*p)->data->vertex_normals.get_pointer(), (*p)->data->vertex_normals.size());
+          mesh->data->share((*p)->data, VSX_MESH_VERTEX_NORMALS);
         }
 
-        mesh->data->vertex_tex_coords.set_volatile();
-        mesh->data->vertex_tex_coords.set_data((*p)->data->vertex_tex_coords.get_pointer(), (*p)->data->vertex_tex_coords.size());
-
-        mesh->data->vertex_tangents.set_volatile();
-        mesh->data->vertex_tangents.set_data((*p)->data->vertex_tangents.get_pointer(), (*p)->data->vertex_tangents.size());
-
-        mesh->data->vertex_colors.set_volatile();
-        mesh->data->vertex_colors.set_data((*p)->data->vertex_colors.get_pointer(), (*p)->data->vertex_colors.size());
-
-        mesh->data->faces.set_volatile();
-        mesh->data->faces.set_data((*p)->data->faces.get_pointer(), (*p)->data->faces.size());
+        mesh->data->share((*p)->data, VSX_MESH_VERTEX_TEX_COORDS | VSX_MESH_VERTEX_TANGENTS | VSX_MESH_VERTEX_COLORS | VSX_MESH_FACES);
       }
       
       mesh->timestamp++;
@@ -1667,9 +1560,11 @@ class vsx_module_mesh_compute_tangents : public vsx_module {
   vsx_mesh* mesh;
   vsx_quaternion_array i_tangents;
   vsx_array<vsx_quaternion> data;
+  vsx_mesh_kernels kernels;
 public:
   bool init() {
     mesh = new vsx_mesh;
+    prev_timestamp = 0xFFFFFFFF;
     return true;
   }
 
@@ -1699,85 +1594,22 @@ public:
   void run() {
     vsx_mesh** p = mesh_in->get_addr();
     if (p /*&& (prev_timestamp != (*p)->timestamp)*/ ) {
+      // the upstream module may have rebuilt its faces in place, with the
+      // same counts, the vertex -> face table can't tell
+      if (prev_timestamp != (*p)->timestamp)
+        kernels.topology_changed();
       prev_timestamp = (*p)->timestamp;
 
-
       if ((*p)->data->vertex_tangents.size())
       {
         i_tangents.data = &(*p)->data->vertex_tangents;
       }
       else
       {
-        //printf("calculating tangents\n");
-      //void CalculateTangentArray(long vertexCount, const Point3D *vertex, const Vector3D *normal,
-              //const Point2D *texcoord, long triangleCount, const Triangle *triangle, Vector4D *tangent)
-      //{
-          //Vector3D *tan1 = new Vector3D[vertexCount * 2];
-          //Vector3D *tan2 = tan1 + vertexCount;
-//          ClearMemory(tan1, vertexCount * sizeof(Vector3D) * 2);
-
-      data.allocate((*p)->data->vertices.size());
-      data.reset_used((*p)->data->vertices.size());
-      data.memory_clear();
-      vsx_quaternion* vec_d = data.get_pointer();
-
-/*          for (unsigned long i = 0; i < (*p)->data->vertices.size(); i++) {
-            data[i].x = 0;
-            data[i].y = 0;
-            data[i].z = 0;
-          }
-*/
-          for (unsigned long a = 0; a < (*p)->data->faces.size(); a++)
-          {
-            long i1 = (*p)->data->faces[a].a;
-            long i2 = (*p)->data->faces[a].b;
-            long i3 = (*p)->data->faces[a].c;
-
-            const vsx_vector& v1 = (*p)->data->vertices[i1];
-            const vsx_vector& v2 = (*p)->data->vertices[i2];
-            const vsx_vector& v3 = (*p)->data->vertices[i3];
-
-            const vsx_tex_coord& w1 = (*p)->data->vertex_tex_coords[i1];
-            const vsx_tex_coord& w2 = (*p)->data->vertex_tex_coords[i2];
-            const vsx_tex_coord& w3 = (*p)->data->vertex_tex_coords[i3];
-
-            float x1 = v2.x - v1.x;
-            float x2 = v3.x - v1.x;
-            float y1 = v2.y - v1.y;
-            float y2 = v3.y - v1.y;
-            float z1 = v2.z - v1.z;
-            float z2 = v3.z - v1.z;
-
-            float s1 = w2.s - w1.s;
-            float s2 = w3.s - w1.s;
-            float t1 = w2.t - w1.t;
-            float t2 = w3.t - w1.t;
-
-            float r = 1.0f / (s1 * t2 - s2 * t1);
-            vsx_quaternion sdir((t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r, (t2 * z1 - t1 * z2) * r);
-            //vsx_vector sdir((s1 * x2 - s2 * x1) * r, (s1 * y2 - s2 * y1) * r,(s1 * z2 - s2 * z1) * r);
-
-            vec_d[i1] += sdir;
-            vec_d[i2] += sdir;
-            vec_d[i3] += sdir;
-
-            //tan2[i1] += tdir;
-            //tan2[i2] += tdir;
-            //tan2[i3] += tdir;
-          }
-          for (unsigned long a = 0; a < data.size(); a++)
-          {
-              vsx_vector& n = (*p)->data->vertex_normals[a];
-              vsx_quaternion& t = vec_d[a];
-
-              // Gram-Schmidt orthogonalize
-              //vec_d[a] = (t - n * t.dot_product(&n) );
-              vec_d[a] = (t - n * t.dot_product(&n) );
-              vec_d[a].normalize();
-
-              // Calculate handedness
-              //tangent[a].w = (Dot(Cross(n, t), tan2[a]) < 0.0F) ? -1.0F : 1.0F;
-          }
+        // Lengyel's per face sdir/tdir, gathered per vertex and
+        // orthogonalized against the normal; empty without tex coords
+        i_tangents.data = &data;
+        kernels.calculate_tangents((*p)->data, data);
       }
     }
   }
@@ -2027,9 +1859,11 @@ public:
 
 // mesh inflation by CoR
 // optimized 2010-01 by jaw
+// the simulation itself is in vsx_soft_body
 
-#define printVector(a,b,c)
-#define printFloat(a,b,c)
+// never more than this many steps in one frame, after a long stall the
+// simulation slows down instead of freezing the engine
+#define MESH_INFLATE_MAX_STEPS 32
 
 class vsx_module_mesh_inflate : public vsx_module {
   // in
@@ -2047,11 +1881,9 @@ class vsx_module_mesh_inflate : public vsx_module {
   vsx_module_param_float* volume_out;
   // internal
   vsx_mesh* mesh;
-  vsx_array<vsx_vector> faceLengths;
-  vsx_array<float> faceAreas;
-  vsx_array<vsx_vector> verticesSpeed;
+  vsx_soft_body body;
+  vsx_mesh_kernels kernels;
 
-  bool debug;
 public:
   bool init() {
     mesh = new vsx_mesh;
@@ -2062,14 +1894,6 @@ public:
   {
     delete mesh;
   }
-  
-  void _printVector(const char* name, int faceInd, vsx_vector vec) {
-    if(debug) printf("%d %s: %f %f %f \n", faceInd, name, vec.x, vec.y, vec.z);
-  }
-  void _printFloat(const char* name, int faceInd, float f) {
-    if(debug) printf("%d %s: %f \n", faceInd, name, f);
-  }
-
 
   void module_info(vsx_module_info* info)
   {
@@ -2118,25 +1942,21 @@ public:
     volume_out = (vsx_module_param_float*)out_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"volume_out");
     volume_out->set(0.0f);
     prev_timestamp = 0xFFFFFFFF;
+    dtimeRest = 0.0f;
   }
 
   unsigned long prev_timestamp;
-  vsx_vector v;
   float dtimeRest;
 
   void run() {
     vsx_mesh** p = mesh_in->get_addr();
-    if (!p) 
+    if (!p)
     {
       return;
     }
 
-    debug = false;
-    bool newMeshLoaded = false;
-
-
     //after a mesh change clone the mesh
-    if (p && (prev_timestamp != (*p)->timestamp)) {
+    if (prev_timestamp != (*p)->timestamp) {
       prev_timestamp = (*p)->timestamp;
       mesh->data->vertices.reset_used(0);
       mesh->data->vertex_normals.reset_used(0);
@@ -2144,231 +1964,72 @@ public:
       mesh->data->vertex_colors.reset_used(0);
       mesh->data->faces.reset_used(0);
 
-      for (unsigned int i = 0; i < (*p)->data->vertices.size(); i++)
-      {
-        mesh->data->vertices[i] = (*p)->data->vertices[i] + v;
-        verticesSpeed[i] = vsx_vector(0, 0, 0);
-      }
-
+      for (unsigned int i = 0; i < (*p)->data->vertices.size(); i++) mesh->data->vertices[i] = (*p)->data->vertices[i];
       for (unsigned int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
       for (unsigned int i = 0; i < (*p)->data->vertex_tangents.size(); i++) mesh->data->vertex_tangents[i] = (*p)->data->vertex_tangents[i];
       for (unsigned int i = 0; i < (*p)->data->vertex_tex_coords.size(); i++) mesh->data->vertex_tex_coords[i] = (*p)->data->vertex_tex_coords[i];
-      for (unsigned int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
       for (unsigned int i = 0; i < (*p)->data->vertex_colors.size(); i++) mesh->data->vertex_colors[i] = (*p)->data->vertex_colors[i];
       for (unsigned int i = 0; i < (*p)->data->faces.size(); i++) mesh->data->faces[i] = (*p)->data->faces[i];
+      kernels.topology_changed();
 
-      //calc and store original face lengths
-      faceLengths.reset_used();
-     	vsx_vector normal;
-     	vsx_vector len;
-     	vsx_vector hypVec;
-      for (unsigned int i = 0; i < (*p)->data->faces.size(); i++) {
-      	vsx_face& f = mesh->data->faces[i];
-      	vsx_vector& v0 = mesh->data->vertices[f.a];
-      	vsx_vector& v1 = mesh->data->vertices[f.b];
-      	vsx_vector& v2 = mesh->data->vertices[f.c];
-      	//calc face area
-        normal.assign_face_normal(&v0, &v1, &v2);
-        float area = normal.length() / 2.0f;
-        faceAreas[i] = area;
-        //facelengths a, b, c stored in vector x, y, z
-        len.x = (v1 - v0).length();
-        len.y = (v2 - v1).length();
-        len.z = (v0 - v2).length();
-        faceLengths.push_back(len);
-      }
+      // rest lengths from the mesh as it came in
+      body.build(mesh->data->faces.get_pointer(), mesh->data->faces.size(), mesh->data->vertices.get_pointer(), mesh->data->vertices.size());
+
+      //default gas_amount to volume of a new mesh i.e. no pressure
+      gas_amount->set(body.calculate_volume(mesh->data->vertices.get_pointer()));
       mesh->timestamp++;
       param_updates = 0;
 
-      newMeshLoaded = true;
       dtimeRest = 0.0f;
     }
 
-    float stepSize = step_size->get();
-    //float stepsPerSecond = steps_per_second->get();
-    float gasExpansionFactor = gas_expansion_factor->get();
-    float gridStiffnessFactor = grid_stiffness_factor->get();
-    float dampingFactor =  damping_factor->get();
-    float materialWeight = material_weight->get();
-    float lowerBoundary = lower_boundary->get();
-
-    //use engine->dtime; and dtimeRest
-    //to repeat the calculation several times ((dtime + rest) * stepsPerSecond)
-
-
-
-    //calculate volume
-    float volume = 0.0f;
-    vsx_face* face_p = mesh->data->faces.get_pointer();
-    vsx_vector* vertex_p = mesh->data->vertices.get_pointer();
-    vsx_vector* faces_length_p = faceLengths.get_pointer();
-
-    verticesSpeed.allocate(mesh->data->vertices.size());
-    vsx_vector* vertices_speed_p = verticesSpeed.get_pointer();
-
-    float onedivsix = (1.0f / 6.0f);
-    for(unsigned int i = 0; i < mesh->data->faces.size(); i++) {
-    	vsx_face& f = face_p[i];//mesh->data->faces[i];
-    	vsx_vector& v0 = vertex_p[f.a];
-    	vsx_vector& v2 = vertex_p[f.b];
-    	vsx_vector& v1 = vertex_p[f.c];
-
-      volume += (v0.x * (v1.y - v2.y) +
-           v1.x * (v2.y - v0.y) +
-           v2.x * (v0.y - v1.y)) * (v0.z + v1.z + v2.z) * onedivsix;
-
-    }
-
-    //default gas_amount to volume of a new mesh i.e. no pressure
-    if(newMeshLoaded) {
-      gas_amount->set(volume);
-    }
-    float pressure = (gas_amount->get() - volume) / volume;
-
-    //mesh->data->face_normals.reset_used(0);
-    //mesh->data->vertex_normals.reset_used(0);
-
-
-    //calculate face areas, normals, forces and add to speed
-    for(unsigned int i = 0; i < mesh->data->faces.size(); i++) {
-    	vsx_face& f = face_p[i];//mesh->data->faces[i];
-    	vsx_vector& v0 = vertex_p[f.a];//mesh->data->vertices[f.a];
-    	vsx_vector& v1 = vertex_p[f.b];//mesh->data->vertices[f.b];
-    	vsx_vector& v2 = vertex_p[f.c];//mesh->data->vertices[f.c];
-
-              printVector("v0", i, v0);
-              printVector("v1", i, v1);
-              printVector("v2", i, v2);
-
-    	//vsx_vector normal = mesh->data->get_face_normal(i);
-      vsx_vector a = vertex_p[face_p[i].b] - vertex_p[face_p[i].a];
-      vsx_vector b = vertex_p[face_p[i].c] - vertex_p[face_p[i].a];
-      vsx_vector normal;
-      normal.cross(a,b);
-
-
-
-              printVector("normal", i, normal);
-
-      //float len = normal.length();
-      //float area = len / 2;
-
-              printFloat("length", i, len);
-              printFloat("area", i, len);
-
-      vsx_vector edgeA = (v1 - v0);
-      vsx_vector edgeB = (v2 - v1);
-      vsx_vector edgeC = (v0 - v2);
-
-              printVector("edgeA", i, edgeA);
-              printVector("edgeB", i, edgeB);
-              printVector("edgeC", i, edgeC);
-
-      float lenA = edgeA.length();
-      float lenB = edgeB.length();
-      float lenC = edgeC.length();
-
-              printFloat("lenA", i, lenA);
-              printFloat("lenB", i, lenB);
-              printFloat("lenC", i, lenC);
-
-
-      float edgeForceA = (faces_length_p[i].x - lenA) / faces_length_p[i].x;
-      float edgeForceB = (faces_length_p[i].y - lenB) / faces_length_p[i].y;
-      float edgeForceC = (faces_length_p[i].z - lenC) / faces_length_p[i].z;
-
-              printFloat("edgeForceA", i, edgeForceA);
-              printFloat("edgeForceB", i, edgeForceB);
-              printFloat("edgeForceC", i, edgeForceC);
-
-      float edgeAccA = edgeForceA / lenA;
-      float edgeAccB = edgeForceB / lenB;
-      float edgeAccC = edgeForceC / lenC;
-
-              printFloat("edgeAccA", i, edgeAccA);
-              printFloat("edgeAccB", i, edgeAccB);
-              printFloat("edgeAccC", i, edgeAccC);
-
-      vsx_vector accA = edgeA * edgeAccA;
-      vsx_vector accB = edgeB * edgeAccB;
-      vsx_vector accC = edgeC * edgeAccC;
-
-              printVector("accA", i, accA);
-              printVector("accB", i, accB);
-              printVector("accC", i, accC);
-
-      vertices_speed_p[f.a] -= (accA - accC) * gridStiffnessFactor;
-      vertices_speed_p[f.b] -= (accB - accA) * gridStiffnessFactor;
-      vertices_speed_p[f.c] -= (accC - accB) * gridStiffnessFactor;
-
-      //applying pressure to areas of faces
-      vsx_vector pressureAcc = normal * pressure * gasExpansionFactor;
-      vertices_speed_p[f.a] -= pressureAcc;
-      vertices_speed_p[f.b] -= pressureAcc;
-      vertices_speed_p[f.c] -= pressureAcc;
-
-      //apply material weight
-      vertices_speed_p[f.a].y -= materialWeight;
-      vertices_speed_p[f.b].y -= materialWeight;
-      vertices_speed_p[f.c].y -= materialWeight;
-
-    }
+    if (!body.get_num_vertices())
+      return;
 
-    //apply speeds to vertices
-    for(unsigned int i = 0; i < mesh->data->vertices.size(); i++) {
-      vertex_p[i] += vertices_speed_p[i] * stepSize;
-      if(vertex_p[i].y < lowerBoundary) {
-        vertex_p[i].y = lowerBoundary;
+    body.step_size = step_size->get();
+    body.gas_amount = gas_amount->get();
+    body.gas_expansion = gas_expansion_factor->get();
+    body.stiffness = grid_stiffness_factor->get();
+    body.damping = damping_factor->get();
+    body.face_acceleration = vsx_vector(0.0f, -material_weight->get(), 0.0f);
+    body.floor_y = lower_boundary->get();
+
+    // fixed steps per second of engine time, the rest carries over to the
+    // next frame. 0 steps per second is one step per frame like before.
+    int steps = 1;
+    float stepsPerSecond = steps_per_second->get();
+    if (stepsPerSecond > 0.0f)
+    {
+      dtimeRest += engine->dtime;
+      if (dtimeRest < 0.0f)
+        dtimeRest = 0.0f;
+      steps = (int)(dtimeRest * stepsPerSecond);
+      dtimeRest -= (float)steps / stepsPerSecond;
+      if (steps > MESH_INFLATE_MAX_STEPS)
+      {
+        steps = MESH_INFLATE_MAX_STEPS;
+        dtimeRest = 0.0f;
       }
-      vertices_speed_p[i] = vertices_speed_p[i] * dampingFactor;
     }
 
+    if (steps)
+    {
+      for (int i = 0; i < steps; i++)
+        body.step(mesh->data->vertices.get_pointer());
+      mesh->data->vertices.timestamp++;
 
-    mesh->data->vertex_normals.allocate(mesh->data->vertices.size());
-    mesh->data->vertex_normals.memory_clear();
-    vsx_vector* vertex_normals_p = mesh->data->vertex_normals.get_pointer();
-    /*for(unsigned int i = 0; i < mesh->data->vertices.size(); i++) {
-      mesh->data->vertex_normals[i] = vsx_vector(0, 0, 0);
-    }*/
-
-    //TODO: create vertex normals, for rendering... should be a separate module...
-    for(unsigned int i = 0; i < mesh->data->faces.size(); i++) {
-      vsx_vector a = vertex_p[face_p[i].b] - vertex_p[face_p[i].a];
-      vsx_vector b = vertex_p[face_p[i].c] - vertex_p[face_p[i].a];
-      vsx_vector normal;
-      normal.cross(a,b);
-
-    	//vsx_vector normal = mesh->data->get_face_normal(i);
-    	normal = -normal;
-    	normal.normalize();
-    	vertex_normals_p[face_p[i].a] += normal;
-    	vertex_normals_p[face_p[i].b] += normal;
-    	vertex_normals_p[face_p[i].c] += normal;
+      // vertex normals for rendering, faces wind the other way in here
+      kernels.calculate_vertex_normals(mesh->data, VSX_MESH_KERNELS_UNIT_FACES | VSX_MESH_KERNELS_FLIP);
+      mesh->timestamp++;
     }
 
-    volume_out->set(volume);
-
-    //printf("***************Pressure %f     ", pressure);
-    //printf(" Volume %f\n", volume);
-
+    volume_out->set(body.volume);
     mesh_out->set_p(mesh);
   }
 };
 
-#undef printVector
-#undef printFloat
-
 
 
-class vertex_holder {
-public:
-  float dist;
-  int id;
-  bool operator < (const vertex_holder& a) {
-      return dist > a.dist;
-  }
-};
-
 class vsx_module_mesh_vertex_distance_sort : public vsx_module {
   // in
   vsx_module_param_mesh* mesh_in;
@@ -2378,100 +2039,19 @@ class vsx_module_mesh_vertex_distance_sort : public vsx_module {
   vsx_module_param_float_array* original_ids;
   // internal
   vsx_mesh* mesh;
-  vsx_array<vertex_holder*> distances;
+  vsx_array<float> distances;
+  // keeps the last order, a slowly moving point sorts in about one pass
+  vsx_sort_float sorter;
 
   // previous id maintanence
   vsx_float_array i_ids;
   vsx_array<float> ids_data;
 
-  //*******************************************************************************
-  //*******************************************************************************
-  //*******************************************************************************
-  //*******************************************************************************
-
-  // fast square root routine from nvidia
-  
-  #define FP_BITS(fp) (*(unsigned int *)&(fp))
-
-  unsigned int fast_sqrt_table[0x10000];  // declare table of square roots
-
-  typedef union FastSqrtUnion
-  {
-    float f;
-    unsigned int i;
-  } FastSqrtUnion;
-
-  void  build_sqrt_table()
-  {
-    unsigned int i;
-    FastSqrtUnion s;
-
-    for (i = 0; i <= 0x7FFF; i++)
-    {
-
-      // Build a float with the bit pattern i as mantissa
-      //  and an exponent of 0, stored as 127
-
-      s.i = (i << 8) | (0x7F << 23);
-      s.f = (float)sqrt(s.f);
-
-      // Take the square root then strip the first 7 bits of
-      //  the mantissa into the table
-
-      fast_sqrt_table[i + 0x8000] = (s.i & 0x7FFFFF);
-
-      // Repeat the process, this time with an exponent of 1,
-      //  stored as 128
-
-      s.i = (i << 8) | (0x80 << 23);
-      s.f = (float)sqrt(s.f);
-
-      fast_sqrt_table[i] = (s.i & 0x7FFFFF);
-    }
-  }
-
-  inline float fastsqrt(float n)
-  {
-    if (FP_BITS(n) == 0)
-      return 0.0;                 // check for square root of 0
-
-    FP_BITS(n) = fast_sqrt_table[(FP_BITS(n) >> 8) & 0xFFFF] | ((((FP_BITS(n) - 0x3F800000) >> 1) + 0x3F800000) & 0x7F800000);
-
-    return n;
-  }
-  
-  void quicksort(vertex_holder** a, int left, int right) {
-      int i = left, j = right;
-      vertex_holder *tmp;
-      float pivot = a[(left + right) / 2]->dist;
-
-      /* partition */
-      while (i <= j) {
-            while (a[i]->dist < pivot)
-                  i++;
-            while (a[j]->dist > pivot)
-                  j--;
-            if (i <= j) {
-                  tmp = a[i];
-                  a[i] = a[j];
-                  a[j] = tmp;
-                  i++;
-                  j--;
-            }
-      };
-
-      /* recursion */
-      if (left < j)
-            quicksort(a, left, j);
-      if (i < right)
-            quicksort(a, i, right);
-}
-  
-
 public:
 
   bool init() {
     mesh = new vsx_mesh;
+    prev_timestamp = 0xFFFFFFFF;
     return true;
   }
 
@@ -2500,8 +2080,6 @@ public:
     original_ids = (vsx_module_param_float_array*)out_parameters.create(VSX_MODULE_PARAM_ID_FLOAT_ARRAY,"original_ids");
     i_ids.data = &ids_data;
     original_ids->set_p(i_ids);
-    
-    build_sqrt_table();
   }
 
 
@@ -2518,53 +2096,34 @@ public:
       float dty = distance_to->get(1);
       float dtz = distance_to->get(2);
       //---
-      //  init pointer iterators
       size_t vertex_count = (*p)->data->vertices.size();
-      //printf("distances arreay size: %d      mesh data size: %d\n", distances.size(), vertex_count);
-      if (distances.size() < vertex_count)
-      {
-        #ifdef VSXU_DEBUG
-        printf("allocating more memory for vertex holders...\n");
-        #endif
-        distances.allocate(vertex_count-1);
-        for (size_t i = 0; i < vertex_count; i++)
-        {
-          distances[i] = new vertex_holder;
-        }
-      }
-      //-----------------------------------------------------------
-      vertex_holder** vf = distances.get_pointer();
+      distances.allocate(vertex_count - 1);
+      distances.reset_used(vertex_count);
+      float* dist = distances.get_pointer();
       vsx_vector* vp = (*p)->data->vertices.get_pointer();
-      //
-      
-      for (unsigned int i = 0; i < (*p)->data->vertices.size(); i++)
+      for (size_t i = 0; i < vertex_count; i++)
       {
-        float x = fabs(dtx - (*vp).x);
-        float y = fabs(dty - (*vp).y);
-        float z = fabs(dtz - (*vp).z);
-        // yo pythagoras!
-        (*vf)->dist = sqrtf(x*x + y*y + z*z);
-        (*vf)->id = i;
-        vf++;
-        vp++;
+        float x = dtx - vp[i].x;
+        float y = dty - vp[i].y;
+        float z = dtz - vp[i].z;
+        // squared, sorts the same as the distance
+        dist[i] = x*x + y*y + z*z;
       }
-      // sort the arrays
-      quicksort(distances.get_pointer(),0,vertex_count-1);
-      // put it back into our private mesh, payload order is calculated by id
-      mesh->data->vertices.allocate(vertex_count);
-      vertex_holder** ddp = distances.get_pointer();
-      vsx_vector* dp = mesh->data->vertices.get_end_pointer();
-      vsx_vector* ds = (*p)->data->vertices.get_pointer();
-      size_t i = 0;
-      while (i < vertex_count)
+      const unsigned int* order = sorter.sort(dist, vertex_count);
+      // put it back into our private mesh furthest first, the ids stay
+      // nearest first
+      mesh->data->vertices.allocate(vertex_count - 1);
+      mesh->data->vertices.reset_used(vertex_count);
+      ids_data.allocate(vertex_count - 1);
+      ids_data.reset_used(vertex_count);
+      vsx_vector* dp = mesh->data->vertices.get_pointer();
+      float* ip = ids_data.get_pointer();
+      for (size_t i = 0; i < vertex_count; i++)
       {
-        //printf("id: %d  %f\n", (*ddp)->id,(*ddp)->dist);
-        *dp = ds[(*ddp)->id];
-        ids_data[i] = (float)(*ddp)->id;
-        dp--;
-        ddp++;
-        i++;
+        dp[vertex_count - 1 - i] = vp[order[i]];
+        ip[i] = (float)order[i];
       }
+      mesh->data->vertices.timestamp++;
       // finally set output params
       mesh->timestamp++;
       mesh_out->set_p(mesh);
@@ -2631,14 +2190,9 @@ public:
       am.x = amount->get(0);
       am.y = amount->get(1);
       am.z = amount->get(2);
-      mesh->data->vertices.reset_used(0);
-      mesh->data->vertex_normals.reset_used(0);
-      mesh->data->vertex_tex_coords.reset_used(0);
-      mesh->data->vertex_colors.reset_used(0);
-      mesh->data->faces.reset_used(0);
 
       unsigned long end = (*p)->data->vertices.size();
-      vsx_vector* vs_p = &(*p)->data->vertices[0];
+      vsx_vector* vs_p = (*p)->data->vertices.get_pointer();
       mesh->data->vertices.allocate(end);
       mesh->data->vertices.reset_used(end);
       vsx_vector* vs_d = mesh->data->vertices.get_pointer();
@@ -2671,20 +2225,7 @@ public:
 
       //if (prev_timestamp != (*p)->timestamp)
       //{
-      mesh->data->vertex_normals.set_volatile();
-      mesh->data->vertex_normals.set_data((*p)->data->vertex_normals.get_pointer(), (*p)->data->vertex_normals.size());
-
-      mesh->data->vertex_tex_coords.set_volatile();
-      mesh->data->vertex_tex_coords.set_data((*p)->data->vertex_tex_coords.get_pointer(), (*p)->data->vertex_tex_coords.size());
-
-      mesh->data->vertex_tangents.set_volatile();
-      mesh->data->vertex_tangents.set_data((*p)->data->vertex_tangents.get_pointer(), (*p)->data->vertex_tangents.size());
-
-      mesh->data->vertex_colors.set_volatile();
-      mesh->data->vertex_colors.set_data((*p)->data->vertex_colors.get_pointer(), (*p)->data->vertex_colors.size());
-
-      mesh->data->faces.set_volatile();
-      mesh->data->faces.set_data((*p)->data->faces.get_pointer(), (*p)->data->faces.size());
+      mesh->data->share((*p)->data, VSX_MESH_VERTEX_NORMALS | VSX_MESH_VERTEX_TEX_COORDS | VSX_MESH_VERTEX_TANGENTS | VSX_MESH_VERTEX_COLORS | VSX_MESH_FACES);
 //      }
 
 
@@ -2694,6 +2235,7 @@ public:
       //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
       //for (unsigned int i = 0; i < (*p)->data->vertex_colors.size(); i++) mesh->data->vertex_colors[i] = (*p)->data->vertex_colors[i];
       //for (unsigned int i = 0; i < (*p)->data->faces.size(); i++) mesh->data->faces[i] = (*p)->data->faces[i];
+      mesh->data->vertices.timestamp++;
       mesh->timestamp++;
       mesh_out->set_p(mesh);
       //for (int i = 0; i < (*p)->data->vertex_normals.size(); i++) mesh->data->vertex_normals[i] = (*p)->data->vertex_normals[i];
@@ -2742,6 +2284,7 @@ vsx_module* create_new_module(unsigned long module, void* args)
     case 15: return (vsx_module*)(new vsx_module_mesh_translate_edge_wraparound);
     case 16: return (vsx_module*)(new vsx_module_mesh_vortex);
     case 17: return (vsx_module*)(new vsx_module_mesh_scale_normalize);
+    case 18: return (vsx_module*)(new vsx_module_mesh_closest_vertex_picker);
   }
   return 0;
 }
@@ -2767,9 +2310,10 @@ void destroy_module(vsx_module* m,unsigned long module) {
     case 15: delete (vsx_module_mesh_translate_edge_wraparound*)m; break;
     case 16: delete (vsx_module_mesh_vortex*)m; break;
     case 17: delete (vsx_module_mesh_scale_normalize*)m; break;
+    case 18: delete (vsx_module_mesh_closest_vertex_picker*)m; break;
   }
 }
 
 unsigned long get_num_modules() {
-  return 18;
+  return 19;
 }
@@ -28,6 +28,7 @@
 #include "vsx_param.h"
 #include "vsx_module.h"
 #include "vsx_quaternion.h"
+#include "vsx_mesh_spatial.h"
 
 
 class vsx_module_plugin_fluid : public vsx_module {
@@ -915,6 +916,133 @@ public:
   }
 };
 
+class vsx_module_particle_mesh_collider : public vsx_module {
+	// in
+	vsx_module_param_particlesystem* in_particlesystem;
+	vsx_module_param_mesh* mesh_in;
+	vsx_module_param_int* bounce;
+	vsx_module_param_float* loss;
+	vsx_module_param_float* offset;
+	// out
+	vsx_module_param_particlesystem* result_particlesystem;
+	// internal
+	// where every particle was after the last frame, and its age then - a
+	// particle that got younger was respawned and didn't travel
+	vsx_array<vsx_vector> previous;
+	vsx_array<float> previous_time;
+	vsx_array<vsx_vector> direction;
+	vsx_array<vsx_mesh_spatial_hit> hits;
+
+public:
+
+  void module_info(vsx_module_info* info)
+  {
+    info->identifier = "particlesystems;modifiers;mesh_collider";
+    info->description = "Keeps particles from passing through\n"
+                        "the faces of a mesh, like floor\n"
+                        "does for the walls.";
+    info->in_param_spec = "in_particlesystem:particlesystem,mesh_in:mesh,bounce:enum?no|yes,loss:float,offset:float";
+    info->out_param_spec = "particlesystem:particlesystem";
+    info->component_class = "particlesystem";
+  }
+
+  void declare_params(vsx_module_param_list& in_parameters, vsx_module_param_list& out_parameters)
+  {
+    loading_done = true;
+    in_particlesystem = (vsx_module_param_particlesystem*)in_parameters.create(VSX_MODULE_PARAM_ID_PARTICLESYSTEM,"in_particlesystem");
+    mesh_in = (vsx_module_param_mesh*)in_parameters.create(VSX_MODULE_PARAM_ID_MESH,"mesh_in");
+    bounce = (vsx_module_param_int*)in_parameters.create(VSX_MODULE_PARAM_ID_INT,"bounce");
+    bounce->set(1);
+    loss = (vsx_module_param_float*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"loss");
+    loss->set(5.0f);
+    offset = (vsx_module_param_float*)in_parameters.create(VSX_MODULE_PARAM_ID_FLOAT,"offset");
+    offset->set(0.001f);
+    result_particlesystem = (vsx_module_param_particlesystem*)out_parameters.create(VSX_MODULE_PARAM_ID_PARTICLESYSTEM,"particlesystem");
+  }
+
+  void run() {
+    vsx_particlesystem* particles = in_particlesystem->get_addr();
+    if (!particles) {
+      result_particlesystem->valid = false;
+      return;
+    }
+    result_particlesystem->set_p(*particles);
+
+    unsigned long nump = particles->particles->size();
+    vsx_particle* pp = particles->particles->get_pointer();
+    if (!nump)
+      return;
+    bool fresh = previous.size() != nump;
+    if (fresh)
+    {
+      previous.allocate(nump - 1);
+      previous.reset_used(nump);
+      previous_time.allocate(nump - 1);
+      previous_time.reset_used(nump);
+    }
+
+    vsx_mesh** mesh = mesh_in->get_addr();
+    if (fresh || !mesh || !(*mesh)->data || !(*mesh)->data->faces.size())
+    {
+      for (unsigned long i = 0; i < nump; i++)
+      {
+        previous[i] = pp[i].pos;
+        previous_time[i] = pp[i].time;
+      }
+      return;
+    }
+
+    // the segment every particle moved along since the last frame, one
+    // batched ray cast against the mesh's bvh
+    direction.allocate(nump - 1);
+    direction.reset_used(nump);
+    hits.allocate(nump - 1);
+    hits.reset_used(nump);
+    vsx_vector* from = previous.get_pointer();
+    for (unsigned long i = 0; i < nump; i++)
+    {
+      if (pp[i].time < previous_time[i])
+        direction[i] = vsx_vector(0, 0, 0);
+      else
+        direction[i] = vsx_vector(pp[i].pos.x - from[i].x, pp[i].pos.y - from[i].y, pp[i].pos.z - from[i].z);
+    }
+    vsx_bvh* bvh = vsx_mesh_spatial::get(*mesh)->get_bvh();
+    bvh->raycast_batch(from, direction.get_pointer(), nump, 1.0f, hits.get_pointer());
+
+    vsx_mesh_data* md = (*mesh)->data;
+    float keep = 1.0f - loss->get() * 0.01f;
+    float off = offset->get();
+    bool b = bounce->get() != 0;
+    for (unsigned long i = 0; i < nump; i++)
+    {
+      vsx_mesh_spatial_hit& hit = hits[i];
+      if (hit.distance != FLT_MAX)
+      {
+        vsx_face& f = md->faces[hit.index];
+        vsx_vector e1 = md->vertices[f.b] - md->vertices[f.a];
+        vsx_vector e2 = md->vertices[f.c] - md->vertices[f.a];
+        vsx_vector n;
+        n.cross(e1, e2);
+        n.normalize();
+        // face the side the particle came from
+        if (n.dot_product(&direction[i]) > 0.0f)
+          n = n * -1.0f;
+        pp[i].pos = hit.position + n * off;
+        float into = pp[i].speed.dot_product(&n);
+        if (into < 0.0f)
+        {
+          if (b)
+            pp[i].speed = (pp[i].speed - n * (2.0f * into)) * keep;
+          else
+            pp[i].speed = pp[i].speed - n * into;
+        }
+      }
+      previous[i] = pp[i].pos;
+      previous_time[i] = pp[i].time;
+    }
+  }
+};
+
 //******************************************************************************
 //*** F A C T O R Y ************************************************************
 //******************************************************************************
@@ -931,7 +1059,7 @@ __declspec(dllexport) unsigned long get_num_modules();
 
 
 unsigned long get_num_modules() {
-  return 5;
+  return 6;
 }  
 
 vsx_module* create_new_module(unsigned long module, void* args)
@@ -943,6 +1071,7 @@ vsx_module* create_new_module(unsigned long module, void* args)
     case 2: return (vsx_module*)(new vsx_module_plugin_gravity);
     case 3: return (vsx_module*)(new vsx_module_particle_floor);
     case 4: return (vsx_module*)(new vsx_module_plugin_fluid);
+    case 5: return (vsx_module*)(new vsx_module_particle_mesh_collider);
   }
   return 0;
 }
@@ -954,5 +1083,6 @@ void destroy_module(vsx_module* m,unsigned long module) {
     case 2: delete (vsx_module_plugin_gravity*)m; break;
     case 3: delete (vsx_module_particle_floor*)m; break;
     case 4: delete (vsx_module_plugin_fluid*)m; break;
+    case 5: delete (vsx_module_particle_mesh_collider*)m; break;
   }
 }
@@ -26,6 +26,7 @@
 #include "vsx_param.h"
 #include "vsx_module.h"
 #include "vsx_math_3d.h"
+#include "vsx_sort.h"
 #define VSX_FONT_NO_FT 1
 #include "vsx_font.h"
 #include "vsx_glsl.h"
@@ -594,18 +595,6 @@ public:
   }
 };
 
-class face_holder {
-public:
-  double dist;
-  int id;
-  bool operator < (const face_holder& a) {
-      return dist > a.dist;
-  }
-  //face_holder() : dist(0),id(0) {};
-};
-
-
-
 #include "module_render_mesh.h"
 
 
@@ -773,8 +762,10 @@ class vsx_module_render_mesh_zsort : public vsx_module {
   vsx_texture** ta;
   bool m_normals, m_tex, m_colors;
   vsx_matrix mod_mat, proj_mat;
-  vsx_avector_nd<face_holder> f_distances;
+  vsx_avector_nd<float> f_distances;
   vsx_avector_nd<vsx_face> f_result;
+  // keeps last frame's order, a slowly turning camera costs next to nothing
+  vsx_sort_float sorter;
 public:
   void module_info(vsx_module_info* info)
   {
@@ -801,40 +792,6 @@ public:
   }
 
 
-  static int fpartition(face_holder* a, int first, int last) {
-    face_holder pivot = a[first];
-    int lastS1 = first;
-    int firstUnknown = first + 1;
-    while (firstUnknown <= last) {
-      if (a[firstUnknown] < pivot) {
-        lastS1++;
-        face_holder b = a[firstUnknown];
-        a[firstUnknown] = a[lastS1];
-        a[lastS1] = b;
-        //printf("a");
-        //std::swap(a[firstUnknown], a[lastS1]);
-      }
-      firstUnknown++;
-    }
-    face_holder b = a[first];
-    a[first] = a[lastS1];
-    a[lastS1] = b;
-    //std::swap(a[first], a[lastS1]);
-    return lastS1;
-  }
-
-  static void fquicksort(face_holder* a, int first, int last) {
-    if (first < last) {
-      int pivotIndex = fpartition(a, first, last);
-      fquicksort(a, first, pivotIndex - 1);
-      fquicksort(a, pivotIndex + 1, last);
-    }
-  }
-
-  static void fquicksort(face_holder* a, int aSize) {
-    fquicksort(a, 0, aSize - 1);
-  }
-
   void output(vsx_module_param_abs* param)
   {
     VSX_UNUSED(param);
@@ -888,31 +845,26 @@ public:
         //b.dump("camera_pos");
 
         // make sure we have centers to sort on
-        if (!(*mesh)->data->face_centers.size()) {
+        unsigned long face_count = (*mesh)->data->faces.size();
+        if ((*mesh)->data->face_centers.size() != face_count) {
           (*mesh)->data->calculate_face_centers();
         }
-        // loop through all the faces and calculate the distance from the camera
-        for (unsigned long i = 0; i < (*mesh)->data->face_centers.size(); ++i) {
-          //f_distances[i].dist = (*mesh)->data->face_centers[i].distance(b);
-          f_distances[i].dist = (*mesh)->data->face_centers[i].dot_product(&sort_vec);
-          f_distances[i].id = i;
-          /*glPushMatrix();
-          glTranslatef((*mesh)->data->face_centers[i].x,(*mesh)->data->face_centers[i].y,(*mesh)->data->face_centers[i].z);
-          glColor4f(1,1,1,1);
-          gluSphere(quadratic,0.1,20,20);
-          glPopMatrix();
-          printf("id: %d  dist: %f\n",i, f_distances[i].dist);*/
+        // distance along the view direction, far faces first
+        f_distances.reset_used(0);
+        f_distances[face_count - 1];
+        f_result.reset_used(0);
+        f_result[face_count - 1];
+        float* dist = f_distances.get_pointer();
+        vsx_vector* centers = (*mesh)->data->face_centers.get_pointer();
+        for (unsigned long i = 0; i < face_count; ++i) {
+          dist[i] = centers[i].dot_product(&sort_vec);
         }
-        //printf("-----\n");
-        // we have the distances, now time to sort
-        //std::sort(f_distances, f_distances.get_end_pointer());
-        fquicksort(f_distances.get_pointer(),f_distances.size());
-        for (unsigned long i = 0; i < (*mesh)->data->face_centers.size(); ++i) {
-          //printf("id: %d  dist: %f\n",f_distances[i].id, f_distances[i].dist);
-          f_result[i] = (*mesh)->data->faces[f_distances[i].id];
-          //f_result[(*mesh)->data->face_centers.size()-1-i] = (*mesh)->data->faces[f_distances[i].id];
+        const unsigned int* order = sorter.sort(dist, face_count, true);
+        vsx_face* faces = (*mesh)->data->faces.get_pointer();
+        vsx_face* result = f_result.get_pointer();
+        for (unsigned long i = 0; i < face_count; ++i) {
+          result[i] = faces[order[i]];
         }
-        //printf("f_Result.size: %d\n",f_result.size());
 
 
         if (vertex_colors->get()) {
@@ -29,6 +29,7 @@
 #include "vsx_module.h"
 #include "pthread.h"
 #include "vsxg.h"
+#include "vsx_bitmap_loader.h"
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -149,45 +150,20 @@ class module_load_png : public vsx_module {
   vsx_module_param_texture* texture_out;
   
   // internal
-  
-  // threading stuff
-  void* pti_l;
-  
   vsx_texture* texture;
-  
-  static void* png_worker_v(void *ptr) {
-    //printf("thread starting\n");
-    //if (((module_load_png*)ptr)->bitm.data) {
-      //delete ((module_load_png*)ptr)->bitm.data;
-    //}
 
-    module_load_png* module = ((module_load_png*)ptr);
-    
-    ((module_load_png*)ptr)->pp = new pngRawInfo;
-    if (pngLoadRaw( module->current_filename.c_str(), ((module_load_png*)ptr)->pp,((module_load_png*)ptr)->engine->filesystem)) {
-      ((module_load_png*)ptr)->bitm.valid = true;
-      ((module_load_png*)ptr)->thread_state = 2;
-    } else {
-      //printf("thread: bitmap not valid\n");
-      ((module_load_png*)ptr)->bitm.valid = false;
-      ((module_load_png*)ptr)->thread_state = -1;
-      ((module_load_png*)ptr)->last_modify_time = 0;
-    }
-    //printf("png thread ending\n");
-    return 0;
-  }
-  
+  // decoding is done by the shared loader, the bitmap data belongs to it.
+  // the old image stays around until the new one is decoded.
+  vsx_bitmap_loader_entry* entry;
+  vsx_bitmap_loader_entry* pending;
+  // coming up in the timeline
+  vsx_bitmap_loader_prefetch prefetched;
 
 public:
   int m_type;
   vsx_string current_filename;
   vsx_bitmap bitm;
   int bitm_timestamp; // keep track of the timestamp for the bitmap internally 
-  int               thread_state;
-  bool              thread_working;
-  pngRawInfo*       pp;
-  pthread_t         worker_t;
-  pthread_attr_t    worker_t_attr;
 
   int texture_timestamp;
 
@@ -229,29 +205,20 @@ public:
     texture_timestamp = bitm_timestamp = bitm.timestamp;
   
     bitmap_out->set_p(bitm);
-    thread_state = 0;
+    entry = 0;
+    pending = 0;
     texture = 0x0;
     
     texture_out = (vsx_module_param_texture*)out_parameters.create(VSX_MODULE_PARAM_ID_TEXTURE,"texture");
     texture_out->valid = false;
   }
   
-  time_t last_modify_time;
-  t_stat st;
   void run()
   {
     if (current_filename != filename_in->get() || reload->get() == 1) {
+      bool force = reload->get() == 1;
       reload->set(0);
 
-      // time to decode a new png
-      if (thread_state > 0) {
-        if (thread_state == 1) {
-          long* aa;
-          pthread_join(worker_t, (void **)&aa);
-        }
-        free(pp->Data);
-        delete pp; 
-      }
      	if (!verify_filesuffix(filename_in->get(),"png")) {
      		filename_in->set(current_filename);
      		message = "module||ERROR! This is not a PNG image file!";
@@ -259,47 +226,41 @@ public:
      	} else message = "module||ok";
     
       current_filename = filename_in->get();
-      stat(current_filename.c_str(), &st);
-      last_modify_time = st.st_mtime;
-      pthread_attr_init(&worker_t_attr);
-      thread_state = 1;
-      pthread_create(&(worker_t), &(worker_t_attr), &png_worker_v, (void*)this);
+      vsx_bitmap_loader::get_instance()->release(pending, engine->filesystem);
+      pending = vsx_bitmap_loader::get_instance()->request(current_filename, engine->filesystem, VSX_BITMAP_LOADER_PRIORITY_NORMAL, "", force);
+      prefetched.remove(current_filename, engine->filesystem);
     }
-    //printf("foobar\n");
-    if (thread_state == 2) {
-      thread_state = 3;
-      if (bitm.valid) {
-        if (pp->Components == 1) {
-          bitm.bpp = 3;
-          bitm.bformat = GL_RGB;
-        } else 
-        if (pp->Components == 2) {
-          bitm.bpp = 4;
-          bitm.bformat = GL_RGBA;
-        } else
-        if (pp->Components == 3) {
-          bitm.bpp = 3;
-          bitm.bformat = GL_RGB;
-        } else
-        if (pp->Components == 4) {
-          bitm.bpp = 4;
-          bitm.bformat = GL_RGBA;
-        }
-        bitm.size_x = pp->Width;
-        bitm.size_y = pp->Height;
-        bitm.data = (vsx_bitmap_32bt*)(pp->Data);
-
-        bitm.timestamp++;
-        bitmap_out->set_p(bitm);
-      }
+    if (!pending)
+      return;
+    if (pending->state == VSX_BITMAP_LOADER_FAILED) {
+      message = "module||"+pending->error+"\n"+current_filename;
+      vsx_bitmap_loader::get_instance()->release(pending, engine->filesystem);
+      pending = 0;
+      return;
+    }
+    if (pending->state == VSX_BITMAP_LOADER_DONE) {
+      vsx_bitmap_loader::get_instance()->release(entry, engine->filesystem);
+      entry = pending;
+      pending = 0;
+      bitm.bpp = entry->bitmap.bpp;
+      bitm.bformat = entry->bitmap.bformat;
+      bitm.size_x = entry->bitmap.size_x;
+      bitm.size_y = entry->bitmap.size_y;
+      bitm.data = entry->bitmap.data;
+      bitm.valid = true;
+      bitm.timestamp++;
+      bitmap_out->set_p(bitm);
       loading_done = true;
+    }
   }
-}
 
 void output(vsx_module_param_abs* param)
 {
   if (param == (vsx_module_param_abs*)texture_out)
   {
+    // someone is drawing with us, get to the front of the queue
+    if (pending && pending->priority < VSX_BITMAP_LOADER_PRIORITY_VISIBLE)
+      vsx_bitmap_loader::get_instance()->set_priority(pending, VSX_BITMAP_LOADER_PRIORITY_VISIBLE);
     if (texture_timestamp != bitm.timestamp)
     {
       if (texture == 0x0)
@@ -309,7 +270,8 @@ void output(vsx_module_param_abs* param)
         texture->init_opengl_texture();
         texture->valid = false;
       }
-      texture->upload_ram_bitmap(&bitm,true);
+      if (entry)
+        texture->upload_ram_bitmap_cached(&bitm, entry->content_name, true);
       texture->valid = true;
       texture_out->set(texture);
       texture_timestamp = bitm.timestamp;
@@ -325,20 +287,26 @@ void stop() {
 }
 
 void start() {
-  texture->init_opengl_texture();
-  texture->upload_ram_bitmap(&bitm,true);
+  if (!texture || !entry)
+    return;
+  texture->upload_ram_bitmap_cached(&bitm, entry->content_name, true);
   texture->valid = true;
   texture_out->set(texture);
 }
 
 
+void prefetch(const vsx_string& name, const vsx_string& value)
+{
+  vsx_string filename = value;
+  if (name != "filename" || filename == current_filename) return;
+  if (!verify_filesuffix(filename, "png")) return;
+  prefetched.add(filename, engine->filesystem);
+}
+
 void on_delete() {
-  if (thread_state == 1)
-  pthread_join(worker_t,0);
-  if (thread_state > 0) {
-    free(pp->Data);
-    delete pp;
-  }
+  prefetched.clear(engine->filesystem);
+  vsx_bitmap_loader::get_instance()->release(pending, engine->filesystem);
+  vsx_bitmap_loader::get_instance()->release(entry, engine->filesystem);
   if (texture) {
     texture->unload();
     delete texture;
@@ -364,52 +332,11 @@ class module_load_jpeg : public vsx_module
   // internal
   vsx_texture* texture;
 
-  // threading stuff
-  void* pti_l;
-  
-  static void* jpeg_worker_v(void *ptr)
-  {
-    module_load_jpeg* mod = (module_load_jpeg*)ptr;
-
-    CJPEGTest* cj = new CJPEGTest;
-    vsx_string ret;
-    if
-    (
-     !(cj
-       ->LoadJPEG(
-       mod->current_filename,
-       ret,
-       mod->engine->filesystem
-     ))
-    )
-    {
-      mod->message = "module||"+ret+"\n"+((module_load_jpeg*)ptr)->current_filename;
-      mod->thread_state = -1;
-      delete cj;
-      return 0;
-    }
-    mod->bitm.size_x = cj->GetResX();
-    mod->bitm.size_y = cj->GetResY();
-
-    // allocate data in the vsx_bitmap
-    vsx_bitmap_32bt b_c = (mod->bitm.size_x) * (mod->bitm.size_y);
-
-    unsigned char* rb = (unsigned char*)cj->m_pBuf;
-    mod->bitm.data = new vsx_bitmap_32bt[b_c*2];
-
-    for (unsigned long i = 0; i < b_c; ++i)
-    {
-      ((vsx_bitmap_32bt*)mod->bitm.data)[i] =
-          0xFF000000 |
-          rb[i*3+2] << 16 |
-          rb[i*3+1] << 8 |
-          rb[i*3];
-    }
-    delete cj;
-    mod->thread_state = 2;
-
-    return 0;
-  }
+  // owned by the shared loader, see module_load_png
+  vsx_bitmap_loader_entry* entry;
+  vsx_bitmap_loader_entry* pending;
+  // coming up in the timeline
+  vsx_bitmap_loader_prefetch prefetched;
   
 public:
   int m_type;
@@ -417,10 +344,6 @@ public:
   vsx_string current_filename;
   vsx_bitmap bitm;
   int bitm_timestamp; // keep track of the timestamp for the bitmap internally 
-  int               thread_state;
-  bool              thread_working;
-  pthread_t         worker_t;
-  pthread_attr_t    worker_t_attr;
   int texture_timestamp;
   
   void module_info(vsx_module_info* info)
@@ -459,7 +382,8 @@ public:
     bitm.valid = false;
   
     bitmap_out->set_p(bitm);
-    thread_state = 0;
+    entry = 0;
+    pending = 0;
     texture_out = (vsx_module_param_texture*)out_parameters.create(VSX_MODULE_PARAM_ID_TEXTURE,"texture");
 
   	texture = new vsx_texture;
@@ -471,18 +395,6 @@ public:
   {
     if (current_filename != filename_in->get())
     {
-      if (thread_state == -1)
-      {
-        message = "module||ok";
-      }
-
-      // time to decode a new jpg
-      if (thread_state == 1)
-      {
-        long* aa;
-        pthread_join(worker_t, (void **)&aa);
-      }
-
       if (!verify_filesuffix(filename_in->get(),"jpg"))
       {
      		filename_in->set(current_filename);
@@ -492,17 +404,31 @@ public:
       message = "module||ok";
       
       current_filename = filename_in->get();
-      pthread_attr_init(&worker_t_attr);
-      thread_state = 1;
-      pthread_create(&(worker_t), &(worker_t_attr), &jpeg_worker_v, (void*)this);
+      vsx_bitmap_loader::get_instance()->release(pending, engine->filesystem);
+      pending = vsx_bitmap_loader::get_instance()->request(current_filename, engine->filesystem);
+      prefetched.remove(current_filename, engine->filesystem);
     }
-    if (thread_state == 2)
+    if (!pending)
+      return;
+    if (pending->state == VSX_BITMAP_LOADER_FAILED)
     {
+      message = "module||"+pending->error+"\n"+current_filename;
+      vsx_bitmap_loader::get_instance()->release(pending, engine->filesystem);
+      pending = 0;
+      return;
+    }
+    if (pending->state == VSX_BITMAP_LOADER_DONE)
+    {
+      vsx_bitmap_loader::get_instance()->release(entry, engine->filesystem);
+      entry = pending;
+      pending = 0;
+      bitm.size_x = entry->bitmap.size_x;
+      bitm.size_y = entry->bitmap.size_y;
+      bitm.data = entry->bitmap.data;
       bitm.bpp = 4;
       bitm.bformat = GL_RGBA;
       bitm.valid = true;
       ++bitm.timestamp;
-      thread_state = 3;
       loading_done = true;
       bitmap_out->set_p(bitm);
     }
@@ -512,9 +438,11 @@ public:
   {
     if (param == (vsx_module_param_abs*)texture_out)
     {
+      if (pending && pending->priority < VSX_BITMAP_LOADER_PRIORITY_VISIBLE)
+        vsx_bitmap_loader::get_instance()->set_priority(pending, VSX_BITMAP_LOADER_PRIORITY_VISIBLE);
       if (texture_timestamp != bitm.timestamp && bitm.valid)
       {
-        texture->upload_ram_bitmap(&bitm,true);
+        texture->upload_ram_bitmap_cached(&bitm, entry->content_name, true);
         texture->valid = true;
         texture_out->set(texture);
         texture_timestamp = bitm.timestamp;
@@ -522,14 +450,21 @@ public:
     }
   }
   
+  void prefetch(const vsx_string& name, const vsx_string& value)
+  {
+    vsx_string filename = value;
+    if (name != "filename" || filename == current_filename) return;
+    if (!verify_filesuffix(filename, "jpg")) return;
+    prefetched.add(filename, engine->filesystem);
+  }
+
   void on_delete()
   {
-    if (thread_state == 1) 
-    pthread_join(worker_t, 0);
-    if (bitm.valid)
-    {
-      delete[] (vsx_bitmap_32bt*)bitm.data;
-    }
+    prefetched.clear(engine->filesystem);
+    vsx_bitmap_loader::get_instance()->release(pending, engine->filesystem);
+    vsx_bitmap_loader::get_instance()->release(entry, engine->filesystem);
+    texture->unload();
+    delete texture;
   }  
 };
 
@@ -552,108 +487,11 @@ class module_load_jpeg_alpha : public vsx_module
   // internal
   vsx_texture* texture;
 
-  // threading stuff
-  void* pti_l;
-
-  static void* jpeg_worker_v(void *ptr)
-  {
-    module_load_jpeg_alpha* mod = (module_load_jpeg_alpha*)ptr;
-
-    vsx_string ret;
-
-    CJPEGTest* cj = new CJPEGTest;
-    if
-    (
-     !(cj
-       ->LoadJPEG(
-       mod->current_filename,
-       ret,
-       mod->engine->filesystem
-     ))
-    )
-    {
-      mod->message = "module||"+ret+"\n"+((module_load_jpeg*)ptr)->current_filename;
-      mod->thread_state = -1;
-      delete cj;
-      return 0;
-    }
-
-    if (mod->current_alpha_filename != "")
-    {
-
-      CJPEGTest* cj_a = new CJPEGTest;
-      if
-      (
-        !(cj_a
-         ->LoadJPEG(
-         mod->current_alpha_filename,
-         ret,
-         mod->engine->filesystem
-       ))
-      )
-      {
-        mod->message = "module||"+ret+"\n"+((module_load_jpeg*)ptr)->current_filename;
-        mod->thread_state = -1;
-        delete cj;
-        delete cj_a;
-        return 0;
-      }
-
-      mod->bitm.size_x = cj->GetResX();
-      mod->bitm.size_y = cj->GetResY();
-
-      // allocate data in the vsx_bitmap
-      vsx_bitmap_32bt b_c = (mod->bitm.size_x) * (mod->bitm.size_y);
-
-      unsigned char* rgbcp = (unsigned char*)cj->m_pBuf;
-
-      unsigned char* acp = (unsigned char*)cj_a->m_pBuf;
-
-      mod->bitm.data = new vsx_bitmap_32bt[b_c*2];
-
-      for (unsigned long i = 0; i < b_c; ++i)
-      {
-        ((vsx_bitmap_32bt*)mod->bitm.data)[i] =
-            acp[i*3] << 24 |
-            rgbcp[i*3+2] << 16 |
-            rgbcp[i*3+1] << 8 |
-            rgbcp[i*3];
-      }
-
-      delete cj;
-      delete cj_a;
-
-      mod->thread_state = 2;
-      return 0;
-    }
-
-    // no alpha filename selected
-
-    mod->bitm.size_x = cj->GetResX();
-    mod->bitm.size_y = cj->GetResY();
-
-    // allocate data in the vsx_bitmap
-    vsx_bitmap_32bt b_c = (mod->bitm.size_x) * (mod->bitm.size_y);
-
-    unsigned char* rgbcp = (unsigned char*)cj->m_pBuf;
-
-    mod->bitm.data = new vsx_bitmap_32bt[b_c*2];
-
-    for (unsigned long i = 0; i < b_c; ++i)
-    {
-      ((vsx_bitmap_32bt*)mod->bitm.data)[i] =
-          0xFF000000 |
-          rgbcp[i*3+2] << 16 |
-          rgbcp[i*3+1] << 8 |
-          rgbcp[i*3];
-    }
-
-    delete cj;
-
-    mod->thread_state = 2;
-
-    return 0;
-  }
+  // owned by the shared loader, see module_load_png
+  vsx_bitmap_loader_entry* entry;
+  vsx_bitmap_loader_entry* pending;
+  // coming up in the timeline
+  vsx_bitmap_loader_prefetch prefetched;
 
 public:
   int m_type;
@@ -663,10 +501,6 @@ public:
 
   vsx_bitmap bitm;
   int bitm_timestamp; // keep track of the timestamp for the bitmap internally
-  int               thread_state;
-  bool              thread_working;
-  pthread_t         worker_t;
-  pthread_attr_t    worker_t_attr;
   int texture_timestamp;
 
   void module_info(vsx_module_info* info)
@@ -726,7 +560,8 @@ public:
     bitm.valid = false;
 
     bitmap_out->set_p(bitm);
-    thread_state = 0;
+    entry = 0;
+    pending = 0;
     texture_out = (vsx_module_param_texture*)out_parameters.create(VSX_MODULE_PARAM_ID_TEXTURE,"texture");
 
     texture = new vsx_texture;
@@ -738,18 +573,6 @@ public:
   {
     if (current_filename != filename_in->get())
     {
-      if (thread_state == -1)
-      {
-        message = "module||ok";
-      }
-
-      // time to decode a new jpg
-      if (thread_state == 1)
-      {
-        long* aa;
-        pthread_join(worker_t, (void **)&aa);
-      }
-
       if (!verify_filesuffix(filename_in->get(),"jpg"))
       {
         filename_in->set(current_filename);
@@ -761,17 +584,31 @@ public:
       current_filename = filename_in->get();
       current_alpha_filename = filename_alpha_in->get();
 
-      pthread_attr_init(&worker_t_attr);
-      thread_state = 1;
-      pthread_create(&(worker_t), &(worker_t_attr), &jpeg_worker_v, (void*)this);
+      vsx_bitmap_loader::get_instance()->release(pending, engine->filesystem);
+      pending = vsx_bitmap_loader::get_instance()->request(current_filename, engine->filesystem, VSX_BITMAP_LOADER_PRIORITY_NORMAL, current_alpha_filename);
+      prefetched.remove(current_filename, engine->filesystem, current_alpha_filename);
     }
-    if (thread_state == 2)
+    if (!pending)
+      return;
+    if (pending->state == VSX_BITMAP_LOADER_FAILED)
     {
+      message = "module||"+pending->error+"\n"+current_filename;
+      vsx_bitmap_loader::get_instance()->release(pending, engine->filesystem);
+      pending = 0;
+      return;
+    }
+    if (pending->state == VSX_BITMAP_LOADER_DONE)
+    {
+      vsx_bitmap_loader::get_instance()->release(entry, engine->filesystem);
+      entry = pending;
+      pending = 0;
+      bitm.size_x = entry->bitmap.size_x;
+      bitm.size_y = entry->bitmap.size_y;
+      bitm.data = entry->bitmap.data;
       bitm.bpp = 4;
       bitm.bformat = GL_RGBA;
       bitm.valid = true;
       ++bitm.timestamp;
-      thread_state = 3;
       loading_done = true;
       bitmap_out->set_p(bitm);
     }
@@ -781,9 +618,11 @@ public:
   {
     if (param == (vsx_module_param_abs*)texture_out)
     {
+      if (pending && pending->priority < VSX_BITMAP_LOADER_PRIORITY_VISIBLE)
+        vsx_bitmap_loader::get_instance()->set_priority(pending, VSX_BITMAP_LOADER_PRIORITY_VISIBLE);
       if (texture_timestamp != bitm.timestamp && bitm.valid)
       {
-        texture->upload_ram_bitmap(&bitm,true);
+        texture->upload_ram_bitmap_cached(&bitm, entry->content_name, true);
         texture->valid = true;
         texture_out->set(texture);
         texture_timestamp = bitm.timestamp;
@@ -791,15 +630,155 @@ public:
     }
   }
 
+  void prefetch(const vsx_string& name, const vsx_string& value)
+  {
+    // with the alpha file that's set now
+    vsx_string filename = value;
+    if (name != "filename_rgb" || filename == current_filename) return;
+    if (!verify_filesuffix(filename, "jpg")) return;
+    prefetched.add(filename, engine->filesystem, filename_alpha_in->get());
+  }
+
   void on_delete()
   {
-    if (thread_state == 1)
-    pthread_join(worker_t, 0);
-    if (bitm.valid)
+    prefetched.clear(engine->filesystem);
+    vsx_bitmap_loader::get_instance()->release(pending, engine->filesystem);
+    vsx_bitmap_loader::get_instance()->release(entry, engine->filesystem);
+    texture->unload();
+    delete texture;
+  }
+};
+
+
+//************************************************************************************
+//************************************************************************************
+//************************************************************************************
+//************************************************************************************
+
+
+// VXT LOADER --------------------------------------------------------------------------------------
+// .vxt files are made offline by tools/vsxtex, already flipped and mipmapped
+class module_load_vxt : public vsx_module
+{
+  // in
+  vsx_module_param_resource* filename_in;
+  // out
+  vsx_module_param_texture* texture_out;
+  // internal
+  vsx_texture* texture;
+  vsx_bitmap_loader_entry* entry;
+  vsx_bitmap_loader_entry* pending;
+  // coming up in the timeline
+  vsx_bitmap_loader_prefetch prefetched;
+  vsx_string current_filename;
+  bool uploaded;
+
+public:
+
+  void module_info(vsx_module_info* info)
+  {
+    info->identifier = "texture;loaders;vxt_tex_load";
+  #ifndef VSX_NO_CLIENT
+    info->description = "Loads a prebuilt texture\n(.vxt, made with vsxtex)\nincluding all mipmap levels.";
+    info->in_param_spec = "filename:resource";
+    info->out_param_spec = "texture:texture";
+    info->component_class = "texture";
+  #endif
+  }
+
+  void declare_params(vsx_module_param_list& in_parameters, vsx_module_param_list& out_parameters)
+  {
+    loading_done = false;
+    filename_in = (vsx_module_param_resource*)in_parameters.create(VSX_MODULE_PARAM_ID_RESOURCE,"filename");
+    filename_in->set("");
+    current_filename = "";
+    texture_out = (vsx_module_param_texture*)out_parameters.create(VSX_MODULE_PARAM_ID_TEXTURE,"texture");
+    texture_out->valid = false;
+    entry = 0;
+    pending = 0;
+    uploaded = false;
+    texture = new vsx_texture;
+    texture->locked = true;
+    texture->init_opengl_texture();
+  }
+
+  void run()
+  {
+    if (current_filename != filename_in->get())
+    {
+      if (!verify_filesuffix(filename_in->get(),"vxt"))
+      {
+        filename_in->set(current_filename);
+        message = "module||ERROR! This is not a VXT texture file!";
+        return;
+      }
+      message = "module||ok";
+      current_filename = filename_in->get();
+      vsx_bitmap_loader::get_instance()->release(pending, engine->filesystem);
+      pending = vsx_bitmap_loader::get_instance()->request(current_filename, engine->filesystem);
+      prefetched.remove(current_filename, engine->filesystem);
+    }
+    if (!pending)
+      return;
+    if (pending->state == VSX_BITMAP_LOADER_FAILED)
+    {
+      message = "module||"+pending->error+"\n"+current_filename;
+      vsx_bitmap_loader::get_instance()->release(pending, engine->filesystem);
+      pending = 0;
+      return;
+    }
+    if (pending->state == VSX_BITMAP_LOADER_DONE)
+    {
+      vsx_bitmap_loader::get_instance()->release(entry, engine->filesystem);
+      entry = pending;
+      pending = 0;
+      uploaded = false;
+      loading_done = true;
+    }
+  }
+
+  void output(vsx_module_param_abs* param)
+  {
+    if (param == (vsx_module_param_abs*)texture_out)
     {
-      delete[] (vsx_bitmap_32bt*)bitm.data;
+      if (pending && pending->priority < VSX_BITMAP_LOADER_PRIORITY_VISIBLE)
+        vsx_bitmap_loader::get_instance()->set_priority(pending, VSX_BITMAP_LOADER_PRIORITY_VISIBLE);
+      if (entry && !uploaded)
+      {
+        texture->upload_container(entry->container);
+        texture_out->set(texture);
+        uploaded = true;
+      }
     }
   }
+
+  void stop()
+  {
+    texture->unload();
+  }
+
+  void start()
+  {
+    texture->init_opengl_texture();
+    uploaded = false;
+  }
+
+  void prefetch(const vsx_string& name, const vsx_string& value)
+  {
+    vsx_string filename = value;
+    if (name != "filename" || filename == current_filename) return;
+    if (!verify_filesuffix(filename, "vxt")) return;
+    prefetched.add(filename, engine->filesystem);
+  }
+
+  void on_delete()
+  {
+    prefetched.clear(engine->filesystem);
+    vsx_bitmap_loader::get_instance()->release(pending, engine->filesystem);
+    vsx_bitmap_loader::get_instance()->release(entry, engine->filesystem);
+    texture->unload();
+    delete texture;
+  }
 };
 
 
@@ -854,6 +833,8 @@ vsx_module* create_new_module(unsigned long module, void* args)
     }
     case 6:
     return (vsx_module*)(new texture_loaders_bitmap2texture);
+    case 7:
+    return (vsx_module*)(new module_load_vxt);
   };
   return 0;
 }
@@ -864,10 +845,11 @@ void destroy_module(vsx_module* m,unsigned long module) {
     case 2: case 3: delete (module_load_jpeg*)m; break;
     case 4: case 5: delete (module_load_jpeg_alpha*)m; break;
     case 6: delete (texture_loaders_bitmap2texture*)m; break;
+    case 7: delete (module_load_vxt*)m; break;
   }
 }
 
 unsigned long get_num_modules() {
   // we have only one module. it's id is 0
-  return 7;
+  return 8;
 }  
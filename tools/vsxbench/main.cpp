@@ -0,0 +1,1290 @@
+/**
+* Project: VSXu: Realtime modular visual programming language, music/audio visualizer.
+*
+* This file is part of Vovoid VSXu.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Public License (GPL)
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+// Headless benchmarks for the CPU heavy module kernels.
+// Runs without OpenGL so it can be used on build machines.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include "vsx_string.h"
+#include "vsx_timer.h"
+#include "vsx_bitmap.h"
+#include "vsx_thread_pool.h"
+#include "vsx_mesh_kernels.h"
+#include "vsx_sort.h"
+#include "vsx_mesh_spatial.h"
+#include "vsx_engine.h"
+#include "vsx_param_sequence.h"
+#include "bitmap.modifiers/particle_kernels.h"
+#include "mesh.importers.obj/obj_parser.h"
+#include "mesh.generators.ocean/vsx_ocean.h"
+#include "mesh.generators/parametric_surface.h"
+#include "mesh.generators/supershape.h"
+// defines min/max macros, keep it last
+#include "bitmap.texgen/blend_kernels.h"
+
+const char* blend_names[] =
+{
+  "normal", "lighten", "darken", "multiply", "average", "add", "subtract",
+  "difference", "negation", "screen", "exclusion", "overlay", "soft_light",
+  "hard_light", "color_dodge", "color_burn", "linear_dodge", "linear_burn",
+  "linear_light", "vivid_light", "pin_light", "hard_mix", "reflect", "glow",
+  "phoenix"
+};
+
+void blend_rows_task(void* ptr, size_t start, size_t end)
+{
+  blend_composite_rows(*((blend_composite*)ptr), start, end);
+}
+
+// blend_row (simd where there is a kernel) against the table for every mode
+// and a range of opacities, over all src / base byte pairs plus a tail that
+// isn't a multiple of 16
+static bool blend_check()
+{
+  const size_t num = 256 * 256 + 13;
+  std::vector<uint8> src(num), base(num), dst_lut(num), dst(num);
+  for (size_t i = 0; i < num; i++)
+  {
+    src[i] = (uint8)(i >> 8);
+    base[i] = (uint8)i;
+  }
+  float opacities[] = {0.0f, 0.1f, 0.25f, 1.0f / 3.0f, 0.5f, 0.75f, 0.9f, 0.999f, 1.0f};
+  blend_lut lut;
+  bool ok = true;
+  for (size_t o = 0; o < sizeof(opacities) / sizeof(opacities[0]); o++)
+  for (int mode = 0; mode < 25; mode++)
+  {
+    lut.build(mode, opacities[o]);
+    blend_row_lut(lut, &dst_lut[0], &src[0], &base[0], num);
+    blend_row(lut, &dst[0], &src[0], &base[0], num);
+    for (size_t i = 0; i < num; i++)
+    {
+      if (dst[i] != dst_lut[i])
+      {
+        printf("MISMATCH %s @%g: src %d base %d gives %d, table %d\n", blend_names[mode], opacities[o], src[i], base[i], dst[i], dst_lut[i]);
+        ok = false;
+        break;
+      }
+    }
+  }
+  printf("blend_row against the table, 25 modes, %d opacities: %s\n", (int)(sizeof(opacities) / sizeof(opacities[0])), ok ? "ok" : "MISMATCH");
+  return ok;
+}
+
+// bitmaps;filters;bitm_blend_* - one full blend of two size x size bitmaps
+// per iteration, first the plain table kernel on one thread, then the
+// module code path (simd kernels split over the thread pool)
+int bench_bitmap_blend(unsigned long size, int iterations)
+{
+  bool ok = blend_check();
+  unsigned long num = size * size;
+  vsx_bitmap_32bt* src1 = new vsx_bitmap_32bt[num];
+  vsx_bitmap_32bt* src2 = new vsx_bitmap_32bt[num];
+  vsx_bitmap_32bt* dst = new vsx_bitmap_32bt[num];
+  vsx_bitmap_32bt* zero = new vsx_bitmap_32bt[size];
+  memset(zero, 0, size * 4);
+  for (unsigned long i = 0; i < num; i++)
+  {
+    src1[i] = (vsx_bitmap_32bt)rand() * 2654435761u;
+    src2[i] = (vsx_bitmap_32bt)rand() * 2246822519u;
+  }
+
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+  printf("bitmaps;filters blend %lux%lu, %d iterations, %d pool threads\n", size, size, iterations, (int)pool->get_num_threads());
+  printf("%-14s %12s %12s %12s %8s\n", "mode", "table ms", "simd ms", "pooled ms", "speedup");
+
+  vsx_timer timer;
+  blend_lut lut;
+  float opacities[] = {1.0f, 0.5f};
+  for (int o = 0; o < 2; o++)
+  for (int mode = 0; mode < 25; mode++)
+  {
+    lut.build(mode, opacities[o]);
+
+    timer.start();
+    for (int i = 0; i < iterations; i++)
+      blend_row_lut(lut, (uint8*)dst, (const uint8*)src2, (const uint8*)src1, num * 4);
+    double t_lut = timer.dtime() * 1000.0 / iterations;
+
+    for (int i = 0; i < iterations; i++)
+      blend_row(lut, (uint8*)dst, (const uint8*)src2, (const uint8*)src1, num * 4);
+    double t_simd = timer.dtime() * 1000.0 / iterations;
+
+    blend_composite c;
+    c.dst = dst; c.dst_x = size; c.dst_y = size;
+    c.src1 = src1; c.src1_x = size; c.src1_y = size; c.ofs1_x = 0; c.ofs1_y = 0;
+    c.src2 = src2; c.src2_x = size; c.src2_y = size; c.ofs2_x = 0; c.ofs2_y = 0;
+    c.lut = &lut;
+    c.zero_row = zero;
+    timer.dtime();
+    for (int i = 0; i < iterations; i++)
+      pool->parallel_for(size, 16, &blend_rows_task, (void*)&c);
+    double t_pool = timer.dtime() * 1000.0 / iterations;
+
+    vsx_string name = vsx_string(blend_names[mode]) + (o ? "@0.5" : "");
+    printf("%-14s %12.3f %12.3f %12.3f %7.1fx\n", name.c_str(), t_lut, t_simd, t_pool, t_lut / t_pool);
+  }
+
+  delete[] src1;
+  delete[] src2;
+  delete[] dst;
+  delete[] zero;
+  return ok ? 0 : 1;
+}
+
+// particlesystems;generators;bitmap2particlesystem - a size x size bitmap
+// where about a third of the pixels are dark. The plain per pixel loop is
+// the reference, the kernel output is compared against it.
+bool particles_equal(vsx_particle* a, vsx_particle* b, size_t count)
+{
+  for (size_t i = 0; i < count; i++)
+  {
+    if (memcmp(&a[i].color, &b[i].color, sizeof(vsx_color)) != 0 || a[i].size != b[i].size ||
+        memcmp(&a[i].pos, &b[i].pos, sizeof(vsx_vector)) != 0)
+      return false;
+  }
+  return true;
+}
+
+int bench_bitmap_particles(unsigned long size, int iterations)
+{
+  unsigned long num = size * size;
+  vsx_bitmap_32bt* bitmap = new vsx_bitmap_32bt[num];
+  vsx_vector* grid = new vsx_vector[num];
+  for (unsigned long i = 0; i < num; i++)
+  {
+    bitmap[i] = (vsx_bitmap_32bt)rand() * 2654435761u;
+    if (i % 3 == 0)
+      bitmap[i] &= 0xFF020102; // dark, alpha doesn't count
+    grid[i].x = (float)(i % size);
+    grid[i].y = 0;
+    grid[i].z = (float)(i / size);
+  }
+  vsx_particle* reference = (vsx_particle*)calloc(num, sizeof(vsx_particle));
+  vsx_particle* out = (vsx_particle*)calloc(num, sizeof(vsx_particle));
+  size_t* row_offsets = new size_t[size + 1];
+
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+  printf("particlesystems;generators bitmap2particlesystem %lux%lu, %d iterations, %d pool threads\n", size, size, iterations, (int)pool->get_num_threads());
+  printf("%-10s %12s %12s %12s %10s %8s %s\n", "mode", "plain ms", "simd ms", "pooled ms", "particles", "speedup", "result");
+
+  bitmap_particles_job j;
+  j.data = bitmap;
+  j.size_x = size;
+  j.size_y = size;
+  j.grid = grid;
+  j.blobsize = 0.1f;
+  j.write_pos = true;
+  j.row_offsets = row_offsets;
+
+  vsx_timer timer;
+  int errors = 0;
+  for (int compact = 0; compact < 2; compact++)
+  {
+    j.compact = compact != 0;
+
+    timer.start();
+    size_t ref_count = 0;
+    for (int i = 0; i < iterations; i++)
+    {
+      ref_count = 0;
+      for (unsigned long p = 0; p < num; p++)
+      {
+        if (j.compact && !bitmap_particles_lit(bitmap[p]))
+          continue;
+        bitmap_particles_write(j, &reference[ref_count], p);
+        reference[ref_count].pos = grid[p];
+        ref_count++;
+      }
+    }
+    double t_plain = timer.dtime() * 1000.0 / iterations;
+
+    size_t count = 0;
+    j.particles = out;
+    for (int i = 0; i < iterations; i++)
+      count = bitmap_particles_convert(j, 0);
+    double t_simd = timer.dtime() * 1000.0 / iterations;
+    bool ok = count == ref_count && particles_equal(reference, out, count);
+
+    memset(out, 0, num * sizeof(vsx_particle));
+    timer.dtime();
+    for (int i = 0; i < iterations; i++)
+      count = bitmap_particles_convert(j, pool);
+    double t_pool = timer.dtime() * 1000.0 / iterations;
+    ok &= count == ref_count && particles_equal(reference, out, count);
+    if (!ok)
+      errors++;
+
+    printf("%-10s %12.3f %12.3f %12.3f %10d %7.1fx %s\n", compact ? "skip_dark" : "all", t_plain, t_simd, t_pool, (int)count, t_plain / t_pool, ok ? "ok" : "MISMATCH");
+  }
+
+  delete[] bitmap;
+  delete[] grid;
+  delete[] row_offsets;
+  free(reference);
+  free(out);
+  return errors ? 1 : 0;
+}
+
+// vsx_mesh_kernels - a side x side grid of bumpy quads, two faces each.
+// The serial scatter loop the mesh modules used to have is the reference
+// for the vertex normals.
+int bench_mesh_kernels(unsigned long side, int iterations)
+{
+  vsx_mesh_data data;
+  unsigned long row = side + 1;
+  unsigned long num_vertices = row * row;
+  for (unsigned long i = 0; i < num_vertices; i++)
+  {
+    float x = (float)(i % row);
+    float y = (float)(i / row);
+    data.vertices[i] = vsx_vector(x, y, sinf(x * 0.13f) * cosf(y * 0.07f) * 4.0f + (float)(rand() % 100) * 0.001f);
+    data.vertex_tex_coords[i] = vsx_tex_coord__(x / side, y / side);
+  }
+  for (unsigned long y = 0; y < side; y++)
+  for (unsigned long x = 0; x < side; x++)
+  {
+    vsx_face f;
+    unsigned long v = y * row + x;
+    f.a = v; f.b = v + 1; f.c = v + row;
+    data.faces.push_back(f);
+    f.a = v + 1; f.b = v + row + 1; f.c = v + row;
+    data.faces.push_back(f);
+  }
+  size_t num_faces = data.faces.size();
+
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+  printf("vsx_mesh_kernels %d faces, %d vertices, %d iterations, %d pool threads\n", (int)num_faces, (int)num_vertices, iterations, (int)pool->get_num_threads());
+  printf("%-16s %12s %12s %8s %s\n", "pass", "serial ms", "kernels ms", "speedup", "result");
+
+  vsx_timer timer;
+  vsx_vector* reference = new vsx_vector[num_vertices];
+  vsx_vector* vp = data.vertices.get_pointer();
+  vsx_face* fp = data.faces.get_pointer();
+  timer.start();
+  for (int it = 0; it < iterations; it++)
+  {
+    memset((void*)reference, 0, sizeof(vsx_vector) * num_vertices);
+    for (size_t i = 0; i < num_faces; i++)
+    {
+      vsx_vector n;
+      n.assign_face_normal(&vp[fp[i].a], &vp[fp[i].b], &vp[fp[i].c]);
+      reference[fp[i].a] += n;
+      reference[fp[i].b] += n;
+      reference[fp[i].c] += n;
+    }
+    for (size_t i = 0; i < num_vertices; i++)
+      reference[i].normalize();
+  }
+  double t_serial = timer.dtime() * 1000.0 / iterations;
+
+  vsx_mesh_kernels kernels;
+  kernels.calculate_vertex_normals(&data);
+  double t_first = timer.dtime() * 1000.0;
+  for (int it = 0; it < iterations; it++)
+    kernels.calculate_vertex_normals(&data);
+  double t_kernels = timer.dtime() * 1000.0 / iterations;
+  float max_error = 0.0f;
+  vsx_vector* np = data.vertex_normals.get_pointer();
+  for (size_t i = 0; i < num_vertices; i++)
+  {
+    vsx_vector d = np[i] - reference[i];
+    float e = d.length();
+    if (e > max_error)
+      max_error = e;
+  }
+  bool ok = data.vertex_normals.size() == num_vertices && max_error < 1e-4f;
+  printf("%-16s %12.3f %12.3f %7.1fx %s (max error %g)\n", "vertex_normals", t_serial, t_kernels, t_serial / t_kernels, ok ? "ok" : "MISMATCH", max_error);
+  printf("%-16s %12s %12.3f\n", " first call", "", t_first);
+
+  timer.dtime();
+  for (int it = 0; it < iterations; it++)
+    data.calculate_face_centers();
+  t_serial = timer.dtime() * 1000.0 / iterations;
+  for (int it = 0; it < iterations; it++)
+    kernels.calculate_face_centers(&data);
+  t_kernels = timer.dtime() * 1000.0 / iterations;
+  printf("%-16s %12.3f %12.3f %7.1fx\n", "face_centers", t_serial, t_kernels, t_serial / t_kernels);
+
+  for (int it = 0; it < iterations; it++)
+    kernels.calculate_face_normals(&data);
+  t_kernels = timer.dtime() * 1000.0 / iterations;
+  bool faces_ok = data.face_normals.size() == num_faces;
+  for (size_t i = 0; faces_ok && i < num_faces; i += 997)
+  {
+    vsx_vector n;
+    n.assign_face_normal(&vp[fp[i].a], &vp[fp[i].b], &vp[fp[i].c]);
+    n.normalize();
+    faces_ok = (n - data.face_normals[i]).length() < 1e-5f;
+  }
+  ok &= faces_ok;
+  printf("%-16s %12s %12.3f %8s %s\n", "face_normals", "", t_kernels, "", faces_ok ? "ok" : "MISMATCH");
+
+  vsx_array<vsx_quaternion> tangents;
+  for (int it = 0; it < iterations; it++)
+    ok &= kernels.calculate_tangents(&data, tangents);
+  t_kernels = timer.dtime() * 1000.0 / iterations;
+  // the grid is textured along x, so tangents point roughly that way
+  bool tangents_ok = tangents.size() == num_vertices && tangents[num_vertices / 2].x > 0.5f && tangents[num_vertices / 2].w != 0.0f;
+  ok &= tangents_ok;
+  printf("%-16s %12s %12.3f %8s %s\n", "tangents", "", t_kernels, "", tangents_ok ? "ok" : "MISMATCH");
+
+  vsx_vector lo, hi;
+  for (int it = 0; it < iterations; it++)
+    kernels.calculate_bounds(&data, lo, hi);
+  t_kernels = timer.dtime() * 1000.0 / iterations;
+  bool bounds_ok = lo.x == 0.0f && lo.y == 0.0f && hi.x == (float)side && hi.y == (float)side;
+  ok &= bounds_ok;
+  printf("%-16s %12s %12.3f %8s %s\n", "bounds", "", t_kernels, "", bounds_ok ? "ok" : "MISMATCH");
+
+  delete[] reference;
+  return ok ? 0 : 1;
+}
+
+class sort_key_less
+{
+public:
+  const float* keys;
+  bool operator()(unsigned int a, unsigned int b) const
+  {
+    return keys[a] < keys[b];
+  }
+};
+
+static bool sort_check(const float* keys, const unsigned int* order, size_t count)
+{
+  std::vector<bool> seen(count, false);
+  for (size_t i = 0; i < count; i++)
+  {
+    if (order[i] >= count || seen[order[i]])
+      return false;
+    seen[order[i]] = true;
+    if (i && keys[order[i - 1]] > keys[order[i]])
+      return false;
+  }
+  return true;
+}
+
+// depth sorting like mesh_transparency_render: count random points
+// projected on a view direction that turns a little every iteration.
+// std::sort on the indices, then vsx_sort_float from scratch every frame
+// and keeping its order between frames - random points reorder too much
+// for anything but radix there. Then inputs made for each of the coherent
+// paths, checking vsx_sort_float picks it.
+int bench_sort(size_t count, int iterations)
+{
+  std::vector<vsx_vector> points(count);
+  srand(1);
+  for (size_t i = 0; i < count; i++)
+  {
+    points[i].x = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+    points[i].y = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+    points[i].z = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+  }
+  std::vector<float> keys(count);
+  std::vector<unsigned int> reference(count);
+
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+  printf("vsx_sort_float %d keys, %d iterations, %d pool threads\n", (int)count, iterations, (int)pool->get_num_threads());
+  printf("%-16s %12s %s\n", "pass", "ms", "result");
+
+  vsx_timer timer;
+  double t_keys = 0.0;
+  double t_sort = 0.0;
+  sort_key_less less;
+  less.keys = &keys[0];
+  bool ok = true;
+  for (int it = 0; it < iterations; it++)
+  {
+    vsx_vector view(cosf(0.002f * it), sinf(0.002f * it), 0.3f);
+    timer.start();
+    for (size_t i = 0; i < count; i++)
+      keys[i] = points[i].dot_product(&view);
+    t_keys += timer.dtime();
+    for (size_t i = 0; i < count; i++)
+      reference[i] = (unsigned int)i;
+    std::sort(reference.begin(), reference.end(), less);
+    t_sort += timer.dtime();
+  }
+  printf("%-16s %12.3f\n", "std::sort", t_sort * 1000.0 / iterations);
+
+  const char* pass_names[] = { "radix", "coherent" };
+  for (int pass = 0; pass < 2; pass++)
+  {
+    vsx_sort_float sorter;
+    int methods[4] = { 0, 0, 0, 0 };
+    bool pass_ok = true;
+    t_sort = 0.0;
+    for (int it = 0; it < iterations; it++)
+    {
+      vsx_vector view(cosf(0.002f * it), sinf(0.002f * it), 0.3f);
+      for (size_t i = 0; i < count; i++)
+        keys[i] = points[i].dot_product(&view);
+      if (pass == 0)
+        sorter.reset();
+      timer.start();
+      const unsigned int* order = sorter.sort(&keys[0], count);
+      t_sort += timer.dtime();
+      methods[sorter.get_last_method()]++;
+      pass_ok &= sort_check(&keys[0], order, count);
+    }
+    ok &= pass_ok;
+    printf("%-16s %12.3f %s (unchanged %d, insertion %d, merge %d, radix %d)\n", pass_names[pass], t_sort * 1000.0 / iterations, pass_ok ? "ok" : "MISMATCH", methods[VSX_SORT_UNCHANGED], methods[VSX_SORT_INSERTION], methods[VSX_SORT_MERGE], methods[VSX_SORT_RADIX]);
+  }
+
+  // the cases the coherent paths are for, from the order of the last
+  // frame: the same keys again, neighbours swapped all over (camera moved a
+  // little), a few items moved far (objects teleporting)
+  const char* method_names[] = { "unchanged", "insertion", "merge", "radix" };
+  std::vector<float> base_keys(keys);
+  std::vector<unsigned int> base_order(count);
+  for (int c = 0; c < 3; c++)
+  {
+    vsx_sort_float sorter;
+    const unsigned int* order = sorter.sort(&base_keys[0], count);
+    memcpy(&base_order[0], order, count * sizeof(unsigned int));
+    keys = base_keys;
+    int expected = VSX_SORT_UNCHANGED;
+    if (c == 1)
+    {
+      // one swap in every 32, with 32 or fewer breaks it would be a merge
+      if (count / 32 <= 32)
+        continue;
+      for (size_t p = 0; p + 32 <= count; p += 32)
+      {
+        size_t q = p + rand() % 31;
+        std::swap(keys[base_order[q]], keys[base_order[q + 1]]);
+      }
+      expected = VSX_SORT_INSERTION;
+    }
+    if (c == 2)
+    {
+      // from the middle to either end, so every one breaks a run
+      if (count < 16)
+        continue;
+      for (int i = 0; i < 10; i++)
+        keys[base_order[count / 4 + rand() % (count / 2)]] = (i & 1) ? 1e10f : -1e10f;
+      expected = VSX_SORT_MERGE;
+    }
+    timer.start();
+    order = sorter.sort(&keys[0], count);
+    double t = timer.dtime();
+    int method = sorter.get_last_method();
+    bool case_ok = method == expected && sort_check(&keys[0], order, count);
+    ok &= case_ok;
+    printf("%-16s %12.3f %s (%s)\n", method_names[expected], t * 1000.0, case_ok ? "ok" : "MISMATCH", method_names[method]);
+  }
+  keys = base_keys;
+
+  // descending and a few special values
+  float special[] = { 0.0f, -0.0f, 1.0f, -1.0f, 1e30f, -1e30f, 1e-30f, -1e-30f, 2.0f, -2.0f };
+  vsx_sort_float sorter;
+  const unsigned int* order = sorter.sort(special, 10, true);
+  bool special_ok = true;
+  for (size_t i = 1; i < 10; i++)
+    special_ok &= special[order[i - 1]] >= special[order[i]];
+  ok &= special_ok;
+  printf("%-16s %12s %s\n", "descending", "", special_ok ? "ok" : "MISMATCH");
+  return ok ? 0 : 1;
+}
+
+// mesh;importers;obj_importer - a side x side grid with texture coords and
+// normals written as OBJ text (quads, so the fan split is covered too),
+// parsed line by line with sscanf/atof like the old loader did and then
+// with obj_parser_load in both modes
+int bench_obj(unsigned long side, int iterations)
+{
+  std::vector<char> text;
+  char line[256];
+  unsigned long n = side + 1;
+  for (unsigned long y = 0; y < n; y++)
+    for (unsigned long x = 0; x < n; x++)
+    {
+      int len = sprintf(line, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn 0 0 1\n", (float)x * 0.5f, (float)y * -0.25f, (float)((x * 7 + y * 3) % 11) * 0.1f, (float)x / side, (float)y / side);
+      text.insert(text.end(), line, line + len);
+    }
+  for (unsigned long y = 0; y < side; y++)
+    for (unsigned long x = 0; x < side; x++)
+    {
+      unsigned long v = y * n + x + 1;
+      int len = sprintf(line, "f %lu/%lu/%lu %lu/%lu/%lu %lu/%lu/%lu %lu/%lu/%lu\n", v, v, v, v + 1, v + 1, v + 1, v + n + 1, v + n + 1, v + n + 1, v + n, v + n, v + n);
+      text.insert(text.end(), line, line + len);
+    }
+  // a relative face and a comment at the end
+  const char* tail = "# done\nf -1/-1/-1 -2/-2/-2 -3/-3/-3\n";
+  text.insert(text.end(), tail, tail + strlen(tail));
+  size_t num_vertices = n * n;
+  size_t num_faces = side * side * 2 + 1;
+
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+  printf("obj_parser %d KB, %d vertices, %d faces, %d iterations, %d pool threads\n", (int)(text.size() / 1024), (int)num_vertices, (int)num_faces, iterations, (int)pool->get_num_threads());
+  printf("%-16s %12s %s\n", "pass", "ms", "result");
+
+  vsx_timer timer;
+  timer.start();
+  size_t reference_vertices = 0;
+  std::vector<char> line_buf;
+  for (int it = 0; it < iterations; it++)
+  {
+    std::vector<vsx_vector> positions;
+    const char* p = &text[0];
+    const char* end = p + text.size();
+    while (p < end)
+    {
+      const char* e = p;
+      while (e < end && *e != '\n')
+        e++;
+      line_buf.assign(p, e);
+      line_buf.push_back(0);
+      float x, y, z;
+      if (line_buf[0] == 'v' && line_buf[1] == ' ' && sscanf(&line_buf[2], "%f %f %f", &x, &y, &z) == 3)
+        positions.push_back(vsx_vector(x, y, z));
+      p = e + 1;
+    }
+    reference_vertices = positions.size();
+  }
+  printf("%-16s %12.3f %s\n", "sscanf (v only)", timer.dtime() * 1000.0 / iterations, reference_vertices == num_vertices ? "ok" : "MISMATCH");
+
+  bool ok = true;
+  const char* pass_names[] = { "positions only", "preserve uv" };
+  for (int pass = 0; pass < 2; pass++)
+  {
+    vsx_mesh_data data;
+    timer.dtime();
+    bool loaded = true;
+    for (int it = 0; it < iterations; it++)
+      loaded &= obj_parser_load(&text[0], text.size(), pass == 1, &data, pool);
+    double t = timer.dtime() * 1000.0 / iterations;
+    bool pass_ok = loaded && data.vertices.size() == num_vertices && data.faces.size() == num_faces;
+    if (pass == 1)
+      pass_ok &= data.vertex_tex_coords.size() == num_vertices && data.vertex_normals.size() == num_vertices;
+    // every grid vertex where it was written
+    for (size_t i = 0; pass_ok && i < num_faces - 1; i += 97)
+    {
+      vsx_face& f = data.faces[i];
+      unsigned int corner = pass == 1 ? f.a : f.c;
+      unsigned long x = (unsigned long)(data.vertices[corner].x * 2.0f + 0.5f);
+      unsigned long y = (unsigned long)(data.vertices[corner].y * -4.0f + 0.5f);
+      pass_ok = x < n && y < n && fabs(data.vertices[corner].z - (float)((x * 7 + y * 3) % 11) * 0.1f) < 1e-5f;
+      if (pass_ok && pass == 1)
+        pass_ok = fabs(data.vertex_tex_coords[corner].s - (float)x / side) < 1e-5f && data.vertex_normals[corner].z == 1.0f;
+    }
+    // f -1 -2 -3 is the last three vertices
+    vsx_face& last = data.faces[num_faces - 1];
+    unsigned int first_corner = pass == 1 ? last.a : last.c;
+    pass_ok &= data.vertices[first_corner].x == data.vertices[num_vertices - 1].x && data.vertices[first_corner].y == data.vertices[num_vertices - 1].y;
+    ok &= pass_ok;
+    printf("%-16s %12.3f %s\n", pass_names[pass], t, pass_ok ? "ok" : "MISMATCH");
+  }
+
+  // the number parser against strtod
+  const char* numbers[] = { "0", "-0.5", "1e3", "+2.25E-2", "123456.789", "0.000001234", "-7.", ".5", "3.4028234e38", "1e-40", "98765432109876543210" };
+  bool numbers_ok = true;
+  for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++)
+  {
+    float f;
+    obj_parser_float(numbers[i], numbers[i] + strlen(numbers[i]), f);
+    float r = (float)strtod(numbers[i], 0);
+    if (fabs(f - r) > fabs(r) * 1e-6f)
+    {
+      printf("  %s: %g, expected %g\n", numbers[i], f, r);
+      numbers_ok = false;
+    }
+  }
+  ok &= numbers_ok;
+  printf("%-16s %12s %s\n", "numbers", "", numbers_ok ? "ok" : "MISMATCH");
+  return ok ? 0 : 1;
+}
+
+// segment / triangle, both sides, same as the bvh but no tree
+static float spatial_linear_ray(const std::vector<vsx_vector>& v, const std::vector<vsx_face>& f, vsx_vector o, vsx_vector d)
+{
+  float best = FLT_MAX;
+  for (size_t i = 0; i < f.size(); i++)
+  {
+    // vsx_vector's operators aren't const
+    vsx_vector a = v[f[i].a];
+    vsx_vector b = v[f[i].b];
+    vsx_vector c = v[f[i].c];
+    vsx_vector e1 = b - a;
+    vsx_vector e2 = c - a;
+    vsx_vector p;
+    p.cross(d, e2);
+    float det = e1.dot_product(&p);
+    if (fabsf(det) < 1e-12f)
+      continue;
+    vsx_vector s = o - a;
+    float u = s.dot_product(&p) / det;
+    vsx_vector q;
+    q.cross(s, e1);
+    float w = d.dot_product(&q) / det;
+    float t = e2.dot_product(&q) / det;
+    if (u >= 0.0f && w >= 0.0f && u + w <= 1.0f && t >= 0.0f && t <= 1.0f && t < best)
+      best = t;
+  }
+  return best;
+}
+
+// particles;modifiers;mesh_collider and the closest vertex picker: count
+// particle steps cast against a bumpy side x side grid, and the nearest
+// vertex to as many points. A linear scan over the first few queries for
+// reference, all of them through the bvh / point grid.
+int bench_spatial(size_t count, unsigned long side, int iterations)
+{
+  std::vector<vsx_vector> v;
+  std::vector<vsx_face> f;
+  for (unsigned long y = 0; y <= side; y++)
+    for (unsigned long x = 0; x <= side; x++)
+    {
+      float fx = (float)x / side * 2.0f - 1.0f;
+      float fz = (float)y / side * 2.0f - 1.0f;
+      v.push_back(vsx_vector(fx, 0.2f * sinf(fx * 7.0f) * cosf(fz * 5.0f), fz));
+    }
+  for (unsigned long y = 0; y < side; y++)
+    for (unsigned long x = 0; x < side; x++)
+    {
+      vsx_face a;
+      a.a = y * (side + 1) + x;
+      a.b = a.a + 1;
+      a.c = a.a + side + 1;
+      f.push_back(a);
+      a.a = a.b;
+      a.b = a.c + 1;
+      f.push_back(a);
+    }
+
+  srand(1);
+  std::vector<vsx_vector> origins(count);
+  std::vector<vsx_vector> directions(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    origins[i] = vsx_vector((float)rand() / RAND_MAX * 2.2f - 1.1f, (float)rand() / RAND_MAX * 0.6f - 0.3f, (float)rand() / RAND_MAX * 2.2f - 1.1f);
+    directions[i] = vsx_vector((float)rand() / RAND_MAX * 0.1f - 0.05f, (float)rand() / RAND_MAX * 0.2f - 0.1f, (float)rand() / RAND_MAX * 0.1f - 0.05f);
+  }
+  std::vector<vsx_mesh_spatial_hit> hits(count);
+
+  vsx_thread_pool* pool = vsx_thread_pool::get_instance();
+  printf("vsx_mesh_spatial %d faces, %d queries, %d iterations, %d pool threads\n", (int)f.size(), (int)count, iterations, (int)pool->get_num_threads());
+  printf("%-16s %12s %s\n", "pass", "ms", "result");
+
+  vsx_timer timer;
+  size_t reference = count < 200 ? count : 200;
+  timer.start();
+  std::vector<float> linear(reference);
+  for (size_t i = 0; i < reference; i++)
+    linear[i] = spatial_linear_ray(v, f, origins[i], directions[i]);
+  double t_linear = timer.dtime() * count / reference;
+  printf("%-16s %12.3f (estimated from %d)\n", "ray linear", t_linear * 1000.0, (int)reference);
+
+  vsx_bvh bvh;
+  double t_build = 0.0;
+  double t_query = 0.0;
+  for (int it = 0; it < iterations; it++)
+  {
+    timer.start();
+    bvh.build(&v[0], v.size(), &f[0], f.size());
+    t_build += timer.dtime();
+    bvh.raycast_batch(&origins[0], &directions[0], count, 1.0f, &hits[0]);
+    t_query += timer.dtime();
+  }
+  bool ok = true;
+  int hit_count = 0;
+  for (size_t i = 0; i < reference; i++)
+    ok &= linear[i] == FLT_MAX ? hits[i].distance == FLT_MAX : fabsf(linear[i] - hits[i].distance) < 1e-4f;
+  for (size_t i = 0; i < count; i++)
+    hit_count += hits[i].distance != FLT_MAX;
+  printf("%-16s %12.3f %d nodes\n", "bvh build", t_build * 1000.0 / iterations, (int)bvh.get_num_nodes());
+  printf("%-16s %12.3f %s (%d hits)\n", "bvh raycast", t_query * 1000.0 / iterations, ok ? "ok" : "MISMATCH", hit_count);
+
+  timer.start();
+  std::vector<unsigned int> closest(reference);
+  for (size_t i = 0; i < reference; i++)
+  {
+    float best = FLT_MAX;
+    for (size_t k = 0; k < v.size(); k++)
+    {
+      vsx_vector d = v[k] - origins[i];
+      float d2 = d.dot_product(&d);
+      if (d2 < best)
+      {
+        best = d2;
+        closest[i] = (unsigned int)k;
+      }
+    }
+  }
+  t_linear = timer.dtime() * count / reference;
+  printf("%-16s %12.3f (estimated from %d)\n", "nearest linear", t_linear * 1000.0, (int)reference);
+
+  vsx_point_grid grid;
+  t_build = 0.0;
+  t_query = 0.0;
+  for (int it = 0; it < iterations; it++)
+  {
+    timer.start();
+    grid.build(&v[0], v.size());
+    t_build += timer.dtime();
+    grid.nearest_batch(&origins[0], count, FLT_MAX, &hits[0]);
+    t_query += timer.dtime();
+  }
+  bool grid_ok = true;
+  for (size_t i = 0; i < reference; i++)
+  {
+    // ties may pick another vertex at the same distance
+    vsx_vector d = v[closest[i]] - origins[i];
+    grid_ok &= fabsf(d.length() - hits[i].distance) < 1e-5f;
+  }
+  printf("%-16s %12.3f cell %g\n", "grid build", t_build * 1000.0 / iterations, grid.get_cell_size());
+  printf("%-16s %12.3f %s\n", "grid nearest", t_query * 1000.0 / iterations, grid_ok ? "ok" : "MISMATCH");
+  return ok && grid_ok ? 0 : 1;
+}
+
+// straight from the definition in vsx_fft.h, O(n^2) per point
+static void fft_naive(const std::vector<vsx_fft_complex>& in, std::vector<vsx_fft_complex>& out, size_t sx, size_t sy, bool inverse)
+{
+  double sign = inverse ? 1.0 : -1.0;
+  double scale = inverse ? 1.0 : 1.0 / (double)(sx * sy);
+  for (size_t v = 0; v < sy; v++)
+  for (size_t u = 0; u < sx; u++)
+  {
+    double re = 0.0, im = 0.0;
+    for (size_t y = 0; y < sy; y++)
+    for (size_t x = 0; x < sx; x++)
+    {
+      double a = sign * 2.0 * M_PI * ((double)(u * x) / (double)sx + (double)(v * y) / (double)sy);
+      const vsx_fft_complex& c = in[y * sx + x];
+      re += c.re * cos(a) - c.im * sin(a);
+      im += c.re * sin(a) + c.im * cos(a);
+    }
+    out[v * sx + u].re = (float)(re * scale);
+    out[v * sx + u].im = (float)(im * scale);
+  }
+}
+
+static float fft_error(const std::vector<vsx_fft_complex>& a, const std::vector<vsx_fft_complex>& b)
+{
+  float e = 0.0f;
+  for (size_t i = 0; i < a.size(); i++)
+  {
+    if (fabsf(a[i].re - b[i].re) > e) e = fabsf(a[i].re - b[i].re);
+    if (fabsf(a[i].im - b[i].im) > e) e = fabsf(a[i].im - b[i].im);
+  }
+  return e;
+}
+
+// mesh;generators;ocean - vsx_fft_2d against the plain DFT for a few sizes
+// (forward, inverse, threaded and not), then the ocean update at size
+int bench_fft(size_t size, int iterations)
+{
+  bool ok = true;
+  vsx_timer timer;
+  printf("vsx_fft_2d against the naive DFT\n");
+  printf("%-10s %12s %12s %12s\n", "size", "forward err", "inverse err", "");
+  size_t sizes[][2] = {{4, 4}, {8, 16}, {32, 8}, {32, 32}};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+  {
+    size_t sx = sizes[s][0];
+    size_t sy = sizes[s][1];
+    std::vector<vsx_fft_complex> in(sx * sy), ref(sx * sy), data, data_threaded;
+    for (size_t i = 0; i < in.size(); i++)
+    {
+      in[i].re = (float)rand() / (float)RAND_MAX - 0.5f;
+      in[i].im = (float)rand() / (float)RAND_MAX - 0.5f;
+    }
+    vsx_fft_2d fft;
+    fft.init(sx, sy);
+
+    fft_naive(in, ref, sx, sy, false);
+    data = in;
+    fft.forward(&data[0], false);
+    data_threaded = in;
+    fft.forward(&data_threaded[0]);
+    float e_forward = fft_error(data, ref) + fft_error(data_threaded, ref);
+
+    fft_naive(in, ref, sx, sy, true);
+    data = in;
+    fft.inverse(&data[0], false);
+    data_threaded = in;
+    fft.inverse(&data_threaded[0]);
+    // the inverse doesn't scale, so the error grows with the sum
+    float e_inverse = (fft_error(data, ref) + fft_error(data_threaded, ref)) / (float)(sx * sy);
+
+    bool size_ok = e_forward < 1e-5f && e_inverse < 1e-5f;
+    ok &= size_ok;
+    char name[32];
+    sprintf(name, "%dx%d", (int)sx, (int)sy);
+    printf("%-10s %12g %12g %12s\n", name, e_forward, e_inverse, size_ok ? "ok" : "MISMATCH");
+  }
+
+  vsx_fft_2d fft;
+  if (!fft.init(size, size))
+  {
+    printf("size %d is not a power of two\n", (int)size);
+    return 1;
+  }
+  std::vector<vsx_fft_complex> data(size * size);
+  for (size_t i = 0; i < data.size(); i++)
+  {
+    data[i].re = (float)rand() / (float)RAND_MAX;
+    data[i].im = 0.0f;
+  }
+  std::vector<vsx_fft_complex> orig = data;
+  timer.start();
+  for (int i = 0; i < iterations; i++)
+  {
+    fft.forward(&data[0]);
+    fft.inverse(&data[0]);
+  }
+  double t_fft = timer.dtime() * 1000.0 / iterations;
+  float e_round = fft_error(data, orig);
+  bool round_ok = e_round < 1e-4f;
+  ok &= round_ok;
+  printf("%-16s %12.3f ms, error %g %s\n", "forward+inverse", t_fft, e_round, round_ok ? "ok" : "MISMATCH");
+
+  vsx_ocean ocean;
+  ocean.size = size;
+  ocean.calculate_h0();
+  timer.dtime();
+  for (int i = 0; i < iterations; i++)
+    ocean.update((float)i * 0.1f);
+  double t_ocean = timer.dtime() * 1000.0 / iterations;
+  // the surface is real (the imaginary parts are the packed displacement),
+  // so all that can go wrong here shows up as nan, a flat sea or bad normals
+  bool ocean_ok = ocean.height.size() == size * size;
+  float h_max = 0.0f;
+  for (size_t i = 0; ocean_ok && i < ocean.height.size(); i++)
+  {
+    float n = ocean.normals[i].length();
+    if (ocean.height[i] != ocean.height[i] || ocean.displacement_x[i] != ocean.displacement_x[i] || fabsf(n - 1.0f) > 1e-3f)
+      ocean_ok = false;
+    if (fabsf(ocean.height[i]) > h_max)
+      h_max = fabsf(ocean.height[i]);
+  }
+  ocean_ok &= h_max > 0.0f;
+  ok &= ocean_ok;
+  printf("%-16s %12.3f ms, max height %g %s\n", "ocean update", t_ocean, h_max, ocean_ok ? "ok" : "MISMATCH");
+  return ok ? 0 : 1;
+}
+
+// remembers what the sequence told it about and when
+class sequence_prefetch_module : public vsx_module
+{
+public:
+  float now;
+  std::vector<vsx_string> values;
+  std::vector<float> times;
+  void prefetch(const vsx_string& name, const vsx_string& value)
+  {
+    VSX_UNUSED(name);
+    values.push_back(value);
+    times.push_back(now);
+  }
+};
+
+// rows first.. announced exactly once each, at least horizon - frame before
+// they start
+static bool sequence_prefetch_check(sequence_prefetch_module& m, const char** names, size_t first, size_t rows, float row_length, float block_start, float horizon, float frame)
+{
+  bool ok = m.values.size() == rows - first;
+  for (size_t i = 0; ok && i < m.values.size(); i++)
+  {
+    float lead = block_start + (float)(first + i) * row_length - m.times[i];
+    ok = m.values[i] == names[first + i] && lead > horizon - frame - 1e-4f && lead <= horizon + 1e-4f;
+  }
+  return ok;
+}
+
+// engine;sequencer - string and resource params step from row to row and
+// the upcoming rows are announced through vsx_module::prefetch; then the
+// time of a frame of a rows long resource sequence
+int bench_sequence(size_t rows, int iterations)
+{
+  const char* names[] = {"a.png", "b.png", "c.png", "d.png"};
+  const float row_length = 3.0f;
+  const float horizon = 2.0f;
+  const float frame = 0.5f;
+  vsx_string rows_string;
+  for (size_t i = 0; i < 4; i++)
+    rows_string += vsx_string(i ? "|" : "") + f2s(row_length) + ";0;" + base64_encode(names[i]);
+
+  sequence_prefetch_module m;
+  vsx_module_param_resource* resource = new vsx_module_param_resource("filename");
+  resource->type = VSX_MODULE_PARAM_ID_RESOURCE;
+  resource->set("");
+  vsx_module_param_string* string = new vsx_module_param_string("text");
+  string->type = VSX_MODULE_PARAM_ID_STRING;
+  string->set("");
+  vsx_engine_param resource_param, string_param;
+  resource_param.module = &m;
+  resource_param.module_param = resource;
+  resource_param.name = "filename";
+  string_param.module = &m;
+  string_param.module_param = string;
+  string_param.name = "text";
+
+  vsx_param_sequence resource_seq(VSX_MODULE_PARAM_ID_RESOURCE, &resource_param);
+  vsx_param_sequence string_seq(VSX_MODULE_PARAM_ID_STRING, &string_param);
+  // like vsx_param_sequence_list::add_param_sequence
+  resource_seq.engine = 0;
+  resource_seq.comp = 0;
+  resource_seq.param = &resource_param;
+  string_seq.engine = 0;
+  string_seq.comp = 0;
+  string_seq.param = &string_param;
+  resource_seq.inject(rows_string);
+  string_seq.inject(rows_string);
+
+  // off the row boundaries so float sums can't land on one
+  bool step_ok = true;
+  m.now = 0.25f;
+  resource_seq.execute(m.now);
+  string_seq.execute(m.now);
+  resource_seq.prefetch_ahead(horizon);
+  while (m.now < 4.0f * row_length)
+  {
+    size_t row = (size_t)(m.now / row_length);
+    if (row > 3) row = 3;
+    step_ok &= resource->get() == names[row] && string->get() == names[row];
+    resource_seq.execute(frame);
+    string_seq.execute(frame);
+    m.now += frame;
+    resource_seq.prefetch_ahead(horizon);
+  }
+  // rewinding steps back too
+  resource_seq.execute(4.0f - m.now);
+  string_seq.execute(4.0f - m.now);
+  step_ok &= resource->get() == names[1] && string->get() == names[1];
+  resource_seq.execute(0.25f - 4.0f);
+  string_seq.execute(0.25f - 4.0f);
+  step_ok &= resource->get() == names[0] && string->get() == names[0];
+  printf("%-22s %s\n", "string/resource steps", step_ok ? "ok" : "MISMATCH");
+  // the first row is current from the start, not announced
+  bool ahead_ok = sequence_prefetch_check(m, names, 1, 4, row_length, 0.0f, horizon, frame);
+  printf("%-22s %s\n", "prefetch ahead", ahead_ok ? "ok" : "MISMATCH");
+
+  // a block of a master channel starting at block_start: the channel hands
+  // it the new part of its window every frame, in block time
+  m.values.clear();
+  m.times.clear();
+  const float block_start = 5.25f;
+  float end = 0.0f;
+  for (m.now = 0.0f; m.now < block_start + 4.0f * row_length; m.now += frame)
+  {
+    float to = m.now + horizon;
+    if (block_start <= to)
+      resource_seq.prefetch(end - block_start, to - block_start);
+    end = to;
+  }
+  // here the first row is included, the block isn't playing yet
+  bool block_ok = sequence_prefetch_check(m, names, 0, 4, row_length, block_start, horizon, frame);
+  printf("%-22s %s\n", "prefetch block", block_ok ? "ok" : "MISMATCH");
+
+  // timing: one frame of playback and lookahead on a long sequence
+  rows_string = "";
+  for (size_t i = 0; i < rows; i++)
+    rows_string += vsx_string(i ? "|" : "") + "0.1;0;" + base64_encode(vsx_string("file_") + i2s((int)i) + ".png");
+  resource_seq.inject(rows_string);
+  vsx_timer timer;
+  timer.start();
+  size_t frames = 0;
+  for (int it = 0; it < iterations; it++)
+  {
+    resource_seq.execute(-(float)rows);
+    for (float t = 0.0f; t < (float)rows * 0.1f; t += 0.0167f)
+    {
+      resource_seq.execute(0.0167f);
+      resource_seq.prefetch_ahead(horizon);
+      frames++;
+    }
+  }
+  printf("%-22s %12.3f us per frame, %d rows\n", "execute + prefetch", timer.dtime() * 1000000.0 / (double)frames, (int)rows);
+
+  resource_param.module_param = 0;
+  string_param.module_param = 0;
+  delete resource;
+  delete string;
+  return step_ok && ahead_ok && block_ok ? 0 : 1;
+}
+
+static float frand(float lo, float hi)
+{
+  return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+// largest difference between a and b relative to the size of the shape
+static float parametric_error(const vsx_vector* a, const vsx_vector* b, size_t count)
+{
+  float e = 0.0f, m = 1e-6f;
+  for (size_t i = 0; i < count; i++)
+  {
+    float d = fabsf(a[i].x - b[i].x) + fabsf(a[i].y - b[i].y) + fabsf(a[i].z - b[i].z);
+    if (d > e) e = d;
+    float s = fabsf(b[i].x) + fabsf(b[i].y) + fabsf(b[i].z);
+    if (s > m) m = s;
+  }
+  return e / m;
+}
+
+// mesh;solid;mesh_solid_supershape, super_banana and torus_knot - the row
+// tables of parametric_surface against the per vertex code they replaced,
+// on a side x side grid: eval3D for the supershape, center + N * x + B * y
+// for the tubes. Then the SSE separable row against plain multiplies for
+// column counts around the 4 wide steps.
+int bench_parametric(int side, int iterations)
+{
+  bool ok = true;
+  vsx_timer timer;
+  printf("mesh;solid parametric surfaces %dx%d, %d iterations\n", side, side, iterations);
+  printf("%-22s %12s %12s %12s\n", "pass", "vertex ms", "table ms", "error");
+
+  vsx_mesh_data data;
+  parametric_surface surface;
+  surface.set_resolution(&data, side + 1, side + 1);
+  std::vector<vsx_vector> reference((side + 1) * (side + 1));
+
+  // a, b, m, n1, n2, n3; the module defaults first
+  float shapes[][6] =
+  {
+    {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f},
+    {1.0f, 1.0f, 6.0f, 1.0f, 1.7f, 1.7f},
+    {1.2f, 0.8f, 7.0f, 0.2f, 1.7f, 1.7f},
+    {1.0f, 1.0f, 3.0f, 4.5f, 10.0f, 10.0f}
+  };
+  for (size_t s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++)
+  {
+    float* sh = shapes[s];
+    float theta_start = (float)-HALF_PI, theta_step = (float)PI / side;
+    float phi_start = (float)-PI, phi_step = (float)TWO_PI / side;
+
+    timer.start();
+    for (int it = 0; it < iterations; it++)
+    {
+      float phi = phi_start;
+      for (int i = 0; i <= side; i++)
+      {
+        float theta = theta_start;
+        for (int j = 0; j <= side; j++)
+        {
+          vsx_vector& v = reference[i * (side + 1) + j];
+          eval3D(sh[0], sh[1], sh[2], sh[3], sh[4], sh[5], phi, theta, v.x, v.y, v.z);
+          theta += theta_step;
+        }
+        phi += phi_step;
+      }
+    }
+    double t_vertex = timer.dtime() * 1000.0 / iterations;
+
+    supershape_tables tables;
+    for (int it = 0; it < iterations; it++)
+    {
+      tables.build(sh[0], sh[1], sh[2], sh[3], sh[4], sh[5], phi_start, phi_step, theta_start, theta_step, surface.rows, surface.columns);
+      surface.evaluate(&data, &supershape_row, (void*)&tables);
+    }
+    double t_table = timer.dtime() * 1000.0 / iterations;
+
+    float e = parametric_error(data.vertices.get_pointer(), &reference[0], reference.size());
+    bool shape_ok = e < 1e-5f;
+    ok &= shape_ok;
+    char name[64];
+    sprintf(name, "supershape m=%g n1=%g", sh[2], sh[3]);
+    printf("%-22s %12.3f %12.3f %12g %s\n", name, t_vertex, t_table, e, shape_ok ? "ok" : "MISMATCH");
+  }
+
+  // a tube around a random walk, frames from the walk like torus_knot
+  parametric_surface_tube tube;
+  int stacks = side + 1, sectors = side + 1;
+  tube.resize(stacks, sectors);
+  tube.set_angles((float)sectors);
+  vsx_vector pos(0, 0, 0);
+  for (int i = 0; i < stacks; i++)
+  {
+    vsx_vector t(frand(0.5f, 1.0f), frand(-0.5f, 0.5f), frand(-0.5f, 0.5f));
+    t.normalize();
+    vsx_vector up(0, 0, 1);
+    vsx_vector n;
+    n.cross(t, up);
+    n.normalize();
+    vsx_vector b;
+    b.cross(t, n);
+    pos += t * 0.1f;
+    tube.center[i] = pos;
+    tube.x_axis[i] = n;
+    tube.y_axis[i] = b;
+    tube.radius_x[i] = frand(0.05f, 0.2f);
+    tube.radius_y[i] = frand(0.05f, 0.2f);
+  }
+  timer.start();
+  for (int it = 0; it < iterations; it++)
+  {
+    double j1_div = 1.0 / (double)sectors;
+    for (int i = 0; i < stacks; i++)
+      for (int j = 0; j < sectors; j++)
+      {
+        double j1 = (float)j * j1_div;
+        float px = cos(j1 * TWO_PI) * tube.radius_x[i];
+        float py = sin(j1 * TWO_PI) * tube.radius_y[i];
+        vsx_vector v = tube.center[i];
+        v += tube.x_axis[i] * px + tube.y_axis[i] * py;
+        reference[i * sectors + j] = v;
+      }
+  }
+  double t_vertex = timer.dtime() * 1000.0 / iterations;
+  for (int it = 0; it < iterations; it++)
+    surface.evaluate(&data, &parametric_surface_tube::row, (void*)&tube);
+  double t_table = timer.dtime() * 1000.0 / iterations;
+  float e = parametric_error(data.vertices.get_pointer(), &reference[0], reference.size());
+  bool tube_ok = e < 1e-5f;
+  ok &= tube_ok;
+  printf("%-22s %12.3f %12.3f %12g %s\n", "tube", t_vertex, t_table, e, tube_ok ? "ok" : "MISMATCH");
+
+  // every column count up to two 4 wide steps past the tail
+  bool row_ok = true;
+  std::vector<float> column_x(64), column_z(64);
+  std::vector<vsx_vector> out(64), plain(64);
+  for (int columns = 1; columns <= 64; columns++)
+  {
+    for (int k = 0; k < columns; k++)
+    {
+      column_x[k] = frand(-2.0f, 2.0f);
+      column_z[k] = frand(-2.0f, 2.0f);
+    }
+    float a = frand(-2.0f, 2.0f), b = frand(-2.0f, 2.0f);
+    // one past the end must stay untouched
+    out[columns < 64 ? columns : 0] = vsx_vector(7, 7, 7);
+    parametric_surface_separable_row(a, b, &column_x[0], &column_z[0], columns, &out[0]);
+    for (int k = 0; k < columns; k++)
+    {
+      plain[k].x = a * column_x[k];
+      plain[k].y = b * column_x[k];
+      plain[k].z = column_z[k];
+      row_ok &= out[k].x == plain[k].x && out[k].y == plain[k].y && out[k].z == plain[k].z;
+    }
+    if (columns < 64)
+      row_ok &= out[columns].x == 7 && out[columns].y == 7 && out[columns].z == 7;
+  }
+  ok &= row_ok;
+#ifdef __SSE2__
+  printf("%-22s %s\n", "separable row sse", row_ok ? "ok" : "MISMATCH");
+#else
+  printf("%-22s %s (no sse2, scalar only)\n", "separable row", row_ok ? "ok" : "MISMATCH");
+#endif
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+  printf("Vovoid VSXu benchmarks\n");
+  if (argc < 2 || vsx_string(argv[1]) == "-help")
+  {
+    printf("syntax:\n"
+           "  vsxbench blend [size=512] [iterations=20]       bitmaps;filters blend modes\n"
+           "  vsxbench particles [size=512] [iterations=20]   bitmap2particlesystem\n"
+           "  vsxbench mesh [side=708] [iterations=20]        mesh kernels, 2*side^2 faces\n"
+           "  vsxbench sort [count=200000] [iterations=20]    depth sorting\n"
+           "  vsxbench obj [side=500] [iterations=5]          obj importer, 2*side^2 faces\n"
+           "  vsxbench spatial [count=100000] [iterations=5]  bvh / point grid queries\n"
+           "  vsxbench fft [size=256] [iterations=20]        2d fft and ocean\n"
+           "  vsxbench sequence [rows=1000] [iterations=5]    sequencer stepping, prefetch\n"
+           "  vsxbench parametric [side=400] [iterations=5]   supershape / tube rows\n");
+    return 0;
+  }
+  vsx_string test = argv[1];
+  if (test == "blend")
+  {
+    unsigned long size = argc > 2 ? atoi(argv[2]) : 512;
+    int iterations = argc > 3 ? atoi(argv[3]) : 20;
+    if (size < 1) size = 1;
+    if (iterations < 1) iterations = 1;
+    return bench_bitmap_blend(size, iterations);
+  }
+  if (test == "particles")
+  {
+    unsigned long size = argc > 2 ? atoi(argv[2]) : 512;
+    int iterations = argc > 3 ? atoi(argv[3]) : 20;
+    if (size < 1) size = 1;
+    if (iterations < 1) iterations = 1;
+    return bench_bitmap_particles(size, iterations);
+  }
+  if (test == "mesh")
+  {
+    unsigned long side = argc > 2 ? atoi(argv[2]) : 708;
+    int iterations = argc > 3 ? atoi(argv[3]) : 20;
+    if (side < 1) side = 1;
+    if (iterations < 1) iterations = 1;
+    return bench_mesh_kernels(side, iterations);
+  }
+  if (test == "sort")
+  {
+    size_t count = argc > 2 ? atoi(argv[2]) : 200000;
+    int iterations = argc > 3 ? atoi(argv[3]) : 20;
+    if (count < 1) count = 1;
+    if (iterations < 1) iterations = 1;
+    return bench_sort(count, iterations);
+  }
+  if (test == "obj")
+  {
+    unsigned long side = argc > 2 ? atoi(argv[2]) : 500;
+    int iterations = argc > 3 ? atoi(argv[3]) : 5;
+    if (side < 1) side = 1;
+    if (iterations < 1) iterations = 1;
+    return bench_obj(side, iterations);
+  }
+  if (test == "spatial")
+  {
+    size_t count = argc > 2 ? atoi(argv[2]) : 100000;
+    int iterations = argc > 3 ? atoi(argv[3]) : 5;
+    if (count < 1) count = 1;
+    if (iterations < 1) iterations = 1;
+    return bench_spatial(count, 256, iterations);
+  }
+  if (test == "fft")
+  {
+    size_t size = argc > 2 ? atoi(argv[2]) : 256;
+    int iterations = argc > 3 ? atoi(argv[3]) : 20;
+    if (size < 2) size = 2;
+    if (iterations < 1) iterations = 1;
+    return bench_fft(size, iterations);
+  }
+  if (test == "sequence")
+  {
+    size_t rows = argc > 2 ? atoi(argv[2]) : 1000;
+    int iterations = argc > 3 ? atoi(argv[3]) : 5;
+    if (rows < 1) rows = 1;
+    if (iterations < 1) iterations = 1;
+    return bench_sequence(rows, iterations);
+  }
+  if (test == "parametric")
+  {
+    int side = argc > 2 ? atoi(argv[2]) : 400;
+    int iterations = argc > 3 ? atoi(argv[3]) : 5;
+    if (side < 1) side = 1;
+    if (iterations < 1) iterations = 1;
+    return bench_parametric(side, iterations);
+  }
+  printf("unknown benchmark: %s\n", argv[1]);
+  return 1;
+}
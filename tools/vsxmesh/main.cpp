@@ -0,0 +1,363 @@
+/**
+* Project: VSXu: Realtime modular visual programming language, music/audio visualizer.
+*
+* This file is part of Vovoid VSXu.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Public License (GPL)
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+// Converts .obj and .vxm meshes to .vxb (see vsx_mesh_container.h) so show
+// assets can be baked once instead of parsed on every load. -verify round
+// trips meshes through the format without writing anything.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "vsx_string.h"
+#include "vsxfst.h"
+#include "vsx_mesh.h"
+#include "vsx_mesh_container.h"
+#include "vsx_thread_pool.h"
+#include "mesh.importers.obj/obj_parser.h"
+
+// the old vxm layout: "vxm\0", then vertices, normals, texture coordinates
+// and faces, each as a native size_t byte count followed by the raw memory
+bool read_vxm(const unsigned char* data, unsigned long size, vsx_mesh_data* out)
+{
+  if (size < 4 || memcmp(data, "vxm", 4) != 0)
+    return false;
+  const unsigned char* p = data + 4;
+  const unsigned char* end = data + size;
+  for (int section = 0; section < 4; section++)
+  {
+    size_t bytes;
+    if ((size_t)(end - p) < sizeof(size_t))
+      return false;
+    memcpy(&bytes, p, sizeof(size_t));
+    p += sizeof(size_t);
+    if (bytes > (size_t)(end - p))
+      return false;
+    switch (section)
+    {
+      case 0:
+      case 1:
+      {
+        vsx_array<vsx_vector>& a = section ? out->vertex_normals : out->vertices;
+        for (size_t i = 0; i < bytes / sizeof(vsx_vector); i++)
+          memcpy((void*)&a[i], p + i * sizeof(vsx_vector), sizeof(vsx_vector));
+        break;
+      }
+      case 2:
+        for (size_t i = 0; i < bytes / sizeof(vsx_tex_coord); i++)
+          memcpy((void*)&out->vertex_tex_coords[i], p + i * sizeof(vsx_tex_coord), sizeof(vsx_tex_coord));
+        break;
+      case 3:
+        for (size_t i = 0; i < bytes / sizeof(vsx_face); i++)
+          memcpy((void*)&out->faces[i], p + i * sizeof(vsx_face), sizeof(vsx_face));
+        break;
+    }
+    p += bytes;
+  }
+  return true;
+}
+
+// own copy of an array that may point into a file
+template<class T>
+void copy_array(vsx_array<T>& dest, vsx_array<T>& source)
+{
+  dest.reset_used(0);
+  if (!source.size())
+    return;
+  dest.allocate(source.size() - 1);
+  dest.reset_used(source.size());
+  memcpy((void*)dest.get_pointer(), (void*)source.get_pointer(), sizeof(T) * source.size());
+  source.unset_volatile();
+}
+
+bool read_mesh(vsxf& filesystem, vsx_string filename, bool preserve_uv_coords, vsx_mesh_data* out)
+{
+  vsxf_handle* fp = filesystem.f_open(filename.c_str(), "rb");
+  if (!fp)
+  {
+    printf("%s: could not open\n", filename.c_str());
+    return false;
+  }
+  const unsigned char* data = (const unsigned char*)filesystem.f_data_map(fp);
+  bool ok = false;
+  if (verify_filesuffix(filename, "obj"))
+    ok = obj_parser_load((const char*)data, fp->size, preserve_uv_coords, out, vsx_thread_pool::get_instance());
+  else
+  if (verify_filesuffix(filename, "vxm"))
+    ok = read_vxm(data, fp->size, out);
+  else
+  if (verify_filesuffix(filename, "vxb"))
+  {
+    // to (un)compress an existing one - copied, the file goes away below
+    vsx_mesh_container c;
+    vsx_mesh_data in_file;
+    ok = c.load_memory(data, fp->size, &in_file);
+    copy_array(out->vertices, in_file.vertices);
+    copy_array(out->vertex_normals, in_file.vertex_normals);
+    copy_array(out->vertex_tex_coords, in_file.vertex_tex_coords);
+    copy_array(out->vertex_colors, in_file.vertex_colors);
+    copy_array(out->vertex_tangents, in_file.vertex_tangents);
+    copy_array(out->faces, in_file.faces);
+  }
+  else
+    printf("%s: not an obj, vxm or vxb file\n", filename.c_str());
+  filesystem.f_close(fp);
+  if (ok && !out->vertices.size())
+  {
+    printf("%s: no vertices\n", filename.c_str());
+    ok = false;
+  }
+  return ok;
+}
+
+template<class T>
+bool same_array(const char* name, const char* what, vsx_array<T>& a, vsx_array<T>& b)
+{
+  if (a.size() != b.size() || (a.size() && memcmp((void*)a.get_pointer(), (void*)b.get_pointer(), sizeof(T) * a.size()) != 0))
+  {
+    printf("FAIL %s: %s differ after read back\n", name, what);
+    return false;
+  }
+  return true;
+}
+
+// serialize, read back and compare every attribute bit for bit
+bool verify_mesh(const char* name, vsx_mesh_data* data, bool compress)
+{
+  vsx_mesh_container built;
+  built.flags = compress ? VSX_MESH_CONTAINER_COMPRESSED : 0;
+  unsigned long file_size;
+  unsigned char* file = built.serialize(data, file_size);
+  if (!file)
+  {
+    printf("FAIL %s: could not serialize\n", name);
+    return false;
+  }
+  // the file through a 64 byte aligned buffer, like a mapping
+  unsigned char* buffer = (unsigned char*)malloc(file_size + 64);
+  unsigned char* aligned = buffer + (64 - ((size_t)buffer & 63));
+  memcpy(aligned, file, file_size);
+  free(file);
+  vsx_mesh_container c;
+  vsx_mesh_data loaded;
+  bool ok = c.load_memory((const unsigned char*)aligned, file_size, &loaded);
+  if (!ok)
+    printf("FAIL %s: could not read back\n", name);
+  ok = ok && same_array(name, "vertices", data->vertices, loaded.vertices);
+  ok = ok && same_array(name, "normals", data->vertex_normals, loaded.vertex_normals);
+  ok = ok && same_array(name, "texture coordinates", data->vertex_tex_coords, loaded.vertex_tex_coords);
+  ok = ok && same_array(name, "colors", data->vertex_colors, loaded.vertex_colors);
+  ok = ok && same_array(name, "tangents", data->vertex_tangents, loaded.vertex_tangents);
+  ok = ok && same_array(name, "faces", data->faces, loaded.faces);
+  if (ok && !compress && !(c.in_place & VSX_MESH_CONTAINER_VERTICES))
+  {
+    printf("FAIL %s: vertices were copied\n", name);
+    ok = false;
+  }
+  // every single byte flipped in turn must be caught or harmless
+  if (ok && file_size < 65536)
+  {
+    unsigned char* broken = aligned;
+    for (unsigned long i = 0; i < file_size; i++)
+    {
+      broken[i] ^= 0x5A;
+      vsx_mesh_data junk;
+      vsx_mesh_container jc;
+      if (jc.load_memory(broken, file_size, &junk))
+      {
+        for (unsigned long f = 0; f < junk.faces.size(); f++)
+          if (junk.faces[f].a >= junk.vertices.size() || junk.faces[f].b >= junk.vertices.size() || junk.faces[f].c >= junk.vertices.size())
+          {
+            printf("FAIL %s: byte %lu let a bad face through\n", name, i);
+            ok = false;
+            break;
+          }
+      }
+      junk.vertices.unset_volatile();
+      junk.vertex_normals.unset_volatile();
+      junk.vertex_tex_coords.unset_volatile();
+      junk.vertex_colors.unset_volatile();
+      junk.vertex_tangents.unset_volatile();
+      junk.faces.unset_volatile();
+      broken[i] ^= 0x5A;
+      if (!ok)
+        break;
+    }
+  }
+  loaded.vertices.unset_volatile();
+  loaded.vertex_normals.unset_volatile();
+  loaded.vertex_tex_coords.unset_volatile();
+  loaded.vertex_colors.unset_volatile();
+  loaded.vertex_tangents.unset_volatile();
+  loaded.faces.unset_volatile();
+  free(buffer);
+  if (ok)
+    printf("ok   %s: %lu vertices, %lu faces, %s, %lu bytes\n", name, c.vertex_count, c.face_count, compress ? "compressed" : "raw", file_size);
+  return ok;
+}
+
+// grids with and without the optional attributes, odd sizes so the
+// compressed blocks don't line up
+bool verify_synthetic(bool compress)
+{
+  unsigned long sides[] = { 1, 2, 5, 64, 67 };
+  bool ok = true;
+  for (size_t s = 0; s < sizeof(sides) / sizeof(sides[0]); s++)
+  {
+    unsigned long side = sides[s];
+    unsigned long n = side + 1;
+    vsx_mesh_data data;
+    for (unsigned long y = 0; y < n; y++)
+      for (unsigned long x = 0; x < n; x++)
+      {
+        unsigned long i = y * n + x;
+        data.vertices[i] = vsx_vector((float)x * 0.1f, sinf((float)(x * y)), -(float)y * 0.3f);
+        if (s & 1)
+        {
+          data.vertex_tex_coords[i] = vsx_tex_coord__((float)x / side, (float)y / side);
+          data.vertex_colors[i] = vsx_color((float)x / side, 0.5f, (float)y / side, 1.0f);
+        }
+      }
+    for (unsigned long y = 0; y < side; y++)
+      for (unsigned long x = 0; x < side; x++)
+      {
+        vsx_face f;
+        f.a = y * n + x;
+        f.b = f.a + 1;
+        f.c = f.a + n;
+        data.faces.push_back(f);
+        f.a = f.b;
+        f.b = f.c + 1;
+        data.faces.push_back(f);
+      }
+    char name[64];
+    sprintf(name, "synthetic %lux%lu%s", side, side, s & 1 ? " uv/colors" : "");
+    ok &= verify_mesh(name, &data, compress);
+  }
+  return ok;
+}
+
+vsx_string vxb_filename(vsx_string filename)
+{
+  for (int i = (int)filename.size() - 1; i >= 0; i--)
+  {
+    if (filename[i] == '.')
+      return filename.substr(0, i) + ".vxb";
+    if (filename[i] == '/' || filename[i] == '\\')
+      break;
+  }
+  return filename + ".vxb";
+}
+
+int main(int argc, char* argv[])
+{
+  printf("Vovoid VSXu mesh converter\n");
+  if (argc < 2 || vsx_string(argv[1]) == "-help")
+  {
+    printf("syntax:\n"
+           "  vsxmesh [-z] [-nouv] [-a archive.vsx] mesh.obj [mesh.vxm ...]\n"
+           "      writes mesh.vxb next to each input, or all of them into a new archive\n"
+           "      -z     compress (smaller, decoded on load instead of used in place)\n"
+           "      -nouv  obj: vertices are the v lines only, like obj_importer's preserve_uv_coords=NO\n"
+           "  vsxmesh -verify [-z] [mesh.obj ...]\n"
+           "      round trips the meshes (or built in test grids) without writing anything\n");
+    return 0;
+  }
+
+  bool compress = false;
+  bool preserve_uv_coords = true;
+  bool verify = false;
+  vsx_string archive_name;
+  std::vector<vsx_string> inputs;
+  for (int i = 1; i < argc; i++)
+  {
+    vsx_string arg = argv[i];
+    if (arg == "-z") compress = true;
+    else if (arg == "-nouv") preserve_uv_coords = false;
+    else if (arg == "-verify") verify = true;
+    else if (arg == "-a" && i + 1 < argc) archive_name = argv[++i];
+    else inputs.push_back(arg);
+  }
+
+  vsxf filesystem;
+  if (verify)
+  {
+    bool ok = true;
+    if (!inputs.size())
+    {
+      ok &= verify_synthetic(false);
+      ok &= verify_synthetic(true);
+    }
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+      vsx_mesh_data data;
+      if (!read_mesh(filesystem, inputs[i], preserve_uv_coords, &data))
+      {
+        ok = false;
+        continue;
+      }
+      ok &= verify_mesh(inputs[i].c_str(), &data, compress);
+    }
+    printf(ok ? "all ok\n" : "FAILED\n");
+    return ok ? 0 : 1;
+  }
+
+  vsxf archive;
+  if (archive_name.size())
+    archive.archive_create(archive_name.c_str());
+  int errors = 0;
+  for (size_t i = 0; i < inputs.size(); i++)
+  {
+    vsx_mesh_data data;
+    if (!read_mesh(filesystem, inputs[i], preserve_uv_coords, &data))
+    {
+      errors++;
+      continue;
+    }
+    vsx_mesh_container c;
+    c.flags = compress ? VSX_MESH_CONTAINER_COMPRESSED : 0;
+    unsigned long size;
+    unsigned char* file = c.serialize(&data, size);
+    vsx_string out_name = vxb_filename(inputs[i]);
+    if (archive_name.size())
+    {
+      archive.archive_add_file(out_name, (char*)file, size);
+    }
+    else
+    {
+      FILE* fp = fopen(out_name.c_str(), "wb");
+      if (!fp || fwrite(file, 1, size, fp) != size)
+      {
+        printf("%s: could not write\n", out_name.c_str());
+        errors++;
+      }
+      if (fp) fclose(fp);
+    }
+    printf("%s -> %s (%lu vertices, %lu faces, %lu bytes)\n", inputs[i].c_str(), out_name.c_str(), c.vertex_count, c.face_count, size);
+    free(file);
+  }
+  if (archive_name.size())
+    archive.archive_close();
+  return errors ? 1 : 0;
+}
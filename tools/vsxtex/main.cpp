@@ -0,0 +1,343 @@
+/**
+* Project: VSXu: Realtime modular visual programming language, music/audio visualizer.
+*
+* This file is part of Vovoid VSXu.
+*
+* @author Jonatan Wallmander, Robert Wenzel, Vovoid Media Technologies AB Copyright (C) 2003-2013
+* @see The GNU Public License (GPL)
+*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, write to the Free Software Foundation, Inc.,
+* 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+// Converts png/jpeg images to .vxt texture containers (see
+// vsx_texture_container.h). Needs no OpenGL context, so -verify can run
+// on a build machine.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include "vsx_string.h"
+#include "vsxfst.h"
+#include "vsxg.h"
+#include "vsx_texture_container.h"
+
+// decode any png/jpeg to top down RGBA8
+unsigned char* decode_image(vsxf& filesystem, vsx_string filename, unsigned long& size_x, unsigned long& size_y)
+{
+  if (verify_filesuffix(filename, "jpg") || verify_filesuffix(filename, "jpeg"))
+  {
+    CJPEGTest cj;
+    vsx_string err;
+    if (!cj.LoadJPEG(filename, err, &filesystem))
+    {
+      printf("%s: %s\n", filename.c_str(), err.c_str());
+      return 0;
+    }
+    size_x = cj.GetResX();
+    size_y = cj.GetResY();
+    unsigned char* out = (unsigned char*)malloc(size_x * size_y * 4);
+    for (unsigned long i = 0; i < size_x * size_y; i++)
+    {
+      out[i*4] = cj.m_pBuf[i*3];
+      out[i*4+1] = cj.m_pBuf[i*3+1];
+      out[i*4+2] = cj.m_pBuf[i*3+2];
+      out[i*4+3] = 255;
+    }
+    return out;
+  }
+
+  pngRawInfo pp;
+  if (!pngLoadRaw(filename.c_str(), &pp, &filesystem))
+  {
+    printf("%s: could not decode png\n", filename.c_str());
+    return 0;
+  }
+  size_x = pp.Width;
+  size_y = pp.Height;
+  unsigned char* out = (unsigned char*)malloc(size_x * size_y * 4);
+  for (unsigned long i = 0; i < size_x * size_y; i++)
+  {
+    unsigned char* s = pp.Data + i * pp.Components;
+    switch (pp.Components)
+    {
+      case 1: out[i*4] = out[i*4+1] = out[i*4+2] = s[0]; out[i*4+3] = 255; break;
+      case 2: out[i*4] = out[i*4+1] = out[i*4+2] = s[0]; out[i*4+3] = s[1]; break;
+      case 3: out[i*4] = s[0]; out[i*4+1] = s[1]; out[i*4+2] = s[2]; out[i*4+3] = 255; break;
+      default: memcpy(out + i*4, s, 4);
+    }
+  }
+  free(pp.Data);
+  return out;
+}
+
+float texel(vsx_texture_container& c, int level, unsigned long i)
+{
+  if (c.format == VSX_TEXTURE_CONTAINER_RGBA16F)
+    return vsx_texture_container::half_to_float(((uint16_t*)c.levels[level].data)[i]);
+  return ((unsigned char*)c.levels[level].data)[i];
+}
+
+// build, write, read back and check every level against the source
+bool verify_bitmap(const char* name, const unsigned char* rgba, unsigned long size_x, unsigned long size_y, int format, bool mipmaps)
+{
+  vsx_texture_container built;
+  if (!built.build(rgba, size_x, size_y, format, mipmaps))
+  {
+    printf("FAIL %s: build failed\n", name);
+    return false;
+  }
+  unsigned long file_size;
+  unsigned char* file = built.serialize(file_size);
+  vsx_texture_container c;
+  bool ok = c.load_memory(file, file_size);
+  free(file);
+  if (!ok)
+  {
+    printf("FAIL %s: could not read back, %s\n", name, c.error);
+    return false;
+  }
+
+  unsigned long expected_levels = 1;
+  if (mipmaps)
+    for (unsigned long m = size_x > size_y ? size_x : size_y; m > 1; m /= 2)
+      expected_levels++;
+  if (c.levels.size() != expected_levels || c.levels.size() != built.levels.size() || c.size_x != size_x || c.size_y != size_y)
+  {
+    printf("FAIL %s: %d levels, expected %d\n", name, (int)c.levels.size(), (int)expected_levels);
+    return false;
+  }
+
+  float tolerance = format == VSX_TEXTURE_CONTAINER_RGBA16F ? 1.0f / 1024.0f : 0.0f;
+  float scale = format == VSX_TEXTURE_CONTAINER_RGBA16F ? 1.0f / 255.0f : 1.0f;
+  for (size_t l = 0; l < c.levels.size(); l++)
+  {
+    vsx_texture_container_level& lv = c.levels[l];
+    if (lv.data_size != built.levels[l].data_size || memcmp(lv.data, built.levels[l].data, lv.data_size) != 0)
+    {
+      printf("FAIL %s: level %d differs after read back\n", name, (int)l);
+      return false;
+    }
+    if (l == 0)
+    {
+      // flipped copy of the source
+      for (unsigned long y = 0; y < size_y; y++)
+      for (unsigned long x = 0; x < size_x * 4; x++)
+        if (fabs(texel(c, 0, y * size_x * 4 + x) - rgba[(size_y - 1 - y) * size_x * 4 + x] * scale) > tolerance)
+        {
+          printf("FAIL %s: level 0 pixel %lu,%lu\n", name, x / 4, y);
+          return false;
+        }
+      continue;
+    }
+    vsx_texture_container_level& pv = c.levels[l - 1];
+    unsigned long ex = pv.size_x > 1 ? pv.size_x / 2 : 1;
+    unsigned long ey = pv.size_y > 1 ? pv.size_y / 2 : 1;
+    if (lv.size_x != ex || lv.size_y != ey)
+    {
+      printf("FAIL %s: level %d is %lux%lu, expected %lux%lu\n", name, (int)l, lv.size_x, lv.size_y, ex, ey);
+      return false;
+    }
+    // every texel is the average of its 2x2 footprint in the level above
+    for (unsigned long y = 0; y < ey; y++)
+    for (unsigned long x = 0; x < ex; x++)
+    for (int ch = 0; ch < 4; ch++)
+    {
+      unsigned long x0 = x * 2, x1 = x * 2 + 1 < pv.size_x ? x * 2 + 1 : pv.size_x - 1;
+      unsigned long y0 = y * 2, y1 = y * 2 + 1 < pv.size_y ? y * 2 + 1 : pv.size_y - 1;
+      float sum =
+        texel(c, l - 1, (y0 * pv.size_x + x0) * 4 + ch) +
+        texel(c, l - 1, (y0 * pv.size_x + x1) * 4 + ch) +
+        texel(c, l - 1, (y1 * pv.size_x + x0) * 4 + ch) +
+        texel(c, l - 1, (y1 * pv.size_x + x1) * 4 + ch);
+      float expected = format == VSX_TEXTURE_CONTAINER_RGBA16F ? sum * 0.25f : floorf((sum + 2.0f) / 4.0f);
+      if (fabs(texel(c, l, (y * ex + x) * 4 + ch) - expected) > tolerance * 2.0f)
+      {
+        printf("FAIL %s: level %d pixel %lu,%lu\n", name, (int)l, x, y);
+        return false;
+      }
+    }
+  }
+  printf("ok   %s: %lux%lu %s, %d levels, %lu bytes\n", name, size_x, size_y,
+    format == VSX_TEXTURE_CONTAINER_RGBA16F ? "rgba16f" : "rgba8", (int)c.levels.size(), file_size);
+  return true;
+}
+
+// odd and non square sizes are the interesting ones for the box filter
+bool verify_synthetic(int format, bool mipmaps)
+{
+  unsigned long sizes[][2] = { {1, 1}, {2, 2}, {7, 3}, {64, 64}, {33, 17}, {1, 40}, {256, 128} };
+  bool ok = true;
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+  {
+    unsigned long sx = sizes[s][0], sy = sizes[s][1];
+    unsigned char* rgba = (unsigned char*)malloc(sx * sy * 4);
+    for (unsigned long i = 0; i < sx * sy * 4; i++)
+      rgba[i] = (unsigned char)((i * 2654435761u) >> 24);
+    char name[64];
+    sprintf(name, "synthetic %lux%lu", sx, sy);
+    ok &= verify_bitmap(name, rgba, sx, sy, format, mipmaps);
+    free(rgba);
+  }
+  return ok;
+}
+
+// the header is little endian on any host, other versions and formats
+// don't load
+bool verify_header()
+{
+  unsigned char rgba[3 * 2 * 4] = {0};
+  vsx_texture_container built;
+  built.build(rgba, 3, 2, VSX_TEXTURE_CONTAINER_RGBA16F, false);
+  unsigned long file_size;
+  unsigned char* file = built.serialize(file_size);
+  const unsigned char expected[] = {'V', 'X', 'T', '1', 1, 0, 0, 0};
+  bool ok = memcmp(file, expected, sizeof(expected)) == 0 && file[12] == 3 && file[16] == 2 && file[20] == 1;
+  if (!ok)
+    printf("FAIL header: not little endian\n");
+
+  vsx_texture_container c;
+  file[3] = '2';
+  if (c.load_memory(file, file_size))
+  {
+    printf("FAIL header: loaded version 2\n");
+    ok = false;
+  }
+  file[3] = '1';
+  file[4] = 7;
+  if (c.load_memory(file, file_size))
+  {
+    printf("FAIL header: loaded format 7\n");
+    ok = false;
+  }
+  file[4] = 1;
+  if (!c.load_memory(file, file_size))
+  {
+    printf("FAIL header: could not read back, %s\n", c.error);
+    ok = false;
+  }
+  free(file);
+  if (ok)
+    printf("ok   header: little endian, other versions and formats rejected\n");
+  return ok;
+}
+
+vsx_string vxt_filename(vsx_string filename)
+{
+  for (int i = (int)filename.size() - 1; i >= 0; i--)
+  {
+    if (filename[i] == '.')
+      return filename.substr(0, i) + ".vxt";
+    if (filename[i] == '/' || filename[i] == '\\')
+      break;
+  }
+  return filename + ".vxt";
+}
+
+int main(int argc, char* argv[])
+{
+  printf("Vovoid VSXu texture converter\n");
+  if (argc < 2 || vsx_string(argv[1]) == "-help")
+  {
+    printf("syntax:\n"
+           "  vsxtex [-f16] [-nomip] [-a archive.vsx] image.png [image.jpg ...]\n"
+           "      writes image.vxt next to each input, or all of them into a new archive\n"
+           "  vsxtex -verify [-f16] [-nomip] [image.png ...]\n"
+           "      round trips the images (or built in test bitmaps) without writing anything\n");
+    return 0;
+  }
+
+  int format = VSX_TEXTURE_CONTAINER_RGBA8;
+  bool mipmaps = true;
+  bool verify = false;
+  vsx_string archive_name;
+  std::vector<vsx_string> inputs;
+  for (int i = 1; i < argc; i++)
+  {
+    vsx_string arg = argv[i];
+    if (arg == "-f16") format = VSX_TEXTURE_CONTAINER_RGBA16F;
+    else if (arg == "-nomip") mipmaps = false;
+    else if (arg == "-verify") verify = true;
+    else if (arg == "-a" && i + 1 < argc) archive_name = argv[++i];
+    else inputs.push_back(arg);
+  }
+
+  vsxf filesystem;
+  if (verify)
+  {
+    bool ok = true;
+    if (!inputs.size())
+    {
+      ok &= verify_header();
+      ok &= verify_synthetic(VSX_TEXTURE_CONTAINER_RGBA8, mipmaps);
+      ok &= verify_synthetic(VSX_TEXTURE_CONTAINER_RGBA16F, mipmaps);
+    }
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+      unsigned long sx, sy;
+      unsigned char* rgba = decode_image(filesystem, inputs[i], sx, sy);
+      if (!rgba)
+      {
+        ok = false;
+        continue;
+      }
+      ok &= verify_bitmap(inputs[i].c_str(), rgba, sx, sy, format, mipmaps);
+      free(rgba);
+    }
+    printf(ok ? "all ok\n" : "FAILED\n");
+    return ok ? 0 : 1;
+  }
+
+  vsxf archive;
+  if (archive_name.size())
+    archive.archive_create(archive_name.c_str());
+  int errors = 0;
+  for (size_t i = 0; i < inputs.size(); i++)
+  {
+    unsigned long sx, sy;
+    unsigned char* rgba = decode_image(filesystem, inputs[i], sx, sy);
+    if (!rgba)
+    {
+      errors++;
+      continue;
+    }
+    vsx_texture_container c;
+    c.build(rgba, sx, sy, format, mipmaps);
+    free(rgba);
+    unsigned long size;
+    unsigned char* data = c.serialize(size);
+    vsx_string out_name = vxt_filename(inputs[i]);
+    if (archive_name.size())
+    {
+      archive.archive_add_file(out_name, (char*)data, size);
+    }
+    else
+    {
+      FILE* fp = fopen(out_name.c_str(), "wb");
+      if (!fp || fwrite(data, 1, size, fp) != size)
+      {
+        printf("%s: could not write\n", out_name.c_str());
+        errors++;
+      }
+      if (fp) fclose(fp);
+    }
+    printf("%s -> %s (%d levels, %lu bytes)\n", inputs[i].c_str(), out_name.c_str(), (int)c.levels.size(), size);
+    free(data);
+  }
+  if (archive_name.size())
+    archive.archive_close();
+  return errors ? 1 : 0;
+}